@@ -94,55 +94,119 @@ double GetLNDetMInvMInf(SC3Data *SC3D)
 } 
 
 /***************************************************************/
-/* compute \trace \{ M^{-1} dMdAlpha\},                        */
-/* where Alpha=x, y, z                                         */
+/* compute \trace \{ M^{-1} dMdAlpha\} for all requested force */
+/* and torque quantities (Alpha=x, y, z, theta_1..3), storing  */
+/* the results in the requested order in Traces[]. the return  */
+/* value is the number of quantities computed.                 */
+/*                                                             */
+/* the only nonzero blocks of dMdAlpha are the (0,ns) blocks   */
+/* dU_{0,ns} and their adjoints (ns>0), so                     */
+/*                                                             */
+/*  \trace M^{-1} dM = 2 Re \sum_{ns>0} \trace                 */
+/*                       { dU_{0,ns} [M^{-1}]_{ns,0} }         */
+/*                                                             */
+/* (using the hermiticity of M); this requires only the first  */
+/* N1 columns of M^{-1}, which we obtain with a single LU      */
+/* solve that is shared by all quantities. the cost of each    */
+/* individual quantity is then only O(N*N1).                   */
+/*                                                             */
+/* if SC3D->TraceProbes>0, the block trace is instead estimated*/
+/* stochastically (Hutchinson's method) using TraceProbes      */
+/* random +-1 vectors of length N1, which requires an LU solve */
+/* with only TraceProbes right-hand sides. the same probe      */
+/* vectors are used at every frequency, so that the statistical*/
+/* error is a smooth function of Xi.                           */
 /***************************************************************/
-double GetTraceMInvdM(SC3Data *SC3D, char XYZT)
+int GetTraceMInvdM(SC3Data *SC3D, double *Traces)
 { 
   /***************************************************************/
   /* unpack fields from workspace structure **********************/
   /***************************************************************/
   RWGGeometry *G     = SC3D->G;
   HMatrix *M         = SC3D->M;
-  HMatrix *dM        = SC3D->dM;
   HMatrix **dUBlocks = SC3D->dUBlocks;
+  int N1             = SC3D->N1;
+  int K              = SC3D->TraceProbes;
 
-  int Mu=0;
-  switch(XYZT)
-   {  case 'X': Mu   = 0; break;
-      case 'Y': Mu   = 1; break;
-      case 'Z': Mu   = 2; break;
-      case '1': Mu   = 3; break; 
-      case '2': Mu   = 4; break; 
-      case '3': Mu   = 5; break; 
-   };
+  /***************************************************************/
+  /* get the first N1 columns of M^{-1}, or M^{-1} times the     */
+  /* probe vectors                                               */
+  /***************************************************************/
+  HMatrix *W;
+  double *Z=0;
+  if (K>0)
+   { 
+     if (SC3D->ProbeVectors==0)
+      { SC3D->ProbeVectors = new HMatrix(SC3D->N, K, M->RealComplex);
+        SC3D->ProbeSigns = (double *)mallocEC(N1*K*sizeof(double));
+      };
+     W=SC3D->ProbeVectors;
+     Z=SC3D->ProbeSigns;
+
+     unsigned int Seed=12345;
+     for(int n=0; n<N1*K; n++)
+      { Seed = 1103515245U*Seed + 12345U;
+        Z[n] = (Seed & 0x40000000U) ? 1.0 : -1.0;
+      };
 
-  if ( '1'<=XYZT && XYZT<='3' )
-   Log("  Computing torque about axis #%c...",XYZT);
+     Log("  Computing %i-probe trace estimates...",K);
+     W->Zero();
+     for(int k=0; k<K; k++)
+      for(int n=0; n<N1; n++)
+       W->SetEntry(n, k, Z[n + k*N1]);
+   }
   else
-   Log("  Computing %cForce...",XYZT);
+   { W=SC3D->dM;
+     Log("  Computing block traces...");
+     W->Zero();
+     for(int n=0; n<N1; n++)
+      W->SetEntry(n, n, 1.0);
+   };
+
+  M->LUSolve(W);
 
   /***************************************************************/
-  /* stamp derivative blocks into dM matrix, compute M^{-1} dM,  */
-  /* then sum the diagonals of the upper matrix block            */
+  /* contract with the derivative blocks for each quantity       */
   /***************************************************************/
-  dM->Zero();
-  for(int ns=1; ns<G->NumSurfaces; ns++)
-   dM->InsertBlockAdjoint(dUBlocks[ 6*(ns-1) + Mu ], G->BFIndexOffset[ns], 0);
-
-  M->LUSolve(dM);
+  int NumTraces=0;
+  for(int Mu=0; Mu<6; Mu++)
+   { 
+     if ( !(SC3D->WhichQuantities & (QUANTITY_XFORCE<<Mu)) )
+      continue;
+
+     double Trace=0.0;
+     for(int ns=1; ns<G->NumSurfaces; ns++)
+      { HMatrix *dU = dUBlocks[ 6*(ns-1) + Mu ];
+        int Offset  = G->BFIndexOffset[ns];
+        int NBF     = G->Surfaces[ns]->NumBFs;
+        if (K>0)
+         { for(int k=0; k<K; k++)
+            for(int nr=0; nr<N1; nr++)
+             { cdouble Sum=0.0;
+               for(int nc=0; nc<NBF; nc++)
+                Sum += dU->GetEntry(nr,nc) * W->GetEntry(Offset+nc,k);
+               Trace += Z[nr + k*N1] * real(Sum);
+             };
+         }
+        else
+         { for(int nr=0; nr<N1; nr++)
+            for(int nc=0; nc<NBF; nc++)
+             Trace += real( dU->GetEntry(nr,nc) * W->GetEntry(Offset+nc,nr) );
+         };
+      };
+     if (K>0)
+      Trace/=((double)K);
+     Trace*=2.0;
 
-  double Trace=0.0;
-  for(int n=0; n<dM->NC; n++)
-   Trace+=dM->GetEntryD(n,n);
-  Trace*=2.0;
+     // paraphrasing the physicists of the 1930s, 'just because
+     // something is infinite doesn't mean that it's zero.' and yet...
+     if (!IsFinite(Trace))
+      Trace=0.0;
 
-  // paraphrasing the physicists of the 1930s, 'just because
-  // something is infinite doesn't mean that it's zero.' and yet...
-  if (!IsFinite(Trace))
-   Trace=0.0;
+     Traces[NumTraces++] = -Trace/(2.0*M_PI);
+   };
 
-  return -Trace/(2.0*M_PI);
+  return NumTraces;
 } 
 
 
@@ -312,15 +376,29 @@ void GetCasimirIntegrand(SC3Data *SC3D, double Xi,
       };
    };
      
+  /***************************************************************/
+  /* if the T-matrix fast path is in use, compute the T-matrices */
+  /* of all bodies at this frequency                             */
+  /***************************************************************/
+  if (SC3D->TMatrixData)
+   GetTMatrices(SC3D, Omega);
+
   /***************************************************************/
   /* for each line in the TransFile, apply the specified         */
   /* transformation, then calculate all quantities requested.    */
+  /* if the T-matrix fast path is in use, the transformation at  */
+  /* which it is validated is processed first.                   */
   /***************************************************************/
-  FILE *ByXiKFile=0;
-  if (SC3D->ByXiKFileName)
-   ByXiKFile=fopen(SC3D->ByXiKFileName,"a");
-  for(int ntnq=0, nt=0; nt<SC3D->NumTransformations; nt++)
+  int ntValidate = GetTMatrixValidationTransform(SC3D);
+  bool UBlocksAssembled = false;
+  bool *TransformSkipped = new bool[SC3D->NumTransformations];
+  for(int n=0; n<SC3D->NumTransformations; n++)
    { 
+     int nt = n;
+     if ( ntValidate>0 && n<=ntValidate )
+      nt = (n==0) ? ntValidate : n-1;
+     int ntnq = nt*SC3D->NumQuantities;
+
      char *Tag=SC3D->GTCList[nt]->Tag;
 
      /******************************************************************/
@@ -335,18 +413,12 @@ void GetCasimirIntegrand(SC3Data *SC3D, double Xi,
       { Log("All quantities already converged at Tag %s",Tag);
 
         for(int nq=0; nq<SC3D->NumQuantities; nq++)
-         EFT[ntnq++]=0.0;
-
-        if (ByXiKFile)
-         { fprintf(ByXiKFile,"%s %.15e %e %e ",Tag,Xi,kBloch[0],kBloch[1]);
-           for(int nq=0; nq<SC3D->NumQuantities; nq++)
-            fprintf(ByXiKFile,"%.15e ",0.0);
-           fprintf(ByXiKFile,"\n");
-           fflush(ByXiKFile);
-         };
+         EFT[ntnq+nq]=0.0;
 
+        TransformSkipped[nt]=true;
         continue;
       };
+     TransformSkipped[nt]=false;
 
      /******************************************************************/
      /* apply the geometrical transform                                */
@@ -357,83 +429,103 @@ void GetCasimirIntegrand(SC3Data *SC3D, double Xi,
       if (G->SurfaceMoved[ns]) SurfaceNeverMoved[ns]=false;
 
      /***************************************************************/
-     /* assemble U_{a,b} blocks and dUdXYZT_{0,b} blocks            */
-     /***************************************************************/
-     for(int nb=0, ns=0; ns<G->NumSurfaces; ns++)
-      for(int nsp=ns+1; nsp<G->NumSurfaces; nsp++, nb++)
-       { 
-         /* if we already computed the interaction between objects ns  */
-         /* and nsp once at this frequency, and if neither object has  */
-         /* moved, then we do not need to recompute the interaction    */
-         if ( nt>0 && SurfaceNeverMoved[ns] && SurfaceNeverMoved[nsp] )
-          continue;
-
-         Log(" Assembling U(%i,%i)",ns,nsp);
-         void *Accelerator = PBC ? SC3D->UAccelerators[nt][nb] : 0;
-         if (ns==0)
-          G->AssembleBEMMatrixBlock(ns, nsp, Omega, kBloch,
-                                    SC3D->UBlocks[nb], SC3D->dUBlocks + 6*nb,
-                                    0, 0, Accelerator, false, 
-                                    SC3D->NumTorqueAxes, SC3D->dUBlocks + 6*nb + 3, SC3D->GammaMatrix);
-         else
-          G->AssembleBEMMatrixBlock(ns, nsp, Omega, kBloch, SC3D->UBlocks[nb], 0,
-                                    0, 0, Accelerator, false);
-
-       };
-
-     /***************************************************************/
-     /* factorize the M matrix and compute casimir quantities       */
+     /* for well-separated compact bodies we may be able to bypass  */
+     /* the BEM calculation entirely (see TMatrixCasimir.cc)        */
      /***************************************************************/
-     Factorize(SC3D);
-     if ( SC3D->WhichQuantities & QUANTITY_ENERGY )
-      EFT[ntnq++]=GetLNDetMInvMInf(SC3D);
-     if ( SC3D->WhichQuantities & QUANTITY_XFORCE )
-      EFT[ntnq++]=GetTraceMInvdM(SC3D,'X');
-     if ( SC3D->WhichQuantities & QUANTITY_YFORCE )
-      EFT[ntnq++]=GetTraceMInvdM(SC3D,'Y');
-     if ( SC3D->WhichQuantities & QUANTITY_ZFORCE )
-      EFT[ntnq++]=GetTraceMInvdM(SC3D,'Z');
-     if ( SC3D->WhichQuantities & QUANTITY_TORQUE1 )
-      EFT[ntnq++]=GetTraceMInvdM(SC3D,'1');
-     if ( SC3D->WhichQuantities & QUANTITY_TORQUE2 )
-      EFT[ntnq++]=GetTraceMInvdM(SC3D,'2');
-     if ( SC3D->WhichQuantities & QUANTITY_TORQUE3 )
-      EFT[ntnq++]=GetTraceMInvdM(SC3D,'3');
+     if ( !GetTMatrixEFT(SC3D, EFT+ntnq) )
+      {
+        /***************************************************************/
+        /* assemble U_{a,b} blocks and dUdXYZT_{0,b} blocks            */
+        /***************************************************************/
+        for(int nb=0, ns=0; ns<G->NumSurfaces; ns++)
+         for(int nsp=ns+1; nsp<G->NumSurfaces; nsp++, nb++)
+          { 
+            /* if we already computed the interaction between objects ns  */
+            /* and nsp once at this frequency, and if neither object has  */
+            /* moved, then we do not need to recompute the interaction    */
+            if ( UBlocksAssembled && SurfaceNeverMoved[ns] && SurfaceNeverMoved[nsp] )
+             continue;
+
+            Log(" Assembling U(%i,%i)",ns,nsp);
+            void *Accelerator = PBC ? SC3D->UAccelerators[nt][nb] : 0;
+            if (ns==0)
+             G->AssembleBEMMatrixBlock(ns, nsp, Omega, kBloch,
+                                       SC3D->UBlocks[nb], SC3D->dUBlocks + 6*nb,
+                                       0, 0, Accelerator, false, 
+                                       SC3D->NumTorqueAxes, SC3D->dUBlocks + 6*nb + 3, SC3D->GammaMatrix);
+            else
+             G->AssembleBEMMatrixBlock(ns, nsp, Omega, kBloch, SC3D->UBlocks[nb], 0,
+                                       0, 0, Accelerator, false);
+
+          };
+        UBlocksAssembled=true;
+
+        /***************************************************************/
+        /* factorize the M matrix and compute casimir quantities       */
+        /***************************************************************/
+        Factorize(SC3D);
+        int nq=ntnq;
+        if ( SC3D->WhichQuantities & QUANTITY_ENERGY )
+         EFT[nq++]=GetLNDetMInvMInf(SC3D);
+        if ( SC3D->WhichQuantities & ~QUANTITY_ENERGY )
+         GetTraceMInvdM(SC3D, EFT+nq);
+
+        /***************************************************************/
+        /* the first admissible BEM result at this frequency (normally */
+        /* at ntValidate) is used to validate the T-matrix fast path   */
+        /***************************************************************/
+        ValidateTMatrixEFT(SC3D, EFT + ntnq);
+      };
 
      /******************************************************************/
-     /* write results to .byXi file (for non-periodic geometries) or   */
-     /* to .byXiK file (for periodic geometries).                      */
-     /* Note that, for periodic geometries, data are also written to   */
-     /* the .byXi file, but this happens at one level higher up in the */
-     /* calling hierarchy, in the GetXiIntegrand() routine.            */
+     /* undo the geometrical transform                                 */
      /******************************************************************/
-     FILE *f=0;
+     G->UnTransform();
+
+   }; // for(n=0; n<SC3D->NumTransformations; n++)
+
+  /******************************************************************/
+  /* write results to .byXi file (for non-periodic geometries) or   */
+  /* to .byXiK file (for periodic geometries).                      */
+  /* Note that, for periodic geometries, data are also written to   */
+  /* the .byXi file, but this happens at one level higher up in the */
+  /* calling hierarchy, in the GetXiIntegrand() routine.            */
+  /* The lines for all transformations are written as one locked    */
+  /* block, so that concurrent frequency workers cannot interleave  */
+  /* them (CacheRead() expects them on consecutive lines).          */
+  /******************************************************************/
+  FILE *f = fopen( G->LDim==0 ? SC3D->ByXiFileName : SC3D->ByXiKFileName, "a");
+  LockOutputFile(f);
+  for(int ntnq=0, nt=0; nt<SC3D->NumTransformations; nt++, ntnq+=SC3D->NumQuantities)
+   { 
+     char *Tag=SC3D->GTCList[nt]->Tag;
+
+     if (TransformSkipped[nt])
+      { if (G->LDim>0)
+         { fprintf(f,"%s %.15e %e %e ",Tag,Xi,kBloch[0],kBloch[1]);
+           for(int nq=0; nq<SC3D->NumQuantities; nq++)
+            fprintf(f,"%.15e ",0.0);
+           fprintf(f,"\n");
+         };
+        continue;
+      };
+
      if (G->LDim==0)
-      { f = fopen(SC3D->ByXiFileName, "a");
-        fprintf(f,"%s %.6e ",Tag,Xi);
-      }
+      fprintf(f,"%s %.6e ",Tag,Xi);
      else if (G->LDim==1)
-      { f = fopen(SC3D->ByXiKFileName, "a");
-        fprintf(f,"%s %.6e %.6e ",Tag,Xi,kBloch[0]);
-      }
+      fprintf(f,"%s %.6e %.6e ",Tag,Xi,kBloch[0]);
      else if (G->LDim==2)
-      { f = fopen(SC3D->ByXiKFileName, "a");
-        fprintf(f,"%s %.6e %.6e %.6e ",Tag,Xi,kBloch[0],kBloch[1]);
-      }
+      fprintf(f,"%s %.6e %.6e %.6e ",Tag,Xi,kBloch[0],kBloch[1]);
      else
       ErrExit("%s:%i: internal error",__FILE__,__LINE__);
 
-     for(int nq=SC3D->NumQuantities; nq>0; nq--)
-      fprintf(f,"%.8e ",EFT[ntnq-nq]);
+     for(int nq=0; nq<SC3D->NumQuantities; nq++)
+      fprintf(f,"%.8e ",EFT[ntnq+nq]);
      fprintf(f,"\n");
-     fclose(f);
-
-     /******************************************************************/
-     /* undo the geometrical transform                                 */
-     /******************************************************************/
-     G->UnTransform();
-
-   }; // for(ntnq=nt=0; nt<SC3D->NumTransformations; nt++)
+   };
+  UnlockOutputFile(f);
+  fclose(f);
+  delete[] TransformSkipped;
 
   /***************************************************************/
   /***************************************************************/
@@ -172,6 +172,11 @@ SC3Data *CreateSC3Data(RWGGeometry *G, char *TransFile,
   SC3D->M           = new HMatrix(N,  N,  RealComplex);
   SC3D->dM          = new HMatrix(N,  N1, RealComplex);
   SC3D->NewEnergyMethod  = NewEnergyMethod;
+  SC3D->TraceProbes      = 0;
+  SC3D->ProbeVectors     = 0;
+  SC3D->ProbeSigns       = 0;
+  SC3D->TMatrixData      = 0;
+  SC3D->FrequencyWorkers = 0;
 
   if (WhichQuantities & QUANTITY_ENERGY)
    { SC3D->MInfLUDiagonal = new HVector(G->TotalBFs);
@@ -418,12 +418,14 @@ void GetBZIntegral(SC3Data *SC3D, double Xi, double *EFT)
   /* write data to .byXi file                                    */
   /***************************************************************/
   FILE *f=fopen(SC3D->ByXiFileName,"a");
+  LockOutputFile(f);
   for(int ntnq=0, nt=0; nt<SC3D->NumTransformations; nt++)
    { fprintf(f,"%s %.6e ",SC3D->GTCList[nt]->Tag,Xi);
      for(int nq=0; nq<SC3D->NumQuantities; nq++, ntnq++) 
       fprintf(f,"%.8e %.8e ",EFT[ntnq],Error[ntnq]);
      fprintf(f,"\n");
    };
+  UnlockOutputFile(f);
   fclose(f);
 
   delete[] Error;
@@ -449,28 +451,76 @@ void GetXiIntegrand(SC3Data *SC3D, double Xi, double *EFT)
 }
 
 /***************************************************************/
-/* wrapper with correct prototype for pcubature (over an       */
-/* infinite interval)                                          */
+/* wrappers with the prototype expected by the frequency       */
+/* workers (FrequencyWorkers.cc in libscuff); x = {Xi} or      */
+/* x = {Xi, kx, ky}.                                           */
 /***************************************************************/
-int GetXiIntegrand2(unsigned ndim, const double *x, void *params, 
-                    unsigned fdim, double *fval)
+void XiWorkerFunction(void *UserData, const double *x, double *EFT)
+{
+  SC3Data *SC3D = (SC3Data *)UserData;
+
+  // only the first worker writes the cache file
+  if (GetFrequencyWorkerIndex()>0) 
+   SC3D->WriteCache=0;
+
+  GetXiIntegrand(SC3D, x[0], EFT);
+}
+
+void XikBlochWorkerFunction(void *UserData, const double *x, double *EFT)
+{
+  SC3Data *SC3D = (SC3Data *)UserData;
+
+  if (GetFrequencyWorkerIndex()>0) 
+   SC3D->WriteCache=0;
+
+  double kBloch[2];
+  kBloch[0]=x[1];
+  kBloch[1]=x[2];
+  GetCasimirIntegrand(SC3D, x[0], kBloch, EFT);
+}
+
+/***************************************************************/
+/* evaluate the Xi integrand at NumXi frequencies, concurrently*/
+/* if frequency workers were created, and store the results   */
+/* for frequency #nx in EFT[nx*NTNQ ... (nx+1)*NTNQ-1].         */
+/***************************************************************/
+void GetXiIntegrands(SC3Data *SC3D, int NumXi, double *Xi, double *EFT)
+{
+  if (SC3D->FrequencyWorkers)
+   EvaluateFrequencyPoints(SC3D->FrequencyWorkers, NumXi, Xi, EFT);
+  else
+   for(int nx=0; nx<NumXi; nx++)
+    GetXiIntegrand(SC3D, Xi[nx], EFT + nx*SC3D->NTNQ);
+
+  if (SC3D->FrequencyWorkers) 
+   SC3D->WriteCache=0;
+}
+
+/***************************************************************/
+/* vectorized wrapper for pcubature_v (over an infinite        */
+/* interval)                                                   */
+/***************************************************************/
+int GetXiIntegrand2_v(unsigned ndim, size_t npt, const double *x,
+                      void *params, unsigned fdim, double *fval)
 {
   (void) ndim; // unused
-  (void) fdim; // unused
 
   SC3Data *SC3D = (SC3Data *)params;
 
-  double Xi = SC3D->XiMin + x[0]/(1.0-x[0]); 
-  double Jacobian = 1.0/( (1.0-x[0])*(1.0-x[0]) );
-  double *EFT = fval;
+  double *Xi = new double[npt];
+  for(size_t np=0; np<npt; np++)
+   Xi[np] = SC3D->XiMin + x[np]/(1.0-x[np]);
 
-  GetXiIntegrand(SC3D, Xi, EFT);
+  GetXiIntegrands(SC3D, npt, Xi, fval);
 
-  for(int ntnq=0; ntnq<SC3D->NTNQ; ntnq++)
-   EFT[ntnq]*=Jacobian;
+  for(size_t np=0; np<npt; np++)
+   { double Jacobian = 1.0/( (1.0-x[np])*(1.0-x[np]) );
+     for(unsigned nf=0; nf<fdim; nf++)
+      fval[np*fdim + nf]*=Jacobian;
+   };
 
+  delete[] Xi;
   return 0;
-
 }
 
 /***************************************************************/
@@ -498,57 +548,52 @@ int GetXiIntegrand3(unsigned ndim, const double *x, void *params,
 void GetXiIntegral_TrapSimp(SC3Data *SC3D, int NumIntervals, double *I, double *E)
 { 
   int fdim = SC3D->NTNQ;
-  double *fLeft  = new double[fdim];
-  double *fMid   = new double[fdim];
-  double *fRight = new double[fdim];
-  double Xi;
 
   /*--------------------------------------------------------------*/
-  /*- evaluate integrand at leftmost frequency point and estimate */
-  /*- the integral from 0 to XIMIN by assuming that the integrand */
-  /*- is constant in that range                                   */
+  /*- all quadrature points are known in advance, so we evaluate  */
+  /*- the integrand at all of them in a single batch (which runs  */
+  /*- concurrently if frequency workers are in use).              */
+  /*- point #0 is the leftmost frequency; points #2n+1, #2n+2 are */
+  /*- the midpoint and right end of the nth interval.             */
+  /*--------------------------------------------------------------*/
+  double Delta = (XIMAX - XIMIN ) / NumIntervals;
+  int NumPoints = 2*NumIntervals + 1;
+  double *Xi = new double[NumPoints];
+  for(int np=0; np<NumPoints; np++)
+   Xi[np] = SC3D->XiMin + 0.5*np*Delta;
+  double *f = new double[NumPoints*fdim];
+  GetXiIntegrands(SC3D, NumPoints, Xi, f);
+
+  /*--------------------------------------------------------------*/
+  /*- estimate the integral from 0 to XIMIN by assuming that the  */
+  /*- integrand is constant in that range                         */
   /*--------------------------------------------------------------*/
-  Xi=SC3D->XiMin;
-  GetXiIntegrand(SC3D, Xi, fLeft);
   for(int nf=0; nf<fdim; nf++)
-   I[nf] = fLeft[nf] * (SC3D->XiMin);
+   I[nf] = f[nf] * (SC3D->XiMin);
   memset(E,0,SC3D->NTNQ*sizeof(double));
 
   /*--------------------------------------------------------------*/
   /*--------------------------------------------------------------*/
   /*--------------------------------------------------------------*/
-  double Delta = (XIMAX - XIMIN ) / NumIntervals;
-  double *ISimp  = new double[fdim];
-  double *ITrap  = new double[fdim];
   for(int nIntervals=0; nIntervals<NumIntervals; nIntervals++)
    { 
-     // evaluate integrand at midpoint of interval 
-     Xi += 0.5*Delta;
-     GetXiIntegrand(SC3D, Xi, fMid);
-
-     // evaluate integrand at right end of interval 
-     Xi += 0.5*Delta;
-     GetXiIntegrand(SC3D, Xi, fRight);
+     double *fLeft  = f + (2*nIntervals+0)*fdim;
+     double *fMid   = f + (2*nIntervals+1)*fdim;
+     double *fRight = f + (2*nIntervals+2)*fdim;
 
      // compute the simpson's rule and trapezoidal rule
      // estimates of the integral over this interval  
      // and take their difference as the error
      for(int nf=0; nf<fdim; nf++)
-      { ISimp[nf] = (fLeft[nf] + 4.0*fMid[nf] + fRight[nf])*Delta/6.0;
-        ITrap[nf] = (fLeft[nf] + 2.0*fMid[nf] + fRight[nf])*Delta/4.0;
-        I[nf] += ISimp[nf];
-        E[nf] += fabs(ISimp[nf] - ITrap[nf]);
+      { double ISimp = (fLeft[nf] + 4.0*fMid[nf] + fRight[nf])*Delta/6.0;
+        double ITrap = (fLeft[nf] + 2.0*fMid[nf] + fRight[nf])*Delta/4.0;
+        I[nf] += ISimp;
+        E[nf] += fabs(ISimp - ITrap);
       };
-
-     // prepare for next iteration
-     memcpy(fLeft, fRight, fdim*sizeof(double));
-
    };
-  delete[] fLeft;
-  delete[] fMid;
-  delete[] fRight;
-  delete[] ISimp;
-  delete[] ITrap;
+
+  delete[] Xi;
+  delete[] f;
 
 }
 
@@ -561,9 +606,9 @@ void GetXiIntegral_Adaptive(SC3Data *SC3D, double *EFT, double *Error)
   double Lower[1] = {0.0}; 
   double Upper[1] = {1.0};
 
-  pcubature(SC3D->NTNQ, GetXiIntegrand2, (void *)SC3D, 1, Lower, Upper,
-            SC3D->MaxXiPoints, SC3D->AbsTol, SC3D->RelTol,
-            ERROR_INDIVIDUAL, EFT, Error);
+  pcubature_v(SC3D->NTNQ, GetXiIntegrand2_v, (void *)SC3D, 1, Lower, Upper,
+              SC3D->MaxXiPoints, SC3D->AbsTol, SC3D->RelTol,
+              ERROR_INDIVIDUAL, EFT, Error);
    
 }
 
@@ -634,9 +679,9 @@ void GetXiIntegral_Cliff(SC3Data *SC3D, double *I, double *E)
 void GetMatsubaraSum(SC3Data *SC3D, double Temperature, double *EFT, double *Error)
 { 
   int n, ntnq, NTNQ=SC3D->NTNQ;
-  double Xi, Weight;
+  double Weight;
 
-  double *dEFT = new double [NTNQ]; 
+  double *dEFT;
   double *LastEFT = new double[NTNQ]; 
   double RelDelta;
   int AllConverged=0;
@@ -650,25 +695,38 @@ void GetMatsubaraSum(SC3Data *SC3D, double Temperature, double *EFT, double *Err
 
   Log("Beginning Matsubara sum at T=%g kelvin...",Temperature);
 
+  /***************************************************************/
+  /* if frequency workers are in use, the matsubara frequencies  */
+  /* are evaluated in batches of one frequency per worker; the   */
+  /* convergence analysis below still proceeds one frequency at  */
+  /* a time, so the result does not depend on the batch size.    */
+  /***************************************************************/
+  int BatchSize = GetNumFrequencyWorkers(SC3D->FrequencyWorkers);
+  double *XiBatch  = new double[BatchSize];
+  double *EFTBatch = new double[BatchSize*NTNQ];
+
   for(n=0; n<SC3D->MaxXiPoints; n++)
    { 
      /***************************************************************/
-     /* compute the next matsubara frequency ************************/
+     /* evaluate the frequency integrand at the next batch of       */
+     /* matsubara frequencies                                       */
      /***************************************************************/
-     if (n==0)
-      { Weight=0.5;
-        // NOTE: we assume that the integrand is constant for Xi < XIMIN
-        Xi=XIMIN;
-      }
-     else
-      { Weight=1.0;
-        Xi=2.0*M_PI*kT*((double)n);
+     int nb = n % BatchSize;
+     if (nb==0)
+      { int NumXi = SC3D->MaxXiPoints - n;
+        if (NumXi > BatchSize) NumXi=BatchSize;
+        for(int nx=0; nx<NumXi; nx++)
+         { 
+           // NOTE: we assume that the integrand is constant for Xi < XIMIN
+           if (n+nx==0) 
+            XiBatch[nx]=XIMIN;
+           else
+            XiBatch[nx]=2.0*M_PI*kT*((double)(n+nx));
+         };
+        GetXiIntegrands(SC3D, NumXi, XiBatch, EFTBatch);
       };
-
-     /***************************************************************/
-     /* evaluate the frequency integrand at this matsubara frequency*/
-     /***************************************************************/
-     GetXiIntegrand(SC3D, Xi, dEFT);
+     dEFT   = EFTBatch + nb*NTNQ;
+     Weight = (n==0) ? 0.5 : 1.0;
 
      /***************************************************************/
      /* accumulate contributions to the sum.                        */
@@ -725,7 +783,8 @@ void GetMatsubaraSum(SC3Data *SC3D, double Temperature, double *EFT, double *Err
 
    }; /* for (n=0 ... */
 
-  delete[] dEFT;   
+  delete[] XiBatch;
+  delete[] EFTBatch;
   delete[] LastEFT;
   delete[] ConvergedIters;
   
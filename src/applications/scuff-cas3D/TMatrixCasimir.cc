@@ -0,0 +1,658 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * TMatrixCasimir.cc -- spherical-wave T-matrix evaluation of casimir
+ *                   -- energies and forces for well-separated compact
+ *                   -- bodies
+ *
+ * how it works:
+ *
+ *  (a) at each Xi, after the T blocks of the BEM matrix have been
+ *      assembled, we compute for each body a the matrix
+ *
+ *       TM_a = P_a * T_a^{-1} * R_a
+ *
+ *      where column q of R_a is the RHS vector on body a for a
+ *      regular spherical wave about the body center X_a, and P_a maps
+ *      surface currents on body a to the coefficients of the outgoing
+ *      spherical waves (about X_a) that they radiate. TM_a is thus the
+ *      spherical-wave T-matrix of body a in isolation, as computed by
+ *      scuff-tmatrix.
+ *
+ *  (b) the U blocks factor as U_ab = -R_a * W_ab * P_b, where W_ab
+ *      (computed from the libSpherical translation matrices) maps the
+ *      outgoing-wave coefficients about X_b to regular-wave
+ *      coefficients about X_a. by Sylvester's determinant identity,
+ *      det(M/MInfinity) is then the determinant of the small matrix
+ *      with unit diagonal blocks and off-diagonal blocks
+ *      -W_ab * TM_b, whose dimension is NumSurfaces*2*((lMax+1)^2-1)
+ *      regardless of the mesh size.
+ *
+ *  (c) forces on surface 0 are obtained by central finite differences
+ *      of this determinant with respect to the position of X_0 (step
+ *      TMC_DELTA times the body radius). there is no analytic
+ *      derivative of the translation matrices, and torques are not
+ *      available at all: if a torque is requested the fast path is
+ *      switched off (with a warning) and everything is computed by
+ *      the full BEM calculation.
+ *
+ *  (d) the expansion converges like Rho^lMax, where Rho is the ratio
+ *      of the sum of the body radii to the distance between the
+ *      body centers. transformations for which some pair of bodies
+ *      has Rho^lMax > TMC_TOLERANCE, or in which a body is rotated,
+ *      are handled by the full BEM calculation. lMax is chosen
+ *      automatically from the transformation list unless specified.
+ *
+ *  (e) at each Xi, the admissible transformation with the largest
+ *      Rho (which has the largest truncation error) is computed first,
+ *      and both ways; the fast path is only used for the remaining
+ *      transformations at that Xi if the two calculations agree to
+ *      within TMC_VALIDTOL. otherwise a warning is issued and all
+ *      transformations at that Xi are computed by the BEM.
+ *
+ * agent         -- 10/2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libIncField.h>
+#include <libSpherical.h>
+
+#include "scuff-cas3D.h"
+
+#define II cdouble(0.0,1.0)
+
+#define TMC_MAXLMAX    12     // largest lMax chosen automatically
+#define TMC_TOLERANCE  1.0e-4 // target truncation error
+#define TMC_VALIDTOL   1.0e-3 // agreement required with the BEM result
+#define TMC_MAXKR      100.0  // skip the fast path if |k|*radius exceeds this
+#define TMC_DELTA      1.0e-3 // finite-difference step (relative to body radius)
+
+#define TMC_UNVALIDATED 0
+#define TMC_VALIDATED   1
+#define TMC_FAILED      2
+
+/***************************************************************/
+/* data for the T-matrix fast path                             */
+/***************************************************************/
+typedef struct TMCData
+ {
+   int lMax, NA, NM;         // NA = (lMax+1)^2-1 ; NM = 2*NA
+   double RhoMax;            // largest admissible Rho
+   int ValidationTransform;  // admissible transformation with the largest Rho
+   int NumFastPath;          // number of transformations computed via T-matrices
+
+   double *X0;               // X0[3*ns + i] = untransformed center of surface #ns
+   double *Radius;           // Radius[ns] = radius of surface #ns about X0
+
+   HMatrix **TM;             // TM[ns] = spherical-wave T-matrix of surface #ns
+   cdouble K;                // wavenumber at which the TMs were computed
+   double Xi;                // imaginary frequency at which the TMs were computed
+   int Status;
+
+   HMatrix *MM;              // workspace for the NS*NM x NS*NM determinant
+   HMatrix *W, *WT;          // workspace for translation blocks
+   HMatrix *A, *B, *C;       // workspace for translation matrices
+
+ } TMCData;
+
+/***************************************************************/
+/* regular spherical wave about a given center, with E=M or    */
+/* E=N (compare the SphericalWave class in scuff-tmatrix)      */
+/***************************************************************/
+class RegularWave : public IncField
+ {
+ public:
+   double X0[3];
+   int Alpha, Type, lMax;
+   cdouble *MArray, *NArray;
+
+   RegularWave(int NewlMax)
+    { lMax=NewlMax;
+      int NAlpha=(lMax+1)*(lMax+1);
+      MArray = new cdouble[3*NAlpha];
+      NArray = new cdouble[3*NAlpha];
+    };
+   ~RegularWave()
+    { delete[] MArray;
+      delete[] NArray;
+    };
+
+   void GetFields(const double X[3], cdouble EH[6]);
+ };
+
+void RegularWave::GetFields(const double X[3], cdouble EH[6])
+{
+  cdouble K = sqrt(Eps*Mu) * Omega;
+  cdouble Z = ZVAC*sqrt(Mu/Eps);
+
+  double XmX0[3];
+  VecSub(X, X0, XmX0);
+  double r, Theta, Phi;
+  CoordinateC2S(XmX0, &r, &Theta, &Phi);
+  GetMNlmArray(lMax, K, r, Theta, Phi, LS_REGULAR, MArray, NArray);
+
+  cdouble *MVec = MArray + 3*Alpha, *NVec = NArray + 3*Alpha;
+  cdouble EHS[6];
+  for(int Mu=0; Mu<3; Mu++)
+   { EHS[Mu]   = (Type==0) ? MVec[Mu]     : NVec[Mu];
+     EHS[3+Mu] = (Type==0) ? -NVec[Mu]/Z  : MVec[Mu]/Z;
+   };
+
+  VectorS2C(Theta, Phi, EHS+0, EH+0);
+  VectorS2C(Theta, Phi, EHS+3, EH+3);
+}
+
+/***************************************************************/
+/* get the center and radius of each surface, and check that   */
+/* the geometry consists of compact bodies in a common exterior*/
+/* region                                                      */
+/***************************************************************/
+static bool GetBodyCenters(RWGGeometry *G, double *X0, double *Radius)
+{
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   { RWGSurface *S=G->Surfaces[ns];
+     if ( !(S->IsClosed) || S->RegionIndices[0]!=0 )
+      return false;
+     for(int nsp=0; nsp<G->NumSurfaces; nsp++)
+      if ( G->Surfaces[nsp]->RegionIndices[0]==S->RegionIndices[1] )
+       return false;
+
+     // center of the bounding box of the panel vertices
+     double XMin[3]={+1.0e89, +1.0e89, +1.0e89};
+     double XMax[3]={-1.0e89, -1.0e89, -1.0e89};
+     for(int np=0; np<S->NumPanels; np++)
+      for(int iv=0; iv<3; iv++)
+       for(int i=0; i<3; i++)
+        { double Xi=S->Vertices[ 3*(S->Panels[np]->VI[iv]) + i ];
+          XMin[i]=fmin(XMin[i], Xi);
+          XMax[i]=fmax(XMax[i], Xi);
+        };
+     double *X=X0+3*ns;
+     for(int i=0; i<3; i++)
+      X[i]=0.5*(XMin[i]+XMax[i]);
+
+     Radius[ns]=0.0;
+     for(int np=0; np<S->NumPanels; np++)
+      for(int iv=0; iv<3; iv++)
+       Radius[ns]=fmax(Radius[ns], VecDistance(X, S->Vertices + 3*(S->Panels[np]->VI[iv])));
+   };
+  return true;
+}
+
+/***************************************************************/
+/* get the current centers of all surfaces after the most      */
+/* recent call to G->Transform(); returns false if any surface */
+/* has been rotated.                                           */
+/***************************************************************/
+static bool GetTransformedCenters(RWGGeometry *G, TMCData *TMC, double *X)
+{
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   { GTransformation *GT=G->Surfaces[ns]->GT;
+     VecCopy(TMC->X0 + 3*ns, X + 3*ns);
+     if (GT==0) continue;
+     for(int Mu=0; Mu<3; Mu++)
+      { double E[3]={0.0, 0.0, 0.0};
+        E[Mu]=1.0;
+        GT->ApplyRotation(E);
+        if ( fabs(E[Mu]-1.0) > 1.0e-12 )
+         return false;
+      };
+     GT->Apply(X + 3*ns);
+   };
+  return true;
+}
+
+/***************************************************************/
+/* largest value of Rho over all pairs of bodies               */
+/***************************************************************/
+static double GetRho(RWGGeometry *G, TMCData *TMC, double *X)
+{
+  double Rho=0.0;
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   for(int nsp=ns+1; nsp<G->NumSurfaces; nsp++)
+    { double D = VecDistance(X+3*ns, X+3*nsp);
+      double R = TMC->Radius[ns] + TMC->Radius[nsp];
+      Rho = (D<=R) ? 1.0 : fmax(Rho, R/D);
+    };
+  return Rho;
+}
+
+/***************************************************************/
+/* set up the T-matrix fast path. returns 0 if it is not       */
+/* applicable to this geometry or to the requested quantities. */
+/* if lMax==0 it is chosen automatically.                      */
+/***************************************************************/
+void *CreateTMatrixData(SC3Data *SC3D, int lMax)
+{
+  RWGGeometry *G = SC3D->G;
+  int NS = G->NumSurfaces;
+
+  if ( G->LDim>0 || NS<2 )
+   { Warn("T-matrix fast path is only available for two or more compact bodies");
+     return 0;
+   };
+  if ( SC3D->WhichQuantities & (QUANTITY_TORQUE1 | QUANTITY_TORQUE2 | QUANTITY_TORQUE3) )
+   { Warn("T-matrix fast path is not available for torque calculations");
+     return 0;
+   };
+
+  TMCData *TMC=(TMCData *)mallocEC(sizeof(TMCData));
+  TMC->X0     = (double *)mallocEC(3*NS*sizeof(double));
+  TMC->Radius = (double *)mallocEC(NS*sizeof(double));
+  if ( !GetBodyCenters(G, TMC->X0, TMC->Radius) )
+   { Warn("T-matrix fast path requires non-nested closed bodies in the exterior medium");
+     free(TMC->X0);
+     free(TMC->Radius);
+     free(TMC);
+     return 0;
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- choose lMax from the largest Rho over all transformations   */
+  /*- that can be handled with lMax<=TMC_MAXLMAX (transformations*/
+  /*- that rotate a body are flagged with Rho=2)                  */
+  /*--------------------------------------------------------------*/
+  int NT = SC3D->NumTransformations;
+  double *Rho = new double[NT];
+  double *X = new double[3*NS];
+  for(int nt=0; nt<NT; nt++)
+   { G->Transform(SC3D->GTCList[nt]);
+     Rho[nt] = GetTransformedCenters(G, TMC, X) ? GetRho(G, TMC, X) : 2.0;
+     G->UnTransform();
+   };
+  delete[] X;
+
+  if (lMax==0)
+   { double RhoCap = pow(TMC_TOLERANCE, 1.0/TMC_MAXLMAX);
+     double RhoWorst = 0.0;
+     for(int nt=0; nt<NT; nt++)
+      if (Rho[nt]<=RhoCap)
+       RhoWorst=fmax(RhoWorst, Rho[nt]);
+     lMax = (RhoWorst==0.0) ? 1 : (int)ceil( log(TMC_TOLERANCE) / log(RhoWorst) );
+     if (lMax<1) lMax=1;
+     if (lMax>TMC_MAXLMAX) lMax=TMC_MAXLMAX;
+   };
+  TMC->lMax   = lMax;
+  TMC->RhoMax = pow(TMC_TOLERANCE, 1.0/lMax);
+  TMC->NA     = (lMax+1)*(lMax+1) - 1;
+  TMC->NM     = 2*TMC->NA;
+
+  /*--------------------------------------------------------------*/
+  /*- the fast path is validated at the admissible transformation -*/
+  /*- with the largest truncation error (see (e) above)           -*/
+  /*--------------------------------------------------------------*/
+  int NumAdmissible=0;
+  TMC->ValidationTransform=-1;
+  for(int nt=0; nt<NT; nt++)
+   if (Rho[nt]<=TMC->RhoMax)
+    { if ( NumAdmissible==0 || Rho[nt]>Rho[TMC->ValidationTransform] )
+       TMC->ValidationTransform=nt;
+      NumAdmissible++;
+    };
+  TMC->NumFastPath=0;
+  delete[] Rho;
+
+  Log("T-matrix fast path: lMax=%i, %i/%i transformations admissible",
+       lMax, NumAdmissible, SC3D->NumTransformations);
+  if (NumAdmissible==0)
+   Warn("no transformations are admissible for the T-matrix fast path");
+
+  int NAlpha = (lMax+1)*(lMax+1);
+  TMC->TM = (HMatrix **)mallocEC(NS*sizeof(HMatrix *));
+  for(int ns=0; ns<NS; ns++)
+   TMC->TM[ns] = new HMatrix(TMC->NM, TMC->NM, LHM_COMPLEX);
+  TMC->MM = new HMatrix(NS*TMC->NM, NS*TMC->NM, LHM_COMPLEX);
+  TMC->W  = new HMatrix(TMC->NM, TMC->NM, LHM_COMPLEX);
+  TMC->WT = new HMatrix(TMC->NM, TMC->NM, LHM_COMPLEX);
+  TMC->A  = new HMatrix(NAlpha, NAlpha, LHM_COMPLEX);
+  TMC->B  = new HMatrix(NAlpha, NAlpha, LHM_COMPLEX);
+  TMC->C  = new HMatrix(NAlpha, NAlpha, LHM_COMPLEX);
+  TMC->Status = TMC_FAILED;
+
+  return (void *)TMC;
+}
+
+/***************************************************************/
+/* compute the matrix P that maps the surface currents on      */
+/* surface #ns to the coefficients of the outgoing M and N     */
+/* waves about X0 that they radiate into the exterior region.  */
+/*                                                             */
+/* these are the projections of the currents onto the regular  */
+/* waves \tilde M_{lm} = (-1)^{m+1} M_{l,-m},                  */
+/*       \tilde N_{lm} = (-1)^{m}   N_{l,-m},                  */
+/* which at real frequencies are the complex conjugates used   */
+/* in GetSphericalMoments. at imaginary frequencies the        */
+/* conjugate is not the analytic continuation, so we take the  */
+/* unconjugated projections from GetMNProjections and reorder  */
+/* them here. the prefactors are those of the moments computed */
+/* by GetSphericalMoments and the field treecode.              */
+/***************************************************************/
+static void GetProjectionMatrix(RWGGeometry *G, int ns, cdouble Omega,
+                                cdouble K, int lMax, double *X0, HMatrix *P)
+{
+  RWGSurface *S = G->Surfaces[ns];
+  int NA        = (lMax+1)*(lMax+1) - 1;
+  int NAlpha    = NA+1;
+
+  cdouble iwu = II*Omega*G->MuTF[0];
+  cdouble ik  = II*K, k2 = K*K;
+
+  cdouble *MArray    = new cdouble[3*NAlpha];
+  cdouble *NArray    = new cdouble[3*NAlpha];
+  cdouble *MProj     = new cdouble[NAlpha];
+  cdouble *NProj     = new cdouble[NAlpha];
+  double *Workspace  = new double[4*(lMax+2)];
+
+  P->Zero();
+  for(int ne=0; ne<S->NumEdges; ne++)
+   {
+     GetMNProjections(S, ne, K, lMax, MArray, NArray, Workspace,
+                      MProj, NProj, X0, false);
+
+     for(int Alpha=1, l=1; l<=lMax; l++)
+      for(int m=-l; m<=l; m++, Alpha++)
+       { int AlphaBar = l*(l+1) - m;
+         double mSign = (m%2) ? 1.0 : -1.0;
+         cdouble MDot =  mSign*MProj[AlphaBar];
+         cdouble NDot = -mSign*NProj[AlphaBar];
+
+         int pM = Alpha-1, pN = NA + Alpha-1;
+         if (S->IsPEC)
+          { P->SetEntry(pM, ne, ZVAC*iwu*ik*MDot);
+            P->SetEntry(pN, ne, ZVAC*iwu*ik*NDot);
+          }
+         else
+          { P->SetEntry(pM, 2*ne+0,  ZVAC*iwu*ik*MDot);
+            P->SetEntry(pM, 2*ne+1, -ZVAC*k2*NDot);
+            P->SetEntry(pN, 2*ne+0,  ZVAC*iwu*ik*NDot);
+            P->SetEntry(pN, 2*ne+1,  ZVAC*k2*MDot);
+          };
+       };
+   };
+
+  delete[] MArray;
+  delete[] NArray;
+  delete[] MProj;
+  delete[] NProj;
+  delete[] Workspace;
+}
+
+/***************************************************************/
+/* compute the T-matrices of all bodies at the given frequency.*/
+/* this must be called with the geometry in its untransformed  */
+/* state, after the T blocks have been assembled.              */
+/***************************************************************/
+void GetTMatrices(SC3Data *SC3D, cdouble Omega)
+{
+  TMCData *TMC   = (TMCData *)SC3D->TMatrixData;
+  RWGGeometry *G = SC3D->G;
+  int NS = G->NumSurfaces;
+  int lMax=TMC->lMax, NA=TMC->NA, NM=TMC->NM;
+
+  G->UpdateCachedEpsMuValues(Omega);
+  TMC->K  = csqrt2(G->EpsTF[0]*G->MuTF[0])*Omega;
+  TMC->Xi = imag(Omega);
+
+  TMC->Status = TMC_UNVALIDATED;
+  if (TMC->ValidationTransform==-1)
+   TMC->Status = TMC_FAILED;
+  for(int ns=0; ns<NS; ns++)
+   if ( abs(TMC->K)*TMC->Radius[ns] > TMC_MAXKR )
+    TMC->Status = TMC_FAILED;
+  if (TMC->Status==TMC_FAILED)
+   { Log("T-matrix fast path skipped at Xi=%e (|k|R too large or no "
+         "admissible transformations)",imag(Omega));
+     return;
+   };
+
+  HVector *RHS = new HVector(G->TotalBFs, LHM_COMPLEX);
+  RegularWave RW(lMax);
+  HMatrix *TFactored=0;
+  int TFactoredIndex=-1;
+  for(int ns=0; ns<NS; ns++)
+   {
+     Log("Computing T-matrix of surface %i (lMax=%i)...",ns,lMax);
+     int NBF    = G->Surfaces[ns]->NumBFs;
+     int Offset = G->BFIndexOffset[ns];
+     double *X0 = TMC->X0 + 3*ns;
+
+     /*--------------------------------------------------------------*/
+     /*- factorize a complex copy of the T block (surfaces that are  */
+     /*- identical to the previous surface reuse its factorization)  */
+     /*--------------------------------------------------------------*/
+     int nsT = (G->Mate[ns]==-1) ? ns : G->Mate[ns];
+     if (nsT!=TFactoredIndex)
+      { if (TFactored) delete TFactored;
+        HMatrix *T=SC3D->TBlocks[nsT];
+        TFactored=new HMatrix(NBF, NBF, LHM_COMPLEX);
+        for(int nr=0; nr<NBF; nr++)
+         for(int nc=0; nc<NBF; nc++)
+          TFactored->SetEntry(nr, nc, T->GetEntry(nr,nc));
+        TFactored->LUFactorize();
+        TFactoredIndex=nsT;
+      };
+
+     /*--------------------------------------------------------------*/
+     /*- RHS vectors for regular spherical waves about X0            */
+     /*--------------------------------------------------------------*/
+     HMatrix *R=new HMatrix(NBF, NM, LHM_COMPLEX);
+     VecCopy(X0, RW.X0);
+     for(int Type=0; Type<2; Type++)
+      for(int Alpha=1; Alpha<=NA; Alpha++)
+       { RW.Type=Type;
+         RW.Alpha=Alpha;
+         G->AssembleRHSVector(Omega, &RW, RHS);
+         int nc = Type*NA + Alpha-1;
+         for(int nr=0; nr<NBF; nr++)
+          R->SetEntry(nr, nc, RHS->GetEntry(Offset+nr));
+       };
+     TFactored->LUSolve(R);
+
+     /*--------------------------------------------------------------*/
+     /*- project the induced currents onto outgoing waves            */
+     /*--------------------------------------------------------------*/
+     HMatrix *P=new HMatrix(NM, NBF, LHM_COMPLEX);
+     GetProjectionMatrix(G, ns, Omega, TMC->K, lMax, X0, P);
+     P->Multiply(R, TMC->TM[ns]);
+
+     delete P;
+     delete R;
+   };
+
+  if (TFactored) delete TFactored;
+  delete RHS;
+}
+
+/***************************************************************/
+/* compute the matrix W that maps the coefficients of outgoing */
+/* waves about Xb to the coefficients of regular waves about Xa*/
+/***************************************************************/
+static void GetWMatrix(TMCData *TMC, double *Xa, double *Xb, HMatrix *W)
+{
+  int NA=TMC->NA;
+  double Xij[3];
+  VecSub(Xb, Xa, Xij);
+  GetTranslationMatrices(Xij, TMC->K, TMC->lMax, TMC->A, TMC->B, TMC->C);
+
+  HMatrix *B=TMC->B, *C=TMC->C;
+  for(int Alpha=1; Alpha<=NA; Alpha++)
+   for(int AlphaP=1; AlphaP<=NA; AlphaP++)
+    { cdouble BB = B->GetEntry(Alpha, AlphaP);
+      cdouble CC = C->GetEntry(Alpha, AlphaP);
+      int p=AlphaP-1, q=Alpha-1;
+      W->SetEntry(p,    q,     BB);
+      W->SetEntry(p,    NA+q, -CC);
+      W->SetEntry(NA+p, q,     CC);
+      W->SetEntry(NA+p, NA+q,  BB);
+    };
+}
+
+/***************************************************************/
+/* log |det(M/MInfinity)| for the given body centers           */
+/***************************************************************/
+static double GetLogDet(RWGGeometry *G, TMCData *TMC, double *X)
+{
+  int NS=G->NumSurfaces, NM=TMC->NM;
+  HMatrix *MM=TMC->MM;
+
+  MM->Zero();
+  for(int n=0; n<NS*NM; n++)
+   MM->SetEntry(n, n, 1.0);
+  for(int nsa=0; nsa<NS; nsa++)
+   for(int nsb=0; nsb<NS; nsb++)
+    { if (nsa==nsb) continue;
+      GetWMatrix(TMC, X+3*nsa, X+3*nsb, TMC->W);
+      TMC->W->Multiply(TMC->TM[nsb], TMC->WT);
+      for(int nr=0; nr<NM; nr++)
+       for(int nc=0; nc<NM; nc++)
+        MM->SetEntry(nsa*NM+nr, nsb*NM+nc, -TMC->WT->GetEntry(nr,nc));
+    };
+
+  MM->LUFactorize();
+  double LogDet=0.0;
+  for(int n=0; n<NS*NM; n++)
+   LogDet+=log( abs(MM->GetEntry(n,n)) );
+  return LogDet;
+}
+
+/***************************************************************/
+/* compute the energy and force integrands for the current     */
+/* transformation. returns false if the transformation is not  */
+/* admissible.                                                 */
+/***************************************************************/
+static bool ComputeTMatrixEFT(SC3Data *SC3D, double *EFT)
+{
+  TMCData *TMC   = (TMCData *)SC3D->TMatrixData;
+  RWGGeometry *G = SC3D->G;
+
+  double *X = new double[3*G->NumSurfaces];
+  if ( !GetTransformedCenters(G, TMC, X) || GetRho(G, TMC, X)>TMC->RhoMax )
+   { delete[] X;
+     return false;
+   };
+
+  int nq=0;
+  if ( SC3D->WhichQuantities & QUANTITY_ENERGY )
+   EFT[nq++] = GetLogDet(G, TMC, X) / (2.0*M_PI);
+
+  double Delta = TMC_DELTA*TMC->Radius[0];
+  for(int Mu=0; Mu<3; Mu++)
+   { if ( !(SC3D->WhichQuantities & (QUANTITY_XFORCE<<Mu)) )
+      continue;
+     double X0Mu=X[Mu];
+     X[Mu] = X0Mu + Delta;
+     double LDP=GetLogDet(G, TMC, X);
+     X[Mu] = X0Mu - Delta;
+     double LDM=GetLogDet(G, TMC, X);
+     X[Mu] = X0Mu;
+     EFT[nq++] = -(LDP-LDM) / (2.0*Delta*2.0*M_PI);
+   };
+
+  delete[] X;
+  return true;
+}
+
+/***************************************************************/
+/* attempt to compute the casimir quantities at the current    */
+/* transformation via the T-matrix fast path. returns false if */
+/* the fast path is not (yet) usable, in which case the caller */
+/* must do the full BEM calculation and then pass its results  */
+/* to ValidateTMatrixEFT.                                      */
+/***************************************************************/
+bool GetTMatrixEFT(SC3Data *SC3D, double *EFT)
+{
+  TMCData *TMC = (TMCData *)SC3D->TMatrixData;
+  if ( TMC==0 || TMC->Status!=TMC_VALIDATED )
+   return false;
+
+  if ( !ComputeTMatrixEFT(SC3D, EFT) )
+   return false;
+
+  TMC->NumFastPath++;
+  Log(" (computed via T-matrix fast path)");
+  return true;
+}
+
+/***************************************************************/
+/* compare the fast-path results at the current transformation */
+/* with the full BEM results; if they agree, the fast path is  */
+/* enabled for the remaining transformations at this frequency.*/
+/* the force components are compared relative to the largest  */
+/* force component, so that components that vanish by symmetry */
+/* do not spoil the comparison.                                */
+/***************************************************************/
+void ValidateTMatrixEFT(SC3Data *SC3D, double *BEMEFT)
+{
+  TMCData *TMC = (TMCData *)SC3D->TMatrixData;
+  if ( TMC==0 || TMC->Status!=TMC_UNVALIDATED )
+   return;
+
+  double *EFT = new double[SC3D->NumQuantities];
+  if ( ComputeTMatrixEFT(SC3D, EFT) )
+   {
+     int nqForce = (SC3D->WhichQuantities & QUANTITY_ENERGY) ? 1 : 0;
+     double ForceScale=0.0;
+     for(int nq=nqForce; nq<SC3D->NumQuantities; nq++)
+      ForceScale=fmax(ForceScale, fabs(BEMEFT[nq]));
+
+     double MaxRelErr=0.0;
+     for(int nq=0; nq<SC3D->NumQuantities; nq++)
+      { double Err = fabs(EFT[nq]-BEMEFT[nq]);
+        double Scale = (nq<nqForce) ? fabs(BEMEFT[nq]) : ForceScale;
+        MaxRelErr = fmax(MaxRelErr, (Scale==0.0) ? Err : Err/Scale);
+      };
+     if (MaxRelErr<=TMC_VALIDTOL)
+      { TMC->Status=TMC_VALIDATED;
+        Log("T-matrix fast path enabled at Xi=%e (relative deviation %e)",
+             TMC->Xi, MaxRelErr);
+      }
+     else
+      { TMC->Status=TMC_FAILED;
+        Warn("T-matrix fast path disagrees with BEM at Xi=%e "
+             "(relative deviation %e > %e); using BEM at this Xi",
+              TMC->Xi, MaxRelErr, TMC_VALIDTOL);
+      };
+   };
+  delete[] EFT;
+}
+
+/***************************************************************/
+/* index of the transformation at which the fast path should   */
+/* be validated, which the caller should therefore compute     */
+/* first; -1 if there is none.                                 */
+/***************************************************************/
+int GetTMatrixValidationTransform(SC3Data *SC3D)
+{
+  TMCData *TMC = (TMCData *)SC3D->TMatrixData;
+  return TMC ? TMC->ValidationTransform : -1;
+}
+
+/***************************************************************/
+/* number of transformations (summed over all frequencies)     */
+/* that have been computed via the fast path so far            */
+/***************************************************************/
+int GetTMatrixFastPathCount(SC3Data *SC3D)
+{
+  TMCData *TMC = (TMCData *)SC3D->TMatrixData;
+  return TMC ? TMC->NumFastPath : 0;
+}
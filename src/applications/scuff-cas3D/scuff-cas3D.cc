@@ -89,11 +89,16 @@ int main(int argc, char *argv[])
   char *Cache=0;
   char *ReadCache[MAXCACHE];                int nReadCache;
   char *WriteCache=0;
+  char *SnapshotDir=0;
   //
   // other miscellaneous flags
   //
   bool UseExistingData=false;
   bool NewEnergyMethod = false;
+  int TraceProbes=0;
+  bool TMatrix=false;
+  int TMatrixLMax=0;
+  int FrequencyWorkers=0;
 //
   /* name               type    #args  max_instances  storage           count         description*/
   OptStruct OSArray[]=
@@ -127,14 +132,21 @@ int main(int argc, char *argv[])
      {"Cache",          PA_STRING,  1, 1,       (void *)&Cache,         0,             "read/write cache"},
      {"ReadCache",      PA_STRING,  1, MAXCACHE,(void *)ReadCache,      &nReadCache,   "read cache"},
      {"WriteCache",     PA_STRING,  1, 1,       (void *)&WriteCache,    0,             "write cache"},
+     {"SnapshotDir",    PA_STRING,  1, 1,       (void *)&SnapshotDir,   0,             "directory for cached geometry snapshots"},
 //
      {"UseExistingData", PA_BOOL,   0, 1,       (void *)&UseExistingData, 0,           "reuse data from existing .byXi files"},
 //
      {"NewEnergyMethod", PA_BOOL,   0, 1,       (void *)&NewEnergyMethod, 0,           "use alternative method for energy calculation"},
+     {"TraceProbes",     PA_INT,    1, 1,       (void *)&TraceProbes,   0,             "estimate force/torque traces using this many random probe vectors"},
+     {"TMatrix",         PA_BOOL,   0, 1,       (void *)&TMatrix,       0,             "use T-matrices for well-separated compact bodies (energy and force only)"},
+     {"TMatrixLMax",     PA_INT,    1, 1,       (void *)&TMatrixLMax,   0,             "maximum l-value for --TMatrix (default: automatic)"},
+     {"FrequencyWorkers",PA_INT,    1, 1,       (void *)&FrequencyWorkers, 0,          "number of worker processes evaluating frequency points concurrently"},
 //
      {0,0,0,0,0,0,0}
    };
   ProcessOptions(argc, argv, OSArray);
+  if (SnapshotDir)
+   RWGGeometry::SetSnapshotDir(SnapshotDir);
 
   if (FileBase)
    SetLogFileName("%s.log",FileBase);
@@ -147,6 +159,22 @@ int main(int argc, char *argv[])
   /***************************************************************/
   if (GeoFile==0)
    OSUsage(argv[0], OSArray, "--geometry option is mandatory");
+
+  /***************************************************************/
+  /* frequency workers are forked later, so geometry setup must  */
+  /* not start the OpenMP thread pool (see FrequencyWorkers.cc   */
+  /* in libscuff).                                               */
+  /***************************************************************/
+  if (FrequencyWorkers>1)
+   { bool CliffOnly = !XiKFile && !XiFile && nXiVals==0 && Temperature==0.0
+                      && ( !XiQuadrature || !strcasecmp(XiQuadrature,"CLIFF") );
+     if (CliffOnly)
+      { Warn("--FrequencyWorkers is not supported for cliff quadrature (ignoring)");
+        FrequencyWorkers=1;
+      };
+   };
+  ReserveFrequencyWorkers(FrequencyWorkers);
+
   RWGGeometry *G = new RWGGeometry(GeoFile);
   //G->SetLogLevel(SCUFF_TERSELOGGING);
   G->SetLogLevel(SCUFF_VERBOSELOGGING);
@@ -289,6 +317,23 @@ int main(int argc, char *argv[])
   SC3D->BZQMethod          = BZQMethod;
   SC3D->BZSymmetry         = BZSymmetry;
   SC3D->XiMin              = XiMin;
+  SC3D->TraceProbes        = TraceProbes;
+  if (TMatrix)
+   SC3D->TMatrixData = CreateTMatrixData(SC3D, TMatrixLMax);
+
+  /*******************************************************************/
+  /* fork worker processes for concurrent evaluation of frequency    */
+  /* points. (setup above ran single-threaded for this purpose; this */
+  /* restores the full thread count in the parent.)                  */
+  /*******************************************************************/
+  if (FrequencyWorkers>1)
+   { if (XiKPoints)
+      SC3D->FrequencyWorkers=CreateFrequencyWorkers(XikBlochWorkerFunction, (void *)SC3D,
+                                                    3, SC3D->NTNQ, FrequencyWorkers);
+     else
+      SC3D->FrequencyWorkers=CreateFrequencyWorkers(XiWorkerFunction, (void *)SC3D,
+                                                    1, SC3D->NTNQ, FrequencyWorkers);
+   };
 
   /*******************************************************************/
   /* now switch off based on the requested frequency behavior to     */
@@ -296,7 +341,19 @@ int main(int argc, char *argv[])
   /*******************************************************************/
   double *EFT = new double[SC3D->NTNQ];
   double *Error=0; 
-  if ( XiKPoints )
+  if ( XiKPoints && SC3D->FrequencyWorkers )
+   { 
+     int NR=XiKPoints->NR;
+     double *XiK  = new double[3*NR];
+     double *EFTs = new double[NR*SC3D->NTNQ];
+     for(int nr=0; nr<NR; nr++)
+      for(int nc=0; nc<3; nc++)
+       XiK[3*nr + nc] = XiKPoints->GetEntryD(nr, nc);
+     EvaluateFrequencyPoints(SC3D->FrequencyWorkers, NR, XiK, EFTs);
+     delete[] XiK;
+     delete[] EFTs;
+   }
+  else if ( XiKPoints )
    { 
      double Xi, kBloch[2];
      for(int nr=0; nr<XiKPoints->NR; nr++)
@@ -309,8 +366,14 @@ int main(int argc, char *argv[])
    }
   else if ( XiPoints )
    { 
-     for (int nr=0; nr<XiPoints->NR; nr++)
-      GetXiIntegrand(SC3D, XiPoints->GetEntryD(nr,0), EFT);
+     int NR=XiPoints->NR;
+     double *Xi   = new double[NR];
+     double *EFTs = new double[NR*SC3D->NTNQ];
+     for (int nr=0; nr<NR; nr++)
+      Xi[nr] = XiPoints->GetEntryD(nr,0);
+     GetXiIntegrands(SC3D, NR, Xi, EFTs);
+     delete[] Xi;
+     delete[] EFTs;
    }
   else if ( Temperature > 0.0)
    { 
@@ -328,6 +391,8 @@ int main(int argc, char *argv[])
       GetXiIntegral_Cliff(SC3D, EFT, Error);
    };
 
+  DestroyFrequencyWorkers(SC3D->FrequencyWorkers);
+
   /***************************************************************/
   /* write output file if we computed summed or integrated quantities */
   /***************************************************************/
@@ -107,6 +107,21 @@ typedef struct SC3Data
    int MaxXiPoints, MaxkBlochPoints;
    double AbsTol, RelTol;
 
+   // stochastic estimation of force/torque traces:
+   // TraceProbes = number of Hutchinson probe vectors
+   // (0 = compute the block traces exactly)
+   int TraceProbes;
+   HMatrix *ProbeVectors;
+   double *ProbeSigns;
+
+   // data for the spherical-wave T-matrix fast path
+   // (TMatrixCasimir.cc), or NULL if it is not in use
+   void *TMatrixData;
+
+   // worker processes for concurrent evaluation of frequency
+   // points (FrequencyWorkers.cc in libscuff), or NULL
+   void *FrequencyWorkers;
+
    // 20130427 alternative energy calculation
    bool NewEnergyMethod;
    HMatrix *MM1MInf;
@@ -152,4 +167,17 @@ void GetXiIntegral_Cliff(SC3Data *SC3D, double *EFT, double *Error);
 void GetMatsubaraSum(SC3Data *SC3D, double Temperature, double *EFT, double *Error);
 bool CacheRead(SC3Data *SC3D, double Xi, double *kBloch, double *EFT);
 
+// concurrent evaluation of frequency points
+void XiWorkerFunction(void *UserData, const double *x, double *EFT);
+void XikBlochWorkerFunction(void *UserData, const double *x, double *EFT);
+void GetXiIntegrands(SC3Data *SC3D, int NumXi, double *Xi, double *EFT);
+
+// T-matrix fast path for separation sweeps of compact bodies
+void *CreateTMatrixData(SC3Data *SC3D, int lMax);
+void GetTMatrices(SC3Data *SC3D, cdouble Omega);
+bool GetTMatrixEFT(SC3Data *SC3D, double *EFT);
+void ValidateTMatrixEFT(SC3Data *SC3D, double *BEMEFT);
+int GetTMatrixValidationTransform(SC3Data *SC3D);
+int GetTMatrixFastPathCount(SC3Data *SC3D);
+
 #endif // #define SCUFFCAS3D_H
@@ -113,7 +113,6 @@ void GetCPIntegrand(SCPData *SCPD, double Xi, double *U)
 {
   RWGGeometry *G       = SCPD->G;
   HMatrix *M           = SCPD->M;
-  HVector *KN          = SCPD->KN;
   int NumAtoms         = SCPD->NumAtoms;
   PolModel **PolModels = SCPD->PolModels;
   HMatrix **Alphas     = SCPD->Alphas;   
@@ -141,12 +140,25 @@ void GetCPIntegrand(SCPData *SCPD, double Xi, double *U)
   for(int na=0; na<NumAtoms; na++)
    PolModels[na]->GetPolarizability(Xi, Alphas[na]);
 
+  /***************************************************************/ 
+  /* get the dyadic GFs at all evaluation points at once: this   */ 
+  /* is a single multi-column solve with the LU-factorized BEM   */
+  /* matrix, followed by dot products (no field evaluations).    */
+  /* the CP potential only involves the electric DGF, so we skip */
+  /* the magnetic-dipole columns.                                */
+  /***************************************************************/ 
+  if (G)
+   { Log("Computing DGFs at %i eval points...",EPMatrix->NR);
+     SCPD->GMatrix=G->GetDyadicGFs(EPMatrix, cdouble(0,Xi), M,
+                                   SCPD->GMatrix, true);
+   };
+
   /***************************************************************/ 
   /* loop over all evaluation points to get the contribution of  */ 
   /* this frequency to the CP potential at each point            */
   /***************************************************************/ 
   double R[3];
-  cdouble GE[3][3], GM[3][3];
+  cdouble GE[3][3];
   FILE *f=fopen(ByXiFileName,"a");
   Log("Computing CP potential at %i eval points...",EPMatrix->NR);
   for(int nep=0; nep<EPMatrix->NR; nep++)
@@ -157,7 +169,10 @@ void GetCPIntegrand(SCPData *SCPD, double Xi, double *U)
       R[2]=EPMatrix->GetEntryD(nep, 2);
 
       if (G) 
-       G->GetDyadicGFs(R, cdouble(0,Xi), M, KN, GE, GM);
+       { for(int i=0; i<3; i++)
+          for(int j=0; j<3; j++)
+           GE[i][j]=SCPD->GMatrix->GetEntry(nep, 3*i+j);
+       }
       else
        GetPECPlateDGF(R[2], Xi, GE);
 
@@ -204,14 +204,13 @@ int main(int argc, char *argv[])
   if (GeoFile)
    { SCPD->G  = new RWGGeometry(GeoFile, SCUFF_TERSELOGGING);
      SCPD->M  = SCPD->G->AllocateBEMMatrix(SCUFF_PUREIMAGFREQ);
-     SCPD->KN = SCPD->G->AllocateRHSVector(SCUFF_PUREIMAGFREQ);
    }
   else
    { SCPD->G  = 0; // in this case we take the 
      SCPD->M  = 0; // geometry to be a PEC plate in the xy plane
-     SCPD->KN = 0;
      GeoFile = strdup("PECPlate");
    };
+  SCPD->GMatrix = 0;
   SCPD->RelTol = RelTol;
 
   /*******************************************************************/
@@ -96,7 +96,10 @@ typedef struct SCPData
  {
    RWGGeometry *G;
    HMatrix *M;
-   HVector *KN;
+
+   // GMatrix[nep, 3*i+j] = GE[i][j] at evaluation point #nep
+   // (see the batched GetDyadicGFs in libscuff)
+   HMatrix *GMatrix;
 
    int NumAtoms;
    PolModel **PolModels;
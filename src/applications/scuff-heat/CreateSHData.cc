@@ -64,6 +64,7 @@ SHData *CreateSHData(char *GeoFile, char *TransFile, int PlotFlux,
    SHD->nThread=GetNumThreads();
 
   SHD->WriteCache=0;
+  SHD->FrequencyWorkers=0;
 
   /*--------------------------------------------------------------*/
   /*--------------------------------------------------------------*/
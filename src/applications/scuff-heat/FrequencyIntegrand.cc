@@ -369,7 +369,9 @@ void GetFrequencyIntegrand(SHData *SHD, cdouble Omega, double *FI)
         /* write the result to the frequency-resolved output file ******/
         /***************************************************************/
         FILE *f=fopen(SHD->ByOmegaFile, "a");
+        LockOutputFile(f);
         fprintf(f,"%s %s %e\n",Tag,z2s(Omega),FI[nt]);
+        UnlockOutputFile(f);
         fclose(f);
       };
 
@@ -392,3 +394,37 @@ void GetFrequencyIntegrand(SHData *SHD, cdouble Omega, double *FI)
    };
 
 }
+
+/***************************************************************/
+/* entry point for frequency worker processes: x = {re, im} of */
+/* the frequency. only the first worker writes the cache.      */
+/***************************************************************/
+void OmegaWorkerFunction(void *UserData, const double *x, double *FI)
+{
+  SHData *SHD = (SHData *)UserData;
+  if ( GetFrequencyWorkerIndex() > 0 )
+   SHD->WriteCache=0;
+  GetFrequencyIntegrand(SHD, cdouble(x[0], x[1]), FI);
+}
+
+/***************************************************************/
+/* evaluate the frequency integrand at NumOmega frequencies,   */
+/* concurrently if frequency workers were created; the values  */
+/* for frequency #no go into FI[no*NumTransformations ...].    */
+/***************************************************************/
+void GetFrequencyIntegrands(SHData *SHD, int NumOmega, cdouble *Omega, double *FI)
+{
+  if (SHD->FrequencyWorkers)
+   { double *x = new double[2*NumOmega];
+     for(int no=0; no<NumOmega; no++)
+      { x[2*no+0] = real(Omega[no]);
+        x[2*no+1] = imag(Omega[no]);
+      };
+     EvaluateFrequencyPoints(SHD->FrequencyWorkers, NumOmega, x, FI);
+     delete[] x;
+     SHD->WriteCache=0;
+   }
+  else
+   for(int no=0; no<NumOmega; no++)
+    GetFrequencyIntegrand(SHD, Omega[no], FI + no*SHD->NumTransformations);
+}
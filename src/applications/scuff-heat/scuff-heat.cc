@@ -146,6 +146,10 @@
  * 
  *     --nThread xx   (use xx computational threads)
  *
+ *     --FrequencyWorkers xx   (evaluate xx frequencies at a time
+ *                              in separate worker processes, each
+ *                              using nThread/xx threads)
+ *
  */
 #include <stdio.h>
 #include <stdlib.h>
@@ -185,8 +189,10 @@ int main(int argc, char *argv[])
   char *Cache=0;
   char *ReadCache[MAXCACHE];         int nReadCache;
   char *WriteCache=0;
+  char *SnapshotDir=0;
   double SWPPITol=0.0;
   int nThread=0;
+  int FrequencyWorkers=0;
   /* name               type    #args  max_instances  storage           count         description*/
   OptStruct OSArray[]=
    { {"Geometry",       PA_STRING,  1, 1,       (void *)&GeoFile,    0,             "geometry file"},
@@ -202,10 +208,14 @@ int main(int argc, char *argv[])
      {"Cache",          PA_STRING,  1, 1,       (void *)&Cache,      0,             "read/write cache"},
      {"ReadCache",      PA_STRING,  1, MAXCACHE,(void *)ReadCache,   &nReadCache,   "read cache"},
      {"WriteCache",     PA_STRING,  1, 1,       (void *)&WriteCache, 0,             "write cache"},
+     {"SnapshotDir",    PA_STRING,  1, 1,       (void *)&SnapshotDir, 0,             "directory for cached geometry snapshots"},
      {"nThread",        PA_INT,     1, 1,       (void *)&nThread,    0,             "number of CPU threads to use"},
+     {"FrequencyWorkers",PA_INT,    1, 1,       (void *)&FrequencyWorkers, 0,       "number of worker processes evaluating frequencies concurrently"},
      {0,0,0,0,0,0,0}
    };
   ProcessOptions(argc, argv, OSArray);
+  if (SnapshotDir)
+   RWGGeometry::SetSnapshotDir(SnapshotDir);
 
   if (GeoFile==0)
    OSUsage(argv[0], OSArray, "--geometry option is mandatory");
@@ -278,6 +288,15 @@ int main(int argc, char *argv[])
       Log("Integrating over range Omega=(%g,%g).",real(OmegaMin),real(OmegaMax));
    };
 
+  /*******************************************************************/
+  /* frequency workers are forked below, so geometry setup must not  */
+  /* start the OpenMP thread pool (see FrequencyWorkers.cc in        */
+  /* libscuff)                                                       */
+  /*******************************************************************/
+  if (NumFreqs<=1)
+   FrequencyWorkers=0;
+  ReserveFrequencyWorkers(FrequencyWorkers);
+
   /*******************************************************************/
   /* create the SHData structure that contains all the info needed   */
   /* to evaluate the heat transfer at a single frequency             */
@@ -296,20 +315,34 @@ int main(int argc, char *argv[])
   if (Cache) WriteCache=Cache;
   SHD->WriteCache = WriteCache;
 
+  /*******************************************************************/
+  /* fork worker processes for concurrent evaluation of frequencies  */
+  /* (setup above ran single-threaded for this purpose; this         */
+  /* restores the full thread count in the parent)                   */
+  /*******************************************************************/
+  if (FrequencyWorkers>1)
+   SHD->FrequencyWorkers=CreateFrequencyWorkers(OmegaWorkerFunction, (void *)SHD, 2,
+                                                SHD->NumTransformations,
+                                                FrequencyWorkers);
+
   /*******************************************************************/
   /* now switch off based on the requested frequency behavior to     */
   /* perform the actual calculations                                 */
   /*******************************************************************/
-  double *I = new double[SHD->NumTransformations];
   if (NumFreqs>0)
-   { for (nFreq=0; nFreq<NumFreqs; nFreq++)
-      GetFrequencyIntegrand(SHD, OmegaList->GetEntry(nFreq), I);
+   { cdouble *Omega = new cdouble[NumFreqs];
+     double *I = new double[NumFreqs*SHD->NumTransformations];
+     for (nFreq=0; nFreq<NumFreqs; nFreq++)
+      Omega[nFreq] = OmegaList->GetEntry(nFreq);
+     GetFrequencyIntegrands(SHD, NumFreqs, Omega, I);
+     delete[] Omega;
+     delete[] I;
    }
   else
    { // frequency integration not yet implemented 
      ErrExit("frequency integration is not yet implemented");
    };
-  delete[] I;
+  DestroyFrequencyWorkers(SHD->FrequencyWorkers);
 
   /***************************************************************/
   /***************************************************************/
@@ -55,6 +55,10 @@ typedef struct SHData
    GTComplex **GTCList;
    int NumTransformations;
 
+   // worker processes for concurrent evaluation of frequency
+   // points (FrequencyWorkers.cc in libscuff), or NULL
+   void *FrequencyWorkers;
+
    char *WriteCache;
    int nThread;
 
@@ -64,5 +68,7 @@ SHData *CreateSHData(char *GeoFile, char *TransFile, int PlotFlux,
                      char *ByOmegaFile, int nThread);
 
 void GetFrequencyIntegrand(SHData *SHD, cdouble Omega, double *FI);
+void OmegaWorkerFunction(void *UserData, const double *x, double *FI);
+void GetFrequencyIntegrands(SHData *SHD, int NumOmega, cdouble *Omega, double *FI);
 
 #endif
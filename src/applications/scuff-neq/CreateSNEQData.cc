@@ -40,6 +40,7 @@ SNEQData *CreateSNEQData(char *GeoFile, char *TransFile, int QuantityFlags,
   SNEQData *SNEQD=(SNEQData *)mallocEC(sizeof(*SNEQD));
 
   SNEQD->WriteCache=0;
+  SNEQD->FrequencyWorkers=0;
 
   /*--------------------------------------------------------------*/
   /*-- try to create the RWGGeometry -----------------------------*/
@@ -135,8 +136,7 @@ SNEQData *CreateSNEQData(char *GeoFile, char *TransFile, int QuantityFlags,
    if (G->Surfaces[ns]->NumBFs > MaxBFs) 
     MaxBFs = G->Surfaces[ns]->NumBFs;
   
-  int nBuffer = 1 + SNEQD->NQ;
-  if (nBuffer<3) nBuffer=3;
+  int nBuffer = 3 + SNEQD->NQ;
   int BufSize = MaxBFs * MaxBFs * sizeof(cdouble);
   SNEQD->Buffer[0] = mallocEC(nBuffer*BufSize);
   for(int nb=1; nb<nBuffer; nb++)
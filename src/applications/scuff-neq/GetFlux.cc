@@ -65,6 +65,80 @@ int GetIndex(SNEQData *SNEQD, int nt, int nss, int nsd, int nq)
   return nt*NS2NQ + nss*NSNQ + nsd*NQ + nq; 
 }
 
+/***************************************************************/
+/* trace kernels used by GetTrace(). all matrices are stored in */
+/* LAPACK (column-major) order, so the inner loops below run    */
+/* over contiguous columns.                                     */
+/***************************************************************/
+
+/*--------------------------------------------------------------*/
+/*- return Re Tr[ A*B ], or Re Tr[ (Sym A) * B ] with           */
+/*- Sym A = (A + A^\dagger)/2 if SymA==true                     */
+/*--------------------------------------------------------------*/
+static double DenseTrace(HMatrix *A, HMatrix *B, bool SymA=false)
+{
+  int N=A->NR;
+  cdouble *ZA=A->ZM, *ZB=B->ZM;
+
+  double Sum=0.0;
+  int NumThreads;
+#ifndef USE_OPENMP
+  NumThreads=1;
+#else
+  NumThreads=GetNumThreads();
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads), reduction(+:Sum)
+#endif
+  for(int nr=0; nr<N; nr++)
+   for(int nc=0; nc<N; nc++)
+    { cdouble AEntry = ZA[nr + nc*N];
+      if (SymA) 
+       AEntry = 0.5*(AEntry + conj(ZA[nc + nr*N]));
+      Sum += real( AEntry * ZB[nc + nr*N] );
+    };
+
+  return Sum;
+}
+
+/*--------------------------------------------------------------*/
+/*- return Re Tr[ O * W^\dagger * GW ] for a sparse matrix O,   */
+/*- without forming the dense product W^\dagger * GW:           */
+/*-                                                             */
+/*-  Tr = \sum_{r} \sum_{c \in nz(r)} O_{rc} (W_{:,c})^\dagger  */
+/*-                                       (GW)_{:,r}            */
+/*-                                                             */
+/*- the cost is nnz(O) * W->NR instead of (W->NC)^2 * W->NR.    */
+/*--------------------------------------------------------------*/
+static double SparseTrace(SMatrix *O, HMatrix *W, HMatrix *GW)
+{
+  int NR=W->NR, NC=W->NC;
+  cdouble *ZW=W->ZM, *ZGW=GW->ZM;
+
+  double Sum=0.0;
+  int NumThreads;
+#ifndef USE_OPENMP
+  NumThreads=1;
+#else
+  NumThreads=GetNumThreads();
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads), reduction(+:Sum)
+#endif
+  for(int r=0; r<NC; r++)
+   { 
+     int *CIndices;       // column indices
+     cdouble *Entries;    // column entries   
+     int nnz=O->GetRow(r, &CIndices, &Entries);
+     cdouble *GWr = ZGW + r*NR;
+     for(int nci=0; nci<nnz; nci++)
+      { cdouble *Wc = ZW + CIndices[nci]*NR;
+        cdouble Dot=0.0;
+        for(int a=0; a<NR; a++)
+         Dot += conj(Wc[a]) * GWr[a];
+        Sum += real( Entries[nci] * Dot );
+      };
+   };
+
+  return Sum;
+}
+
 /***************************************************************/
 /* compute the four-matrix-trace formula for the contribution  */
 /* of sources inside SourceSurface to the fluxes of power      */
@@ -87,22 +161,26 @@ int GetIndex(SNEQData *SNEQD, int nt, int nss, int nsd, int nq)
 /*                                                             */
 /*            W = (Source, Dest) subblock of inverse BEM       */
 /*                                                             */
+/* WD is the column block of the inverse BEM matrix for the    */
+/* destination surface, i.e. WD = W^{-1}_{:,Dest}.             */
+/*                                                             */
 /* This routine makes use of the Buffer field of the SNEQD     */
 /* data structure, as follows:                                 */
 /*                                                             */
-/*  (A) Buffer[0] is used throughout to store the matrix       */
-/*      (W^\dagger) * SymGSource * W.                          */
+/*  (A) Buffer[1] and Buffer[2] store W_{SD} and               */
+/*      SymGSource * W_{SD}.                                   */
 /*                                                             */
-/*  (B) Buffer[1] and Buffer[2] are used in the first part     */
-/*      of the routine to store intermediate matrices used     */
-/*      in the computation of item (A) above.                  */
+/*  (B) Buffer[0] stores the matrix (W^\dagger)*SymGSource*W,  */
+/*      which is only formed if one of the MDest matrices is   */
+/*      dense; for sparse (overlap) matrices MDest the trace   */
+/*      is evaluated directly from the nonzero entries.        */
 /*                                                             */
-/*  (C) Buffer[1...NumQuantities+1] are used in the second     */
+/*  (C) Buffer[3...NumQuantities+2] are used in the second     */
 /*      part of the routine (only if Source==Dest) to store    */
 /*      the SIPFT matrices for the quantities required.        */
 /***************************************************************/
 void GetTrace(SNEQData *SNEQD, int SourceSurface, int DestSurface,
-              cdouble Omega, double *Results)
+              HMatrix *WD, cdouble Omega, double *Results)
 {
   RWGGeometry *G      = SNEQD->G;
 
@@ -110,17 +188,15 @@ void GetTrace(SNEQData *SNEQD, int SourceSurface, int DestSurface,
   int OffsetS         = G->BFIndexOffset[SourceSurface];
 
   int DimD            = G->Surfaces[DestSurface]->NumBFs;
-  int OffsetD         = G->BFIndexOffset[DestSurface];
    
   /*--------------------------------------------------------------*/
   /*- Set W_{SD} = S,D subblock of W matrix                       */
   /*--------------------------------------------------------------*/
   HMatrix *WSD = new HMatrix(DimS, DimD, LHM_COMPLEX, LHM_NORMAL, SNEQD->Buffer[1]);
-  SNEQD->W->ExtractBlock(OffsetS, OffsetD, WSD);
+  WD->ExtractBlock(OffsetS, 0, WSD);
 
   /*--------------------------------------------------------------*/
   /*- set   GW = G_S * W_{SD}                                    -*/
-  /*- and WDGW = W_{SD}^\dagger  * G_S * W_{SD}                  -*/
   /*- where G_S = (Sym G)_{source}.                              -*/
   /*--------------------------------------------------------------*/
   HMatrix *GW = new HMatrix(DimS, DimD, LHM_COMPLEX, LHM_NORMAL, SNEQD->Buffer[2]);
@@ -132,10 +208,18 @@ void GetTrace(SNEQData *SNEQD, int SourceSurface, int DestSurface,
                                )); 
   SymG->Multiply(WSD, GW);
   delete SymG; 
-  HMatrix *WDGW = new HMatrix(DimD, DimD, LHM_COMPLEX, LHM_NORMAL, SNEQD->Buffer[0]);
-  WSD->Multiply(GW, WDGW, "--transA C");
-  delete WSD;
-  delete GW;
+
+  /*--------------------------------------------------------------*/
+  /*- set WDGW = W_{SD}^\dagger  * G_S * W_{SD} if any of the     */
+  /*- quantities requested involves a dense matrix               -*/
+  /*--------------------------------------------------------------*/
+  bool NeedWDGW =    (SourceSurface==DestSurface)
+                  || (SNEQD->SymGPower && (SNEQD->QuantityFlags & QFLAG_POWER));
+  HMatrix *WDGW = 0;
+  if (NeedWDGW)
+   { WDGW = new HMatrix(DimD, DimD, LHM_COMPLEX, LHM_NORMAL, SNEQD->Buffer[0]);
+     WSD->Multiply(GW, WDGW, "--transA C");
+   };
 
   /*--------------------------------------------------------------*/
   /*- assemble SIPFT matrices as necessary -----------------------*/
@@ -147,7 +231,7 @@ void GetTrace(SNEQData *SNEQD, int SourceSurface, int DestSurface,
     /*- first determine which SIPFT matrices we need                */
     /*--------------------------------------------------------------*/
     bool NeedMatrix[NUMSIPFT];
-    for(int QIndex=0, nBuffer=1; QIndex<MAXQUANTITIES; QIndex++)
+    for(int QIndex=0, nBuffer=3; QIndex<MAXQUANTITIES; QIndex++)
      { 
        int QFlag = 1<<QIndex;
        if ( !(SNEQD->QuantityFlags & QFlag) )
@@ -170,8 +254,6 @@ void GetTrace(SNEQData *SNEQD, int SourceSurface, int DestSurface,
   /*- for each quantity requested, compute trace(M*WDGW) where    */
   /*- M is the OPFT or SIPFT matrix for the quantity in question  */
   /*--------------------------------------------------------------*/
-  int *CIndices;       // column indices
-  cdouble *Entries;    // column entries   
   for(int nq=0, QIndex=0; QIndex<MAXQUANTITIES; QIndex++)
    { 
       int QFlag = 1<<QIndex;
@@ -181,47 +263,28 @@ void GetTrace(SNEQData *SNEQD, int SourceSurface, int DestSurface,
        continue;
 
       if ( QFlag==QFLAG_POWER && SNEQD->SymGPower )
-       {
-         HMatrix *T=SNEQD->TSelf[DestSurface];
-         double FMPTrace=0.0; //'four-matrix-product trace'
-         for(int nr=0; nr<DimD; nr++)
-          for(int nc=0; nc<DimD; nc++)
-           { cdouble SymGEntry = 0.5 * (T->GetEntry(nr,nc) + conj(T->GetEntry(nc,nr)) );
-             FMPTrace += real(SymGEntry * WDGW->GetEntry(nc,nr));
-           };
-         Results[nq++] = (1.0/8.0) * FMPTrace;
+       { Results[nq++] = (1.0/8.0) * DenseTrace(SNEQD->TSelf[DestSurface], WDGW, true);
          continue;
        };
 
       //
       if ( SourceSurface==DestSurface )
-       {
-         HMatrix *M=MSIPFT[QIndex];
-         double FMPTrace=0.0; //'four-matrix-product trace'
-         for(int nr=0; nr<DimD; nr++)
-          for(int nc=0; nc<DimD; nc++)
-           FMPTrace += real( M->GetEntry(nr,nc) * WDGW->GetEntry(nc,nr) );
-         Results[nq++] = (1.0/4.0) * FMPTrace;
+       { Results[nq++] = (1.0/4.0) * DenseTrace(MSIPFT[QIndex], WDGW);
          continue;
        };
  
       //
       SMatrix *OMatrixD = SNEQD->SArray[DestSurface][ 1 + QIndex ];
-      double FMPTrace=0.0; //'four-matrix-product trace'
-      for(int ri=0; ri<DimD; ri++) // 'row index'
-       { 
-         int nnz=OMatrixD->GetRow(ri, &CIndices, (void **)&Entries);
-         for(int nci=0; nci<nnz; nci++)
-          FMPTrace += real( Entries[nci] * WDGW->GetEntry(CIndices[nci], ri) );
-       };
-      Results[nq++] = (-1.0/16.0) * FMPTrace;
+      Results[nq++] = (-1.0/16.0) * SparseTrace(OMatrixD, WSD, GW);
 
    };
 
   /*--------------------------------------------------------------*/
   /*- deallocate temporary storage -------------------------------*/
   /*--------------------------------------------------------------*/
-  delete WDGW;
+  delete WSD;
+  delete GW;
+  if (WDGW) delete WDGW;
   if ( SourceSurface==DestSurface )
    for(int nq=0; nq<SNEQD->NQ; nq++)
     if (MSIPFT[nq]) delete MSIPFT[nq];
@@ -441,36 +504,40 @@ void GetFlux(SNEQData *SNEQD, cdouble Omega, double *kBloch, double *Flux)
          };
       };
      UndoSCUFFMatrixTransformation(W);
-     Log("LU factorizing/inverting...");
+     Log("LU factorizing...");
      W->LUFactorize();
-     W->LUInvert();
-     Log("Done with linear algebra...");
 
      /*--------------------------------------------------------------*/
      /*- compute the requested quantities for all objects           -*/
      /*- note: nss = 'num surface, source'                          -*/
      /*-       nsd = 'num surface, destination'                     -*/
+     /*-                                                            -*/
+     /*- we never form the full inverse of the BEM matrix; instead, -*/
+     /*- for each destination surface we solve for just the column  -*/
+     /*- block W^{-1}_{:,nsd} from the LU factors, which contains   -*/
+     /*- the (nss,nsd) blocks needed for all source surfaces. the   -*/
+     /*- column block is freed again before the next one is solved, -*/
+     /*- so the only persistent dense storage is the LU-factorized  -*/
+     /*- BEM matrix itself.                                         -*/
      /*--------------------------------------------------------------*/
-     FILE *f=vfopen("%s.flux","a",SNEQD->FileBase);
-     double Quantities[7];
-     for(int nss=0; nss<NS; nss++)
-      for(int nsd=0; nsd<NS; nsd++)
-       { 
-         fprintf(f,"%e %s ",real(Omega),Tag);
-         if (kBloch) fprintf(f,"%e %e ",kBloch[0],kBloch[1]);
-         fprintf(f,"%i%i ",nss+1,nsd+1);
-         GetTrace(SNEQD, nss, nsd, Omega, Quantities);
-         for(int nq=0; nq<NQ; nq++)
-          { int Index=GetIndex(SNEQD, nt, nss, nsd, nq);
-            Flux[Index] = Quantities[nq]; 
-            fprintf(f,"%.8e ",Flux[Index]);
-            fflush(f);
-          };
-         fprintf(f,"\n");
-         fflush(f);
-    
-       };
-     fclose(f);
+     for(int nsd=0; nsd<NS; nsd++)
+      { 
+        int DimD    = G->Surfaces[nsd]->NumBFs;
+        int OffsetD = G->BFIndexOffset[nsd];
+        HMatrix *WD = new HMatrix(G->TotalBFs, DimD, LHM_COMPLEX);
+        WD->Zero();
+        for(int n=0; n<DimD; n++)
+         WD->SetEntry(OffsetD + n, n, 1.0);
+        Log(" Solving for column block %i of inverse BEM matrix...",nsd);
+        W->LUSolve(WD);
+
+        for(int nss=0; nss<NS; nss++)
+         GetTrace(SNEQD, nss, nsd, WD, Omega,
+                  Flux + GetIndex(SNEQD, nt, nss, nsd, 0));
+
+        delete WD;
+      };
+     Log("Done with linear algebra...");
 
      /*--------------------------------------------------------------*/
      /* and untransform the geometry                                 */
@@ -480,6 +547,28 @@ void GetFlux(SNEQData *SNEQD, cdouble Omega, double *kBloch, double *Flux)
 
    }; // for (nt=0; nt<SNEQD->NumTransformations... )
 
+  /*--------------------------------------------------------------*/
+  /*- write the results for all transformations to the .flux file */
+  /*- as one locked block, so that concurrent frequency workers   */
+  /*- cannot interleave them (CacheRead() expects them on         */
+  /*- consecutive lines).                                         */
+  /*--------------------------------------------------------------*/
+  FILE *f=vfopen("%s.flux","a",SNEQD->FileBase);
+  LockOutputFile(f);
+  for(int nt=0; nt<SNEQD->NumTransformations; nt++)
+   for(int nss=0; nss<NS; nss++)
+    for(int nsd=0; nsd<NS; nsd++)
+     { 
+       fprintf(f,"%e %s ",real(Omega),SNEQD->GTCList[nt]->Tag);
+       if (kBloch) fprintf(f,"%e %e ",kBloch[0],kBloch[1]);
+       fprintf(f,"%i%i ",nss+1,nsd+1);
+       for(int nq=0; nq<NQ; nq++)
+        fprintf(f,"%.8e ",Flux[GetIndex(SNEQD, nt, nss, nsd, nq)]);
+       fprintf(f,"\n");
+     };
+  UnlockOutputFile(f);
+  fclose(f);
+
   /*--------------------------------------------------------------*/
   /*- at the end of the first successful frequency calculation,  -*/
   /*- we dump out the cache to disk, and then tell ourselves not -*/
@@ -498,3 +587,56 @@ void GetFlux(SNEQData *SNEQD, cdouble Omega, double *kBloch, double *Flux)
 /***************************************************************/
 void GetFlux(SNEQData *SNEQD, cdouble Omega, double *Flux)
  { GetFlux(SNEQD, Omega, 0, Flux); }
+
+/***************************************************************/
+/* wrappers with the prototype expected by the frequency       */
+/* workers (FrequencyWorkers.cc in libscuff);                  */
+/* x = {real(Omega), imag(Omega)} or x = {Omega, kx, ky}.      */
+/***************************************************************/
+void OmegaWorkerFunction(void *UserData, const double *x, double *Flux)
+{
+  SNEQData *SNEQD = (SNEQData *)UserData;
+
+  // only the first worker writes the cache file
+  if (GetFrequencyWorkerIndex()>0)
+   SNEQD->WriteCache=0;
+
+  GetFlux(SNEQD, cdouble(x[0], x[1]), Flux);
+}
+
+void OmegakBlochWorkerFunction(void *UserData, const double *x, double *Flux)
+{
+  SNEQData *SNEQD = (SNEQData *)UserData;
+
+  if (GetFrequencyWorkerIndex()>0)
+   SNEQD->WriteCache=0;
+
+  double kBloch[2];
+  kBloch[0]=x[1];
+  kBloch[1]=x[2];
+  GetFlux(SNEQD, x[0], kBloch, Flux);
+}
+
+/***************************************************************/
+/* compute fluxes at NumOmega frequencies, concurrently if     */
+/* frequency workers were created; the results for frequency   */
+/* #no go into Flux[no*NTNSNQ*NS ... ].                         */
+/***************************************************************/
+void GetFluxes(SNEQData *SNEQD, int NumOmega, cdouble *Omega, double *Flux)
+{
+  int fdim = SNEQD->NTNSNQ * SNEQD->G->NumSurfaces;
+
+  if (SNEQD->FrequencyWorkers)
+   { double *x = new double[2*NumOmega];
+     for(int no=0; no<NumOmega; no++)
+      { x[2*no+0] = real(Omega[no]);
+        x[2*no+1] = imag(Omega[no]);
+      };
+     EvaluateFrequencyPoints(SNEQD->FrequencyWorkers, NumOmega, x, Flux);
+     delete[] x;
+     SNEQD->WriteCache=0;
+   }
+  else
+   for(int no=0; no<NumOmega; no++)
+    GetFlux(SNEQD, Omega[no], Flux + no*fdim);
+}
@@ -231,6 +231,65 @@ int GetOmegaIntegrand2(unsigned ndim, const double *x, void *params,
   return GetOmegaIntegrand(ndim, x, params, fdim, 0, fval);
 }
 
+/***************************************************************/
+/* vectorized version of GetOmegaIntegrand for pcubature_v,    */
+/* which evaluates all points of a cubature pass in one batch  */
+/* (concurrently if frequency workers are in use).             */
+/* libSGJC has no logging variant of pcubature_v, so each      */
+/* batch is appended to the same log file that pcubature_log   */
+/* writes in the serial case, one line (x, integrand values)   */
+/* per point.                                                  */
+/***************************************************************/
+int GetOmegaIntegrand_v(unsigned ndim, size_t npt, const double *x,
+                        void *params, unsigned fdim, double *fval)
+{
+  (void) ndim; // unused
+
+  GOIData *Data       = (GOIData *)params;
+  SNEQData *SNEQD     = Data->SNEQD;
+
+  memset(SNEQD->OmegaConverged, 0, fdim*sizeof(bool));
+
+  cdouble *Omega   = new cdouble[npt];
+  double *Jacobian = new double[npt];
+  for(size_t np=0; np<npt; np++)
+   { if (Data->Infinite)
+      { Omega[np]    = Data->OmegaMin + x[np] / (1.0-x[np]);
+        Jacobian[np] = 1.0 / ( (1.0-x[np]) * (1.0-x[np]) );
+      }
+     else
+      { Omega[np]    = x[np];
+        Jacobian[np] = 1.0;
+      };
+     if (real(Omega[np])<MINOMEGA)
+      Omega[np]=MINOMEGA;
+   };
+
+  GetFluxes(SNEQD, npt, Omega, fval);
+
+  for(size_t np=0; np<npt; np++)
+   { double *f = fval + np*fdim;
+     for(unsigned int nf=0; nf<fdim; nf++)
+      f[nf]*=Jacobian[np];
+     PutInThetaFactors(SNEQD, real(Omega[np]), Data->TSurfaces, Data->TEnvironment, f);
+   };
+
+  FILE *LogFile=fopen("scuff-neq.SGJClog","a");
+  if (LogFile)
+   { for(size_t np=0; np<npt; np++)
+      { fprintf(LogFile,"%.8e ",x[np]);
+        for(unsigned int nf=0; nf<fdim; nf++)
+         fprintf(LogFile,"%.8e ",fval[np*fdim + nf]);
+        fprintf(LogFile,"\n");
+      };
+     fclose(LogFile);
+   };
+
+  delete[] Omega;
+  delete[] Jacobian;
+  return 0;
+}
+
 /***************************************************************/
 /***************************************************************/
 /***************************************************************/
@@ -269,10 +328,15 @@ void GetOmegaIntegral_Adaptive(SNEQData *SNEQD,
   int fdim = NT*NS*NS*NQ;
   double AbsTol = SNEQD->AbsTol;
   double RelTol = SNEQD->RelTol;
-  pcubature_log(fdim, GetOmegaIntegrand2, (void *)Data, 1,
-                &OmegaMin, &OmegaMax, 1000, 
-                AbsTol, RelTol, ERROR_INDIVIDUAL,
-                I, E, "scuff-neq.SGJClog");
+  if (SNEQD->FrequencyWorkers)
+   pcubature_v(fdim, GetOmegaIntegrand_v, (void *)Data, 1,
+               &OmegaMin, &OmegaMax, 1000, 
+               AbsTol, RelTol, ERROR_INDIVIDUAL, I, E);
+  else
+   pcubature_log(fdim, GetOmegaIntegrand2, (void *)Data, 1,
+                 &OmegaMin, &OmegaMax, 1000, 
+                 AbsTol, RelTol, ERROR_INDIVIDUAL,
+                 I, E, "scuff-neq.SGJClog");
 
 }
 
@@ -305,87 +369,69 @@ void GetOmegaIntegral_TrapSimp(SNEQData *SNEQD,
   int NT = SNEQD->NumTransformations;
   int NQ = SNEQD->NQ;
   int fdim = NT*NS*NS*NQ;
-  double *fLeft  = new double[fdim];
-  double *fMid   = new double[fdim];
-  double *fRight = new double[fdim];
-  double Omega, Jacobian;
 
   /*--------------------------------------------------------------*/
-  /*- evaluate integrand at leftmost point -----------------------*/
+  /*- all quadrature points are known in advance, so we evaluate  */
+  /*- the integrand at all of them in a single batch (which runs  */
+  /*- concurrently if frequency workers are in use).              */
+  /*- point #0 is the leftmost point; points #2n+1, #2n+2 are the */
+  /*- midpoint and right end of the nth interval.                 */
+  /*- with the variable transformation the rightmost point is    */
+  /*- u=1, i.e. Omega=infinity, where the integrand (with its     */
+  /*- Theta factors) vanishes; it is not evaluated and its value  */
+  /*- is left at zero.                                            */
   /*--------------------------------------------------------------*/
-  if (UseVariableTransformation) 
-   { Omega = OmegaMin + uMin / (1.0-uMin);
-     Jacobian = 1.0/( (1.0-uMin)*(1.0-uMin) );
-     GetFlux(SNEQD, Omega, fLeft);
-     for(int n=0; n<fdim; n++) fLeft[n]*=Jacobian;
-   }
-  else
-   { Omega=uMin;
-     GetFlux(SNEQD, Omega, fLeft);
+  double Delta = (uMax - uMin) / NumIntervals;
+  int NumPoints = 2*NumIntervals + 1;
+  int NumEvaluated = UseVariableTransformation ? NumPoints-1 : NumPoints;
+  cdouble *Omega   = new cdouble[NumPoints];
+  double *Jacobian = new double[NumPoints];
+  for(int np=0; np<NumPoints; np++)
+   { double u = uMin + 0.5*np*Delta;
+     if (UseVariableTransformation) 
+      { Omega[np]    = OmegaMin + u/(1.0-u);
+        Jacobian[np] = 1.0/( (1.0-u)*(1.0-u) );
+      }
+     else
+      { Omega[np]    = u;
+        Jacobian[np] = 1.0;
+      };
+   };
+
+  double *f = new double[NumPoints*fdim];
+  memset(f, 0, NumPoints*fdim*sizeof(double));
+  GetFluxes(SNEQD, NumEvaluated, Omega, f);
+  for(int np=0; np<NumEvaluated; np++)
+   { for(int nf=0; nf<fdim; nf++) 
+      f[np*fdim + nf]*=Jacobian[np];
+     PutInThetaFactors(SNEQD, real(Omega[np]), TSurfaces, TEnvironment, f + np*fdim);
    };
-  PutInThetaFactors(SNEQD, Omega, TSurfaces, TEnvironment, fLeft);
 
   /*--------------------------------------------------------------*/
   /*--------------------------------------------------------------*/
   /*--------------------------------------------------------------*/
-  double u=uMin, Delta = (uMax - uMin) / NumIntervals;
-  double *ISimp  = new double[fdim];
-  double *ITrap  = new double[fdim];
   memset(I, 0, fdim*sizeof(double));
   memset(E, 0, fdim*sizeof(double));
   for(int nIntervals=0; nIntervals<NumIntervals; nIntervals++)
    { 
-     // evaluate integrand at midpoint end of interval 
-     u += 0.5*Delta;
-     if (UseVariableTransformation) 
-      { Omega = OmegaMin + u/ (1.0-u);
-        Jacobian = 1.0/( (1.0-u)*(1.0-u) );
-        GetFlux(SNEQD, Omega, fMid);
-        for(int n=0; n<fdim; n++) fMid[n]*=Jacobian;
-      }
-     else
-      { Omega=u;
-        GetFlux(SNEQD, Omega, fMid);
-      };
-     PutInThetaFactors(SNEQD, Omega, TSurfaces, TEnvironment, fMid);
-
-     // evaluate integrand at right end of interval 
-     u += 0.5*Delta;
-     if (UseVariableTransformation && nIntervals==NumIntervals-1) 
-      { Omega=0.0;
-        memset(fRight,0,fdim*sizeof(double)) ;
-      }
-     if (UseVariableTransformation) 
-      { Omega = OmegaMin + u/ (1.0-u);
-        Jacobian = 1.0/( (1.0-u)*(1.0-u) );
-        GetFlux(SNEQD, Omega, fRight);
-        for(int n=0; n<fdim; n++) fRight[n]*=Jacobian;
-      }
-     else
-      { Omega=u;
-        GetFlux(SNEQD, Omega, fRight);
-      };
-     PutInThetaFactors(SNEQD, Omega, TSurfaces, TEnvironment, fRight);
+     double *fLeft  = f + (2*nIntervals+0)*fdim;
+     double *fMid   = f + (2*nIntervals+1)*fdim;
+     double *fRight = f + (2*nIntervals+2)*fdim;
 
      // compute the simpson's rule and trapezoidal rule
      // estimates of the integral over this interval
      // and take their difference as the error
      for(int nf=0; nf<fdim; nf++)
-      { ISimp[nf] = (fLeft[nf] + 4.0*fMid[nf] + fRight[nf])*Delta/6.0;
-        ITrap[nf] = (fLeft[nf] + 2.0*fMid[nf] + fRight[nf])*Delta/4.0;
-        I[nf] += ISimp[nf];
-        E[nf] += fabs(ISimp[nf] - ITrap[nf]);
+      { double ISimp = (fLeft[nf] + 4.0*fMid[nf] + fRight[nf])*Delta/6.0;
+        double ITrap = (fLeft[nf] + 2.0*fMid[nf] + fRight[nf])*Delta/4.0;
+        I[nf] += ISimp;
+        E[nf] += fabs(ISimp - ITrap);
       };
-
-     // prepare for next iteration
-     memcpy(fLeft, fRight, fdim*sizeof(double));
-
    };
-  delete[] fLeft;
-  delete[] fMid;
-  delete[] fRight;
-  delete[] ISimp;
-  delete[] ITrap;
+
+  delete[] Omega;
+  delete[] Jacobian;
+  delete[] f;
 
 }
 
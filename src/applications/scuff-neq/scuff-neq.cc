@@ -99,10 +99,12 @@ int main(int argc, char *argv[])
   char *Cache=0;
   char *ReadCache[MAXCACHE];         int nReadCache;
   char *WriteCache=0;
+  char *SnapshotDir=0;
 
   /*--------------------------------------------------------------*/
   bool SymGPower=false;
   bool UseExistingData=false;
+  int FrequencyWorkers=0;
 
   /* name               type    #args  max_instances  storage           count         description*/
   OptStruct OSArray[]=
@@ -140,14 +142,18 @@ int main(int argc, char *argv[])
      {"SINumPoints",    PA_INT,     1, 1,       (void *)&SINumPoints,0,             "number of quadrature points for SIPFT"},
 /**/
      {"UseExistingData", PA_BOOL,   0, 1,       (void *)&UseExistingData, 0,        "read existing data from .flux files"},
+     {"FrequencyWorkers",PA_INT,    1, 1,       (void *)&FrequencyWorkers, 0,       "number of worker processes evaluating frequency points concurrently"},
 /**/
      {"Cache",          PA_STRING,  1, 1,       (void *)&Cache,      0,             "read/write cache"},
      {"ReadCache",      PA_STRING,  1, MAXCACHE,(void *)ReadCache,   &nReadCache,   "read cache"},
      {"WriteCache",     PA_STRING,  1, 1,       (void *)&WriteCache, 0,             "write cache"},
+     {"SnapshotDir",    PA_STRING,  1, 1,       (void *)&SnapshotDir, 0,             "directory for cached geometry snapshots"},
 /**/     
      {0,0,0,0,0,0,0}
    };
   ProcessOptions(argc, argv, OSArray);
+  if (SnapshotDir)
+   RWGGeometry::SetSnapshotDir(SnapshotDir);
 
   if (GeoFile==0)
    OSUsage(argv[0], OSArray, "--geometry option is mandatory");
@@ -259,6 +265,17 @@ int main(int argc, char *argv[])
   if ( nIntervals!=0 && OQMethod!=QMETHOD_TRAPSIMP )
    ErrExit("--Intervals may only be used with --OmegaQuadrature TrapSimp");
 
+  /*******************************************************************/
+  /* frequency workers are forked below, so geometry setup must not  */
+  /* start the OpenMP thread pool (see FrequencyWorkers.cc in        */
+  /* libscuff).                                                      */
+  /*******************************************************************/
+  if ( FrequencyWorkers>1 && !OmegaKPoints && !OmegaPoints && OQMethod==QMETHOD_CLIFF )
+   { Warn("--FrequencyWorkers is not supported for cliff quadrature (ignoring)");
+     FrequencyWorkers=1;
+   };
+  ReserveFrequencyWorkers(FrequencyWorkers);
+
   /*******************************************************************/
   /* create the SNEQData structure that contains all the info needed*/
   /* to evaluate the neq transfer at a single frequency              */
@@ -321,13 +338,39 @@ int main(int argc, char *argv[])
   SNEQD->WriteCache = WriteCache;
 
   /*******************************************************************/
-  /* now switch off based on the requested frequency behavior to     */
-  /* perform the actual calculations                                 */
+  /* fork worker processes for concurrent evaluation of frequency    */
+  /* points. (setup above ran single-threaded for this purpose; this */
+  /* restores the full thread count in the parent.)                  */
   /*******************************************************************/
   int OutputVectorLength 
    = SNEQD->NumTransformations * G->NumSurfaces * G->NumSurfaces * SNEQD->NQ;
+  if (FrequencyWorkers>1)
+   { if (OmegaKPoints)
+      SNEQD->FrequencyWorkers=CreateFrequencyWorkers(OmegakBlochWorkerFunction, (void *)SNEQD,
+                                                     3, OutputVectorLength, FrequencyWorkers);
+     else
+      SNEQD->FrequencyWorkers=CreateFrequencyWorkers(OmegaWorkerFunction, (void *)SNEQD,
+                                                     2, OutputVectorLength, FrequencyWorkers);
+   };
+
+  /*******************************************************************/
+  /* now switch off based on the requested frequency behavior to     */
+  /* perform the actual calculations                                 */
+  /*******************************************************************/
   double *I = new double[ OutputVectorLength ];
-  if (OmegaKPoints)
+  if (OmegaKPoints && SNEQD->FrequencyWorkers)
+   { 
+     int NR=OmegaKPoints->NR;
+     double *OmegaK = new double[3*NR];
+     double *Fluxes = new double[NR*OutputVectorLength];
+     for(int nok=0; nok<NR; nok++)
+      for(int nc=0; nc<3; nc++)
+       OmegaK[3*nok + nc] = OmegaKPoints->GetEntryD(nok, nc);
+     EvaluateFrequencyPoints(SNEQD->FrequencyWorkers, NR, OmegaK, Fluxes);
+     delete[] OmegaK;
+     delete[] Fluxes;
+   }
+  else if (OmegaKPoints)
    { for (int nok=0; nok<OmegaKPoints->NR; nok++)
       {  
         cdouble Omega; 
@@ -340,8 +383,13 @@ int main(int argc, char *argv[])
    }
   else if (NumFreqs>0)
    { 
+     cdouble *Omega = new cdouble[NumFreqs];
+     double *Fluxes = new double[NumFreqs*OutputVectorLength];
      for (int nFreq=0; nFreq<NumFreqs; nFreq++)
-      GetFlux(SNEQD, OmegaPoints->GetEntry(nFreq), I);
+      Omega[nFreq] = OmegaPoints->GetEntry(nFreq);
+     GetFluxes(SNEQD, NumFreqs, Omega, Fluxes);
+     delete[] Omega;
+     delete[] Fluxes;
    }
   else
    { 
@@ -351,15 +399,18 @@ int main(int argc, char *argv[])
        { case QMETHOD_ADAPTIVE:
           GetOmegaIntegral_Adaptive(SNEQD, OmegaMin, OmegaMax,
                                     TSurfaces, TEnvironment, I, E);
+          break;
 
          case QMETHOD_TRAPSIMP:
           GetOmegaIntegral_TrapSimp(SNEQD, OmegaMin, OmegaMax,
                                     TSurfaces, TEnvironment,
                                     Intervals, I, E);
+          break;
 
          case QMETHOD_CLIFF:
           GetOmegaIntegral_Cliff(SNEQD, OmegaMin, OmegaMax,
                                  TSurfaces, TEnvironment, I, E);
+          break;
        };
 
       WriteDataToOutputFile(SNEQD, I, E);
@@ -367,6 +418,7 @@ int main(int argc, char *argv[])
       delete[] E;
    };
   delete[] I;
+  DestroyFrequencyWorkers(SNEQD->FrequencyWorkers);
 
   /***************************************************************/
   /***************************************************************/
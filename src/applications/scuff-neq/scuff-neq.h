@@ -98,7 +98,7 @@ typedef struct SNEQData
 
    // Buffer[0..N] are pointers into an internally-allocated
    // chunk of memory used as a workspace in the GetTrace() routine.
-   void *Buffer[MAXQUANTITIES+1];
+   void *Buffer[MAXQUANTITIES+3];
 
    /*--------------------------------------------------------------*/
    /* storage for sparse PFT matrices                              */
@@ -122,6 +122,10 @@ typedef struct SNEQData
    /*--------------------------------------------------------------*/
    /*- miscellaneous other options                                -*/
    /*--------------------------------------------------------------*/
+   // worker processes for concurrent evaluation of frequency
+   // points (FrequencyWorkers.cc in libscuff), or NULL
+   void *FrequencyWorkers;
+
    double RelTol, AbsTol;  // integration tolerances
    char *FileBase;
    bool UseExistingData;
@@ -140,6 +144,9 @@ SNEQData *CreateSNEQData(char *GeoFile, char *TransFile,
 int GetIndex(SNEQData *SNEQD, int nt, int nss, int nsd, int nq);
 void GetFlux(SNEQData *SNEQD, cdouble Omega, double *kBloch, double *Flux);
 void GetFlux(SNEQData *SNEQD, cdouble Omega, double *Flux);
+void OmegaWorkerFunction(void *UserData, const double *x, double *Flux);
+void OmegakBlochWorkerFunction(void *UserData, const double *x, double *Flux);
+void GetFluxes(SNEQData *SNEQD, int NumOmega, cdouble *Omega, double *Flux);
 
 /*--------------------------------------------------------------*/
 /*- in Quadrature.cc          ----------------------------------*/
@@ -38,6 +38,10 @@
 
 #include "RWGPorts.h"
 
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
 #define ABSTOL 1.0e-8
 #define RELTOL 1.0e-4
 #define FREQ2OMEGA (2.0*M_PI/300.0)
@@ -439,3 +443,350 @@ void GetPortVoltages(RWGGeometry *G, HVector *KN,
     }; 
 
 }
+
+/***************************************************************/
+/* Port-voltage functionals.                                   */
+/*                                                             */
+/* The port voltages computed by GetPortVoltages() above are   */
+/* linear in the surface-current vector KN and in the port     */
+/* currents, i.e.                                              */
+/*                                                             */
+/*  V_p = \sum_\alpha W_{\alpha p} KN_\alpha                   */
+/*       + \sum_q      D_{pq}      I_q                          */
+/*                                                             */
+/* The routines below compute the matrices W and D once per    */
+/* frequency, so that port voltages for any number of KN       */
+/* vectors are just dense products (Z = W^T M^{-1} R + D).     */
+/*                                                             */
+/*  (a) scalar-potential contribution: for each port p we      */
+/*      tabulate the potential difference Phi_p[panel] between */
+/*      the positive and negative port edges due to a unit     */
+/*      charge on each panel; the charge on each panel is in   */
+/*      turn a linear function of KN and the port currents     */
+/*      (cf. ComputePanelCharges above).                       */
+/*                                                             */
+/*  (b) vector-potential contribution: the line integral of    */
+/*      iwA from PRefPoint to MRefPoint is evaluated once as a */
+/*      vector-valued integral whose components are the        */
+/*      contributions of each basis function and of unit       */
+/*      currents in each port.                                 */
+/***************************************************************/
+
+/***************************************************************/
+/* integrand for (b): fval[2*alpha, 2*alpha+1] = contribution  */
+/* of basis function #alpha, fval[2*(NBF+q), ...] = contribution*/
+/* of a unit current in port #q.                               */
+/***************************************************************/
+typedef struct iwAVData
+ {
+   RWGGeometry *G;
+   RWGPort **Ports;
+   int NumPorts;
+   cdouble IK;
+   double *X1, *X2;
+ } iwAVData;
+
+static void iwaVectorIntegrand(unsigned ndim, const double *x, void *params, 
+                               unsigned fdim, double *fval)
+{
+  (void) ndim;
+  (void) fdim;
+
+  iwAVData *iwAVD  = (iwAVData *)params;
+  RWGGeometry *G   = iwAVD->G;
+  RWGPort **Ports  = iwAVD->Ports;
+  int NumPorts     = iwAVD->NumPorts;
+  cdouble IK       = iwAVD->IK;
+  double *X1       = iwAVD->X1;
+  double *X2       = iwAVD->X2;
+  cdouble *zf      = (cdouble *)fval;
+
+  double Tau=x[0];
+  double X[3], X2mX1[3];
+  VecSub(X2, X1, X2mX1);
+  X[0] = X1[0] + Tau*X2mX1[0];
+  X[1] = X1[1] + Tau*X2mX1[1];
+  X[2] = X1[2] + Tau*X2mX1[2];
+
+  /*--------------------------------------------------------------*/
+  /*- contributions of interior edges ----------------------------*/
+  /*--------------------------------------------------------------*/
+  int NBF = G->TotalBFs;
+  int NumThreads;
+#ifndef USE_OPENMP
+  NumThreads=1;
+#else
+  NumThreads=GetNumThreads();
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+  for(int BFIndex=0; BFIndex<NBF; BFIndex++)
+   { 
+     int ns=G->NumSurfaces-1;
+     while( G->BFIndexOffset[ns] > BFIndex ) ns--;
+     RWGSurface *S=G->Surfaces[ns];
+     int ne = BFIndex - G->BFIndexOffset[ns];
+     RWGEdge *E=S->Edges[ne];
+  
+     cdouble PhiAP[4], PhiAM[4], iwA[3];
+     if ( VecDistance(X, E->Centroid) > 3.0*E->Radius )
+      GetEdgeiwA_Multipole(S, ne, IK, X, iwA);
+     else
+      { GetPanelPotentials(S, E->iPPanel, E->PIndex, IK, X, PhiAP);
+        GetPanelPotentials(S, E->iMPanel, E->MIndex, IK, X, PhiAM);
+        iwA[0] = PhiAP[1] - PhiAM[1];
+        iwA[1] = PhiAP[2] - PhiAM[2];
+        iwA[2] = PhiAP[3] - PhiAM[3];
+      };
+
+     zf[BFIndex] = iwA[0]*X2mX1[0] + iwA[1]*X2mX1[1] + iwA[2]*X2mX1[2];
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- contributions of unit currents in each port ----------------*/
+  /*--------------------------------------------------------------*/
+  for(int nPort=0; nPort<NumPorts; nPort++)
+   { 
+     RWGPort *Port=Ports[nPort];
+     cdouble PhiA[4], iwAI=0.0;
+     
+     RWGSurface *S = Port->PSurface;
+     double Weight = 1.0 / Port->PPerimeter;
+     for(int nPanel=0; nPanel<Port->NumPEdges; nPanel++)
+      { GetPanelPotentials(S, Port->PPanelIndices[nPanel], Port->PPaneliQs[nPanel], IK, X, PhiA);
+        iwAI -= Weight * ( PhiA[1]*X2mX1[0] + PhiA[2]*X2mX1[1] + PhiA[3]*X2mX1[2] );
+      };
+     
+     S = Port->MSurface;
+     Weight = 1.0 / Port->MPerimeter;
+     for(int nPanel=0; nPanel<Port->NumMEdges; nPanel++)
+      { GetPanelPotentials(S, Port->MPanelIndices[nPanel], Port->MPaneliQs[nPanel], IK, X, PhiA);
+        iwAI += Weight * ( PhiA[1]*X2mX1[0] + PhiA[2]*X2mX1[1] + PhiA[3]*X2mX1[2] );
+      };
+
+     zf[NBF + nPort] = iwAI;
+   };
+
+}
+
+/***************************************************************/
+/* compute (or recompute, if PVF is non-NULL) the port-voltage */
+/* functionals at frequency Omega.                             */
+/***************************************************************/
+PortVoltageFunctionals *GetPortVoltageFunctionals(RWGGeometry *G, 
+                                                  RWGPort **Ports, int NumPorts,
+                                                  cdouble Omega,
+                                                  PortVoltageFunctionals *PVF)
+{
+  int NBF=G->TotalBFs;
+  if (PVF && (PVF->NBF!=NBF || PVF->NumPorts!=NumPorts) )
+   { DestroyPortVoltageFunctionals(PVF);
+     PVF=0;
+   };
+  if (PVF==0)
+   { PVF=(PortVoltageFunctionals *)mallocEC(sizeof(PortVoltageFunctionals));
+     PVF->NBF      = NBF;
+     PVF->NumPorts = NumPorts;
+     PVF->W        = new HMatrix(NBF, NumPorts, LHM_COMPLEX);
+     PVF->D        = new HMatrix(NumPorts, NumPorts, LHM_COMPLEX);
+   };
+  PVF->Omega = Omega;
+  PVF->W->Zero();
+  PVF->D->Zero();
+
+  cdouble IW = II*Omega;
+  cdouble IK = II*Omega;
+
+  /***************************************************************/
+  /* (a) scalar-potential contributions                          */
+  /***************************************************************/
+  Log("   scalar potential functionals");
+  int NumPanels = G->TotalPanels;
+  cdouble *Phi = (cdouble *)mallocEC(NumPanels*NumPorts*sizeof(cdouble));
+  int NumThreads;
+#ifndef USE_OPENMP
+  NumThreads=1;
+#else
+  NumThreads=GetNumThreads();
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+  for(int nPanel=0; nPanel<NumPanels; nPanel++)
+   { 
+     int ns=G->NumSurfaces-1;
+     while( G->PanelIndexOffset[ns] > nPanel ) ns--;
+     RWGSurface *SourceSurface = G->Surfaces[ns];
+     RWGPanel *SourcePanel     = SourceSurface->Panels[nPanel - G->PanelIndexOffset[ns]];
+     double *PV[3];
+     PV[0] = SourceSurface->Vertices + 3*(SourcePanel->VI[0]);
+     PV[1] = SourceSurface->Vertices + 3*(SourcePanel->VI[1]);
+     PV[2] = SourceSurface->Vertices + 3*(SourcePanel->VI[2]);
+
+     for(int nPort=0; nPort<NumPorts; nPort++)
+      { 
+        RWGPort *Port=Ports[nPort];
+        double *EV[2];
+        cdouble VP=0.0, VM=0.0;
+
+        RWGSurface *DestSurface=Port->PSurface;
+        for(int npe=0; npe<Port->NumPEdges; npe++)
+         { RWGPanel *DestPanel = DestSurface->Panels[ Port->PPanelIndices[npe] ];
+           int iQDest          = Port->PPaneliQs[npe];
+           EV[0] = DestSurface->Vertices + 3*(DestPanel->VI[ (iQDest+1)%3 ]);
+           EV[1] = DestSurface->Vertices + 3*(DestPanel->VI[ (iQDest+2)%3 ]);
+           VP += GetEdgePanelInteraction(PV, EV, Omega);
+         };
+
+        DestSurface=Port->MSurface;
+        for(int npe=0; npe<Port->NumMEdges; npe++)
+         { RWGPanel *DestPanel = DestSurface->Panels[ Port->MPanelIndices[npe] ];
+           int iQDest          = Port->MPaneliQs[npe];
+           EV[0] = DestSurface->Vertices + 3*(DestPanel->VI[ (iQDest+1)%3 ]);
+           EV[1] = DestSurface->Vertices + 3*(DestPanel->VI[ (iQDest+2)%3 ]);
+           VM += GetEdgePanelInteraction(PV, EV, Omega);
+         };
+
+        Phi[nPort*NumPanels + nPanel] 
+         = 2.0*ZVAC*( VP/((double)Port->NumPEdges) - VM/((double)Port->NumMEdges) );
+      };
+   };
+
+  for(int nPort=0; nPort<NumPorts; nPort++)
+   { 
+     cdouble *PhiP = Phi + nPort*NumPanels;
+
+     // charges due to interior basis functions 
+     if ( ContribOnly==0 || ContribOnly==INTERIORPOTENTIAL )
+      for(int BFIndex=0, ns=0; ns<G->NumSurfaces; ns++)
+       { RWGSurface *S=G->Surfaces[ns];
+         int PIOffset=G->PanelIndexOffset[ns];
+         for(int ne=0; ne<S->NumEdges; ne++, BFIndex++)
+          { RWGEdge *E=S->Edges[ne];
+            PVF->W->SetEntry(BFIndex, nPort, 
+                             E->Length*(PhiP[PIOffset+E->iPPanel]-PhiP[PIOffset+E->iMPanel])/IW);
+          };
+       };
+
+     // charges due to port currents 
+     if ( ContribOnly==0 || ContribOnly==PORTPOTENTIAL )
+      for(int nq=0; nq<NumPorts; nq++)
+       { RWGPort *Port=Ports[nq];
+         cdouble DPQ=0.0;
+         int PIOffset=G->PanelIndexOffset[Port->PSurface->Index];
+         for(int nPanel=0; nPanel<Port->NumPEdges; nPanel++)
+          DPQ -= Port->PLengths[nPanel]*PhiP[PIOffset + Port->PPanelIndices[nPanel]]
+                  / (IW*Port->PPerimeter);
+         PIOffset=G->PanelIndexOffset[Port->MSurface->Index];
+         for(int nPanel=0; nPanel<Port->NumMEdges; nPanel++)
+          DPQ += Port->MLengths[nPanel]*PhiP[PIOffset + Port->MPanelIndices[nPanel]]
+                  / (IW*Port->MPerimeter);
+         PVF->D->SetEntry(nPort, nq, DPQ);
+       };
+   };
+  free(Phi);
+
+  /***************************************************************/
+  /* (b) vector-potential contributions                          */
+  /***************************************************************/
+  if ( ContribOnly==0 || ContribOnly==IWAINTEGRAL )
+   { 
+     Log("   vector potential functionals");
+     int fdim = 2*(NBF + NumPorts);
+     double *I = new double[fdim];
+     double *E = new double[fdim];
+     iwAVData MyiwAVData, *iwAVD=&MyiwAVData;
+     iwAVD->G=G;
+     iwAVD->Ports=Ports;
+     iwAVD->NumPorts=NumPorts;
+     iwAVD->IK=IK;
+     for(int nPort=0; nPort<NumPorts; nPort++)
+      { 
+        // as in iwAIntegral(), the absolute tolerance is set by the 
+        // magnitude of the scalar-potential contribution
+        double RefVal=0.0;
+        for(int BFIndex=0; BFIndex<NBF; BFIndex++)
+         RefVal = fmax(RefVal, abs(PVF->W->GetEntry(BFIndex,nPort)));
+
+        iwAVD->X1=Ports[nPort]->PRefPoint;
+        iwAVD->X2=Ports[nPort]->MRefPoint;
+        double Lower=0.0, Upper=1.0;
+        adapt_integrate(fdim, iwaVectorIntegrand, (void *)iwAVD, 1, 
+                        &Lower, &Upper, 1000, RELTOL*RefVal, RELTOL, I, E);
+        AICheck(__FILE__,__LINE__, I, E, RELTOL*RefVal, RELTOL, fdim);
+
+        cdouble *zI=(cdouble *)I;
+        for(int BFIndex=0; BFIndex<NBF; BFIndex++)
+         PVF->W->AddEntry(BFIndex, nPort, zI[BFIndex]);
+        for(int nq=0; nq<NumPorts; nq++)
+         PVF->D->AddEntry(nPort, nq, zI[NBF+nq]);
+      };
+     delete[] I;
+     delete[] E;
+   };
+
+  return PVF;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+void DestroyPortVoltageFunctionals(PortVoltageFunctionals *PVF)
+{
+  if (!PVF) return;
+  delete PVF->W;
+  delete PVF->D;
+  free(PVF);
+}
+
+/***************************************************************/
+/* port voltages from precomputed functionals: same result as  */
+/* the GetPortVoltages() routine above, but just O(NBF) work.  */
+/***************************************************************/
+void GetPortVoltages(PortVoltageFunctionals *PVF, HVector *KN,
+                     cdouble *PortCurrents, cdouble *PortVoltages)
+{
+  int NBF=PVF->NBF, NumPorts=PVF->NumPorts;
+  for(int nPort=0; nPort<NumPorts; nPort++)
+   { cdouble V=0.0;
+     for(int BFIndex=0; BFIndex<NBF; BFIndex++)
+      V += PVF->W->GetEntry(BFIndex, nPort) * KN->GetEntry(BFIndex);
+     for(int nq=0; nq<NumPorts; nq++)
+      V += PVF->D->GetEntry(nPort, nq) * PortCurrents[nq];
+     PortVoltages[nPort]=V;
+   };
+}
+
+/***************************************************************/
+/* port voltages for a block of solutions at once: column #nc  */
+/* of KNMatrix must be the solution of the BEM system for a    */
+/* unit current at port #nc (as obtained by M->LUSolve() on    */
+/* the output of GetPortRHSMatrix), and on return              */
+/* VMatrix(nPort, nc) is the voltage at port #nPort for that   */
+/* excitation, i.e. VMatrix = W^T * KNMatrix + D.              */
+/***************************************************************/
+HMatrix *GetPortVoltages(PortVoltageFunctionals *PVF, HMatrix *KNMatrix,
+                         HMatrix *VMatrix)
+{
+  int NBF=PVF->NBF, NumPorts=PVF->NumPorts;
+  if ( VMatrix && (VMatrix->NR!=NumPorts || VMatrix->NC!=NumPorts || VMatrix->RealComplex!=LHM_COMPLEX) )
+   { Warn("wrong-size matrix passed to GetPortVoltages (reallocating)");
+     delete VMatrix;
+     VMatrix=0;
+   };
+  if (!VMatrix)
+   VMatrix=new HMatrix(NumPorts, NumPorts, LHM_COMPLEX);
+
+#ifdef USE_OPENMP
+  int NumThreads=GetNumThreads();
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+  for(int nn=0; nn<NumPorts*NumPorts; nn++)
+   { int nPort=nn/NumPorts, nc=nn%NumPorts;
+     cdouble *W  = PVF->W->ZM + ((size_t)nPort)*NBF;
+     cdouble *KN = KNMatrix->ZM + ((size_t)nc)*NBF;
+     cdouble V=PVF->D->GetEntry(nPort, nc);
+     for(int BFIndex=0; BFIndex<NBF; BFIndex++)
+      V += W[BFIndex]*KN[BFIndex];
+     VMatrix->SetEntry(nPort, nc, V);
+   };
+
+  return VMatrix;
+}
@@ -551,6 +551,79 @@ RWGPort **ParsePortFile(RWGGeometry *G,
 
 }
 
+/***************************************************************/
+/* inner product of RWG basis function E on DestSurface with   */
+/* the E-field produced by a unit current at Port.             */
+/***************************************************************/
+static cdouble GetPortEFieldIntegral(GetPPIArgStruct *GPPIArgs, RWGPort *Port,
+                                     RWGSurface *DestSurface, RWGEdge *E,
+                                     cdouble IK)
+{
+  int DestPPanelIndex  = E->iPPanel;
+  int DestPPaneliQ     = E->PIndex;
+  int DestMPanelIndex  = E->iMPanel;
+  int DestMPaneliQ     = E->MIndex;
+  double DestLength    = E->Length;
+
+  cdouble EFieldIntegral=0.0;
+
+  /***************************************************************/
+  /* get contributions of panels on the positive side of the port*/
+  /***************************************************************/
+  RWGSurface *SourceSurface=Port->PSurface;
+  double Weight=1.0/(Port->PPerimeter);
+  for(int npe=0; npe<Port->NumPEdges; npe++) // npe = 'num port edge'
+   { 
+     double SourceLength = Port->PLengths[npe];
+
+     GPPIArgs->Sa  = SourceSurface;
+     GPPIArgs->npa = Port->PPanelIndices[npe];
+     GPPIArgs->iQa = Port->PPaneliQs[npe];
+
+     GPPIArgs->Sb  = DestSurface;
+     GPPIArgs->npb = DestPPanelIndex;
+     GPPIArgs->iQb = DestPPaneliQ;
+     GetPanelPanelInteractions(GPPIArgs);
+     EFieldIntegral -= Weight*SourceLength*DestLength*IK*GPPIArgs->H[0];
+
+     GPPIArgs->Sb  = DestSurface;
+     GPPIArgs->npb = DestMPanelIndex;
+     GPPIArgs->iQb = DestMPaneliQ;
+     GetPanelPanelInteractions(GPPIArgs);
+     EFieldIntegral += Weight*SourceLength*DestLength*IK*GPPIArgs->H[0];
+
+   }; // for(npe=0; npe<Port->NumPEdges; npe++)
+
+  /***************************************************************/
+  /* get contributions of panels on the negative side of the port*/
+  /***************************************************************/
+  SourceSurface=Port->MSurface;
+  Weight=1.0/(Port->MPerimeter);
+  for(int npe=0; npe<Port->NumMEdges; npe++)
+   { 
+     double SourceLength = Port->MLengths[npe];
+
+     GPPIArgs->Sa  = SourceSurface;
+     GPPIArgs->npa = Port->MPanelIndices[npe];
+     GPPIArgs->iQa = Port->MPaneliQs[npe];
+
+     GPPIArgs->Sb  = DestSurface;
+     GPPIArgs->npb = DestPPanelIndex;
+     GPPIArgs->iQb = DestPPaneliQ;
+     GetPanelPanelInteractions(GPPIArgs);
+     EFieldIntegral += Weight*SourceLength*DestLength*IK*GPPIArgs->H[0];
+
+     GPPIArgs->Sb  = DestSurface;
+     GPPIArgs->npb = DestMPanelIndex;
+     GPPIArgs->iQb = DestMPaneliQ;
+     GetPanelPanelInteractions(GPPIArgs);
+     EFieldIntegral -= Weight*SourceLength*DestLength*IK*GPPIArgs->H[0];
+
+   }; // for(npe=0; npe<Port->NumMEdges; npe++)
+
+  return EFieldIntegral;
+}
+
 /***************************************************************/
 /***************************************************************/
 /***************************************************************/
@@ -558,23 +631,7 @@ void AddPortContributionsToRHS(RWGGeometry *G,
                                RWGPort **Ports, int NumPorts, cdouble *PortCurrents, 
                                cdouble Omega, HVector *KN)
 {
-  int ns, ne, npe, BFIndex, nPort;
-  RWGPort *Port;
-  RWGEdge *E;
   cdouble IK=II*Omega;
- 
-  RWGSurface *SourceSurface;
-  int SourcePanelIndex;
-  int SourcePaneliQ;
-  double SourceLength;
-  cdouble PortCurrent, Weight;
-
-  RWGSurface *DestSurface;
-  int DestPPanelIndex, DestMPanelIndex;
-  int DestPPaneliQ, DestMPaneliQ;
-  double DestLength;
-
-  cdouble EFieldIntegral;
 
   GetPPIArgStruct GPPIArgsBuffer, *GPPIArgs=&GPPIArgsBuffer;
   InitGetPPIArgs(GPPIArgs);
@@ -588,25 +645,11 @@ void AddPortContributionsToRHS(RWGGeometry *G,
   /* fill in (actually augment) entries of the RHS vector one-by-*/
   /* one                                                         */
   /***************************************************************/
-  int NumThreads=GetNumThreads();
-//#ifdef USE_OPENMP
-//#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
-//#endif
-  for(BFIndex=0, ns=0; ns<G->NumSurfaces; ns++)
+  for(int BFIndex=0, ns=0; ns<G->NumSurfaces; ns++)
    { 
-     DestSurface=G->Surfaces[ns];
-     for(ne=0; ne<DestSurface->NumEdges; ne++, BFIndex++)
+     RWGSurface *DestSurface=G->Surfaces[ns];
+     for(int ne=0; ne<DestSurface->NumEdges; ne++, BFIndex++)
       { 
-        E=DestSurface->Edges[ne];
-
-        DestPPanelIndex  = E->iPPanel;
-        DestPPaneliQ     = E->PIndex;
-
-        DestMPanelIndex  = E->iMPanel;
-        DestMPaneliQ     = E->MIndex;
-
-        DestLength       = E->Length;
-
         /***************************************************************/
         /* get contribution of all ports to this element of the vector.*/
         /* note: at the conclusion of this loop, we have that          */
@@ -615,71 +658,14 @@ void AddPortContributionsToRHS(RWGGeometry *G,
         /* ports. the corresponding contribution to the RHS vector is  */
         /* then simply -EFieldIntegral.                                */
         /***************************************************************/
-        for(EFieldIntegral=0.0, nPort=0; nPort<NumPorts; nPort++)
+        cdouble EFieldIntegral=0.0;
+        for(int nPort=0; nPort<NumPorts; nPort++)
          { 
-           PortCurrent=PortCurrents[nPort];
-           if (PortCurrent==0.0) continue;
-
-           Port=Ports[nPort];
-
-           /***************************************************************/
-           /* get contributions of panels on the positive side of the port*/
-           /***************************************************************/
-           SourceSurface=Port->PSurface;
-           Weight=PortCurrent/(Port->PPerimeter);
-           for(npe=0; npe<Port->NumPEdges; npe++) // npe = 'num port edge'
-            { 
-              SourcePanelIndex  = Port->PPanelIndices[npe];
-              SourcePaneliQ     = Port->PPaneliQs[npe];
-              SourceLength      = Port->PLengths[npe];
-
-              GPPIArgs->Sa  = SourceSurface;
-              GPPIArgs->npa = SourcePanelIndex;
-              GPPIArgs->iQa = SourcePaneliQ;
-
-              GPPIArgs->Sb  = DestSurface;
-              GPPIArgs->npb = DestPPanelIndex;
-              GPPIArgs->iQb = DestPPaneliQ;
-              GetPanelPanelInteractions(GPPIArgs);
-              EFieldIntegral -= Weight*SourceLength*DestLength*IK*GPPIArgs->H[0];
-
-              GPPIArgs->Sb  = DestSurface;
-              GPPIArgs->npb = DestMPanelIndex;
-              GPPIArgs->iQb = DestMPaneliQ;
-              GetPanelPanelInteractions(GPPIArgs);
-              EFieldIntegral += Weight*SourceLength*DestLength*IK*GPPIArgs->H[0];
-
-            }; // for ne=0; ne<Port->NumPEdges; ne++)
-
-           /***************************************************************/
-           /* get contributions of panels on the negative side of the port*/
-           /***************************************************************/
-           SourceSurface=Port->MSurface;
-           Weight=PortCurrent/(Port->MPerimeter);
-           for(npe=0; npe<Port->NumMEdges; npe++)
-            { 
-              SourcePanelIndex  = Port->MPanelIndices[npe];
-              SourcePaneliQ     = Port->MPaneliQs[npe];
-              SourceLength      = Port->MLengths[npe];
-
-              GPPIArgs->Sa  = SourceSurface;
-              GPPIArgs->npa = SourcePanelIndex;
-              GPPIArgs->iQa = SourcePaneliQ;
-
-              GPPIArgs->Sb  = DestSurface;
-              GPPIArgs->npb = DestPPanelIndex;
-              GPPIArgs->iQb = DestPPaneliQ;
-              GetPanelPanelInteractions(GPPIArgs);
-              EFieldIntegral += Weight*SourceLength*DestLength*IK*GPPIArgs->H[0];
-
-              GPPIArgs->Sb  = DestSurface;
-              GPPIArgs->npb = DestMPanelIndex;
-              GPPIArgs->iQb = DestMPaneliQ;
-              GetPanelPanelInteractions(GPPIArgs);
-              EFieldIntegral -= Weight*SourceLength*DestLength*IK*GPPIArgs->H[0];
-
-            }; // for ne=0; ne<Port->NumMEdges; ne++)
-         }; // for(nPort=0; nPort<NumPorts; nPort++)
+           if (PortCurrents[nPort]==0.0) continue;
+           EFieldIntegral += PortCurrents[nPort]
+                              *GetPortEFieldIntegral(GPPIArgs, Ports[nPort], DestSurface,
+                                                     DestSurface->Edges[ne], IK);
+         };
 
         KN->AddEntry(BFIndex, -1.0*EFieldIntegral );
 
@@ -688,6 +674,61 @@ void AddPortContributionsToRHS(RWGGeometry *G,
 
 }
 
+/***************************************************************/
+/* RHS vectors for all ports at once: column #nPort of the     */
+/* TotalBFs x NumPorts matrix KNMatrix is the RHS vector       */
+/* produced by AddPortContributionsToRHS for a unit current at */
+/* port #nPort and zero current at all other ports. (every     */
+/* basis function couples to every port, so the columns are    */
+/* dense.) a single pass over the basis functions computes all */
+/* columns, which may then be solved simultaneously with one   */
+/* multi-column M->LUSolve(KNMatrix).                          */
+/***************************************************************/
+HMatrix *GetPortRHSMatrix(RWGGeometry *G, RWGPort **Ports, int NumPorts,
+                          cdouble Omega, HMatrix *KNMatrix)
+{
+  int NBF=G->TotalBFs;
+  if ( KNMatrix && (KNMatrix->NR!=NBF || KNMatrix->NC!=NumPorts || KNMatrix->RealComplex!=LHM_COMPLEX) )
+   { Warn("wrong-size matrix passed to GetPortRHSMatrix (reallocating)");
+     delete KNMatrix;
+     KNMatrix=0;
+   };
+  if (!KNMatrix)
+   KNMatrix=new HMatrix(NBF, NumPorts, LHM_COMPLEX);
+
+  cdouble IK=II*Omega;
+
+  // flat table of (surface, edge) for each basis function
+  int *BFSurface = new int[NBF], *BFEdge = new int[NBF];
+  for(int BFIndex=0, ns=0; ns<G->NumSurfaces; ns++)
+   for(int ne=0; ne<G->Surfaces[ns]->NumEdges; ne++, BFIndex++)
+    { BFSurface[BFIndex]=ns;
+      BFEdge[BFIndex]=ne;
+    };
+
+#ifdef USE_OPENMP
+  int NumThreads=GetNumThreads();
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+  for(int BFIndex=0; BFIndex<NBF; BFIndex++)
+   { 
+     GetPPIArgStruct GPPIArgsBuffer, *GPPIArgs=&GPPIArgsBuffer;
+     InitGetPPIArgs(GPPIArgs);
+     GPPIArgs->k=Omega; // this assumes the exterior medium is vacuum
+
+     RWGSurface *DestSurface=G->Surfaces[BFSurface[BFIndex]];
+     RWGEdge *E=DestSurface->Edges[BFEdge[BFIndex]];
+     for(int nPort=0; nPort<NumPorts; nPort++)
+      KNMatrix->SetEntry(BFIndex, nPort,
+                         -1.0*GetPortEFieldIntegral(GPPIArgs, Ports[nPort], DestSurface, E, IK));
+   };
+
+  delete[] BFSurface;
+  delete[] BFEdge;
+
+  return KNMatrix;
+}
+
 /***************************************************************/
 /***************************************************************/
 /***************************************************************/
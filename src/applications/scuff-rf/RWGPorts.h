@@ -78,6 +78,9 @@ void AddPortContributionsToRHS(RWGGeometry *G,
                                RWGPort **Ports, int NumPorts, cdouble *PortCurrents,
                                cdouble Omega, HVector *KN);
 
+HMatrix *GetPortRHSMatrix(RWGGeometry *G, RWGPort **Ports, int NumPorts,
+                          cdouble Omega, HMatrix *KNMatrix=0);
+
 void AddPortContributionsToPSD(RWGGeometry *G,
                                RWGPort **Ports, int NumPorts, cdouble *PortCurrents,
                                cdouble Omega, HMatrix *PSD);
@@ -86,6 +89,40 @@ void GetPortVoltages(RWGGeometry *G, HVector *KN,
                      RWGPort **Ports, int NumPorts, cdouble *PortCurrents,
                      cdouble Omega, cdouble *PortVoltages);
 
+/***************************************************************/
+/* port-voltage functionals: at a given frequency, the port    */
+/* voltages are V = W^T * KN + D * PortCurrents, where W is    */
+/* TotalBFs x NumPorts and D is NumPorts x NumPorts.           */
+/***************************************************************/
+typedef struct PortVoltageFunctionals
+ { 
+   int NBF, NumPorts;
+   cdouble Omega;
+   HMatrix *W, *D;
+
+ } PortVoltageFunctionals;
+
+PortVoltageFunctionals *GetPortVoltageFunctionals(RWGGeometry *G, 
+                                                  RWGPort **Ports, int NumPorts,
+                                                  cdouble Omega,
+                                                  PortVoltageFunctionals *PVF=0);
+void DestroyPortVoltageFunctionals(PortVoltageFunctionals *PVF);
+void GetPortVoltages(PortVoltageFunctionals *PVF, HVector *KN,
+                     cdouble *PortCurrents, cdouble *PortVoltages);
+HMatrix *GetPortVoltages(PortVoltageFunctionals *PVF, HMatrix *KNMatrix,
+                         HMatrix *VMatrix=0);
+
+/***************************************************************/
+/* reduced-order (rational) frequency model for Z-parameter    */
+/* sweeps (RationalModel.cc). ZSampler computes the exact      */
+/* NumPorts x NumPorts impedance matrix at one frequency.      */
+/***************************************************************/
+typedef void (*ZSampler)(void *UserData, double Freq, HMatrix *ZMatrix);
+
+int GetZParametersROM(ZSampler Sampler, void *UserData, int NumPorts,
+                      HVector *FreqList, double RelTol, int MaxSamples,
+                      HMatrix **ZMatrices, double *ErrEst);
+
 void PlotPortsinGNUPLOT(const char *GPFileName, RWGPort **Ports, int NumPorts);
 void PlotPortsInGMSH(RWGPort **Ports, int NumPorts, const char *format, ...);
 void DrawGMSHCircle(const char *PPFile, const char *Name,
@@ -0,0 +1,570 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * RationalModel.cc -- reduced-order frequency model for Z-parameter
+ *                  -- sweeps in scuff-rf
+ *
+ * how it works:
+ *
+ *  (a) the impedance matrix Z(f) of a passive structure is a rational
+ *      function of frequency to excellent accuracy over a finite band,
+ *      so instead of solving the BEM problem at every point of a
+ *      frequency sweep we solve it at a small number of sample
+ *      frequencies and fit a rational model to the results.
+ *
+ *  (b) the model is a barycentric rational function
+ *
+ *        Z_k(f) = \sum_j w_j Z_k(f_j)/(f-f_j) / \sum_j w_j/(f-f_j)
+ *
+ *      with the same support points f_j and weights w_j for all
+ *      NumPorts^2 entries Z_k of the Z-matrix; the support points
+ *      and weights are computed by the (set-valued) AAA algorithm.
+ *      (the smallest singular vector of the Loewner matrix needed
+ *      by AAA is computed by inverse iteration on the small
+ *      n x n matrix L^\dagger L.) after the fit, spurious poles
+ *      with negligible residues (Froissart doublets) are located
+ *      by Aberth iteration, the support points nearest to them are
+ *      dropped, and the weights are recomputed.
+ *
+ *  (c) sample frequencies are chosen adaptively from the sweep: we
+ *      start with the endpoints and the midpoint, and at each stage
+ *      compare the current model with the model fitted at the
+ *      previous stage (i.e. without the most recent sample). the
+ *      difference between the two, relative to the largest |Z|
+ *      seen, is our error estimate at each sweep point. if the
+ *      largest estimated error exceeds the tolerance, the worst
+ *      sweep point is added to the samples.
+ *
+ *  (d) on return, Z-matrices at sampled frequencies are exact (and
+ *      have error estimate 0); all others come from the model.
+ *
+ * agent         -- 10/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include <libhmat.h>
+
+#include "RWGPorts.h"
+
+#define AAA_MAXINVITER    50      // max number of inverse-iteration steps
+#define AAA_MAXABERTHITER 200     // max number of Aberth steps for the poles
+#define AAA_CLEANUPTOL    1.0e-13 // Froissart-doublet residue threshold
+                                  // (relative to max|Z| * bandwidth)
+
+/***************************************************************/
+/* evaluate the barycentric model with n support points zs,    */
+/* function values Fs[j*NK + k], and weights w at frequency z. */
+/***************************************************************/
+static void EvaluateModel(int n, double *zs, cdouble *Fs, cdouble *w,
+                          int NK, double z, cdouble *r)
+{
+  for(int j=0; j<n; j++)
+   if (z==zs[j])
+    { memcpy(r, Fs + j*NK, NK*sizeof(cdouble));
+      return;
+    };
+
+  cdouble Den=0.0;
+  memset(r, 0, NK*sizeof(cdouble));
+  for(int j=0; j<n; j++)
+   { cdouble c = w[j] / (z-zs[j]);
+     Den += c;
+     for(int k=0; k<NK; k++)
+      r[k] += c*Fs[j*NK + k];
+   };
+  for(int k=0; k<NK; k++)
+   r[k] /= Den;
+}
+
+/***************************************************************/
+/* eigenvector of the smallest eigenvalue of the n x n         */
+/* hermitian positive-semidefinite matrix A, by inverse        */
+/* iteration (A is overwritten)                                */
+/***************************************************************/
+static void GetSmallestEigenvector(HMatrix *A, cdouble *w)
+{
+  int n=A->NR;
+
+  double Trace=0.0;
+  for(int j=0; j<n; j++)
+   Trace += real(A->GetEntry(j,j));
+  double Delta = 1.0e-13*(Trace/n) + 1.0e-300;
+  for(int j=0; j<n; j++)
+   A->AddEntry(j, j, Delta);
+  A->LUFactorize();
+
+  HVector *x = new HVector(n, LHM_COMPLEX);
+  for(int j=0; j<n; j++)
+   x->SetEntry(j, 1.0/sqrt((double)n));
+  for(int Iter=0; Iter<AAA_MAXINVITER; Iter++)
+   {
+     memcpy(w, x->ZV, n*sizeof(cdouble));
+     A->LUSolve(x);
+
+     double Norm=0.0;
+     for(int j=0; j<n; j++)
+      Norm += norm(x->GetEntry(j));
+     Norm=sqrt(Norm);
+     x->Scale(1.0/Norm);
+
+     // converged if x is parallel to the previous iterate
+     cdouble Overlap=0.0;
+     for(int j=0; j<n; j++)
+      Overlap += conj(w[j]) * x->GetEntry(j);
+     if ( 1.0-abs(Overlap) < 1.0e-14 )
+      break;
+   };
+  memcpy(w, x->ZV, n*sizeof(cdouble));
+  delete x;
+}
+
+/***************************************************************/
+/* AAA weights for the n support points Support[0..n-1]: the   */
+/* smallest singular vector of the Loewner matrix              */
+/*  L_{(ik),j} = (F_k(z_i)-F_k(z_j)) / (z_i-z_j)               */
+/* (rows = non-support samples i and all functions k).         */
+/***************************************************************/
+static void GetAAAWeights(int NS, double *zS, cdouble *FS, int NK,
+                          double *Scale, int n, int *Support,
+                          bool *IsSupport, cdouble *w)
+{
+  HMatrix *A=new HMatrix(n, n, LHM_COMPLEX);
+  cdouble *LRow = new cdouble[n];
+  for(int i=0; i<NS; i++)
+   { if (IsSupport[i]) continue;
+     for(int k=0; k<NK; k++)
+      { for(int j=0; j<n; j++)
+         { int is=Support[j];
+           LRow[j] = (FS[i*NK+k] - FS[is*NK+k]) / (Scale[k]*(zS[i]-zS[is]));
+         };
+        for(int j=0; j<n; j++)
+         for(int jp=0; jp<n; jp++)
+          A->AddEntry(j, jp, conj(LRow[j])*LRow[jp]);
+      };
+   };
+  delete[] LRow;
+  GetSmallestEigenvector(A, w);
+  delete A;
+}
+
+/***************************************************************/
+/* evaluate the model at all samples (R[i*NK+k]) and return    */
+/* the largest normalized error                                */
+/***************************************************************/
+static double GetAAAError(int NS, double *zS, cdouble *FS, int NK,
+                          double *Scale, int n, int *Support,
+                          cdouble *w, cdouble *R)
+{
+  double *zSupport  = new double[n];
+  cdouble *FSupport = new cdouble[n*NK];
+  for(int j=0; j<n; j++)
+   { zSupport[j]=zS[Support[j]];
+     memcpy(FSupport + j*NK, FS + Support[j]*NK, NK*sizeof(cdouble));
+   };
+  double MaxErr=0.0;
+  for(int i=0; i<NS; i++)
+   { EvaluateModel(n, zSupport, FSupport, w, NK, zS[i], R + i*NK);
+     for(int k=0; k<NK; k++)
+      MaxErr = fmax(MaxErr, abs(FS[i*NK+k]-R[i*NK+k])/Scale[k]);
+   };
+  delete[] zSupport;
+  delete[] FSupport;
+  return MaxErr;
+}
+
+/***************************************************************/
+/* poles of the barycentric model, i.e. the zeros of           */
+/*  D(z) = \sum_j w_j / (z-z_j),                               */
+/* which are the n-1 roots of the polynomial                   */
+/*  q(z) = D(z) * \prod_j (z-z_j).                             */
+/* libhmat has no eigensolver for the usual arrowhead-pencil   */
+/* formulation, so we find the roots by Aberth iteration, with */
+/* q'/q = D'/D + \sum_j 1/(z-z_j) evaluated in barycentric     */
+/* form. roots that run off to infinity (if \sum_j w_j ~ 0 the */
+/* degree of q drops) are discarded. returns the number of     */
+/* poles.                                                      */
+/***************************************************************/
+static int GetAAAPoles(int n, double *zS, int *Support, cdouble *w,
+                       double zMin, double zMax, cdouble *Poles)
+{
+  int m=n-1;
+  double Center=0.5*(zMax+zMin), Radius=0.5*(zMax-zMin);
+  if (Radius==0.0) Radius=1.0;
+
+  // starting points: an irregularly-spaced ring around the band
+  for(int k=0; k<m; k++)
+   { double Theta = 2.0*M_PI*(k+0.25)/m + 0.4;
+     Poles[k] = Center + Radius*cdouble(cos(Theta), sin(Theta));
+   };
+
+  for(int Iter=0; Iter<AAA_MAXABERTHITER; Iter++)
+   { 
+     double MaxStep=0.0;
+     for(int k=0; k<m; k++)
+      { 
+        cdouble z=Poles[k];
+        cdouble D=0.0, dD=0.0, SumS=0.0;
+        bool OnSupport=false;
+        for(int j=0; j<n; j++)
+         { cdouble d = z - zS[Support[j]];
+           if (d==0.0) { OnSupport=true; break; };
+           D    += w[j]/d;
+           dD   -= w[j]/(d*d);
+           SumS += 1.0/d;
+         };
+        if (OnSupport)
+         { Poles[k] += 1.0e-8*Radius*cdouble(1.0,1.0);
+           MaxStep=HUGE_VAL;
+           continue;
+         };
+        if (D==0.0) continue;
+
+        cdouble Ratio = 1.0 / (dD/D + SumS);   // q/q'
+        cdouble SumP=0.0;
+        for(int l=0; l<m; l++)
+         if (l!=k) SumP += 1.0/(z-Poles[l]);
+        cdouble Step = Ratio / (1.0 - Ratio*SumP);
+        if ( !isfinite(real(Step)) || !isfinite(imag(Step)) ) continue;
+        Poles[k] -= Step;
+        MaxStep = fmax(MaxStep, abs(Step));
+      };
+     if (MaxStep < 1.0e-13*Radius)
+      break;
+   };
+
+  int NumPoles=0;
+  for(int k=0; k<m; k++)
+   if ( abs(Poles[k]-Center) < 1.0e6*Radius )
+    Poles[NumPoles++]=Poles[k];
+  return NumPoles;
+}
+
+/***************************************************************/
+/* largest normalized residue of the model at a pole z:        */
+/*  Res_k = N_k(z) / D'(z),  N_k(z) = \sum_j w_j F_jk/(z-z_j)  */
+/***************************************************************/
+static double GetAAAResidue(int n, double *zS, cdouble *FS, int NK,
+                            double *Scale, int *Support, cdouble *w,
+                            cdouble z)
+{
+  cdouble dD=0.0;
+  for(int j=0; j<n; j++)
+   { cdouble d = z - zS[Support[j]];
+     dD -= w[j]/(d*d);
+   };
+
+  double MaxRes=0.0;
+  for(int k=0; k<NK; k++)
+   { cdouble N=0.0;
+     for(int j=0; j<n; j++)
+      N += w[j]*FS[Support[j]*NK + k] / (z - zS[Support[j]]);
+     MaxRes = fmax(MaxRes, abs(N/dD)/Scale[k]);
+   };
+  return MaxRes;
+}
+
+/***************************************************************/
+/* set-valued AAA fit to NK functions sampled at NS points.    */
+/* on return, Support[0..n-1] are the indices of the support   */
+/* points and w[0..n-1] the weights (n is the return value).  */
+/***************************************************************/
+static int AAAFit(int NS, double *zS, cdouble *FS, int NK, double Tol,
+                  int *Support, cdouble *w)
+{
+  /*--------------------------------------------------------------*/
+  /*- normalize each function by its largest sample --------------*/
+  /*--------------------------------------------------------------*/
+  double *Scale = new double[NK];
+  for(int k=0; k<NK; k++)
+   { Scale[k]=0.0;
+     for(int i=0; i<NS; i++)
+      Scale[k] = fmax(Scale[k], abs(FS[i*NK+k]));
+     if (Scale[k]==0.0) Scale[k]=1.0;
+   };
+
+  // current approximation at the sample points: start with the mean
+  cdouble *R = new cdouble[NS*NK];
+  for(int k=0; k<NK; k++)
+   { cdouble Mean=0.0;
+     for(int i=0; i<NS; i++)
+      Mean += FS[i*NK+k];
+     Mean /= (double)NS;
+     for(int i=0; i<NS; i++)
+      R[i*NK+k] = Mean;
+   };
+
+  bool *IsSupport = new bool[NS];
+  for(int i=0; i<NS; i++)
+   IsSupport[i]=false;
+
+  int MaxSupport = (NS>1) ? NS-1 : 1;
+  int n;
+  for(n=1; n<=MaxSupport; n++)
+   {
+     /*--------------------------------------------------------------*/
+     /*- the next support point is the worst-fit sample ------------*/
+     /*--------------------------------------------------------------*/
+     int iMax=-1;
+     double MaxErr=-1.0;
+     for(int i=0; i<NS; i++)
+      { if (IsSupport[i]) continue;
+        double Err=0.0;
+        for(int k=0; k<NK; k++)
+         Err = fmax(Err, abs(FS[i*NK+k]-R[i*NK+k])/Scale[k]);
+        if (Err>MaxErr) { MaxErr=Err; iMax=i; };
+      };
+     Support[n-1]=iMax;
+     IsSupport[iMax]=true;
+
+     /*--------------------------------------------------------------*/
+     /*- recompute weights, update the approximation, and check     -*/
+     /*- convergence                                                -*/
+     /*--------------------------------------------------------------*/
+     GetAAAWeights(NS, zS, FS, NK, Scale, n, Support, IsSupport, w);
+     MaxErr=GetAAAError(NS, zS, FS, NK, Scale, n, Support, w, R);
+     if (MaxErr<=Tol)
+      break;
+   };
+  if (n>MaxSupport) n=MaxSupport;
+
+  /*--------------------------------------------------------------*/
+  /*- remove Froissart doublets: poles of the model with residues -*/
+  /*- so small that they are cancelled by a nearby zero. these    -*/
+  /*- are artifacts of the fit (typically of noise in the         -*/
+  /*- samples), not features of Z; between samples they show up   -*/
+  /*- as narrow spikes. we drop the support point closest to each -*/
+  /*- such pole and recompute the weights once.                   -*/
+  /*--------------------------------------------------------------*/
+  if (n>1)
+   { 
+     double zMin=zS[0], zMax=zS[0];
+     for(int i=1; i<NS; i++)
+      { zMin=fmin(zMin, zS[i]); zMax=fmax(zMax, zS[i]); };
+
+     cdouble *Poles = new cdouble[n];
+     int NumPoles=GetAAAPoles(n, zS, Support, w, zMin, zMax, Poles);
+
+     int NumRemoved=0;
+     for(int np=0; np<NumPoles; np++)
+      { double Residue=GetAAAResidue(n, zS, FS, NK, Scale, Support, w, Poles[np]);
+        if ( Residue >= AAA_CLEANUPTOL*(zMax-zMin) )
+         continue;
+
+        int jNearest=-1;
+        double MinDist=HUGE_VAL;
+        for(int j=0; j<n; j++)
+         if ( IsSupport[Support[j]] && abs(Poles[np]-zS[Support[j]])<MinDist )
+          { MinDist=abs(Poles[np]-zS[Support[j]]);
+            jNearest=j;
+          };
+        if (jNearest!=-1 && NumRemoved<n-1)
+         { IsSupport[Support[jNearest]]=false;
+           NumRemoved++;
+         };
+      };
+     delete[] Poles;
+
+     if (NumRemoved>0)
+      { Log("ROM: removing %i Froissart doublet%s from AAA fit",
+             NumRemoved, NumRemoved==1 ? "" : "s");
+        int nNew=0;
+        for(int j=0; j<n; j++)
+         if (IsSupport[Support[j]])
+          Support[nNew++]=Support[j];
+        n=nNew;
+        GetAAAWeights(NS, zS, FS, NK, Scale, n, Support, IsSupport, w);
+      };
+   };
+
+  delete[] IsSupport;
+  delete[] R;
+  delete[] Scale;
+
+  return n;
+}
+
+/***************************************************************/
+/* Compute Z-matrices at all frequencies in FreqList using an  */
+/* adaptively-sampled rational model. ZMatrices[nf] must be    */
+/* NumPorts x NumPorts complex matrices; on return ErrEst[nf]  */
+/* is the estimated relative error of ZMatrices[nf]. The       */
+/* return value is the number of exact (BEM) samples used.     */
+/***************************************************************/
+int GetZParametersROM(ZSampler Sampler, void *UserData, int NumPorts,
+                      HVector *FreqList, double RelTol, int MaxSamples,
+                      HMatrix **ZMatrices, double *ErrEst)
+{
+  int NF = FreqList->N;
+  int NK = NumPorts*NumPorts;
+  if (MaxSamples>NF) MaxSamples=NF;
+  if (MaxSamples<1)  MaxSamples=1;
+
+  double *Freqs = new double[NF];
+  for(int nf=0; nf<NF; nf++)
+   Freqs[nf]=FreqList->GetEntryD(nf);
+
+  // data on sampled frequencies
+  int NS=0;
+  int *SampleIndex = new int[MaxSamples];
+  double *zS       = new double[MaxSamples];
+  cdouble *FS      = new cdouble[MaxSamples*NK];
+  bool *IsSampled  = new bool[NF];
+  for(int nf=0; nf<NF; nf++)
+   IsSampled[nf]=false;
+
+  // current and previous models
+  int *Support      = new int[MaxSamples];
+  cdouble *w        = new cdouble[MaxSamples];
+  double *zSupport  = new double[MaxSamples];
+  cdouble *FSupport = new cdouble[MaxSamples*NK];
+  int nPrev=0;
+  cdouble *wPrev        = new cdouble[MaxSamples];
+  double *zSupportPrev  = new double[MaxSamples];
+  cdouble *FSupportPrev = new cdouble[MaxSamples*NK];
+  cdouble *r1    = new cdouble[NK];
+  cdouble *r2    = new cdouble[NK];
+
+  /*--------------------------------------------------------------*/
+  /*- initial samples: endpoints and midpoint of the sweep       -*/
+  /*--------------------------------------------------------------*/
+  int NewSamples[3] = {0, NF-1, (NF-1)/2};
+  int NumNew = (NF<3) ? NF : 3;
+  if (NumNew>MaxSamples) NumNew=MaxSamples;
+
+  int n=0;
+  double MaxErrEst=0.0;
+  for(;;)
+   {
+     /*--------------------------------------------------------------*/
+     /*- exact BEM solutions at the new sample frequencies ---------*/
+     /*--------------------------------------------------------------*/
+     for(int nn=0; nn<NumNew; nn++)
+      { int nf=NewSamples[nn];
+        if (IsSampled[nf]) continue;
+        Log("ROM: exact sample %i at f=%g GHz",NS+1,Freqs[nf]);
+        Sampler(UserData, Freqs[nf], ZMatrices[nf]);
+        IsSampled[nf]=true;
+        SampleIndex[NS]=nf;
+        zS[NS]=Freqs[nf];
+        for(int np=0; np<NumPorts; np++)
+         for(int npp=0; npp<NumPorts; npp++)
+          FS[NS*NK + np*NumPorts + npp] = ZMatrices[nf]->GetEntry(np,npp);
+        NS++;
+      };
+     for(int nf=0; nf<NF; nf++)
+      ErrEst[nf]=0.0;
+     if (NS==NF)
+      { n=0;
+        break;
+      };
+
+     /*--------------------------------------------------------------*/
+     /*- fit the model and estimate errors at unsampled frequencies -*/
+     /*--------------------------------------------------------------*/
+     if (n>0)
+      { nPrev=n;
+        memcpy(wPrev, w, n*sizeof(cdouble));
+        memcpy(zSupportPrev, zSupport, n*sizeof(double));
+        memcpy(FSupportPrev, FSupport, n*NK*sizeof(cdouble));
+      };
+     n=AAAFit(NS, zS, FS, NK, 1.0e-3*RelTol, Support, w);
+     for(int j=0; j<n; j++)
+      { zSupport[j]=zS[Support[j]];
+        memcpy(FSupport + j*NK, FS + Support[j]*NK, NK*sizeof(cdouble));
+      };
+
+     double ZScale=0.0;
+     for(int m=0; m<NS*NK; m++)
+      ZScale=fmax(ZScale, abs(FS[m]));
+     if (ZScale==0.0) ZScale=1.0;
+
+     // on the first pass there is no previous model to compare
+     // against, so we just add the sweep point farthest from the
+     // existing samples
+     int nfMax=-1;
+     MaxErrEst=0.0;
+     for(int nf=0; nf<NF; nf++)
+      { if (IsSampled[nf]) continue;
+        double Err=0.0;
+        if (nPrev==0)
+         { Err=HUGE_VAL;
+           for(int ns=0; ns<NS; ns++)
+            Err=fmin(Err, fabs(Freqs[nf]-zS[ns]));
+         }
+        else
+         { EvaluateModel(n,     zSupport,     FSupport,     w,     NK, Freqs[nf], r1);
+           EvaluateModel(nPrev, zSupportPrev, FSupportPrev, wPrev, NK, Freqs[nf], r2);
+           for(int k=0; k<NK; k++)
+            Err=fmax(Err, abs(r1[k]-r2[k])/ZScale);
+           ErrEst[nf]=Err;
+         };
+        if (Err>MaxErrEst) { MaxErrEst=Err; nfMax=nf; };
+      };
+     if (nPrev==0)
+      { MaxErrEst=HUGE_VAL;
+        Log("ROM: %i samples, %i support points",NS,n);
+      }
+     else
+      Log("ROM: %i samples, %i support points, max estimated error %e",NS,n,MaxErrEst);
+
+     if ( MaxErrEst<RelTol || nfMax==-1 )
+      break;
+     if ( NS==MaxSamples )
+      { Warn("reduced-order model unconverged after %i samples (estimated error %e)",NS,MaxErrEst);
+        break;
+      };
+     NewSamples[0]=nfMax;
+     NumNew=1;
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- evaluate the model at all unsampled frequencies -----------*/
+  /*--------------------------------------------------------------*/
+  if (n>0)
+   for(int nf=0; nf<NF; nf++)
+    { if (IsSampled[nf]) continue;
+      EvaluateModel(n, zSupport, FSupport, w, NK, Freqs[nf], r1);
+      for(int np=0; np<NumPorts; np++)
+       for(int npp=0; npp<NumPorts; npp++)
+        ZMatrices[nf]->SetEntry(np, npp, r1[np*NumPorts + npp]);
+    };
+
+  delete[] r2;
+  delete[] r1;
+  delete[] FSupportPrev;
+  delete[] zSupportPrev;
+  delete[] wPrev;
+  delete[] FSupport;
+  delete[] zSupport;
+  delete[] w;
+  delete[] Support;
+  delete[] IsSampled;
+  delete[] FS;
+  delete[] zS;
+  delete[] SampleIndex;
+  delete[] Freqs;
+
+  return NS;
+}
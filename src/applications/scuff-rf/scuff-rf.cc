@@ -71,6 +71,76 @@ void HVConcat(HVector *V1, HVector *V2)
 
 }
 
+/***************************************************************/
+/* exact Z-matrix at a single frequency, for use as the sample */
+/* function of the reduced-order model (RationalModel.cc)      */
+/***************************************************************/
+typedef struct ZSamplerData
+ { RWGGeometry *G;
+   HMatrix *M;
+   RWGPort **Ports;
+   int NumPorts;
+   PortVoltageFunctionals *PVF;
+   HMatrix *KNMatrix, *VMatrix;
+   char *WriteCache;
+ } ZSamplerData;
+
+void GetExactZMatrix(void *UserData, double Freq, HMatrix *ZMatrix)
+{
+  ZSamplerData *ZSD=(ZSamplerData *)UserData;
+  RWGGeometry *G=ZSD->G;
+  HMatrix *M=ZSD->M;
+  int NumPorts=ZSD->NumPorts;
+
+  cdouble Omega=FREQ2OMEGA * Freq;
+  Log("Assembling BEM matrix at f=%g GHz...",Freq);
+  G->AssembleBEMMatrix(Omega, M);
+  Log("Factorizing...");
+  M->LUFactorize();
+
+  if (ZSD->WriteCache)
+   { StoreCache( ZSD->WriteCache );
+     ZSD->WriteCache=0;
+   };
+
+  Log(" Computing port-voltage functionals");
+  ZSD->PVF=GetPortVoltageFunctionals(G, ZSD->Ports, NumPorts, Omega, ZSD->PVF);
+
+  ZSD->KNMatrix=GetPortRHSMatrix(G, ZSD->Ports, NumPorts, Omega, ZSD->KNMatrix);
+  M->LUSolve(ZSD->KNMatrix);
+  ZSD->VMatrix=GetPortVoltages(ZSD->PVF, ZSD->KNMatrix, ZSD->VMatrix);
+
+  // see the note on the sign convention in main()
+  for(int np=0; np<NumPorts; np++)
+   for(int npp=0; npp<NumPorts; npp++)
+    ZMatrix->SetEntry(np, npp, conj(ZSD->VMatrix->GetEntry(npp,np)));
+}
+
+/***************************************************************/
+/* write dipole moments, surface currents, and panel source    */
+/* densities for the surface-current vector KN (--Moments)     */
+/***************************************************************/
+void WriteMomentData(RWGGeometry *G, cdouble Omega, double Freq, HVector *KN,
+                     RWGPort **Ports, int NumPorts, cdouble *PortCurrents,
+                     HVector *PM, HMatrix *PSD, FILE *MomentFile,
+                     const char *Label, const char *FileTag)
+{
+  G->GetDipoleMoments(Omega, KN, PM);
+  SetDefaultCD2SFormat("%+.6e %+.6e");
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   fprintf(MomentFile,"%e %i %s %s %s %s %s %s %s %s \n",
+                       real(Omega),G->TotalPanels,Label,G->Surfaces[ns]->Label,
+                       CD2S(PM->GetEntry(6*ns+0)), CD2S(PM->GetEntry(6*ns+1)), CD2S(PM->GetEntry(6*ns+2)),
+                       CD2S(PM->GetEntry(6*ns+3)), CD2S(PM->GetEntry(6*ns+4)), CD2S(PM->GetEntry(6*ns+5)));
+  G->PlotSurfaceCurrents(KN, Omega, "%s_%s.pp",GetFileBase(G->GeoFileName),FileTag);
+
+  char PSDFileName[1000];
+  G->GetPanelSourceDensities(Omega, KN, PSD);
+  AddPortContributionsToPSD(G, Ports, NumPorts, PortCurrents, Omega, PSD);
+  snprintf(PSDFileName,1000,"%s.%g.%s.PSD",GetFileBase(G->GeoFileName),Freq,FileTag);
+  PSD->ExportToText(PSDFileName,"--separate");
+}
+
 /***************************************************************/
 /* main function   *********************************************/
 /***************************************************************/  
@@ -96,7 +166,11 @@ int main(int argc, char *argv[])
   char *Cache=0;
   char *ReadCache[MAXCACHE];         int nReadCache;
   char *WriteCache=0;
+  char *SnapshotDir=0;
   char *ContribOnly=0;
+  int ROM=0;
+  double ROMTol=1.0e-4;
+  int ROMMaxSamples=30;
   /* name               type    #args  max_instances  storage           count         description*/
   OptStruct OSArray[]=
    { {"geometry",       PA_STRING,  1, 1,       (void *)&GeoFile,    0,             "geometry file"},
@@ -114,6 +188,10 @@ int main(int argc, char *argv[])
      {"ZParameters",    PA_BOOL,    0, 1,       (void *)&ZParameters, 0,            "output z parameters"},
      {"SParameters",    PA_BOOL,    0, 1,       (void *)&SParameters, 0,            "output s parameters"},
      {"Moments",        PA_BOOL,    0, 1,       (void *)&Moments,     0,            "output dipole moments"},
+//
+     {"ROM",            PA_BOOL,    0, 1,       (void *)&ROM,           0,          "use a reduced-order model for Z/S-parameter sweeps"},
+     {"ROMTol",         PA_DOUBLE,  1, 1,       (void *)&ROMTol,        0,          "relative error tolerance for --ROM"},
+     {"ROMMaxSamples",  PA_INT,     1, 1,       (void *)&ROMMaxSamples, 0,          "maximum number of exact frequency samples for --ROM"},
 //
      {"portcurrentfile", PA_STRING,  1, 1,      (void *)&PCFile,     0,             "port current file"},
      {"EPFile",         PA_STRING,  1, 1,       (void *)&EPFile,     0,             "list of evaluation points"},
@@ -121,6 +199,7 @@ int main(int argc, char *argv[])
      {"Cache",          PA_STRING,  1, 1,       (void *)&Cache,      0,             "read/write cache"},
      {"ReadCache",      PA_STRING,  1, MAXCACHE,(void *)ReadCache,   &nReadCache,   "read cache"},
      {"WriteCache",     PA_STRING,  1, 1,       (void *)&WriteCache, 0,             "write cache"},
+     {"SnapshotDir",    PA_STRING,  1, 1,       (void *)&SnapshotDir, 0,             "directory for cached geometry snapshots"},
 //
      {"WriteLogFile",   PA_BOOL,    0, 1,       (void *)&WriteLogFile, 0,           "write new log file"},
 //
@@ -129,6 +208,8 @@ int main(int argc, char *argv[])
      {0,0,0,0,0,0,0}
    };
   ProcessOptions(argc, argv, OSArray);
+  if (SnapshotDir)
+   RWGGeometry::SetSnapshotDir(SnapshotDir);
 
   /***************************************************************/
   /* create the log file *****************************************/
@@ -237,6 +318,8 @@ int main(int argc, char *argv[])
    OSUsage(argv[0],OSArray,"--zparameters and --sparameters may not be used with --portcurrentfile");
   if (PCList!=0 && EPFile==0)
    OSUsage(argv[0],OSArray,"--EPFile must be specified if --portcurrentfile is specified");
+  if (ROM && (Moments || PCFile || EPFile) )
+   ErrExit("--ROM may not be combined with --Moments, --portcurrentfile, or --EPFile");
 
   /***************************************************************/
   /* create output files *****************************************/
@@ -269,6 +352,9 @@ int main(int argc, char *argv[])
                    2*NumPorts*NumPorts, 2*NumPorts*NumPorts+1, 
                    NumPorts+1,NumPorts+1);
       };
+     if (ROM)
+      fprintf(ZParFile,"# %i estimated relative error of reduced-order model (0 = exact sample)\n",
+                 2*NumPorts*NumPorts+2);
 
      ZMatrix=new HMatrix(NumPorts, NumPorts, LHM_COMPLEX);
    };
@@ -296,6 +382,9 @@ int main(int argc, char *argv[])
                    2*NumPorts*NumPorts,2*NumPorts*NumPorts+1, 
                    NumPorts+1,NumPorts+1);
       };
+     if (ROM)
+      fprintf(SParFile,"# %i estimated relative error of reduced-order model (0 = exact sample)\n",
+                 2*NumPorts*NumPorts+2);
 
      SMatrix=new HMatrix(NumPorts, NumPorts, LHM_COMPLEX);
      if (ZMatrix==0) //ZMatrix is needed if s-parameters are computed
@@ -307,7 +396,6 @@ int main(int argc, char *argv[])
   /*******************************************************************/
   HVector *PM=0;
   FILE *MomentFile=0;
-  char PSDFileName[1000];
   HMatrix *PSD=0;
   if (Moments)
    { PM=new HVector(6*G->NumSurfaces, LHM_COMPLEX);
@@ -338,8 +426,67 @@ int main(int argc, char *argv[])
   double Freq; 
   cdouble Omega;
   cdouble *PortCurrents=new cdouble[NumPorts]; 
-  cdouble *PortVoltages=new cdouble[NumPorts];
-  for (nf=0, Freq=FreqList->GetEntryD(0); nf<FreqList->N; Freq=FreqList->GetEntryD(++nf) )
+  PortVoltageFunctionals *PVF=0;
+  HMatrix *KNMatrix=0, *VMatrix=0, *RHSMatrix=0;
+
+  /*--------------------------------------------------------------*/
+  /*- with --ROM, we solve the BEM problem at a few frequencies  -*/
+  /*- and fill in the rest of the sweep from a rational model    -*/
+  /*--------------------------------------------------------------*/
+  int NumLoopFreqs = FreqList->N;
+  if (ROM)
+   { 
+     ZSamplerData MyZSD, *ZSD=&MyZSD;
+     ZSD->G            = G;
+     ZSD->M            = M;
+     ZSD->Ports        = Ports;
+     ZSD->NumPorts     = NumPorts;
+     ZSD->PVF          = 0;
+     ZSD->KNMatrix     = 0;
+     ZSD->VMatrix      = 0;
+     ZSD->WriteCache   = WriteCache;
+
+     HMatrix **ZMatrices = new HMatrix *[FreqList->N];
+     for(nf=0; nf<FreqList->N; nf++)
+      ZMatrices[nf]=new HMatrix(NumPorts, NumPorts, LHM_COMPLEX);
+     double *ErrEst = new double[FreqList->N];
+
+     int NumSamples=GetZParametersROM(GetExactZMatrix, (void *)ZSD, NumPorts,
+                                      FreqList, ROMTol, ROMMaxSamples,
+                                      ZMatrices, ErrEst);
+     Log("Reduced-order model: %i exact samples for %i frequencies",NumSamples,FreqList->N);
+
+     for(nf=0; nf<FreqList->N; nf++)
+      { 
+        Freq=FreqList->GetEntryD(nf);
+        if (ZParameters)
+         { fprintf(ZParFile,"%e ",Freq);
+           for(np=0; np<NumPorts; np++)
+            for(npp=0; npp<NumPorts; npp++)
+             fprintf(ZParFile,"%e %e ",real(ZMatrices[nf]->GetEntry(np,npp)),
+                                       imag(ZMatrices[nf]->GetEntry(np,npp)));
+           fprintf(ZParFile,"%e\n",ErrEst[nf]);
+         };
+        if (SParameters)
+         { ZToS(ZMatrices[nf], SMatrix);
+           fprintf(SParFile,"%e ",Freq);
+           for(np=0; np<NumPorts; np++)
+            for(npp=0; npp<NumPorts; npp++)
+             fprintf(SParFile,"%e %e ",real(SMatrix->GetEntry(np,npp)), imag(SMatrix->GetEntry(np,npp)));
+           fprintf(SParFile,"%e\n",ErrEst[nf]);
+         };
+        delete ZMatrices[nf];
+      };
+
+     delete[] ErrEst;
+     delete[] ZMatrices;
+     DestroyPortVoltageFunctionals(ZSD->PVF);
+     if (ZSD->KNMatrix) delete ZSD->KNMatrix;
+     if (ZSD->VMatrix) delete ZSD->VMatrix;
+     NumLoopFreqs=0;
+   };
+
+  for (nf=0, Freq=FreqList->GetEntryD(0); nf<NumLoopFreqs; Freq=FreqList->GetEntryD(++nf) )
    { 
       /*--------------------------------------------------------------*/
       /* assemble and factorize the BEM matrix at this frequency      */
@@ -363,72 +510,55 @@ int main(int argc, char *argv[])
       /* the rows of the Z-matrix at this frequency                   */
       /*--------------------------------------------------------------*/
       if (ZParameters || SParameters)
-       { for(np=0; np<NumPorts; np++)
-          { 
-            Log(" Computing row %i of the impedance matrix:",np+1);
-
-            Log("  assembling RHS vector");
-            memset(PortCurrents, 0, NumPorts*sizeof(cdouble));
-            PortCurrents[np]=1.0;
-            KN->Zero();
-            AddPortContributionsToRHS(G, Ports, NumPorts, PortCurrents, Omega, KN);
-
-            /*--------------------------------------------------------------*/
-            /*--------------------------------------------------------------*/
-            /*--------------------------------------------------------------*/
-            if (Moments)
-             { G->GetDipoleMoments(Omega, KN, PM);
-               SetDefaultCD2SFormat("%+.6e %+.6e");
-               for(int ns=0; ns<G->NumSurfaces; ns++)
-                fprintf(MomentFile,"%e %i BEFORE %s %s %s %s %s %s %s \n",
-                                    real(Omega),G->TotalPanels,G->Surfaces[ns]->Label,
-                                    CD2S(PM->GetEntry(6*ns+0)), CD2S(PM->GetEntry(6*ns+1)), CD2S(PM->GetEntry(6*ns+2)),
-                                    CD2S(PM->GetEntry(6*ns+3)), CD2S(PM->GetEntry(6*ns+4)), CD2S(PM->GetEntry(6*ns+5)));
-               G->PlotSurfaceCurrents(KN, Omega, "%s_Before.pp",GetFileBase(G->GeoFileName));
-
-               G->GetPanelSourceDensities(Omega, KN, PSD);
-               AddPortContributionsToPSD(G, Ports, NumPorts, PortCurrents, Omega, PSD);
-               sprintf(PSDFileName,"%s.%g.Before.PSD",GetFileBase(G->GeoFileName),Freq);
-               PSD->ExportToText(PSDFileName,"--separate");
-             };
-                
-            /*--------------------------------------------------------------*/
-            /*--------------------------------------------------------------*/
-            /*--------------------------------------------------------------*/
-            Log("  solving the BEM system");
-            M->LUSolve(KN);
-
-            /*--------------------------------------------------------------*/
-            /*--------------------------------------------------------------*/
-            /*--------------------------------------------------------------*/
-            if (Moments)
-             { G->GetDipoleMoments(Omega, KN, PM);
-               SetDefaultCD2SFormat("%+.6e %+.6e");
-               for(int ns=0; ns<G->NumSurfaces; ns++)
-                fprintf(MomentFile,"%e %i AFTER %s %s %s %s %s %s %s \n",
-                                    real(Omega),G->TotalPanels,G->Surfaces[ns]->Label,
-                                    CD2S(PM->GetEntry(6*ns+0)), CD2S(PM->GetEntry(6*ns+1)), CD2S(PM->GetEntry(6*ns+2)),
-                                    CD2S(PM->GetEntry(6*ns+3)), CD2S(PM->GetEntry(6*ns+4)), CD2S(PM->GetEntry(6*ns+5)));
-               G->PlotSurfaceCurrents(KN, Omega, "%s_After.pp",GetFileBase(G->GeoFileName));
-
-               G->GetPanelSourceDensities(Omega, KN, PSD);
-               AddPortContributionsToPSD(G, Ports, NumPorts, PortCurrents, Omega, PSD);
-               sprintf(PSDFileName,"%s.%g.After.PSD",GetFileBase(G->GeoFileName),Freq);
-               PSD->ExportToText(PSDFileName,"--separate");
-             };
-
-            Log("  computing port voltages");
-            GetPortVoltages(G, KN, Ports, NumPorts, PortCurrents, Omega, PortVoltages);
-
-            /* note: the entry in the Z-matrix is the complex conjugate */
-            /* of the measured port voltage, because the Z-matrix is    */
-            /* defined using the usual circuit theory convention in     */
-            /* which all quantities have time dependence exp(+iwt),     */
-            /* whereas scuff-EM uses the opposite sign convention.      */
-            for(npp=0; npp<NumPorts; npp++)
-             ZMatrix->SetEntry(np, npp, conj(PortVoltages[npp]));
+       { 
+         Log(" Computing port-voltage functionals");
+         PVF=GetPortVoltageFunctionals(G, Ports, NumPorts, Omega, PVF);
+
+         /*--------------------------------------------------------------*/
+         /*- column #np of KNMatrix is the RHS vector for a unit current */
+         /*- at port #np; all columns are solved with a single call to   */
+         /*- LUSolve and all port voltages obtained in a single pass     */
+         /*--------------------------------------------------------------*/
+         Log(" Assembling RHS vectors for %i ports",NumPorts);
+         KNMatrix=GetPortRHSMatrix(G, Ports, NumPorts, Omega, KNMatrix);
+         if (Moments)
+          { if (!RHSMatrix) 
+             RHSMatrix=new HMatrix(KNMatrix);
+            else
+             RHSMatrix->Copy(KNMatrix);
           };
 
+         Log(" Solving the BEM system for %i ports",NumPorts);
+         M->LUSolve(KNMatrix);
+
+         Log(" Computing port voltages");
+         VMatrix=GetPortVoltages(PVF, KNMatrix, VMatrix);
+
+         /* note: the entry in the Z-matrix is the complex conjugate */
+         /* of the measured port voltage, because the Z-matrix is    */
+         /* defined using the usual circuit theory convention in     */
+         /* which all quantities have time dependence exp(+iwt),     */
+         /* whereas scuff-EM uses the opposite sign convention.      */
+         for(np=0; np<NumPorts; np++)
+          for(npp=0; npp<NumPorts; npp++)
+           ZMatrix->SetEntry(np, npp, conj(VMatrix->GetEntry(npp,np)));
+
+         /*--------------------------------------------------------------*/
+         /*- dipole moments and source densities before and after the   -*/
+         /*- solve, one port at a time                                   -*/
+         /*--------------------------------------------------------------*/
+         if (Moments)
+          for(np=0; np<NumPorts; np++)
+           { memset(PortCurrents, 0, NumPorts*sizeof(cdouble));
+             PortCurrents[np]=1.0;
+             memcpy(KN->ZV, RHSMatrix->ZM + ((size_t)np)*KN->N, KN->N*sizeof(cdouble));
+             WriteMomentData(G, Omega, Freq, KN, Ports, NumPorts, PortCurrents,
+                             PM, PSD, MomentFile, "BEFORE", "Before");
+             memcpy(KN->ZV, KNMatrix->ZM + ((size_t)np)*KN->N, KN->N*sizeof(cdouble));
+             WriteMomentData(G, Omega, Freq, KN, Ports, NumPorts, PortCurrents,
+                             PM, PSD, MomentFile, "AFTER", "After");
+           };
+
          /*--------------------------------------------------------------*/
          /*- write Z parameters to output file if that was requested    -*/
          /*--------------------------------------------------------------*/
@@ -488,6 +618,11 @@ int main(int argc, char *argv[])
   /***************************************************************/
   /***************************************************************/
   /***************************************************************/
+  if (PVF)
+   DestroyPortVoltageFunctionals(PVF);
+  if (KNMatrix) delete KNMatrix;
+  if (VMatrix) delete VMatrix;
+  if (RHSMatrix) delete RHSMatrix;
   if (ZParameters)
    { fclose(ZParFile);
      printf("Z-parameters vs. frequency written to file %s\n",ZParFileName);
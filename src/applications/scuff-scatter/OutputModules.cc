@@ -26,6 +26,7 @@
 #include <stdarg.h>
 
 #include <libSGJC.h>
+#include <config.h>
 
 #include "scuff-scatter.h"
 
@@ -119,6 +120,82 @@ void ProcessEPFile(SSData *SSD, char *EPFileName)
 
 }
 
+/***************************************************************/
+/* evaluate fields on each of the planar grids described in a  */
+/* field-grid file (see the description of --FieldGrid in      */
+/* scuff-scatter.cc). each grid goes through the streaming     */
+/* GetFieldsGridsToFile() routine, so its size is limited only */
+/* by disk space.                                              */
+/***************************************************************/
+void ProcessFieldGridFile(SSData *SSD, char *FGFileName, char *GridFuncs,
+                          bool Resume)
+{
+  RWGGeometry *G  = SSD->G;
+  if (G->LDim!=0)
+   { Warn("--FieldGrid is not supported for periodic geometries (skipping)");
+     return;
+   };
+
+  FILE *f=fopen(FGFileName,"r");
+  if (!f)
+   { Warn("could not open field-grid file %s (skipping)",FGFileName);
+     return;
+   };
+
+  if (GridFuncs==0)
+   GridFuncs=const_cast<char *>("Ex,Ey,Ez,Hx,Hy,Hz");
+
+#ifdef HAVE_HDF5
+  const char *Extension="h5";
+#else
+  const char *Extension="bin";
+#endif
+
+  char Line[MAXSTR];
+  int LineNum=0, NumGrids=0;
+  while( fgets(Line, MAXSTR, f) )
+   { 
+     LineNum++;
+     char *Tokens[20];
+     int NumTokens=Tokenize(Line, Tokens, 20);
+     if ( NumTokens==0 || Tokens[0][0]=='#' )
+      continue;
+
+     double Center[3], L1, L2;
+     int N1, N2;
+     CartesianDirection Normal;
+     if      ( !StrCaseCmp(Tokens[0],"X") ) Normal=XDIR;
+     else if ( !StrCaseCmp(Tokens[0],"Y") ) Normal=YDIR;
+     else if ( !StrCaseCmp(Tokens[0],"Z") ) Normal=ZDIR;
+     else
+      ErrExit("%s:%i: unknown grid normal %s",FGFileName,LineNum,Tokens[0]);
+     if (    NumTokens!=8
+          || 1!=sscanf(Tokens[1],"%le",Center+0)
+          || 1!=sscanf(Tokens[2],"%le",Center+1)
+          || 1!=sscanf(Tokens[3],"%le",Center+2)
+          || 1!=sscanf(Tokens[4],"%le",&L1)
+          || 1!=sscanf(Tokens[5],"%le",&L2)
+          || 1!=sscanf(Tokens[6],"%i",&N1)
+          || 1!=sscanf(Tokens[7],"%i",&N2)
+          || N1<=0 || N2<=0
+        ) 
+      ErrExit("%s:%i: syntax error",FGFileName,LineNum);
+
+     PlaneGrid Grid(N1, N2, Center, L1, L2, Normal);
+
+     char OutFileName[MAXSTR];
+     snprintf(OutFileName,MAXSTR,"%s.%s.%i.%s",
+              GetFileBase(FGFileName),z2s(SSD->Omega),NumGrids,Extension);
+     Log("Evaluating %ix%i field grid %i of %s (output to %s)...",
+          N1,N2,NumGrids,FGFileName,OutFileName);
+     G->GetFieldsGridsToFile(Grid, GridFuncs, SSD->Omega, SSD->KN, SSD->IF,
+                             OutFileName, 0, Resume);
+     NumGrids++;
+   };
+  fclose(f);
+
+}
+
 /***************************************************************/
 /***************************************************************/
 /***************************************************************/
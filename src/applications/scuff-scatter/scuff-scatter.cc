@@ -104,6 +104,28 @@
  * 
  *         (Note that --epfile may be specified more than once.)
  * 
+ *     --FieldGrid MyGridFile
+ * 
+ *         a file describing one or more planar grids of evaluation
+ *         points. each line of MyGridFile (other than blank lines and
+ *         comments) has the form
+ * 
+ *           X|Y|Z  cx cy cz  L1 L2  N1 N2
+ * 
+ *         describing an N1xN2 grid of points, of dimensions L1xL2,
+ *         centered at (cx,cy,cz) and normal to the given cartesian
+ *         direction. the grid is evaluated in tiles of rows and
+ *         written tile by tile (so arbitrarily large grids may be
+ *         computed in fixed memory) to MyGridFile.omega.n.h5 (or
+ *         .bin if scuff-em was compiled without HDF5), where n is
+ *         the index of the grid in the file. 
+ * 
+ *         By default the six cartesian components of the total
+ *         E and H fields are written; use --GridFuncs "expr1,expr2"
+ *         to write other functions of the fields (see FieldGrid.h).
+ *         use --ResumeGrids to skip tiles that were written by an
+ *         earlier, interrupted run.
+ * 
  *     --PFTFile MyPFTFile
  * 
  *        Requests that the power, force, and torque delivered to 
@@ -210,6 +232,7 @@
 #define MAXPS    10    // max number of point sources
 #define MAXFREQ  10    // max number of frequencies 
 #define MAXEPF   10    // max number of evaluation-point files
+#define MAXFG    10    // max number of field-grid files
 #define MAXFM    10    // max number of flux meshes
 #define MAXCACHE 10    // max number of cache files for preload
 
@@ -237,6 +260,9 @@ int main(int argc, char *argv[])
   cdouble OmegaVals[MAXFREQ];        int nOmegaVals;
   char *OmegaFile;                   int nOmegaFiles;
   char *EPFiles[MAXEPF];             int nEPFiles;
+  char *FGFiles[MAXFG];              int nFGFiles;
+  char *GridFuncs=0;
+  int ResumeGrids=0;
   char *PFTFile=0;
   char *SIPFTFile=0;
   double SIRadius = 100.0;
@@ -247,9 +273,11 @@ int main(int argc, char *argv[])
   int PlotSurfaceCurrents=0;
   int nThread=0;
   int ExportMatrix=0;
+  double FieldTreecode=0.0;
   char *Cache=0;
   char *ReadCache[MAXCACHE];         int nReadCache;
   char *WriteCache=0;
+  char *SnapshotDir=0;
   /* name               type    #args  max_instances  storage           count         description*/
   OptStruct OSArray[]=
    { 
@@ -270,6 +298,9 @@ int main(int argc, char *argv[])
      {"psStrength",     PA_CDOUBLE, 3, MAXPS,   (void *)psStrength,  &npsStrength,  "point source strength"},
 /**/
      {"EPFile",         PA_STRING,  1, MAXEPF,  (void *)EPFiles,     &nEPFiles,     "list of evaluation points"},
+     {"FieldGrid",      PA_STRING,  1, MAXFG,   (void *)FGFiles,     &nFGFiles,     "list of field-evaluation grids"},
+     {"GridFuncs",      PA_STRING,  1, 1,       (void *)&GridFuncs,  0,             "functions of the fields to evaluate on grids"},
+     {"ResumeGrids",    PA_BOOL,    0, 1,       (void *)&ResumeGrids, 0,            "skip grid tiles written by an earlier run"},
      {"FluxMesh",       PA_STRING,  1, MAXFM,   (void *)FluxMeshes,  &nFluxMeshes,  "flux mesh"},
 /**/
      {"PFTFile",        PA_STRING,  1, 1,       (void *)&PFTFile,    0,             "name of power/force/torque output file"},
@@ -284,13 +315,17 @@ int main(int argc, char *argv[])
      {"Cache",          PA_STRING,  1, 1,       (void *)&Cache,      0,             "read/write cache"},
      {"ReadCache",      PA_STRING,  1, MAXCACHE,(void *)ReadCache,   &nReadCache,   "read cache"},
      {"WriteCache",     PA_STRING,  1, 1,       (void *)&WriteCache, 0,             "write cache"},
+     {"SnapshotDir",    PA_STRING,  1, 1,       (void *)&SnapshotDir, 0,             "directory for cached geometry snapshots"},
 /**/
      {"nThread",        PA_INT,     1, 1,       (void *)&nThread,    0,             "number of CPU threads to use"},
      {"ExportMatrix",   PA_BOOL,    0, 1,       (void *)&ExportMatrix, 0,           "export BEM matrix to file"},
+     {"FieldTreecode",  PA_DOUBLE,  1, 1,       (void *)&FieldTreecode, 0,          "relative accuracy of treecode scattered-field evaluation"},
 /**/
      {0,0,0,0,0,0,0}
    };
   ProcessOptions(argc, argv, OSArray);
+  if (SnapshotDir)
+   RWGGeometry::SetSnapshotDir(SnapshotDir);
 
   if (GeoFile==0)
    OSUsage(argv[0], OSArray, "--geometry option is mandatory");
@@ -368,6 +403,7 @@ int main(int argc, char *argv[])
                              || PFTFile!=0 
                              || SIPFTFile!=0 
                              || nEPFiles>0 
+                             || nFGFiles>0 
                              || nFluxMeshes>0 
                              || PlotSurfaceCurrents
                            );
@@ -380,6 +416,9 @@ int main(int argc, char *argv[])
   SetLogFileName("scuff-scatter.log");
   Log("scuff-scatter running on %s",GetHostName());
 
+  if (FieldTreecode>0.0)
+   RWGGeometry::TreecodeTolerance=FieldTreecode;
+
   /*******************************************************************/
   /* create the SSData structure containing everything we need to    */
   /* execute scattering calculations                                 */
@@ -388,7 +427,20 @@ int main(int argc, char *argv[])
 
   RWGGeometry *G = SSD->G = new RWGGeometry(GeoFile);
   G->SetLogLevel(SCUFF_VERBOSELOGGING);
-  HMatrix *M = SSD->M =G->AllocateBEMMatrix();
+  // for symmetric geometries we work with the symmetry-reduced
+  // blocks of the BEM matrix instead of the full matrix
+  HMatrix *M=0, **MBlocks=0;
+  int NumMBlocks=0;
+  bool MirrorBlocks=false;
+  if ( (NumMBlocks=G->GetNumSymmetryBlocks()) > 0 )
+   MBlocks=G->AllocateSymmetryBlocks();
+  else if ( (NumMBlocks=G->GetNumMirrorBlocks()) > 0 )
+   { MBlocks=G->AllocateMirrorBlocks();
+     MirrorBlocks=true;
+   }
+  else
+   M=G->AllocateBEMMatrix();
+  SSD->M=M;
   SSD->RHS = G->AllocateRHSVector();
   HVector *KN = SSD->KN =G->AllocateRHSVector();
   SSD->IF=IFDList;
@@ -439,7 +491,11 @@ int main(int argc, char *argv[])
      /*******************************************************************/
      /* assemble the BEM matrix at this frequency                       */
      /*******************************************************************/
-     if ( G->LDim==0 )
+     if ( MirrorBlocks )
+      G->AssembleMirrorBlocks(Omega, MBlocks);
+     else if ( MBlocks )
+      G->AssembleSymmetryBlocks(Omega, MBlocks);
+     else if ( G->LDim==0 )
       G->AssembleBEMMatrix(Omega, M);
      else
       { cdouble EpsExterior, MuExterior;
@@ -469,7 +525,12 @@ int main(int argc, char *argv[])
      /*******************************************************************/
      if (ExportMatrix)
       { void *pCC=HMatrix::OpenMATLABContext("%s_%s",GeoFileBase,OmegaStr);
-        M->ExportToMATLAB(pCC,"M");
+        if (MBlocks)
+         { for(int m=0; m<NumMBlocks; m++)
+            MBlocks[m]->ExportToMATLAB(pCC,"M%i",m);
+         }
+        else
+         M->ExportToMATLAB(pCC,"M");
         HMatrix::CloseMATLABContext(pCC);
       };
 
@@ -486,7 +547,12 @@ int main(int argc, char *argv[])
      /* problems                                                        */
      /*******************************************************************/
      Log("  LU-factorizing BEM matrix...");
-     M->LUFactorize();
+     if (MirrorBlocks)
+      G->LUFactorizeMirrorBlocks(MBlocks);
+     else if (MBlocks)
+      G->LUFactorizeSymmetryBlocks(MBlocks);
+     else
+      M->LUFactorize();
 
      /***************************************************************/
      /* set up the incident field profile and assemble the RHS vector */
@@ -499,7 +565,12 @@ int main(int argc, char *argv[])
      /* solve the BEM system*****************************************/
      /***************************************************************/
      Log("  Solving the BEM system...");
-     M->LUSolve(KN);
+     if (MirrorBlocks)
+      G->LUSolveMirror(MBlocks, KN);
+     else if (MBlocks)
+      G->LUSolveSymmetric(MBlocks, KN);
+     else
+      M->LUSolve(KN);
 
      /***************************************************************/
      /* now process all requested outputs                           */
@@ -531,6 +602,12 @@ int main(int argc, char *argv[])
      for(nepf=0; nepf<nEPFiles; nepf++)
       ProcessEPFile(SSD, EPFiles[nepf]);
 
+     /*--------------------------------------------------------------*/
+     /*- fields on user-specified grids -----------------------------*/
+     /*--------------------------------------------------------------*/
+     for(int nfg=0; nfg<nFGFiles; nfg++)
+      ProcessFieldGridFile(SSD, FGFiles[nfg], GridFuncs, ResumeGrids);
+
      /*--------------------------------------------------------------*/
      /*- induced dipole moments       -------------------------------*/
      /*--------------------------------------------------------------*/
@@ -58,6 +58,8 @@ void WriteSIPFTFile(SSData *SSD, char *SIPFTFile, double SIRadius, int SIPoints)
 void WritePSDFile(SSData *SSD, char *PSDFile);
 void GetMoments(SSData *SSD, char *MomentFile);
 void ProcessEPFile(SSData *SSData, char *EPFileName);
+void ProcessFieldGridFile(SSData *SSD, char *FGFileName, char *GridFuncs,
+                          bool Resume);
 void CreateFluxPlot(SSData *SSData, char *MeshFileName);
 
 #endif
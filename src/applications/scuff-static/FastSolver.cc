@@ -0,0 +1,1250 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * FastSolver.cc -- matrix-free (fast multipole + GMRES) solution of
+ *               -- the electrostatic BEM system for large geometries
+ *
+ * how it works:
+ *
+ *  (a) we build an octree over all panels in the geometry and
+ *      sort pairs of nodes by a dual-tree traversal: a pair (T,S)
+ *      of target and source nodes is well-separated if
+ *
+ *        Radius(T) + Radius(S) < Theta * |Center(T) - Center(S)|.
+ *
+ *      well-separated pairs go on the M2L list of T; pairs of leaves
+ *      that are not well-separated go on the near-field list of T;
+ *      otherwise we split the larger of the two nodes and recurse.
+ *
+ *  (b) for each pair of (target panel in T, source panel in a leaf
+ *      on T's near-field list) we compute the exact BEM matrix
+ *      element (GetBEMMatrixEntry, i.e. GetPPI with Taylor-Duffy
+ *      for singular pairs) and store it in a sparse (CSR) matrix.
+ *      this is the only place GetPPI is called.
+ *
+ *  (c) all other matrix elements are never computed. instead, to
+ *      apply the BEM matrix to a vector of panel charge densities,
+ *      we represent each source panel by a few cubature points
+ *      carrying point charges and use a cartesian fast multipole
+ *      method for the 1/r kernel:
+ *
+ *       P2M: multipole moments M_k = \sum_j q_j (y_j - Center)^k of
+ *            each leaf, for multi-indices |k| <= P;
+ *       M2M: moments of parent nodes by shifting those of children;
+ *       M2L: local (taylor) coefficients about Center(T) of the
+ *            potential due to each node S on the M2L list of T,
+ *
+ *              L_j = (-1)^{|j|} \sum_k C(j+k,k) a_{j+k}(R) M_k,
+ *
+ *            with R = Center(T) - Center(S) and a_k(R) the taylor
+ *            coefficients (1/k!) D^k_y (1/|x-y|) at x-y=R, which
+ *            satisfy the recurrence
+ *
+ *              |k| |R|^2 a_k - (2|k|-1) \sum_i R_i a_{k-e_i}
+ *                            + (|k|-1) \sum_i a_{k-2e_i} = 0;
+ *
+ *       L2L: local coefficients of child nodes by shifting those of
+ *            parents;
+ *       L2P: potential (or normal field, for dielectric panels) at
+ *            the cubature points of each target panel from the local
+ *            expansion of its leaf.
+ *
+ *  (d) the system is solved by restarted GMRES with a block-jacobi
+ *      preconditioner whose blocks are the (LU-factorized) diagonal
+ *      leaf-leaf blocks of the near-field matrix. several right-hand
+ *      sides (e.g. one for each conductor in a capacitance
+ *      calculation) are iterated in lockstep, so that the tree
+ *      passes and the M2L translation operators are shared by all
+ *      of them in each matrix-vector product.
+ *
+ * agent         -- 10/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include <libTriInt.h>
+
+#include "libscuff.h"
+#include "SSSolver.h"
+
+namespace scuff {
+
+#define SSFS_MAXLEAF    16    // maximum number of panels in a leaf node
+#define SSFS_MAXDEPTH   20    // maximum depth of octree
+#define SSFS_THETA      0.5   // admissibility parameter (Radius/Distance)
+#define SSFS_TCRORDER   4     // cubature order for far-field interactions
+#define SSFS_MAXORDER   12    // maximum multipole order
+#define SSFS_RESTART    30    // GMRES restart length
+#define SSFS_MAXITERS   1000  // maximum number of GMRES iterations
+
+/***************************************************************/
+/* a single node in the octree. nodes own a contiguous range   */
+/* [PanelStart, PanelStart+NumPanels) of the Panels array.     */
+/***************************************************************/
+typedef struct SSFSNode
+ {
+   double Center[3];
+   double Radius;
+   int PanelStart, NumPanels;
+   int Children[8], NumChildren;
+   int Parent, Level;
+
+ } SSFSNode;
+
+/***************************************************************/
+/* growable list of integers                                   */
+/***************************************************************/
+typedef struct SSFSList
+ {
+   int *Data;
+   int N, NAlloc;
+
+ } SSFSList;
+
+static void AppendToList(SSFSList *L, int n)
+{
+  if (L->N == L->NAlloc)
+   { L->NAlloc = (L->NAlloc==0) ? 16 : 2*L->NAlloc;
+     L->Data = (int *)reallocEC(L->Data, L->NAlloc*sizeof(int));
+   };
+  L->Data[L->N++] = n;
+}
+
+/***************************************************************/
+/* the full fast-solver structure                              */
+/***************************************************************/
+typedef struct SSFastSolver
+ {
+   int N;                 // total number of panels
+
+   // octree; Panels[] maps tree order to global panel indices.
+   // LevelNodes[LevelStart[l]...LevelStart[l+1]-1] are the nodes
+   // at level l.
+   int *Panels;
+   SSFSNode *Nodes;
+   int NumNodes, NumAllocated;
+   int NumLeaves, *Leaves, *LeafNumber;
+   int NumLevels, *LevelStart, *LevelNodes;
+
+   // cubature points (3*NQ per panel) and weights (NQ per panel,
+   // including the jacobian 2*Area) for far-field interactions
+   int NQ;
+   double *XQ, *WQ;
+
+   // RowFactor[p] multiplies the far-field panel-panel integrals
+   // in row #p; NeedField[p] is true for dielectric panels, whose
+   // rows involve the normal field rather than the potential
+   double *RowFactor, *nHat;
+   bool *NeedField;
+
+   // multi-index tables for the cartesian expansions: K[3*n+i]
+   // is the ith component of multi-index #n, Index[] maps
+   // (k1,k2,k3) to n, Minus[3*n+i] is the index of k-e_i (or -1).
+   // multi-indices are sorted by total degree; the first NM
+   // have |k|<=Order, the first NC have |k|<=2*Order.
+   int Order, NM, NC, Q;
+   int *K, *Index, *Minus;
+   double *Binomial;       // Binomial[n*Q+m] = n choose m
+
+   // M2L operator tables: for target index j and source index k,
+   // M2LIndex[j*NM+k] = index of j+k, and
+   // M2LCoeff[j*NM+k] = (-1)^{|j|} C(j+k,k)
+   int *M2LIndex;
+   double *M2LCoeff;
+
+   // M2L lists of all nodes (CSR format)
+   int *M2LStart, *M2LNodes;
+
+   // near-field matrix (CSR format, rows in global panel order)
+   size_t *NearStart;
+   int *NearCols;
+   double *NearValues;
+
+   // block-jacobi preconditioner: LU factors of the diagonal
+   // leaf-leaf blocks of the near-field matrix
+   HMatrix **PCBlocks;
+
+   // GMRES parameters
+   double Tolerance;
+   int MaxIters;
+
+ } SSFastSolver;
+
+/***************************************************************/
+/* add a new node to the tree, growing the node array as needed*/
+/***************************************************************/
+static int AddNode(SSFastSolver *FS, int PanelStart, int NumPanels,
+                   int Parent, int Level)
+{
+  if (FS->NumNodes == FS->NumAllocated)
+   { FS->NumAllocated = (FS->NumAllocated==0) ? 64 : 2*FS->NumAllocated;
+     FS->Nodes=(SSFSNode *)reallocEC(FS->Nodes, FS->NumAllocated*sizeof(SSFSNode));
+   };
+
+  int nn = FS->NumNodes++;
+  SSFSNode *Node = FS->Nodes + nn;
+  memset(Node, 0, sizeof(SSFSNode));
+  Node->PanelStart = PanelStart;
+  Node->NumPanels  = NumPanels;
+  Node->Parent     = Parent;
+  Node->Level      = Level;
+  return nn;
+}
+
+/***************************************************************/
+/* recursively subdivide node #nn. (note that FS->Nodes may be */
+/* reallocated by the recursive calls, so we never hold        */
+/* pointers to nodes across them.)                             */
+/***************************************************************/
+static void SubdivideNode(SSFastSolver *FS, RWGPanel **PanelList, int nn)
+{
+  int *Panels   = FS->Panels + FS->Nodes[nn].PanelStart;
+  int NumPanels = FS->Nodes[nn].NumPanels;
+  int Level     = FS->Nodes[nn].Level;
+
+  /*--------------------------------------------------------------*/
+  /*- bounding box of the panel centroids, then the radius of the */
+  /*- smallest sphere about the box center enclosing all panels   */
+  /*--------------------------------------------------------------*/
+  double RMax[3]={-1.0e89, -1.0e89, -1.0e89};
+  double RMin[3]={+1.0e89, +1.0e89, +1.0e89};
+  for(int n=0; n<NumPanels; n++)
+   for(int Mu=0; Mu<3; Mu++)
+    { RMax[Mu] = fmax(RMax[Mu], PanelList[Panels[n]]->Centroid[Mu]);
+      RMin[Mu] = fmin(RMin[Mu], PanelList[Panels[n]]->Centroid[Mu]);
+    };
+
+  double Center[3], Radius=0.0;
+  for(int Mu=0; Mu<3; Mu++)
+   Center[Mu] = 0.5*(RMax[Mu] + RMin[Mu]);
+  for(int n=0; n<NumPanels; n++)
+   { RWGPanel *P = PanelList[Panels[n]];
+     Radius = fmax(Radius, VecDistance(Center, P->Centroid) + P->Radius);
+   };
+
+  SSFSNode *Node = FS->Nodes + nn;
+  VecCopy(Center, Node->Center);
+  Node->Radius = Radius;
+
+  if ( NumPanels<=SSFS_MAXLEAF || Level==SSFS_MAXDEPTH )
+   return;
+
+  /*--------------------------------------------------------------*/
+  /*- sort panels into octants (counting sort) -------------------*/
+  /*--------------------------------------------------------------*/
+  int *Octant = new int[NumPanels];
+  int Count[8]={0,0,0,0,0,0,0,0};
+  for(int n=0; n<NumPanels; n++)
+   { double *X = PanelList[Panels[n]]->Centroid;
+     Octant[n] =   (X[0]>Center[0] ? 1 : 0)
+                 + (X[1]>Center[1] ? 2 : 0)
+                 + (X[2]>Center[2] ? 4 : 0);
+     Count[Octant[n]]++;
+   };
+
+  // all centroids coincide (degenerate); leave as a leaf
+  for(int no=0; no<8; no++)
+   if (Count[no]==NumPanels)
+    { delete[] Octant;
+      return;
+    };
+
+  int Start[8];
+  Start[0]=0;
+  for(int no=1; no<8; no++)
+   Start[no] = Start[no-1] + Count[no-1];
+
+  int *Sorted = new int[NumPanels];
+  int Next[8];
+  memcpy(Next, Start, 8*sizeof(int));
+  for(int n=0; n<NumPanels; n++)
+   Sorted[ Next[Octant[n]]++ ] = Panels[n];
+  memcpy(Panels, Sorted, NumPanels*sizeof(int));
+  delete[] Sorted;
+  delete[] Octant;
+
+  /*--------------------------------------------------------------*/
+  /*- create and subdivide the children --------------------------*/
+  /*--------------------------------------------------------------*/
+  int PanelStart = FS->Nodes[nn].PanelStart;
+  for(int no=0; no<8; no++)
+   {
+     if (Count[no]==0) continue;
+     int nc = AddNode(FS, PanelStart + Start[no], Count[no], nn, Level+1);
+     int NumChildren = FS->Nodes[nn].NumChildren++;
+     FS->Nodes[nn].Children[NumChildren] = nc;
+     SubdivideNode(FS, PanelList, nc);
+   };
+
+}
+
+/***************************************************************/
+/* dual-tree traversal sorting the pair (nt, ns) of target and */
+/* source nodes into the M2L and near-field lists.             */
+/***************************************************************/
+static void GetInteractionLists(SSFastSolver *FS, int nt, int ns,
+                                SSFSList *M2LLists, SSFSList *NearLists)
+{
+  SSFSNode *T = FS->Nodes + nt;
+  SSFSNode *S = FS->Nodes + ns;
+
+  double Distance = VecDistance(T->Center, S->Center);
+  if ( (T->Radius + S->Radius) < SSFS_THETA*Distance )
+   AppendToList(M2LLists + nt, ns);
+  else if (T->NumChildren==0 && S->NumChildren==0)
+   AppendToList(NearLists + FS->LeafNumber[nt], ns);
+  else if ( S->NumChildren==0 || (T->NumChildren>0 && T->Radius>=S->Radius) )
+   { for(int nc=0; nc<T->NumChildren; nc++)
+      GetInteractionLists(FS, T->Children[nc], ns, M2LLists, NearLists);
+   }
+  else
+   { for(int nc=0; nc<S->NumChildren; nc++)
+      GetInteractionLists(FS, nt, S->Children[nc], M2LLists, NearLists);
+   };
+}
+
+/***************************************************************/
+/* tables of multi-indices and translation coefficients for    */
+/* expansions of order Order                                   */
+/***************************************************************/
+static void InitMultiIndices(SSFastSolver *FS, int Order)
+{
+  int Q = 2*Order+1;
+  FS->Order = Order;
+  FS->Q     = Q;
+  FS->NM    = (Order+1)*(Order+2)*(Order+3)/6;
+  FS->NC    = (2*Order+1)*(2*Order+2)*(2*Order+3)/6;
+  FS->K     = (int *)mallocEC(3*FS->NC*sizeof(int));
+  FS->Index = (int *)mallocEC(Q*Q*Q*sizeof(int));
+  FS->Minus = (int *)mallocEC(3*FS->NM*sizeof(int));
+
+  for(int n=0; n<Q*Q*Q; n++)
+   FS->Index[n]=-1;
+
+  int n=0;
+  for(int Degree=0; Degree<=2*Order; Degree++)
+   for(int k1=Degree; k1>=0; k1--)
+    for(int k2=Degree-k1; k2>=0; k2--, n++)
+     { int k3=Degree-k1-k2;
+       FS->K[3*n+0]=k1;
+       FS->K[3*n+1]=k2;
+       FS->K[3*n+2]=k3;
+       FS->Index[ (k1*Q + k2)*Q + k3 ] = n;
+     };
+
+  for(n=0; n<FS->NM; n++)
+   { int *k=FS->K + 3*n;
+     FS->Minus[3*n+0] = k[0]==0 ? -1 : FS->Index[ ((k[0]-1)*Q + k[1]  )*Q + k[2]   ];
+     FS->Minus[3*n+1] = k[1]==0 ? -1 : FS->Index[ ( k[0]   *Q + k[1]-1)*Q + k[2]   ];
+     FS->Minus[3*n+2] = k[2]==0 ? -1 : FS->Index[ ( k[0]   *Q + k[1]  )*Q + k[2]-1 ];
+   };
+
+  FS->Binomial = (double *)mallocEC(Q*Q*sizeof(double));
+  for(int nn=0; nn<Q; nn++)
+   { FS->Binomial[nn*Q+0]=1.0;
+     for(int m=1; m<Q; m++)
+      FS->Binomial[nn*Q+m] = (m>nn) ? 0.0 : FS->Binomial[(nn-1)*Q+m-1] + FS->Binomial[(nn-1)*Q+m];
+   };
+
+  int NM=FS->NM;
+  FS->M2LIndex = (int *)mallocEC(NM*NM*sizeof(int));
+  FS->M2LCoeff = (double *)mallocEC(NM*NM*sizeof(double));
+  for(int j=0; j<NM; j++)
+   for(int k=0; k<NM; k++)
+    { int *kj=FS->K+3*j, *kk=FS->K+3*k;
+      int s[3] = { kj[0]+kk[0], kj[1]+kk[1], kj[2]+kk[2] };
+      double Sign = ( (kj[0]+kj[1]+kj[2]) % 2 ) ? -1.0 : 1.0;
+      FS->M2LIndex[j*NM+k] = FS->Index[ (s[0]*Q + s[1])*Q + s[2] ];
+      FS->M2LCoeff[j*NM+k] = Sign * FS->Binomial[s[0]*Q+kk[0]]
+                                  * FS->Binomial[s[1]*Q+kk[1]]
+                                  * FS->Binomial[s[2]*Q+kk[2]];
+    };
+}
+
+/***************************************************************/
+/* taylor coefficients a_k(R), |k| <= 2*Order, of 1/|x-y| at   */
+/* x-y=R                                                       */
+/***************************************************************/
+static void GetTaylorCoefficients(SSFastSolver *FS, double R[3], double *a)
+{
+  int Q  = FS->Q;
+  int *K = FS->K;
+  double R2 = R[0]*R[0] + R[1]*R[1] + R[2]*R[2];
+
+  a[0] = 1.0/sqrt(R2);
+  for(int n=1; n<FS->NC; n++)
+   { int k[3];
+     k[0]=K[3*n+0];
+     k[1]=K[3*n+1];
+     k[2]=K[3*n+2];
+     int Degree = k[0] + k[1] + k[2];
+
+     double Sum1=0.0, Sum2=0.0;
+     for(int i=0; i<3; i++)
+      { if (k[i]==0) continue;
+        k[i]--;
+        Sum1 += R[i]*a[ FS->Index[ (k[0]*Q + k[1])*Q + k[2] ] ];
+        if (k[i]>0)
+         { k[i]--;
+           Sum2 += a[ FS->Index[ (k[0]*Q + k[1])*Q + k[2] ] ];
+           k[i]++;
+         };
+        k[i]++;
+      };
+
+     a[n] = ( (2.0*Degree-1.0)*Sum1 - (Degree-1.0)*Sum2 ) / (Degree*R2);
+   };
+}
+
+/***************************************************************/
+/* Monomials[n] = X^{k_n} for all |k_n| <= Order               */
+/***************************************************************/
+static void GetMonomials(SSFastSolver *FS, double X[3], double *Monomials)
+{
+  int *K=FS->K, Order=FS->Order;
+  double *Powers = new double[3*(Order+1)];
+  for(int i=0; i<3; i++)
+   { Powers[i*(Order+1)]=1.0;
+     for(int l=1; l<=Order; l++)
+      Powers[i*(Order+1)+l] = Powers[i*(Order+1)+l-1]*X[i];
+   };
+  for(int n=0; n<FS->NM; n++)
+   Monomials[n] =  Powers[0*(Order+1)+K[3*n+0]]
+                  *Powers[1*(Order+1)+K[3*n+1]]
+                  *Powers[2*(Order+1)+K[3*n+2]];
+  delete[] Powers;
+}
+
+/***************************************************************/
+/* shift multipole moments (Local==false) or local coefficients*/
+/* (Local==true) by D, i.e.                                    */
+/*  M2M: Out_k += \sum_{j<=k} C(k,j) D^{k-j} In_j,             */
+/*       D = Center(child) - Center(parent)                    */
+/*  L2L: Out_j += \sum_{i>=j} C(i,j) D^{i-j} In_i,             */
+/*       D = Center(child) - Center(parent)                    */
+/***************************************************************/
+static void ShiftExpansion(SSFastSolver *FS, double D[3], bool Local,
+                           int NRHS, double *In, double *Out)
+{
+  int NM=FS->NM, Q=FS->Q, *K=FS->K;
+  double *Binomial=FS->Binomial;
+  double *DPowers = new double[NM];
+  GetMonomials(FS, D, DPowers);
+
+  for(int n1=0; n1<NM; n1++)
+   for(int n2=0; n2<NM; n2++)
+    {
+      // for M2M, n1 = k (output) and n2 = j (input), j<=k
+      // for L2L, n1 = j (output) and n2 = i (input), i>=j
+      int *kBig   = Local ? K+3*n2 : K+3*n1;
+      int *kSmall = Local ? K+3*n1 : K+3*n2;
+      if (kSmall[0]>kBig[0] || kSmall[1]>kBig[1] || kSmall[2]>kBig[2])
+       continue;
+      int Diff[3] = { kBig[0]-kSmall[0], kBig[1]-kSmall[1], kBig[2]-kSmall[2] };
+      double Coeff =  Binomial[kBig[0]*Q + kSmall[0]]
+                     *Binomial[kBig[1]*Q + kSmall[1]]
+                     *Binomial[kBig[2]*Q + kSmall[2]]
+                     *DPowers[ FS->Index[ (Diff[0]*Q + Diff[1])*Q + Diff[2] ] ];
+      for(int nr=0; nr<NRHS; nr++)
+       Out[nr*NM + n1] += Coeff*In[nr*NM + n2];
+    };
+
+  delete[] DPowers;
+}
+
+/***************************************************************/
+/* create the fast solver: build the tree and interaction      */
+/* lists, compute the near-field matrix, and factorize the     */
+/* preconditioner blocks.                                      */
+/***************************************************************/
+void SSSolver::InitFastSolver(double Tolerance, int MultipoleOrder)
+{
+  if (FastSolver)
+   DestroyFastSolver();
+
+  if (MultipoleOrder<1) MultipoleOrder=1;
+  if (MultipoleOrder>SSFS_MAXORDER) MultipoleOrder=SSFS_MAXORDER;
+
+  SSFastSolver *FS=(SSFastSolver *)mallocEC(sizeof(SSFastSolver));
+  memset(FS, 0, sizeof(SSFastSolver));
+  FastSolver    = (void *)FS;
+  FS->Tolerance = Tolerance;
+  FS->MaxIters  = SSFS_MAXITERS;
+  InitMultiIndices(FS, MultipoleOrder);
+
+  int N = FS->N = G->TotalPanels;
+  Log("Initializing fast solver (%i panels, multipole order %i, GMRES tolerance %e)",
+       N,MultipoleOrder,Tolerance);
+
+  /*--------------------------------------------------------------*/
+  /*- flat tables of panels and of the surface on which each lives*/
+  /*--------------------------------------------------------------*/
+  RWGPanel **PanelList = new RWGPanel *[N];
+  int *SurfaceIndex    = new int[N];
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   { RWGSurface *S=G->Surfaces[ns];
+     int Offset = G->PanelIndexOffset[ns];
+     for(int np=0; np<S->NumPanels; np++)
+      { PanelList[Offset+np] = S->Panels[np];
+        SurfaceIndex[Offset+np] = ns;
+      };
+   };
+
+  SurfType *SurfaceTypes = new SurfType[G->NumSurfaces];
+  double *Deltas         = new double[G->NumSurfaces];
+  double *Lambdas        = new double[G->NumSurfaces];
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   SurfaceTypes[ns]=GetSurfaceType(G->Surfaces[ns], Deltas+ns, Lambdas+ns);
+
+  /*--------------------------------------------------------------*/
+  /*- cubature points and row data for all panels. (the cubature -*/
+  /*- rule is parameterized exactly as in GetPPI_CC.)            -*/
+  /*--------------------------------------------------------------*/
+  double *TCR = GetTCR(SSFS_TCRORDER, &(FS->NQ));
+  int NQ = FS->NQ;
+  FS->XQ        = (double *)mallocEC(3*NQ*N*sizeof(double));
+  FS->WQ        = (double *)mallocEC(NQ*N*sizeof(double));
+  FS->RowFactor = (double *)mallocEC(N*sizeof(double));
+  FS->nHat      = (double *)mallocEC(3*N*sizeof(double));
+  FS->NeedField = (bool *)mallocEC(N*sizeof(bool));
+  for(int p=0; p<N; p++)
+   {
+     int ns = SurfaceIndex[p];
+     RWGSurface *S = G->Surfaces[ns];
+     RWGPanel *P = PanelList[p];
+     double *V0 = S->Vertices + 3*P->VI[0];
+     double *V1 = S->Vertices + 3*P->VI[1];
+     double *V2 = S->Vertices + 3*P->VI[2];
+     for(int nq=0; nq<NQ; nq++)
+      { double u=TCR[3*nq+0], v=TCR[3*nq+1], w=TCR[3*nq+2];
+        for(int Mu=0; Mu<3; Mu++)
+         FS->XQ[3*(p*NQ+nq)+Mu] = V0[Mu] + u*(V1[Mu]-V0[Mu]) + v*(V2[Mu]-V1[Mu]);
+        FS->WQ[p*NQ+nq] = 2.0*P->Area*w;
+      };
+
+     VecCopy(P->ZHat, FS->nHat + 3*p);
+     switch(SurfaceTypes[ns])
+      { case PEC:           FS->RowFactor[p] =  1.0;        break;
+        case LAMBDASURFACE: FS->RowFactor[p] = -1.0;        break;
+        case DIELECTRIC:    FS->RowFactor[p] = Deltas[ns];  break;
+      };
+     FS->NeedField[p] = (SurfaceTypes[ns]==DIELECTRIC);
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- build the octree and sort nodes by level. (children are    -*/
+  /*- always created after their parents, so nodes come out of   -*/
+  /*- this in an order compatible with the tree passes.)         -*/
+  /*--------------------------------------------------------------*/
+  FS->Panels = (int *)mallocEC(N*sizeof(int));
+  for(int p=0; p<N; p++)
+   FS->Panels[p]=p;
+  AddNode(FS, 0, N, -1, 0);
+  SubdivideNode(FS, PanelList, 0);
+
+  int NumNodes = FS->NumNodes;
+  FS->Leaves     = (int *)mallocEC(NumNodes*sizeof(int));
+  FS->LeafNumber = (int *)mallocEC(NumNodes*sizeof(int));
+  FS->NumLevels  = 0;
+  for(int nn=0; nn<NumNodes; nn++)
+   { FS->LeafNumber[nn] = -1;
+     if (FS->Nodes[nn].NumChildren==0)
+      { FS->LeafNumber[nn] = FS->NumLeaves;
+        FS->Leaves[FS->NumLeaves++] = nn;
+      };
+     if (FS->Nodes[nn].Level >= FS->NumLevels)
+      FS->NumLevels = FS->Nodes[nn].Level + 1;
+   };
+
+  FS->LevelStart = (int *)mallocEC((FS->NumLevels+1)*sizeof(int));
+  FS->LevelNodes = (int *)mallocEC(NumNodes*sizeof(int));
+  memset(FS->LevelStart, 0, (FS->NumLevels+1)*sizeof(int));
+  for(int nn=0; nn<NumNodes; nn++)
+   FS->LevelStart[FS->Nodes[nn].Level + 1]++;
+  for(int l=0; l<FS->NumLevels; l++)
+   FS->LevelStart[l+1] += FS->LevelStart[l];
+  int *LevelFill = new int[FS->NumLevels];
+  memcpy(LevelFill, FS->LevelStart, FS->NumLevels*sizeof(int));
+  for(int nn=0; nn<NumNodes; nn++)
+   FS->LevelNodes[ LevelFill[FS->Nodes[nn].Level]++ ] = nn;
+  delete[] LevelFill;
+  Log(" octree: %i nodes, %i leaves, %i levels",NumNodes,FS->NumLeaves,FS->NumLevels);
+
+  /*--------------------------------------------------------------*/
+  /*- interaction lists; the near-field lists are only needed to  */
+  /*- lay out the near-field matrix, so we keep them temporarily  */
+  /*--------------------------------------------------------------*/
+  int NumLeaves = FS->NumLeaves;
+  SSFSList *M2LLists  = (SSFSList *)mallocEC(NumNodes*sizeof(SSFSList));
+  SSFSList *NearLists = (SSFSList *)mallocEC(NumLeaves*sizeof(SSFSList));
+  memset(M2LLists, 0, NumNodes*sizeof(SSFSList));
+  memset(NearLists, 0, NumLeaves*sizeof(SSFSList));
+  GetInteractionLists(FS, 0, 0, M2LLists, NearLists);
+
+  FS->M2LStart = (int *)mallocEC((NumNodes+1)*sizeof(int));
+  FS->M2LStart[0]=0;
+  for(int nn=0; nn<NumNodes; nn++)
+   FS->M2LStart[nn+1] = FS->M2LStart[nn] + M2LLists[nn].N;
+  FS->M2LNodes = (int *)mallocEC((FS->M2LStart[NumNodes]+1)*sizeof(int));
+  for(int nn=0; nn<NumNodes; nn++)
+   { if (M2LLists[nn].N>0)
+      memcpy(FS->M2LNodes + FS->M2LStart[nn], M2LLists[nn].Data, M2LLists[nn].N*sizeof(int));
+     free(M2LLists[nn].Data);
+   };
+  free(M2LLists);
+  Log(" %i M2L translations",FS->M2LStart[NumNodes]);
+
+  /*--------------------------------------------------------------*/
+  /*- lay out the near-field matrix: all rows in a leaf have the  */
+  /*- same column pattern (the panels of its near-field leaves)   */
+  /*--------------------------------------------------------------*/
+  int *LeafOf       = new int[N];   // leaf containing each panel
+  int *LeafPosition = new int[N];   // position of each panel within its leaf
+  for(int nl=0; nl<NumLeaves; nl++)
+   { SSFSNode *L = FS->Nodes + FS->Leaves[nl];
+     for(int n=0; n<L->NumPanels; n++)
+      { LeafOf[ FS->Panels[L->PanelStart + n] ] = nl;
+        LeafPosition[ FS->Panels[L->PanelStart + n] ] = n;
+      };
+   };
+
+  int *NumNearCols = new int[NumLeaves];
+  for(int nl=0; nl<NumLeaves; nl++)
+   { NumNearCols[nl]=0;
+     for(int nn=0; nn<NearLists[nl].N; nn++)
+      NumNearCols[nl] += FS->Nodes[ NearLists[nl].Data[nn] ].NumPanels;
+   };
+
+  FS->NearStart = (size_t *)mallocEC((N+1)*sizeof(size_t));
+  FS->NearStart[0]=0;
+  for(int p=0; p<N; p++)
+   FS->NearStart[p+1] = FS->NearStart[p] + NumNearCols[LeafOf[p]];
+  size_t NNZ = FS->NearStart[N];
+  Log(" near-field matrix: %lu nonzeros (%.1f per row, %g MB)",
+       (unsigned long)NNZ, ((double)NNZ)/((double)N),
+       ((double)NNZ)*(sizeof(int)+sizeof(double))/1048576.0);
+  FS->NearCols   = (int *)mallocEC((NNZ+1)*sizeof(int));
+  FS->NearValues = (double *)mallocEC((NNZ+1)*sizeof(double));
+
+  /*--------------------------------------------------------------*/
+  /*- compute the near-field matrix elements ---------------------*/
+  /*--------------------------------------------------------------*/
+  Log(" computing near-field matrix elements...");
+#ifdef USE_OPENMP
+  int NumThreads = GetNumThreads();
+  Log("OpenMP multithreading (%i threads)",NumThreads);
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+  for(int nl=0; nl<NumLeaves; nl++)
+   {
+     LogPercent(nl, NumLeaves);
+     SSFSNode *T = FS->Nodes + FS->Leaves[nl];
+     for(int nt=0; nt<T->NumPanels; nt++)
+      {
+        int pa = FS->Panels[T->PanelStart + nt];
+        int nsa = SurfaceIndex[pa];
+        RWGSurface *Sa = G->Surfaces[nsa];
+        int npa = pa - G->PanelIndexOffset[nsa];
+        size_t nnz = FS->NearStart[pa];
+        for(int nn=0; nn<NearLists[nl].N; nn++)
+         { SSFSNode *S = FS->Nodes + NearLists[nl].Data[nn];
+           for(int nsp=0; nsp<S->NumPanels; nsp++, nnz++)
+            { int pb = FS->Panels[S->PanelStart + nsp];
+              int nsb = SurfaceIndex[pb];
+              RWGSurface *Sb = G->Surfaces[nsb];
+              int npb = pb - G->PanelIndexOffset[nsb];
+              FS->NearCols[nnz]   = pb;
+              FS->NearValues[nnz] = GetBEMMatrixEntry(Sa, npa, Sb, npb, SurfaceTypes[nsa],
+                                                      Deltas[nsa], Lambdas[nsa]);
+            };
+         };
+      };
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- extract and factorize the diagonal leaf-leaf blocks --------*/
+  /*--------------------------------------------------------------*/
+  Log(" factorizing preconditioner blocks...");
+  FS->PCBlocks = (HMatrix **)mallocEC(NumLeaves*sizeof(HMatrix *));
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+  for(int nl=0; nl<NumLeaves; nl++)
+   {
+     SSFSNode *T = FS->Nodes + FS->Leaves[nl];
+     HMatrix *B = FS->PCBlocks[nl] = new HMatrix(T->NumPanels, T->NumPanels);
+     B->Zero();
+     for(int nt=0; nt<T->NumPanels; nt++)
+      { int pa = FS->Panels[T->PanelStart + nt];
+        for(size_t nnz=FS->NearStart[pa]; nnz<FS->NearStart[pa+1]; nnz++)
+         { int pb = FS->NearCols[nnz];
+           if (LeafOf[pb]==nl)
+            B->SetEntry(nt, LeafPosition[pb], FS->NearValues[nnz]);
+         };
+      };
+     B->LUFactorize();
+   };
+
+  for(int nl=0; nl<NumLeaves; nl++)
+   free(NearLists[nl].Data);
+  free(NearLists);
+  delete[] NumNearCols;
+  delete[] LeafPosition;
+  delete[] LeafOf;
+  delete[] SurfaceTypes;
+  delete[] Deltas;
+  delete[] Lambdas;
+  delete[] SurfaceIndex;
+  delete[] PanelList;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+void SSSolver::DestroyFastSolver()
+{
+  SSFastSolver *FS=(SSFastSolver *)FastSolver;
+  if (!FS) return;
+
+  for(int nl=0; nl<FS->NumLeaves; nl++)
+   delete FS->PCBlocks[nl];
+  free(FS->PCBlocks);
+  free(FS->NearValues);
+  free(FS->NearCols);
+  free(FS->NearStart);
+  free(FS->M2LNodes);
+  free(FS->M2LStart);
+  free(FS->M2LCoeff);
+  free(FS->M2LIndex);
+  free(FS->Binomial);
+  free(FS->Minus);
+  free(FS->Index);
+  free(FS->K);
+  free(FS->NeedField);
+  free(FS->nHat);
+  free(FS->RowFactor);
+  free(FS->WQ);
+  free(FS->XQ);
+  free(FS->LevelNodes);
+  free(FS->LevelStart);
+  free(FS->LeafNumber);
+  free(FS->Leaves);
+  free(FS->Nodes);
+  free(FS->Panels);
+  free(FS);
+  FastSolver=0;
+}
+
+/***************************************************************/
+/* Y = M*X for NRHS columns of length N, stored contiguously   */
+/* (column-major), where M is the BEM matrix, applied as       */
+/* near-field matrix + fast multipole far field.               */
+/***************************************************************/
+static void ApplyFastBEMMatrix(SSFastSolver *FS, int NRHS, double *X, double *Y)
+{
+  if (NRHS==0) return;
+
+  int N=FS->N, NQ=FS->NQ, NM=FS->NM, NumNodes=FS->NumNodes;
+  size_t ESize = ((size_t)NRHS)*NM;  // size of one node's expansions
+
+  // Moments[nn*ESize + nr*NM + n] = moment #n of node nn for RHS #nr
+  double *Moments = (double *)mallocEC(NumNodes*ESize*sizeof(double));
+  double *Locals  = (double *)mallocEC(NumNodes*ESize*sizeof(double));
+  memset(Moments, 0, NumNodes*ESize*sizeof(double));
+  memset(Locals,  0, NumNodes*ESize*sizeof(double));
+
+  int NumThreads;
+#ifndef USE_OPENMP
+  NumThreads=1;
+#else
+  NumThreads=GetNumThreads();
+#endif
+
+  /*--------------------------------------------------------------*/
+  /*- P2M: moments of leaves -------------------------------------*/
+  /*--------------------------------------------------------------*/
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+  for(int nl=0; nl<FS->NumLeaves; nl++)
+   {
+     int nn = FS->Leaves[nl];
+     SSFSNode *Node = FS->Nodes + nn;
+     double *M = Moments + nn*ESize;
+     double *Monomials = new double[NM];
+     for(int np=0; np<Node->NumPanels; np++)
+      { int p = FS->Panels[Node->PanelStart + np];
+        for(int nq=0; nq<NQ; nq++)
+         { double D[3];
+           VecSub(FS->XQ + 3*(p*NQ + nq), Node->Center, D);
+           GetMonomials(FS, D, Monomials);
+           for(int nr=0; nr<NRHS; nr++)
+            { double q = FS->WQ[p*NQ+nq] * X[((size_t)nr)*N + p];
+              if (q==0.0) continue;
+              for(int n=0; n<NM; n++)
+               M[nr*NM + n] += q*Monomials[n];
+            };
+         };
+      };
+     delete[] Monomials;
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- M2M: upward pass, one level at a time ----------------------*/
+  /*--------------------------------------------------------------*/
+  for(int Level=FS->NumLevels-2; Level>=0; Level--)
+   {
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+     for(int nln=FS->LevelStart[Level]; nln<FS->LevelStart[Level+1]; nln++)
+      { int nn = FS->LevelNodes[nln];
+        SSFSNode *Node = FS->Nodes + nn;
+        for(int nc=0; nc<Node->NumChildren; nc++)
+         { int nChild = Node->Children[nc];
+           double D[3];
+           VecSub(FS->Nodes[nChild].Center, Node->Center, D);
+           ShiftExpansion(FS, D, false, NRHS, Moments + nChild*ESize, Moments + nn*ESize);
+         };
+      };
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- M2L: local expansions due to well-separated nodes ----------*/
+  /*--------------------------------------------------------------*/
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+  for(int nn=0; nn<NumNodes; nn++)
+   {
+     if (FS->M2LStart[nn]==FS->M2LStart[nn+1]) continue;
+     double *a = new double[FS->NC];
+     double *T = new double[NM*NM];
+     double *L = Locals + nn*ESize;
+     for(int nf=FS->M2LStart[nn]; nf<FS->M2LStart[nn+1]; nf++)
+      {
+        int ns = FS->M2LNodes[nf];
+        double R[3];
+        VecSub(FS->Nodes[nn].Center, FS->Nodes[ns].Center, R);
+        GetTaylorCoefficients(FS, R, a);
+
+        // translation operator, shared by all right-hand sides
+        for(int jk=0; jk<NM*NM; jk++)
+         T[jk] = FS->M2LCoeff[jk] * a[FS->M2LIndex[jk]];
+
+        double *M = Moments + ns*ESize;
+        for(int nr=0; nr<NRHS; nr++)
+         for(int j=0; j<NM; j++)
+          { double Sum=0.0;
+            for(int k=0; k<NM; k++)
+             Sum += T[j*NM+k] * M[nr*NM + k];
+            L[nr*NM + j] += Sum;
+          };
+      };
+     delete[] a;
+     delete[] T;
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- L2L: downward pass, one level at a time --------------------*/
+  /*--------------------------------------------------------------*/
+  for(int Level=1; Level<FS->NumLevels; Level++)
+   {
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+     for(int nln=FS->LevelStart[Level]; nln<FS->LevelStart[Level+1]; nln++)
+      { int nn = FS->LevelNodes[nln];
+        int nParent = FS->Nodes[nn].Parent;
+        double D[3];
+        VecSub(FS->Nodes[nn].Center, FS->Nodes[nParent].Center, D);
+        ShiftExpansion(FS, D, true, NRHS, Locals + nParent*ESize, Locals + nn*ESize);
+      };
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- L2P and near field -----------------------------------------*/
+  /*--------------------------------------------------------------*/
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+  for(int nl=0; nl<FS->NumLeaves; nl++)
+   {
+     int nn = FS->Leaves[nl];
+     SSFSNode *Node = FS->Nodes + nn;
+     double *L = Locals + nn*ESize;
+     double *Monomials = new double[NM];
+     double *Sum = new double[NRHS];
+
+     for(int nt=0; nt<Node->NumPanels; nt++)
+      {
+        int pa = FS->Panels[Node->PanelStart + nt];
+        bool NeedField = FS->NeedField[pa];
+        double *nHat = FS->nHat + 3*pa;
+
+        for(int nr=0; nr<NRHS; nr++)
+         Sum[nr]=0.0;
+
+        for(int nq=0; nq<NQ; nq++)
+         { double D[3];
+           VecSub(FS->XQ + 3*(pa*NQ + nq), Node->Center, D);
+           GetMonomials(FS, D, Monomials);
+           double WQ = FS->WQ[pa*NQ + nq];
+           for(int nr=0; nr<NRHS; nr++)
+            { double Value=0.0;
+              if (NeedField)
+               { // nHat \cdot E = -nHat \cdot \nabla Phi
+                 for(int n=0; n<NM; n++)
+                  for(int i=0; i<3; i++)
+                   { int nMinus = FS->Minus[3*n+i];
+                     if (nMinus==-1) continue;
+                     Value -= nHat[i] * FS->K[3*n+i] * L[nr*NM + n] * Monomials[nMinus];
+                   };
+               }
+              else
+               for(int n=0; n<NM; n++)
+                Value += L[nr*NM + n] * Monomials[n];
+              Sum[nr] += WQ*Value;
+            };
+         };
+
+        for(int nr=0; nr<NRHS; nr++)
+         {
+           double Near=0.0;
+           for(size_t nnz=FS->NearStart[pa]; nnz<FS->NearStart[pa+1]; nnz++)
+            Near += FS->NearValues[nnz] * X[((size_t)nr)*N + FS->NearCols[nnz]];
+           Y[((size_t)nr)*N + pa] = Near + FS->RowFactor[pa]*Sum[nr]/(4.0*M_PI);
+         };
+      };
+
+     delete[] Monomials;
+     delete[] Sum;
+   };
+
+  free(Moments);
+  free(Locals);
+}
+
+/***************************************************************/
+/* apply the block-jacobi preconditioner in place              */
+/***************************************************************/
+static void ApplyPreconditioner(SSFastSolver *FS, int NRHS, double *X)
+{
+  int N=FS->N;
+#ifdef USE_OPENMP
+  int NumThreads = GetNumThreads();
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+  for(int nl=0; nl<FS->NumLeaves; nl++)
+   {
+     SSFSNode *T = FS->Nodes + FS->Leaves[nl];
+     int *Panels = FS->Panels + T->PanelStart;
+     HVector *V = new HVector(T->NumPanels);
+     for(int nr=0; nr<NRHS; nr++)
+      { double *XR = X + ((size_t)nr)*N;
+        for(int nt=0; nt<T->NumPanels; nt++)
+         V->SetEntry(nt, XR[Panels[nt]]);
+        FS->PCBlocks[nl]->LUSolve(V);
+        for(int nt=0; nt<T->NumPanels; nt++)
+         XR[Panels[nt]] = V->GetEntryD(nt);
+      };
+     delete V;
+   };
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+static double Dot(int N, double *X, double *Y)
+{ double Sum=0.0;
+  for(int n=0; n<N; n++)
+   Sum+=X[n]*Y[n];
+  return Sum;
+}
+
+/***************************************************************/
+/* apply the BEM matrix to the columns of X using the fast     */
+/* solver (which must have been initialized)                   */
+/***************************************************************/
+HMatrix *SSSolver::ApplyBEMMatrix(HMatrix *X, HMatrix *Y)
+{
+  SSFastSolver *FS=(SSFastSolver *)FastSolver;
+  if (!FS)
+   ErrExit("%s:%i: ApplyBEMMatrix requires InitFastSolver",__FILE__,__LINE__);
+
+  if ( Y && (Y->NR!=X->NR || Y->NC!=X->NC) )
+   { Warn("wrong-size matrix passed to ApplyBEMMatrix (reallocating)");
+     delete Y;
+     Y=0;
+   };
+  if (!Y)
+   Y=new HMatrix(X->NR, X->NC);
+
+  ApplyFastBEMMatrix(FS, X->NC, X->DM, Y->DM);
+  return Y;
+}
+
+/***************************************************************/
+/* solve M*Sigma = RHS for all columns of RHS, overwriting RHS */
+/* with the solutions. if the fast solver was initialized, M   */
+/* is ignored (and may be NULL); otherwise M must contain the  */
+/* LU-factorized BEM matrix.                                   */
+/*                                                             */
+/* the fast path runs restarted, right-preconditioned GMRES    */
+/* simultaneously for all columns; columns that converge drop  */
+/* out of the matrix-vector products.                          */
+/***************************************************************/
+void SSSolver::SolveBEMSystem(HMatrix *M, HMatrix *RHS)
+{
+  SSFastSolver *FS=(SSFastSolver *)FastSolver;
+  if (!FS)
+   { M->LUSolve(RHS);
+     return;
+   };
+
+  int N=FS->N, NRHS=RHS->NC, m=SSFS_RESTART;
+  if (RHS->NR!=N)
+   ErrExit("%s:%i: wrong-size RHS matrix in SolveBEMSystem",__FILE__,__LINE__);
+
+  /*--------------------------------------------------------------*/
+  /*- per-column GMRES data --------------------------------------*/
+  /*--------------------------------------------------------------*/
+  double *B    = RHS->DM;                                   // N x NRHS
+  double *Sol  = (double *)mallocEC(((size_t)N)*NRHS*sizeof(double));
+  double *V    = (double *)mallocEC(((size_t)N)*(m+1)*NRHS*sizeof(double));
+  double *H    = (double *)mallocEC((m+1)*m*NRHS*sizeof(double));
+  double *CS   = (double *)mallocEC(m*NRHS*sizeof(double));
+  double *SN   = (double *)mallocEC(m*NRHS*sizeof(double));
+  double *g    = (double *)mallocEC((m+1)*NRHS*sizeof(double));
+  double *BNorm = new double[NRHS];
+  double *Residual = new double[NRHS];
+  int *Iters   = new int[NRHS];
+  int *CycleLength = new int[NRHS];
+  bool *Converged = new bool[NRHS];
+  bool *Active    = new bool[NRHS];
+  int *ActiveList = new int[NRHS];
+
+  // workspace for packed block matrix-vector products
+  double *ZIn  = (double *)mallocEC(((size_t)N)*NRHS*sizeof(double));
+  double *ZOut = (double *)mallocEC(((size_t)N)*NRHS*sizeof(double));
+
+  memset(Sol, 0, ((size_t)N)*NRHS*sizeof(double));
+  for(int nr=0; nr<NRHS; nr++)
+   { BNorm[nr] = sqrt(Dot(N, B + ((size_t)nr)*N, B + ((size_t)nr)*N));
+     Converged[nr] = (BNorm[nr]==0.0);
+     Residual[nr] = 0.0;
+     Iters[nr] = 0;
+   };
+
+  #define VCOL(j,nr) (V + ( ((size_t)(nr))*(m+1) + (j) )*N)
+  #define HENT(i,j,nr) H[ ((nr)*m + (j))*(m+1) + (i) ]
+
+  for(int Cycle=0; ; Cycle++)
+   {
+     /*--------------------------------------------------------------*/
+     /*- residuals of unconverged columns: r = b - M*x (on the first*/
+     /*- cycle x=0, so r=b)                                          */
+     /*--------------------------------------------------------------*/
+     int NumActive=0;
+     for(int nr=0; nr<NRHS; nr++)
+      { CycleLength[nr]=0;
+        Active[nr]=false;
+        if (!Converged[nr] && Iters[nr]<FS->MaxIters)
+         ActiveList[NumActive++]=nr;
+      };
+     if (NumActive==0) break;
+
+     if (Cycle>0)
+      { for(int na=0; na<NumActive; na++)
+         memcpy(ZIn + ((size_t)na)*N, Sol + ((size_t)ActiveList[na])*N, N*sizeof(double));
+        ApplyFastBEMMatrix(FS, NumActive, ZIn, ZOut);
+      };
+     for(int na=0; na<NumActive; na++)
+      { int nr=ActiveList[na];
+        double *V0 = VCOL(0,nr), *b = B + ((size_t)nr)*N;
+        for(int n=0; n<N; n++)
+         V0[n] = (Cycle==0) ? b[n] : b[n] - ZOut[((size_t)na)*N + n];
+        double Beta = sqrt(Dot(N, V0, V0));
+        for(int n=0; n<N; n++)
+         V0[n] /= Beta;
+        memset(g + nr*(m+1), 0, (m+1)*sizeof(double));
+        g[nr*(m+1)] = Beta;
+        Active[nr] = true;
+        Residual[nr] = Beta / BNorm[nr];
+        if (Residual[nr] < FS->Tolerance)
+         { Converged[nr]=true;
+           Active[nr]=false;
+         };
+      };
+
+     /*--------------------------------------------------------------*/
+     /*- arnoldi iterations, in lockstep for all active columns      */
+     /*--------------------------------------------------------------*/
+     for(int j=0; j<m; j++)
+      {
+        NumActive=0;
+        for(int nr=0; nr<NRHS; nr++)
+         if (Active[nr])
+          ActiveList[NumActive++]=nr;
+        if (NumActive==0) break;
+
+        // w = M * P^{-1} * v_j for all active columns at once
+        for(int na=0; na<NumActive; na++)
+         memcpy(ZIn + ((size_t)na)*N, VCOL(j,ActiveList[na]), N*sizeof(double));
+        ApplyPreconditioner(FS, NumActive, ZIn);
+        ApplyFastBEMMatrix(FS, NumActive, ZIn, ZOut);
+
+        for(int na=0; na<NumActive; na++)
+         {
+           int nr=ActiveList[na];
+           double *w = VCOL(j+1,nr);
+           memcpy(w, ZOut + ((size_t)na)*N, N*sizeof(double));
+
+           // modified gram-schmidt
+           for(int i=0; i<=j; i++)
+            { double *vi=VCOL(i,nr);
+              double hij = Dot(N, w, vi);
+              HENT(i,j,nr) = hij;
+              for(int n=0; n<N; n++)
+               w[n] -= hij*vi[n];
+            };
+           double hNorm = sqrt(Dot(N, w, w));
+           HENT(j+1,j,nr) = hNorm;
+           if (hNorm!=0.0)
+            for(int n=0; n<N; n++)
+             w[n] /= hNorm;
+
+           // apply previous givens rotations to the new column of H,
+           // then compute and apply a new one
+           double *cs=CS + nr*m, *sn=SN + nr*m, *gr=g + nr*(m+1);
+           for(int i=0; i<j; i++)
+            { double Temp   = cs[i]*HENT(i,j,nr) + sn[i]*HENT(i+1,j,nr);
+              HENT(i+1,j,nr) = -sn[i]*HENT(i,j,nr) + cs[i]*HENT(i+1,j,nr);
+              HENT(i,j,nr)   = Temp;
+            };
+           double Denom = sqrt( HENT(j,j,nr)*HENT(j,j,nr) + hNorm*hNorm );
+           if (Denom==0.0)
+            { cs[j]=1.0; sn[j]=0.0; }
+           else
+            { cs[j] = HENT(j,j,nr) / Denom;
+              sn[j] = hNorm / Denom;
+            };
+           HENT(j,j,nr)   = cs[j]*HENT(j,j,nr) + sn[j]*hNorm;
+           HENT(j+1,j,nr) = 0.0;
+           gr[j+1] = -sn[j]*gr[j];
+           gr[j]   =  cs[j]*gr[j];
+
+           Iters[nr]++;
+           CycleLength[nr] = j+1;
+           Residual[nr] = fabs(gr[j+1]) / BNorm[nr];
+           if ( Residual[nr]<FS->Tolerance || hNorm==0.0 || Iters[nr]>=FS->MaxIters )
+            Active[nr]=false;
+         };
+      };
+
+     /*--------------------------------------------------------------*/
+     /*- update the solutions: x += P^{-1} V y, with y the solution  */
+     /*- of the upper-triangular system H y = g                      */
+     /*--------------------------------------------------------------*/
+     NumActive=0;
+     for(int nr=0; nr<NRHS; nr++)
+      if (!Converged[nr] && CycleLength[nr]>0)
+       ActiveList[NumActive++]=nr;
+     for(int na=0; na<NumActive; na++)
+      { int nr=ActiveList[na], k=CycleLength[nr];
+        double *y = new double[k], *gr=g + nr*(m+1);
+        for(int i=k-1; i>=0; i--)
+         { y[i]=gr[i];
+           for(int l=i+1; l<k; l++)
+            y[i] -= HENT(i,l,nr)*y[l];
+           y[i] /= HENT(i,i,nr);
+         };
+        double *z = ZIn + ((size_t)na)*N;
+        memset(z, 0, N*sizeof(double));
+        for(int i=0; i<k; i++)
+         { double *vi=VCOL(i,nr);
+           for(int n=0; n<N; n++)
+            z[n] += y[i]*vi[n];
+         };
+        delete[] y;
+        if (Residual[nr]<FS->Tolerance)
+         Converged[nr]=true;
+      };
+     ApplyPreconditioner(FS, NumActive, ZIn);
+     for(int na=0; na<NumActive; na++)
+      { double *x = Sol + ((size_t)ActiveList[na])*N, *z = ZIn + ((size_t)na)*N;
+        for(int n=0; n<N; n++)
+         x[n] += z[n];
+      };
+   };
+
+  #undef VCOL
+  #undef HENT
+
+  /*--------------------------------------------------------------*/
+  /*--------------------------------------------------------------*/
+  /*--------------------------------------------------------------*/
+  for(int nr=0; nr<NRHS; nr++)
+   { if (Converged[nr])
+      Log("GMRES: RHS %i converged in %i iterations (residual %e)",nr,Iters[nr],Residual[nr]);
+     else
+      Warn("GMRES: RHS %i unconverged after %i iterations (residual %e)",nr,Iters[nr],Residual[nr]);
+   };
+  memcpy(RHS->DM, Sol, ((size_t)N)*NRHS*sizeof(double));
+
+  free(ZOut);
+  free(ZIn);
+  delete[] ActiveList;
+  delete[] Active;
+  delete[] Converged;
+  delete[] CycleLength;
+  delete[] Iters;
+  delete[] Residual;
+  delete[] BNorm;
+  free(g);
+  free(SN);
+  free(CS);
+  free(H);
+  free(V);
+  free(Sol);
+}
+
+/***************************************************************/
+/* single right-hand side                                      */
+/***************************************************************/
+void SSSolver::SolveBEMSystem(HMatrix *M, HVector *RHS)
+{
+  if (!FastSolver)
+   { M->LUSolve(RHS);
+     return;
+   };
+
+  HMatrix *RHSMatrix = new HMatrix(RHS->N, 1);
+  memcpy(RHSMatrix->DM, RHS->DV, RHS->N*sizeof(double));
+  SolveBEMSystem(M, RHSMatrix);
+  memcpy(RHS->DV, RHSMatrix->DM, RHS->N*sizeof(double));
+  delete RHSMatrix;
+}
+
+} // namespace scuff
@@ -139,11 +139,18 @@ void GetPolarizabilities(SSSolver *SSS, HMatrix *M, HVector *Sigma, char *FileNa
   /*--------------------------------------------------------------*/
   /*--------------------------------------------------------------*/
   /*--------------------------------------------------------------*/
+  int N = Sigma->N;
+  HMatrix *RHS = new HMatrix(N, 3);
+  for(int Mu=0; Mu<3; Mu++)
+   { SSS->AssembleRHSVector(0, PhiEConstant, (void *)(&Mu), Sigma);
+     memcpy(RHS->DM + Mu*N, Sigma->DV, N*sizeof(double));
+   };
+  SSS->SolveBEMSystem(M, RHS);
+
   HMatrix *QP        = new HMatrix(NS, 4);
   for(int Mu=0; Mu<3; Mu++)
    { 
-     SSS->AssembleRHSVector(0, PhiEConstant, (void *)(&Mu), Sigma);
-     M->LUSolve(Sigma);
+     memcpy(Sigma->DV, RHS->DM + Mu*N, N*sizeof(double));
      SSS->GetCartesianMoments(Sigma, QP);
      for(int ns=0; ns<NS; ns++)
       { PolMatrix->SetEntry(ns, 0*3+Mu, QP->GetEntryD(ns,1));
@@ -152,6 +159,7 @@ void GetPolarizabilities(SSSolver *SSS, HMatrix *M, HVector *Sigma, char *FileNa
       };
    };
   delete QP;
+  delete RHS;
 
   /*--------------------------------------------------------------*/
   /*--------------------------------------------------------------*/
@@ -197,20 +205,35 @@ HMatrix *ComputeCapacitanceMatrix(SSSolver *SSS, HMatrix *M,
    C=new HMatrix(NS, NS);
 
   /*--------------------------------------------------------------*/
+  /*- solve for the charge distributions with each conductor held */
+  /*- at unit potential and all others grounded; the NS solves    */
+  /*- share one call to SolveBEMSystem                            */
   /*--------------------------------------------------------------*/
-  /*--------------------------------------------------------------*/
-  HMatrix *QP = new HMatrix(NS, 4);
+  int N = Sigma->N;
+  HMatrix *RHS = new HMatrix(N, NS);
   for(int ns=0; ns<NS; ns++)
    { 
      memset(Potentials, 0, NS*sizeof(double));
      Potentials[ns]=1.0;
      SSS->AssembleRHSVector(Potentials, 0, 0, Sigma);
-     M->LUSolve(Sigma);
+     memcpy(RHS->DM + ns*N, Sigma->DV, N*sizeof(double));
+   };
+  SSS->SolveBEMSystem(M, RHS);
+
+  /*--------------------------------------------------------------*/
+  /*--------------------------------------------------------------*/
+  /*--------------------------------------------------------------*/
+  HMatrix *QP = new HMatrix(NS, 4);
+  for(int ns=0; ns<NS; ns++)
+   { 
+     memcpy(Sigma->DV, RHS->DM + ns*N, N*sizeof(double));
      SSS->GetCartesianMoments(Sigma, QP);
      for(int nsp=0; nsp<NS; nsp++)
       C->SetEntry(nsp, ns, QP->GetEntry(nsp,0));
    };
   delete QP;
+  delete RHS;
+  delete[] Potentials;
 
   return C;
   
@@ -257,7 +280,7 @@ void GetCMatrix(SSSolver *SSS, HMatrix *M, HVector *Sigma,
       PESD->l = l;
       PESD->m = m;
       SSS->AssembleRHSVector(0, PhiESpherical, (void *)PESD, Sigma);
-      M->LUSolve(Sigma);
+      SSS->SolveBEMSystem(M, Sigma);
 
       /*--------------------------------------------------------------*/
       /*--------------------------------------------------------------*/
@@ -389,7 +412,7 @@ void DoFieldCalculation(SSSolver *SSS, HMatrix *M, HVector *Sigma,
   /***************************************************************/
   /* solve the problem *******************************************/
   /***************************************************************/
-  M->LUSolve(Sigma);
+  SSS->SolveBEMSystem(M, Sigma);
 
   /***************************************************************/
   /***************************************************************/
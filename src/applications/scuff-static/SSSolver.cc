@@ -49,6 +49,7 @@ namespace scuff {
 SSSolver::SSSolver(const char *GeoFileName, int LogLevel)
 {
   G=new RWGGeometry(GeoFileName, LogLevel);
+  FastSolver=0;
 }
 
 /***********************************************************************/
@@ -56,6 +57,7 @@ SSSolver::SSSolver(const char *GeoFileName, int LogLevel)
 /***********************************************************************/
 SSSolver::~SSSolver()
 {
+  DestroyFastSolver();
   delete G;
 }
 
@@ -102,6 +104,60 @@ HMatrix *SSSolver::AssembleBEMMatrix(HMatrix *M)
 
 }
 
+/***********************************************************************/
+/* classify surface S and get the material parameter (Delta for        */
+/* dielectric surfaces, Lambda for lambda surfaces) that enters the    */
+/* rows of the BEM matrix corresponding to its panels.                 */
+/***********************************************************************/
+SurfType SSSolver::GetSurfaceType(RWGSurface *S, double *Delta, double *Lambda)
+{
+  *Delta=*Lambda=0.0;
+  if (S->IsPEC)
+   return PEC;
+
+  double EpsR  = real( G->RegionMPs[ S->RegionIndices[0] ] -> GetEps(0.0) );
+  cdouble EpsRP = G->RegionMPs[ S->RegionIndices[1] ] -> GetEps(0.0);
+
+  if ( real(EpsRP)==0.0 && imag(EpsRP)<=0.0 )
+   { *Lambda = -imag(EpsRP);
+     return LAMBDASURFACE;
+   };
+
+  *Delta = 2.0*(EpsR - real(EpsRP)) / (EpsR + real(EpsRP));
+  return DIELECTRIC;
+}
+
+/***********************************************************************/
+/* a single element of the BEM matrix. (SurfaceType, Delta, Lambda are */
+/* the values returned by GetSurfaceType for Sa.)                      */
+/***********************************************************************/
+double SSSolver::GetBEMMatrixEntry(RWGSurface *Sa, int npa,
+                                   RWGSurface *Sb, int npb,
+                                   SurfType SurfaceType,
+                                   double Delta, double Lambda)
+{
+  double MatrixEntry=0.0;
+  switch(SurfaceType)
+   {
+     case PEC:
+       MatrixEntry = GetPPI(Sa,npa,Sb,npb,0);
+       break;
+
+     case LAMBDASURFACE:
+       MatrixEntry = -1.0*GetPPI(Sa,npa,Sb,npb,0);
+       if (Sa==Sb && npa==npb) MatrixEntry -= Lambda*Sa->Panels[npa]->Area;
+       break;
+
+     case DIELECTRIC:
+       if (Sa==Sb && npa==npb)
+        MatrixEntry = Sa->Panels[npa]->Area;
+       else 
+        MatrixEntry = Delta * GetPPI(Sa,npa,Sb,npb,1);
+       break;
+   };
+  return MatrixEntry;
+}
+
 /***********************************************************************/
 /***********************************************************************/
 /***********************************************************************/
@@ -117,23 +173,8 @@ void SSSolver::AssembleBEMMatrixBlock(int nsa, int nsb,
   /***************************************************************/
   /***************************************************************/
   /***************************************************************/
-  SurfType SurfaceType;
-  double Delta=0.0, Lambda=0.0;
-  if (Sa->IsPEC)
-   SurfaceType = PEC;
-  else
-   { double EpsR  = real( G->RegionMPs[ Sa->RegionIndices[0] ] -> GetEps(0.0) );
-     cdouble EpsRP = G->RegionMPs[ Sa->RegionIndices[1] ] -> GetEps(0.0);
-
-     if ( real(EpsRP)==0.0 && imag(EpsRP)<=0.0 )
-      { SurfaceType = LAMBDASURFACE;
-        Lambda = -imag(EpsRP);
-      }
-     else
-      { SurfaceType = DIELECTRIC;
-        Delta = 2.0*(EpsR - real(EpsRP)) / (EpsR + real(EpsRP));
-      };
-   };
+  double Delta, Lambda;
+  SurfType SurfaceType = GetSurfaceType(Sa, &Delta, &Lambda);
 
   /***************************************************************/
   /***************************************************************/
@@ -147,25 +188,8 @@ void SSSolver::AssembleBEMMatrixBlock(int nsa, int nsb,
    for(int npb=0; npb<Sb->NumPanels; npb++)
     { 
       if (npb==0) LogPercent(npa, Sa->NumPanels);
-      double MatrixEntry=0.0;
-      switch(SurfaceType)
-       {
-         case PEC:
-           MatrixEntry = GetPPI(Sa,npa,Sb,npb,0);
-           break;
-
-         case LAMBDASURFACE:
-           MatrixEntry = -1.0*GetPPI(Sa,npa,Sb,npb,0);
-           if (Sa==Sb && npa==npb) MatrixEntry -= Lambda*Sa->Panels[npa]->Area;
-           break;
-
-         case DIELECTRIC:
-           if (Sa==Sb && npa==npb)
-            MatrixEntry = Sa->Panels[npa]->Area;
-           else 
-            MatrixEntry = Delta * GetPPI(Sa,npa,Sb,npb,1);
-           break;
-       };
+      double MatrixEntry
+       = GetBEMMatrixEntry(Sa, npa, Sb, npb, SurfaceType, Delta, Lambda);
       M->SetEntry(RowOffset + npa, ColOffset + npb, MatrixEntry); 
     };
 
@@ -77,6 +77,16 @@ class SSSolver
    void AssembleBEMMatrixBlock(int nsa, int nsb,
                                HMatrix *M, int RowOffset=0, int ColOffset=0);
 
+   /* fast (matrix-free) solver for large geometries (FastSolver.cc) */
+   void InitFastSolver(double Tolerance=1.0e-6, int MultipoleOrder=6);
+   void DestroyFastSolver();
+   HMatrix *ApplyBEMMatrix(HMatrix *X, HMatrix *Y=NULL);
+
+   /* solve the BEM system, using the fast solver if it was */
+   /* initialized and the LU-factorized matrix M otherwise  */
+   void SolveBEMSystem(HMatrix *M, HMatrix *RHS);
+   void SolveBEMSystem(HMatrix *M, HVector *RHS);
+
    /* routines for allocating, and then filling in, the RHS vector */
    HVector *AllocateRHSVector();
    HVector *AssembleRHSVector(double *Potentials, StaticField *SF, 
@@ -99,6 +109,9 @@ class SSSolver
    /*- would be private if we cared about the public/private distinction */
    /*--------------------------------------------------------------------*/ 
    double GetPPI(RWGSurface *Sa, int npa, RWGSurface *Sb, int npb, int WhichIntegral);
+   SurfType GetSurfaceType(RWGSurface *S, double *Delta, double *Lambda);
+   double GetBEMMatrixEntry(RWGSurface *Sa, int npa, RWGSurface *Sb, int npb,
+                            SurfType SurfaceType, double Delta, double Lambda);
    double GetPhiE(int ns, int np, double *X, double PhiE[4]);
 
    /*--------------------------------------------------------------------*/ 
@@ -107,6 +120,9 @@ class SSSolver
    /*--------------------------------------------------------------------*/ 
    RWGGeometry *G;
 
+   // opaque data for the fast solver (FastSolver.cc), or NULL
+   void *FastSolver;
+
  };
 
 }
@@ -82,7 +82,11 @@ int main(int argc, char *argv[])
   char *Cache       = 0;
   char *ReadCache[MAXCACHE];         int nReadCache;
   char *WriteCache  = 0;
+  char *SnapshotDir = 0;
   char *ConstField  = 0;
+  bool FastSolver   = false;
+  double GMRESTol   = 1.0e-6;
+  int MultipoleOrder = 6;
   /* name               type    #args  max_instances  storage           count         description*/
   OptStruct OSArray[]=
    { 
@@ -107,10 +111,17 @@ int main(int argc, char *argv[])
      {"Cache",          PA_STRING,  1, 1,       (void *)&Cache,      0,             "read/write cache"},
      {"ReadCache",      PA_STRING,  1, MAXCACHE,(void *)ReadCache,   &nReadCache,   "read cache"},
      {"WriteCache",     PA_STRING,  1, 1,       (void *)&WriteCache, 0,             "write cache"},
+     {"SnapshotDir",    PA_STRING,  1, 1,       (void *)&SnapshotDir, 0,             "directory for cached geometry snapshots"},
+/**/
+     {"FastSolver",     PA_BOOL,    0, 1,       (void *)&FastSolver, 0,             "use the matrix-free fast-multipole/GMRES solver"},
+     {"GMRESTol",       PA_DOUBLE,  1, 1,       (void *)&GMRESTol,   0,             "relative residual tolerance for --FastSolver"},
+     {"MultipoleOrder", PA_INT,     1, 1,       (void *)&MultipoleOrder, 0,         "multipole expansion order for --FastSolver"},
 /**/
      {0,0,0,0,0,0,0}
    };
   ProcessOptions(argc, argv, OSArray);
+  if (SnapshotDir)
+   RWGGeometry::SetSnapshotDir(SnapshotDir);
 
   if (GeoFile==0)
    OSUsage(argv[0], OSArray, "--geometry option is mandatory");
@@ -149,7 +160,7 @@ int main(int argc, char *argv[])
   /* create the ScuffStaticGeometry **********************************/
   /*******************************************************************/
   SSSolver *SSS   = new SSSolver(GeoFile);
-  HMatrix *M      = SSS->AllocateBEMMatrix();
+  HMatrix *M      = FastSolver ? 0 : SSS->AllocateBEMMatrix();
   HVector *Sigma  = SSS->AllocateRHSVector();
 
   /*******************************************************************/
@@ -166,10 +177,16 @@ int main(int argc, char *argv[])
    PreloadCache( Cache );
 
   /*******************************************************************/
-  /* assemble and factorize the BEM matrix                           */
+  /* assemble and factorize the BEM matrix, or (for large problems)  */
+  /* set up the fast solver, in which case the full matrix is never  */
+  /* formed and M stays NULL                                         */
   /*******************************************************************/
-  SSS->AssembleBEMMatrix(M);
-  M->LUFactorize();
+  if (FastSolver)
+   SSS->InitFastSolver(GMRESTol, MultipoleOrder);
+  else
+   { SSS->AssembleBEMMatrix(M);
+     M->LUFactorize();
+   };
 
   /*******************************************************************/
   /* now switch off depending on the type of calculation the user    */
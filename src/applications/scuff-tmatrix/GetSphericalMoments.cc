@@ -412,5 +412,96 @@ HVector *GetSphericalMoments(RWGGeometry *G, cdouble k, int lMax,
   /***************************************************************/
   /***************************************************************/
   delete Scratch;
+
+  return AVector;
    
 }
+
+/***************************************************************/
+/* the spherical moments computed by GetSphericalMoments() are */
+/* linear in the surface-current vector KN: AVector = P * KN,  */
+/* where P is the NumMoments x TotalBFs matrix computed here.  */
+/* for a block of surface-current vectors (one per column) the */
+/* moments are then obtained by a single matrix-matrix product,*/
+/* with the projection integrals over each edge done only once.*/
+/***************************************************************/
+HMatrix *GetSphericalProjectionMatrix(RWGGeometry *G, cdouble k, int lMax,
+                                      HMatrix *PMatrix)
+{
+  int NumLMs = (lMax+1)*(lMax+1);
+  int NumMoments = 2*NumLMs; // a^E and a^M moments for each l,m
+  int NBF = G->TotalBFs;
+
+  /***************************************************************/
+  /* (re)allocate the PMatrix as necessary ***********************/
+  /***************************************************************/
+  if ( PMatrix && (PMatrix->NR!=NumMoments || PMatrix->NC!=NBF) )
+   { Warn("wrong-size PMatrix passed to GetSphericalProjectionMatrix (reallocating...)");
+     delete PMatrix;
+     PMatrix=0;
+   };
+  if ( PMatrix==0 )
+   PMatrix=new HMatrix(NumMoments, NBF, LHM_COMPLEX);
+  PMatrix->Zero();
+
+  /***************************************************************/
+  /* flat table of (surface, edge) pairs *************************/
+  /***************************************************************/
+  int NumEdges=0;
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   NumEdges += G->Surfaces[ns]->NumEdges;
+  int *EdgeSurface = new int[NumEdges], *EdgeIndex = new int[NumEdges];
+  for(int nn=0, ns=0; ns<G->NumSurfaces; ns++)
+   for(int ne=0; ne<G->Surfaces[ns]->NumEdges; ne++, nn++)
+    { EdgeSurface[nn]=ns;
+      EdgeIndex[nn]=ne;
+    };
+
+  /***************************************************************/
+  /* one column (PEC) or two columns (non-PEC) of P per edge,    */
+  /* with the same coefficients as in GSM_Thread above           */
+  /***************************************************************/
+  Log("Computing spherical projection matrix (%i moments, %i basis functions)...",NumMoments,NBF);
+  cdouble k2=k*k;
+  int NumThreads=GetNumThreads();
+#ifndef USE_OPENMP
+  NumThreads=1;
+#else
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+  for(int nn=0; nn<NumEdges; nn++)
+   { 
+     LogPercent(nn, NumEdges);
+
+     int ns=EdgeSurface[nn], ne=EdgeIndex[nn];
+     RWGSurface *S=G->Surfaces[ns];
+     int Offset=G->BFIndexOffset[ns];
+
+     cdouble *Workspace   = new cdouble[12*NumLMs];
+     cdouble *MProjection = Workspace + 10*NumLMs;
+     cdouble *NProjection = Workspace + 11*NumLMs;
+     GetMNProjections(S, ne, k, lMax, Workspace, MProjection, NProjection);
+
+     for(int nLM=0; nLM<NumLMs; nLM++)
+      { 
+        if ( S->IsPEC )
+         { PMatrix->SetEntry(2*nLM+0, Offset+ne, -k2*ZVAC*MProjection[nLM]);
+           PMatrix->SetEntry(2*nLM+1, Offset+ne, -k2*ZVAC*NProjection[nLM]);
+         }
+        else
+         { // KAlpha = KN[2*ne+0], NAlpha = -ZVAC*KN[2*ne+1]
+           PMatrix->SetEntry(2*nLM+0, Offset+2*ne+0, -k2*ZVAC*MProjection[nLM]);
+           PMatrix->SetEntry(2*nLM+1, Offset+2*ne+0, -k2*ZVAC*NProjection[nLM]);
+           PMatrix->SetEntry(2*nLM+0, Offset+2*ne+1, -k2*ZVAC*NProjection[nLM]);
+           PMatrix->SetEntry(2*nLM+1, Offset+2*ne+1, +k2*ZVAC*MProjection[nLM]);
+         };
+      };
+
+     delete[] Workspace;
+   };
+
+  delete[] EdgeSurface;
+  delete[] EdgeIndex;
+
+  return PMatrix;
+}
@@ -23,14 +23,23 @@
  * homer reid          -- 11/2009 -- 2/2012
  */
 
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
 #include <libhrutil.h>
 #include <libIncField.h>
 #include <libSpherical.h>
+#include <libTriInt.h>
+#include "libscuff.h"
 #include "SphericalWave.h"
 
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+using namespace scuff;
+
 #define II cdouble(0.0,1.0)
 
 /**********************************************************************/
@@ -94,3 +103,181 @@ void SphericalWave::GetFields(const double X[3], cdouble EHC[6])
   VectorS2C(Theta, Phi, EHS+3, EHC+3);
 
 }
+
+/**********************************************************************/
+/* RHS vectors for all incident spherical waves up to lMax at once:   */
+/* column #nc=2*(l*l+l+m)+Type of the TotalBFs x NumMoments matrix    */
+/* RMatrix is the vector that G->AssembleRHSVector would produce for  */
+/* a SphericalWave with the given (l,m,Type). (the l=0 columns are    */
+/* left zero.)                                                        */
+/*                                                                    */
+/* as in AssembleRHSVector, we first compute moments of the incident  */
+/* fields over each panel and then combine the moments of the two     */
+/* panels of each edge; here, though, a single call to GetMNlmArray   */
+/* at each cubature point yields the fields of all waves at once.     */
+/**********************************************************************/
+#define SWRHS_TCRORDER 20
+HMatrix *GetSphericalWaveRHSMatrix(RWGGeometry *G, cdouble Omega, int lMax,
+                                   HMatrix *RMatrix)
+{
+  int NumLMs = (lMax+1)*(lMax+1);
+  int NumMoments = 2*NumLMs;
+  int NBF = G->TotalBFs;
+
+  if ( RMatrix && (RMatrix->NR!=NBF || RMatrix->NC!=NumMoments) )
+   { Warn("wrong-size RMatrix passed to GetSphericalWaveRHSMatrix (reallocating...)");
+     delete RMatrix;
+     RMatrix=0;
+   };
+  if ( RMatrix==0 )
+   RMatrix=new HMatrix(NBF, NumMoments, LHM_COMPLEX);
+  RMatrix->Zero();
+
+  /*--------------------------------------------------------------*/
+  /*- wavenumber, impedance, and source region of the incident    */
+  /*- waves, exactly as they would be set up by AssembleRHSVector */
+  /*--------------------------------------------------------------*/
+  SphericalWave SW;
+  G->UpdateIncFields(&SW, Omega);
+  cdouble K = sqrt(SW.Eps*SW.Mu) * Omega;
+  cdouble Z = ZVAC*sqrt(SW.Mu/SW.Eps);
+
+  /*--------------------------------------------------------------*/
+  /*- fields sourced in the region on the positive (negative)    -*/
+  /*- side of a surface contribute with a plus (minus) sign      -*/
+  /*--------------------------------------------------------------*/
+  double *SurfaceSign = new double[G->NumSurfaces];
+  cdouble **PanelMoments = new cdouble *[G->NumSurfaces];
+  int NumPanels=0;
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   { RWGSurface *S=G->Surfaces[ns];
+     SurfaceSign[ns] = (S->RegionIndices[1]==SW.RegionIndex) ?  1.0 :
+                       (S->RegionIndices[0]==SW.RegionIndex) ? -1.0 : 0.0;
+     PanelMoments[ns] = 0;
+     if (SurfaceSign[ns]==0.0) continue;
+     PanelMoments[ns] = (cdouble *)mallocEC(8*NumLMs*S->NumPanels*sizeof(cdouble));
+     NumPanels += S->NumPanels;
+   };
+
+  int *PanelSurface = new int[NumPanels], *PanelIndex = new int[NumPanels];
+  for(int nn=0, ns=0; ns<G->NumSurfaces; ns++)
+   if (PanelMoments[ns])
+    for(int np=0; np<G->Surfaces[ns]->NumPanels; np++, nn++)
+     { PanelSurface[nn]=ns;
+       PanelIndex[nn]=np;
+     };
+
+  /*--------------------------------------------------------------*/
+  /*- panel moments: for each (l,m), PM[0..3] are the moments     */
+  /*- \int M, \int (x-XC).M and PM[4..7] the same for N          */
+  /*--------------------------------------------------------------*/
+  Log("Computing spherical-wave RHS matrix (%i waves, %i panels)...",NumMoments,NumPanels);
+  int NumPts;
+  double *TCR = GetTCR(SWRHS_TCRORDER, &NumPts);
+  int NumThreads=GetNumThreads();
+#ifndef USE_OPENMP
+  NumThreads=1;
+#else
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+  for(int nn=0; nn<NumPanels; nn++)
+   { 
+     int ns=PanelSurface[nn], np=PanelIndex[nn];
+     RWGSurface *S=G->Surfaces[ns];
+     RWGPanel *P = S->Panels[np];
+     double *V0  = S->Vertices + 3*(P->VI[0]);
+     double *V1  = S->Vertices + 3*(P->VI[1]);
+     double *V2  = S->Vertices + 3*(P->VI[2]);
+     double *XC  = P->Centroid;
+     double JFac = 2.0*P->Area;
+
+     cdouble *MArray = new cdouble[6*NumLMs];
+     cdouble *NArray = MArray + 3*NumLMs;
+     cdouble *PM = PanelMoments[ns] + 8*NumLMs*np;
+     memset(PM, 0, 8*NumLMs*sizeof(cdouble));
+
+     for(int ncp=0; ncp<NumPts; ncp++)
+      { 
+        double u=TCR[3*ncp+0], v=TCR[3*ncp+1], w=JFac*TCR[3*ncp+2];
+        double X[3], XmXC[3];
+        for(int Mu=0; Mu<3; Mu++)
+         X[Mu] = V0[Mu] + u*(V1[Mu]-V0[Mu]) + v*(V2[Mu]-V0[Mu]);
+        VecSub(X, XC, XmXC);
+
+        double r, Theta, Phi;
+        CoordinateC2S(X, &r, &Theta, &Phi);
+        GetMNlmArray(lMax, K, r, Theta, Phi, LS_REGULAR, MArray, NArray);
+
+        for(int nLM=1; nLM<NumLMs; nLM++)
+         { cdouble MC[3], NC[3];
+           VectorS2C(Theta, Phi, MArray + 3*nLM, MC);
+           VectorS2C(Theta, Phi, NArray + 3*nLM, NC);
+           cdouble *PMLM = PM + 8*nLM;
+           for(int Mu=0; Mu<3; Mu++)
+            { PMLM[Mu]   += w*MC[Mu];
+              PMLM[4+Mu] += w*NC[Mu];
+            };
+           PMLM[3] += w*(XmXC[0]*MC[0] + XmXC[1]*MC[1] + XmXC[2]*MC[2]);
+           PMLM[7] += w*(XmXC[0]*NC[0] + XmXC[1]*NC[1] + XmXC[2]*NC[2]);
+         };
+      };
+
+     delete[] MArray;
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- combine panel moments into basis-function inner products.   */
+  /*- the magnetic wave has E=M, H=-N/Z; the electric wave has    */
+  /*- E=N, H=M/Z.                                                 */
+  /*--------------------------------------------------------------*/
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   { 
+     if (PanelMoments[ns]==0) 
+      continue;
+
+     RWGSurface *S=G->Surfaces[ns];
+     int Offset=G->BFIndexOffset[ns];
+     for(int ne=0; ne<S->NumEdges; ne++)
+      for(int nLM=1; nLM<NumLMs; nLM++)
+       { 
+         RWGEdge *E = S->Edges[ne];
+         cdouble MProd=0.0, NProd=0.0;
+         for(int Sign=1; Sign>=-1; Sign-=2)
+          { 
+            int iQ = (Sign==1) ? E->iQP     : E->iQM;
+            int np = (Sign==1) ? E->iPPanel : E->iMPanel;
+            if (iQ==-1) continue;
+
+            RWGPanel *P = S->Panels[np];
+            cdouble *PM = PanelMoments[ns] + 8*NumLMs*np + 8*nLM;
+            double PreFac = SurfaceSign[ns] * Sign * E->Length / (2.0*P->Area);
+            double XCmQ[3];
+            VecSub(P->Centroid, S->Vertices + 3*iQ, XCmQ);
+
+            MProd += PreFac*( PM[3] + XCmQ[0]*PM[0] + XCmQ[1]*PM[1] + XCmQ[2]*PM[2] );
+            NProd += PreFac*( PM[7] + XCmQ[0]*PM[4] + XCmQ[1]*PM[5] + XCmQ[2]*PM[6] );
+          };
+
+         int ncM = 2*nLM + SW_MAGNETIC, ncE = 2*nLM + SW_ELECTRIC;
+         if ( S->IsPEC )
+          { RMatrix->SetEntry(Offset + ne, ncM, MProd / ZVAC);
+            RMatrix->SetEntry(Offset + ne, ncE, NProd / ZVAC);
+          }
+         else
+          { RMatrix->SetEntry(Offset + 2*ne+0, ncM, MProd / ZVAC);
+            RMatrix->SetEntry(Offset + 2*ne+1, ncM, -1.0*NProd / Z);
+            RMatrix->SetEntry(Offset + 2*ne+0, ncE, NProd / ZVAC);
+            RMatrix->SetEntry(Offset + 2*ne+1, ncE, MProd / Z);
+          };
+       };
+
+     free(PanelMoments[ns]);
+   };
+
+  delete[] PanelMoments;
+  delete[] SurfaceSign;
+  delete[] PanelSurface;
+  delete[] PanelIndex;
+
+  return RMatrix;
+}
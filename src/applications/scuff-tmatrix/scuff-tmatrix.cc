@@ -51,6 +51,12 @@ HVector *GetSphericalMoments(RWGSurface *S, cdouble k, int lMax,
 HVector *GetSphericalMoments(RWGGeometry *S, cdouble k, int lMax,
                              HVector *KNVector, HVector *AVector=0);
 
+HMatrix *GetSphericalProjectionMatrix(RWGGeometry *G, cdouble k, int lMax,
+                                      HMatrix *PMatrix=0);
+
+HMatrix *GetSphericalWaveRHSMatrix(RWGGeometry *G, cdouble Omega, int lMax,
+                                   HMatrix *RMatrix=0);
+
 /***************************************************************/
 /***************************************************************/
 /***************************************************************/
@@ -64,6 +70,7 @@ int main(int argc, char *argv[])
   cdouble Omega=0;      // angular frequency at which to run the computation
   char *OmegaFile=0;    // list of angular frequencies
   char *Cache=0;        // scuff cache file 
+  char *SnapshotDir=0;  // directory for cached geometry snapshots
   /* name        type    #args  max_instances  storage    count  description*/
   OptStruct OSArray[]=
    { {"geometry",  PA_STRING,  1, 1, (void *)&GeoFileName,  0,  ".scuffgeo file"},
@@ -71,9 +78,12 @@ int main(int argc, char *argv[])
      {"Omega",     PA_CDOUBLE, 1, 1, (void *)&Omega,        0,  "angular frequency"},
      {"OmegaFile", PA_STRING,  1, 1, (void *)&OmegaFile,    0,  "list of angular frequencies"},
      {"Cache",     PA_STRING,  1, 1, (void *)&Cache,        0,  "scuff cache file"},
+     {"SnapshotDir", PA_STRING, 1, 1, (void *)&SnapshotDir, 0,  "directory for cached geometry snapshots"},
      {0,0,0,0,0,0,0}
    };
   ProcessOptions(argc, argv, OSArray);
+  if (SnapshotDir)
+   RWGGeometry::SetSnapshotDir(SnapshotDir);
   if (GeoFileName==0)
    OSUsage(argv[0],OSArray,"--geometry option is mandatory");
 
@@ -100,23 +110,20 @@ int main(int argc, char *argv[])
    PreloadCache(Cache);
 
   /*--------------------------------------------------------------*/
-  /* preallocate BEM matrix and RHS vector                        */
+  /* preallocate BEM matrix                                       */
   /*--------------------------------------------------------------*/
   HMatrix *M  = G->AllocateBEMMatrix();
-  HVector *KN = G->AllocateRHSVector();
 
   /*--------------------------------------------------------------*/
-  /*- preallocate an HMatrix to store the T-matrix data           */
+  /*- preallocate HMatrices to store the T-matrix data, the RHS   */
+  /*- vectors for all incident spherical waves (one per column),  */
+  /*- and the projection of the basis functions onto the outgoing */
+  /*- spherical waves                                             */
   /*--------------------------------------------------------------*/
   int NumMoments= 2*(lMax+1)*(lMax+1);
   HMatrix *TMatrix = new HMatrix(NumMoments, NumMoments, LHM_COMPLEX);
-  HVector *AVector = new HVector(NumMoments, LHM_COMPLEX);
-
-  /*--------------------------------------------------------------*/
-  /* instantiate a SphericalWave structure (we will set the l, m, */
-  /* and Type fields later)                                       */
-  /*--------------------------------------------------------------*/
-  SphericalWave SW;
+  HMatrix *RMatrix = new HMatrix(G->TotalBFs, NumMoments, LHM_COMPLEX);
+  HMatrix *PMatrix = new HMatrix(NumMoments, G->TotalBFs, LHM_COMPLEX);
 
   /*--------------------------------------------------------------*/
   /*- outer loop over frequencies --------------------------------*/
@@ -138,35 +145,18 @@ int main(int argc, char *argv[])
      M->LUFactorize();
 
      /*--------------------------------------------------------------*/
-     /*- inner loop over incident spherical waves (i.e. over columns-*/
-     /*- of the T matrix; note nc is a running column index)        -*/
+     /*- solve the scattering problems for all incident spherical    */
+     /*- waves at once: column #nc of RMatrix is the RHS vector for  */
+     /*- the nc-th wave (nc is a running index over (l,m,Type)), and */
+     /*- the T-matrix is P * M^{-1} * R, where the projection matrix */
+     /*- P maps surface currents to induced spherical moments.       */
      /*--------------------------------------------------------------*/
-     TMatrix->Zero();
-     for(nc=l=0; l<=lMax; l++)
-      for(m=-l; m<=l; m++)
-       for(Type=SW_MAGNETIC; Type<=SW_ELECTRIC; Type++, nc++)
-        { 
-          if (l==0) 
-           continue;
-
-           SW.SetType(Type);
-           SW.SetL(l);
-           SW.SetM(m);
-
-           // solve the scattering problem for this incident spherical wave
-           Log("Solving scattering problem with incident spherical wave P(l,m)=%c(%i,%i)",TypeChar[Type],l,m);
-           G->AssembleRHSVector(Omega, &SW, KN);
-           M->LUSolve(KN);
-
-           // compute the spherical multipole moments induced by the 
-           // incident wave on the object 
-           GetSphericalMoments(G, Omega, lMax, KN, AVector);
-
-           // stamp in the vector of moments as the ncth row of the T-matrix
-           for(nr=0; nr<NumMoments; nr++)
-            TMatrix->SetEntry(nr, nc, AVector->GetEntry(nr));
+     Log("Solving scattering problems for %i incident spherical waves",NumMoments-2);
+     GetSphericalWaveRHSMatrix(G, Omega, lMax, RMatrix);
+     M->LUSolve(RMatrix);
 
-        }; // for (nc=l=0...)
+     GetSphericalProjectionMatrix(G, Omega, lMax, PMatrix);
+     PMatrix->Multiply(RMatrix, TMatrix);
 
      /*--------------------------------------------------------------*/
      /*- write the full content of the T-matrix at this frequency to */
@@ -191,6 +181,10 @@ int main(int argc, char *argv[])
     }; // for( nOmega= ... )
 
   fclose(TextOutputFile);
+  delete TMatrix;
+  delete RMatrix;
+  delete PMatrix;
+  delete M;
       
   /*--------------------------------------------------------------*/
   /*--------------------------------------------------------------*/
@@ -0,0 +1,659 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * TransmissionFlux.cc -- transmitted and reflected fluxes, transmission
+ *                     -- amplitudes, and BEM-matrix assembly for
+ *                     -- scuff-transmission
+ *
+ * homer reid          -- 9/2012
+ * agent               -- 10/2026
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "scuff-transmission.h"
+
+/*******************************************************************/
+/* this is a 9th-order, 17-point cubature rule for the unit square */
+/* with corners {(0,0) (1,0) (1,1) (1,0)}.                         */
+/* array entries:                                                  */
+/*  x_0, y_0, w_0,                                                 */
+/*  x_1, y_1, w_1,                                                 */
+/*  ...                                                            */
+/*  x_16, y_16, w_16                                               */
+/* where (x_n, y_n) and w_n are the nth cubature point and weight. */
+/*******************************************************************/
+double SCR9[]={
+  +5.0000000000000000e-01, +5.0000000000000000e-01, +1.3168724279835392e-01,
+  +9.8442498318098881e-01, +8.1534005986583447e-01, +2.2219844542549678e-02,
+  +9.8442498318098881e-01, +1.8465994013416559e-01, +2.2219844542549678e-02,
+  +1.5575016819011134e-02, +8.1534005986583447e-01, +2.2219844542549678e-02,
+  +1.5575016819011134e-02, +1.8465994013416559e-01, +2.2219844542549678e-02,
+  +8.7513854998945029e-01, +9.6398082297978482e-01, +2.8024900532399120e-02,
+  +8.7513854998945029e-01, +3.6019177020215176e-02, +2.8024900532399120e-02,
+  +1.2486145001054971e-01, +9.6398082297978482e-01, +2.8024900532399120e-02,
+  +1.2486145001054971e-01, +3.6019177020215176e-02, +2.8024900532399120e-02,
+  +7.6186791010721466e-01, +7.2666991056782360e-01, +9.9570609815517519e-02,
+  +7.6186791010721466e-01, +2.7333008943217640e-01, +9.9570609815517519e-02,
+  +2.3813208989278534e-01, +7.2666991056782360e-01, +9.9570609815517519e-02,
+  +2.3813208989278534e-01, +2.7333008943217640e-01, +9.9570609815517519e-02,
+  +5.3810416409630857e-01, +9.2630786466683113e-01, +6.7262834409945196e-02,
+  +5.3810416409630857e-01, +7.3692135333168873e-02, +6.7262834409945196e-02,
+  +4.6189583590369143e-01, +9.2630786466683113e-01, +6.7262834409945196e-02,
+  +4.6189583590369143e-01, +7.3692135333168873e-02, +6.7262834409945196e-02 
+};
+
+/*******************************************************************/
+/* get the transmitted and reflected flux by integrating the       */
+/* scattered poynting vector over the area of the unit cell.       */
+/*                                                                 */
+/* more specifically, the transmitted power is the integral of     */
+/* the upward-directed poynting vector at ZAbove, while the        */
+/* reflected power is the integral of the downward-directed        */
+/* poynting vector at ZBelow; the flux is the power divided by     */
+/* the area of the unit cell.                                      */
+/*                                                                 */
+/* Return values: TRFlux[0,1] = transmitted, reflected flux        */
+/*******************************************************************/
+void GetTRFlux(RWGGeometry *G, IncField *IF, HVector *KN, cdouble Omega, 
+               int NQPoints, double *kBloch, 
+               double ZAbove, double ZBelow, double *TRFlux)
+{
+  double *SCR=SCR9;
+
+  /***************************************************************/
+  /***************************************************************/
+  /***************************************************************/
+  int NCP; // number of cubature points
+  if (NQPoints==0)
+   NCP=17; 
+  else
+   NCP=NQPoints*NQPoints;
+
+  /***************************************************************/
+  /* on the first invocation we allocate space for the matrices  */
+  /* of evaluation points and fields.                            */
+  /***************************************************************/
+  static HMatrix *XMatrixAbove = 0, *XMatrixBelow = 0;
+  static HMatrix *FMatrixAbove = 0, *FMatrixBelow = 0;
+  if (XMatrixAbove==0)
+   { XMatrixAbove = new HMatrix(NCP, 3 ); 
+     XMatrixBelow = new HMatrix(NCP, 3 ); 
+     FMatrixAbove = new HMatrix(NCP, 6, LHM_COMPLEX);
+     FMatrixBelow = new HMatrix(NCP, 6, LHM_COMPLEX);
+   };
+
+  /***************************************************************/ 
+  /* fill in coordinates of evaluation points.                   */ 
+  /* the first NCP points are for the upper surface; the next    */ 
+  /* NCP points are for the lower surface.                       */ 
+  /***************************************************************/ 
+  double x, y, *LBV[2];
+  LBV[0]=G->LBasis[0];
+  LBV[1]=G->LBasis[1];
+  if (NQPoints==0)
+   { for(int ncp=0; ncp<NCP; ncp++)
+      { 
+        x=SCR[3*ncp+0];
+        y=SCR[3*ncp+1];
+
+        XMatrixAbove->SetEntry(ncp, 0, x*LBV[0][0] + y*LBV[1][0]);
+        XMatrixAbove->SetEntry(ncp, 1, x*LBV[0][1] + y*LBV[1][1]);
+        XMatrixAbove->SetEntry(ncp, 2, ZAbove);
+
+        XMatrixBelow->SetEntry(ncp, 0, x*LBV[0][0] + y*LBV[1][0]);
+        XMatrixBelow->SetEntry(ncp, 1, x*LBV[0][1] + y*LBV[1][1]);
+        XMatrixBelow->SetEntry(ncp, 2, ZBelow);
+
+      };
+   }
+  else
+   { double Delta = 1.0 / ( (double)NQPoints );
+     for(int nqpx=0, ncp=0; nqpx<NQPoints; nqpx++)
+      for(int nqpy=0; nqpy<NQPoints; nqpy++, ncp++)
+       { 
+         x = ((double)nqpx + 0.5)*Delta;
+         y = ((double)nqpy + 0.5)*Delta;
+
+         XMatrixAbove->SetEntry(ncp, 0, x*LBV[0][0] + y*LBV[1][0]);
+         XMatrixAbove->SetEntry(ncp, 1, x*LBV[0][1] + y*LBV[1][1]);
+         XMatrixAbove->SetEntry(ncp, 2, ZAbove);
+
+         XMatrixBelow->SetEntry(ncp, 0, x*LBV[0][0] + y*LBV[1][0]);
+         XMatrixBelow->SetEntry(ncp, 1, x*LBV[0][1] + y*LBV[1][1]);
+         XMatrixBelow->SetEntry(ncp, 2, ZBelow);
+       };
+   };
+
+  /***************************************************************/ 
+  /* get scattered fields at all cubature points                 */ 
+  /***************************************************************/ 
+  G->GetFields(IF, KN, Omega, kBloch, XMatrixAbove, FMatrixAbove);
+  G->GetFields(0, KN, Omega, kBloch, XMatrixBelow, FMatrixBelow);
+
+  /***************************************************************/
+  /* integrate poynting vector over upper and lower surfaces.    */
+  /* Note: The jacobian in this cubature is the area of the unit */
+  /*       cell, so omitting that factor is equivalent to        */
+  /*       dividing the integrated power by the unit-cell area,  */
+  /*       which is what we want to do anyway.                   */
+  /***************************************************************/
+  double w, PTransmitted=0.0, PReflected=0.0;
+  cdouble E[3], H[3];
+  for(int ncp=0; ncp<NCP; ncp++)
+   {
+     if (NQPoints==0) 
+      w=SCR[3*ncp+2];  // cubature weight
+     else
+      w=1.0/((double)(NCP));
+
+     E[0]=FMatrixAbove->GetEntry(ncp, 0);
+     E[1]=FMatrixAbove->GetEntry(ncp, 1);
+     H[0]=FMatrixAbove->GetEntry(ncp, 3);
+     H[1]=FMatrixAbove->GetEntry(ncp, 4);
+     PTransmitted += 0.5*w*real( E[0]*conj(H[1]) - E[1]*conj(H[0]) );
+
+     E[0]=FMatrixBelow->GetEntry(ncp, 0);
+     E[1]=FMatrixBelow->GetEntry(ncp, 1);
+     H[0]=FMatrixBelow->GetEntry(ncp, 3);
+     H[1]=FMatrixBelow->GetEntry(ncp, 4);
+     PReflected -= 0.5*w*real( E[0]*conj(H[1]) - E[1]*conj(H[0]) );
+
+   };
+
+  /***************************************************************/
+  /***************************************************************/
+  /***************************************************************/
+  TRFlux[0]=PTransmitted;
+  TRFlux[1]=PReflected;
+
+}
+
+/***************************************************************/
+/* J_n(Z) = \int_0^1 u^n e^{-iuZ} du  for n=0,...,4.           */
+/* for |Z|<1 we sum the Taylor series, since the closed-form   */
+/* expressions lose accuracy there; for |Z|>=1 the upward      */
+/* recurrence J_n = (n*J_{n-1} - e^{-iZ}) / (iZ) is stable.    */
+/***************************************************************/
+#define NUMJN 5
+static void GetJn(double Z, cdouble J[NUMJN])
+{
+  if (fabs(Z)<1.0)
+   { cdouble Term=1.0;
+     for(int n=0; n<NUMJN; n++) 
+      J[n]=0.0;
+     for(int k=0; k<20; k++)
+      { for(int n=0; n<NUMJN; n++)
+         J[n] += Term / ((double)(n+k+1));
+        Term *= -II*Z/((double)(k+1));
+      };
+   }
+  else
+   { cdouble ExpMIZ=exp(-II*Z);
+     J[0]=(1.0-ExpMIZ)/(II*Z);
+     for(int n=1; n<NUMJN; n++)
+      J[n]=((double)n*J[n-1] - ExpMIZ)/(II*Z);
+   };
+}
+
+/***************************************************************/
+/* f1 = \int_0^1 \int_0^u u*e^{-i(uX+vY)} dv du                */
+/* f2 = \int_0^1 \int_0^u v*e^{-i(uX+vY)} dv du                */
+/*                                                             */
+/* doing the inner (f1) or outer (f2) integral first gives     */
+/*  f1 = [ J_1(X) - J_1(X+Y) ] / (iY)                          */
+/*  f2 = J_1(Y) J_0(X) + [ J_1(X+Y) - J_1(Y) ] / (iX)          */
+/* which are finite everywhere except for the divided          */
+/* differences at Y=0 (f1) and X=0 (f2). when |Y| (|X|) is     */
+/* below the absolute threshold F1F2_DELTA we replace the      */
+/* divided difference by its Taylor expansion through second   */
+/* order, using dJ_n/dZ = -i J_{n+1}; the threshold balances   */
+/* the O(DELTA^3) truncation error against the O(1/DELTA)      */
+/* cancellation error, and both stay below ~1e-10 (relative).  */
+/***************************************************************/
+#define F1F2_DELTA 3.0e-4
+void f1f2(double X, double Y, cdouble *f1, cdouble *f2)
+{
+  cdouble JX[NUMJN], JY[NUMJN], JXPY[NUMJN];
+  GetJn(X, JX);
+  GetJn(Y, JY);
+  GetJn(X+Y, JXPY);
+
+  if (fabs(Y)<F1F2_DELTA)
+   *f1 = JX[2] - II*Y*JX[3]/2.0 - Y*Y*JX[4]/6.0;
+  else
+   *f1 = (JX[1] - JXPY[1]) / (II*Y);
+
+  if (fabs(X)<F1F2_DELTA)
+   *f2 = JY[1]*JX[0] - JY[2] + II*X*JY[3]/2.0 + X*X*JY[4]/6.0;
+  else
+   *f2 = JY[1]*JX[0] + (JXPY[1] - JY[1]) / (II*X);
+}
+
+/***************************************************************/
+/* compute the vector-valued integral                          */
+/*  \int Exp[-i*(K \cdot X)] b[X] dX                           */
+/***************************************************************/
+void GetEMiKXRWGIntegral(RWGSurface *S, int ne, double K[3], cdouble Integral[3])
+{
+  RWGEdge *E    = S->Edges[ne];
+  double *QP    = S->Vertices + 3*E->iQP;
+  double *V1    = S->Vertices + 3*E->iV1;
+  double *V2    = S->Vertices + 3*E->iV2;
+  double *QM    = S->Vertices + 3*E->iQM;
+  double Length = E->Length;
+
+  double AP[3], AM[3], B[3]; 
+  double KQP=0.0, KAP=0.0, KQM=0.0, KAM=0.0, KB=0.0;
+  for(int Mu=0; Mu<3; Mu++)
+   { AP[Mu] = V1[Mu] - QP[Mu];
+     AM[Mu] = V1[Mu] - QM[Mu];
+      B[Mu] = V2[Mu] - V1[Mu];
+       KQP += K[Mu]*QP[Mu];
+       KAP += K[Mu]*AP[Mu];
+       KQM += K[Mu]*QM[Mu];
+       KAM += K[Mu]*AM[Mu];
+        KB += K[Mu]*B[Mu];
+   };
+
+  cdouble ExpFac, f1, f2;
+
+  f1f2(KAP, KB, &f1, &f2);
+  ExpFac = exp(-II*KQP);
+  for(int Mu=0; Mu<3; Mu++)
+   Integral[Mu] = Length*ExpFac*( f1*AP[Mu] + f2*B[Mu] );
+
+  f1f2(KAM, KB, &f1, &f2);
+  ExpFac = exp(-II*KQM);
+  for(int Mu=0; Mu<3; Mu++)
+   Integral[Mu] -= Length*ExpFac*( f1*AM[Mu] + f2*B[Mu] );
+  
+}
+
+/***************************************************************/
+/* This routine computes the contributions of currents on a    */
+/* single surface to the transmission amplitude.               */
+/***************************************************************/
+void GetTransmissionAmplitudes(RWGGeometry *G, HVector *KN,
+                               int WhichSurface, cdouble EpsPrime,
+                               cdouble Omega, double Theta,
+                               cdouble *ptTE, cdouble *ptTM)
+{
+  double nn = real(sqrt(EpsPrime));
+  cdouble ZPrime = 1.0/nn;
+  double SinThetaPrime = sin(Theta)/nn;
+  double CosThetaPrime = sqrt(1.0-SinThetaPrime*SinThetaPrime);
+
+  /*--------------------------------------------------------------*/
+  /*--------------------------------------------------------------*/
+  /*--------------------------------------------------------------*/
+  double K[3];
+  K[0] = nn*real(Omega)*SinThetaPrime;
+  K[1] = 0.0;
+  K[2] = nn*real(Omega)*CosThetaPrime;
+
+  /*--------------------------------------------------------------*/
+  /*--------------------------------------------------------------*/
+  /*--------------------------------------------------------------*/
+  double EpsTE[3], EpsBarTE[3], EpsTM[3], EpsBarTM[3];
+  EpsTE[0]=0.0;     EpsBarTE[0] = -CosThetaPrime;
+  EpsTE[1]=1.0;     EpsBarTE[1] = 0.0;
+  EpsTE[2]=0.0;     EpsBarTE[2] = +SinThetaPrime;
+
+  EpsTM[0]=+CosThetaPrime;  EpsBarTM[0]=0.0;
+  EpsTM[1]=0.0;             EpsBarTM[1]=1.0;
+  EpsTM[2]=-SinThetaPrime;  EpsBarTM[2]=0.0;
+
+  /*--------------------------------------------------------------*/
+  /*--------------------------------------------------------------*/
+  /*--------------------------------------------------------------*/
+  RWGSurface *S = G->Surfaces[WhichSurface];
+  int BFIndexOffset = G->BFIndexOffset[WhichSurface];
+
+  cdouble tTE=0.0, tTM=0.0;
+  cdouble KAlpha, NAlpha=0.0;
+  for(int ne=0; ne<S->NumEdges; ne++)
+   { 
+     if (S->IsPEC)
+      { 
+        KAlpha=KN->GetEntry( BFIndexOffset + ne );
+      }
+     else
+      { KAlpha=KN->GetEntry( BFIndexOffset + 2*ne + 0 );
+        NAlpha=-ZVAC*KN->GetEntry( BFIndexOffset + 2*ne + 1 );
+      };
+
+     cdouble EMiQXBAlpha[3]; 
+     GetEMiKXRWGIntegral(S, ne, K, EMiQXBAlpha);
+     
+     tTE += KAlpha*(   EpsTE[0]*EMiQXBAlpha[0]
+                     + EpsTE[1]*EMiQXBAlpha[1]
+                     + EpsTE[2]*EMiQXBAlpha[2] 
+                   )
+           +NAlpha*(   EpsBarTE[0]*EMiQXBAlpha[0]
+                     + EpsBarTE[1]*EMiQXBAlpha[1]
+                     + EpsBarTE[2]*EMiQXBAlpha[2] 
+                   );
+     
+     tTM += KAlpha*(   EpsTM[0]*EMiQXBAlpha[0]
+                     + EpsTM[1]*EMiQXBAlpha[1]
+                     + EpsTM[2]*EMiQXBAlpha[2] 
+                   )
+           +NAlpha*(   EpsBarTM[0]*EMiQXBAlpha[0]
+                     + EpsBarTM[1]*EMiQXBAlpha[1]
+                     + EpsBarTM[2]*EMiQXBAlpha[2] 
+                   );
+
+   };
+
+  if (G->LDim!=2)
+   ErrExit("%s: %i: internal error",__FILE__,__LINE__);
+  double *L1 = G->LBasis[0];
+  double *L2 = G->LBasis[1];
+  double UnitCellVolume = L1[0]*L2[1]-L1[1]*L2[0];
+
+  tTE *= ZVAC*ZPrime / (2.0*UnitCellVolume*CosThetaPrime);
+  tTM *= ZVAC*ZPrime / (2.0*UnitCellVolume*CosThetaPrime);
+
+  if (ptTE) *ptTE = tTE;
+  if (ptTM) *ptTM = tTM;
+}
+
+/***************************************************************/
+/* This routine computes the contributions of currents on ALL  */
+/* surfaces bounding the uppermost region to the transmission  */
+/* amplitude.                                                  */
+/***************************************************************/
+void GetTransmissionAmplitudes(RWGGeometry *G, HVector *KN,
+                               int UppermostRegionIndex,
+                               cdouble Omega, double Theta,
+                               cdouble *ptTE, cdouble *ptTM)
+{
+  double EpsPrime 
+   = real( G->RegionMPs[UppermostRegionIndex]->GetEps(Omega) );
+
+  cdouble tTE=0.0, tTM=0.0;
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   { 
+     double Sign;
+
+     if (G->Surfaces[ns]->RegionIndices[0]==UppermostRegionIndex)
+      Sign=1.0;
+     else if (G->Surfaces[ns]->RegionIndices[1]==UppermostRegionIndex)
+      Sign=-1.0;
+     else
+      continue;
+
+     cdouble tTEPartial, tTMPartial;
+     GetTransmissionAmplitudes(G, KN, ns, EpsPrime, Omega, Theta,
+                               &tTEPartial, &tTMPartial);
+
+     tTE += Sign*tTEPartial;
+     tTM += Sign*tTMPartial;
+   };
+
+  if (ptTE) *ptTE = tTE;
+  if (ptTM) *ptTM = tTM;
+}
+
+/***************************************************************/
+/* Get the zeroth-order Floquet-mode (specular) component of   */
+/* the field scattered into region RegionIndex by the surface  */
+/* currents in KN, evaluated at the point X, which must lie    */
+/* above (Upward=true) or below (Upward=false) all surfaces    */
+/* bounding the region.                                        */
+/*                                                             */
+/* Away from the film, the field of a 2D-periodic current      */
+/* distribution is a sum of plane waves whose transverse       */
+/* wavevectors are kBloch plus reciprocal lattice vectors. The */
+/* zeroth-order wave has wavevector k=(kBloch, +-kz), and its  */
+/* amplitude is given by the Fourier transforms of the         */
+/* currents over the unit cell evaluated at k:                 */
+/*                                                             */
+/*  E = ZVAC e^{ik.X} [ -w*Mu*KT - k x N ] / (2*kz*A)          */
+/*  H =      e^{ik.X} [ +w*Eps*NT - k x K ] / (2*kz*A)         */
+/*                                                             */
+/* where K = \sum_alpha K_alpha \int e^{-ik.x} b_alpha(x) dx   */
+/* (similarly N), KT and NT are the components of K and N      */
+/* transverse to k, and A is the area of the unit cell.        */
+/* If the zeroth order is evanescent in the region, the fields */
+/* are set to zero.                                            */
+/***************************************************************/
+void GetFloquetFields(RWGGeometry *G, HVector *KN, cdouble Omega,
+                      double *kBloch, int RegionIndex, bool Upward,
+                      double X[3], cdouble EH[6])
+{
+  memset(EH, 0, 6*sizeof(cdouble));
+
+  cdouble EpsR, MuR;
+  G->RegionMPs[RegionIndex]->GetEpsMu(Omega, &EpsR, &MuR);
+  double k2  = real(EpsR*MuR*Omega*Omega);
+  double kz2 = k2 - kBloch[0]*kBloch[0] - kBloch[1]*kBloch[1];
+  if (kz2<=0.0) 
+   return;
+  double kz = sqrt(kz2);
+
+  double k[3];
+  k[0] = kBloch[0];
+  k[1] = kBloch[1];
+  k[2] = Upward ? kz : -kz;
+
+  /*--------------------------------------------------------------*/
+  /*- Fourier-transform the surface currents at k                -*/
+  /*--------------------------------------------------------------*/
+  cdouble KTilde[3]={0.0, 0.0, 0.0}, NTilde[3]={0.0, 0.0, 0.0};
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   { 
+     RWGSurface *S = G->Surfaces[ns];
+     int Offset    = G->BFIndexOffset[ns];
+
+     double Sign;
+     if ( S->RegionIndices[0] == RegionIndex )
+      Sign=+1.0;
+     else if ( S->RegionIndices[1] == RegionIndex )
+      Sign=-1.0;
+     else
+      continue;
+
+     for(int ne=0; ne<S->NumEdges; ne++)
+      { 
+        cdouble KAlpha, NAlpha;
+        if ( S->IsPEC )
+         { KAlpha = Sign*KN->GetEntry( Offset + ne );
+           NAlpha = 0.0;
+         }
+        else
+         { KAlpha = Sign*KN->GetEntry( Offset + 2*ne + 0 );
+           NAlpha = Sign*KN->GetEntry( Offset + 2*ne + 1 );
+         };
+
+        cdouble bTilde[3];
+        GetEMiKXRWGIntegral(S, ne, k, bTilde);
+        for(int Mu=0; Mu<3; Mu++)
+         { KTilde[Mu] += KAlpha*bTilde[Mu];
+           NTilde[Mu] += NAlpha*bTilde[Mu];
+         };
+      };
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- assemble the plane-wave fields at X                        -*/
+  /*--------------------------------------------------------------*/
+  double kMag = sqrt(k2), kHat[3];
+  kHat[0]=k[0]/kMag;
+  kHat[1]=k[1]/kMag;
+  kHat[2]=k[2]/kMag;
+
+  cdouble kHatDotK = kHat[0]*KTilde[0] + kHat[1]*KTilde[1] + kHat[2]*KTilde[2];
+  cdouble kHatDotN = kHat[0]*NTilde[0] + kHat[1]*NTilde[1] + kHat[2]*NTilde[2];
+
+  cdouble kxK[3], kxN[3];
+  kxK[0] = k[1]*KTilde[2] - k[2]*KTilde[1];
+  kxK[1] = k[2]*KTilde[0] - k[0]*KTilde[2];
+  kxK[2] = k[0]*KTilde[1] - k[1]*KTilde[0];
+  kxN[0] = k[1]*NTilde[2] - k[2]*NTilde[1];
+  kxN[1] = k[2]*NTilde[0] - k[0]*NTilde[2];
+  kxN[2] = k[0]*NTilde[1] - k[1]*NTilde[0];
+
+  double *L1 = G->LBasis[0];
+  double *L2 = G->LBasis[1];
+  double UnitCellArea = fabs(L1[0]*L2[1]-L1[1]*L2[0]);
+  cdouble PreFac = exp( II*(k[0]*X[0] + k[1]*X[1] + k[2]*X[2]) )
+                   / (2.0*kz*UnitCellArea);
+
+  for(int Mu=0; Mu<3; Mu++)
+   { EH[Mu]   = ZVAC*PreFac*( -Omega*MuR*(KTilde[Mu] - kHat[Mu]*kHatDotK) - kxN[Mu] );
+     EH[Mu+3] =      PreFac*( +Omega*EpsR*(NTilde[Mu] - kHat[Mu]*kHatDotN) - kxK[Mu] );
+   };
+
+}
+
+/***************************************************************/
+/* get the transmitted and reflected flux from the zeroth-order*/
+/* Floquet-mode projection of the surface currents. This is a  */
+/* cheap replacement for GetTRFlux(): only the specular orders */
+/* carry power below the diffraction threshold, and for a      */
+/* single plane wave the poynting vector is constant over the  */
+/* unit cell, so no cubature (and no field evaluation) is      */
+/* needed. As in GetTRFlux(), the field above includes the     */
+/* incident field if it lives in the upper region.             */
+/*                                                             */
+/* Return values: TRFlux[0,1] = transmitted, reflected flux    */
+/***************************************************************/
+void GetTRFluxFloquet(RWGGeometry *G, IncField *IF, HVector *KN,
+                      cdouble Omega, double *kBloch,
+                      double ZAbove, int RegionAbove,
+                      double ZBelow, int RegionBelow, double *TRFlux)
+{
+  double XAbove[3]={0.0, 0.0, ZAbove};
+  double XBelow[3]={0.0, 0.0, ZBelow};
+
+  cdouble EHAbove[6], EHBelow[6];
+  GetFloquetFields(G, KN, Omega, kBloch, RegionAbove, true,  XAbove, EHAbove);
+  GetFloquetFields(G, KN, Omega, kBloch, RegionBelow, false, XBelow, EHBelow);
+
+  if ( IF && IF->RegionIndex==RegionAbove )
+   { cdouble EHInc[6];
+     IF->GetFields(XAbove, EHInc);
+     for(int Mu=0; Mu<6; Mu++)
+      EHAbove[Mu] += EHInc[Mu];
+   };
+
+  cdouble *E=EHAbove, *H=EHAbove+3;
+  TRFlux[0] = +0.5*real( E[0]*conj(H[1]) - E[1]*conj(H[0]) );
+
+  E=EHBelow; H=EHBelow+3;
+  TRFlux[1] = -0.5*real( E[0]*conj(H[1]) - E[1]*conj(H[0]) );
+}
+
+/***************************************************************/
+/* count the nonzero diffraction orders that propagate in      */
+/* region RegionIndex at (Omega, kBloch). GetTRFluxFloquet()   */
+/* is exact only when this number is zero above and below.     */
+/***************************************************************/
+int CountPropagatingOrders(RWGGeometry *G, cdouble Omega,
+                           double *kBloch, int RegionIndex)
+{
+  cdouble EpsR, MuR;
+  G->RegionMPs[RegionIndex]->GetEpsMu(Omega, &EpsR, &MuR);
+  double k2 = real(EpsR*MuR*Omega*Omega);
+
+  double *L1 = G->LBasis[0];
+  double *L2 = G->LBasis[1];
+  double UnitCellArea = L1[0]*L2[1]-L1[1]*L2[0];
+  double RLV1[2], RLV2[2]; // reciprocal lattice vectors
+  RLV1[0] = +2.0*M_PI*L2[1]/UnitCellArea;
+  RLV1[1] = -2.0*M_PI*L2[0]/UnitCellArea;
+  RLV2[0] = -2.0*M_PI*L1[1]/UnitCellArea;
+  RLV2[1] = +2.0*M_PI*L1[0]/UnitCellArea;
+
+  int NumOrders=0;
+  for(int n1=-2; n1<=2; n1++)
+   for(int n2=-2; n2<=2; n2++)
+    { if (n1==0 && n2==0) continue;
+      double qx = kBloch[0] + n1*RLV1[0] + n2*RLV2[0];
+      double qy = kBloch[1] + n1*RLV1[1] + n2*RLV2[1];
+      if ( qx*qx + qy*qy < k2 ) 
+       NumOrders++;
+    };
+
+  return NumOrders;
+}
+
+/***************************************************************/
+/* assemble the BEM matrix at (Omega, kBloch), optionally      */
+/* using ABMB accelerators for all surface pairs.              */
+/*                                                             */
+/* Each accelerator caches the kBloch-independent              */
+/* contributions of the innermost lattice cells and recomputes */
+/* them only when Omega changes, so within an angle sweep at   */
+/* fixed Omega each matrix after the first costs only the      */
+/* outer-cell lattice sum and the re-stamping of Bloch phases. */
+/* The price is memory: the accelerator for a diagonal block   */
+/* holds 5 extra copies of the block, and that for an          */
+/* off-diagonal block holds 9, so the accelerators together    */
+/* need several times the storage of the BEM matrix itself.    */
+/* Accelerators==0 assembles every block from scratch.         */
+/***************************************************************/
+void **CreateABMBAccelerators(RWGGeometry *G)
+{
+  int NS=G->NumSurfaces;
+  void **Accelerators = (void **)mallocEC(NS*NS*sizeof(void *));
+  for(int ns=0; ns<NS; ns++)
+   for(int nsp=0; nsp<NS; nsp++)
+    Accelerators[ns*NS + nsp] 
+     = (ns==nsp && G->Mate[ns]!=-1) ? 0 : G->CreateABMBAccelerator(ns, nsp);
+  return Accelerators;
+}
+
+void DestroyABMBAccelerators(RWGGeometry *G, void **Accelerators)
+{
+  int NS=G->NumSurfaces;
+  for(int nb=0; nb<NS*NS; nb++)
+   G->DestroyABMBAccelerator(Accelerators[nb]);
+  free(Accelerators);
+}
+
+void AssembleBEMMatrix(RWGGeometry *G, cdouble Omega, double *kBloch,
+                       void **Accelerators, HMatrix *M)
+{
+  int NS=G->NumSurfaces;
+  for(int ns=0; ns<NS; ns++)
+   for(int nsp=0; nsp<NS; nsp++)
+    { 
+      int RowOffset = G->BFIndexOffset[ns];
+      int ColOffset = G->BFIndexOffset[nsp];
+
+      // reuse the diagonal block of an identical previous surface
+      int nsm = G->Mate[ns];
+      if (ns==nsp && nsm!=-1)
+       { int MateOffset = G->BFIndexOffset[nsm];
+         int Dim = G->Surfaces[ns]->NumBFs;
+         M->InsertBlock(M, RowOffset, RowOffset, Dim, Dim, MateOffset, MateOffset);
+         continue;
+       };
+
+      void *Accelerator = Accelerators ? Accelerators[ns*NS + nsp] : 0;
+      G->AssembleBEMMatrixBlock(ns, nsp, Omega, kBloch, M, 0,
+                                RowOffset, ColOffset, Accelerator, false);
+    };
+}
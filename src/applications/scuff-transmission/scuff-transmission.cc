@@ -26,13 +26,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 
-#include <libhrutil.h>
-#include <libscuff.h>
-#include <libIncField.h>
-
-using namespace scuff;
-
-#define II cdouble (0.0, 1.0)
+#include "scuff-transmission.h"
 
 #define MAXFREQ 10
 #define MAXCACHE 10    // max number of cache files for preload
@@ -40,372 +34,6 @@ using namespace scuff;
 #define POLARIZATION_TE 0
 #define POLARIZATION_TM 1
 
-/*******************************************************************/
-/* this is a 9th-order, 17-point cubature rule for the unit square */
-/* with corners {(0,0) (1,0) (1,1) (1,0)}.                         */
-/* array entries:                                                  */
-/*  x_0, y_0, w_0,                                                 */
-/*  x_1, y_1, w_1,                                                 */
-/*  ...                                                            */
-/*  x_16, y_16, w_16                                               */
-/* where (x_n, y_n) and w_n are the nth cubature point and weight. */
-/*******************************************************************/
-double SCR9[]={
-  +5.0000000000000000e-01, +5.0000000000000000e-01, +1.3168724279835392e-01,
-  +9.8442498318098881e-01, +8.1534005986583447e-01, +2.2219844542549678e-02,
-  +9.8442498318098881e-01, +1.8465994013416559e-01, +2.2219844542549678e-02,
-  +1.5575016819011134e-02, +8.1534005986583447e-01, +2.2219844542549678e-02,
-  +1.5575016819011134e-02, +1.8465994013416559e-01, +2.2219844542549678e-02,
-  +8.7513854998945029e-01, +9.6398082297978482e-01, +2.8024900532399120e-02,
-  +8.7513854998945029e-01, +3.6019177020215176e-02, +2.8024900532399120e-02,
-  +1.2486145001054971e-01, +9.6398082297978482e-01, +2.8024900532399120e-02,
-  +1.2486145001054971e-01, +3.6019177020215176e-02, +2.8024900532399120e-02,
-  +7.6186791010721466e-01, +7.2666991056782360e-01, +9.9570609815517519e-02,
-  +7.6186791010721466e-01, +2.7333008943217640e-01, +9.9570609815517519e-02,
-  +2.3813208989278534e-01, +7.2666991056782360e-01, +9.9570609815517519e-02,
-  +2.3813208989278534e-01, +2.7333008943217640e-01, +9.9570609815517519e-02,
-  +5.3810416409630857e-01, +9.2630786466683113e-01, +6.7262834409945196e-02,
-  +5.3810416409630857e-01, +7.3692135333168873e-02, +6.7262834409945196e-02,
-  +4.6189583590369143e-01, +9.2630786466683113e-01, +6.7262834409945196e-02,
-  +4.6189583590369143e-01, +7.3692135333168873e-02, +6.7262834409945196e-02 
-};
-
-/*******************************************************************/
-/* get the transmitted and reflected flux by integrating the       */
-/* scattered poynting vector over the area of the unit cell.       */
-/*                                                                 */
-/* more specifically, the transmitted power is the integral of     */
-/* the upward-directed poynting vector at ZAbove, while the        */
-/* reflected power is the integral of the downward-directed        */
-/* poynting vector at ZBelow; the flux is the power divided by     */
-/* the area of the unit cell.                                      */
-/*                                                                 */
-/* Return values: TRFlux[0,1] = transmitted, reflected flux        */
-/*******************************************************************/
-void GetTRFlux(RWGGeometry *G, IncField *IF, HVector *KN, cdouble Omega, 
-               int NQPoints, double *kBloch, 
-               double ZAbove, double ZBelow, double *TRFlux)
-{
-  double *SCR=SCR9;
-
-  /***************************************************************/
-  /***************************************************************/
-  /***************************************************************/
-  int NCP; // number of cubature points
-  if (NQPoints==0)
-   NCP=17; 
-  else
-   NCP=NQPoints*NQPoints;
-
-  /***************************************************************/
-  /* on the first invocation we allocate space for the matrices  */
-  /* of evaluation points and fields.                            */
-  /***************************************************************/
-  static HMatrix *XMatrixAbove = 0, *XMatrixBelow = 0;
-  static HMatrix *FMatrixAbove = 0, *FMatrixBelow = 0;
-  if (XMatrixAbove==0)
-   { XMatrixAbove = new HMatrix(NCP, 3 ); 
-     XMatrixBelow = new HMatrix(NCP, 3 ); 
-     FMatrixAbove = new HMatrix(NCP, 6, LHM_COMPLEX);
-     FMatrixBelow = new HMatrix(NCP, 6, LHM_COMPLEX);
-   };
-
-  /***************************************************************/ 
-  /* fill in coordinates of evaluation points.                   */ 
-  /* the first NCP points are for the upper surface; the next    */ 
-  /* NCP points are for the lower surface.                       */ 
-  /***************************************************************/ 
-  double x, y, *LBV[2];
-  LBV[0]=G->LBasis[0];
-  LBV[1]=G->LBasis[1];
-  if (NQPoints==0)
-   { for(int ncp=0; ncp<NCP; ncp++)
-      { 
-        x=SCR[3*ncp+0];
-        y=SCR[3*ncp+1];
-
-        XMatrixAbove->SetEntry(ncp, 0, x*LBV[0][0] + y*LBV[1][0]);
-        XMatrixAbove->SetEntry(ncp, 1, x*LBV[0][1] + y*LBV[1][1]);
-        XMatrixAbove->SetEntry(ncp, 2, ZAbove);
-
-        XMatrixBelow->SetEntry(ncp, 0, x*LBV[0][0] + y*LBV[1][0]);
-        XMatrixBelow->SetEntry(ncp, 1, x*LBV[0][1] + y*LBV[1][1]);
-        XMatrixBelow->SetEntry(ncp, 2, ZBelow);
-
-      };
-   }
-  else
-   { double Delta = 1.0 / ( (double)NQPoints );
-     for(int nqpx=0, ncp=0; nqpx<NQPoints; nqpx++)
-      for(int nqpy=0; nqpy<NQPoints; nqpy++, ncp++)
-       { 
-         x = ((double)nqpx + 0.5)*Delta;
-         y = ((double)nqpy + 0.5)*Delta;
-
-         XMatrixAbove->SetEntry(ncp, 0, x*LBV[0][0] + y*LBV[1][0]);
-         XMatrixAbove->SetEntry(ncp, 1, x*LBV[0][1] + y*LBV[1][1]);
-         XMatrixAbove->SetEntry(ncp, 2, ZAbove);
-
-         XMatrixBelow->SetEntry(ncp, 0, x*LBV[0][0] + y*LBV[1][0]);
-         XMatrixBelow->SetEntry(ncp, 1, x*LBV[0][1] + y*LBV[1][1]);
-         XMatrixBelow->SetEntry(ncp, 2, ZBelow);
-       };
-   };
-
-  /***************************************************************/ 
-  /* get scattered fields at all cubature points                 */ 
-  /***************************************************************/ 
-  G->GetFields(IF, KN, Omega, kBloch, XMatrixAbove, FMatrixAbove);
-  G->GetFields(0, KN, Omega, kBloch, XMatrixBelow, FMatrixBelow);
-
-  /***************************************************************/
-  /* integrate poynting vector over upper and lower surfaces.    */
-  /* Note: The jacobian in this cubature is the area of the unit */
-  /*       cell, so omitting that factor is equivalent to        */
-  /*       dividing the integrated power by the unit-cell area,  */
-  /*       which is what we want to do anyway.                   */
-  /***************************************************************/
-  double w, PTransmitted=0.0, PReflected=0.0;
-  cdouble E[3], H[3];
-  for(int ncp=0; ncp<NCP; ncp++)
-   {
-     if (NQPoints==0) 
-      w=SCR[3*ncp+2];  // cubature weight
-     else
-      w=1.0/((double)(NCP));
-
-     E[0]=FMatrixAbove->GetEntry(ncp, 0);
-     E[1]=FMatrixAbove->GetEntry(ncp, 1);
-     H[0]=FMatrixAbove->GetEntry(ncp, 3);
-     H[1]=FMatrixAbove->GetEntry(ncp, 4);
-     PTransmitted += 0.5*w*real( E[0]*conj(H[1]) - E[1]*conj(H[0]) );
-
-     E[0]=FMatrixBelow->GetEntry(ncp, 0);
-     E[1]=FMatrixBelow->GetEntry(ncp, 1);
-     H[0]=FMatrixBelow->GetEntry(ncp, 3);
-     H[1]=FMatrixBelow->GetEntry(ncp, 4);
-     PReflected -= 0.5*w*real( E[0]*conj(H[1]) - E[1]*conj(H[0]) );
-
-   };
-
-  /***************************************************************/
-  /***************************************************************/
-  /***************************************************************/
-  TRFlux[0]=PTransmitted;
-  TRFlux[1]=PReflected;
-
-}
-
-/***************************************************************/
-/* f1 = \int_0^1 \int_0^u u*e^{-i(uX+vY)} dv du                */
-/* f2 = \int_0^1 \int_0^u v*e^{-i(uX+vY)} dv du                */
-/***************************************************************/
-void f1f2(double X, double Y, cdouble *f1, cdouble *f2)
-{
-  cdouble ExpIX=exp(II*X);
-  cdouble ExpIY=exp(II*Y);
-  double X2=X*X; 
-  double X3=X2*X;
-  double Y2=Y*Y;
-  double Y3=Y2*Y;
-  double XPY2=(X+Y)*(X+Y);
-
-  if (X==0.0 && Y==0.0)
-   { *f1=1.0/3.0;
-     *f2=1.0/6.0;
-   }
-  else if (X==0.0 && Y!=0.0)
-   { 
-     *f1 = ((II/2.0)*(-2.0 + (2.0 + (2.0*II)*Y)/ExpIY - Y2))/Y3;
-     *f2 = -(2.0*II + Y + (-2.0*II + Y)/ExpIY)/Y3;
-   }
-  else if (Y==0.0 && X!=0.0)
-   { *f1= (2.0*II + (-2.0*II + (2.0 + II*X)*X)/ExpIX)/X3;
-     *f2= (2.0*II + (-2.0*II + (2.0 + II*X)*X)/ExpIX)/(2.0*X3);
-   }
-  else if ( fabs(XPY2)<1.0e-20 )
-   { *f1 = ((II/2.0)*(-2.0 + (2.0 + (2.0*II)*X)/ExpIX - X2))/X3;
-     *f2 = ((-II/2.0)*(-2.0 + 2.0/ExpIX + X*(2.0*II + X)))/X3;
-   }
-  else
-   {
-     *f1=((-II)*(-1.0 + (1.0 + II*X)/ExpIX))/(X2*Y) + 
-         (II*(-1.0 + (II*(-II + X + Y))/ ExpIX*ExpIY))/(Y*XPY2);
-
-     *f2 = (-(X*(X*(-II + Y) + Y*(-2.0*II + Y))) - II*ExpIY*(-(ExpIX*Y2) + (XPY2)))/
-            (ExpIX*ExpIY*X*Y2*XPY2);
-   };
-
-}
-
-/***************************************************************/
-/* compute the vector-valued integral                          */
-/*  \int Exp[-i*(K \cdot X)] b[X] dX                           */
-/***************************************************************/
-void GetEMiKXRWGIntegral(RWGSurface *S, int ne, double K[3], cdouble Integral[3])
-{
-  RWGEdge *E    = S->Edges[ne];
-  double *QP    = S->Vertices + 3*E->iQP;
-  double *V1    = S->Vertices + 3*E->iV1;
-  double *V2    = S->Vertices + 3*E->iV2;
-  double *QM    = S->Vertices + 3*E->iQM;
-  double Length = E->Length;
-
-  double AP[3], AM[3], B[3]; 
-  double KQP=0.0, KAP=0.0, KQM=0.0, KAM=0.0, KB=0.0;
-  for(int Mu=0; Mu<3; Mu++)
-   { AP[Mu] = V1[Mu] - QP[Mu];
-     AM[Mu] = V1[Mu] - QM[Mu];
-      B[Mu] = V2[Mu] - V1[Mu];
-       KQP += K[Mu]*QP[Mu];
-       KAP += K[Mu]*AP[Mu];
-       KQM += K[Mu]*QM[Mu];
-       KAM += K[Mu]*AM[Mu];
-        KB += K[Mu]*B[Mu];
-   };
-
-  cdouble ExpFac, f1, f2;
-
-  f1f2(KAP, KB, &f1, &f2);
-  ExpFac = exp(-II*KQP);
-  Integral[0] = Length*ExpFac*( f1*AP[0] + f2*B[0] );
-  Integral[1] = Length*ExpFac*( f1*AP[0] + f2*B[0] );
-  Integral[2] = Length*ExpFac*( f1*AP[0] + f2*B[0] );
-
-  f1f2(KAM, KB, &f1, &f2);
-  ExpFac = exp(-II*KQM);
-  Integral[0] -= Length*ExpFac*( f1*AM[0] + f2*B[0] );
-  Integral[1] -= Length*ExpFac*( f1*AM[0] + f2*B[0] );
-  Integral[2] -= Length*ExpFac*( f1*AM[0] + f2*B[0] );
-  
-}
-
-/***************************************************************/
-/* This routine computes the contributions of currents on a    */
-/* single surface to the transmission amplitude.               */
-/***************************************************************/
-void GetTransmissionAmplitudes(RWGGeometry *G, HVector *KN,
-                               int WhichSurface, cdouble EpsPrime,
-                               cdouble Omega, double Theta,
-                               cdouble *ptTE, cdouble *ptTM)
-{
-  double nn = real(sqrt(EpsPrime));
-  cdouble ZPrime = 1.0/nn;
-  double SinThetaPrime = sin(Theta)/nn;
-  double CosThetaPrime = sqrt(1.0-SinThetaPrime*SinThetaPrime);
-
-  /*--------------------------------------------------------------*/
-  /*--------------------------------------------------------------*/
-  /*--------------------------------------------------------------*/
-  double K[3];
-  K[0] = nn*real(Omega)*SinThetaPrime;
-  K[1] = 0.0;
-  K[2] = nn*real(Omega)*CosThetaPrime;
-
-  /*--------------------------------------------------------------*/
-  /*--------------------------------------------------------------*/
-  /*--------------------------------------------------------------*/
-  double EpsTE[3], EpsBarTE[3], EpsTM[3], EpsBarTM[3];
-  EpsTE[0]=0.0;     EpsBarTE[0] = -CosThetaPrime;
-  EpsTE[1]=1.0;     EpsBarTE[1] = 0.0;
-  EpsTE[2]=0.0;     EpsBarTE[2] = +SinThetaPrime;
-
-  EpsTM[0]=+CosThetaPrime;  EpsBarTM[0]=0.0;
-  EpsTM[1]=0.0;             EpsBarTM[1]=1.0;
-  EpsTM[2]=-SinThetaPrime;  EpsBarTM[2]=0.0;
-
-  /*--------------------------------------------------------------*/
-  /*--------------------------------------------------------------*/
-  /*--------------------------------------------------------------*/
-  RWGSurface *S = G->Surfaces[WhichSurface];
-  int BFIndexOffset = G->BFIndexOffset[WhichSurface];
-
-  cdouble tTE=0.0, tTM=0.0;
-  cdouble KAlpha, NAlpha=0.0;
-  for(int ne=0; ne<S->NumEdges; ne++)
-   { 
-     if (S->IsPEC)
-      { 
-        KAlpha=KN->GetEntry( BFIndexOffset + ne );
-      }
-     else
-      { KAlpha=KN->GetEntry( BFIndexOffset + 2*ne + 0 );
-        NAlpha=-ZVAC*KN->GetEntry( BFIndexOffset + 2*ne + 1 );
-      };
-
-     cdouble EMiQXBAlpha[3]; 
-     GetEMiKXRWGIntegral(S, ne, K, EMiQXBAlpha);
-     
-     tTE += KAlpha*(   EpsTE[0]*EMiQXBAlpha[0]
-                     + EpsTE[1]*EMiQXBAlpha[1]
-                     + EpsTE[2]*EMiQXBAlpha[2] 
-                   )
-           +NAlpha*(   EpsBarTE[0]*EMiQXBAlpha[0]
-                     + EpsBarTE[1]*EMiQXBAlpha[1]
-                     + EpsBarTE[2]*EMiQXBAlpha[2] 
-                   );
-     
-     tTM += KAlpha*(   EpsTM[0]*EMiQXBAlpha[0]
-                     + EpsTM[1]*EMiQXBAlpha[1]
-                     + EpsTM[2]*EMiQXBAlpha[2] 
-                   )
-           +NAlpha*(   EpsBarTM[0]*EMiQXBAlpha[0]
-                     + EpsBarTM[1]*EMiQXBAlpha[1]
-                     + EpsBarTM[2]*EMiQXBAlpha[2] 
-                   );
-
-   };
-
-  if (G->LDim!=2)
-   ErrExit("%s: %i: internal error",__FILE__,__LINE__);
-  double *L1 = G->LBasis[0];
-  double *L2 = G->LBasis[1];
-  double UnitCellVolume = L1[0]*L2[1]-L1[1]*L2[0];
-
-  tTE *= ZVAC*ZPrime / (2.0*UnitCellVolume*CosThetaPrime);
-  tTM *= ZVAC*ZPrime / (2.0*UnitCellVolume*CosThetaPrime);
-
-  if (ptTE) *ptTE = tTE;
-  if (ptTM) *ptTM = tTM;
-}
-
-/***************************************************************/
-/* This routine computes the contributions of currents on ALL  */
-/* surfaces bounding the uppermost region to the transmission  */
-/* amplitude.                                                  */
-/***************************************************************/
-void GetTransmissionAmplitudes(RWGGeometry *G, HVector *KN,
-                               int UppermostRegionIndex,
-                               cdouble Omega, double Theta,
-                               cdouble *ptTE, cdouble *ptTM)
-{
-  double EpsPrime 
-   = real( G->RegionMPs[UppermostRegionIndex]->GetEps(Omega) );
-
-  cdouble tTE=0.0, tTM=0.0;
-  for(int ns=0; ns<G->NumSurfaces; ns++)
-   { 
-     double Sign;
-
-     if (G->Surfaces[ns]->RegionIndices[0]==UppermostRegionIndex)
-      Sign=1.0;
-     else if (G->Surfaces[ns]->RegionIndices[1]==UppermostRegionIndex)
-      Sign=-1.0;
-     else
-      continue;
-
-     cdouble tTEPartial, tTMPartial;
-     GetTransmissionAmplitudes(G, KN, ns, EpsPrime, Omega, Theta,
-                               &tTEPartial, &tTMPartial);
-
-     tTE += Sign*tTEPartial;
-     tTM += Sign*tTMPartial;
-   };
-
-  if (ptTE) *ptTE = tTE;
-  if (ptTM) *ptTM = tTM;
-}
-
 /***************************************************************/
 /***************************************************************/
 /***************************************************************/
@@ -427,11 +55,14 @@ int main(int argc, char *argv[])
   double ZAbove=2.0;
   double ZBelow=-1.0;
   int NQPoints=0;
+  bool FieldFlux=false;
+  bool Accelerate=false;
   char *OutFileName=0;
   char *Cache=0;
   char *ReadCache[MAXCACHE];         int nReadCache;
   char *WriteCache=0;
-char *UpperRegion;
+  char *SnapshotDir=0;
+char *UpperRegion=0;
   /* name        type    #args  max_instances  storage    count  description*/
   OptStruct OSArray[]=
    { {"geometry",    PA_STRING,  1, 1,       (void *)&GeoFileName,  0,       ".scuffgeo file"},
@@ -450,15 +81,20 @@ char *UpperRegion;
      {"UpperRegion", PA_STRING,  1, 1,       (void *)&UpperRegion,  0,       "delete me please"},
 /**/
      {"NQPoints",    PA_INT,     1, 1,       (void *)&NQPoints,     0,       "number of quadrature points per dimension"},
+     {"FieldFlux",   PA_BOOL,    0, 1,       (void *)&FieldFlux,    0,       "always compute fluxes by integrating the poynting vector"},
+     {"Accelerate",  PA_BOOL,    0, 1,       (void *)&Accelerate,   0,       "cache kBloch-independent matrix blocks for angle sweeps (needs extra memory)"},
 /**/
      {"OutFile",     PA_STRING,  1, 1,       (void *)&OutFileName,  0,       "output file name"},
 /**/
      {"Cache",       PA_STRING,  1, 1,       (void *)&Cache,        0,             "read/write cache"},
      {"ReadCache",   PA_STRING,  1, MAXCACHE,(void *)ReadCache,     &nReadCache,   "read cache"},
      {"WriteCache",  PA_STRING,  1, 1,       (void *)&WriteCache,   0,             "write cache"},
+     {"SnapshotDir", PA_STRING,  1, 1,       (void *)&SnapshotDir,  0,             "directory for cached geometry snapshots"},
      {0,0,0,0,0,0,0}
    };
   ProcessOptions(argc, argv, OSArray);
+  if (SnapshotDir)
+   RWGGeometry::SetSnapshotDir(SnapshotDir);
   if (GeoFileName==0)
    OSUsage(argv[0],OSArray,"--geometry option is mandatory");
   
@@ -474,13 +110,26 @@ char *UpperRegion;
   HVector *RHS = G->AllocateRHSVector();
   HVector *KN  = G->AllocateRHSVector();
 
+  // the TE and TM problems share each LU factorization, so
+  // we solve for both sets of surface currents at once
+  HMatrix *KNMatrix = new HMatrix(G->TotalBFs, 2, LHM_COMPLEX);
+
+  double XAbove[3]={0.0, 0.0, ZAbove};
+  double XBelow[3]={0.0, 0.0, ZBelow};
+  int RegionAbove=G->GetRegionIndex(XAbove);
+  int RegionBelow=G->GetRegionIndex(XBelow);
+
 int UpperRegionIndex;
-for(UpperRegionIndex=0; UpperRegionIndex<G->NumRegions; UpperRegionIndex++)
- if (!strcasecmp(UpperRegion,G->RegionLabels[UpperRegionIndex]))
-  break;
-if (UpperRegionIndex==G->NumRegions)
- ErrExit("unknown upper region %s",UpperRegion);
-printf("Identified uppermost region %s as region # %i.\n",UpperRegion,UpperRegionIndex);
+if (UpperRegion==0)
+ UpperRegionIndex=RegionAbove;
+else
+ { for(UpperRegionIndex=0; UpperRegionIndex<G->NumRegions; UpperRegionIndex++)
+    if (!strcasecmp(UpperRegion,G->RegionLabels[UpperRegionIndex]))
+     break;
+   if (UpperRegionIndex==G->NumRegions)
+    ErrExit("unknown upper region %s",UpperRegion);
+ };
+printf("Identified uppermost region %s as region # %i.\n",G->RegionLabels[UpperRegionIndex],UpperRegionIndex);
 
   /*******************************************************************/
   /* process frequency-related options to construct a list of        */
@@ -591,6 +240,15 @@ printf("Identified uppermost region %s as region # %i.\n",UpperRegion,UpperRegio
 
   cdouble EpsExterior, MuExterior, kExterior;
 
+  /*--------------------------------------------------------------*/
+  /*- with --Accelerate, the kBloch-independent parts of the BEM  -*/
+  /*- matrix are computed once per frequency and shared by all    -*/
+  /*- incident angles. this speeds up angle sweeps considerably,  -*/
+  /*- but the cached blocks need several times the memory of the  -*/
+  /*- BEM matrix itself, so it is not the default.                -*/
+  /*--------------------------------------------------------------*/
+  void **Accelerators = Accelerate ? CreateABMBAccelerators(G) : 0;
+
   /*--------------------------------------------------------------*/
   /*- loop over frequencies and incident angles ------------------*/
   /*--------------------------------------------------------------*/
@@ -599,75 +257,127 @@ printf("Identified uppermost region %s as region # %i.\n",UpperRegion,UpperRegio
   cdouble Omega;
   double FluxTE[2], FluxTM[2], IncFlux;
   cdouble tTETE, tTETM, tTMTE, tTMTM;
+  int NumFieldFluxPoints=0, NumPoints=0;
+  size_t ColumnSize = G->TotalBFs * sizeof(cdouble);
   for(int nOmega=0; nOmega<OmegaVector->N; nOmega++)
-   for(int nTheta=0; nTheta<ThetaVector->N; nTheta++)
-    { 
-      Omega = OmegaVector->GetEntry(nOmega);
-      Theta = ThetaVector->GetEntryD(nTheta);
-      SinTheta=sin(Theta);
-      CosTheta=cos(Theta);
-      Log("Solving the scattering problem at (Omega,Theta)=(%g,%g)",real(Omega),Theta*RAD2DEG);
-
-      // set bloch wavevector and assemble BEM matrix 
-      G->RegionMPs[0]->GetEpsMu(Omega, &EpsExterior, &MuExterior);
-      kExterior = csqrt2(EpsExterior*MuExterior)*Omega;
-      kBloch[0] = real(kExterior)*SinTheta;
-      kBloch[1] = 0.0;
-      G->AssembleBEMMatrix(Omega, kBloch, M);
-      if (WriteCache)
-       { StoreCache( WriteCache );
-         WriteCache=0;       
-       };
-      M->LUFactorize();
-
-      // set plane wave direction 
-      nHat[0] = SinTheta;
-      nHat[1] = 0.0;
-      nHat[2] = CosTheta;
-      PW.SetnHat(nHat);
-
-      // solve with E-field perpendicular to plane of incidence  (TE)
-      E0[0]=0.0;
-      E0[1]=1.0;
-      E0[2]=0.0;
-      PW.SetE0(E0);
-      G->AssembleRHSVector(Omega, kBloch, &PW, RHS);
-      KN->Copy(RHS);
-      M->LUSolve(KN);
-      GetTRFlux(G, &PW, KN, Omega, NQPoints, kBloch, ZAbove, ZBelow, FluxTE);
-      GetTransmissionAmplitudes(G, KN, UpperRegionIndex, Omega, Theta, 
-                                &tTETE, &tTMTE);
-
-      // solve with E-field parallel to plane of incidence (TM)
-      E0[0]=CosTheta;
-      E0[1]=0.0;
-      E0[2]=-SinTheta;
-      PW.SetE0(E0);
-      G->AssembleRHSVector(Omega, kBloch, &PW, RHS);
-      KN->Copy(RHS);
-      M->LUSolve(KN);
-      GetTRFlux(G, &PW, KN, Omega, NQPoints, kBloch, ZAbove, ZBelow, FluxTM);
-      GetTransmissionAmplitudes(G, KN, UpperRegionIndex, Omega, Theta,
-                                &tTETM, &tTMTM);
+   { 
+     Omega = OmegaVector->GetEntry(nOmega);
+     G->RegionMPs[0]->GetEpsMu(Omega, &EpsExterior, &MuExterior);
+     kExterior = csqrt2(EpsExterior*MuExterior)*Omega;
+
+     for(int nTheta=0; nTheta<ThetaVector->N; nTheta++)
+      { 
+        Theta = ThetaVector->GetEntryD(nTheta);
+        SinTheta=sin(Theta);
+        CosTheta=cos(Theta);
+        Log("Solving the scattering problem at (Omega,Theta)=(%g,%g)",real(Omega),Theta*RAD2DEG);
+
+        // set bloch wavevector and assemble BEM matrix 
+        kBloch[0] = real(kExterior)*SinTheta;
+        kBloch[1] = 0.0;
+        AssembleBEMMatrix(G, Omega, kBloch, Accelerators, M);
+        if (WriteCache)
+         { StoreCache( WriteCache );
+           WriteCache=0;       
+         };
+        M->LUFactorize();
+
+        // set plane wave direction 
+        nHat[0] = SinTheta;
+        nHat[1] = 0.0;
+        nHat[2] = CosTheta;
+        PW.SetnHat(nHat);
+
+        // RHS for E-field perpendicular to plane of incidence (TE)
+        E0[0]=0.0;
+        E0[1]=1.0;
+        E0[2]=0.0;
+        PW.SetE0(E0);
+        G->AssembleRHSVector(Omega, kBloch, &PW, RHS);
+        memcpy(KNMatrix->ZM + 0*G->TotalBFs, RHS->ZV, ColumnSize);
+
+        // RHS for E-field parallel to plane of incidence (TM)
+        E0[0]=CosTheta;
+        E0[1]=0.0;
+        E0[2]=-SinTheta;
+        PW.SetE0(E0);
+        G->AssembleRHSVector(Omega, kBloch, &PW, RHS);
+        memcpy(KNMatrix->ZM + 1*G->TotalBFs, RHS->ZV, ColumnSize);
+
+        // one solve for both polarizations 
+        M->LUSolve(KNMatrix);
+
+        // the Floquet-mode fluxes include only the specular orders,
+        // so wherever higher diffraction orders propagate we fall
+        // back to integrating the poynting vector
+        bool UseFieldFlux=FieldFlux;
+        if (!UseFieldFlux)
+         { int NumOrders = CountPropagatingOrders(G, Omega, kBloch, RegionAbove)
+                          +CountPropagatingOrders(G, Omega, kBloch, RegionBelow);
+           if (NumOrders>0)
+            { Log("%i higher diffraction orders propagate at (Omega,Theta)=(%s,%g): using field cubature",
+                   NumOrders,z2s(Omega),Theta*RAD2DEG);
+              UseFieldFlux=true;
+            };
+         };
+        NumPoints++;
+        if (UseFieldFlux) 
+         NumFieldFluxPoints++;
+
+        // TE post-processing 
+        E0[0]=0.0;
+        E0[1]=1.0;
+        E0[2]=0.0;
+        PW.SetE0(E0);
+        memcpy(KN->ZV, KNMatrix->ZM + 0*G->TotalBFs, ColumnSize);
+        if (UseFieldFlux)
+         GetTRFlux(G, &PW, KN, Omega, NQPoints, kBloch, ZAbove, ZBelow, FluxTE);
+        else
+         GetTRFluxFloquet(G, &PW, KN, Omega, kBloch, ZAbove, RegionAbove,
+                          ZBelow, RegionBelow, FluxTE);
+        GetTransmissionAmplitudes(G, KN, UpperRegionIndex, Omega, Theta, 
+                                  &tTETE, &tTMTE);
+
+        // TM post-processing 
+        E0[0]=CosTheta;
+        E0[1]=0.0;
+        E0[2]=-SinTheta;
+        PW.SetE0(E0);
+        memcpy(KN->ZV, KNMatrix->ZM + 1*G->TotalBFs, ColumnSize);
+        if (UseFieldFlux)
+         GetTRFlux(G, &PW, KN, Omega, NQPoints, kBloch, ZAbove, ZBelow, FluxTM);
+        else
+         GetTRFluxFloquet(G, &PW, KN, Omega, kBloch, ZAbove, RegionAbove,
+                          ZBelow, RegionBelow, FluxTM);
+        GetTransmissionAmplitudes(G, KN, UpperRegionIndex, Omega, Theta,
+                                  &tTETM, &tTMTM);
    
-      IncFlux = CosTheta/(2.0*ZVAC);
-
-      fprintf(f,"%s %e ", z2s(Omega), Theta*RAD2DEG);
-      fprintf(f,"%e %e ", FluxTE[0]/IncFlux, FluxTE[1]/IncFlux);
-      fprintf(f,"%e %e ", FluxTM[0]/IncFlux, FluxTM[1]/IncFlux);
-      fprintf(f,"%e %e ", norm(tTETE), arg(tTETE));
-      fprintf(f,"%e %e ", norm(tTMTE), arg(tTMTE));
-      fprintf(f,"%e %e ", norm(tTETM), arg(tTMTM));
-      fprintf(f,"%e %e ", norm(tTMTM), arg(tTMTM));
-      fprintf(f,"\n");
-      fflush(f);
-
-   }; 
+        IncFlux = CosTheta/(2.0*ZVAC);
+
+        fprintf(f,"%s %e ", z2s(Omega), Theta*RAD2DEG);
+        fprintf(f,"%e %e ", FluxTE[0]/IncFlux, FluxTE[1]/IncFlux);
+        fprintf(f,"%e %e ", FluxTM[0]/IncFlux, FluxTM[1]/IncFlux);
+        fprintf(f,"%e %e ", norm(tTETE), arg(tTETE));
+        fprintf(f,"%e %e ", norm(tTMTE), arg(tTMTE));
+        fprintf(f,"%e %e ", norm(tTETM), arg(tTMTM));
+        fprintf(f,"%e %e ", norm(tTMTM), arg(tTMTM));
+        fprintf(f,"\n");
+        fflush(f);
+
+      }; // for(int nTheta=0...
+
+   }; // for(int nOmega=0...
+  if (Accelerators)
+   DestroyABMBAccelerators(G, Accelerators);
   fclose(f);
 
   /*--------------------------------------------------------------*/
   /*--------------------------------------------------------------*/
   /*--------------------------------------------------------------*/
+  if (!FieldFlux && NumFieldFluxPoints>0)
+   printf("Higher diffraction orders propagate at %i of %i (Omega,Theta) points;\n"
+          "fluxes at those points were computed by integrating the poynting vector.\n",
+          NumFieldFluxPoints, NumPoints);
   printf("Transmission/reflection data written to %s.\n",OutFileName);
   printf("Thank you for your support.\n");
 
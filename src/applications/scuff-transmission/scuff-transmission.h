@@ -0,0 +1,65 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * scuff-transmission.h -- header file for scuff-transmission
+ *
+ * agent                -- 10/2026
+ */
+#ifndef SCUFFTRANSMISSION_H
+#define SCUFFTRANSMISSION_H
+
+#include <libhrutil.h>
+#include <libhmat.h>
+#include <libscuff.h>
+#include <libIncField.h>
+
+using namespace scuff;
+
+#define II cdouble (0.0, 1.0)
+
+/***************************************************************/
+/* routines in TransmissionFlux.cc *****************************/
+/***************************************************************/
+void GetTRFlux(RWGGeometry *G, IncField *IF, HVector *KN, cdouble Omega,
+               int NQPoints, double *kBloch,
+               double ZAbove, double ZBelow, double *TRFlux);
+
+void GetTRFluxFloquet(RWGGeometry *G, IncField *IF, HVector *KN,
+                      cdouble Omega, double *kBloch,
+                      double ZAbove, int RegionAbove,
+                      double ZBelow, int RegionBelow, double *TRFlux);
+
+int CountPropagatingOrders(RWGGeometry *G, cdouble Omega,
+                           double *kBloch, int RegionIndex);
+
+void f1f2(double X, double Y, cdouble *f1, cdouble *f2);
+void GetEMiKXRWGIntegral(RWGSurface *S, int ne, double K[3], cdouble Integral[3]);
+
+void GetTransmissionAmplitudes(RWGGeometry *G, HVector *KN,
+                               int UppermostRegionIndex,
+                               cdouble Omega, double Theta,
+                               cdouble *ptTE, cdouble *ptTM);
+
+void **CreateABMBAccelerators(RWGGeometry *G);
+void DestroyABMBAccelerators(RWGGeometry *G, void **Accelerators);
+void AssembleBEMMatrix(RWGGeometry *G, cdouble Omega, double *kBloch,
+                       void **Accelerators, HMatrix *M);
+
+#endif // #ifndef SCUFFTRANSMISSION_H
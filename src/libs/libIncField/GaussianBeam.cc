@@ -71,6 +71,17 @@ void GaussianBeam::SetW0(double pW0)          { W0 = pW0; }
 /***************************************************************/
 /***************************************************************/
 void GaussianBeam::GetFields(const double X[3], cdouble EH[6])
+{
+  GetFieldsBatch(1, X, EH);
+}
+
+/***************************************************************/
+/* everything that does not depend on the evaluation point --  */
+/* material checks, wavenumber, local coordinate frames for    */
+/* the real and imaginary parts of E0, normalization factors --*/
+/* is computed once, outside the loop over points.             */
+/***************************************************************/
+void GaussianBeam::GetFieldsBatch(int N, const double *X, cdouble *EH)
 {
   if ( imag(Eps) !=0.0 || imag(Mu) != 0.0 )
    ErrExit("%s:%i: gaussian beams not implemented for dispersive media");
@@ -95,119 +106,130 @@ void GaussianBeam::GetFields(const double X[3], cdouble EH[6])
   // and exactly solves Maxwell's equations everywhere in space
   double z0 = k*W0*W0/2;
   double kz0 = k*z0;
-  dVec Xrel = dVec(X) - dVec(X0);
+
+  dVec zHat = KProp; zHat.normalize();
 
   // the field has NO cylindrical symmetry! this means that for
   // complex polarization vectors, we have to do a separate calculation
-  // for the real and for the complex part
+  // for the real and for the complex part.
+  // local coordinate systems given by ^z = kProp, ^x ~ Re(E0) or Im(E0), ^y ~ ^z x ^x  
+  double rnorm = norm(zvE0.real());
+  dVec xHatR, yHatR;
+  if (rnorm>1e-13)
+   { xHatR = zvE0.real() / rnorm;
+     yHatR = cross(zHat,xHatR);
+   };
 
-  // first, we do everything that is not direction dependent, i.e.
-  // where we only need the z-coordinate and the radial distance rho
-  dVec zHat = KProp; zHat.normalize();
-  double z, rho;
+  double inorm = norm(zvE0.imag());
+  dVec xHatI, yHatI;
+  if (inorm>1e-13)
+   { xHatI = zvE0.imag() / inorm;
+     yHatI = cross(zHat,xHatI);
+   };
 
-  // this is from libVec.h
-  GetLocalCylinderCoordinates(Xrel, zHat, rho, z);
+  // the field as calculated below is not normalized, so we get the field strength at the origin
+  // (for E0 == 1)
+  // this can be simplified very much by using that for x=y=z=0, R = sqrt((-i z0)**2) = i z0
 
-  // HR 20130915 the cos, sin below can overflow if kR has large 
-  // imaginary part, so in that case we use the 'rescaled' versions 
-  // of f and g, defined as f,g divided by exp(kz0). x
-  bool UseRescaledFG = false;
+  // 20130915 HR see comments below; note sinh(kz0)/exp(kz0) = 0.5(1-exp(-2*kz0)) 
+  double EorigRescaled = 3./(2*kz0*kz0*kz0) * (kz0*(kz0-1) + 0.5*(1.0-exp(-2.0*kz0)) );
+  double Eorig         = 3./(2*kz0*kz0*kz0) * (exp(kz0)*kz0*(kz0-1) + sinh(kz0));
 
-  cdouble zc = z - IU*z0;
-  cdouble Rsq  = rho*rho + zc*zc, R = sqrt(Rsq), kR = k*R, kRsq = kR*kR, kR3 = kRsq*kR;
-  cdouble f,g,fmgbRsq;
-  // we have to be careful: R can go to zero, leading to numerical problems
-  if (std::abs(kR)>1.e-4) 
+  for(int n=0; n<N; n++)
    {
-    cdouble coskR, sinkR;
-    if ( fabs(imag(kR))>30.0 )
-     { UseRescaledFG = true;
-       cdouble ExpI     = exp( IU*real(kR) );
-       cdouble ExpPlus  = exp( imag(kR) - kz0 );
-       cdouble ExpMinus = exp( -(imag(kR) + kz0) );
-       coskR = 0.5*( ExpI*ExpMinus + conj(ExpI)*ExpPlus);
-       sinkR = -0.5*IU*( ExpI*ExpMinus - conj(ExpI)*ExpPlus);
+     dVec Xrel = dVec(X + 3*n) - dVec(X0);
+     cdouble *EHX = EH + 6*n;
+
+     // first, we do everything that is not direction dependent, i.e.
+     // where we only need the z-coordinate and the radial distance rho
+     double z, rho;
+
+     // this is from libVec.h
+     GetLocalCylinderCoordinates(Xrel, zHat, rho, z);
+
+     // HR 20130915 the cos, sin below can overflow if kR has large 
+     // imaginary part, so in that case we use the 'rescaled' versions 
+     // of f and g, defined as f,g divided by exp(kz0). x
+     bool UseRescaledFG = false;
+
+     cdouble zc = z - IU*z0;
+     cdouble Rsq  = rho*rho + zc*zc, R = sqrt(Rsq), kR = k*R, kRsq = kR*kR, kR3 = kRsq*kR;
+     cdouble f,g,fmgbRsq;
+     // we have to be careful: R can go to zero, leading to numerical problems
+     if (std::abs(kR)>1.e-4) 
+      {
+       cdouble coskR, sinkR;
+       if ( fabs(imag(kR))>30.0 )
+        { UseRescaledFG = true;
+          cdouble ExpI     = exp( IU*real(kR) );
+          cdouble ExpPlus  = exp( imag(kR) - kz0 );
+          cdouble ExpMinus = exp( -(imag(kR) + kz0) );
+          coskR = 0.5*( ExpI*ExpMinus + conj(ExpI)*ExpPlus);
+          sinkR = -0.5*IU*( ExpI*ExpMinus - conj(ExpI)*ExpPlus);
+        }
+       else
+        { coskR = cos(kR); 
+          sinkR = sin(kR);
+        };
+       f   = -3.  *            (coskR/kRsq - sinkR/kR3);
+       //g =  1.5 * (sinkR/kR + coskR/kRsq - sinkR/kR3)
+       g   =  1.5 *  sinkR/kR - 0.5 * f;
+       fmgbRsq = (f-g)/Rsq;
+     } else {
+       cdouble kR4 = kRsq*kRsq;
+       // use a series expansion for small R
+       // fourth order term is already at most 1e-16*3/280!
+       f = kR4   /280. - kRsq/10. + 1.;
+       g = kR4*3./280. - kRsq/5.  + 1.;
+       // note: this is (f(kR)-g(kR))/R^2, not /kR^2 - so we get an additional k^2 term
+       fmgbRsq = (kR4/5040. - kRsq/140. + 0.1) * (k*k);
      }
-    else
-     { coskR = cos(kR); 
-       sinkR = sin(kR);
-     };
-    f   = -3.  *            (coskR/kRsq - sinkR/kR3);
-    //g =  1.5 * (sinkR/kR + coskR/kRsq - sinkR/kR3)
-    g   =  1.5 *  sinkR/kR - 0.5 * f;
-    fmgbRsq = (f-g)/Rsq;
-  } else {
-    cdouble kR4 = kRsq*kRsq;
-    // use a series expansion for small R
-    // fourth order term is already at most 1e-16*3/280!
-    f = kR4   /280. - kRsq/10. + 1.;
-    g = kR4*3./280. - kRsq/5.  + 1.;
-    // note: this is (f(kR)-g(kR))/R^2, not /kR^2 - so we get an additional k^2 term
-    fmgbRsq = (kR4/5040. - kRsq/140. + 0.1) * (k*k);
-  }
-  cdouble i2fk = 0.5*IU*f*k;
-
-  // now calculate the actual coordinates for having either zvE0.real() or zvE0.imag() as the x axis
-  // local coordinate system given by ^z = kProp, ^x ~ Re(E0) or Im(E0), ^y ~ ^z x ^x  
-  zVec E, H;
+     cdouble i2fk = 0.5*IU*f*k;
 
-  double rnorm = norm(zvE0.real());
-  if (rnorm>1e-13) {
-    // calculate fields in local coordinate system
-    dVec xHat = zvE0.real() / rnorm;
-    dVec yHat = cross(zHat,xHat);
-    double  x  = dot(xHat,Xrel);
-    double  y  = dot(yHat,Xrel);
+     // now calculate the actual coordinates for having either zvE0.real() or zvE0.imag() as the x axis
+     zVec E, H;
+
+     if (rnorm>1e-13) {
+       // calculate fields in local coordinate system
+       double  x  = dot(xHatR,Xrel);
+       double  y  = dot(yHatR,Xrel);
     
-    cdouble Ex = g + fmgbRsq * x * x  + i2fk * zc;
-    cdouble Ey =     fmgbRsq * x * y;
-    cdouble Ez =     fmgbRsq * x * zc - i2fk * x;
-    cdouble Hx = Ey;
-    cdouble Hy = g + fmgbRsq * y * y  + i2fk * zc;
-    cdouble Hz =     fmgbRsq * y * zc - i2fk * y;
-
-    // go back to the laboratory frame
-    E += cdouble(rnorm) * (Ex * zVec(xHat) + Ey * zVec(yHat) + Ez * zVec(zHat));
-    H += cdouble(rnorm) * (Hx * zVec(xHat) + Hy * zVec(yHat) + Hz * zVec(zHat));
-  } 
+       cdouble Ex = g + fmgbRsq * x * x  + i2fk * zc;
+       cdouble Ey =     fmgbRsq * x * y;
+       cdouble Ez =     fmgbRsq * x * zc - i2fk * x;
+       cdouble Hx = Ey;
+       cdouble Hy = g + fmgbRsq * y * y  + i2fk * zc;
+       cdouble Hz =     fmgbRsq * y * zc - i2fk * y;
+
+       // go back to the laboratory frame
+       E += cdouble(rnorm) * (Ex * zVec(xHatR) + Ey * zVec(yHatR) + Ez * zVec(zHat));
+       H += cdouble(rnorm) * (Hx * zVec(xHatR) + Hy * zVec(yHatR) + Hz * zVec(zHat));
+     } 
   
-  double inorm = norm(zvE0.imag());
-  if (inorm>1e-13) {
-    // calculate fields in local coordinate system
-    dVec xHat = zvE0.imag() / inorm;
-    dVec yHat = cross(zHat,xHat);
-    double  x  = dot(xHat,Xrel);
-    double  y  = dot(yHat,Xrel);
+     if (inorm>1e-13) {
+       // calculate fields in local coordinate system
+       double  x  = dot(xHatI,Xrel);
+       double  y  = dot(yHatI,Xrel);
     
-    cdouble Ex = g + fmgbRsq * x * x  + i2fk * zc;
-    cdouble Ey =     fmgbRsq * x * y;
-    cdouble Ez =     fmgbRsq * x * zc - i2fk * x;
-    cdouble Hx = Ey;
-    cdouble Hy = g + fmgbRsq * y * y  + i2fk * zc;
-    cdouble Hz =     fmgbRsq * y * zc - i2fk * y;
+       cdouble Ex = g + fmgbRsq * x * x  + i2fk * zc;
+       cdouble Ey =     fmgbRsq * x * y;
+       cdouble Ez =     fmgbRsq * x * zc - i2fk * x;
+       cdouble Hx = Ey;
+       cdouble Hy = g + fmgbRsq * y * y  + i2fk * zc;
+       cdouble Hz =     fmgbRsq * y * zc - i2fk * y;
     
-    // go back to the laboratory frame
-    E += IU * inorm * (Ex * zVec(xHat) + Ey * zVec(yHat) + Ez * zVec(zHat));
-    H += IU * inorm * (Hx * zVec(xHat) + Hy * zVec(yHat) + Hz * zVec(zHat));
-  }
-
-  // the field as calculated above is not normalized, so we get the field strength at the origin
-  // (for E0 == 1)
-  // this can be simplified very much by using that for x=y=z=0, R = sqrt((-i z0)**2) = i z0
+       // go back to the laboratory frame
+       E += IU * inorm * (Ex * zVec(xHatI) + Ey * zVec(yHatI) + Ez * zVec(zHat));
+       H += IU * inorm * (Hx * zVec(xHatI) + Hy * zVec(yHatI) + Hz * zVec(zHat));
+     }
 
-  // 20130915 HR see comments above; note sinh(kz0)/exp(kz0) = 0.5(1-exp(-2*kz0)) 
-  double Eorig; 
-  if (UseRescaledFG)
-   Eorig = 3./(2*kz0*kz0*kz0) * (kz0*(kz0-1) + 0.5*(1.0-exp(-2.0*kz0)) );
-  else
-   Eorig = 3./(2*kz0*kz0*kz0) * (exp(kz0)*kz0*(kz0-1) + sinh(kz0));
-  
-  // now scale the fields to have E(0,0,0) = E0
-  E /= Eorig;
-  EH[0] = E[0]; EH[1] = E[1]; EH[2] = E[2];
-  H /= (Eorig*ZVAC*ZR);
-  EH[3] = H[0]; EH[4] = H[1]; EH[5] = H[2];
+     // now scale the fields to have E(0,0,0) = E0
+     double EScale = UseRescaledFG ? EorigRescaled : Eorig;
+     E /= EScale;
+     EHX[0] = E[0]; EHX[1] = E[1]; EHX[2] = E[2];
+     H /= (EScale*ZVAC*ZR);
+     EHX[3] = H[0]; EHX[4] = H[1]; EHX[5] = H[2];
+   };
 }
 
 /**********************************************************************/
@@ -121,3 +121,13 @@ void IncField::GetTotalFields(const double X[3], cdouble EH[6])
       EH[nc] += PEH[nc];
    };
 }
+
+/***************************************************************/
+/* default implementation of the batch field routine: just     */
+/* evaluate the fields one point at a time                     */
+/***************************************************************/
+void IncField::GetFieldsBatch(int N, const double *X, cdouble *EH)
+{
+  for(int n=0; n<N; n++)
+   GetFields(X + 3*n, EH + 6*n);
+}
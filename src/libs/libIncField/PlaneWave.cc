@@ -51,18 +51,36 @@ void PlaneWave::SetnHat(double pnHat[3])
 /**********************************************************************/
 void PlaneWave::GetFields(const double X[3], cdouble EH[6])
 {
+  GetFieldsBatch(1, X, EH);
+}
 
+/**********************************************************************/
+/* the polarization of E and H is the same at all points, so we       */
+/* compute H0 = (nHat \cross E0) / Z once and only need the phase    */
+/* factor at each point.                                              */
+/**********************************************************************/
+void PlaneWave::GetFieldsBatch(int N, const double *X, cdouble *EH)
+{
   cdouble K=sqrt(Eps*Mu) * Omega;
   cdouble Z=ZVAC*sqrt(Mu/Eps);
-  cdouble ExpFac=exp(II*K*(nHat[0]*X[0] + nHat[1]*X[1] + nHat[2]*X[2]));
 
-  EH[0] = E0[0] * ExpFac;
-  EH[1] = E0[1] * ExpFac;
-  EH[2] = E0[2] * ExpFac;
+  cdouble H0[3];
+  H0[0] = (nHat[1]*E0[2] - nHat[2]*E0[1]) / Z;
+  H0[1] = (nHat[2]*E0[0] - nHat[0]*E0[2]) / Z;
+  H0[2] = (nHat[0]*E0[1] - nHat[1]*E0[0]) / Z;
+
+  cdouble IK=II*K;
+  for(int n=0; n<N; n++)
+   { 
+     const double *XX = X + 3*n;
+     cdouble *EHX     = EH + 6*n;
+     cdouble ExpFac=exp(IK*(nHat[0]*XX[0] + nHat[1]*XX[1] + nHat[2]*XX[2]));
 
-  /* H = (nHat \cross E) / Z */
-  EH[3] = (nHat[1]*EH[2] - nHat[2]*EH[1]) / Z;
-  EH[4] = (nHat[2]*EH[0] - nHat[0]*EH[2]) / Z ;
-  EH[5] = (nHat[0]*EH[1] - nHat[1]*EH[0]) / Z;
-  
-} 
+     EHX[0] = E0[0] * ExpFac;
+     EHX[1] = E0[1] * ExpFac;
+     EHX[2] = E0[2] * ExpFac;
+     EHX[3] = H0[0] * ExpFac;
+     EHX[4] = H0[1] * ExpFac;
+     EHX[5] = H0[2] * ExpFac;
+   };
+}
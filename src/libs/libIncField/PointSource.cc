@@ -71,58 +71,77 @@ bool PointSource::GetSourcePoint(double X[3]) const
 /**********************************************************************/
 void PointSource::GetFields(const double X[3], cdouble EH[6])
 {
-  /* construct R, RHat, etc. */
-  double RHat[3], R;
-  RHat[0]=X[0] - X0[0];
-  RHat[1]=X[1] - X0[1];
-  RHat[2]=X[2] - X0[2];
-  R=sqrt(  RHat[0]*RHat[0] + RHat[1]*RHat[1] + RHat[2]*RHat[2] );
-  RHat[0]/=R;
-  RHat[1]/=R;
-  RHat[2]/=R;
-
-  cdouble PDotR, RCrossP[3];
-  PDotR=P[0]*RHat[0] + P[1]*RHat[1] + P[2]*RHat[2];
-  RCrossP[0]= RHat[1]*P[2] - RHat[2]*P[1];
-  RCrossP[1]= RHat[2]*P[0] - RHat[0]*P[2];
-  RCrossP[2]= RHat[0]*P[1] - RHat[1]*P[0];
-  
-  cdouble k      = Omega*sqrt(Eps*Mu);
-  cdouble ikr    = II*k*R;
-  cdouble ikr2   = ikr*ikr;
-  cdouble ExpFac = k*k*exp(ikr) / (4.0*M_PI*R);
+  GetFieldsBatch(1, X, EH);
+}
 
+void PointSource::GetFieldsBatch(int N, const double *X, cdouble *EH)
+{
+  /* quantities that are the same at all evaluation points */
+  cdouble k      = Omega*sqrt(Eps*Mu);
+  cdouble ik     = II*k;
   cdouble Z      = ZVAC*sqrt(Mu/Eps);
-
-  /* compute the various scalar quantities in the point source formulae */
-  cdouble Term1=  1.0 - 1.0/ikr + 1.0/ikr2; 
-  cdouble Term2= (-1.0 + 3.0/ikr - 3.0/ikr2) * PDotR; 
-  cdouble Term3= (1.0 - 1.0/ikr);
-
-  /* now assemble everything based on source type */
+  cdouble Prefac = k*k / (4.0*M_PI);
+  cdouble EFac, HFac;
   if ( Type == LIF_ELECTRIC_DIPOLE )
-   { 
-     ExpFac /= Eps;
-
-     EH[0]=ExpFac*( Term1*P[0] + Term2*RHat[0] );
-     EH[1]=ExpFac*( Term1*P[1] + Term2*RHat[1] );
-     EH[2]=ExpFac*( Term1*P[2] + Term2*RHat[2] );
-
-     EH[3]=ExpFac*Term3*RCrossP[0] / Z;
-     EH[4]=ExpFac*Term3*RCrossP[1] / Z;
-     EH[5]=ExpFac*Term3*RCrossP[2] / Z;
+   { Prefac /= Eps;
+     EFac    = 1.0;
+     HFac    = 1.0/Z;
    }
   else // ( Type == LIF_TYPE_PSMC )
-   { 
-     ExpFac /= Mu;
-
-     EH[0]=-1.0*ExpFac*Term3*RCrossP[0] / Z;
-     EH[1]=-1.0*ExpFac*Term3*RCrossP[1] / Z;
-     EH[2]=-1.0*ExpFac*Term3*RCrossP[2] / Z;
+   { Prefac /= Mu;
+     EFac    = -1.0/Z;
+     HFac    = 1.0/(Z*Z);
+   };
 
-     EH[3]=ExpFac*( Term1*P[0] + Term2*RHat[0] ) / (Z*Z);
-     EH[4]=ExpFac*( Term1*P[1] + Term2*RHat[1] ) / (Z*Z);
-     EH[5]=ExpFac*( Term1*P[2] + Term2*RHat[2] ) / (Z*Z);
+  for(int n=0; n<N; n++)
+   { 
+     const double *XX = X + 3*n;
+     cdouble *EHX     = EH + 6*n;
+
+     /* construct R, RHat, etc. */
+     double RHat[3], R;
+     RHat[0]=XX[0] - X0[0];
+     RHat[1]=XX[1] - X0[1];
+     RHat[2]=XX[2] - X0[2];
+     R=sqrt(  RHat[0]*RHat[0] + RHat[1]*RHat[1] + RHat[2]*RHat[2] );
+     RHat[0]/=R;
+     RHat[1]/=R;
+     RHat[2]/=R;
+
+     cdouble PDotR, RCrossP[3];
+     PDotR=P[0]*RHat[0] + P[1]*RHat[1] + P[2]*RHat[2];
+     RCrossP[0]= RHat[1]*P[2] - RHat[2]*P[1];
+     RCrossP[1]= RHat[2]*P[0] - RHat[0]*P[2];
+     RCrossP[2]= RHat[0]*P[1] - RHat[1]*P[0];
+
+     cdouble ikr    = ik*R;
+     cdouble ikr2   = ikr*ikr;
+     cdouble ExpFac = Prefac*exp(ikr) / R;
+
+     /* compute the various scalar quantities in the point source formulae */
+     cdouble Term1=  1.0 - 1.0/ikr + 1.0/ikr2;
+     cdouble Term2= (-1.0 + 3.0/ikr - 3.0/ikr2) * PDotR;
+     cdouble Term3= (1.0 - 1.0/ikr);
+
+     /* the 'longitudinal' field (E for an electric dipole, H for  */
+     /* a magnetic dipole) and the 'transverse' field              */
+     cdouble FL[3], FT[3];
+     FL[0]=ExpFac*( Term1*P[0] + Term2*RHat[0] );
+     FL[1]=ExpFac*( Term1*P[1] + Term2*RHat[1] );
+     FL[2]=ExpFac*( Term1*P[2] + Term2*RHat[2] );
+     FT[0]=ExpFac*Term3*RCrossP[0];
+     FT[1]=ExpFac*Term3*RCrossP[1];
+     FT[2]=ExpFac*Term3*RCrossP[2];
+
+     /* now assemble everything based on source type */
+     if ( Type == LIF_ELECTRIC_DIPOLE )
+      { EHX[0]=FL[0];        EHX[1]=FL[1];        EHX[2]=FL[2];
+        EHX[3]=HFac*FT[0];   EHX[4]=HFac*FT[1];   EHX[5]=HFac*FT[2];
+      }
+     else
+      { EHX[0]=EFac*FT[0];   EHX[1]=EFac*FT[1];   EHX[2]=EFac*FT[2];
+        EHX[3]=HFac*FL[0];   EHX[4]=HFac*FL[1];   EHX[5]=HFac*FL[2];
+      };
    };
 
 }
@@ -78,6 +78,13 @@ class IncField
    
    virtual void GetFields(const double X[3], cdouble EH[6]) = 0 ;
    void GetTotalFields(const double X[3], cdouble EH[6]);
+
+   // fields at N points at once: X[3*n+i] is the ith coordinate of
+   // the nth point, and the fields there are returned in EH[6*n+0..5].
+   // the default implementation just calls GetFields() N times;
+   // subclasses may override it to hoist per-source setup out of 
+   // the loop over points.
+   virtual void GetFieldsBatch(int N, const double *X, cdouble *EH);
  };
 
 /**********************************************************************/
@@ -100,6 +107,7 @@ class PlaneWave : public IncField
    void SetnHat(double nHat[3]);
 
    void GetFields(const double X[3], cdouble EH[6]);
+   void GetFieldsBatch(int N, const double *X, cdouble *EH);
 
  };
 
@@ -123,6 +131,7 @@ class PointSource: public IncField
    void SetType(int pType);
 
    void GetFields(const double X[3], cdouble EH[6]);
+   void GetFieldsBatch(int N, const double *X, cdouble *EH);
    bool GetSourcePoint(double X[3]) const;
  };
 
@@ -147,6 +156,7 @@ class GaussianBeam: public IncField
    void SetW0(double pW0);
 
    void GetFields(const double X[3], cdouble EH[6]);
+   void GetFieldsBatch(int N, const double *X, cdouble *EH);
 
    double TotalBeamFlux();
 
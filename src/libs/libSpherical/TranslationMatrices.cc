@@ -36,14 +36,15 @@
  *     lies at x. 
  *
  *     (for real frequencies, Phi_{lm}(R) = h_l(kr) Y_{lm}(theta, phi);
- *      for imag frequencies, Phi_{lm}(R) = k_l(kr) Y_{lm}(theta, phi))
+ *      for imag frequencies k=i*kappa, h_l(kr) = -i^{-l} k_l(kappa*r),
+ *      see GetRadialFunctions in libSpherical.cc)
  *
  *  e) similarly, let Psi_{lm}(xpp-xp) be the value of an INTERIOR helmholtz 
  *     solution at xpp as reckoned from a coordinate system whose origin
  *     lies at xp. 
  *
  *     (for real frequencies, Psi_{lm}(R) = j_l(kr) Y_{lm}(theta, phi);
- *      for imag frequencies, Psi_{lm}(R) = i_l(kr) Y_{lm}(theta, phi))
+ *      for imag frequencies k=i*kappa, j_l(kr) = i^{l} i_l(kappa*r))
  *     
  *  e) then the translation matrix expresses Phi_{lm}(xpp-x) in terms
  *     of Psi_{lm}(xpp-xp), as follows:
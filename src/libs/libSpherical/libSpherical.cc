@@ -35,6 +35,7 @@
 #include "AmosBessel.h"
 
 #define II cdouble(0.0,1.0)
+#define IIPOW(n) ( (n)%4 == 0 ? cdouble(1.0,0.0) : (n)%4 == 1 ? II : (n)%4 == 2 ? cdouble(-1.0,0.0) : -1.0*II )
 #define ROOT2 1.41421356237309504880
 
 /***************************************************************/
@@ -429,17 +430,35 @@ void GetRadialFunctions(int lMax, cdouble k, double r, int WaveType,
      return;
    };
   
-  if ( real(k)==0.0 )
+  /*--------------------------------------------------------------*/
+  /*- 20261019 for pure imaginary k=i*kappa (kappa>0) we use the -*/
+  /*- modified spherical bessel functions of real argument, with -*/
+  /*- the phase factors that make them the analytic continuations-*/
+  /*- of the real-frequency functions:                           -*/
+  /*-   j_l(i*kappa*r)       =  i^{+l} i_l(kappa*r)              -*/
+  /*-   h^{(1)}_l(i*kappa*r) = -i^{-l} k_l(kappa*r)              -*/
+  /*- (previously the phase factors were omitted, so the M and N -*/
+  /*- functions and the translation matrices at imaginary k did  -*/
+  /*- not obey the same relations as at real k.) incoming waves  -*/
+  /*- grow exponentially at imaginary k and use the general path.-*/
+  /*--------------------------------------------------------------*/
+  kr=k*r;
+  if ( real(k)==0.0 && imag(k)>0.0 && WaveType!=LS_INCOMING )
    { 
-     kr=imag(k)*r;
+     double KappaR=imag(k)*r;
      if ( WaveType == LS_REGULAR )
-      AmosBessel('i',kr,0.0,lMax+2,0,R,Workspace);
-     else // no distinction between incoming/outgoing in this case, right?
-      AmosBessel('k',kr,0.0,lMax+2,0,R,Workspace);
+      { AmosBessel('i',KappaR,0.0,lMax+2,0,R,Workspace);
+        for(l=0; l<=lMax+1; l++)
+         R[l] *= IIPOW(l);
+      }
+     else
+      { AmosBessel('k',KappaR,0.0,lMax+2,0,R,Workspace);
+        for(l=0; l<=lMax+1; l++)
+         R[l] *= -1.0*IIPOW(4-(l%4));
+      };
    }
   else
-   { kr=k*r;
-     if ( WaveType == LS_REGULAR )
+   { if ( WaveType == LS_REGULAR )
       AmosBessel('j',kr,0.0,lMax+2,0,R,Workspace);
      else if ( WaveType == LS_OUTGOING ) 
       AmosBessel('o',kr,0.0,lMax+2,0,R,Workspace);
@@ -460,10 +479,10 @@ void GetRadialFunctions(int lMax, cdouble k, double r, int WaveType,
   /* verify.                                                       */
   /* 20100519 yes, this is correct by eq 10.2.21 of abramowitz+stegun */ 
   /*  (page 444)                                                   */
-  if ( real(k)==0.0 && WaveType==LS_REGULAR )
-   Sign=1.0;
-  else
-   Sign=-1.0;
+  /* 20261019 with the phase factors above, the R functions at     */
+  /*  imaginary k are the analytic continuations of j_l and h_l,   */
+  /*  so the first recurrence applies at all k.                    */
+  Sign=-1.0;
 
   for(l=0; l<=lMax; l++)
    { 
@@ -507,8 +526,8 @@ void GetRadialFunction(int l, cdouble k, double r, int WaveType,
 /* where the radial function f_l(kr) is                        */
 /*  a. j_l(kr)            for interior, real-frequency         */
 /*  b. j_l(kr) + iy_l(kr) for exterior, real-frequency         */
-/*  c. i_l(kappa*r)       for interior, imag-frequency         */
-/*  d. k_l(kappa*r)       for exterior, imag-frequency         */
+/*  c. i^l i_l(kappa*r)       for interior, imag-frequency     */
+/*  d. -i^{-l} k_l(kappa*r)   for exterior, imag-frequency     */
 /*      (where kappa=imag(k))                                  */
 /*                                                             */
 /* set WaveType=LS_REGULAR, LS_OUTGOING, or LS_INCOMING.       */
@@ -658,8 +677,8 @@ void GetXlmArray(int lMax, double Theta, double Phi, cdouble *X)
 /* and where the radial function f_l(kr) is                    */
 /*  a. j_l(kr)            for interior, real-frequency         */
 /*  b. j_l(kr) + iy_l(kr) for exterior, real-frequency         */
-/*  c. i_l(kappa*r)       for interior, imag-frequency         */
-/*  d. k_l(kappa*r)       for exterior, imag-frequency         */
+/*  c. i^l i_l(kappa*r)       for interior, imag-frequency     */
+/*  d. -i^{-l} k_l(kappa*r)   for exterior, imag-frequency     */
 /*      (where kappa=imag(k))                                  */ 
 /*                                                             */ 
 /* set WaveType=LS_REGULAR, LS_OUTGOING, or LS_INCOMING.       */
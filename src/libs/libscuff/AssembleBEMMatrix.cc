@@ -546,6 +546,89 @@ done:
 
 }
 
+/***************************************************************/
+/* if surface #ns is a pure translation of the first surface   */
+/* identical to it (as recorded in the Mate[] array), return   */
+/* the index of that surface and set D to the displacement;    */
+/* otherwise return -1.                                        */
+/***************************************************************/
+static int GetTranslationClass(RWGGeometry *G, int ns, double D[3])
+{
+  int nsc = (G->Mate[ns]==-1) ? ns : G->Mate[ns];
+  RWGSurface *S  = G->Surfaces[ns];
+  RWGSurface *SC = G->Surfaces[nsc];
+  if ( S->NumVertices != SC->NumVertices )
+   return -1;
+
+  VecSub(S->Vertices, SC->Vertices, D);
+  for(int nv=1; nv<S->NumVertices; nv++)
+   { double DV[3];
+     VecSub(S->Vertices + 3*nv, SC->Vertices + 3*nv, DV);
+     if ( VecDistance(D, DV) > G->tolVecClose )
+      return -1;
+   };
+  return nsc;
+}
+
+/***************************************************************/
+/* in a geometry containing several copies of the same surface */
+/* that differ only by translations (such as a finite array of */
+/* identical particles) the off-diagonal block for a pair of   */
+/* surfaces depends only on the classes of the two surfaces,   */
+/* their relative displacement, and the regions they bound.    */
+/* a BlockRecord describes one block that was actually         */
+/* computed, so that later blocks in the same equivalence      */
+/* class can be copied from it.                                */
+/***************************************************************/
+typedef struct BlockRecord
+ { int ns, nsp;        // surfaces whose block was computed
+   int Class, ClassP;  // translation classes of ns, nsp
+   double DeltaR[3];   // displacement of nsp relative to ns
+ } BlockRecord;
+
+static bool SameRegions(RWGSurface *S1, RWGSurface *S2)
+{ return    S1->RegionIndices[0]==S2->RegionIndices[0]
+         && S1->RegionIndices[1]==S2->RegionIndices[1];
+}
+
+/***************************************************************/
+/* look for a previously-computed block equivalent to block    */
+/* (ns,nsp) of the BEM matrix, either directly or up to        */
+/* transposition. returns the index of the record in BRs, or   */
+/* -1 if none was found; *Transpose is set to true if the      */
+/* block found is the transpose of the block we want.          */
+/***************************************************************/
+static int FindEquivalentBlock(RWGGeometry *G, BlockRecord *BRs, int NumBRs,
+                               int Class, int ClassP, int ns, int nsp,
+                               double DeltaR[3], bool *Transpose)
+{
+  double Tol = G->tolVecClose;
+  for(int nbr=0; nbr<NumBRs; nbr++)
+   { BlockRecord *BR=BRs+nbr;
+     if (    BR->Class==Class && BR->ClassP==ClassP
+          && VecDistance(BR->DeltaR, DeltaR)<Tol
+          && SameRegions(G->Surfaces[BR->ns],  G->Surfaces[ns])
+          && SameRegions(G->Surfaces[BR->nsp], G->Surfaces[nsp])
+        )
+      { *Transpose=false;
+        return nbr;
+      };
+
+     // M(ns,nsp) = M(nsp,ns)^T and (nsp,ns) may be equivalent to BR
+     double MinusDeltaR[3];
+     VecScale(VecCopy(DeltaR, MinusDeltaR), -1.0);
+     if (    BR->Class==ClassP && BR->ClassP==Class
+          && VecDistance(BR->DeltaR, MinusDeltaR)<Tol
+          && SameRegions(G->Surfaces[BR->ns],  G->Surfaces[nsp])
+          && SameRegions(G->Surfaces[BR->nsp], G->Surfaces[ns])
+        )
+      { *Transpose=true;
+        return nbr;
+      };
+   };
+  return -1;
+}
+
 /***************************************************************/
 /* this is the actual API-exposed routine for assembling the   */
 /* BEM matrix, which is pretty simple and really just calls    */
@@ -579,6 +662,22 @@ HMatrix *RWGGeometry::AssembleBEMMatrix(cdouble Omega, double *kBloch, HMatrix *
   // don't have a nonzero bloch wavevector.
   bool MatrixIsSymmetric = ( !kBloch || (kBloch[0]==0.0 && kBloch[1]==0.0) );
 
+  /***************************************************************/
+  /* for non-periodic geometries, figure out which surfaces are  */
+  /* pure translations of identical surfaces, so that we can     */
+  /* reuse off-diagonal blocks as well as diagonal blocks        */
+  /***************************************************************/
+  int *Class=0, NumBRs=0;
+  double *Displacements=0;
+  BlockRecord *BRs=0;
+  if (LDim==0)
+   { Class=(int *)mallocEC(NumSurfaces*sizeof(int));
+     Displacements=(double *)mallocEC(3*NumSurfaces*sizeof(double));
+     BRs=(BlockRecord *)mallocEC(NumSurfaces*NumSurfaces*sizeof(BlockRecord));
+     for(int ns=0; ns<NumSurfaces; ns++)
+      Class[ns]=GetTranslationClass(this, ns, Displacements + 3*ns);
+   };
+
   /***************************************************************/
   /* loop over all pairs of objects to assemble the diagonal and */
   /* above-diagonal blocks of the matrix                         */
@@ -588,19 +687,61 @@ HMatrix *RWGGeometry::AssembleBEMMatrix(cdouble Omega, double *kBloch, HMatrix *
   for(int ns=0; ns<NumSurfaces; ns++)
    for(int nsp=nspStart*ns; nsp<NumSurfaces; nsp++)
     { 
+      int RowOffset = BFIndexOffset[ns];
+      int ColOffset = BFIndexOffset[nsp];
+
       // attempt to reuse the diagonal block of an identical previous object
       if (ns==nsp && (nsm=Mate[ns])!=-1)
-       { int ThisOffset = BFIndexOffset[ns];
-         int MateOffset = BFIndexOffset[nsm];
+       { int MateOffset = BFIndexOffset[nsm];
          int Dim = Surfaces[ns]->NumBFs;
          Log("Block(%i,%i) is identical to block (%i,%i) (reusing)",ns,ns,nsm,nsm);
-         M->InsertBlock(M, ThisOffset, ThisOffset, Dim, Dim, MateOffset, MateOffset);
-       }
-      else
-       AssembleBEMMatrixBlock(ns, nsp, Omega, kBloch, M, 0,
-                              BFIndexOffset[ns], BFIndexOffset[nsp]);
+         M->InsertBlock(M, RowOffset, RowOffset, Dim, Dim, MateOffset, MateOffset);
+         continue;
+       };
+
+      // attempt to reuse an off-diagonal block for an equivalent
+      // pair of translated surfaces
+      if ( ns!=nsp && Class && Class[ns]!=-1 && Class[nsp]!=-1 )
+       { double DeltaR[3];
+         VecSub(Displacements + 3*nsp, Displacements + 3*ns, DeltaR);
+         bool Transpose;
+         int nbr=FindEquivalentBlock(this, BRs, NumBRs, Class[ns], Class[nsp],
+                                     ns, nsp, DeltaR, &Transpose);
+         if (nbr!=-1)
+          { int nsb=BRs[nbr].ns, nspb=BRs[nbr].nsp;
+            int SrcRowOffset = BFIndexOffset[nsb];
+            int SrcColOffset = BFIndexOffset[nspb];
+            int NR = Surfaces[ns]->NumBFs, NC=Surfaces[nsp]->NumBFs;
+            Log("Block(%i,%i) is identical to block (%i,%i)%s (reusing)",
+                 ns,nsp,nsb,nspb,Transpose ? "^T" : "");
+            if (Transpose)
+             { for(int nr=0; nr<NR; nr++)
+                for(int nc=0; nc<NC; nc++)
+                 M->SetEntry(RowOffset+nr, ColOffset+nc,
+                             M->GetEntry(SrcRowOffset+nc, SrcColOffset+nr));
+             }
+            else
+             M->InsertBlock(M, RowOffset, ColOffset, NR, NC, SrcRowOffset, SrcColOffset);
+            continue;
+          };
+
+         BlockRecord *BR=BRs + (NumBRs++);
+         BR->ns=ns;
+         BR->nsp=nsp;
+         BR->Class=Class[ns];
+         BR->ClassP=Class[nsp];
+         VecCopy(DeltaR, BR->DeltaR);
+       };
+
+      AssembleBEMMatrixBlock(ns, nsp, Omega, kBloch, M, 0, RowOffset, ColOffset);
     };
 
+  if (Class)
+   { free(Class);
+     free(Displacements);
+     free(BRs);
+   };
+
   /***************************************************************/
   /* if the matrix is symmetric, then the computations above have*/
   /* only filled in its upper triangle, so we need to go back and*/
@@ -18,8 +18,67 @@
  */
 
 /*
- * AssembleDMDVMatrix.cc
- * 
+ * AssembleDMDVMatrix.cc -- derivatives of the BEM matrix with respect
+ *                       -- to the cartesian coordinates of mesh vertices
+ *
+ * how it works:
+ *
+ *  (a) moving vertex #nv of a surface changes only the panels that
+ *      have nv as a corner and the basis functions on the edges that
+ *      bound those panels (the 'stencil' of the vertex, typically
+ *      10-20 edges). thus dM/dV is nonzero only in the rows and
+ *      columns of the stencil basis functions, and since the BEM
+ *      matrix is symmetric it suffices to compute the rows.
+ *
+ *  (b) the rows are computed in a single pass: we call
+ *      GetSurfaceSurfaceInteractions() in row-selection mode with
+ *      the DVertex field set, in which case the GradB[Mu] slots
+ *      that normally receive displacement derivatives receive the
+ *      derivatives with respect to coordinate Mu of the vertex.
+ *      at the panel-pair level (PanelPanelInteractions.cc):
+ *
+ *       -- pairs integrated by fixed-order cubature are
+ *          differentiated analytically. the cubature points of a
+ *          panel move with the barycentric weight of the vertex,
+ *          so the derivative needs only the kernel derivatives
+ *          already used for displacement gradients, and the value
+ *          and all three derivatives come from one set of kernel
+ *          evaluations.
+ *
+ *       -- pairs integrated by desingularization or Taylor-Duffy
+ *          (which touch the vertex only if the panels are
+ *          neighbors) are differentiated by central differences
+ *          on a private copy of the vertex, with the integration
+ *          algorithm pinned to the one used for the unperturbed
+ *          pair, so that the step never switches quadrature rules.
+ *
+ *      the derivatives of the RWG edge lengths are added in
+ *      GetEdgeEdgeInteractions(). nothing in the geometry is ever
+ *      modified, so the computation is thread-safe.
+ *
+ *  (c) the singular panel-panel integrals of the displaced panel
+ *      pairs in (b) are never needed again, so instead of
+ *      cluttering the global FIPPI cache they go into a private
+ *      cache that is discarded once a vertex is done.
+ *
+ *  (d) for gradient-based optimization one rarely wants dM/dV itself.
+ *      if KN solves M*KN=RHS and Lambda solves the adjoint system
+ *      M^T * Lambda = dF/dKN, then the derivative of the objective F
+ *      with respect to vertex coordinate V is (up to derivatives of
+ *      the RHS) -Lambda^T * (dM/dV) * KN. GetDMDVContractions()
+ *      computes Lambda^T * (dM/dV) * KN for all vertices of a surface
+ *      at once, so a full shape gradient costs the forward solve, one
+ *      adjoint solve (with the same LU factorization), and one pass
+ *      over the vertices here; no NxN derivative matrix is ever formed.
+ *      with D=dM/dV nonzero only in rows and columns in the stencil
+ *      set S, and D symmetric, we have
+ *
+ *       Lambda^T D KN =   sum_{i in S} Lambda_i (D_i . KN)
+ *                       + sum_{j in S} KN_j (D_j . Lambda)
+ *                       - sum_{i,j in S} Lambda_i D_ij KN_j
+ *
+ *      where D_i is row #i of D.
+ *
  * homer reid   -- 05/2011
  */
 
@@ -27,194 +86,316 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-#include <pthread.h>
 
 #include <libhmat.h>
 #include <libhrutil.h>
 
 #include "libscuff.h"
+#include "libscuffInternals.h"
 
 namespace scuff {
 
-#define II cdouble(0,1)
-
-/***************************************************************/
 /***************************************************************/
+/* for each vertex nv of S, VPList[ VPStart[nv] ... ] are the  */
+/* indices of the panels that have nv as a corner.             */
 /***************************************************************/
-void RWGGeometry::GetMEVertexDerivative(void *pLFW, 
-                                        RWGObject *O, int ne, 
-                                        RWGObject *OP, int nep,
-                                        int VertexIndex, int Mu, 
-                                        double AverageRadius,
-                                        double Frequency, int RealFreq,
-                                        cdouble *dmdv)
+static void GetVertexPanelLists(RWGSurface *S, int **pVPStart, int **pVPList)
 {
+  int NV=S->NumVertices, NP=S->NumPanels;
+
+  int *VPStart=(int *)mallocEC((NV+1)*sizeof(int));
+  memset(VPStart, 0, (NV+1)*sizeof(int));
+  for(int np=0; np<NP; np++)
+   for(int i=0; i<3; i++)
+    VPStart[ S->Panels[np]->VI[i] + 1 ]++;
+  for(int nv=0; nv<NV; nv++)
+   VPStart[nv+1]+=VPStart[nv];
+
+  int *VPList=(int *)mallocEC((3*NP+1)*sizeof(int));
+  int *Next=(int *)mallocEC((NV+1)*sizeof(int));
+  memcpy(Next, VPStart, NV*sizeof(int));
+  for(int np=0; np<NP; np++)
+   for(int i=0; i<3; i++)
+    VPList[ Next[ S->Panels[np]->VI[i] ]++ ] = np;
+  free(Next);
+
+  *pVPStart=VPStart;
+  *pVPList=VPList;
+}
 
-  /***************************************************************/
-  /* for the purposes of this calculation we need to mask the ****/
-  /* fact that O might have a table of static panel-panel      ***/
-  /* integrals                                                 ***/
-  /***************************************************************/
-  StaticPPIDataTable *SPPIDTableSave;
-  SPPIDTableSave=O->SPPIDTable;
-  O->SPPIDTable=0;
-  
-  /***************************************************************/
-  /* use a four-point finite-difference scheme to estimate the   */
-  /* derivatives of the matrix element w.r.t. displacement of    */
-  /* this vertex                                                 */
-  /***************************************************************/
-  double Delta;
-  static HMatrix *MM2D=0, *MM1D, *MP1D, *MP2D;
-
-  if (MM2D==0)
-   { MM2D=new HMatrix(2,2,LHM_COMPLEX);
-     MM1D=new HMatrix(2,2,LHM_COMPLEX);
-     MP1D=new HMatrix(2,2,LHM_COMPLEX);
-     MP2D=new HMatrix(2,2,LHM_COMPLEX);
+/***************************************************************/
+/* get the stencil edges of a vertex, given its stencil panels.*/
+/* EdgeMark is a NumEdges-element scratch array with no entry  */
+/* equal to Stamp on entry. returns the number of edges.       */
+/***************************************************************/
+static int GetStencilEdges(RWGSurface *S, int NumSPanels, int *SPanels,
+                           int *SEdges, int *EdgeMark, int Stamp)
+{
+  int NumSEdges=0;
+  for(int n=0; n<NumSPanels; n++)
+   { RWGPanel *P=S->Panels[ SPanels[n] ];
+     for(int i=0; i<3; i++)
+      { int ne=P->EI[i];
+        if ( ne<0 || EdgeMark[ne]==Stamp ) continue;
+        EdgeMark[ne]=Stamp;
+        SEdges[NumSEdges++]=ne;
+      };
    };
+  return NumSEdges;
+}
 
-  Delta=1.0e-2*AverageRadius;
-
-  O->Vertices[3*VertexIndex + Mu] -= 2.0*Delta;
-  StampMatrixElements(pLFW, O, ne, 0, OP, nep, 0, Frequency, RealFreq, 
-                      0, 0, MM2D, 0, 0, 0, 0, 0, 0);
-
-  O->Vertices[3*VertexIndex + Mu] += Delta;
-  StampMatrixElements(pLFW, O, ne, 0, OP, nep, 0, Frequency, RealFreq, 
-                      0, 0, MM1D, 0, 0, 0, 0, 0, 0);
-  O->Vertices[3*VertexIndex + Mu] += 2.0*Delta;
-  StampMatrixElements(pLFW, O, ne, 0, OP, nep, 0, Frequency, RealFreq, 
-                      0, 0, MP1D, 0, 0, 0, 0, 0, 0);
-  O->Vertices[3*VertexIndex + Mu] += Delta;
-  StampMatrixElements(pLFW, O, ne, 0, OP, nep, 0, Frequency, RealFreq, 
-                      0, 0, MP2D, 0, 0, 0, 0, 0, 0);
-  O->Vertices[3*VertexIndex + Mu] -= 2.0*Delta;
- 
-  dmdv[0] = (  -1.0*MP2D->GetEntry(0,0) 
-               +8.0*MP1D->GetEntry(0,0)
-               -8.0*MM1D->GetEntry(0,0)
-               +1.0*MM2D->GetEntry(0,0) ) / (12.0);
-
-  dmdv[1] = (  -1.0*MP2D->GetEntry(0,1) 
-               +8.0*MP1D->GetEntry(0,1)
-               -8.0*MM1D->GetEntry(0,1)
-               +1.0*MM2D->GetEntry(0,1) ) / (12.0);
-
-  dmdv[2] = (  -1.0*MP2D->GetEntry(1,1) 
-               +8.0*MP1D->GetEntry(1,1)
-               -8.0*MM1D->GetEntry(1,1)
-               +1.0*MM2D->GetEntry(1,1) ) / (12.0);
-
-  /***************************************************************/
-  /* unmask static panel-panel-integral table inside O ***********/
-  /***************************************************************/
-  O->SPPIDTable=SPPIDTableSave;
-
+/***************************************************************/
+/* compute the derivatives of the BEM matrix rows of the       */
+/* stencil edges of vertex #nv of surface #ns with respect to  */
+/* the three coordinates of the vertex into the first          */
+/* (1 or 2)*NumSEdges rows of GradB[0..2]. B receives the rows */
+/* themselves (which are not needed, but come for free).       */
+/***************************************************************/
+static void GetStencilRowDerivatives(RWGGeometry *G, int ns, int nv,
+                                     int NumSEdges, int *SEdges,
+                                     cdouble Omega, void *opFC,
+                                     HMatrix *B, HMatrix *GradB[3])
+{
+  RWGSurface *S=G->Surfaces[ns];
+
+  GetSSIArgStruct MyArgs, *Args=&MyArgs;
+  InitGetSSIArgs(Args);
+  Args->G=G;
+  Args->Omega=Omega;
+  Args->B=B;
+  Args->GradB=GradB;
+  Args->Sa=S;
+  Args->RowOffset=0;
+  Args->NumRowEdges=NumSEdges;
+  Args->RowEdges=SEdges;
+  Args->opFC=opFC;
+  Args->DVertex=S->Vertices + 3*nv;
+  for(int nsp=0; nsp<G->NumSurfaces; nsp++)
+   { Args->Sb=G->Surfaces[nsp];
+     Args->ColOffset=G->BFIndexOffset[nsp];
+     GetSurfaceSurfaceInteractions(Args);
+   };
 }
 
 /***************************************************************/
 /***************************************************************/
 /***************************************************************/
-void RWGGeometry::AssembleDMDVMatrix(int ObjectIndex, int VertexIndex, int Mu, 
-                                     double Frequency, int RealFreq,
-                                     HMatrix *DMDV, int nThread)
-{ 
-  int ne, nep, nop, Offset, OffsetP;
-  int Formulation;
-  RWGObject *O, *OP;
-  RWGEdge *E, *EP;
-  cdouble dmdv[3];
-  static void *pLFW=0;
-
-  if (nThread <= 0) nThread = GetNumThreads();
-
-  if (pLFW==0)
-   pLFW=CreateLFWorkspace();
-
-  /***************************************************************/
-  /* update the cached values of Epsilon and Mu inside all       */
-  /* objects and inside (this)                                   */
-  /***************************************************************/
-  int no;
-  MP->GetEpsMu(Frequency, RealFreq, &EpsThisFreq, &MuThisFreq);
-  for(no=0; no<NumObjects; no++)
-   Objects[no]->MP->GetEpsMu(Frequency, RealFreq, 
-                             &(Objects[no]->EpsThisFreq), 
-                             &(Objects[no]->MuThisFreq));
-
-  /***************************************************************/
-  /***************************************************************/
-  /***************************************************************/
-  O=Objects[ObjectIndex];
-  Offset=BFIndexOffset[ObjectIndex];
-  DMDV->Zero();
+HMatrix *RWGGeometry::AllocateDMDVMatrix(bool PureImagFreq)
+{
+  if (PureImagFreq)
+   return new HMatrix(TotalBFs, TotalBFs, LHM_REAL);
+  else
+   return new HMatrix(TotalBFs, TotalBFs, LHM_COMPLEX);
+}
 
-  /***************************************************************/
-  /***************************************************************/
-  /***************************************************************/
-  double AverageRadius;
-  int np, NumTouchingPanels;
-  RWGPanel *P;
-  AverageRadius=0.0;
-  NumTouchingPanels=0;
-  for(np=0, P=O->Panels[0]; np<O->NumPanels; P=O->Panels[++np])
-   if (P->VI[0]==VertexIndex || P->VI[1]==VertexIndex || P->VI[2]==VertexIndex )
-    { AverageRadius+=P->Radius;
-      NumTouchingPanels++;
-    };
-  AverageRadius/=((double)NumTouchingPanels);
-
-  /***************************************************************/
-  /***************************************************************/
-  /***************************************************************/
-  for(ne=0, E=O->Edges[ne]; ne<O->NumEdges; E=O->Edges[++ne])
-   { 
-     if ( (E->iQP != VertexIndex) && (E->iQM != VertexIndex ) &&
-          (E->iV1 != VertexIndex) && (E->iV2 != VertexIndex ) )
-      continue;
-
-     for(nop=0, OP=Objects[nop]; nop<NumObjects; OP=Objects[++nop])
-      { 
-        OffsetP=BFIndexOffset[nop];
-
-        for(nep=(OP==O ? ne : 0); nep<O->NumEdges; nep++)
-         { 
-           GetMEVertexDerivative(pLFW, O, ne, OP, nep, VertexIndex, Mu, AverageRadius, 
-                                 Frequency, RealFreq, dmdv);
-
-           if (AllPEC)
-            { 
-              DMDV->SetEntry(Offset+ne, OffsetP+nep, dmdv[0] );
-            }
-           else
-            { DMDV->SetEntry(Offset+2*ne,   OffsetP+2*nep,   dmdv[0] );
-              DMDV->SetEntry(Offset+2*ne,   OffsetP+2*nep+1, dmdv[1] ); 
-              DMDV->SetEntry(Offset+2*ne+1, OffsetP+2*nep,   dmdv[1] );
-              DMDV->SetEntry(Offset+2*ne+1, OffsetP+2*nep+1, dmdv[2] );
-            };
-         };
+/***************************************************************/
+/* compute the derivative of the BEM matrix with respect to    */
+/* cartesian coordinate Mu (0,1,2 = x,y,z) of vertex #nv of    */
+/* surface #ns.                                                */
+/***************************************************************/
+HMatrix *RWGGeometry::AssembleDMDVMatrix(int ns, int nv, int Mu,
+                                         cdouble Omega, HMatrix *DMDV)
+{
+  if (LDim>0)
+   ErrExit("%s:%i: vertex derivatives are not supported for periodic geometries",__FILE__,__LINE__);
+  if (ns<0 || ns>=NumSurfaces)
+   ErrExit("%s:%i: invalid surface index %i",__FILE__,__LINE__,ns);
+  RWGSurface *S=Surfaces[ns];
+  if (nv<0 || nv>=S->NumVertices)
+   ErrExit("%s:%i: invalid vertex index %i",__FILE__,__LINE__,nv);
+  if (Mu<0 || Mu>2)
+   ErrExit("%s:%i: invalid coordinate index %i",__FILE__,__LINE__,Mu);
+
+  if ( DMDV && (DMDV->NR!=TotalBFs || DMDV->NC!=TotalBFs) )
+   { Warn("wrong-size DMDV matrix passed to AssembleDMDVMatrix (reallocating)");
+     delete DMDV;
+     DMDV=0;
+   };
+  if (DMDV==0)
+   DMDV=AllocateDMDVMatrix();
+  DMDV->Zero();
 
-      };
+  /*--------------------------------------------------------------*/
+  /*- get the stencil of the vertex ------------------------------*/
+  /*--------------------------------------------------------------*/
+  int NumSPanels=0;
+  int *SPanels=(int *)mallocEC((S->NumPanels+1)*sizeof(int));
+  for(int np=0; np<S->NumPanels; np++)
+   { int *VI=S->Panels[np]->VI;
+     if (VI[0]==nv || VI[1]==nv || VI[2]==nv)
+      SPanels[NumSPanels++]=np;
+   };
+  if (NumSPanels==0)
+   { free(SPanels);
+     return DMDV;
+   };
 
+  int *SEdges=(int *)mallocEC((3*NumSPanels)*sizeof(int));
+  int *EdgeMark=(int *)mallocEC((S->NumEdges+1)*sizeof(int));
+  memset(EdgeMark, 0, (S->NumEdges+1)*sizeof(int));
+  int NumSEdges=GetStencilEdges(S, NumSPanels, SPanels, SEdges, EdgeMark, 1);
+
+  /*--------------------------------------------------------------*/
+  /*- compute the derivatives of the stencil rows ----------------*/
+  /*--------------------------------------------------------------*/
+  int BFsPerEdge = S->IsPEC ? 1 : 2;
+  int NumRows = BFsPerEdge*NumSEdges;
+  if (NumRows>0)
+   {
+     Log("Computing dM/dV for vertex %i of surface %s (%i rows)...",nv,S->Label,NumRows);
+
+     HMatrix *B=new HMatrix(NumRows, TotalBFs, DMDV->RealComplex);
+     HMatrix *GradB[3]={0, 0, 0};
+     GradB[Mu]=new HMatrix(NumRows, TotalBFs, DMDV->RealComplex);
+     FIPPICache *FC=new FIPPICache();
+
+     GetStencilRowDerivatives(this, ns, nv, NumSEdges, SEdges, Omega,
+                              (void *)FC, B, GradB);
+
+     /*--------------------------------------------------------------*/
+     /*- stamp the rows, and by symmetry the columns, into DMDV -----*/
+     /*--------------------------------------------------------------*/
+     for(int n=0; n<NumSEdges; n++)
+      for(int k=0; k<BFsPerEdge; k++)
+       { int Row = BFIndexOffset[ns] + BFsPerEdge*SEdges[n] + k;
+         int BRow = BFsPerEdge*n + k;
+         for(int nc=0; nc<TotalBFs; nc++)
+          { cdouble Entry=GradB[Mu]->GetEntry(BRow, nc);
+            DMDV->SetEntry(Row, nc, Entry);
+            DMDV->SetEntry(nc, Row, Entry);
+          };
+       };
+
+     delete FC;
+     delete B;
+     delete GradB[Mu];
    };
 
-} 
+  free(SPanels);
+  free(SEdges);
+  free(EdgeMark);
+
+  return DMDV;
+}
 
 /***************************************************************/
-/* Allocate a new HMatrix to store the dMdV matrix.    *********/
+/* for all vertices nv of surface #ns and Mu=0,1,2, compute    */
+/*                                                             */
+/*  LDMDVKN[nv,Mu] = Lambda^T * (dM / dV_{nv,Mu}) * KN         */
+/*                                                             */
+/* where V_{nv,Mu} is cartesian coordinate Mu of vertex #nv.   */
+/* the return value is a NumVertices x 3 complex matrix.       */
+/*                                                             */
+/* see item (d) in the comments at the top of this file for    */
+/* the use of this quantity in adjoint shape optimization.     */
 /***************************************************************/
-HMatrix *RWGGeometry::AllocateDMDVMatrix(int RealFreq)
-{ 
-  HMatrix *DMDV;
-
-  if (RealFreq)
-   DMDV=new HMatrix(TotalBFs,TotalBFs,LHM_COMPLEX,LHM_SYMMETRIC);
-  else
-   DMDV=new HMatrix(TotalBFs,TotalBFs,LHM_REAL,LHM_SYMMETRIC);
+HMatrix *RWGGeometry::GetDMDVContractions(int ns, cdouble Omega,
+                                          HVector *Lambda, HVector *KN,
+                                          HMatrix *LDMDVKN)
+{
+  if (LDim>0)
+   ErrExit("%s:%i: vertex derivatives are not supported for periodic geometries",__FILE__,__LINE__);
+  if (ns<0 || ns>=NumSurfaces)
+   ErrExit("%s:%i: invalid surface index %i",__FILE__,__LINE__,ns);
+  if (Lambda->N!=TotalBFs || KN->N!=TotalBFs)
+   ErrExit("%s:%i: wrong-size vectors passed to GetDMDVContractions",__FILE__,__LINE__);
+
+  RWGSurface *S=Surfaces[ns];
+  int NV=S->NumVertices;
+
+  if ( LDMDVKN && (LDMDVKN->NR!=NV || LDMDVKN->NC!=3 || LDMDVKN->RealComplex!=LHM_COMPLEX) )
+   { Warn("wrong-size matrix passed to GetDMDVContractions (reallocating)");
+     delete LDMDVKN;
+     LDMDVKN=0;
+   };
+  if (LDMDVKN==0)
+   LDMDVKN=new HMatrix(NV, 3, LHM_COMPLEX);
+  LDMDVKN->Zero();
+
+  /*--------------------------------------------------------------*/
+  /*- per-vertex panel lists and workspace -----------------------*/
+  /*--------------------------------------------------------------*/
+  int *VPStart, *VPList;
+  GetVertexPanelLists(S, &VPStart, &VPList);
+
+  int MaxSPanels=0;
+  for(int nv=0; nv<NV; nv++)
+   if ( VPStart[nv+1]-VPStart[nv] > MaxSPanels )
+    MaxSPanels = VPStart[nv+1]-VPStart[nv];
+
+  int BFsPerEdge = S->IsPEC ? 1 : 2;
+  int MaxRows = BFsPerEdge*3*MaxSPanels;
+  int *SEdges=(int *)mallocEC((3*MaxSPanels+1)*sizeof(int));
+  int *EdgeMark=(int *)mallocEC((S->NumEdges+1)*sizeof(int));
+  memset(EdgeMark, 0, (S->NumEdges+1)*sizeof(int));
+  int *Rows=(int *)mallocEC((MaxRows+1)*sizeof(int));
+
+  int RealComplex = (real(Omega)==0.0) ? LHM_REAL : LHM_COMPLEX;
+  int NR = MaxRows>0 ? MaxRows : 1;
+  HMatrix *B = new HMatrix(NR, TotalBFs, RealComplex);
+  HMatrix *GradB[3];
+  for(int Mu=0; Mu<3; Mu++)
+   GradB[Mu] = new HMatrix(NR, TotalBFs, RealComplex);
+
+  Log("Computing dM/dV contractions for %i vertices of surface %s...",NV,S->Label);
+
+  /*--------------------------------------------------------------*/
+  /*- loop over vertices -----------------------------------------*/
+  /*--------------------------------------------------------------*/
+  for(int nv=0; nv<NV; nv++)
+   {
+     if (LogLevel>=SCUFF_VERBOSELOGGING)
+      LogPercent(nv, NV);
+
+     int NumSPanels = VPStart[nv+1] - VPStart[nv];
+     if (NumSPanels==0) continue;
+     int *SPanels = VPList + VPStart[nv];
+
+     int NumSEdges=GetStencilEdges(S, NumSPanels, SPanels, SEdges,
+                                   EdgeMark, nv+1);
+     int NumRows = BFsPerEdge*NumSEdges;
+     if (NumRows==0) continue;
+
+     for(int n=0; n<NumSEdges; n++)
+      for(int k=0; k<BFsPerEdge; k++)
+       Rows[BFsPerEdge*n+k] = BFIndexOffset[ns] + BFsPerEdge*SEdges[n] + k;
+
+     FIPPICache *FC=new FIPPICache();
+     GetStencilRowDerivatives(this, ns, nv, NumSEdges, SEdges, Omega,
+                              (void *)FC, B, GradB);
+     delete FC;
+
+     for(int Mu=0; Mu<3; Mu++)
+      {
+        HMatrix *D=GradB[Mu];
+        cdouble Sum=0.0;
+        for(int nr=0; nr<NumRows; nr++)
+         { cdouble DX=0.0, DL=0.0;
+           for(int nc=0; nc<TotalBFs; nc++)
+            { cdouble Dij=D->GetEntry(nr, nc);
+              DX += Dij*KN->GetEntry(nc);
+              DL += Dij*Lambda->GetEntry(nc);
+            };
+           Sum += Lambda->GetEntry(Rows[nr])*DX + KN->GetEntry(Rows[nr])*DL;
+           for(int nrp=0; nrp<NumRows; nrp++)
+            Sum -= Lambda->GetEntry(Rows[nr])
+                   *D->GetEntry(nr, Rows[nrp])
+                   *KN->GetEntry(Rows[nrp]);
+         };
+        LDMDVKN->SetEntry(nv, Mu, Sum);
+      };
+   };
 
-  return DMDV;
+  delete B;
+  for(int Mu=0; Mu<3; Mu++)
+   delete GradB[Mu];
+  free(Rows);
+  free(SEdges);
+  free(EdgeMark);
+  free(VPStart);
+  free(VPList);
 
-} 
+  return LDMDVKN;
+}
 
 } // namespace scuff
@@ -44,131 +44,91 @@
 namespace scuff {
 
 /***************************************************************/
-/* data structure used to pass parameters to                   */
-/* InnerProductIntegrand routine.                              */
+/* Compute 'moments' of the incident fields over panel #np of  */
+/* surface S:                                                  */
+/*                                                             */
+/*  PM[0..2] = \int_P E(x) dA                                  */
+/*  PM[3]    = \int_P (x-XC) \cdot E(x) dA                     */
+/*                                                             */
+/* where XC is the panel centroid, and similarly PM[4..7] for  */
+/* the H field (only if NeedH is true). E and H are the sum of */
+/* the fields of all IncFields in PositiveIFs minus the sum of */
+/* the fields of all IncFields in NegativeIFs.                 */
+/*                                                             */
+/* The inner product of the incident fields with the           */
+/* half-RWG function associated with panel vertex Q is then    */
+/*                                                             */
+/*  (L/2A) * ( PM[3] + (XC-Q) \cdot PM[0..2] )                 */
+/*                                                             */
+/* so a single set of field samples on each panel suffices for */
+/* all three of the panel's edges. (Taking the moment about    */
+/* the centroid rather than the origin avoids cancellation     */
+/* errors for panels far from the origin.)                     */
+/*                                                             */
+/* Workspace must have room for 27*NumPts doubles, where       */
+/* NumPts is the number of points in the cubature rule.        */
 /***************************************************************/
-typedef struct InnerProductIntegrandData 
- { 
-   double *Q;
-   double PreFac;
-
-   IncField **PositiveIFs;
-   int NPositiveIFs;
-   IncField **NegativeIFs;
-   int NNegativeIFs;
+#define RHS_TCRORDER 20
+static void GetPanelMoments(RWGSurface *S, int np,
+                            IncField **PositiveIFs, int NPositiveIFs,
+                            IncField **NegativeIFs, int NNegativeIFs,
+                            bool NeedH, double *Workspace, cdouble PM[8])
+{ 
+  int NumPts;
+  double *TCR = GetTCR(RHS_TCRORDER, &NumPts);
 
-   int NeedHProd;
+  RWGPanel *P = S->Panels[np];
+  double *V0  = S->Vertices + 3*(P->VI[0]);
+  double *V1  = S->Vertices + 3*(P->VI[1]);
+  double *V2  = S->Vertices + 3*(P->VI[2]);
+  double *XC  = P->Centroid;
+  double JFac = 2.0*P->Area; // jacobian of map from standard triangle
 
- } InnerProductIntegrandData;
+  /*--------------------------------------------------------------*/
+  /*- get cubature points ----------------------------------------*/
+  /*--------------------------------------------------------------*/
+  double *X    = Workspace;
+  cdouble *EH  = (cdouble *)(Workspace + 3*NumPts);
+  cdouble *dEH = EH + 6*NumPts;
+  for(int ncp=0; ncp<NumPts; ncp++)
+   { double u=TCR[3*ncp+0], v=TCR[3*ncp+1];
+     for(int Mu=0; Mu<3; Mu++)
+      X[3*ncp+Mu] = V0[Mu] + u*(V1[Mu]-V0[Mu]) + v*(V2[Mu]-V0[Mu]);
+   };
 
-/***************************************************************/
-/* integrand routine passed to TriInt. this returns the dot    */
-/* product of the RWG basis function at point X with the       */
-/* electric field at point X, and optionally the dot product   */
-/* with the magnetic field as well.                            */
-/***************************************************************/
-static void InnerProductIntegrand(double *X, void *opIPID, double *F)
-{ 
-  InnerProductIntegrandData *IPID=(InnerProductIntegrandData *)opIPID;
-
-  /* get value of RWG basis function at X */
-  double fRWG[3];
-  VecSub(X,IPID->Q,fRWG);
-  VecScale(fRWG,IPID->PreFac);
-
-  /* get incident E and H fields at X */
-  cdouble dEH[6], EH[6];
-  memset(EH, 0, 6*sizeof(cdouble));
-  int n, nif;
-  for(nif=0; nif<IPID->NPositiveIFs; nif++)
-   { IPID->PositiveIFs[nif]->GetFields(X,dEH);
-     for(n=0; n<6; n++) 
+  /*--------------------------------------------------------------*/
+  /*- sample all contributing incident fields at all points ------*/
+  /*--------------------------------------------------------------*/
+  memset(EH, 0, 6*NumPts*sizeof(cdouble));
+  for(int nif=0; nif<NPositiveIFs; nif++)
+   { PositiveIFs[nif]->GetFieldsBatch(NumPts, X, dEH);
+     for(int n=0; n<6*NumPts; n++)
       EH[n]+=dEH[n];
    };
-  for(nif=0; nif<IPID->NNegativeIFs; nif++)
-   { IPID->NegativeIFs[nif]->GetFields(X,dEH);
-     for(n=0; n<6; n++) 
+  for(int nif=0; nif<NNegativeIFs; nif++)
+   { NegativeIFs[nif]->GetFieldsBatch(NumPts, X, dEH);
+     for(int n=0; n<6*NumPts; n++)
       EH[n]-=dEH[n];
    };
-  
-  /* compute dot products */
-  cdouble *zF = (cdouble *)F;
-  zF[0] = fRWG[0]*EH[0] + fRWG[1]*EH[1] + fRWG[2]*EH[2];
-  if (IPID->NeedHProd)
-   zF[1] = fRWG[0]*EH[3] + fRWG[1]*EH[4] + fRWG[2]*EH[5];
-  
-} 
 
-/***************************************************************/
-/* Calculate the inner product of given electric and magnetic  */
-/* fields with the basis function associated with edge #ne on  */
-/* the given RWGSurface.                                       */
-/*                                                             */
-/* PositiveIFs[0..NPositiveIFs] are IncFields whose fields     */
-/* contribute with a positive sign.                            */
-/*                                                             */
-/* NegativeIFs[0..NNegativeIFs] are IncFields whose fields     */
-/* contribute with a negative sign.                            */
-/*                                                             */
-/* If pHProd==0, we skip the computation of the magnetic-field */
-/* inner product.                                              */
-/***************************************************************/
-void GetInnerProducts(RWGSurface *S, int ne, 
-                      IncField **PositiveIFs, int NPositiveIFs,
-                      IncField **NegativeIFs, int NNegativeIFs,
-                      cdouble *pEProd, cdouble *pHProd)
-{ 
-  /* get edge vertices */
-  RWGEdge *E   = S->Edges[ne];
-  double *QP   = S->Vertices + 3*(E->iQP);
-  double *V1   = S->Vertices + 3*(E->iV1);
-  double *V2   = S->Vertices + 3*(E->iV2);
-  double PArea = S->Panels[E->iPPanel]->Area;
-  double *QM;
-  double MArea=0.0;
-  if ( E->iQM == -1 )
-   QM = 0;
-  else
-   { QM = S->Vertices + 3*(E->iQM);
-     MArea = S->Panels[E->iMPanel]->Area;
-   };
-
-  /* set up data structure passed to InnerProductIntegrand */
-  InnerProductIntegrandData MyIPID, *IPID=&MyIPID;
-  IPID->PositiveIFs  = PositiveIFs;
-  IPID->NPositiveIFs = NPositiveIFs;
-  IPID->NegativeIFs  = NegativeIFs;
-  IPID->NNegativeIFs = NNegativeIFs;
-  IPID->NeedHProd    = (pHProd==NULL ? 0 : 1);
-  
-  int nFun = (pHProd==NULL ? 2 : 4);
-  double I[4], IP[4], IM[4];
-
-  /* integrate over positive panel */
-  IPID->Q=QP;
-  IPID->PreFac=E->Length / (2.0*PArea);
-  TriIntFixed(InnerProductIntegrand, nFun, (void *)IPID, QP, V1, V2, 20, IP);
-
-  /* integrate over negative panel if present */
-  if (QM)
-   { IPID->Q=QM;
-     IPID->PreFac=E->Length / (2.0*MArea);
-     TriIntFixed(InnerProductIntegrand, nFun, (void *)IPID, V1, V2, QM, 20, IM);
-   }
-  else
+  /*--------------------------------------------------------------*/
+  /*- accumulate moments -----------------------------------------*/
+  /*--------------------------------------------------------------*/
+  memset(PM, 0, 8*sizeof(cdouble));
+  int NumFields = NeedH ? 2 : 1;
+  for(int ncp=0; ncp<NumPts; ncp++)
    { 
-     memset(IM, 0, 4*sizeof(double));
+     double w = JFac*TCR[3*ncp+2];
+     double XmXC[3];
+     VecSub(X + 3*ncp, XC, XmXC);
+     for(int nf=0; nf<NumFields; nf++)
+      { cdouble *F = EH + 6*ncp + 3*nf;
+        PM[4*nf+0] += w*F[0];
+        PM[4*nf+1] += w*F[1];
+        PM[4*nf+2] += w*F[2];
+        PM[4*nf+3] += w*(XmXC[0]*F[0] + XmXC[1]*F[1] + XmXC[2]*F[2]);
+      };
    };
-
-  /* total integral is difference between pos and neg pan integrals */
-  for(int nf=0; nf<nFun; nf++)
-   I[nf] = IP[nf] - IM[nf];
-  
-  /* return values */
-  *pEProd = cdouble(I[0], I[1]);
-  if (pHProd)
-   *pHProd = cdouble(I[2], I[3]);
-
 }
 
 /***************************************************************/
@@ -181,12 +141,14 @@ typedef struct ThreadData
    RWGGeometry *G;
    IncField *IF;
    int NIF;
-   HVector *RHS;
+   cdouble **PanelMoments;
 
  } ThreadData;
 
 /***************************************************************/
-/* AssembleRHS_Thread        ***********************************/
+/* AssembleRHS_Thread: compute panel moments of the incident   */
+/* fields (see GetPanelMoments above) for all panels on all    */
+/* surfaces that receive contributions from incident fields.   */
 /***************************************************************/
 void *AssembleRHS_Thread(void *data)
 { 
@@ -199,10 +161,10 @@ void *AssembleRHS_Thread(void *data)
   /***************************************************************/
   /* extract fields from thread data structure *******************/
   /***************************************************************/
-  RWGGeometry *G   = TD->G;
-  IncField *IFList = TD->IF;
-  int NIF          = TD->NIF;
-  HVector *RHS     = TD->RHS;
+  RWGGeometry *G         = TD->G;
+  IncField *IFList       = TD->IF;
+  int NIF                = TD->NIF;
+  cdouble **PanelMoments = TD->PanelMoments;
 
   /***************************************************************/
   /***************************************************************/
@@ -212,19 +174,22 @@ void *AssembleRHS_Thread(void *data)
   int NPositiveIFs;
   int NNegativeIFs;
 
+  int NumPts;
+  GetTCR(RHS_TCRORDER, &NumPts);
+  double *Workspace = new double[27*NumPts];
+
   /***************************************************************/
   /* loop over all surfaces to get contributions to RHS vector   */
   /***************************************************************/
   RWGSurface *S;
-  int ne, Offset, IsPEC;
   int nt=0;
-  cdouble EProd, HProd;
   IncField *IF;
   for(int ns=0; ns<G->NumSurfaces; ns++)
    { 
+     if (PanelMoments[ns]==0)
+      continue;
+
      S=G->Surfaces[ns];
-     Offset=G->BFIndexOffset[ns];
-     IsPEC=S->IsPEC;
 
      /*--------------------------------------------------------------*/
      /*- Go through the chain of IncField structures to identify     */
@@ -244,37 +209,26 @@ void *AssembleRHS_Thread(void *data)
         else if (S->RegionIndices[1]==IF->RegionIndex)
          PositiveIFs[NPositiveIFs++] = IF;
       };
-     if ( NPositiveIFs==0 && NNegativeIFs==0 )
-      continue;
 
      /*--------------------------------------------------------------*/
-     /*- Loop over all basis functions (edges) on this object to get-*/
-     /*- each BF's contribution to the RHS.                         -*/
+     /*- Loop over all panels on this surface. ----------------------*/
      /*--------------------------------------------------------------*/
-     for(ne=0; ne<S->NumEdges; ne++)
+     for(int np=0; np<S->NumPanels; np++)
       { 
         nt++;
         if (nt==TD->NumTasks) nt=0;
         if (nt!=TD->nt) continue;
 
-        GetInnerProducts(S,ne, 
-                         PositiveIFs, NPositiveIFs,
-                         NegativeIFs, NNegativeIFs,
-                         &EProd, IsPEC ? 0 : &HProd );
+        GetPanelMoments(S, np,
+                        PositiveIFs, NPositiveIFs,
+                        NegativeIFs, NNegativeIFs,
+                        !(S->IsPEC), Workspace, PanelMoments[ns] + 8*np);
 
-        if ( IsPEC )
-         { 
-           RHS->SetEntry(Offset + ne, EProd / ZVAC);
-         }
-        else 
-         { RHS->SetEntry(Offset + 2*ne+0, EProd / ZVAC);
-           RHS->SetEntry(Offset + 2*ne+1, HProd);
-         };
+      }; // for np=...
 
-      }; // for ne=...
-
-   }; // for no=...
+   }; // for ns=...
 
+  delete[] Workspace;
   delete[] PositiveIFs;
   delete[] NegativeIFs;
 
@@ -284,6 +238,12 @@ void *AssembleRHS_Thread(void *data)
 
 /***************************************************************/
 /* Assemble the RHS vector.  ***********************************/
+/*                                                             */
+/* This is done in two stages: first we compute moments of the */
+/* incident fields over each panel (in parallel), then we      */
+/* combine the moments of the two panels of each edge to get   */
+/* the inner product of the incident fields with the RWG basis */
+/* function.                                                   */
 /***************************************************************/
 HVector *RWGGeometry::AssembleRHSVector(cdouble Omega, double *kBloch,
                                         IncField *IF, HVector *RHS)
@@ -296,11 +256,28 @@ HVector *RWGGeometry::AssembleRHSVector(cdouble Omega, double *kBloch,
   int nt, NumTasks, NumThreads = GetNumThreads();
   int NIF=UpdateIncFields(IF, Omega, kBloch);
 
+  /***************************************************************/
+  /* allocate storage for panel moments on those surfaces to     */
+  /* which at least one IncField contributes                     */
+  /***************************************************************/
+  cdouble **PanelMoments = (cdouble **)mallocEC(NumSurfaces*sizeof(cdouble *));
+  for(int ns=0; ns<NumSurfaces; ns++)
+   { 
+     RWGSurface *S=Surfaces[ns];
+     bool Contributes=false;
+     for(IncField *IFNode=IF; IFNode && !Contributes; IFNode=IFNode->Next)
+      if (    S->RegionIndices[0]==IFNode->RegionIndex
+           || S->RegionIndices[1]==IFNode->RegionIndex 
+         ) Contributes=true;
+     PanelMoments[ns] = Contributes ?
+      (cdouble *)mallocEC(8*S->NumPanels*sizeof(cdouble)) : 0;
+   };
+
   ThreadData ReferenceTD;
   ReferenceTD.G=this;
   ReferenceTD.IF=IF;
   ReferenceTD.NIF=NIF;
-  ReferenceTD.RHS=RHS;
+  ReferenceTD.PanelMoments=PanelMoments;
 
 #ifdef USE_PTHREAD
   ThreadData *TDs = new ThreadData[NumThreads], *TD;
@@ -341,6 +318,53 @@ HVector *RWGGeometry::AssembleRHSVector(cdouble Omega, double *kBloch,
    };
 #endif
 
+  /***************************************************************/
+  /* combine panel moments into basis-function inner products    */
+  /***************************************************************/
+  for(int ns=0; ns<NumSurfaces; ns++)
+   { 
+     if (PanelMoments[ns]==0) 
+      continue;
+
+     RWGSurface *S=Surfaces[ns];
+     int Offset=BFIndexOffset[ns];
+     int IsPEC=S->IsPEC;
+
+     for(int ne=0; ne<S->NumEdges; ne++)
+      { 
+        RWGEdge *E = S->Edges[ne];
+        cdouble EProd=0.0, HProd=0.0;
+        for(int Sign=1; Sign>=-1; Sign-=2)
+         { 
+           int iQ = (Sign==1) ? E->iQP     : E->iQM;
+           int np = (Sign==1) ? E->iPPanel : E->iMPanel;
+           if (iQ==-1) continue;
+
+           RWGPanel *P = S->Panels[np];
+           cdouble *PM = PanelMoments[ns] + 8*np;
+           double PreFac = Sign * E->Length / (2.0*P->Area);
+           double XCmQ[3];
+           VecSub(P->Centroid, S->Vertices + 3*iQ, XCmQ);
+
+           EProd += PreFac*( PM[3] + XCmQ[0]*PM[0] + XCmQ[1]*PM[1] + XCmQ[2]*PM[2] );
+           if (!IsPEC)
+            HProd += PreFac*( PM[7] + XCmQ[0]*PM[4] + XCmQ[1]*PM[5] + XCmQ[2]*PM[6] );
+         };
+
+        if ( IsPEC )
+         { 
+           RHS->SetEntry(Offset + ne, EProd / ZVAC);
+         }
+        else 
+         { RHS->SetEntry(Offset + 2*ne+0, EProd / ZVAC);
+           RHS->SetEntry(Offset + 2*ne+1, HProd);
+         };
+      };
+
+     free(PanelMoments[ns]);
+   };
+  free(PanelMoments);
+
   return RHS;
 }
 
@@ -0,0 +1,391 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * EdgeClusterTree.cc -- bounding-sphere hierarchy over the edges of a
+ *                    -- surface, used to enumerate near-interaction
+ *                    -- lists of edge pairs without visiting all pairs
+ *
+ * how it works:
+ *
+ *  (a) each edge (basis function) is enclosed by the sphere of
+ *      radius E->Radius about E->Centroid, which contains all four
+ *      vertices of the two panels of the edge. the tree is a binary
+ *      hierarchy of such spheres, built by splitting each node at
+ *      the median of the edge centroids along its longest axis.
+ *      each node also records the largest panel radius it contains.
+ *
+ *  (b) a panel pair is 'near' (and needs singular or desingularized
+ *      integration) if its centroid distance is less than
+ *      DESINGULARIZATION_RADIUS times the larger panel radius. for
+ *      two nodes with centers at distance D, radii RA, RB, and
+ *      largest panel radius RP, every panel pair is guaranteed far if
+ *
+ *       D - RA - RB > DESINGULARIZATION_RADIUS * RP,
+ *
+ *      so a simultaneous traversal of the trees for two surfaces
+ *      prunes whole blocks of far pairs at once and produces, for
+ *      each edge of the first surface, the sorted list of edges of
+ *      the second surface that may interact with it in the near
+ *      field (typically a few dozen).
+ *
+ *  (c) GetSurfaceSurfaceInteractions() computes these lists once per
+ *      matrix block and passes the Far flag for all other edge pairs
+ *      down to GetPanelPanelInteractions(), which then skips
+ *      AssessPanelPair() and goes straight to low-order cubature.
+ *      the results are identical to those of the unaccelerated code.
+ *
+ *  (d) the tree of each surface is built the first time it is
+ *      needed and kept in RWGSurface::ECTree, so repeated matrix
+ *      assemblies (frequency sweeps, row-selection calls) do not
+ *      rebuild it. the tree stores copies of the edge centroids and
+ *      radii, so RWGSurface::Transform(), UnTransform(), and
+ *      UpdateVertices() discard it. like the panel kd-tree, it is
+ *      created outside of any parallel region.
+ *
+ * agent         -- 10/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+
+#include "libscuff.h"
+#include "libscuffInternals.h"
+
+namespace scuff {
+
+#define ECT_MAXLEAF 8        // maximum number of edges in a leaf node
+#define ECT_SAFETY  1.0e-3   // relative safety margin in the far test
+
+typedef struct ECTNode
+ { double Center[3], Radius;
+   double MaxPanelRadius;
+   int Start, Count;  // edges EdgeList[Start ... Start+Count-1]
+   int Child[2];      // -1 for leaf nodes
+ } ECTNode;
+
+typedef struct EdgeClusterTree
+ { RWGSurface *S;
+   int NumEdges;
+   int *EdgeList;
+   ECTNode *Nodes;
+   int NumNodes;
+ } EdgeClusterTree;
+
+typedef struct ECTKey
+ { double Key;
+   int ne;
+ } ECTKey;
+
+static int CompareECTKeys(const void *p1, const void *p2)
+{
+  const ECTKey *K1=(const ECTKey *)p1;
+  const ECTKey *K2=(const ECTKey *)p2;
+  if (K1->Key < K2->Key) return -1;
+  if (K1->Key > K2->Key) return +1;
+  return K1->ne - K2->ne;
+}
+
+/***************************************************************/
+/* largest radius of the (one or two) panels of an edge        */
+/***************************************************************/
+static double GetEdgePanelRadius(RWGSurface *S, RWGEdge *E)
+{
+  double R=S->Panels[E->iPPanel]->Radius;
+  if (E->iMPanel>=0)
+   R=fmax(R, S->Panels[E->iMPanel]->Radius);
+  return R;
+}
+
+/***************************************************************/
+/* true if every panel pair drawn from the two spheres is      */
+/* farther apart than DESINGULARIZATION_RADIUS                 */
+/***************************************************************/
+static bool Separated(const double *CA, double RA, double RPA,
+                      const double *CB, double RB, double RPB)
+{
+  double Gap = VecDistance(CA, CB) - RA - RB;
+  return Gap > DESINGULARIZATION_RADIUS*(1.0+ECT_SAFETY)*fmax(RPA, RPB);
+}
+
+/***************************************************************/
+/* build the subtree for EdgeList[Start...Start+Count-1] and   */
+/* return the index of its root node                           */
+/***************************************************************/
+static int BuildNode(EdgeClusterTree *T, int Start, int Count, ECTKey *Keys)
+{
+  RWGSurface *S=T->S;
+  int nn=T->NumNodes++;
+  ECTNode *Node=T->Nodes + nn;
+  Node->Start=Start;
+  Node->Count=Count;
+  Node->Child[0]=Node->Child[1]=-1;
+
+  /*--------------------------------------------------------------*/
+  /*- bounding box of edge centroids, enclosing sphere -----------*/
+  /*--------------------------------------------------------------*/
+  int *EL=T->EdgeList + Start;
+  double XMin[3], XMax[3];
+  VecCopy(S->Edges[EL[0]]->Centroid, XMin);
+  VecCopy(S->Edges[EL[0]]->Centroid, XMax);
+  for(int n=1; n<Count; n++)
+   { double *X=S->Edges[EL[n]]->Centroid;
+     for(int i=0; i<3; i++)
+      { XMin[i]=fmin(XMin[i], X[i]);
+        XMax[i]=fmax(XMax[i], X[i]);
+      };
+   };
+  for(int i=0; i<3; i++)
+   Node->Center[i]=0.5*(XMin[i]+XMax[i]);
+
+  Node->Radius=Node->MaxPanelRadius=0.0;
+  for(int n=0; n<Count; n++)
+   { RWGEdge *E=S->Edges[EL[n]];
+     Node->Radius=fmax(Node->Radius, VecDistance(Node->Center, E->Centroid) + E->Radius);
+     Node->MaxPanelRadius=fmax(Node->MaxPanelRadius, GetEdgePanelRadius(S,E));
+   };
+
+  if (Count<=ECT_MAXLEAF)
+   return nn;
+
+  /*--------------------------------------------------------------*/
+  /*- split at the median along the longest axis -----------------*/
+  /*--------------------------------------------------------------*/
+  int Axis=0;
+  for(int i=1; i<3; i++)
+   if ( (XMax[i]-XMin[i]) > (XMax[Axis]-XMin[Axis]) )
+    Axis=i;
+
+  for(int n=0; n<Count; n++)
+   { Keys[n].Key=S->Edges[EL[n]]->Centroid[Axis];
+     Keys[n].ne=EL[n];
+   };
+  qsort(Keys, Count, sizeof(ECTKey), CompareECTKeys);
+  for(int n=0; n<Count; n++)
+   EL[n]=Keys[n].ne;
+
+  int Half=Count/2;
+  int Child0=BuildNode(T, Start, Half, Keys);
+  int Child1=BuildNode(T, Start+Half, Count-Half, Keys);
+
+  // T->Nodes is preallocated, so Node is still valid here
+  Node->Child[0]=Child0;
+  Node->Child[1]=Child1;
+  return nn;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+void *CreateEdgeClusterTree(RWGSurface *S)
+{
+  EdgeClusterTree *T=(EdgeClusterTree *)mallocEC(sizeof(EdgeClusterTree));
+  T->S=S;
+  T->NumEdges=S->NumEdges;
+  T->NumNodes=0;
+  if (S->NumEdges==0)
+   { T->EdgeList=0;
+     T->Nodes=0;
+     return (void *)T;
+   };
+
+  T->EdgeList=(int *)mallocEC(S->NumEdges*sizeof(int));
+  for(int ne=0; ne<S->NumEdges; ne++)
+   T->EdgeList[ne]=ne;
+
+  // a binary tree with nonempty leaves has fewer than 2N nodes
+  T->Nodes=(ECTNode *)mallocEC(2*S->NumEdges*sizeof(ECTNode));
+
+  ECTKey *Keys=(ECTKey *)mallocEC(S->NumEdges*sizeof(ECTKey));
+  BuildNode(T, 0, S->NumEdges, Keys);
+  free(Keys);
+
+  return (void *)T;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+void DestroyEdgeClusterTree(void *opECT)
+{
+  EdgeClusterTree *T=(EdgeClusterTree *)opECT;
+  if (!T) return;
+  if (T->EdgeList) free(T->EdgeList);
+  if (T->Nodes) free(T->Nodes);
+  free(T);
+}
+
+/***************************************************************/
+/* get the cached edge cluster tree of a surface, building it  */
+/* if necessary (or if edges were added since it was built).   */
+/***************************************************************/
+void *RWGSurface::GetEdgeClusterTree()
+{
+  EdgeClusterTree *T=(EdgeClusterTree *)ECTree;
+  if ( T && T->NumEdges!=NumEdges )
+   ClearEdgeClusterTree();
+  if (ECTree==0)
+   ECTree=CreateEdgeClusterTree(this);
+  return ECTree;
+}
+
+void RWGSurface::ClearEdgeClusterTree()
+{
+  DestroyEdgeClusterTree(ECTree);
+  ECTree=0;
+}
+
+static int CompareInts(const void *p1, const void *p2)
+{
+  return *((const int *)p1) - *((const int *)p2);
+}
+
+/***************************************************************/
+/* get near-interaction lists for the edges of two surfaces.   */
+/* on return, for each edge nea of the first surface,          */
+/*  (*pCols)[ (*pRowStart)[nea] ... (*pRowStart)[nea+1]-1 ]    */
+/* are the indices, in ascending order, of the edges of the    */
+/* second surface for which at least one of the (up to) four   */
+/* panel pairs may lie within DESINGULARIZATION_RADIUS. all    */
+/* other edge pairs are guaranteed to be far. the caller must  */
+/* free both arrays.                                           */
+/***************************************************************/
+void GetNearEdgeLists(void *opECTA, void *opECTB,
+                      int **pRowStart, int **pCols)
+{
+  EdgeClusterTree *TA=(EdgeClusterTree *)opECTA;
+  EdgeClusterTree *TB=(EdgeClusterTree *)opECTB;
+  RWGSurface *SA=TA->S, *SB=TB->S;
+
+  int *RowStart=(int *)mallocEC((SA->NumEdges+1)*sizeof(int));
+  memset(RowStart, 0, (SA->NumEdges+1)*sizeof(int));
+
+  /*--------------------------------------------------------------*/
+  /*- simultaneous traversal of the two trees ---------------------*/
+  /*--------------------------------------------------------------*/
+  int NumPairs=0, MaxPairs=0;
+  int *Pairs=0;
+  int StackSize=0, MaxStack=64;
+  int *Stack=(int *)mallocEC(2*MaxStack*sizeof(int));
+  if (TA->NumNodes>0 && TB->NumNodes>0)
+   { Stack[0]=Stack[1]=0;
+     StackSize=1;
+   };
+  while(StackSize>0)
+   {
+     StackSize--;
+     ECTNode *NA=TA->Nodes + Stack[2*StackSize+0];
+     ECTNode *NB=TB->Nodes + Stack[2*StackSize+1];
+
+     if ( Separated(NA->Center, NA->Radius, NA->MaxPanelRadius,
+                    NB->Center, NB->Radius, NB->MaxPanelRadius) )
+      continue;
+
+     bool ALeaf = (NA->Child[0]==-1), BLeaf = (NB->Child[0]==-1);
+     if (ALeaf && BLeaf)
+      { for(int na=0; na<NA->Count; na++)
+         { int nea=TA->EdgeList[NA->Start + na];
+           RWGEdge *EA=SA->Edges[nea];
+           double RPA=GetEdgePanelRadius(SA, EA);
+           for(int nb=0; nb<NB->Count; nb++)
+            { int neb=TB->EdgeList[NB->Start + nb];
+              RWGEdge *EB=SB->Edges[neb];
+              if ( Separated(EA->Centroid, EA->Radius, RPA,
+                             EB->Centroid, EB->Radius, GetEdgePanelRadius(SB,EB)) )
+               continue;
+              if (NumPairs==MaxPairs)
+               { MaxPairs = (MaxPairs==0) ? 1024 : 2*MaxPairs;
+                 Pairs=(int *)realloc(Pairs, 2*MaxPairs*sizeof(int));
+                 if (!Pairs) ErrExit("out of memory");
+               };
+              Pairs[2*NumPairs+0]=nea;
+              Pairs[2*NumPairs+1]=neb;
+              NumPairs++;
+              RowStart[nea+1]++;
+            };
+         };
+        continue;
+      };
+
+     if (StackSize+2 > MaxStack)
+      { MaxStack*=2;
+        Stack=(int *)realloc(Stack, 2*MaxStack*sizeof(int));
+        if (!Stack) ErrExit("out of memory");
+      };
+
+     // descend into the larger of the two nodes
+     int ia=NA-TA->Nodes, ib=NB-TB->Nodes;
+     if ( BLeaf || (!ALeaf && NA->Radius>=NB->Radius) )
+      for(int c=0; c<2; c++)
+       { Stack[2*StackSize+0]=NA->Child[c];
+         Stack[2*StackSize+1]=ib;
+         StackSize++;
+       }
+     else
+      for(int c=0; c<2; c++)
+       { Stack[2*StackSize+0]=ia;
+         Stack[2*StackSize+1]=NB->Child[c];
+         StackSize++;
+       };
+   };
+  free(Stack);
+
+  /*--------------------------------------------------------------*/
+  /*- sort the pairs into rows ------------------------------------*/
+  /*--------------------------------------------------------------*/
+  for(int nea=0; nea<SA->NumEdges; nea++)
+   RowStart[nea+1]+=RowStart[nea];
+
+  int *Cols=(int *)mallocEC((NumPairs+1)*sizeof(int));
+  int *Next=(int *)mallocEC((SA->NumEdges+1)*sizeof(int));
+  memcpy(Next, RowStart, SA->NumEdges*sizeof(int));
+  for(int n=0; n<NumPairs; n++)
+   Cols[ Next[Pairs[2*n]]++ ] = Pairs[2*n+1];
+  free(Next);
+  if (Pairs) free(Pairs);
+
+  for(int nea=0; nea<SA->NumEdges; nea++)
+   qsort(Cols + RowStart[nea], RowStart[nea+1]-RowStart[nea], sizeof(int), CompareInts);
+
+  *pRowStart=RowStart;
+  *pCols=Cols;
+}
+
+/***************************************************************/
+/* true if edge pair (nea, neb) appears in the near lists      */
+/***************************************************************/
+bool IsNearEdgePair(const int *RowStart, const int *Cols, int nea, int neb)
+{
+  int Lo=RowStart[nea], Hi=RowStart[nea+1];
+  while(Lo<Hi)
+   { int Mid=(Lo+Hi)/2;
+     if (Cols[Mid]==neb) return true;
+     if (Cols[Mid]<neb)
+      Lo=Mid+1;
+     else
+      Hi=Mid;
+   };
+  return false;
+}
+
+} // namespace scuff
@@ -145,6 +145,8 @@ void GetEdgeEdgeInteractions(GetEEIArgStruct *Args)
   GetPPIArgs->opFC                   = Args->opFC;
   GetPPIArgs->Displacement           = Args->Displacement;
   GetPPIArgs->GInterp                = Args->GInterp;
+  GetPPIArgs->Far                    = Args->Far;
+  GetPPIArgs->DVertex                = Args->DVertex;
 
   /*--------------------------------------------------------------*/
   /*- positive-positive, positive-negative, etc. -----------------*/
@@ -190,6 +192,25 @@ void GetEdgeEdgeInteractions(GetEEIArgStruct *Args)
      Args->GradGC[2*Mu+1] = CPreFac*( GradHPP[2*Mu+1] - GradHPM[2*Mu+1] - GradHMP[2*Mu+1] + GradHMM[2*Mu+1] );
    };
 
+  /*--------------------------------------------------------------*/
+  /*- for vertex derivatives, the edge lengths in the prefactors  */
+  /*- depend on the vertex too                                    */
+  /*--------------------------------------------------------------*/
+  if (Args->DVertex && NumGradientComponents>0)
+   { double dGPreFac[3]={0.0, 0.0, 0.0};
+     double *DV=Args->DVertex;
+     double *Va1=Sa->Vertices + 3*Ea->iV1, *Va2=Sa->Vertices + 3*Ea->iV2;
+     double *Vb1=Sb->Vertices + 3*Eb->iV1, *Vb2=Sb->Vertices + 3*Eb->iV2;
+     for(Mu=0; Mu<3; Mu++)
+      { if (DV==Va1) dGPreFac[Mu] += Eb->Length*(Va1[Mu]-Va2[Mu])/Ea->Length;
+        if (DV==Va2) dGPreFac[Mu] += Eb->Length*(Va2[Mu]-Va1[Mu])/Ea->Length;
+        if (DV==Vb1) dGPreFac[Mu] += Ea->Length*(Vb1[Mu]-Vb2[Mu])/Eb->Length;
+        if (DV==Vb2) dGPreFac[Mu] += Ea->Length*(Vb2[Mu]-Vb1[Mu])/Eb->Length;
+        Args->GradGC[2*Mu+0] += dGPreFac[Mu]*(HPP[0] - HPM[0] - HMP[0] + HMM[0]);
+        Args->GradGC[2*Mu+1] += dGPreFac[Mu]*(HPP[1] - HPM[1] - HMP[1] + HMM[1]) / (II*k);
+      };
+   };
+
   for(Mu=0; Mu<NumTorqueAxes; Mu++)
    { Args->dGCdT[2*Mu+0] = GPreFac*( dHdTPP[2*Mu+0] - dHdTPM[2*Mu+0] - dHdTMP[2*Mu+0] + dHdTMM[2*Mu+0]);
      Args->dGCdT[2*Mu+1] = CPreFac*( dHdTPP[2*Mu+1] - dHdTPM[2*Mu+1] - dHdTMP[2*Mu+1] + dHdTMM[2*Mu+1]);
@@ -285,6 +306,8 @@ void InitGetEEIArgs(GetEEIArgStruct *Args)
   Args->opFC=0;
   Args->Force=EEI_NOFORCE;
   Args->GInterp=0;
+  Args->Far=false;
+  Args->DVertex=0;
   memset(Args->PPIAlgorithmCount, 0, NUMPPIALGORITHMS*sizeof(unsigned));
 }
 
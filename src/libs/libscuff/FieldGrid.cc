@@ -28,8 +28,16 @@
 #include "libscuff.h"
 #include "cmatheval.h"
 
+#include <stdio.h>
 #include <string.h>
 
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+#ifdef HAVE_HDF5
+#  include <hdf5.h>
+#endif
+
 static const double MU0 = 4e-7 * 3.14159265358979323846; // magnetic constant
 static const double C0 = 299792458.0;                  // vacuum speed of light
 static const double EPS0 = 1.0 / (C0*C0*MU0);        // electric constant
@@ -240,8 +248,9 @@ HMatrix **RWGGeometry::GetFieldsGrids(SurfaceGrid &grid,
 /***************************************************************************/
 // Convenience wrappers of GetFieldsGrids with simpler arguments.
 
-HMatrix **RWGGeometry::GetFieldsGrids(SurfaceGrid &grid, const char *exprs_,
-                                      cdouble Omega, HVector *KN, IncField *inc) {
+// parse a string of comma-separated expressions into an array
+// of (new'ed) ParsedFieldFuncs; the array itself is malloc'ed
+static FieldFunc **ParseFieldFuncs(const char *exprs_, int *nfuncs) {
   FieldFunc **f;
   int nf = 1;
 
@@ -262,6 +271,15 @@ HMatrix **RWGGeometry::GetFieldsGrids(SurfaceGrid &grid, const char *exprs_,
   }
   free(exprs);
 
+  *nfuncs = nf;
+  return f;
+}
+
+HMatrix **RWGGeometry::GetFieldsGrids(SurfaceGrid &grid, const char *exprs_,
+                                      cdouble Omega, HVector *KN, IncField *inc) {
+  int nf;
+  FieldFunc **f = ParseFieldFuncs(exprs_, &nf);
+
   if (LogLevel >= SCUFF_VERBOSELOGGING)
     Log(" GetFieldsGrids %dx%d of: %s ...", grid.N1,grid.N2, exprs_);
 
@@ -290,6 +308,413 @@ HMatrix *RWGGeometry::GetFieldsGrid(SurfaceGrid &grid, const char *expr,
   return GetFieldsGrid(grid, f, Omega, KN, inc);
 }
 
+/***************************************************************************/
+/***************************************************************************/
+/***************************************************************************/
+/* Streaming variant of GetFieldsGrids.  The grid is processed in tiles
+   of TileRows consecutive rows (n1 values); each tile is evaluated with
+   the threaded GetFields(XMatrix) routine and written to disk as soon
+   as it is done, so memory usage is independent of the grid size.
+
+   If FileName ends in .h5 or .hdf5, the output is an HDF5 file with one
+   N1 x N2 dataset per function (named Fn for real-valued functions and
+   FnReal, FnImag for complex-valued functions, n=0,1,...) plus an
+   integer dataset TileStatus recording which tiles have been written;
+   tiles are written as hyperslabs of the datasets.
+
+   Otherwise the output is a binary file consisting of a header
+   (see GFGHeader below) followed by the grid values in row-major
+   order, with the nfuncs function values stored consecutively for
+   each grid point (one double for real-valued functions, two for
+   complex-valued functions).
+
+   If Resume is true and FileName exists and matches the grid and
+   functions, tiles that were already written are skipped. In binary
+   files, a tile that was only partly written before an interruption
+   is recomputed and overwritten in place; a binary file that is
+   longer than the grid requires is rewritten from scratch.
+
+   Returns the number of tiles that were computed. */
+
+#define GFG_MAGIC "SCUFFGFG"
+
+typedef struct GFGHeader {
+  char Magic[8];
+  int N1, N2, NumFuncs, TileRows;
+} GFGHeader;
+
+class GridFileWriter {
+public:
+  int N1, N2, NumFuncs, NumColumns, TileRows, NumTiles;
+  bool *IsReal;
+  bool *TileDone;
+  bool HDF5;
+
+  FILE *f;
+  long DataOffset, RowBytes;
+#ifdef HAVE_HDF5
+  hid_t FileID, *DataSets, StatusSet;
+#endif
+
+  GridFileWriter(const char *FileName, int N1, int N2, int NumFuncs,
+                 bool *IsReal, int TileRows, bool Resume);
+  ~GridFileWriter();
+
+  void WriteTile(int nt, double **Columns);
+};
+
+GridFileWriter::GridFileWriter(const char *FileName, int n1, int n2,
+                               int nfuncs, bool *isReal, int tileRows,
+                               bool Resume) {
+  N1 = n1; N2 = n2; NumFuncs = nfuncs; TileRows = tileRows;
+  NumTiles = (N1 + TileRows - 1) / TileRows;
+  IsReal = isReal;
+  NumColumns = 0;
+  for (int i = 0; i < NumFuncs; ++i)
+    NumColumns += IsReal[i] ? 1 : 2;
+  TileDone = (bool *) mallocEC(NumTiles * sizeof(bool));
+  f = 0;
+
+  const char *Ext = strrchr(FileName, '.');
+  HDF5 = Ext && (!StrCaseCmp(Ext, ".h5") || !StrCaseCmp(Ext, ".hdf5"));
+
+  if (HDF5) {
+#ifndef HAVE_HDF5
+    ErrExit("%s: SCUFF-EM was compiled without HDF5 support", FileName);
+#else
+    DataSets = (hid_t *) mallocEC(NumColumns * sizeof(hid_t));
+
+    char **Names = (char **) mallocEC(NumColumns * sizeof(char *));
+    for (int i = 0, nc = 0; i < NumFuncs; ++i) {
+      if (IsReal[i])
+        Names[nc++] = vstrdup("F%i", i);
+      else {
+        Names[nc++] = vstrdup("F%iReal", i);
+        Names[nc++] = vstrdup("F%iImag", i);
+      }
+    }
+
+    // on resume, try to reopen the existing datasets; if anything is
+    // missing or has the wrong size, start over
+    bool Reopened = false;
+    FileID = -1;
+    if (Resume) {
+      H5E_BEGIN_TRY {
+        FileID = H5Fopen(FileName, H5F_ACC_RDWR, H5P_DEFAULT);
+        if (FileID >= 0) {
+          Reopened = true;
+          hsize_t Dims[2];
+          for (int nc = 0; nc < NumColumns; ++nc) {
+            DataSets[nc] = H5Dopen2(FileID, Names[nc], H5P_DEFAULT);
+            hid_t Space = DataSets[nc]>=0 ? H5Dget_space(DataSets[nc]) : -1;
+            if (    Space < 0
+                 || H5Sget_simple_extent_ndims(Space) != 2
+                 || H5Sget_simple_extent_dims(Space, Dims, 0) < 0
+                 || Dims[0] != (hsize_t)N1 || Dims[1] != (hsize_t)N2 )
+              Reopened = false;
+            if (Space >= 0) H5Sclose(Space);
+          }
+          int *Status = (int *) mallocEC(NumTiles * sizeof(int));
+          StatusSet = H5Dopen2(FileID, "TileStatus", H5P_DEFAULT);
+          hid_t Space = StatusSet>=0 ? H5Dget_space(StatusSet) : -1;
+          if (    Space < 0
+               || H5Sget_simple_extent_npoints(Space) != NumTiles
+               || H5Dread(StatusSet, H5T_NATIVE_INT, H5S_ALL, H5S_ALL,
+                          H5P_DEFAULT, Status) < 0 )
+            Reopened = false;
+          if (Space >= 0) H5Sclose(Space);
+          for (int nt = 0; nt < NumTiles; ++nt)
+            TileDone[nt] = Reopened && Status[nt];
+          free(Status);
+          if (!Reopened) {
+            for (int nc = 0; nc < NumColumns; ++nc)
+              if (DataSets[nc] >= 0) H5Dclose(DataSets[nc]);
+            if (StatusSet >= 0) H5Dclose(StatusSet);
+            H5Fclose(FileID);
+            Log("%s: existing file does not match grid; starting over", FileName);
+          }
+        }
+      } H5E_END_TRY;
+    }
+
+    if (!Reopened) {
+      FileID = H5Fcreate(FileName, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+      if (FileID < 0)
+        ErrExit("could not create HDF5 file %s", FileName);
+      hsize_t Dims[2] = { (hsize_t)N1, (hsize_t)N2 };
+      hid_t Space = H5Screate_simple(2, Dims, 0);
+      for (int nc = 0; nc < NumColumns; ++nc)
+        DataSets[nc] = H5Dcreate2(FileID, Names[nc], H5T_NATIVE_DOUBLE, Space,
+                                  H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+      H5Sclose(Space);
+
+      hsize_t NT = NumTiles;
+      int *Status = (int *) mallocEC(NumTiles * sizeof(int));
+      memset(Status, 0, NumTiles * sizeof(int));
+      Space = H5Screate_simple(1, &NT, 0);
+      StatusSet = H5Dcreate2(FileID, "TileStatus", H5T_NATIVE_INT, Space,
+                             H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+      H5Dwrite(StatusSet, H5T_NATIVE_INT, H5S_ALL, H5S_ALL, H5P_DEFAULT, Status);
+      H5Sclose(Space);
+      free(Status);
+      memset(TileDone, 0, NumTiles * sizeof(bool));
+    }
+
+    for (int nc = 0; nc < NumColumns; ++nc)
+      free(Names[nc]);
+    free(Names);
+#endif
+    return;
+  }
+
+  /*--------------------------------------------------------------*/
+  /*- binary output: since tiles are written in order, resuming    */
+  /*- amounts to counting the complete tiles already in the file   */
+  /*--------------------------------------------------------------*/
+  GFGHeader Header;
+  memset(&Header, 0, sizeof(Header));
+  memcpy(Header.Magic, GFG_MAGIC, 8);
+  Header.N1 = N1; Header.N2 = N2;
+  Header.NumFuncs = NumFuncs; Header.TileRows = TileRows;
+  DataOffset = sizeof(Header) + NumFuncs*sizeof(int);
+  RowBytes = (long)N2 * NumColumns * sizeof(double);
+
+  int NumDone = 0;
+  if (Resume && (f = fopen(FileName, "r+b"))) {
+    GFGHeader OldHeader;
+    int *OldIsReal = (int *) mallocEC(NumFuncs*sizeof(int) + 1);
+    bool Match = (    fread(&OldHeader, sizeof(OldHeader), 1, f) == 1
+                   && !memcmp(&OldHeader, &Header, sizeof(Header))
+                   && fread(OldIsReal, sizeof(int), NumFuncs, f) == (size_t)NumFuncs );
+    for (int i = 0; Match && i < NumFuncs; ++i)
+      Match = (OldIsReal[i] == (IsReal[i] ? 1 : 0));
+    free(OldIsReal);
+    long DataBytes = 0;
+    if (Match) {
+      fseek(f, 0, SEEK_END);
+      DataBytes = ftell(f) - DataOffset;
+      Match = (DataBytes <= N1 * RowBytes);
+    }
+    if (Match) {
+      // a tile counts as done only if all of its rows (including the
+      // possibly shorter last tile) are in the file; a partly written
+      // tile is recomputed and overwritten in place
+      long Rows = DataBytes / RowBytes;
+      while (    NumDone < NumTiles
+              && (NumDone+1 == NumTiles ? N1 : (NumDone+1)*TileRows) <= Rows )
+        NumDone++;
+    } else {
+      Log("%s: existing file does not match grid; starting over", FileName);
+      fclose(f);
+      f = 0;
+    }
+  }
+
+  if (!f) {
+    if (!(f = fopen(FileName, "w+b")))
+      ErrExit("could not open file %s", FileName);
+    fwrite(&Header, sizeof(Header), 1, f);
+    for (int i = 0; i < NumFuncs; ++i) {
+      int ir = IsReal[i] ? 1 : 0;
+      fwrite(&ir, sizeof(int), 1, f);
+    }
+  }
+
+  for (int nt = 0; nt < NumTiles; ++nt)
+    TileDone[nt] = (nt < NumDone);
+  fseek(f, DataOffset + NumDone * TileRows * RowBytes, SEEK_SET);
+}
+
+GridFileWriter::~GridFileWriter() {
+#ifdef HAVE_HDF5
+  if (HDF5) {
+    for (int nc = 0; nc < NumColumns; ++nc)
+      H5Dclose(DataSets[nc]);
+    H5Dclose(StatusSet);
+    H5Fclose(FileID);
+    free(DataSets);
+  }
+#endif
+  if (f) fclose(f);
+  free(TileDone);
+}
+
+// Columns[nc] is an array of NumRows*N2 doubles giving the values of
+// output column nc for the grid points in tile nt in row-major order
+void GridFileWriter::WriteTile(int nt, double **Columns) {
+  int Row0 = nt * TileRows;
+  int NumRows = (Row0 + TileRows > N1) ? N1 - Row0 : TileRows;
+  int NP = NumRows * N2;
+
+  if (HDF5) {
+#ifdef HAVE_HDF5
+    hsize_t Start[2] = { (hsize_t)Row0, 0 };
+    hsize_t Count[2] = { (hsize_t)NumRows, (hsize_t)N2 };
+    hid_t MemSpace = H5Screate_simple(2, Count, 0);
+    for (int nc = 0; nc < NumColumns; ++nc) {
+      hid_t FileSpace = H5Dget_space(DataSets[nc]);
+      H5Sselect_hyperslab(FileSpace, H5S_SELECT_SET, Start, 0, Count, 0);
+      if (H5Dwrite(DataSets[nc], H5T_NATIVE_DOUBLE, MemSpace, FileSpace,
+                   H5P_DEFAULT, Columns[nc]) < 0)
+        ErrExit("error writing tile %i to HDF5 file", nt);
+      H5Sclose(FileSpace);
+    }
+    H5Sclose(MemSpace);
+
+    // mark the tile as done only after its data are written
+    hsize_t TStart = nt, TCount = 1;
+    int One = 1;
+    MemSpace = H5Screate_simple(1, &TCount, 0);
+    hid_t FileSpace = H5Dget_space(StatusSet);
+    H5Sselect_hyperslab(FileSpace, H5S_SELECT_SET, &TStart, 0, &TCount, 0);
+    H5Dwrite(StatusSet, H5T_NATIVE_INT, MemSpace, FileSpace, H5P_DEFAULT, &One);
+    H5Sclose(FileSpace);
+    H5Sclose(MemSpace);
+    H5Fflush(FileID, H5F_SCOPE_GLOBAL);
+#endif
+  } else {
+    // position explicitly at the start of the tile, so that a tile
+    // that was partly written before an interruption is overwritten
+    // in place rather than appended
+    long Offset = DataOffset + (long)Row0 * RowBytes;
+    if ( fseek(f, Offset, SEEK_SET) || ftell(f) != Offset )
+      ErrExit("could not seek to tile %i in output file", nt);
+    double *Buffer = (double *) mallocEC(NumColumns * sizeof(double));
+    for (int np = 0; np < NP; ++np) {
+      for (int nc = 0; nc < NumColumns; ++nc)
+        Buffer[nc] = Columns[nc][np];
+      if (fwrite(Buffer, sizeof(double), NumColumns, f) != (size_t)NumColumns)
+        ErrExit("error writing tile %i to output file", nt);
+    }
+    free(Buffer);
+    fflush(f);
+  }
+
+  TileDone[nt] = true;
+}
+
+int RWGGeometry::GetFieldsGridsToFile(SurfaceGrid &grid,
+                                      int nfuncs, FieldFunc **funcs,
+                                      cdouble Omega, HVector *KN,
+                                      IncField *IF, const char *FileName,
+                                      int TileRows, bool Resume) {
+  if (nfuncs == 0 || grid.N1 == 0 || grid.N2 == 0) return 0;
+
+  // default to tiles of roughly 64k points
+  if (TileRows <= 0) {
+    TileRows = 65536 / grid.N2;
+    if (TileRows < 1) TileRows = 1;
+  }
+  if (TileRows > grid.N1) TileRows = grid.N1;
+
+  bool *IsReal = (bool *) mallocEC(nfuncs * sizeof(bool));
+  for (int i = 0; i < nfuncs; ++i)
+    IsReal[i] = funcs[i]->IsReal();
+
+  GridFileWriter W(FileName, grid.N1, grid.N2, nfuncs, IsReal, TileRows, Resume);
+
+  int NumSkipped = 0;
+  for (int nt = 0; nt < W.NumTiles; ++nt)
+    if (W.TileDone[nt]) NumSkipped++;
+  if (NumSkipped > 0)
+    Log("%s: resuming with %i/%i tiles already done", FileName,
+        NumSkipped, W.NumTiles);
+
+  UpdateCachedEpsMuValues(Omega);
+
+  // storage for one (full-size) tile
+  int MaxPoints = TileRows * grid.N2;
+  double *dAs = (double *) mallocEC(3 * MaxPoints * sizeof(double));
+  int *Regions = (int *) mallocEC(MaxPoints * sizeof(int));
+  double **Columns = (double **) mallocEC(W.NumColumns * sizeof(double *));
+  for (int nc = 0; nc < W.NumColumns; ++nc)
+    Columns[nc] = (double *) mallocEC(MaxPoints * sizeof(double));
+
+  int NumComputed = 0;
+  for (int nt = 0; nt < W.NumTiles; ++nt) {
+    if (W.TileDone[nt]) continue;
+
+    int Row0 = nt * TileRows;
+    int NumRows = (Row0 + TileRows > grid.N1) ? grid.N1 - Row0 : TileRows;
+    int NP = NumRows * grid.N2;
+
+    if (LogLevel >= SCUFF_VERBOSELOGGING)
+      Log(" tile %i/%i (rows %i--%i)...", nt+1, W.NumTiles, Row0, Row0+NumRows-1);
+
+    HMatrix *XMatrix = new HMatrix(NP, 3);
+    for (int n1 = 0, np = 0; n1 < NumRows; ++n1)
+      for (int n2 = 0; n2 < grid.N2; ++n2, ++np) {
+        double X[3];
+        grid.GetPoint(Row0 + n1, n2, X, dAs + 3*np);
+        XMatrix->SetEntry(np, 0, X[0]);
+        XMatrix->SetEntry(np, 1, X[1]);
+        XMatrix->SetEntry(np, 2, X[2]);
+      }
+
+    // total (scattered + incident) fields at all points of the tile;
+    // GetFields also hands back the region index of each point
+    HMatrix *FMatrix;
+    if (KN || IF)
+      FMatrix = GetFields(IF, KN, Omega, 0, XMatrix, 0, 0, Regions);
+    else {
+      FMatrix = new HMatrix(NP, 6, LHM_COMPLEX);
+      FMatrix->Zero();
+      GetRegionIndices(XMatrix, Regions);
+    }
+
+    for (int np = 0; np < NP; ++np) {
+      double X[3];
+      cdouble EH[6];
+      X[0] = XMatrix->GetEntryD(np, 0);
+      X[1] = XMatrix->GetEntryD(np, 1);
+      X[2] = XMatrix->GetEntryD(np, 2);
+      for (int i = 0; i < 6; ++i)
+        EH[i] = FMatrix->GetEntry(np, i);
+      int nr = Regions[np];
+      for (int i = 0, nc = 0; i < nfuncs; ++i) {
+        cdouble F = funcs[i]->Eval(X, dAs + 3*np, EH, EpsTF[nr], MuTF[nr]);
+        Columns[nc++][np] = real(F);
+        if (!IsReal[i])
+          Columns[nc++][np] = imag(F);
+      }
+    }
+
+    W.WriteTile(nt, Columns);
+    NumComputed++;
+
+    delete XMatrix;
+    delete FMatrix;
+  }
+
+  for (int nc = 0; nc < W.NumColumns; ++nc)
+    free(Columns[nc]);
+  free(Columns);
+  free(Regions);
+  free(dAs);
+  free(IsReal);
+
+  return NumComputed;
+}
+
+int RWGGeometry::GetFieldsGridsToFile(SurfaceGrid &grid, const char *exprs,
+                                      cdouble Omega, HVector *KN,
+                                      IncField *inc, const char *FileName,
+                                      int TileRows, bool Resume) {
+  int nf;
+  FieldFunc **f = ParseFieldFuncs(exprs, &nf);
+
+  if (LogLevel >= SCUFF_VERBOSELOGGING)
+    Log(" GetFieldsGridsToFile %dx%d of: %s ...", grid.N1,grid.N2, exprs);
+
+  int NumTiles = GetFieldsGridsToFile(grid, nf, f, Omega, KN, inc,
+                                      FileName, TileRows, Resume);
+
+  for (int i=0; i < nf; ++i) delete f[i];
+  free(f);
+
+  return NumTiles;
+}
+
 /***************************************************************************/
 /***************************************************************************/
 /***************************************************************************/
@@ -0,0 +1,618 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * FieldTreecode.cc -- treecode acceleration of scattered-field
+ *                  -- computations at large numbers of evaluation points
+ *
+ * how it works:
+ *
+ *  (a) for each region of the geometry, we build an octree over
+ *      the RWG basis functions living on the surfaces that bound
+ *      the region.
+ *
+ *  (b) for each node in the tree, we compute the outgoing spherical-
+ *      wave expansion (about the node center) of the fields radiated
+ *      into the region by the surface currents in the node. this is
+ *      done by projecting the RWG functions onto regular M- and
+ *      N-type spherical waves, exactly as in GetSphericalMoments.cc.
+ *
+ *  (c) to get the scattered fields at an evaluation point X, we
+ *      walk the tree from the root; for nodes that are well-separated
+ *      from X (|X-Center| > Radius / Theta) we sum the outgoing
+ *      expansion, while for leaf nodes that are too close we fall
+ *      back to the usual panel cubature (GetReducedPotentials).
+ *
+ * the spherical-wave expansion of the dyadic green's function we use
+ * here is
+ *
+ *  G(x,x') = ik \sum_{lm} [   M^{out}_{lm}(x) \tilde M_{lm}(x')
+ *                           - N^{out}_{lm}(x) \tilde N_{lm}(x') ]
+ *
+ * where \tilde M_{lm} = (-1)^{m+1} M^{reg}_{l,-m} (and similarly for N)
+ * is M^{reg}_{lm} with the angular part, but not the radial part,
+ * conjugated; this form remains valid for lossy (complex-k) media.
+ *
+ * agent         -- 10/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include <libSpherical.h>
+#include <libTriInt.h>
+
+#include "libscuff.h"
+#include "libscuffInternals.h"
+
+namespace scuff {
+
+#define II cdouble(0,1)
+
+#define FTC_MAXLEAF   32    // maximum number of basis functions in a leaf node
+#define FTC_MAXDEPTH  12    // maximum depth of octree
+#define FTC_MAXLMAX   30    // nodes requiring higher lMax get no expansion
+#define FTC_THETA     0.5   // admissibility parameter (Radius/Distance)
+#define FTC_TCRORDER  9     // cubature order for spherical-wave projections
+
+/***************************************************************/
+/* a single basis function contributing to the fields in a     */
+/* region; Sign is +1 (-1) if the region is the exterior       */
+/* (interior) region of the surface in question.               */
+/***************************************************************/
+typedef struct FTCSource
+ {
+   RWGSurface *S;
+   int ne;
+   double Sign;
+   cdouble KAlpha, NAlpha;
+   double *Centroid;
+
+ } FTCSource;
+
+/***************************************************************/
+/* a single node in the octree. nodes own a contiguous range   */
+/* [SourceStart, SourceStart+NumSources) of the Sources array  */
+/* of their tree.                                              */
+/*                                                             */
+/* if lMax>0, then Coefficients points to 4*(lMax+1)^2 cdoubles*/
+/* storing the expansion coefficients of the E and H fields    */
+/* in outgoing M and N spherical waves, in the order           */
+/*  EM[Alpha], EN[Alpha], HM[Alpha], HN[Alpha].                */
+/* if lMax==-1, the node is too large to admit an expansion of */
+/* reasonable order and we always descend into its children.  */
+/***************************************************************/
+typedef struct FTCNode
+ {
+   double Center[3];
+   double Radius;
+   int SourceStart, NumSources;
+   int Children[8], NumChildren;
+   int lMax;
+   cdouble *Coefficients;
+
+ } FTCNode;
+
+/***************************************************************/
+/* the octree for a single region                              */
+/***************************************************************/
+typedef struct FTCTree
+ {
+   FTCSource *Sources;
+   int NumSources;
+   FTCNode *Nodes;
+   int NumNodes, NumAllocated;
+   cdouble K, Eps, Mu;
+
+ } FTCTree;
+
+/***************************************************************/
+/* the full treecode structure, one tree per region            */
+/***************************************************************/
+typedef struct FieldTreecode
+ {
+   RWGGeometry *G;
+   cdouble Omega;
+   double Tolerance;
+   FTCTree *Trees;
+
+ } FieldTreecode;
+
+/***************************************************************/
+/* choose the expansion order for a node of the given radius.  */
+/* the first estimate is the usual excess-bandwidth formula    */
+/* for the helmholtz kernel; the second handles the quasistatic*/
+/* regime, where the truncation error goes like Theta^lMax.    */
+/***************************************************************/
+static int GetNodeLMax(cdouble K, double Radius, double Tolerance)
+{
+  double kR     = abs(K)*Radius;
+  double Digits = -log10(Tolerance);
+  if (Digits<1.0) Digits=1.0;
+
+  int lDynamic = (int)ceil( kR + 1.8*pow(Digits, 2.0/3.0)*pow(kR, 1.0/3.0) );
+  int lStatic  = (int)ceil( log(Tolerance) / log(FTC_THETA) );
+  int lMax = (lDynamic > lStatic) ? lDynamic : lStatic;
+  if (lMax<1)
+   lMax=1;
+
+  return (lMax > FTC_MAXLMAX) ? -1 : lMax;
+}
+
+/***************************************************************/
+/* add a new node to the tree, growing the node array as needed*/
+/***************************************************************/
+static int AddNode(FTCTree *Tree, int SourceStart, int NumSources)
+{
+  if (Tree->NumNodes == Tree->NumAllocated)
+   { Tree->NumAllocated = (Tree->NumAllocated==0) ? 64 : 2*Tree->NumAllocated;
+     Tree->Nodes=(FTCNode *)reallocEC(Tree->Nodes, Tree->NumAllocated*sizeof(FTCNode));
+   };
+
+  int nn = Tree->NumNodes++;
+  FTCNode *Node = Tree->Nodes + nn;
+  memset(Node, 0, sizeof(FTCNode));
+  Node->SourceStart = SourceStart;
+  Node->NumSources  = NumSources;
+  Node->lMax        = -1;
+  return nn;
+}
+
+/***************************************************************/
+/* recursively subdivide node #nn. (note that Tree->Nodes may  */
+/* be reallocated by the recursive calls, so we never hold     */
+/* pointers to nodes across them.)                             */
+/***************************************************************/
+static void SubdivideNode(FTCTree *Tree, int nn, int Depth, double Tolerance)
+{
+  FTCSource *Sources = Tree->Sources + Tree->Nodes[nn].SourceStart;
+  int NumSources     = Tree->Nodes[nn].NumSources;
+
+  /*--------------------------------------------------------------*/
+  /*- bounding box of the edge centroids, then the radius of the  */
+  /*- smallest sphere about the box center enclosing the supports */
+  /*- of all basis functions in the node                          */
+  /*--------------------------------------------------------------*/
+  double RMax[3]={-1.0e89, -1.0e89, -1.0e89};
+  double RMin[3]={+1.0e89, +1.0e89, +1.0e89};
+  for(int n=0; n<NumSources; n++)
+   for(int Mu=0; Mu<3; Mu++)
+    { RMax[Mu] = fmax(RMax[Mu], Sources[n].Centroid[Mu]);
+      RMin[Mu] = fmin(RMin[Mu], Sources[n].Centroid[Mu]);
+    };
+
+  double Center[3], Radius=0.0;
+  for(int Mu=0; Mu<3; Mu++)
+   Center[Mu] = 0.5*(RMax[Mu] + RMin[Mu]);
+  for(int n=0; n<NumSources; n++)
+   { RWGEdge *E = Sources[n].S->Edges[Sources[n].ne];
+     Radius = fmax(Radius, VecDistance(Center, E->Centroid) + E->Radius);
+   };
+
+  FTCNode *Node = Tree->Nodes + nn;
+  VecCopy(Center, Node->Center);
+  Node->Radius = Radius;
+  Node->lMax   = GetNodeLMax(Tree->K, Radius, Tolerance);
+
+  if ( NumSources<=FTC_MAXLEAF || Depth==FTC_MAXDEPTH )
+   return;
+
+  /*--------------------------------------------------------------*/
+  /*- sort sources into octants (counting sort) ------------------*/
+  /*--------------------------------------------------------------*/
+  int *Octant = new int[NumSources];
+  int Count[8]={0,0,0,0,0,0,0,0};
+  for(int n=0; n<NumSources; n++)
+   { double *X = Sources[n].Centroid;
+     Octant[n] =   (X[0]>Center[0] ? 1 : 0)
+                 + (X[1]>Center[1] ? 2 : 0)
+                 + (X[2]>Center[2] ? 4 : 0);
+     Count[Octant[n]]++;
+   };
+
+  // all centroids coincide (degenerate); leave as a leaf
+  for(int no=0; no<8; no++)
+   if (Count[no]==NumSources)
+    { delete[] Octant;
+      return;
+    };
+
+  int Start[8];
+  Start[0]=0;
+  for(int no=1; no<8; no++)
+   Start[no] = Start[no-1] + Count[no-1];
+
+  FTCSource *Sorted = new FTCSource[NumSources];
+  int Next[8];
+  memcpy(Next, Start, 8*sizeof(int));
+  for(int n=0; n<NumSources; n++)
+   Sorted[ Next[Octant[n]]++ ] = Sources[n];
+  memcpy(Sources, Sorted, NumSources*sizeof(FTCSource));
+  delete[] Sorted;
+  delete[] Octant;
+
+  /*--------------------------------------------------------------*/
+  /*- create and subdivide the children --------------------------*/
+  /*--------------------------------------------------------------*/
+  int SourceStart = Tree->Nodes[nn].SourceStart;
+  for(int no=0; no<8; no++)
+   {
+     if (Count[no]==0) continue;
+     int nc = AddNode(Tree, SourceStart + Start[no], Count[no]);
+     int NumChildren = Tree->Nodes[nn].NumChildren++;
+     Tree->Nodes[nn].Children[NumChildren] = nc;
+     SubdivideNode(Tree, nc, Depth+1, Tolerance);
+   };
+
+}
+
+/***************************************************************/
+/* add the projections of a single basis function (weighted by */
+/* its expansion coefficients) onto the regular spherical waves*/
+/* about X0 to the CKM, CKN, CNM, CNN accumulators.            */
+/***************************************************************/
+static void AddSourceProjections(FTCSource *Source, cdouble K, int lMax,
+                                 double *X0, cdouble *MArray, cdouble *NArray,
+                                 cdouble *CKM, cdouble *CKN,
+                                 cdouble *CNM, cdouble *CNN)
+{
+  RWGSurface *S = Source->S;
+  RWGEdge *E    = S->Edges[Source->ne];
+  double *QP    = S->Vertices + 3*(E->iQP);
+  double *V1    = S->Vertices + 3*(E->iV1);
+  double *V2    = S->Vertices + 3*(E->iV2);
+  double *QM    = (E->iQM == -1) ? 0 : S->Vertices + 3*(E->iQM);
+
+  cdouble KWeight = Source->Sign * E->Length * Source->KAlpha;
+  cdouble NWeight = Source->Sign * E->Length * Source->NAlpha;
+
+  int NumPts;
+  double *TCR = GetTCR(FTC_TCRORDER, &NumPts);
+
+  for(int nPanel=0; nPanel<2; nPanel++)
+   {
+     double *Q = (nPanel==0) ? QP : QM;
+     if (Q==0) continue;
+     double PanelSign = (nPanel==0) ? 1.0 : -1.0;
+
+     for(int np=0; np<NumPts; np++)
+      {
+        double u=TCR[3*np+0], v=TCR[3*np+1], w=TCR[3*np+2];
+
+        double XmQ[3], XmX0[3], FS[3];
+        for(int Mu=0; Mu<3; Mu++)
+         { XmQ[Mu]  = u*(V1[Mu]-Q[Mu]) + v*(V2[Mu]-Q[Mu]);
+           XmX0[Mu] = Q[Mu] + XmQ[Mu] - X0[Mu];
+         };
+
+        double r, Theta, Phi;
+        CoordinateC2S(XmX0, &r, &Theta, &Phi);
+        VectorC2S(Theta, Phi, XmQ, FS);
+        GetMNlmArray(lMax, K, r, Theta, Phi, LS_REGULAR, MArray, NArray);
+
+        // \tilde M_{lm} = (-1)^{m+1} M_{l,-m}, and similarly for N
+        for(int Alpha=1, l=1; l<=lMax; l++)
+         for(int m=-l; m<=l; m++, Alpha++)
+          {
+            int AlphaBar = l*(l+1) - m;
+            double mSign = (m%2) ? 1.0 : -1.0;
+            cdouble MDot =  mSign*w*PanelSign*(  FS[0]*MArray[3*AlphaBar+0]
+                                                +FS[1]*MArray[3*AlphaBar+1]
+                                                +FS[2]*MArray[3*AlphaBar+2] );
+            cdouble NDot = -mSign*w*PanelSign*(  FS[0]*NArray[3*AlphaBar+0]
+                                                +FS[1]*NArray[3*AlphaBar+1]
+                                                +FS[2]*NArray[3*AlphaBar+2] );
+            CKM[Alpha] += KWeight*MDot;
+            CKN[Alpha] += KWeight*NDot;
+            CNM[Alpha] += NWeight*MDot;
+            CNN[Alpha] += NWeight*NDot;
+          };
+      };
+   };
+
+}
+
+/***************************************************************/
+/* compute the outgoing-wave expansion coefficients for a      */
+/* single node.                                                */
+/*                                                             */
+/* with a^{K,N} = \int G * (K,N) and the curl relations        */
+/* \nabla x M = -ik N, \nabla x N = ik M, the fields are       */
+/*  E = ZVAC*( iwu a^K + \nabla x a^N )                        */
+/*  H = -iwe a^N + \nabla x a^K                                */
+/* (compare GetScatteredFields in GetFields.cc).               */
+/***************************************************************/
+static void GetNodeCoefficients(FTCTree *Tree, FTCNode *Node, cdouble Omega)
+{
+  int lMax   = Node->lMax;
+  int NAlpha = (lMax+1)*(lMax+1);
+
+  cdouble *MArray = new cdouble[3*NAlpha];
+  cdouble *NArray = new cdouble[3*NAlpha];
+  cdouble *C      = new cdouble[4*NAlpha];
+  memset(C, 0, 4*NAlpha*sizeof(cdouble));
+  cdouble *CKM=C+0*NAlpha, *CKN=C+1*NAlpha, *CNM=C+2*NAlpha, *CNN=C+3*NAlpha;
+
+  cdouble K=Tree->K;
+  for(int n=0; n<Node->NumSources; n++)
+   AddSourceProjections(Tree->Sources + Node->SourceStart + n,
+                        K, lMax, Node->Center, MArray, NArray,
+                        CKM, CKN, CNM, CNN);
+
+  cdouble iwe = II*Omega*Tree->Eps;
+  cdouble iwu = II*Omega*Tree->Mu;
+  cdouble ik  = II*K, k2 = K*K;
+  Node->Coefficients = new cdouble[4*NAlpha];
+  cdouble *EM=Node->Coefficients + 0*NAlpha;
+  cdouble *EN=Node->Coefficients + 1*NAlpha;
+  cdouble *HM=Node->Coefficients + 2*NAlpha;
+  cdouble *HN=Node->Coefficients + 3*NAlpha;
+  for(int Alpha=0; Alpha<NAlpha; Alpha++)
+   { EM[Alpha] = ZVAC*( iwu*ik*CKM[Alpha] - k2*CNN[Alpha] );
+     EN[Alpha] = ZVAC*( iwu*ik*CKN[Alpha] + k2*CNM[Alpha] );
+     HM[Alpha] = -iwe*ik*CNM[Alpha] - k2*CKN[Alpha];
+     HN[Alpha] = -iwe*ik*CNN[Alpha] + k2*CKM[Alpha];
+   };
+
+  delete[] MArray;
+  delete[] NArray;
+  delete[] C;
+}
+
+/***************************************************************/
+/* create a treecode for the scattered fields of the surface   */
+/* currents described by KN at frequency Omega. returns NULL if*/
+/* the treecode is not applicable (in which case the caller    */
+/* should fall back to direct evaluation).                     */
+/***************************************************************/
+void *CreateFieldTreecode(RWGGeometry *G, HVector *KN, cdouble Omega, double Tolerance)
+{
+  /*--------------------------------------------------------------*/
+  /*- the expansions are only implemented for non-periodic        */
+  /*- geometries, and their error estimates (GetNodeLMax) assume  */
+  /*- oscillatory radial functions, so we punt on pure imaginary  */
+  /*- wavenumbers                                                 */
+  /*--------------------------------------------------------------*/
+  if ( G->LDim>0 || KN==0 || Tolerance<=0.0 )
+   return 0;
+
+  G->UpdateCachedEpsMuValues(Omega);
+  for(int nr=0; nr<G->NumRegions; nr++)
+   if (    !(G->RegionMPs[nr]->IsPEC())
+        && real( csqrt2(G->EpsTF[nr]*G->MuTF[nr])*Omega )==0.0
+      ) return 0;
+
+  Log("Building field treecode (tolerance %e)...",Tolerance);
+
+  FieldTreecode *FTC = (FieldTreecode *)mallocEC(sizeof(FieldTreecode));
+  FTC->G         = G;
+  FTC->Omega     = Omega;
+  FTC->Tolerance = Tolerance;
+  FTC->Trees     = (FTCTree *)mallocEC(G->NumRegions*sizeof(FTCTree));
+
+  int NumExpansions=0, NumNodes=0;
+  for(int nr=0; nr<G->NumRegions; nr++)
+   {
+     FTCTree *Tree = FTC->Trees + nr;
+     memset(Tree, 0, sizeof(FTCTree));
+     if ( G->RegionMPs[nr]->IsPEC() )
+      continue;
+
+     Tree->Eps = G->EpsTF[nr];
+     Tree->Mu  = G->MuTF[nr];
+     Tree->K   = csqrt2(Tree->Eps*Tree->Mu)*Omega;
+
+     /*--------------------------------------------------------------*/
+     /*- collect all basis functions on surfaces bounding the region */
+     /*--------------------------------------------------------------*/
+     for(int ns=0; ns<G->NumSurfaces; ns++)
+      if ( G->Surfaces[ns]->RegionIndices[0]==nr || G->Surfaces[ns]->RegionIndices[1]==nr )
+       Tree->NumSources += G->Surfaces[ns]->NumEdges;
+     if (Tree->NumSources==0)
+      continue;
+
+     Tree->Sources = (FTCSource *)mallocEC(Tree->NumSources*sizeof(FTCSource));
+     for(int ns=0, n=0; ns<G->NumSurfaces; ns++)
+      {
+        RWGSurface *S=G->Surfaces[ns];
+        double Sign;
+        if ( S->RegionIndices[0]==nr )
+         Sign=+1.0;
+        else if ( S->RegionIndices[1]==nr )
+         Sign=-1.0;
+        else
+         continue;
+
+        int Offset=G->BFIndexOffset[ns];
+        for(int ne=0; ne<S->NumEdges; ne++, n++)
+         { FTCSource *Source = Tree->Sources + n;
+           Source->S        = S;
+           Source->ne       = ne;
+           Source->Sign     = Sign;
+           Source->Centroid = S->Edges[ne]->Centroid;
+           if (S->IsPEC)
+            { Source->KAlpha = KN->GetEntry(Offset + ne);
+              Source->NAlpha = 0.0;
+            }
+           else
+            { Source->KAlpha = KN->GetEntry(Offset + 2*ne + 0);
+              Source->NAlpha = KN->GetEntry(Offset + 2*ne + 1);
+            };
+         };
+      };
+
+     /*--------------------------------------------------------------*/
+     /*- build the octree and compute node expansions. (this is done */
+     /*- single-threaded for the same reason as in                   */
+     /*- GetSphericalMoments.)                                       */
+     /*--------------------------------------------------------------*/
+     AddNode(Tree, 0, Tree->NumSources);
+     SubdivideNode(Tree, 0, 0, Tolerance);
+     for(int nn=0; nn<Tree->NumNodes; nn++)
+      if (Tree->Nodes[nn].lMax>0)
+       { GetNodeCoefficients(Tree, Tree->Nodes + nn, Omega);
+         NumExpansions++;
+       };
+     NumNodes+=Tree->NumNodes;
+   };
+
+  Log(" ...%i nodes (%i with expansions)",NumNodes,NumExpansions);
+  return (void *)FTC;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+void DestroyFieldTreecode(void *opFTC)
+{
+  FieldTreecode *FTC = (FieldTreecode *)opFTC;
+  if (FTC==0)
+   return;
+
+  for(int nr=0; nr<FTC->G->NumRegions; nr++)
+   { FTCTree *Tree = FTC->Trees + nr;
+     for(int nn=0; nn<Tree->NumNodes; nn++)
+      if (Tree->Nodes[nn].Coefficients)
+       delete[] Tree->Nodes[nn].Coefficients;
+     if (Tree->Nodes) free(Tree->Nodes);
+     if (Tree->Sources) free(Tree->Sources);
+   };
+  free(FTC->Trees);
+  free(FTC);
+}
+
+/***************************************************************/
+/* add the direct contributions of all sources in a leaf node  */
+/***************************************************************/
+static void AddDirectContributions(FTCTree *Tree, FTCNode *Node,
+                                   const double X[3], cdouble Omega,
+                                   cdouble EHS[6])
+{
+  cdouble iwe = II*Omega*Tree->Eps;
+  cdouble iwu = II*Omega*Tree->Mu;
+  cdouble a[3], Curla[3], Gradp[3];
+
+  for(int n=0; n<Node->NumSources; n++)
+   {
+     FTCSource *Source = Tree->Sources + Node->SourceStart + n;
+     cdouble KAlpha = Source->Sign * Source->KAlpha;
+     cdouble NAlpha = Source->Sign * Source->NAlpha;
+
+     Source->S->GetReducedPotentials(Source->ne, X, Tree->K, 0, a, Curla, Gradp);
+
+     for(int i=0; i<3; i++)
+      { EHS[i]   += ZVAC*( KAlpha*(iwu*a[i] - Gradp[i]/iwe) + NAlpha*Curla[i] );
+        EHS[i+3] += -1.0*NAlpha*(iwe*a[i] - Gradp[i]/iwu) + KAlpha*Curla[i];
+      };
+   };
+}
+
+/***************************************************************/
+/* add the contribution of the outgoing expansion of a node    */
+/***************************************************************/
+static void AddExpansionContributions(FTCTree *Tree, FTCNode *Node,
+                                      const double X[3],
+                                      cdouble *MArray, cdouble *NArray,
+                                      cdouble EHS[6])
+{
+  int lMax   = Node->lMax;
+  int NAlpha = (lMax+1)*(lMax+1);
+  cdouble *EM=Node->Coefficients + 0*NAlpha;
+  cdouble *EN=Node->Coefficients + 1*NAlpha;
+  cdouble *HM=Node->Coefficients + 2*NAlpha;
+  cdouble *HN=Node->Coefficients + 3*NAlpha;
+
+  double XmX0[3], r, Theta, Phi;
+  VecSub(X, Node->Center, XmX0);
+  CoordinateC2S(XmX0, &r, &Theta, &Phi);
+  GetMNlmArray(lMax, Tree->K, r, Theta, Phi, LS_OUTGOING, MArray, NArray);
+
+  cdouble ES[3]={0.0,0.0,0.0}, HS[3]={0.0,0.0,0.0};
+  for(int Alpha=1; Alpha<NAlpha; Alpha++)
+   for(int Mu=0; Mu<3; Mu++)
+    { ES[Mu] += EM[Alpha]*MArray[3*Alpha+Mu] + EN[Alpha]*NArray[3*Alpha+Mu];
+      HS[Mu] += HM[Alpha]*MArray[3*Alpha+Mu] + HN[Alpha]*NArray[3*Alpha+Mu];
+    };
+
+  cdouble EC[3], HC[3];
+  VectorS2C(Theta, Phi, ES, EC);
+  VectorS2C(Theta, Phi, HS, HC);
+  for(int Mu=0; Mu<3; Mu++)
+   { EHS[Mu]   += EC[Mu];
+     EHS[Mu+3] += HC[Mu];
+   };
+}
+
+/***************************************************************/
+/* scratch storage for the spherical-wave arrays used by       */
+/* GetTreecodeScatteredFields; each thread allocates one of    */
+/* these before looping over its evaluation points.            */
+/***************************************************************/
+void *CreateTreecodeWorkspace()
+{
+  return (void *)(new cdouble[6*(FTC_MAXLMAX+1)*(FTC_MAXLMAX+1)]);
+}
+
+void DestroyTreecodeWorkspace(void *Workspace)
+{
+  if (Workspace)
+   delete[] (cdouble *)Workspace;
+}
+
+/***************************************************************/
+/* treecode analogue of GetScatteredFields() in GetFields.cc.  */
+/***************************************************************/
+void GetTreecodeScatteredFields(void *opFTC, const double X[3],
+                                int RegionIndex, cdouble EHS[6],
+                                void *Workspace)
+{
+  memset(EHS, 0, 6*sizeof(cdouble));
+
+  FieldTreecode *FTC = (FieldTreecode *)opFTC;
+  FTCTree *Tree = FTC->Trees + RegionIndex;
+  if (Tree->NumNodes==0)
+   return;
+
+  cdouble *MArray = (cdouble *)Workspace;
+  cdouble *NArray = MArray + 3*(FTC_MAXLMAX+1)*(FTC_MAXLMAX+1);
+
+  // each visited node pushes at most 8 children, and the tree
+  // is at most FTC_MAXDEPTH levels deep
+  int Stack[8*FTC_MAXDEPTH + 8];
+  int StackSize=0;
+  Stack[StackSize++]=0;
+  while(StackSize>0)
+   {
+     FTCNode *Node = Tree->Nodes + Stack[--StackSize];
+
+     if ( Node->lMax>0 && VecDistance(X, Node->Center) > Node->Radius/FTC_THETA )
+      AddExpansionContributions(Tree, Node, X, MArray, NArray, EHS);
+     else if ( Node->NumChildren==0 )
+      AddDirectContributions(Tree, Node, X, FTC->Omega, EHS);
+     else
+      for(int nc=0; nc<Node->NumChildren; nc++)
+       Stack[StackSize++] = Node->Children[nc];
+   };
+
+}
+
+} // namespace scuff
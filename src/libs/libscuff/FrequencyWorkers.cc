@@ -0,0 +1,369 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * FrequencyWorkers.cc -- concurrent evaluation of frequency-domain
+ *                     -- integrands in local worker processes
+ *
+ * how it works:
+ *
+ *  (a) the frequency integrands of scuff-cas3D, scuff-neq and
+ *      scuff-heat mutate the geometry (transformations) and a lot of
+ *      per-frequency workspace, so several frequencies cannot be
+ *      evaluated by threads sharing one RWGGeometry. instead,
+ *      CreateFrequencyWorkers() forks NumWorkers copies of the
+ *      calling process, each of which owns a private copy of the
+ *      geometry and workspace and gets NumThreads/NumWorkers of the
+ *      computational threads.
+ *
+ *  (b) the workers sit in a loop reading frequency points (ndim
+ *      doubles) from a pipe, evaluate the user's function at each
+ *      point, and write back the fdim doubles of the result.
+ *      EvaluateFrequencyPoints() hands out a batch of points to the
+ *      idle workers and collects the results in order, so it may
+ *      be used directly as the body of a vectorized cubature
+ *      integrand.
+ *
+ *  (c) the GNU OpenMP runtime does not survive fork() once the
+ *      parent process has started its thread pool, and geometry
+ *      setup (mesh reading, edge lists, snapshot loading) already
+ *      runs parallel regions. callers therefore call
+ *      ReserveFrequencyWorkers() before creating the geometry; this
+ *      records the thread budget and switches to a single thread,
+ *      so that setup runs serially and the pool is never started.
+ *      CreateFrequencyWorkers() splits the recorded budget among
+ *      the workers and restores it in the parent after forking.
+ *
+ *  (d) with NumWorkers<=1 no processes are created and the points
+ *      are evaluated in the calling process, so the calling code
+ *      may go through EvaluateFrequencyPoints unconditionally.
+ *
+ *  (e) GetFrequencyWorkerIndex() returns the index of the worker
+ *      in a worker process and -1 otherwise; callers use this e.g.
+ *      to let only one worker write the FIPPI cache file.
+ *
+ *  (f) workers append their frequency-resolved output to the same
+ *      files; LockOutputFile()/UnlockOutputFile() serialize those
+ *      writes, so that the blocks of lines for one frequency stay
+ *      contiguous (as the CacheRead() routines require).
+ *
+ * agent         -- 10/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <libhrutil.h>
+
+#include "libscuff.h"
+
+namespace scuff {
+
+typedef struct FWData
+ {
+   FrequencyFunction Function;
+   void *UserData;
+   int ndim, fdim;
+
+   int NumWorkers;
+   pid_t *PIDs;
+   int *CommandFDs, *ResultFDs;
+
+ } FWData;
+
+// index of the worker running in this process (-1 in the parent)
+static int WorkerIndex=-1;
+
+// thread budget recorded by ReserveFrequencyWorkers (0 if none)
+static int ReservedThreads=0;
+
+/***************************************************************/
+/* read or write exactly N bytes, retrying after interrupts    */
+/* and partial transfers; returns false on EOF or error.       */
+/***************************************************************/
+static bool ReadAll(int fd, void *Buffer, size_t N)
+{
+  char *p=(char *)Buffer;
+  while(N>0)
+   { ssize_t n=read(fd, p, N);
+     if (n<0 && errno==EINTR) continue;
+     if (n<=0) return false;
+     p+=n; N-=n;
+   };
+  return true;
+}
+
+static bool WriteAll(int fd, const void *Buffer, size_t N)
+{
+  const char *p=(const char *)Buffer;
+  while(N>0)
+   { ssize_t n=write(fd, p, N);
+     if (n<0 && errno==EINTR) continue;
+     if (n<=0) return false;
+     p+=n; N-=n;
+   };
+  return true;
+}
+
+/***************************************************************/
+/* body of a worker process: evaluate points until the command */
+/* pipe is closed                                              */
+/***************************************************************/
+static void WorkerLoop(FWData *FWD, int CommandFD, int ResultFD)
+{
+  double *x    = (double *)mallocEC( (FWD->ndim+1)*sizeof(double) );
+  double *fval = (double *)mallocEC( (FWD->fdim+1)*sizeof(double) );
+
+  while( ReadAll(CommandFD, x, FWD->ndim*sizeof(double)) )
+   { memset(fval, 0, FWD->fdim*sizeof(double));
+     FWD->Function(FWD->UserData, x, fval);
+     if ( !WriteAll(ResultFD, fval, FWD->fdim*sizeof(double)) )
+      break;
+   };
+
+  _exit(0);
+}
+
+/***************************************************************/
+/* restore the thread budget recorded by                       */
+/* ReserveFrequencyWorkers, if any                             */
+/***************************************************************/
+static void ReleaseReservedThreads()
+{
+  if (ReservedThreads==0) return;
+  SetNumThreads(ReservedThreads);
+  ReservedThreads=0;
+}
+
+/***************************************************************/
+/* to be called before any OpenMP calculation (in particular   */
+/* before creating the geometry) by programs that will later   */
+/* call CreateFrequencyWorkers with NumWorkers>1               */
+/***************************************************************/
+void ReserveFrequencyWorkers(int NumWorkers)
+{
+  if (NumWorkers<=1 || ReservedThreads>0)
+   return;
+  ReservedThreads=GetNumThreads();
+  SetNumThreads(1);
+  Log("Running setup single-threaded ahead of %i frequency workers",NumWorkers);
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+void *CreateFrequencyWorkers(FrequencyFunction Function, void *UserData,
+                             int ndim, int fdim, int NumWorkers)
+{
+  FWData *FWD=(FWData *)mallocEC(sizeof(FWData));
+  FWD->Function   = Function;
+  FWD->UserData   = UserData;
+  FWD->ndim       = ndim;
+  FWD->fdim       = fdim;
+  FWD->NumWorkers = (NumWorkers>1) ? NumWorkers : 1;
+  FWD->PIDs       = 0;
+  FWD->CommandFDs = 0;
+  FWD->ResultFDs  = 0;
+  if (FWD->NumWorkers==1)
+   { ReleaseReservedThreads();
+     return (void *)FWD;
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- split the thread budget among the workers                  -*/
+  /*--------------------------------------------------------------*/
+  if (ReservedThreads==0)
+   Warn("frequency workers created without ReserveFrequencyWorkers (workers may hang)");
+  int NumThreads = ReservedThreads>0 ? ReservedThreads : GetNumThreads();
+  int WorkerThreads = NumThreads / FWD->NumWorkers;
+  if (WorkerThreads<1) WorkerThreads=1;
+  Log("Creating %i frequency workers (%i threads each)",FWD->NumWorkers,WorkerThreads);
+
+  // a worker that dies must not kill the parent via SIGPIPE
+  signal(SIGPIPE, SIG_IGN);
+
+  FWD->PIDs       = (pid_t *)mallocEC(FWD->NumWorkers*sizeof(pid_t));
+  FWD->CommandFDs = (int *)mallocEC(FWD->NumWorkers*sizeof(int));
+  FWD->ResultFDs  = (int *)mallocEC(FWD->NumWorkers*sizeof(int));
+  for(int nw=0; nw<FWD->NumWorkers; nw++)
+   {
+     int CommandPipe[2], ResultPipe[2];
+     if ( pipe(CommandPipe) || pipe(ResultPipe) )
+      ErrExit("%s:%i: could not create pipes for frequency workers",__FILE__,__LINE__);
+
+     fflush(stdout);
+     fflush(stderr);
+     pid_t PID=fork();
+     if (PID<0)
+      ErrExit("%s:%i: could not fork frequency worker",__FILE__,__LINE__);
+
+     if (PID==0)
+      {
+        // worker: close the parent's ends of our pipes and of the
+        // pipes of all previously created workers
+        close(CommandPipe[1]);
+        close(ResultPipe[0]);
+        for(int nwp=0; nwp<nw; nwp++)
+         { close(FWD->CommandFDs[nwp]);
+           close(FWD->ResultFDs[nwp]);
+         };
+        WorkerIndex=nw;
+        ReservedThreads=0;
+        SetNumThreads(WorkerThreads);
+        WorkerLoop(FWD, CommandPipe[0], ResultPipe[1]);
+      };
+
+     close(CommandPipe[0]);
+     close(ResultPipe[1]);
+     FWD->PIDs[nw]       = PID;
+     FWD->CommandFDs[nw] = CommandPipe[1];
+     FWD->ResultFDs[nw]  = ResultPipe[0];
+   };
+
+  ReleaseReservedThreads();
+  return (void *)FWD;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int GetNumFrequencyWorkers(void *pFWD)
+{
+  FWData *FWD=(FWData *)pFWD;
+  return FWD ? FWD->NumWorkers : 1;
+}
+
+int GetFrequencyWorkerIndex()
+{
+  return WorkerIndex;
+}
+
+/***************************************************************/
+/* evaluate the function at NumPoints points; point #np is     */
+/* x[np*ndim ... np*ndim+ndim-1] and its value goes into       */
+/* fval[np*fdim ... np*fdim+fdim-1].                            */
+/***************************************************************/
+void EvaluateFrequencyPoints(void *pFWD, int NumPoints, const double *x, double *fval)
+{
+  FWData *FWD=(FWData *)pFWD;
+  int ndim=FWD->ndim, fdim=FWD->fdim;
+
+  if (FWD->NumWorkers==1)
+   { for(int np=0; np<NumPoints; np++)
+      FWD->Function(FWD->UserData, x + np*ndim, fval + np*fdim);
+     return;
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- WorkerPoint[nw] = point on which worker #nw is busy, or -1 -*/
+  /*--------------------------------------------------------------*/
+  int NumWorkers = FWD->NumWorkers;
+  int *WorkerPoint = new int[NumWorkers];
+  struct pollfd *PFDs = new struct pollfd[NumWorkers];
+  for(int nw=0; nw<NumWorkers; nw++)
+   WorkerPoint[nw]=-1;
+
+  int NextPoint=0, NumBusy=0;
+  while( NextPoint<NumPoints || NumBusy>0 )
+   {
+     // hand out points to idle workers
+     for(int nw=0; nw<NumWorkers && NextPoint<NumPoints; nw++)
+      if (WorkerPoint[nw]==-1)
+       { if ( !WriteAll(FWD->CommandFDs[nw], x + NextPoint*ndim, ndim*sizeof(double)) )
+          ErrExit("frequency worker %i (pid %i) terminated unexpectedly",nw,(int)FWD->PIDs[nw]);
+         WorkerPoint[nw]=NextPoint++;
+         NumBusy++;
+       };
+
+     // wait for results from any busy worker
+     int NumFDs=0;
+     for(int nw=0; nw<NumWorkers; nw++)
+      if (WorkerPoint[nw]!=-1)
+       { PFDs[NumFDs].fd=FWD->ResultFDs[nw];
+         PFDs[NumFDs].events=POLLIN;
+         PFDs[NumFDs].revents=0;
+         NumFDs++;
+       };
+     if ( poll(PFDs, NumFDs, -1) < 0 )
+      { if (errno==EINTR) continue;
+        ErrExit("%s:%i: poll failed (%s)",__FILE__,__LINE__,strerror(errno));
+      };
+
+     for(int nfd=0, nw=0; nw<NumWorkers; nw++)
+      { if (WorkerPoint[nw]==-1) continue;
+        if (PFDs[nfd++].revents==0) continue;
+        int np=WorkerPoint[nw];
+        if ( !ReadAll(FWD->ResultFDs[nw], fval + np*fdim, fdim*sizeof(double)) )
+         ErrExit("frequency worker %i (pid %i) terminated unexpectedly",nw,(int)FWD->PIDs[nw]);
+        WorkerPoint[nw]=-1;
+        NumBusy--;
+      };
+   };
+
+  delete[] WorkerPoint;
+  delete[] PFDs;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+void DestroyFrequencyWorkers(void *pFWD)
+{
+  FWData *FWD=(FWData *)pFWD;
+  if (!FWD) return;
+
+  if (FWD->NumWorkers>1)
+   { for(int nw=0; nw<FWD->NumWorkers; nw++)
+      { close(FWD->CommandFDs[nw]);
+        close(FWD->ResultFDs[nw]);
+      };
+     for(int nw=0; nw<FWD->NumWorkers; nw++)
+      waitpid(FWD->PIDs[nw], 0, 0);
+     free(FWD->PIDs);
+     free(FWD->CommandFDs);
+     free(FWD->ResultFDs);
+   };
+
+  free(FWD);
+}
+
+/***************************************************************/
+/* advisory locking for output files shared among workers      */
+/***************************************************************/
+void LockOutputFile(FILE *f)
+{
+  if (f) flock(fileno(f), LOCK_EX);
+}
+
+void UnlockOutputFile(FILE *f)
+{
+  if (!f) return;
+  fflush(f);
+  flock(fileno(f), LOCK_UN);
+}
+
+} // namespace scuff
@@ -0,0 +1,600 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * GeometrySnapshot.cc -- binary snapshots of the derived topology of
+ *                     -- RWGSurfaces, used to skip mesh parsing and
+ *                     -- edge-list construction on repeated runs
+ *
+ * how it works:
+ *
+ *  (a) if a snapshot directory has been set by calling
+ *      RWGGeometry::SetSnapshotDir() (the command-line option
+ *      --SnapshotDir of the scuff-em applications does this),
+ *      InitRWGSurface() computes a 64-bit key for each surface
+ *      by hashing (FNV-1a) the contents of its mesh file together
+ *      with everything else that affects the derived topology: the
+ *      MESHTAG, the one-time transformation from the .scuffgeo
+ *      file, ROTATIONAL_SYMMETRY, OBJECT vs. SURFACE, the
+ *      AssignBasisFunctionsToExteriorEdges flag, and the snapshot
+ *      format version.
+ *
+ *      to avoid reading the whole mesh file on every run, the hash
+ *      of the file contents is itself cached: the file
+ *      SnapshotDir/STAMP.scuffstamp, where STAMP is a hash of the
+ *      device, inode, size, and modification/change times of the
+ *      mesh file, records those stat fields and the content hash.
+ *      the contents are only hashed when no stamp file matches
+ *      (i.e. on the first run, or after the mesh file changes).
+ *
+ *  (b) if the file SnapshotDir/KEY.scuffsnap exists and its header
+ *      matches, the vertices, panels, edges, and boundary-contour
+ *      data are copied out of it (via mmap) in place of reading
+ *      the mesh file and calling InitEdgeList() etc.
+ *
+ *  (c) otherwise, the surface is constructed as usual and a new
+ *      snapshot is written (to a temporary file that is renamed
+ *      into place, so concurrent runs sharing a snapshot directory
+ *      never see a partial file).
+ *
+ *  the file layout is a fixed header followed by flat arrays, with
+ *  all double-valued arrays preceding all int-valued arrays:
+ *
+ *   header
+ *   Vertices           double[3*NumVertices]
+ *   panel records      RWGPanel[NumPanels]
+ *   edge records       RWGEdge[NumEdgeRecords]   (Next fields zeroed)
+ *   Edges              int[NumEdges]             (indices into edge records)
+ *   ExteriorEdges      int[NumExteriorEdges]     (indices into edge records)
+ *   WhichBC            int[NumVertices]
+ *   NumBCEdges         int[NumBCs]
+ *   BCEdges            int[sum NumBCEdges]       (indices into edge records)
+ *
+ *  (edge records that appear in both Edges and ExteriorEdges, as
+ *   happens for promoted exterior edges, are stored only once, so
+ *   the aliasing of the original structure is reproduced exactly.)
+ *
+ *  geometry-level data (Mate[], PBC straddlers, kd-trees) are not
+ *  stored; they are recomputed from the surfaces, which is cheap
+ *  compared to parsing meshes and building edge lists.
+ *
+ * agent         -- 10/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <libhrutil.h>
+
+#include "libscuff.h"
+
+namespace scuff {
+
+#define SNAPSHOT_VERSION 1
+#define SNAPSHOT_MAGIC   "SCUFFSNP"
+
+typedef struct SnapshotHeader
+ { char Magic[8];
+   int Version;
+   int HeaderSize;
+   unsigned long long Key;
+
+   int NumVertices, NumPanels, NumEdgeRecords;
+   int NumEdges, NumExteriorEdges, NumTotalEdges;
+   int NumInteriorVertices, NumRefPts, NumRedundantVertices;
+   int NumBCs, NumBCEdgesTotal, NumSlices;
+
+   double SymmetryOrigin[3], SymmetryAxis[3];
+
+ } SnapshotHeader;
+
+/***************************************************************/
+/* set (Dir!=0) or clear (Dir==0) the snapshot directory,      */
+/* creating it if necessary                                    */
+/***************************************************************/
+void RWGGeometry::SetSnapshotDir(const char *Dir)
+{
+  if (SnapshotDir)
+   free(SnapshotDir);
+  SnapshotDir=0;
+  if (Dir==0 || Dir[0]==0)
+   return;
+
+  struct stat DirInfo;
+  if ( stat(Dir, &DirInfo)!=0 )
+   { if ( mkdir(Dir, 0755)!=0 )
+      ErrExit("could not create geometry snapshot directory %s",Dir);
+   }
+  else if ( !S_ISDIR(DirInfo.st_mode) )
+   ErrExit("geometry snapshot directory %s is not a directory",Dir);
+
+  SnapshotDir=strdupEC(Dir);
+  Log("Caching geometry snapshots in directory %s.",SnapshotDir);
+}
+
+/***************************************************************/
+/* 64-bit FNV-1a hash                                          */
+/***************************************************************/
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME  1099511628211ULL
+static void HashBytes(unsigned long long *Key, const void *Data, size_t N)
+{
+  const unsigned char *p=(const unsigned char *)Data;
+  unsigned long long h=*Key;
+  for(size_t n=0; n<N; n++)
+   { h ^= (unsigned long long)p[n];
+     h *= FNV_PRIME;
+   };
+  *Key=h;
+}
+
+/***************************************************************/
+/* a stamp file records the hash of the contents of a mesh     */
+/* file together with the stat fields of the file at the time  */
+/* the hash was computed                                       */
+/***************************************************************/
+#define STAMP_MAGIC "SCUFFSTP"
+
+typedef struct MeshFileStamp
+ { char Magic[8];
+   long long Device, Inode, Size, MTime, CTime;
+   unsigned long long ContentHash;
+ } MeshFileStamp;
+
+static void GetMeshFileStamp(FILE *MeshFile, MeshFileStamp *Stamp)
+{
+  memset(Stamp, 0, sizeof(MeshFileStamp));
+  memcpy(Stamp->Magic, STAMP_MAGIC, 8);
+  struct stat FileInfo;
+  if ( fstat(fileno(MeshFile), &FileInfo)!=0 )
+   return;
+  Stamp->Device = (long long)FileInfo.st_dev;
+  Stamp->Inode  = (long long)FileInfo.st_ino;
+  Stamp->Size   = (long long)FileInfo.st_size;
+  Stamp->MTime  = (long long)FileInfo.st_mtime;
+  Stamp->CTime  = (long long)FileInfo.st_ctime;
+}
+
+/***************************************************************/
+/* hash of the contents of a mesh file, taken from a matching  */
+/* stamp file if there is one, and computed (and recorded in a */
+/* new stamp file) otherwise. the file is rewound on return.   */
+/***************************************************************/
+static unsigned long long GetContentHash(FILE *MeshFile)
+{
+  MeshFileStamp Stamp;
+  GetMeshFileStamp(MeshFile, &Stamp);
+
+  unsigned long long StampKey=FNV_OFFSET;
+  HashBytes(&StampKey, &Stamp, sizeof(MeshFileStamp));
+  char *StampFileName=vstrdup("%s/%016llx.scuffstamp",RWGGeometry::SnapshotDir,StampKey);
+
+  /*--------------------------------------------------------------*/
+  /*- look for a stamp file whose stat fields match ---------------*/
+  /*--------------------------------------------------------------*/
+  MeshFileStamp Cached;
+  FILE *f=fopen(StampFileName,"r");
+  if (f)
+   { bool ReadOK = (1==fread(&Cached, sizeof(MeshFileStamp), 1, f));
+     fclose(f);
+     unsigned long long ContentHash=Cached.ContentHash;
+     Cached.ContentHash=0; // as in Stamp, for the comparison
+     if ( ReadOK && Stamp.Size>0 && !memcmp(&Cached, &Stamp, sizeof(MeshFileStamp)) )
+      { free(StampFileName);
+        return ContentHash;
+      };
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- no luck; hash the contents and record the result ------------*/
+  /*--------------------------------------------------------------*/
+  unsigned long long ContentHash=FNV_OFFSET;
+  char Buffer[65536];
+  size_t NRead;
+  rewind(MeshFile);
+  while( (NRead=fread(Buffer, 1, sizeof(Buffer), MeshFile)) > 0 )
+   HashBytes(&ContentHash, Buffer, NRead);
+  rewind(MeshFile);
+
+  if (Stamp.Size>0)
+   { Stamp.ContentHash=ContentHash;
+     char *TmpFileName=vstrdup("%s.%i",StampFileName,(int)getpid());
+     f=fopen(TmpFileName,"w");
+     bool WriteOK = f && (1==fwrite(&Stamp, sizeof(MeshFileStamp), 1, f));
+     if (f)
+      WriteOK = (fclose(f)==0) && WriteOK;
+     if ( !WriteOK || rename(TmpFileName, StampFileName)!=0 )
+      unlink(TmpFileName);
+     free(TmpFileName);
+   };
+
+  free(StampFileName);
+  return ContentHash;
+}
+
+/***************************************************************/
+/* compute the snapshot key for a surface whose mesh file has  */
+/* just been opened. the file is rewound on return.            */
+/***************************************************************/
+unsigned long long RWGSurface::GetSnapshotKey(FILE *MeshFile,
+                                              const GTransformation *OTGT)
+{
+  unsigned long long Key=FNV_OFFSET;
+
+  int Version=SNAPSHOT_VERSION;
+  HashBytes(&Key, &Version, sizeof(int));
+
+  /*--------------------------------------------------------------*/
+  /*- contents of the mesh file ----------------------------------*/
+  /*--------------------------------------------------------------*/
+  unsigned long long ContentHash=GetContentHash(MeshFile);
+  HashBytes(&Key, &ContentHash, sizeof(ContentHash));
+
+  /* the file extension determines which reader is used */
+  char *Ext=GetFileExtension(MeshFileName);
+  if (Ext)
+   HashBytes(&Key, Ext, strlen(Ext));
+
+  /*--------------------------------------------------------------*/
+  /*- the one-time transformation, as the images of the origin   -*/
+  /*- and of the three unit vectors                              -*/
+  /*--------------------------------------------------------------*/
+  double GTPoints[12]={0.0, 0.0, 0.0,  1.0, 0.0, 0.0,
+                       0.0, 1.0, 0.0,  0.0, 0.0, 1.0};
+  if (OTGT)
+   OTGT->Apply(GTPoints, 4);
+  HashBytes(&Key, GTPoints, 12*sizeof(double));
+
+  /*--------------------------------------------------------------*/
+  /*- other parameters affecting the topology ---------------------*/
+  /*--------------------------------------------------------------*/
+  int Params[6];
+  Params[0]=MeshTag;
+  Params[1]=NumSlices;
+  Params[2]=IsObject;
+  Params[3]=RWGGeometry::AssignBasisFunctionsToExteriorEdges ? 1 : 0;
+  Params[4]=sizeof(RWGPanel);
+  Params[5]=sizeof(RWGEdge);
+  HashBytes(&Key, Params, 6*sizeof(int));
+
+  return Key;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+static char *GetSnapshotFileName(unsigned long long Key)
+{ return vstrdup("%s/%016llx.scuffsnap",RWGGeometry::SnapshotDir,Key); }
+
+static size_t GetSnapshotSize(SnapshotHeader *H)
+{
+  size_t Size = sizeof(SnapshotHeader);
+  Size += 3*((size_t)H->NumVertices)*sizeof(double);
+  Size += ((size_t)H->NumPanels)*sizeof(RWGPanel);
+  Size += ((size_t)H->NumEdgeRecords)*sizeof(RWGEdge);
+  Size += ((size_t)( H->NumEdges + H->NumExteriorEdges + H->NumVertices
+                    +H->NumBCs + H->NumBCEdgesTotal ))*sizeof(int);
+  return Size;
+}
+
+/***************************************************************/
+/* try to initialize the topology of the surface from the      */
+/* snapshot with the given key. returns true on success; on    */
+/* failure, the surface is left untouched.                     */
+/***************************************************************/
+bool RWGSurface::ReadSnapshot(unsigned long long Key)
+{
+  char *FileName=GetSnapshotFileName(Key);
+
+  int fd=open(FileName, O_RDONLY);
+  if (fd<0)
+   { free(FileName);
+     return false;
+   };
+
+  struct stat FileInfo;
+  if ( fstat(fd, &FileInfo)!=0 || ((size_t)FileInfo.st_size) < sizeof(SnapshotHeader) )
+   { close(fd);
+     free(FileName);
+     return false;
+   };
+  size_t FileSize=(size_t)FileInfo.st_size;
+
+  void *Map=mmap(0, FileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (Map==MAP_FAILED)
+   { free(FileName);
+     return false;
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- sanity-check the header ------------------------------------*/
+  /*--------------------------------------------------------------*/
+  SnapshotHeader *H=(SnapshotHeader *)Map;
+  if (    strncmp(H->Magic, SNAPSHOT_MAGIC, 8)
+       || H->Version!=SNAPSHOT_VERSION
+       || H->HeaderSize!=(int)sizeof(SnapshotHeader)
+       || H->Key!=Key
+       || H->NumVertices<0 || H->NumPanels<=0 || H->NumEdgeRecords<0
+       || H->NumEdges<0 || H->NumExteriorEdges<0 || H->NumBCs<0
+       || H->NumBCEdgesTotal<0
+       || GetSnapshotSize(H)!=FileSize
+     )
+   { Log("ignoring invalid snapshot file %s",FileName);
+     munmap(Map, FileSize);
+     free(FileName);
+     return false;
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- locate the sections ----------------------------------------*/
+  /*--------------------------------------------------------------*/
+  char *p=(char *)Map + sizeof(SnapshotHeader);
+  double *SVertices = (double *)p;   p += 3*H->NumVertices*sizeof(double);
+  RWGPanel *SPanels = (RWGPanel *)p; p += H->NumPanels*sizeof(RWGPanel);
+  RWGEdge *SEdges   = (RWGEdge *)p;  p += H->NumEdgeRecords*sizeof(RWGEdge);
+  int *SEdgeIndex   = (int *)p;      p += H->NumEdges*sizeof(int);
+  int *SExtIndex    = (int *)p;      p += H->NumExteriorEdges*sizeof(int);
+  int *SWhichBC     = (int *)p;      p += H->NumVertices*sizeof(int);
+  int *SNumBCEdges  = (int *)p;      p += H->NumBCs*sizeof(int);
+  int *SBCIndex     = (int *)p;
+
+  /* check edge indices before touching anything */
+  int NR=H->NumEdgeRecords, SumBC=0;
+  bool OK=true;
+  for(int ne=0; OK && ne<H->NumEdges; ne++)
+   OK = (SEdgeIndex[ne]>=0 && SEdgeIndex[ne]<NR);
+  for(int ne=0; OK && ne<H->NumExteriorEdges; ne++)
+   OK = (SExtIndex[ne]>=0 && SExtIndex[ne]<NR);
+  for(int nbc=0; OK && nbc<H->NumBCs; nbc++)
+   SumBC+=SNumBCEdges[nbc];
+  OK = OK && (SumBC==H->NumBCEdgesTotal);
+  for(int n=0; OK && n<SumBC; n++)
+   OK = (SBCIndex[n]>=0 && SBCIndex[n]<NR);
+  if (!OK)
+   { Log("ignoring invalid snapshot file %s",FileName);
+     munmap(Map, FileSize);
+     free(FileName);
+     return false;
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- copy out the data ------------------------------------------*/
+  /*--------------------------------------------------------------*/
+  NumVertices          = H->NumVertices;
+  NumPanels            = H->NumPanels;
+  NumEdges             = H->NumEdges;
+  NumExteriorEdges     = H->NumExteriorEdges;
+  NumTotalEdges        = H->NumTotalEdges;
+  NumInteriorVertices  = H->NumInteriorVertices;
+  NumRefPts            = H->NumRefPts;
+  NumRedundantVertices = H->NumRedundantVertices;
+  NumBCs               = H->NumBCs;
+  NumSlices            = H->NumSlices;
+  memcpy(SymmetryOrigin, H->SymmetryOrigin, 3*sizeof(double));
+  memcpy(SymmetryAxis,   H->SymmetryAxis,   3*sizeof(double));
+
+  Vertices=(double *)mallocEC(3*NumVertices*sizeof(double));
+  memcpy(Vertices, SVertices, 3*NumVertices*sizeof(double));
+
+  Panels=(RWGPanel **)mallocEC(NumPanels*sizeof(RWGPanel *));
+  for(int np=0; np<NumPanels; np++)
+   { Panels[np]=(RWGPanel *)mallocEC(sizeof(RWGPanel));
+     memcpy(Panels[np], SPanels+np, sizeof(RWGPanel));
+   };
+
+  EdgeBlock=(RWGEdge *)mallocEC((NR+1)*sizeof(RWGEdge));
+  memcpy(EdgeBlock, SEdges, NR*sizeof(RWGEdge));
+  for(int nr=0; nr<NR; nr++)
+   EdgeBlock[nr].Next=0;
+
+  Edges=(RWGEdge **)mallocEC((NumEdges+1)*sizeof(RWGEdge *));
+  for(int ne=0; ne<NumEdges; ne++)
+   Edges[ne]=EdgeBlock + SEdgeIndex[ne];
+
+  ExteriorEdges=(RWGEdge **)mallocEC((NumExteriorEdges+1)*sizeof(RWGEdge *));
+  for(int ne=0; ne<NumExteriorEdges; ne++)
+   ExteriorEdges[ne]=EdgeBlock + SExtIndex[ne];
+
+  WhichBC=(int *)mallocEC((NumVertices+1)*sizeof(int));
+  memcpy(WhichBC, SWhichBC, NumVertices*sizeof(int));
+
+  NumBCEdges=0;
+  BCEdges=0;
+  if (NumBCs>0)
+   { NumBCEdges=(int *)mallocEC(NumBCs*sizeof(int));
+     BCEdges=(RWGEdge ***)mallocEC(NumBCs*sizeof(RWGEdge **));
+     for(int nbc=0, n=0; nbc<NumBCs; nbc++)
+      { NumBCEdges[nbc]=SNumBCEdges[nbc];
+        BCEdges[nbc]=(RWGEdge **)mallocEC((NumBCEdges[nbc]+1)*sizeof(RWGEdge *));
+        for(int ne=0; ne<NumBCEdges[nbc]; ne++)
+         BCEdges[nbc][ne]=EdgeBlock + SBCIndex[n++];
+      };
+   };
+
+  munmap(Map, FileSize);
+
+  Log("Read topology of surface %s from snapshot %s",Label ? Label : MeshFileName,FileName);
+  free(FileName);
+  return true;
+}
+
+/***************************************************************/
+/* helper structure for mapping edge pointers to record indices */
+/***************************************************************/
+typedef struct EdgePtrIndex
+ { RWGEdge *E;
+   int Index;
+ } EdgePtrIndex;
+
+static int CompareEdgePtrs(const void *p1, const void *p2)
+{
+  RWGEdge *E1=((const EdgePtrIndex *)p1)->E;
+  RWGEdge *E2=((const EdgePtrIndex *)p2)->E;
+  if (E1<E2) return -1;
+  if (E1>E2) return +1;
+  return 0;
+}
+
+static int FindEdgeRecord(EdgePtrIndex *Table, int NumEntries, RWGEdge *E)
+{
+  EdgePtrIndex Target;
+  Target.E=E;
+  EdgePtrIndex *Match=(EdgePtrIndex *)bsearch(&Target, Table, NumEntries,
+                                              sizeof(EdgePtrIndex), CompareEdgePtrs);
+  return Match ? Match->Index : -1;
+}
+
+/***************************************************************/
+/* write a snapshot of the topology of the surface.            */
+/***************************************************************/
+void RWGSurface::WriteSnapshot(unsigned long long Key)
+{
+  /*--------------------------------------------------------------*/
+  /*- assign a record index to each distinct edge structure.      */
+  /*- records 0..NumEdges-1 are the entries of Edges[]; exterior  */
+  /*- edges not also in Edges[] get records after those.          */
+  /*--------------------------------------------------------------*/
+  int NE=NumEdges, NXE=NumExteriorEdges;
+  EdgePtrIndex *Table=(EdgePtrIndex *)mallocEC((NE+NXE+1)*sizeof(EdgePtrIndex));
+  for(int ne=0; ne<NE; ne++)
+   { Table[ne].E=Edges[ne];
+     Table[ne].Index=ne;
+   };
+  qsort(Table, NE, sizeof(EdgePtrIndex), CompareEdgePtrs);
+
+  int *ExtIndex=(int *)mallocEC((NXE+1)*sizeof(int));
+  int NumRecords=NE;
+  for(int ne=0; ne<NXE; ne++)
+   { ExtIndex[ne]=FindEdgeRecord(Table, NE, ExteriorEdges[ne]);
+     if (ExtIndex[ne]==-1)
+      { Table[NumRecords].E=ExteriorEdges[ne];
+        Table[NumRecords].Index=NumRecords;
+        ExtIndex[ne]=NumRecords++;
+      };
+   };
+
+  RWGEdge **Records=(RWGEdge **)mallocEC((NumRecords+1)*sizeof(RWGEdge *));
+  for(int nr=0; nr<NumRecords; nr++)
+   Records[ Table[nr].Index ] = Table[nr].E;
+  qsort(Table, NumRecords, sizeof(EdgePtrIndex), CompareEdgePtrs);
+
+  int NumBCEdgesTotal=0;
+  for(int nbc=0; nbc<NumBCs; nbc++)
+   NumBCEdgesTotal+=NumBCEdges[nbc];
+  int *BCIndex=(int *)mallocEC((NumBCEdgesTotal+1)*sizeof(int));
+  bool OK=true;
+  for(int nbc=0, n=0; nbc<NumBCs; nbc++)
+   for(int ne=0; ne<NumBCEdges[nbc]; ne++, n++)
+    if ( (BCIndex[n]=FindEdgeRecord(Table, NumRecords, BCEdges[nbc][ne])) == -1 )
+     OK=false;
+  free(Table);
+
+  if (!OK)
+   { Warn("surface %s: boundary-contour edge not found (skipping snapshot)",Label ? Label : MeshFileName);
+     free(Records);
+     free(ExtIndex);
+     free(BCIndex);
+     return;
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- fill in the header -----------------------------------------*/
+  /*--------------------------------------------------------------*/
+  SnapshotHeader H;
+  memset(&H, 0, sizeof(H));
+  memcpy(H.Magic, SNAPSHOT_MAGIC, 8);
+  H.Version              = SNAPSHOT_VERSION;
+  H.HeaderSize           = sizeof(SnapshotHeader);
+  H.Key                  = Key;
+  H.NumVertices          = NumVertices;
+  H.NumPanels            = NumPanels;
+  H.NumEdgeRecords       = NumRecords;
+  H.NumEdges             = NumEdges;
+  H.NumExteriorEdges     = NumExteriorEdges;
+  H.NumTotalEdges        = NumTotalEdges;
+  H.NumInteriorVertices  = NumInteriorVertices;
+  H.NumRefPts            = NumRefPts;
+  H.NumRedundantVertices = NumRedundantVertices;
+  H.NumBCs               = NumBCs;
+  H.NumBCEdgesTotal      = NumBCEdgesTotal;
+  H.NumSlices            = NumSlices;
+  memcpy(H.SymmetryOrigin, SymmetryOrigin, 3*sizeof(double));
+  memcpy(H.SymmetryAxis,   SymmetryAxis,   3*sizeof(double));
+
+  /*--------------------------------------------------------------*/
+  /*- write to a temporary file and rename it into place ---------*/
+  /*--------------------------------------------------------------*/
+  char *FileName=GetSnapshotFileName(Key);
+  char *TmpFileName=vstrdup("%s.%i",FileName,(int)getpid());
+  FILE *f=fopen(TmpFileName,"w");
+  if (!f)
+   { Warn("could not open file %s (skipping snapshot)",TmpFileName);
+     free(FileName);
+     free(TmpFileName);
+     free(Records);
+     free(ExtIndex);
+     free(BCIndex);
+     return;
+   };
+
+  bool WriteOK = (1==fwrite(&H, sizeof(H), 1, f));
+  if (NumVertices>0)
+   WriteOK = WriteOK && (3*NumVertices==(int)fwrite(Vertices, sizeof(double), 3*NumVertices, f));
+  for(int np=0; WriteOK && np<NumPanels; np++)
+   WriteOK = (1==fwrite(Panels[np], sizeof(RWGPanel), 1, f));
+  for(int nr=0; WriteOK && nr<NumRecords; nr++)
+   { RWGEdge E=*(Records[nr]);
+     E.Next=0;
+     WriteOK = (1==fwrite(&E, sizeof(RWGEdge), 1, f));
+   };
+  for(int ne=0; WriteOK && ne<NumEdges; ne++)
+   WriteOK = (1==fwrite(&ne, sizeof(int), 1, f));
+  if (NumExteriorEdges>0)
+   WriteOK = WriteOK && (NumExteriorEdges==(int)fwrite(ExtIndex, sizeof(int), NumExteriorEdges, f));
+  if (NumVertices>0)
+   WriteOK = WriteOK && (NumVertices==(int)fwrite(WhichBC, sizeof(int), NumVertices, f));
+  if (NumBCs>0)
+   WriteOK = WriteOK && (NumBCs==(int)fwrite(NumBCEdges, sizeof(int), NumBCs, f));
+  if (NumBCEdgesTotal>0)
+   WriteOK = WriteOK && (NumBCEdgesTotal==(int)fwrite(BCIndex, sizeof(int), NumBCEdgesTotal, f));
+  WriteOK = (fclose(f)==0) && WriteOK;
+
+  if ( WriteOK && rename(TmpFileName, FileName)==0 )
+   Log("Wrote topology of surface %s to snapshot %s",Label ? Label : MeshFileName,FileName);
+  else
+   { Warn("could not write snapshot file %s",FileName);
+     unlink(TmpFileName);
+   };
+
+  free(FileName);
+  free(TmpFileName);
+  free(Records);
+  free(ExtIndex);
+  free(BCIndex);
+}
+
+} // namespace scuff
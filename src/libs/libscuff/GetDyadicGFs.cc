@@ -36,6 +36,10 @@
 #include "libscuff.h"
 #include "libscuffInternals.h"
 
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
 #define II cdouble(0.0,1.0)
 
 namespace scuff {
@@ -192,4 +196,206 @@ void RWGGeometry::GetDyadicGFs(double XEval[3], double XSource[3],
    };
 }
 
+/***************************************************************/
+/* Batched computation of the scattering DGFs at many points.  */
+/*                                                             */
+/* The single-point routine above does 6 RHS assemblies, 6     */
+/* LU solves, and 6 field evaluations per point. Here we use   */
+/* reciprocity instead: if v(P) is the RHS vector for a point  */
+/* dipole P at X (as assembled by AssembleRHSVector), then the */
+/* scattered field at X due to a dipole Q at X satisfies       */
+/*                                                             */
+/*  P \cdot E^{scat}_Q(X) = C * v^T(P) M^{-1} v(Q)             */
+/*                                                             */
+/* with C = Z0^2 / (i\omega) for electric dipoles and          */
+/* C = -Z^2/(i\omega), Z^2 = Z0^2 * Mu/Eps, for the H field    */
+/* of magnetic dipoles. (Note the transpose, not the adjoint.) */
+/* Thus all points share a single multi-column LU solve, after */
+/* which each DGF component is just one dot product; no calls  */
+/* to GetFields are needed.                                    */
+/*                                                             */
+/* Inputs:                                                     */
+/*                                                             */
+/*  XMatrix: NX x 3 matrix of evaluation points                */
+/*                                                             */
+/*  Omega:   angular frequency                                 */
+/*                                                             */
+/*  M:       the LU-factorized BEM matrix                      */
+/*                                                             */
+/*  GMatrix: NX x 18 complex matrix (NX x 9 if ElectricOnly),  */
+/*           or NULL to allocate a new one                     */
+/*                                                             */
+/*  ElectricOnly: if true, only the electric DGF is computed,  */
+/*                which halves the number of RHS columns       */
+/*                                                             */
+/*  BlockSize: number of points handled by each multi-column   */
+/*             solve, or 0 for the default (see below)         */
+/*                                                             */
+/* On return, row nx of GMatrix contains GE[i][j] in column    */
+/* 3*i+j and (unless ElectricOnly) GM[i][j] in column 9+3*i+j  */
+/* for point #nx.                                              */
+/*                                                             */
+/* The workspace is two TotalBFs x (NCP*BlockSize) matrices    */
+/* (RHS and solution columns, NCP=3 if ElectricOnly, 6         */
+/* otherwise) of the same type as M. The default BlockSize is  */
+/* the largest for which each of them fits in DGF_BLOCK_BYTES, */
+/* i.e. at most 2*DGF_BLOCK_BYTES = 512 MB in total.           */
+/***************************************************************/
+#define DGF_BLOCK_BYTES (1<<28)
+
+// dot product (no conjugation) of column ca of A with column cb of B
+static cdouble ColumnDot(HMatrix *A, int ca, HMatrix *B, int cb)
+{
+  int N=A->NR;
+  if (A->RealComplex==LHM_REAL)
+   { double *a=A->DM + ((size_t)ca)*N, *b=B->DM + ((size_t)cb)*N;
+     double Sum=0.0;
+     for(int n=0; n<N; n++)
+      Sum += a[n]*b[n];
+     return Sum;
+   }
+  else
+   { cdouble *a=A->ZM + ((size_t)ca)*N, *b=B->ZM + ((size_t)cb)*N;
+     cdouble Sum=0.0;
+     for(int n=0; n<N; n++)
+      Sum += a[n]*b[n];
+     return Sum;
+   };
+}
+
+HMatrix *RWGGeometry::GetDyadicGFs(HMatrix *XMatrix, cdouble Omega,
+                                   HMatrix *M, HMatrix *GMatrix,
+                                   bool ElectricOnly, int BlockSize)
+{
+  if (M==0 || M->NR != TotalBFs || M->NC!=M->NR )
+   ErrExit("%s:%i: invalid M matrix passed to GetDyadicGFs()",__FILE__,__LINE__);
+
+  if (XMatrix==0 || XMatrix->NC!=3 || XMatrix->NR==0)
+   ErrExit("%s:%i: invalid XMatrix passed to GetDyadicGFs()",__FILE__,__LINE__);
+
+  // NumTypes = number of dipole types (electric, magnetic);
+  // each point has 3*NumTypes RHS columns and 9*NumTypes DGF entries
+  int NumTypes = ElectricOnly ? 1 : 2;
+  int NCP      = 3*NumTypes;
+
+  int NX=XMatrix->NR;
+  if (GMatrix && (GMatrix->NR!=NX || GMatrix->NC!=9*NumTypes) )
+   { Warn("wrong-sized GMatrix passed to GetDyadicGFs (reallocating)");
+     delete GMatrix;
+     GMatrix=0;
+   };
+  if (GMatrix==0)
+   GMatrix=new HMatrix(NX, 9*NumTypes, LHM_COMPLEX);
+
+  /***************************************************************/
+  /* choose the number of points per block ***********************/
+  /***************************************************************/
+  if (BlockSize<=0)
+   { size_t EntrySize = (M->RealComplex==LHM_REAL) ? sizeof(double) : sizeof(cdouble);
+     BlockSize = DGF_BLOCK_BYTES / (NCP*EntrySize*TotalBFs);
+     if (BlockSize<1) BlockSize=1;
+   };
+  if (BlockSize>NX) BlockSize=NX;
+
+  HMatrix *V = new HMatrix(TotalBFs, NCP*BlockSize, M->RealComplex);
+  HMatrix *W = new HMatrix(TotalBFs, NCP*BlockSize, M->RealComplex);
+  HVector *KN = new HVector(TotalBFs, M->RealComplex);
+
+  /***************************************************************/
+  /* prefactors for each point, which depend on the material     */
+  /* properties of the region containing the point               */
+  /***************************************************************/
+  cdouble *EFactor = new cdouble[NX];
+  cdouble *MFactor = new cdouble[NX];
+  for(int nx=0; nx<NX; nx++)
+   { double X[3];
+     X[0]=XMatrix->GetEntryD(nx,0);
+     X[1]=XMatrix->GetEntryD(nx,1);
+     X[2]=XMatrix->GetEntryD(nx,2);
+     cdouble Eps, Mu;
+     RegionMPs[GetRegionIndex(X)]->GetEpsMu(Omega, &Eps, &Mu);
+     cdouble k2 = Eps*Mu*Omega*Omega;
+     cdouble Z2 = ZVAC*ZVAC*Mu/Eps;
+     EFactor[nx] =      ZVAC*ZVAC / (II*Omega*k2);
+     MFactor[nx] = -1.0*Z2*Z2     / (II*Omega*k2);
+   };
+
+  /***************************************************************/
+  /* loop over blocks of points **********************************/
+  /***************************************************************/
+  cdouble P[3]={1.0, 0.0, 0.0};
+  double X0[3]={0.0, 0.0, 0.0};
+  PointSource PS(X0, P);
+  for(int nx0=0; nx0<NX; nx0+=BlockSize)
+   { 
+     int NB = (NX-nx0 < BlockSize) ? NX-nx0 : BlockSize;
+     Log("Computing DGFs at points %i--%i of %i...",nx0+1,nx0+NB,NX);
+
+     /*--------------------------------------------------------------*/
+     /*- assemble RHS vectors for electric and magnetic dipoles     -*/
+     /*- pointing in each cartesian direction at each point; the    -*/
+     /*- columns for point #nb are NCP*nb+(0,1,2) (electric) and    -*/
+     /*- NCP*nb+(3,4,5) (magnetic, absent if ElectricOnly).         -*/
+     /*--------------------------------------------------------------*/
+     V->Zero();
+     for(int nb=0; nb<NB; nb++)
+      { 
+        double X[3];
+        X[0]=XMatrix->GetEntryD(nx0+nb,0);
+        X[1]=XMatrix->GetEntryD(nx0+nb,1);
+        X[2]=XMatrix->GetEntryD(nx0+nb,2);
+        PS.SetX0(X);
+
+        for(int Type=0; Type<NumTypes; Type++)
+         { PS.SetType( Type==0 ? LIF_ELECTRIC_DIPOLE : LIF_MAGNETIC_DIPOLE );
+           for(int i=0; i<3; i++)
+            { memset(P, 0, 3*sizeof(cdouble));
+              P[i]=1.0;
+              PS.SetP(P);
+              AssembleRHSVector(Omega, &PS, KN);
+              int nc = NCP*nb + 3*Type + i;
+              for(int n=0; n<TotalBFs; n++)
+               V->SetEntry(n, nc, KN->GetEntry(n));
+            };
+         };
+      };
+
+     /*--------------------------------------------------------------*/
+     /*- one multi-column solve for the whole block (in the last    -*/
+     /*- block, any unused columns are zero and stay zero)          -*/
+     /*--------------------------------------------------------------*/
+     W->Copy(V);
+     M->LUSolve(W);
+
+     /*--------------------------------------------------------------*/
+     /*- DGF components are dot products of RHS and solution        -*/
+     /*- columns at the same point                                  -*/
+     /*--------------------------------------------------------------*/
+     int NumThreads;
+#ifndef USE_OPENMP
+     NumThreads=1;
+#else
+     NumThreads=GetNumThreads();
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+     for(int nb=0; nb<NB; nb++)
+      for(int Type=0; Type<NumTypes; Type++)
+       for(int i=0; i<3; i++)
+        for(int j=0; j<3; j++)
+         { int nx = nx0+nb;
+           cdouble Factor = (Type==0) ? EFactor[nx] : MFactor[nx];
+           cdouble G = Factor * ColumnDot(V, NCP*nb+3*Type+i, W, NCP*nb+3*Type+j);
+           GMatrix->SetEntry(nx, 9*Type + 3*i + j, G);
+         };
+   };
+
+  delete[] EFactor;
+  delete[] MFactor;
+  delete KN;
+  delete W;
+  delete V;
+
+  return GMatrix;
+}
+
 } // namespace scuff
@@ -286,11 +286,13 @@ typedef struct ThreadData
    HMatrix *XMatrix;
    HMatrix *FMatrix;
    HVector *KN;
-   IncField *IF;
    cdouble Omega;
    Interp3D **RegionInterpolators;
    ParsedFieldFunc **PFFuncs;
    int NumFuncs;
+   void *opFTC; // 'opaque pointer to field treecode'
+   int *Regions;
+   cdouble *EHInc;
 
  } ThreadData;
 
@@ -312,21 +314,23 @@ void *GetFields_Thread(void *data)
   HMatrix *XMatrix               = TD->XMatrix;
   HMatrix *FMatrix               = TD->FMatrix;
   HVector *KN                    = TD->KN;
-  IncField *IFList               = TD->IF;
   cdouble Omega                  = TD->Omega;
   Interp3D **RegionInterpolators = TD->RegionInterpolators;
   ParsedFieldFunc **PFFuncs      = TD->PFFuncs;
   int NumFuncs                   = TD->NumFuncs;
+  void *opFTC                    = TD->opFTC;
+  int *Regions                   = TD->Regions;
+  cdouble *EHInc                 = TD->EHInc;
+  void *FTCWorkspace             = opFTC ? CreateTreecodeWorkspace() : 0;
 
   /***************************************************************/
   /* other local variables ***************************************/
   /***************************************************************/
   double X[3];
   int RegionIndex;
-  cdouble EH[6], dEH[6];
+  cdouble EH[6];
   cdouble Eps, Mu;
   double dA[3]={1.0, 0.0, 0.0};
-  IncField *IF;
   Interp3D *GBarInterp;
 
   /***************************************************************/
@@ -345,7 +349,7 @@ void *GetFields_Thread(void *data)
 
      memset(EH, 0, 6*sizeof(cdouble));
 
-     RegionIndex = G->GetRegionIndex(X);
+     RegionIndex = Regions[nr];
      if (G->RegionMPs[RegionIndex]->IsPEC())
       continue;
 
@@ -356,20 +360,18 @@ void *GetFields_Thread(void *data)
      /*--------------------------------------------------------------*/
      /*- get scattered fields at X                                   */
      /*--------------------------------------------------------------*/
-     if (KN)
+     if (KN && opFTC)
+      GetTreecodeScatteredFields(opFTC, X, RegionIndex, EH, FTCWorkspace);
+     else if (KN)
       GetScatteredFields(G, X, RegionIndex, KN, Omega, GBarInterp, EH);
 
      /*--------------------------------------------------------------*/
-     /*- add incident fields by summing contributions of all        -*/
-     /*- IncFields whose sources lie in the same region as X        -*/
+     /*- add incident fields, i.e. the sum of the contributions of   -*/
+     /*- all IncFields whose sources lie in the same region as X     -*/
+     /*- (precomputed in batches by GetIncFieldsBatch())             -*/
      /*--------------------------------------------------------------*/
-     if (IFList)
-      { for(IF=IFList; IF; IF=IF->Next)
-         if ( IF->RegionIndex == RegionIndex )
-          { IF->GetFields(X, dEH);
-            SixVecPlusEquals(EH, 1.0, dEH);
-          };
-      };
+     if (EHInc)
+      SixVecPlusEquals(EH, 1.0, EHInc + 6*nr);
 
      /*--------------------------------------------------------------*/
      /*- compute field functions ------------------------------------*/
@@ -379,16 +381,78 @@ void *GetFields_Thread(void *data)
 
    }; // for (nr=0; nr<XMatrix->NR; nr++)
 
+  DestroyTreecodeWorkspace(FTCWorkspace);
+
   return 0;
 
 } 
 
+/***************************************************************/
+/* Evaluate the incident fields at all points in XMatrix.      */
+/* On return, EHInc[6*nr + 0..5] are the total fields at point */
+/* nr of all IncFields whose sources lie in region Regions[nr].*/
+/* The points are processed in blocks; within each block, the  */
+/* points lying in the source region of a given IncField are   */
+/* gathered and passed to GetFieldsBatch() in a single call.   */
+/***************************************************************/
+#define INCFIELD_BLOCKSIZE 1024
+static cdouble *GetIncFieldsBatch(IncField *IFList, HMatrix *XMatrix, int *Regions)
+{
+  int NX=XMatrix->NR;
+  cdouble *EHInc=(cdouble *)mallocEC(6*NX*sizeof(cdouble));
+  memset(EHInc, 0, 6*NX*sizeof(cdouble));
+
+  int NumBlocks = (NX + INCFIELD_BLOCKSIZE - 1) / INCFIELD_BLOCKSIZE;
+#ifdef USE_OPENMP
+  int NumThreads=GetNumThreads();
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+  for(int nb=0; nb<NumBlocks; nb++)
+   { 
+     int Start = nb*INCFIELD_BLOCKSIZE;
+     int Stop  = Start + INCFIELD_BLOCKSIZE;
+     if (Stop>NX) Stop=NX;
+
+     // per-block workspace (about 120 kB for 1024 points) lives on
+     // the heap rather than on the (possibly small) thread stacks
+     int *Indices = (int *)mallocEC(INCFIELD_BLOCKSIZE*sizeof(int));
+     double *X    = (double *)mallocEC(3*INCFIELD_BLOCKSIZE*sizeof(double));
+     cdouble *EH  = (cdouble *)mallocEC(6*INCFIELD_BLOCKSIZE*sizeof(cdouble));
+
+     for(IncField *IF=IFList; IF; IF=IF->Next)
+      { 
+        int NP=0;
+        for(int nr=Start; nr<Stop; nr++)
+         if ( Regions[nr]==IF->RegionIndex )
+          { Indices[NP]=nr;
+            X[3*NP + 0]=XMatrix->GetEntryD(nr,0);
+            X[3*NP + 1]=XMatrix->GetEntryD(nr,1);
+            X[3*NP + 2]=XMatrix->GetEntryD(nr,2);
+            NP++;
+          };
+        if (NP==0) continue;
+
+        IF->GetFieldsBatch(NP, X, EH);
+
+        for(int np=0; np<NP; np++)
+         SixVecPlusEquals(EHInc + 6*Indices[np], 1.0, EH + 6*np);
+      };
+
+     free(Indices);
+     free(X);
+     free(EH);
+   };
+
+  return EHInc;
+}
+
 /***************************************************************/
 /* set kBloch=NULL for non-PBC geometries **********************/
 /***************************************************************/
 HMatrix *RWGGeometry::GetFields(IncField *IF, HVector *KN, 
                                 cdouble Omega, double *kBloch, 
-                                HMatrix *XMatrix, HMatrix *FMatrix, char *FuncString)
+                                HMatrix *XMatrix, HMatrix *FMatrix, char *FuncString,
+                                int *RegionsOut)
 { 
   int NumThreads = GetNumThreads();
  
@@ -451,6 +515,31 @@ if (FMatrix==0)
        RegionInterpolators[nr]=CreateRegionInterpolator(nr, Omega, kBloch, XMatrix);
    };
 
+  /***************************************************************/
+  /* for large numbers of evaluation points in non-periodic      */
+  /* geometries, the user may request that the scattered fields  */
+  /* be computed by a treecode (see FieldTreecode.cc) instead of */
+  /* by summing the contributions of all basis functions.        */
+  /***************************************************************/
+  void *opFTC=0;
+  if ( KN && LDim==0 && TreecodeTolerance>0.0 && XMatrix->NR>=TreecodeMinPoints )
+   opFTC=CreateFieldTreecode(this, KN, Omega, TreecodeTolerance);
+
+  /***************************************************************/
+  /* classify all evaluation points at once; this is much faster */
+  /* than calling GetRegionIndex() separately for each point     */
+  /* (see PointInObject.cc). if the caller asked for the region  */
+  /* indices we store them directly in the caller's array.       */
+  /***************************************************************/
+  int *Regions = RegionsOut ? RegionsOut : (int *)mallocEC(XMatrix->NR*sizeof(int));
+  GetRegionIndices(XMatrix, Regions);
+
+  /***************************************************************/
+  /* evaluate incident fields at all points using the batched    */
+  /* IncField::GetFieldsBatch() routine                          */
+  /***************************************************************/
+  cdouble *EHInc = IF ? GetIncFieldsBatch(IF, XMatrix, Regions) : 0;
+
   /***************************************************************/
   /* fire off threads                                            */
   /***************************************************************/
@@ -467,11 +556,13 @@ if (FMatrix==0)
   ReferenceTD.XMatrix = XMatrix;
   ReferenceTD.FMatrix = FMatrix;
   ReferenceTD.KN=KN;
-  ReferenceTD.IF=IF;
   ReferenceTD.Omega=Omega;
   ReferenceTD.RegionInterpolators=RegionInterpolators;
   ReferenceTD.PFFuncs=PFFuncs;
   ReferenceTD.NumFuncs=NumFuncs;
+  ReferenceTD.opFTC=opFTC;
+  ReferenceTD.Regions=Regions;
+  ReferenceTD.EHInc=EHInc;
 
 #ifdef USE_PTHREAD
   ThreadData *TDs = new ThreadData[NumThreads], *TD;
@@ -514,6 +605,8 @@ if (FMatrix==0)
   /* deallocate temporary storage ********************************/
   /***************************************************************/
   free(FCopy);
+  if (Regions!=RegionsOut) free(Regions);
+  if (EHInc) free(EHInc);
   for(nf=0; nf<NumFuncs; nf++)
    delete PFFuncs[nf];
   delete[] PFFuncs;
@@ -525,6 +618,9 @@ if (FMatrix==0)
      free(RegionInterpolators);
    };
 
+  if (opFTC)
+   DestroyFieldTreecode(opFTC);
+
   return FMatrix;
 
 }
@@ -60,11 +60,20 @@ using namespace scuff;
 /* is the projection of the given basis function onto the      */
 /* M-type spherical wave with spherical wave indices l,m       */
 /* such that Alpha=l^2 + l + m.                                */
+/*                                                             */
+/* The spherical waves are centered at X0 (or at the origin if */
+/* X0 is NULL). If Conjugate is false, the projections are     */
+/* computed with M and N themselves instead of their complex   */
+/* conjugates; these are analytic in k, which is what is       */
+/* needed at imaginary frequencies.                            */
 /***************************************************************/
+namespace scuff {
+
 void GetMNProjections(RWGSurface *S, int ne, cdouble k, int lMax,
                       cdouble *MArray, cdouble *NArray, 
                       double *Workspace,
-                      cdouble *MProjections, cdouble *NProjections)
+                      cdouble *MProjections, cdouble *NProjections,
+                      const double *X0, bool Conjugate)
 {
   int NAlpha = (lMax+1)*(lMax+1);
   memset(MProjections, 0, NAlpha*sizeof(cdouble));
@@ -86,12 +95,13 @@ void GetMNProjections(RWGSurface *S, int ne, cdouble k, int lMax,
   double *V2    = S->Vertices + 3*(E->iV2);
   double *QM    = (E->iQM == -1) ? 0 : S->Vertices + 3*(E->iQM);
 
-  double AP[3], BP[3], AM[3], BM[3];
+  double AP[3], BP[3], AM[3], BM[3], XC[3]={0.0, 0.0, 0.0};
   for(int Mu=0; Mu<3; Mu++)
    { AP[Mu] = V1[Mu] - QP[Mu];
      BP[Mu] = V2[Mu] - QP[Mu];
-     AM[Mu] = V1[Mu] - QM[Mu];
-     BM[Mu] = V2[Mu] - QM[Mu];
+     AM[Mu] = QM ? V1[Mu] - QM[Mu] : 0.0;
+     BM[Mu] = QM ? V2[Mu] - QM[Mu] : 0.0;
+     if (X0) XC[Mu] = X0[Mu];
    };
 
   /***************************************************************/
@@ -111,7 +121,7 @@ void GetMNProjections(RWGSurface *S, int ne, cdouble k, int lMax,
      /*--------------------------------------------------------------*/
      for(int Mu=0; Mu<3; Mu++)
       { XmQ[Mu] = u*AP[Mu] + v*BP[Mu];
-          X[Mu] = XmQ[Mu] + QP[Mu];
+          X[Mu] = XmQ[Mu] + QP[Mu] - XC[Mu];
       };
      CoordinateC2S(X,&r,&Theta,&Phi);
      VectorC2S(Theta,Phi,XmQ,FS);
@@ -134,7 +144,7 @@ void GetMNProjections(RWGSurface *S, int ne, cdouble k, int lMax,
      /*--------------------------------------------------------------*/
      for(int Mu=0; Mu<3; Mu++)
       { XmQ[Mu] = u*AM[Mu] + v*BM[Mu];
-          X[Mu] = XmQ[Mu] + QM[Mu];
+          X[Mu] = XmQ[Mu] + QM[Mu] - XC[Mu];
       };
      CoordinateC2S(X,&r,&Theta,&Phi);
      VectorC2S(Theta,Phi,XmQ,FS);
@@ -159,12 +169,14 @@ void GetMNProjections(RWGSurface *S, int ne, cdouble k, int lMax,
   /* M and N.                                                    */
   /***************************************************************/
   for(int Alpha=0; Alpha<NAlpha; Alpha++)
-   { MProjections[Alpha] = Length * conj(MProjections[Alpha]);
-     NProjections[Alpha] = Length * conj(NProjections[Alpha]);
+   { MProjections[Alpha] = Length * (Conjugate ? conj(MProjections[Alpha]) : MProjections[Alpha]);
+     NProjections[Alpha] = Length * (Conjugate ? conj(NProjections[Alpha]) : NProjections[Alpha]);
    };
 
 }
 
+} // namespace scuff
+
 /***************************************************************/
 /* thread routine for GetSphericalMoments **********************/
 /***************************************************************/
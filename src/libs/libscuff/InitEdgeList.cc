@@ -34,48 +34,237 @@
 #include <string.h>
 #include <math.h>
 
+#include <libhrutil.h>
+
 #include "libscuff.h"
 
 namespace scuff {
 
+/***************************************************************/
+/* a 'half-edge' is one of the three edges of one panel; an    */
+/* interior edge of the surface is shared by two half-edges,   */
+/* an exterior edge belongs to just one.                       */
+/***************************************************************/
+typedef struct HalfEdge
+ { int iVGreater;   // greater of the two vertex indices
+   int Slot;        // 3*(panel index) + (index of edge within panel)
+ } HalfEdge;
+
+/***************************************************************/
+/* initialize the fields of E that are determined by the first */
+/* panel in which the edge appears                             */
+/***************************************************************/
+static void InitEdgeFromPPanel(RWGSurface *S, RWGEdge *E, int Slot)
+{ 
+  RWGPanel *P=S->Panels[Slot/3];
+  int ne=Slot%3;
+
+  E->iV1=P->VI[ne];
+  E->iV2=P->VI[(ne+1)%3];
+  if (E->iV1 > E->iV2)
+   { E->iV1=P->VI[(ne+1)%3];
+     E->iV2=P->VI[ne];
+   };
+  E->iQP=P->VI[ (ne+2)%3 ];
+  E->iQM=-1;
+
+  double *V1=S->Vertices + 3*E->iV1;
+  double *V2=S->Vertices + 3*E->iV2;
+  for(int i=0; i<3; i++)
+   E->Centroid[i]=(V1[i] + V2[i]) / 2.0;
+  E->Length=VecDistance(V1, V2);
+
+  E->iPPanel=P->Index;
+  E->PIndex=(ne+2)%3;
+
+  E->iMPanel=-1;
+  E->MIndex=(ne+2)%3;
+  E->Next=0;
+
+  /* bounding radius is max distance from centroid to any vertex */
+  E->Radius=VecDistance(E->Centroid, S->Vertices+3*E->iQP);
+  E->Radius=fmax(E->Radius, VecDistance(E->Centroid,V1));
+  E->Radius=fmax(E->Radius, VecDistance(E->Centroid,V2));
+}
+
 /***************************************************************/
 /* InitEdgeList: After reading in a set of panels, we call     */
 /* this function to extract all necessary information          */
 /* regarding interior edges, exterior edges, boundary contours,*/
 /* etc.                                                        */
+/*                                                             */
+/* The edges are identified by sorting the half-edges by       */
+/* vertex pair: a counting sort on the lesser vertex index     */
+/* followed by a sort of each (small) bucket on the greater    */
+/* vertex index. The RWGEdge structures are stored            */
+/* contiguously in EdgeBlock, interior edges first.            */
+/*                                                             */
+/* The numbering is the same as that produced by the original  */
+/* linked-list implementation of this routine:                 */
+/*  -- interior edges are numbered in the order in which their */
+/*     second panel appears in the Panels array               */
+/*  -- exterior edges are ordered by lesser vertex index and,  */
+/*     for a given lesser vertex, by decreasing panel index.   */
 /***************************************************************/
 void RWGSurface::InitEdgeList()
 { 
-  RWGPanel *P; 
   RWGEdge *E, ***EVEdges, *BCEdgeList;
-  int i, np, ne, nv, nvp, iVLesser, iVGreater;
+  int np, ne, nv, nvp;
   int NumExteriorVertices, NumUnusedVertices;
   int *VertexUsed;
-  double *VLesser, *VGreater;
   int *EVNumEdges;
   char *MFN=MeshFileName;
-  RWGEdge **EdgeLists;
 
-  /***************************************************************/
-  /***************************************************************/
-  /*- allocate temporary storage arrays  *************************/
-  /***************************************************************/
-  /***************************************************************/
+  /*--------------------------------------------------------------*/
+  /*- bucket the half-edges by lesser vertex index. since we     -*/
+  /*- fill the buckets in order of increasing slot, the half-    -*/
+  /*- edges within each bucket are in order of increasing slot.  -*/
+  /*- bucket #nv is HalfEdges[ BucketStart[nv] ... ]            -*/
+  /*-                  ...   [ BucketStart[nv+1]-1 ]             -*/
+  /*- VertexUsed[nv] = 1 if vertex # nv is a vertex of any panel -*/
+  /*- on the surface. (Used below in the determination of the    -*/
+  /*- number of "interior" vertices.)                            -*/
+  /*--------------------------------------------------------------*/
+  int NumHalfEdges=3*NumPanels;
+  int *BucketStart=(int *)mallocEC((NumVertices+2)*sizeof(int));
+  memset(BucketStart,0,(NumVertices+2)*sizeof(int));
+  VertexUsed=(int *)mallocEC(NumVertices*sizeof(int));
+  memset(VertexUsed,0,NumVertices*sizeof(int));
+  for(np=0; np<NumPanels; np++)
+   for(ne=0; ne<3; ne++)
+    { int iV1=Panels[np]->VI[ne], iV2=Panels[np]->VI[(ne+1)%3];
+      if (iV1<0 || iV1>=NumVertices)
+       ErrExit("%s: panel %i: invalid vertex index %i",MFN,np,iV1);
+      BucketStart[ (iV1<iV2 ? iV1 : iV2) + 2 ]++;
+      VertexUsed[iV1]=1;
+    };
+  for(nv=2; nv<=NumVertices+1; nv++)
+   BucketStart[nv]+=BucketStart[nv-1];
+
+  HalfEdge *HalfEdges=(HalfEdge *)mallocEC((NumHalfEdges+1)*sizeof(HalfEdge));
+  for(int Slot=0; Slot<NumHalfEdges; Slot++)
+   { RWGPanel *P=Panels[Slot/3];
+     int iV1=P->VI[Slot%3], iV2=P->VI[(Slot+1)%3];
+     int iVLesser = (iV1<iV2) ? iV1 : iV2;
+     int n = BucketStart[iVLesser+1]++;
+     HalfEdges[n].iVGreater = (iV1<iV2) ? iV2 : iV1;
+     HalfEdges[n].Slot = Slot;
+   };
+  // now BucketStart[nv] is the start of bucket #nv
 
   /*--------------------------------------------------------------*/
-  /*- EdgeList[nv] is a linked list of all Edge structures for   -*/
-  /*- which the lesser-numbered of the two vertex indices is nv. -*/
+  /*- stable insertion sort of each bucket on iVGreater; buckets -*/
+  /*- contain only a handful of half-edges.                      -*/
   /*--------------------------------------------------------------*/
-  EdgeLists=(RWGEdge **)mallocEC(NumVertices*sizeof(RWGEdge *));
-  memset(EdgeLists,0,NumVertices*sizeof(RWGEdge*));
+#ifdef USE_OPENMP
+  int NumThreads=GetNumThreads();
+#pragma omp parallel for schedule(static), num_threads(NumThreads)
+#endif
+  for(nv=0; nv<NumVertices; nv++)
+   for(int n=BucketStart[nv]+1; n<BucketStart[nv+1]; n++)
+    { HalfEdge HE=HalfEdges[n];
+      int m=n-1;
+      for(; m>=BucketStart[nv] && HalfEdges[m].iVGreater > HE.iVGreater; m--)
+       HalfEdges[m+1]=HalfEdges[m];
+      HalfEdges[m+1]=HE;
+    };
 
   /*--------------------------------------------------------------*/
-  /*- VertexUsed[nv] = 1 if vertex # nv is a vertex of any panel  */
-  /*- on the surface. (Used below in the determination of the     */
-  /*- number of "interior" vertices.)                             */
+  /*- a run of equal iVGreater within a bucket is one edge: a run -*/
+  /*- of length 2 is an interior edge, a run of length 1 an      -*/
+  /*- exterior edge.                                              -*/
+  /*- SecondSlot[s] = position in HalfEdges of the first half of -*/
+  /*-                 the interior edge whose second half-edge is-*/
+  /*-                 slot s, or -1.                              -*/
+  /*- ExteriorOrder[k] = position in HalfEdges of the kth         -*/
+  /*-                    exterior edge.                           -*/
   /*--------------------------------------------------------------*/
-  VertexUsed=(int *)mallocEC(NumVertices*sizeof(int));
-  memset(VertexUsed,0,NumVertices*sizeof(int));
+  int *SecondSlot=(int *)mallocEC((NumHalfEdges+1)*sizeof(int));
+  for(int Slot=0; Slot<NumHalfEdges; Slot++)
+   SecondSlot[Slot]=-1;
+  int *ExteriorOrder=(int *)mallocEC((NumHalfEdges+1)*sizeof(int));
+  NumEdges=NumExteriorEdges=0;
+  int BadRun=-1;
+  for(nv=0; nv<NumVertices; nv++)
+   { 
+     int FirstExterior=NumExteriorEdges;
+     int Stop=BucketStart[nv+1];
+     for(int n=BucketStart[nv], nn; n<Stop; n=nn)
+      { 
+        for(nn=n+1; nn<Stop && HalfEdges[nn].iVGreater==HalfEdges[n].iVGreater; nn++)
+         ;
+        if (nn-n > 2)
+         { // report the offending half-edge that comes first in panel order
+           if (BadRun==-1 || HalfEdges[n+2].Slot < HalfEdges[BadRun+2].Slot)
+            BadRun=n;
+         }
+        else if (nn-n == 2)
+         { SecondSlot[ HalfEdges[n+1].Slot ] = n;
+           NumEdges++;
+         }
+        else
+         { // exterior edges with a given lesser vertex go in order of decreasing slot
+           int k=NumExteriorEdges++;
+           for(; k>FirstExterior && HalfEdges[ExteriorOrder[k-1]].Slot < HalfEdges[n].Slot; k--)
+            ExteriorOrder[k]=ExteriorOrder[k-1];
+           ExteriorOrder[k]=n;
+         };
+      };
+   };
+  if (BadRun!=-1)
+   ErrExit("%s: invalid mesh topology: edge %i of panel %i also belongs to panels %i and %i ",
+           MFN,HalfEdges[BadRun+2].Slot%3,HalfEdges[BadRun+2].Slot/3,
+           HalfEdges[BadRun].Slot/3,HalfEdges[BadRun+1].Slot/3);
+  NumTotalEdges=NumEdges + NumExteriorEdges;
+
+  int *InteriorOrder=(int *)mallocEC((NumEdges+1)*sizeof(int));
+  for(int Slot=0, nie=0; Slot<NumHalfEdges; Slot++)
+   if (SecondSlot[Slot]!=-1)
+    InteriorOrder[nie++]=SecondSlot[Slot];
+
+  /*--------------------------------------------------------------*/
+  /*- fill in the RWGEdge structures: interior edges first, then -*/
+  /*- exterior edges. note that the Index field of the RWGEdge   -*/
+  /*- struct for an exterior edge is set to -(i+1), where i is   -*/
+  /*- the index of the edge in the ExteriorEdges array. (thus the-*/
+  /*- first exterior edge has Index=-1, the second has Index=-2, -*/
+  /*- etc.)                                                      -*/
+  /*--------------------------------------------------------------*/
+  EdgeBlock=(RWGEdge *)mallocEC((NumTotalEdges+1)*sizeof(RWGEdge));
+  Edges=(RWGEdge **)mallocEC((NumEdges+1)*sizeof(Edges[0]));
+  ExteriorEdges=(RWGEdge **)mallocEC((NumExteriorEdges+1)*sizeof(Edges[0]));
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(static), num_threads(NumThreads)
+#endif
+  for(int nt=0; nt<NumTotalEdges; nt++)
+   { 
+     RWGEdge *E=EdgeBlock + nt;
+     if (nt<NumEdges)
+      { int n=InteriorOrder[nt];
+        InitEdgeFromPPanel(this, E, HalfEdges[n].Slot);
+
+        RWGPanel *P=Panels[ HalfEdges[n+1].Slot / 3 ];
+        int nem=HalfEdges[n+1].Slot % 3;
+        E->iQM=P->VI[(nem+2)%3];
+        E->iMPanel=P->Index;
+        E->MIndex=(nem+2)%3;
+        E->Index=nt;
+        E->Radius=fmax(E->Radius, VecDistance(E->Centroid,Vertices+3*E->iQM));
+        Edges[nt]=E;
+      }
+     else
+      { int k=nt-NumEdges;
+        InitEdgeFromPPanel(this, E, HalfEdges[ExteriorOrder[k]].Slot);
+        E->Index=-(k+1);
+        ExteriorEdges[k]=E;
+      };
+   };
+
+  free(BucketStart);
+  free(HalfEdges);
+  free(SecondSlot);
+  free(ExteriorOrder);
+  free(InteriorOrder);
 
   /*--------------------------------------------------------------*/
   /*- EVNumEdges[nv] is the number of exterior edges connected to */
@@ -85,168 +274,25 @@ void RWGSurface::InitEdgeList()
   /*- RWGEdge structures connected to vertex nv (again only       */
   /*- used for nv=exterior vertex)                                */
   /*--------------------------------------------------------------*/
-  EVNumEdges=(int *)mallocEC(NumVertices*sizeof(RWGEdge));
+  EVNumEdges=(int *)mallocEC(NumVertices*sizeof(int));
   memset(EVNumEdges,0,NumVertices*sizeof(int));
   EVEdges=(RWGEdge ***)mallocEC(NumVertices*sizeof(RWGEdge **));
   EVEdges[0]=(RWGEdge **)mallocEC(2*NumVertices*sizeof(RWGEdge *)); 
   for(nv=1; nv<NumVertices; nv++)
    EVEdges[nv]=EVEdges[nv-1]+2;
 
-  /****************************************************************/
-  /* construct a list of RWGEdge structures by going over every   */
-  /* edge of every triangular panel:                              */ 
-  /*                                                              */
-  /*  a. if the edge does not exist in the list (we have not      */
-  /*     visited this edge before) then add it to the list        */
-  /*  b. if the edge does exist in the list, then we are visiting */
-  /*     it for the second time, so it is an interior edge, and   */
-  /*     we mark it as such.                                      */
-  /*  c. if we find ourselves visiting an edge more than two      */
-  /*     times then the topology of the panel set is defective.   */
-  /*                                                              */
-  /* note that when we first create a new RWGEdge structure for an*/
-  /* edge, we assign the panel it came from as its 'positive'     */
-  /* panel, but we don't yet assign it an 'Index' in the overall  */
-  /* problem, because it may turn out to be an exterior edge. we  */
-  /* also set the iQM, iMPanel, and MIndex fields to -1 in view   */
-  /* of this possibility.                                         */
-  /*                                                              */
-  /* if we subsequently come across the edge for the second time  */
-  /* (because it turned out to be attached to a second panel)     */
-  /* we call this second panel the 'negative' panel associated to */
-  /* the edge, and now we do assign an Index to the edge, as well */
-  /* as fill in its iQM, iMPanel, and MIndex fields.              */
-  /*                                                              */
-  /* thus, at the conclusion of this loop, any Edge structure that*/
-  /* still has Index==-1 is an exterior edge. such a structure    */
-  /* will have valid data stored for its iV1, iV2, iQP, PPanel,   */
-  /* iPPanel, and PIndex fields, but not its iQM, MPanel, iMPanel,*/
-  /* or MIndex fields.                                            */
-  /****************************************************************/
-  NumEdges=NumTotalEdges=0;
-  for(np=0; np<NumPanels; np++)
-   for(ne=0; ne<3; ne++)   /* loop over panel edges */
-    { 
-      P=Panels[np];
-
-      /***************************************************************/
-      /* get lesser & greater of the two vertex indices for this edge*/
-      /***************************************************************/
-      iVLesser=P->VI[ne];
-      iVGreater=P->VI[(ne+1)%3];
-      if ( iVLesser > iVGreater ) 
-       { iVLesser=P->VI[(ne+1)%3];
-         iVGreater=P->VI[ne];
-       };
-
-      VertexUsed[iVLesser]=VertexUsed[iVGreater]=1;
-
-      /**********************************************************************/
-      /* look for this edge in list of edges connected to vertex # iVLesser */
-      /**********************************************************************/
-      for(E=EdgeLists[iVLesser]; E; E=E->Next)
-       if (E->iV2==iVGreater) 
-        break;
-      
-      if ( E )
-       { 
-         /***************************************************************/
-         /* we have encountered this edge twice before ******************/
-         /***************************************************************/
-         if ( E->iMPanel != -1 )
-          ErrExit("%s: invalid mesh topology: edge %i of panel %i also belongs to panels %i and %i ",
-                      MFN,ne,np,E->iPPanel,E->iMPanel);
-
-         /***************************************************************/
-         /* we have encountered this edge once before                   */
-         /***************************************************************/
-         E->iQM=P->VI[(ne+2)%3];
-
-         E->iMPanel=P->Index;
-         E->MIndex=(ne+2)%3;
-
-         E->Index=NumEdges++;
-
-         /* bounding radius is max distance from centroid to any vertex */
-         E->Radius=VecDistance(E->Centroid, Vertices+3*E->iQP);
-         E->Radius=fmax(E->Radius, VecDistance(E->Centroid,Vertices+3*E->iQM));
-         E->Radius=fmax(E->Radius, VecDistance(E->Centroid,Vertices+3*E->iV1));
-         E->Radius=fmax(E->Radius, VecDistance(E->Centroid,Vertices+3*E->iV2));
-
-       }
-      else
-       { 
-         /******************************************************************/
-         /* we are encountering this edge for the first time. create a     */ 
-         /* new RWGEdge structure for this edge and chain it in to the     */
-         /* linked list of RWGEdge structures connected to vrtx #iVLesser  */
-         /******************************************************************/
-         NumTotalEdges++;
-         E=(RWGEdge *)mallocEC(sizeof *E);
-         E->Next=EdgeLists[iVLesser];
-         EdgeLists[iVLesser]=E;
-
-         E->iV1=iVLesser;
-         E->iV2=iVGreater;
-         E->iQP=P->VI[ (ne+2)%3 ];
-         E->iQM=-1;
-
-	 VLesser=Vertices + 3*iVLesser;
-         VGreater=Vertices + 3*iVGreater;
-         for(i=0; i<3; i++)
-          E->Centroid[i]=(VLesser[i] + VGreater[i]) / 2.0;
-         E->Length=VecDistance(VLesser, VGreater);
-
-         E->iPPanel=P->Index;
-         E->PIndex=(ne+2)%3;
-
-         E->iMPanel=-1;
-         E->Index=-1;
-         E->MIndex=(ne+2)%3;
-       };
-    };
+  for(int k=0; k<NumExteriorEdges; k++)
+   { 
+     E=ExteriorEdges[k];
 
-  /*--------------------------------------------------------------*/
-  /*- now go back through our list of all edges:                  */
-  /*-  a. put each RWGEdge structure corresponding to an interior */ 
-  /*      edge into the Edges array.                              */
-  /*-  b. put each RWGEdge structure corresponding to an exterior */ 
-  /*      edge into ExteriorEdges array and also into the EVEdges */
-  /*      lists for the edge's 2 vertices.                        */
-  /*      note that the Index field of the RWGEdge struct         */
-  /*      for an exterior edge is set to -(i+1), where i is the   */
-  /*      index of the edge in the ExteriorEdges array. (thus the */
-  /*      first exterior edge has Index=-1, the second has        */
-  /*      Index=-2, etc.)                                         */
-  /*--------------------------------------------------------------*/
-  Edges=(RWGEdge **)mallocEC(NumEdges*sizeof(Edges[0]));
-  ExteriorEdges=(RWGEdge **)mallocEC((NumTotalEdges-NumEdges)*sizeof(Edges[0]));
-  NumExteriorEdges=0;
-  NumExteriorVertices=0;
-  for(nv=0; nv<NumVertices; nv++)
-   for(E=EdgeLists[nv]; E; E=E->Next)
-    { 
-      if (E->Index==-1)  /* E is an exterior edge */
-       { 
-         ExteriorEdges[NumExteriorEdges]=E;
-         E->Index=-(NumExteriorEdges+1);
-         NumExteriorEdges++;
-
-         if (EVNumEdges[E->iV1]==2) 
-          ErrExit("%s: invalid mesh topology: vertex %i",MFN,E->iV1);
-         EVEdges[E->iV1][ EVNumEdges[E->iV1]++ ] = E;
-
-         if (EVNumEdges[E->iV2]==2) 
-          ErrExit("%s: invalid mesh topology: vertex %i",MFN,E->iV2);
-         EVEdges[E->iV2][ EVNumEdges[E->iV2]++ ] = E;
-
-         NumExteriorVertices++;
-       }
-      else               /* E is an interior edge */
-       Edges[E->Index]=E;
-    };
-  if ( (NumExteriorEdges+NumEdges) != NumTotalEdges )
-   ErrExit("%s:%i: internal error (%i!=%i)",__FILE__,__LINE__,NumExteriorEdges,NumTotalEdges-NumEdges);
+     if (EVNumEdges[E->iV1]==2) 
+      ErrExit("%s: invalid mesh topology: vertex %i",MFN,E->iV1);
+     EVEdges[E->iV1][ EVNumEdges[E->iV1]++ ] = E;
+
+     if (EVNumEdges[E->iV2]==2) 
+      ErrExit("%s: invalid mesh topology: vertex %i",MFN,E->iV2);
+     EVEdges[E->iV2][ EVNumEdges[E->iV2]++ ] = E;
+   };
 
   /*--------------------------------------------------------------*/
   /*- now go through and classify exterior boundary contours     -*/
@@ -362,7 +408,6 @@ void RWGSurface::InitEdgeList()
   /*--------------------------------------------------------------*/
   /*- deallocate temporary storage -------------------------------*/
   /*--------------------------------------------------------------*/
-  free(EdgeLists);
   free(VertexUsed);
   free(EVNumEdges);
   free(EVEdges[0]);
@@ -0,0 +1,288 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * MeshFileBuffer.cc -- parsing core shared by the mesh-file readers
+ *                   -- (ReadGMSHFile.cc, ReadComsolFile.cc)
+ *
+ * how it works:
+ *
+ *  (a) the whole mesh file is memory-mapped (or, for non-regular
+ *      files or files whose size is an exact multiple of the page
+ *      size, read into memory) so that its contents are available
+ *      as a single NUL-terminated buffer. (for a mapped file whose
+ *      size is not a multiple of the page size, the remainder of
+ *      the last page is guaranteed to be zero-filled, which gives
+ *      us the terminating NUL for free.)
+ *
+ *  (b) section headers and other short lines are read one at a
+ *      time with GetMeshLine(); binary data are copied out with
+ *      ReadMeshBytes().
+ *
+ *  (c) for long runs of ASCII lines with a fixed meaning (one node
+ *      or element per line), ParseMeshLines() first locates the
+ *      start of each line in a quick serial pass and then calls a
+ *      user-supplied parser on all lines in parallel.
+ *
+ *  the ScanInt / ScanDouble helpers never read past the end of the
+ *  current line, so a line with too few fields is detected as an
+ *  error instead of silently consuming fields from the next line.
+ *  there is no limit on the length of a line.
+ *
+ * agent         -- 10/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include <libhrutil.h>
+
+#include "libscuff.h"
+#include "libscuffInternals.h"
+
+namespace scuff {
+
+/***************************************************************/
+/* read the full contents of f into a malloc'ed, NUL-terminated*/
+/* buffer.                                                     */
+/***************************************************************/
+static char *SlurpFile(FILE *f, size_t *pSize)
+{
+  size_t Size=0, Alloc=1<<20;
+  char *Data=(char *)mallocEC(Alloc+1);
+  size_t NRead;
+  rewind(f);
+  while( (NRead=fread(Data+Size, 1, Alloc-Size, f)) > 0 )
+   { Size+=NRead;
+     if (Size==Alloc)
+      { Alloc*=2;
+        Data=(char *)realloc(Data, Alloc+1);
+        if (!Data)
+         ErrExit("out of memory");
+      };
+   };
+  Data[Size]=0;
+  *pSize=Size;
+  return Data;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+MeshFileBuffer *OpenMeshFileBuffer(FILE *f, const char *FileName)
+{
+  MeshFileBuffer *MFB=(MeshFileBuffer *)mallocEC(sizeof(MeshFileBuffer));
+  MFB->FileName=FileName;
+  MFB->Pos=0;
+  MFB->LineNum=0;
+  MFB->Mapped=false;
+  MFB->Data=0;
+  MFB->Size=0;
+
+  struct stat FileInfo;
+  long PageSize=sysconf(_SC_PAGESIZE);
+  if (    fstat(fileno(f), &FileInfo)==0
+       && S_ISREG(FileInfo.st_mode)
+       && FileInfo.st_size>0
+       && PageSize>0
+       && (FileInfo.st_size % PageSize)!=0
+     )
+   { void *Map=mmap(0, FileInfo.st_size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+     if (Map!=MAP_FAILED)
+      { MFB->Data=(char *)Map;
+        MFB->Size=FileInfo.st_size;
+        MFB->Mapped=true;
+      };
+   };
+
+  if (!MFB->Mapped)
+   MFB->Data=SlurpFile(f, &(MFB->Size));
+
+  return MFB;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+void CloseMeshFileBuffer(MeshFileBuffer *MFB)
+{
+  if (MFB->Mapped)
+   munmap(MFB->Data, MFB->Size);
+  else
+   free(MFB->Data);
+  free(MFB);
+}
+
+/***************************************************************/
+/* return a pointer to the start of the next line in the       */
+/* buffer and advance past it, or NULL at end of file. the     */
+/* line is terminated by '\n' (or by the terminating NUL).     */
+/***************************************************************/
+const char *GetMeshLine(MeshFileBuffer *MFB)
+{
+  if (MFB->Pos>=MFB->Size)
+   return 0;
+
+  const char *Line=MFB->Data + MFB->Pos;
+  const char *EOL=(const char *)memchr(Line, '\n', MFB->Size - MFB->Pos);
+  MFB->Pos = EOL ? (EOL - MFB->Data) + 1 : MFB->Size;
+  MFB->LineNum++;
+  return Line;
+}
+
+/***************************************************************/
+/* true if Line begins with Keyword followed by whitespace or  */
+/* end of line.                                                */
+/***************************************************************/
+bool MeshLineIs(const char *Line, const char *Keyword)
+{
+  size_t Len=strlen(Keyword);
+  if (strncmp(Line, Keyword, Len))
+   return false;
+  char c=Line[Len];
+  return (c==0 || c=='\n' || c=='\r' || c==' ' || c=='\t');
+}
+
+/***************************************************************/
+/* true if the line beginning at Line contains SearchString.   */
+/***************************************************************/
+bool MeshLineContains(const char *Line, const char *SearchString)
+{
+  size_t Len=strlen(SearchString);
+  for(const char *p=Line; *p && *p!='\n'; p++)
+   if ( *p==*SearchString && !strncmp(p, SearchString, Len) )
+    return true;
+  return false;
+}
+
+/***************************************************************/
+/* read lines until one is found that contains SearchString.   */
+/* returns that line, or NULL if the file ended first.         */
+/***************************************************************/
+const char *SkipToMeshLine(MeshFileBuffer *MFB, const char *SearchString)
+{
+  const char *Line;
+  while( (Line=GetMeshLine(MFB)) )
+   if ( MeshLineContains(Line, SearchString) )
+    return Line;
+  return 0;
+}
+
+/***************************************************************/
+/* copy N bytes of binary data out of the buffer.              */
+/***************************************************************/
+bool ReadMeshBytes(MeshFileBuffer *MFB, void *Dest, size_t N)
+{
+  if ( MFB->Pos + N > MFB->Size )
+   return false;
+  if (Dest)
+   memcpy(Dest, MFB->Data + MFB->Pos, N);
+  MFB->Pos+=N;
+  return true;
+}
+
+/***************************************************************/
+/* parse an integer or double at *p, skipping leading blanks   */
+/* but never advancing past the end of the line.               */
+/***************************************************************/
+static const char *SkipBlanks(const char *p)
+{ while( *p==' ' || *p=='\t' || *p=='\r' ) p++;
+  return p;
+}
+
+bool ScanInt(const char **p, long *Value)
+{
+  const char *Start=SkipBlanks(*p);
+  if (*Start=='\n' || *Start==0) return false;
+  char *End;
+  *Value=strtol(Start, &End, 10);
+  if (End==Start) return false;
+  *p=End;
+  return true;
+}
+
+bool ScanInt(const char **p, int *Value)
+{ long L;
+  if (!ScanInt(p, &L)) return false;
+  *Value=(int)L;
+  return true;
+}
+
+bool ScanDouble(const char **p, double *Value)
+{
+  const char *Start=SkipBlanks(*p);
+  if (*Start=='\n' || *Start==0) return false;
+  char *End;
+  *Value=strtod(Start, &End);
+  if (End==Start) return false;
+  *p=End;
+  return true;
+}
+
+/***************************************************************/
+/* call Parser(Line, nl, UserData) for the next NumLines lines */
+/* of the buffer (nl=0..NumLines-1), in parallel, and advance  */
+/* past them. returns 0 on success, or the line number (within */
+/* the file) of the first line for which Parser returned false */
+/* or -1 if the file ended early.                              */
+/***************************************************************/
+int ParseMeshLines(MeshFileBuffer *MFB, int NumLines,
+                   MeshLineParser Parser, void *UserData)
+{
+  if (NumLines<=0) return 0;
+
+  /*--------------------------------------------------------------*/
+  /*- serial pass to locate the line starts ----------------------*/
+  /*--------------------------------------------------------------*/
+  const char **Lines=(const char **)mallocEC(NumLines*sizeof(char *));
+  int FirstLineNum=MFB->LineNum+1;
+  for(int nl=0; nl<NumLines; nl++)
+   if ( !(Lines[nl]=GetMeshLine(MFB)) )
+    { free(Lines);
+      return -1;
+    };
+
+  /*--------------------------------------------------------------*/
+  /*- parallel pass to parse them --------------------------------*/
+  /*--------------------------------------------------------------*/
+  int FirstBadLine=NumLines;
+#ifdef USE_OPENMP
+  int NumThreads=GetNumThreads();
+#pragma omp parallel for schedule(static), num_threads(NumThreads)
+#endif
+  for(int nl=0; nl<NumLines; nl++)
+   if ( !Parser(Lines[nl], nl, UserData) )
+    {
+#ifdef USE_OPENMP
+#pragma omp critical
+#endif
+      if (nl<FirstBadLine) FirstBadLine=nl;
+    };
+
+  free(Lines);
+  return (FirstBadLine==NumLines) ? 0 : FirstLineNum + FirstBadLine;
+}
+
+} // namespace scuff
@@ -0,0 +1,585 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * MirrorSymmetry.cc -- support for geometries that are symmetric under
+ *                   -- reflection in one or more of the coordinate planes
+ *
+ * how it works:
+ *
+ *  (a) the symmetry group G consists of the NumOps=2^NumMirrorPlanes
+ *      products of the reflections; element #g is the product of
+ *      the reflections in the planes whose bits are set in g.
+ *
+ *  (b) each g maps RWG basis function #b into +- basis function #b':
+ *      the reflected RWG function is the RWG function on the
+ *      reflected edge, with positive panel the reflected positive
+ *      panel. electric currents transform as polar vectors and
+ *      magnetic currents pick up an additional factor det(g)=+-1,
+ *      so that the BEM matrix commutes with the action of G.
+ *
+ *  (c) G is abelian with NumOps one-dimensional irreducible
+ *      representations, with characters chi_r(g) = (-1)^{#bits in r&g}.
+ *      for each orbit of basis functions under G and each r we form
+ *      the normalized projection u of the orbit representative onto
+ *      irrep #r (if it doesn't vanish); the u vectors are orthonormal,
+ *      and the BEM matrix is block-diagonal in this basis, with one
+ *      block per irrep.
+ *
+ *  (d) since M commutes with G, the block entries only require the
+ *      rows of the BEM matrix for the orbit representatives:
+ *
+ *       M_r[o][o'] = sqrt(n_o/n_o') \sum_{b \in o'} c_b M[a_o][b]
+ *
+ *      where a_o is the representative of orbit o, n_o its size,
+ *      and c_b=+-1 the coefficient of b in the projection.
+ *
+ *  (e) the action of G on the basis functions is computed once, in
+ *      the RWGGeometry constructor. since surfaces may subsequently
+ *      be transformed, AssembleMirrorBlocks() recomputes it from the
+ *      current surface positions (CheckMirrorSymmetry) and refuses
+ *      to proceed if it has changed.
+ *
+ * agent         -- 10/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+
+#include "libscuff.h"
+#include "libscuffInternals.h"
+
+#ifdef USE_OPENMP
+#  include <omp.h>
+#endif
+
+namespace scuff {
+
+#define MAXOPS 8
+
+/***************************************************************/
+/* internal data describing the action of the symmetry group   */
+/* on the basis functions of the geometry                      */
+/***************************************************************/
+typedef struct MirrorSymmetryData
+ {
+   int NumOps;           // number of group elements (= number of irreps)
+   int NumBFs;           // = G->TotalBFs
+   int *Image;           // Image[g*NumBFs+nbf] = image of BF #nbf under g
+   signed char *Sign;    // Sign[g*NumBFs+nbf]  = +-1 sign of the image
+   int *Dim;             // Dim[r] = dimension of block for irrep #r
+   int **RepBFs;         // RepBFs[r][n] = representative BF of nth basis vector in block #r
+   int *NumRowEdges;     // NumRowEdges[ns] = number of representative edges on surface #ns
+   int **RowEdges;       // RowEdges[ns][n] = index of nth representative edge on surface #ns
+   int *RowOffset;       // RowOffset[ns] = first row for surface #ns in the representative rows
+   int *RowIndex;        // RowIndex[nbf] = row of representative BF #nbf (-1 if not a representative)
+   int NumRows;
+ } MirrorSymmetryData;
+
+/***************************************************************/
+/* character of group element g in irrep r                     */
+/***************************************************************/
+static int Chi(int r, int g)
+{ int Sign=1;
+  for(int b=r&g; b; b>>=1)
+   if (b&1) Sign*=-1;
+  return Sign;
+}
+
+/***************************************************************/
+/* CoordMask bit i set means coordinate i changes sign         */
+/***************************************************************/
+static void Reflect(int CoordMask, const double X[3], double XP[3])
+{ for(int i=0; i<3; i++)
+   XP[i] = (CoordMask & (1<<i)) ? -X[i] : X[i];
+}
+
+static int GetCoordMask(RWGGeometry *G, int g)
+{ int CoordMask=0;
+  for(int p=0; p<G->NumMirrorPlanes; p++)
+   if ( g & (1<<p) )
+    CoordMask ^= (1<<G->MirrorPlanes[p]);
+  return CoordMask;
+}
+
+/***************************************************************/
+/* panel centroids sorted by x coordinate for fast lookup of   */
+/* the images of panels                                        */
+/***************************************************************/
+typedef struct PanelRecord
+ { double X[3];
+   int ns, np;
+ } PanelRecord;
+
+static int ComparePanelRecords(const void *p1, const void *p2)
+{ double x1=((const PanelRecord *)p1)->X[0];
+  double x2=((const PanelRecord *)p2)->X[0];
+  return x1<x2 ? -1 : x1>x2 ? 1 : 0;
+}
+
+/***************************************************************/
+/* sorted list of the current panel centroids of all surfaces  */
+/***************************************************************/
+static PanelRecord *CreatePanelRecords(RWGGeometry *G)
+{
+  PanelRecord *Records=(PanelRecord *)mallocEC(G->TotalPanels*sizeof(PanelRecord));
+  for(int ns=0, n=0; ns<G->NumSurfaces; ns++)
+   for(int np=0; np<G->Surfaces[ns]->NumPanels; np++, n++)
+    { VecCopy(G->Surfaces[ns]->Panels[np]->Centroid, Records[n].X);
+      Records[n].ns=ns;
+      Records[n].np=np;
+    };
+  qsort(Records, G->TotalPanels, sizeof(PanelRecord), ComparePanelRecords);
+  return Records;
+}
+
+/***************************************************************/
+/* return true if surfaces Sa and Sb may be images of each     */
+/* other under a symmetry of the geometry                      */
+/***************************************************************/
+static bool SurfacesEquivalent(RWGGeometry *G, RWGSurface *Sa, RWGSurface *Sb)
+{
+  if (Sa==Sb)
+   return true;
+  if ( Sa->IsPEC!=Sb->IsPEC || Sa->NumEdges!=Sb->NumEdges )
+   return false;
+  if ( (Sa->SurfaceSigmaMP==0) != (Sb->SurfaceSigmaMP==0) )
+   return false;
+  if ( strcmp(G->RegionMPs[Sa->RegionIndices[0]]->Name,
+              G->RegionMPs[Sb->RegionIndices[0]]->Name) )
+   return false;
+  if ( !Sa->IsPEC && strcmp(G->RegionMPs[Sa->RegionIndices[1]]->Name,
+                            G->RegionMPs[Sb->RegionIndices[1]]->Name) )
+   return false;
+  return true;
+}
+
+/***************************************************************/
+/* compute the images of all basis functions under the         */
+/* reflection described by CoordMask. returns false if the     */
+/* geometry is not invariant under the reflection.             */
+/***************************************************************/
+static bool GetBFImages(RWGGeometry *G, int CoordMask,
+                        PanelRecord *Records, int *Image, signed char *Sign)
+{
+  double Tol = G->tolVecClose;
+  int NumRecords = G->TotalPanels;
+  int Det = 1;
+  for(int i=0; i<3; i++)
+   if (CoordMask & (1<<i)) Det*=-1;
+
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   {
+     RWGSurface *S=G->Surfaces[ns];
+     for(int ne=0; ne<S->NumEdges; ne++)
+      {
+        RWGEdge *E=S->Edges[ne];
+
+        /*--------------------------------------------------------------*/
+        /*- find the image of the positive panel by bisection on the    */
+        /*- x-coordinate of its centroid                                */
+        /*--------------------------------------------------------------*/
+        double XP[3];
+        Reflect(CoordMask, S->Panels[E->iPPanel]->Centroid, XP);
+        int Lo=0, Hi=NumRecords;
+        while(Lo<Hi)
+         { int Mid=(Lo+Hi)/2;
+           if ( Records[Mid].X[0] < XP[0]-Tol ) Lo=Mid+1; else Hi=Mid;
+         };
+        PanelRecord *PR=0;
+        for(int n=Lo; n<NumRecords && Records[n].X[0]<=XP[0]+Tol && !PR; n++)
+         if ( VecDistance(XP, Records[n].X) < Tol )
+          PR=Records+n;
+        if (PR==0)
+         return false;
+
+        RWGSurface *SP=G->Surfaces[PR->ns];
+        if ( !SurfacesEquivalent(G, S, SP) )
+         return false;
+
+        /*--------------------------------------------------------------*/
+        /*- the image edge is the edge of the image panel whose         */
+        /*- centroid is the reflected edge centroid                     */
+        /*--------------------------------------------------------------*/
+        RWGPanel *PP=SP->Panels[PR->np];
+        Reflect(CoordMask, E->Centroid, XP);
+        int nep=-1;
+        for(int i=0; i<3 && nep==-1; i++)
+         if ( PP->EI[i]>=0 && VecDistance(XP, SP->Edges[PP->EI[i]]->Centroid) < Tol )
+          nep=PP->EI[i];
+        if (nep==-1)
+         return false;
+
+        int EdgeSign = ( SP->Edges[nep]->iPPanel == PR->np ) ? 1 : -1;
+        int Offset=G->BFIndexOffset[ns], OffsetP=G->BFIndexOffset[PR->ns];
+        if (S->IsPEC)
+         { Image[Offset + ne] = OffsetP + nep;
+           Sign[Offset + ne]  = EdgeSign;
+         }
+        else
+         { Image[Offset + 2*ne + 0] = OffsetP + 2*nep + 0;
+           Sign[Offset + 2*ne + 0]  = EdgeSign;
+           Image[Offset + 2*ne + 1] = OffsetP + 2*nep + 1;
+           Sign[Offset + 2*ne + 1]  = Det*EdgeSign;
+         };
+      };
+   };
+
+  return true;
+}
+
+/***************************************************************/
+/* get the members b and coefficients c_b of the projection of */
+/* the orbit of basis function #a onto irrep #r. the return    */
+/* value is the number of members, or 0 if the projection      */
+/* vanishes.                                                   */
+/***************************************************************/
+static int GetOrbit(MirrorSymmetryData *MD, int r, int a, int *b, int *c)
+{
+  int n=0;
+  for(int g=0; g<MD->NumOps; g++)
+   { int bg = MD->Image[g*MD->NumBFs + a];
+     int cg = Chi(r,g) * MD->Sign[g*MD->NumBFs + a];
+     int m;
+     for(m=0; m<n && b[m]!=bg; m++)
+      ;
+     if (m<n)
+      { if (c[m]!=cg) return 0;
+      }
+     else
+      { b[n]=bg;
+        c[n]=cg;
+        n++;
+      };
+   };
+  return n;
+}
+
+/***************************************************************/
+/* called from the RWGGeometry constructor to set up mirror    */
+/* symmetry. if Auto is true, the candidate planes are all     */
+/* three coordinate planes and we keep those under which the   */
+/* geometry is actually symmetric; otherwise, it is an error   */
+/* if the geometry is not symmetric under the requested planes.*/
+/***************************************************************/
+void RWGGeometry::InitMirrorSymmetry(bool Auto)
+{
+  MirrorData=0;
+  if (LDim>0)
+   ErrExit("%s: MIRROR_SYMMETRY is not supported for periodic geometries",GeoFileName);
+  if (NumSlices>1)
+   { Warn("%s: ignoring MIRROR_SYMMETRY for rotationally symmetric geometry",GeoFileName);
+     NumMirrorPlanes=0;
+     return;
+   };
+
+  PanelRecord *Records=CreatePanelRecords(this);
+
+  int *Image=(int *)mallocEC(MAXOPS*TotalBFs*sizeof(int));
+  signed char *Sign=(signed char *)mallocEC(MAXOPS*TotalBFs*sizeof(signed char));
+
+  /*--------------------------------------------------------------*/
+  /*- check the individual planes ---------------------------------*/
+  /*--------------------------------------------------------------*/
+  const char *PlaneNames[3]={"x","y","z"};
+  if (Auto)
+   { NumMirrorPlanes=0;
+     for(int i=0; i<3; i++)
+      if ( GetBFImages(this, 1<<i, Records, Image, Sign) )
+       MirrorPlanes[NumMirrorPlanes++]=i;
+   }
+  else
+   { for(int p=0; p<NumMirrorPlanes; p++)
+      if ( !GetBFImages(this, 1<<MirrorPlanes[p], Records, Image, Sign) )
+       ErrExit("%s: geometry is not symmetric under %s -> -%s",
+                GeoFileName,PlaneNames[MirrorPlanes[p]],PlaneNames[MirrorPlanes[p]]);
+   };
+  if (NumMirrorPlanes==0)
+   { Log("No mirror symmetries detected.");
+     free(Image);
+     free(Sign);
+     free(Records);
+     return;
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- action of all group elements on the basis functions ---------*/
+  /*--------------------------------------------------------------*/
+  MirrorSymmetryData *MD=(MirrorSymmetryData *)mallocEC(sizeof(MirrorSymmetryData));
+  MD->NumOps = 1<<NumMirrorPlanes;
+  MD->NumBFs = TotalBFs;
+  MD->Image  = Image;
+  MD->Sign   = Sign;
+  for(int g=0; g<MD->NumOps; g++)
+   if ( !GetBFImages(this, GetCoordMask(this, g), Records, Image + g*TotalBFs, Sign + g*TotalBFs) )
+    ErrExit("%s:%i: internal error",__FILE__,__LINE__);
+  free(Records);
+
+  /*--------------------------------------------------------------*/
+  /*- orbit representatives: BF #a is a representative if it has  */
+  /*- the smallest index in its orbit. since the K and N functions */
+  /*- of an edge share an orbit pattern, representatives come in   */
+  /*- whole edges.                                                 */
+  /*--------------------------------------------------------------*/
+  MD->NumRowEdges = (int *)mallocEC(NumSurfaces*sizeof(int));
+  MD->RowEdges    = (int **)mallocEC(NumSurfaces*sizeof(int *));
+  MD->RowOffset   = (int *)mallocEC(NumSurfaces*sizeof(int));
+  MD->RowIndex    = (int *)mallocEC(TotalBFs*sizeof(int));
+  MD->NumRows=0;
+  for(int ns=0; ns<NumSurfaces; ns++)
+   { RWGSurface *S=Surfaces[ns];
+     int BFPerEdge = S->IsPEC ? 1 : 2;
+     MD->NumRowEdges[ns]=0;
+     MD->RowEdges[ns]=(int *)mallocEC(S->NumEdges*sizeof(int));
+     MD->RowOffset[ns]=MD->NumRows;
+     for(int ne=0; ne<S->NumEdges; ne++)
+      { int a = BFIndexOffset[ns] + BFPerEdge*ne;
+        bool IsRep=true;
+        for(int g=1; g<MD->NumOps && IsRep; g++)
+         if ( Image[g*TotalBFs + a] < a )
+          IsRep=false;
+        for(int nbf=0; nbf<BFPerEdge; nbf++)
+         MD->RowIndex[a+nbf] = IsRep ? MD->NumRows + BFPerEdge*MD->NumRowEdges[ns] + nbf : -1;
+        if (IsRep)
+         MD->RowEdges[ns][ MD->NumRowEdges[ns]++ ] = ne;
+      };
+     MD->NumRows += BFPerEdge*MD->NumRowEdges[ns];
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- basis vectors for each irrep --------------------------------*/
+  /*--------------------------------------------------------------*/
+  MD->Dim    = (int *)mallocEC(MD->NumOps*sizeof(int));
+  MD->RepBFs = (int **)mallocEC(MD->NumOps*sizeof(int *));
+  int b[MAXOPS], c[MAXOPS], TotalDim=0;
+  for(int r=0; r<MD->NumOps; r++)
+   { MD->Dim[r]=0;
+     MD->RepBFs[r]=(int *)mallocEC(MD->NumRows*sizeof(int));
+     for(int a=0; a<TotalBFs; a++)
+      if ( MD->RowIndex[a]!=-1 && GetOrbit(MD, r, a, b, c) )
+       MD->RepBFs[r][ MD->Dim[r]++ ] = a;
+     TotalDim+=MD->Dim[r];
+   };
+  if (TotalDim!=TotalBFs)
+   ErrExit("%s:%i: internal error (%i!=%i)",__FILE__,__LINE__,TotalDim,TotalBFs);
+
+  MirrorData=(void *)MD;
+
+  char PlaneList[10]="";
+  for(int p=0; p<NumMirrorPlanes; p++)
+   strcat(PlaneList, PlaneNames[MirrorPlanes[p]]);
+  Log("Geometry has mirror symmetry in %s (%i blocks, %i representative rows).",
+       PlaneList, MD->NumOps, MD->NumRows);
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+void RWGGeometry::DestroyMirrorSymmetry()
+{
+  MirrorSymmetryData *MD=(MirrorSymmetryData *)MirrorData;
+  if (!MD) return;
+  for(int r=0; r<MD->NumOps; r++)
+   free(MD->RepBFs[r]);
+  for(int ns=0; ns<NumSurfaces; ns++)
+   free(MD->RowEdges[ns]);
+  free(MD->RepBFs);
+  free(MD->Dim);
+  free(MD->RowIndex);
+  free(MD->RowOffset);
+  free(MD->RowEdges);
+  free(MD->NumRowEdges);
+  free(MD->Sign);
+  free(MD->Image);
+  free(MD);
+  MirrorData=0;
+}
+
+/***************************************************************/
+/* returns true if the action of the symmetry group on the     */
+/* basis functions, as computed from the current positions of  */
+/* the surfaces, agrees with the one computed at construction  */
+/* time (it won't if a surface has since been transformed in a */
+/* way that breaks the symmetry or permutes the orbits).       */
+/***************************************************************/
+bool RWGGeometry::CheckMirrorSymmetry()
+{
+  MirrorSymmetryData *MD=(MirrorSymmetryData *)MirrorData;
+  if (!MD) return false;
+
+  PanelRecord *Records=CreatePanelRecords(this);
+  int *Image=(int *)mallocEC(TotalBFs*sizeof(int));
+  signed char *Sign=(signed char *)mallocEC(TotalBFs*sizeof(signed char));
+  bool Symmetric=true;
+  for(int g=1; g<MD->NumOps && Symmetric; g++)
+   { if ( !GetBFImages(this, GetCoordMask(this, g), Records, Image, Sign) )
+      Symmetric=false;
+     else if (    memcmp(Image, MD->Image + g*TotalBFs, TotalBFs*sizeof(int))
+               || memcmp(Sign,  MD->Sign  + g*TotalBFs, TotalBFs*sizeof(signed char))
+             )
+      Symmetric=false;
+   };
+  free(Sign);
+  free(Image);
+  free(Records);
+  return Symmetric;
+}
+
+/***************************************************************/
+/* number of blocks in the symmetry-reduced BEM matrix (one per*/
+/* irreducible representation), or 0 if the geometry has no   */
+/* mirror symmetry                                             */
+/***************************************************************/
+int RWGGeometry::GetNumMirrorBlocks()
+{
+  MirrorSymmetryData *MD=(MirrorSymmetryData *)MirrorData;
+  return MD ? MD->NumOps : 0;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+HMatrix **RWGGeometry::AllocateMirrorBlocks()
+{
+  MirrorSymmetryData *MD=(MirrorSymmetryData *)MirrorData;
+  if (!MD)
+   ErrExit("%s: AllocateMirrorBlocks called for geometry without mirror symmetry",GeoFileName);
+  HMatrix **MBlocks=(HMatrix **)mallocEC(MD->NumOps*sizeof(HMatrix *));
+  for(int r=0; r<MD->NumOps; r++)
+   MBlocks[r]=new HMatrix(MD->Dim[r], MD->Dim[r], LHM_COMPLEX);
+  return MBlocks;
+}
+
+/***************************************************************/
+/* compute the representative rows of the BEM matrix, then     */
+/* project onto the irreps.                                    */
+/***************************************************************/
+void RWGGeometry::AssembleMirrorBlocks(cdouble Omega, HMatrix **MBlocks)
+{
+  MirrorSymmetryData *MD=(MirrorSymmetryData *)MirrorData;
+  if (!MD)
+   ErrExit("%s: AssembleMirrorBlocks called for geometry without mirror symmetry",GeoFileName);
+  if ( !CheckMirrorSymmetry() )
+   ErrExit("%s: geometry is no longer mirror-symmetric (were surfaces transformed?)",GeoFileName);
+
+  Log("Assembling mirror-symmetric BEM matrix at Omega=(%g,%g)...",real(Omega),imag(Omega));
+
+  HMatrix *B0=new HMatrix(MD->NumRows, TotalBFs, LHM_COMPLEX);
+
+  GetSSIArgStruct MyArgs, *Args=&MyArgs;
+  InitGetSSIArgs(Args);
+  Args->G=this;
+  Args->Omega=Omega;
+  Args->B=B0;
+  for(int ns=0; ns<NumSurfaces; ns++)
+   { if (MD->NumRowEdges[ns]==0) continue;
+     for(int nsp=0; nsp<NumSurfaces; nsp++)
+      { Args->Sa=Surfaces[ns];
+        Args->Sb=Surfaces[nsp];
+        Args->RowOffset=MD->RowOffset[ns];
+        Args->ColOffset=BFIndexOffset[nsp];
+        Args->NumRowEdges=MD->NumRowEdges[ns];
+        Args->RowEdges=MD->RowEdges[ns];
+        GetSurfaceSurfaceInteractions(Args);
+      };
+   };
+
+  int NumThreads=GetNumThreads();
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+  for(int r=0; r<MD->NumOps; r++)
+   {
+     int Dim=MD->Dim[r];
+     int b[MAXOPS], c[MAXOPS];
+     for(int j=0; j<Dim; j++)
+      { int nOrbit=GetOrbit(MD, r, MD->RepBFs[r][j], b, c);
+        for(int i=0; i<Dim; i++)
+         { int a=MD->RepBFs[r][i];
+           int Row=MD->RowIndex[a];
+           int bi[MAXOPS], ci[MAXOPS];
+           int nRow=GetOrbit(MD, r, a, bi, ci);
+           cdouble Sum=0.0;
+           for(int n=0; n<nOrbit; n++)
+            Sum += ((double)c[n]) * B0->GetEntry(Row, b[n]);
+           MBlocks[r]->SetEntry(i, j, sqrt( ((double)nRow)/((double)nOrbit) )*Sum);
+         };
+      };
+   };
+
+  delete B0;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+void RWGGeometry::LUFactorizeMirrorBlocks(HMatrix **MBlocks)
+{
+  int NumBlocks=GetNumMirrorBlocks();
+  for(int r=0; r<NumBlocks; r++)
+   { if (MBlocks[r]->NR==0) continue;
+     Log(" LU-factorizing mirror-symmetry block %i/%i...",r+1,NumBlocks);
+     MBlocks[r]->LUFactorize();
+   };
+}
+
+/***************************************************************/
+/* on entry, KN is the RHS vector for the full geometry; on    */
+/* return, it is the solution of the full BEM system. the      */
+/* MBlocks must have been LU-factorized.                       */
+/***************************************************************/
+void RWGGeometry::LUSolveMirror(HMatrix **MBlocks, HVector *KN)
+{
+  MirrorSymmetryData *MD=(MirrorSymmetryData *)MirrorData;
+  int b[MAXOPS], c[MAXOPS];
+
+  HVector **Xr=(HVector **)mallocEC(MD->NumOps*sizeof(HVector *));
+  for(int r=0; r<MD->NumOps; r++)
+   {
+     int Dim=MD->Dim[r];
+     Xr[r]=new HVector(Dim, LHM_COMPLEX);
+     for(int i=0; i<Dim; i++)
+      { int n=GetOrbit(MD, r, MD->RepBFs[r][i], b, c);
+        cdouble Sum=0.0;
+        for(int m=0; m<n; m++)
+         Sum += ((double)c[m]) * KN->GetEntry(b[m]);
+        Xr[r]->SetEntry(i, Sum/sqrt((double)n));
+      };
+     if (Dim>0)
+      MBlocks[r]->LUSolve(Xr[r]);
+   };
+
+  KN->Zero();
+  for(int r=0; r<MD->NumOps; r++)
+   { for(int i=0; i<MD->Dim[r]; i++)
+      { int n=GetOrbit(MD, r, MD->RepBFs[r][i], b, c);
+        cdouble X=Xr[r]->GetEntry(i)/sqrt((double)n);
+        for(int m=0; m<n; m++)
+         KN->AddEntry(b[m], ((double)c[m])*X);
+      };
+     delete Xr[r];
+   };
+  free(Xr);
+}
+
+} // namespace scuff
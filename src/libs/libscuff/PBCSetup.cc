@@ -45,6 +45,83 @@ static int PointOnLine(double *X, double *L)
    return ((float)(L[1]*X[0])) == ((float)(L[0]*X[1]));
 } 
 
+/***************************************************************/
+/* To avoid an O(N^2) search over all pairs of exterior edges, */
+/* we sort the exterior edges into cubical cells according to  */
+/* the coordinates of their midpoints. If two edges have       */
+/* endpoints that are pairwise VecClose() (so that every       */
+/* cartesian component of their endpoints differs by at most   */
+/* 3*tolVecClose), then their midpoints are in the same or in  */
+/* adjacent cells as long as the cell side length is at least  */
+/* 3*tolVecClose. Thus, to find the exterior edges that could  */
+/* be translates of a given edge, we need only look through the*/
+/* 27 cells surrounding the translated midpoint of that edge.  */
+/***************************************************************/
+typedef struct EdgeCell
+ { long C[3];   // integer cell coordinates of edge midpoint
+   int nei;     // index of edge within ExteriorEdges
+ } EdgeCell;
+
+typedef struct EdgeCellTable
+ { EdgeCell *Cells;
+   int NumCells;
+   double h;    // cell side length
+ } EdgeCellTable;
+
+static int CompareCells(const long *C1, const long *C2)
+{ for(int i=0; i<3; i++)
+   if (C1[i]!=C2[i]) 
+    return C1[i] < C2[i] ? -1 : 1;
+  return 0;
+}
+
+static int CompareEdgeCells(const void *p1, const void *p2)
+{ 
+  const EdgeCell *EC1=(const EdgeCell *)p1, *EC2=(const EdgeCell *)p2;
+  int Result=CompareCells(EC1->C, EC2->C);
+  if (Result) return Result;
+  return EC1->nei - EC2->nei;
+}
+
+static void GetEdgeCell(double *V1, double *V2, double h, long C[3])
+{ for(int i=0; i<3; i++)
+   C[i] = (long)floor( 0.5*(V1[i] + V2[i]) / h );
+}
+
+static void InitEdgeCellTable(RWGSurface *S, EdgeCellTable *ECT)
+{
+  ECT->h = S->tolVecClose > 0.0 ? 4.0*S->tolVecClose : 1.0;
+  ECT->Cells = (EdgeCell *)mallocEC( (S->NumExteriorEdges+1)*sizeof(EdgeCell) );
+  ECT->NumCells = 0;
+  for(int nei=0; nei<S->NumExteriorEdges; nei++)
+   { RWGEdge *E = S->ExteriorEdges[nei];
+     if (E==0) continue;
+     EdgeCell *EC = ECT->Cells + (ECT->NumCells++);
+     GetEdgeCell(S->Vertices + 3*E->iV1, S->Vertices + 3*E->iV2, ECT->h, EC->C);
+     EC->nei = nei;
+   };
+  qsort(ECT->Cells, ECT->NumCells, sizeof(EdgeCell), CompareEdgeCells);
+}
+
+/***************************************************************/
+/* return the index within ECT->Cells of the first entry whose */
+/* cell is C, or -1 if there is none.                          */
+/***************************************************************/
+static int FindFirstInCell(EdgeCellTable *ECT, long C[3])
+{
+  int Lo=0, Hi=ECT->NumCells;
+  while(Lo<Hi)
+   { int Mid = Lo + (Hi-Lo)/2;
+     if ( CompareCells(ECT->Cells[Mid].C, C) < 0 )
+      Lo=Mid+1;
+     else
+      Hi=Mid;
+   };
+  if ( Lo<ECT->NumCells && CompareCells(ECT->Cells[Lo].C, C)==0 )
+   return Lo;
+  return -1;
+}
+
 /***************************************************************/
 /* given a single exterior edge on an RWGSurface, look for     */
 /* a partner of this edge -- that is, another exterior edge    */
@@ -55,6 +132,8 @@ static int PointOnLine(double *X, double *L)
 /*                                                             */
 /* if a partner edge is found, its index within S's            */
 /* ExteriorEdges array is returned. otherwise, -1 is returned. */
+/* (if there is more than one candidate partner, the one with  */
+/* the lowest index is returned.)                              */
 /*                                                             */
 /* if a partner edge is found, then NumStraddlers[i] is        */
 /* incremented (where i=0 or 1 depending on whether the        */
@@ -78,6 +157,7 @@ static int FindPartnerEdge(RWGSurface *S, int nei,
 			   double LBV[MAXLDIM][2],
                            double LBVi[MAXLDIM][2],
                            int LDim,
+                           EdgeCellTable *ECT,
 			   int NumStraddlers[MAXLDIM],
 			   int *pWhichBV,
                            double *V)
@@ -132,27 +212,49 @@ static int FindPartnerEdge(RWGSurface *S, int nei,
   double V1T[3], V2T[3]; // 'V12, translated'
   V1T[0] = V1[0] + LTranslate[0]; V1T[1] = V1[1] + LTranslate[1]; V1T[2] = V1[2];
   V2T[0] = V2[0] + LTranslate[0]; V2T[1] = V2[1] + LTranslate[1]; V2T[2] = V2[2];
+  long CT[3]; // cell of the translated midpoint
+  GetEdgeCell(V1T, V2T, ECT->h, CT);
+  int PartnerIndex=-1;
   double *V1P, *V2P; // 'V1,V2, primed'
-  for(int neip=0; neip<S->NumExteriorEdges; neip++)
+  for(int dx=-1; dx<=1; dx++)
+   for(int dy=-1; dy<=1; dy++)
+    for(int dz=-1; dz<=1; dz++)
+     { 
+       long C[3];
+       C[0]=CT[0]+dx; C[1]=CT[1]+dy; C[2]=CT[2]+dz;
+       int nc=FindFirstInCell(ECT, C);
+       if (nc==-1) 
+        continue;
+
+       for(; nc<ECT->NumCells && CompareCells(ECT->Cells[nc].C, C)==0; nc++)
+        { 
+          int neip=ECT->Cells[nc].nei;
+          if (S->ExteriorEdges[neip]==0) 
+           continue;
+          if (PartnerIndex!=-1 && neip>PartnerIndex)
+           break;
+
+          V1P = S->Vertices + 3*(S->ExteriorEdges[neip]->iV1);
+          V2P = S->Vertices + 3*(S->ExteriorEdges[neip]->iV2);
+          if (   (VecClose(V1T, V1P, tolvc) && VecClose(V2T, V2P, tolvc))
+              || (VecClose(V1T, V2P, tolvc) && VecClose(V2T, V1P, tolvc))
+             )
+           { PartnerIndex=neip;
+             break;
+           };
+        };
+     };
+
+  if (PartnerIndex!=-1)
    { 
-     if (S->ExteriorEdges[neip]==0) 
-      continue;
-
-     V1P = S->Vertices + 3*(S->ExteriorEdges[neip]->iV1);
-     V2P = S->Vertices + 3*(S->ExteriorEdges[neip]->iV2);
-     if (   (VecClose(V1T, V1P, tolvc) && VecClose(V2T, V2P, tolvc))
-         || (VecClose(V1T, V2P, tolvc) && VecClose(V2T, V1P, tolvc))
-        )
-      { 
-        /*--------------------------------------------------------------*/
-        /*- found a translate of the edge in question.                  */
-        /*--------------------------------------------------------------*/
-        memcpy(V, S->Vertices + 3*(S->ExteriorEdges[neip]->iQP), 3*sizeof(double));
-        V[0] -= LTranslate[0]; 
-        V[1] -= LTranslate[1]; 
-        if (NumStraddlers) NumStraddlers[WhichBV]++;
-        return neip;
-      };
+     /*--------------------------------------------------------------*/
+     /*- found a translate of the edge in question.                  */
+     /*--------------------------------------------------------------*/
+     memcpy(V, S->Vertices + 3*(S->ExteriorEdges[PartnerIndex]->iQP), 3*sizeof(double));
+     V[0] -= LTranslate[0]; 
+     V[1] -= LTranslate[1]; 
+     if (NumStraddlers) NumStraddlers[WhichBV]++;
+     return PartnerIndex;
    };
 
   /*--------------------------------------------------------------*/
@@ -240,6 +342,13 @@ void RWGSurface::AddStraddlers(double LBV[MAXLDIM][2],
   else // (LDim> 2)
    ErrExit("%d lattice vectors unsupported\n", LDim);
 
+  /*--------------------------------------------------------------*/
+  /*- sort the exterior edges into cells by midpoint so that each -*/
+  /*- partner-edge search is a local lookup                       -*/
+  /*--------------------------------------------------------------*/
+  EdgeCellTable ECT;
+  InitEdgeCellTable(this, &ECT);
+
   /*--------------------------------------------------------------*/
   /*--------------------------------------------------------------*/
   /*--------------------------------------------------------------*/
@@ -253,7 +362,7 @@ void RWGSurface::AddStraddlers(double LBV[MAXLDIM][2],
       // version of itself) on the opposite side of the unit cell
       int WhichBV;
       int neip=FindPartnerEdge(this, nei, LBV, LBVi, 
-                               LDim, NumStraddlers, &WhichBV, V);
+                               LDim, &ECT, NumStraddlers, &WhichBV, V);
 
       // if so, add a new vertex, panel, and interior edge to the RWGSurface.
       if (neip!=-1)
@@ -324,6 +433,8 @@ void RWGSurface::AddStraddlers(double LBV[MAXLDIM][2],
      
    }; // for(nei=0; nei<NumExteriorEdges; nei++)
 
+  free(ECT.Cells);
+
   TotalStraddlers=NumNew;
 
   if (NumNew==0)
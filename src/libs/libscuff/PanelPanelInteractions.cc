@@ -58,12 +58,12 @@ namespace scuff {
 #define SWTHRESHOLD 1.0*M_PI
 #define VERYSWTHRESHOLD 20.0
 
-/**********************************************************************/
-// the 'desingularization radius': if the relative distance between   */
-// between two panels is < this number, we evaluate the PPIS using    */
-// the low-k taylor-series expansion (desingularization).             */
-/**********************************************************************/
-#define DESINGULARIZATION_RADIUS 4.0
+// (the desingularization radius DESINGULARIZATION_RADIUS is defined
+// in libscuffInternals.h, since the edge cluster trees need it too)
+
+// finite-difference step, relative to the larger panel radius, for
+// vertex derivatives of nearby panel pairs (see GetNearPPIVertexDerivatives)
+#define PPI_DVRELDELTA 1.0e-3
 
 #define AA0 1.0
 #define AA1 1.0
@@ -278,6 +278,50 @@ void AssembleInnerPPIIntegrand_NoInterp(double wp, cdouble k, double *R, double
 
 }
 
+/***************************************************************/
+/* inner integrand for the vertex-derivative mode of           */
+/* GetPPIs_Cubature(). moving the vertex by dV moves F by      */
+/* dFa*dV, FP by dFb*dV, and R=X-XP by dR*dV; the derivatives  */
+/* of the kernel factors are those used for GradHInner above.  */
+/***************************************************************/
+void AssembleInnerPPIIntegrand_DV(double wp, cdouble k, double *R, double *F, double *FP,
+                                  double dFa, double dFb, double dR,
+                                  cdouble *HInner, cdouble *GradHInner)
+{ 
+  double r=VecNorm(R);
+  double r2=r*r;
+  cdouble ik=II*k, ik2=ik*ik;
+
+  cdouble hPlus = VecDot(F,FP) + 4.0/ik2;
+  double FxFP[3], FPxR[3], RxF[3];
+  VecCross(F, FP, FxFP);
+  VecCross(FP, R, FPxR);
+  VecCross(R, F, RxF);
+  double hTimes=VecDot(FxFP, R);
+
+  cdouble Phi = exp(ik*r) / (4.0*M_PI*r);
+  if ( !IsFinite(real(Phi)) ) Phi=0.0;
+  Phi*=wp; 
+  cdouble Psi = Phi * (ik - 1.0/r) / r;
+  cdouble Zeta = Phi * (ik2 - 3.0*ik/r + 3.0/r2) / r2;
+
+  HInner[0] += hPlus * Phi;
+  HInner[1] += hTimes * Psi;
+
+  for(int Mu=0; Mu<3; Mu++)
+   { GradHInner[2*Mu + 0] += (dFa*FP[Mu] + dFb*F[Mu])*Phi + dR*R[Mu]*hPlus*Psi;
+     GradHInner[2*Mu + 1] += (dFa*FPxR[Mu] + dFb*RxF[Mu] + dR*FxFP[Mu])*Psi
+                             + dR*R[Mu]*hTimes*Zeta;
+   };
+}
+
+/***************************************************************/
+/* weight of vertex #i (0,1,2) of a panel at the point with    */
+/* cubature coordinates (u,v)                                  */
+/***************************************************************/
+static inline double BaryWeight(int i, double u, double v)
+{ return i==0 ? 1.0-u-v : i==1 ? u : v; }
+
 /*--------------------------------------------------------------*/
 /*--------------------------------------------------------------*/
 /*--------------------------------------------------------------*/
@@ -337,6 +381,33 @@ void GetPPIs_Cubature(GetPPIArgStruct *Args,
   cdouble *GradHInner = GradH ? GradHInnerBuffer : 0;
   cdouble *dHdTInner  = dHdT  ? dHdTInnerBuffer  : 0;
 
+  /***************************************************************/
+  /* in vertex-derivative mode (Args->DVertex nonzero) GradH     */
+  /* receives the derivatives with respect to the coordinates of */
+  /* the vertex, which enters through the cubature points of any */
+  /* panel that has it as a corner (with the barycentric weight  */
+  /* of that corner) and through the source/sink vertices Q, QP. */
+  /* pairs not touching the vertex have vanishing derivatives.   */
+  /***************************************************************/
+  double *DV = GradH ? Args->DVertex : 0;
+  int iDVa=-1, iDVb=-1;
+  double qa=0.0, qb=0.0;
+  if (DV)
+   { if (Args->GInterp)
+      ErrExit("%s:%i: vertex derivatives not available with interpolated kernels",__FILE__,__LINE__);
+     for(int i=0; i<3; i++)
+      { if (Va[i]==DV) iDVa=i;
+        if (Vb[i]==DV) iDVb=i;
+      };
+     if (Qa==DV) qa=1.0;
+     if (Qb==DV) qb=1.0;
+     if (iDVa==-1 && iDVb==-1)
+      { memset(Args->GradH, 0, 6*sizeof(cdouble));
+        DV=0;
+        GradH=GradHInner=0;
+      };
+   };
+
   /***************************************************************/
   /* choose order of quadrature scheme to use.                   */
   /* TCR ('triangle cubature rule') points to a vector of 3N     */
@@ -376,6 +447,7 @@ void GetPPIs_Cubature(GetPPIArgStruct *Args,
       { X[Mu] = V0[Mu] + u*A[Mu] + v*B[Mu];
         F[Mu] = X[Mu] - Q[Mu];
       };
+     double la = (iDVa==-1) ? 0.0 : BaryWeight(iDVa, u, v);
 
      /***************************************************************/
      /* inner loop to calculate value of inner integrand ************/
@@ -396,7 +468,12 @@ void GetPPIs_Cubature(GetPPIArgStruct *Args,
            R[Mu] = X[Mu] - XP[Mu];
          };
       
-        if ( Args->GInterp )
+        if ( DV )
+         { double lb = (iDVb==-1) ? 0.0 : BaryWeight(iDVb, up, vp);
+           AssembleInnerPPIIntegrand_DV(wp, k, R, F, FP, la-qa, lb-qb, la-lb,
+                                        HInner, GradHInner);
+         }
+        else if ( Args->GInterp )
          AssembleInnerPPIIntegrand_Interp(wp, k, R, F, FP, 
                                           Args->GInterp, 
                                           NumTorqueAxes, GammaMatrix, 
@@ -432,6 +509,149 @@ void GetPPIs_Cubature(GetPPIArgStruct *Args,
 
 }
 
+/***************************************************************/
+/* compute the H integrals (only) for a pair of nearby panels  */
+/* by the Taylor-Duffy method (Algorithm = PPIALG_TD or        */
+/* PPIALG_HKTD) or by desingularized cubature (Algorithm =     */
+/* PPIALG_DESING). the vertices are ordered as on return from  */
+/* AssessPanelPair(), with ncv common vertices.                */
+/***************************************************************/
+static void GetNearPPIs(GetPPIArgStruct *Args, int Algorithm, int ncv,
+                        double **Va, double *Qa, double **Vb, double *Qb,
+                        cdouble H[2])
+{
+  cdouble k=Args->k;
+
+  if ( Algorithm==PPIALG_TD || Algorithm==PPIALG_HKTD )
+   { 
+     TaylorDuffyArgStruct TDArgStruct, *TDArgs=&TDArgStruct;
+     InitTaylorDuffyArgs(TDArgs);
+
+     int PIndex[3]={TD_UNITY, TD_PMCHWG1, TD_PMCHWC};
+     int KIndex[3]={TD_HELMHOLTZ, TD_HELMHOLTZ, TD_GRADHELMHOLTZ};
+     cdouble KParam[3]={k,k,k};
+     cdouble Result[3], Error[3];
+
+     TDArgs->WhichCase=ncv;
+     TDArgs->NumPKs = (ncv==3) ? 2 : 3;
+     TDArgs->PIndex=PIndex;
+     TDArgs->KIndex=KIndex;
+     TDArgs->KParam=KParam;
+     TDArgs->V1=Va[0];
+     TDArgs->V2=Va[1];
+     TDArgs->V3=Va[2];
+     TDArgs->V2P=Vb[1];
+     TDArgs->V3P=Vb[2];
+     TDArgs->Q=Qa;
+     TDArgs->QP=Qb;
+     TDArgs->Result=Result;
+     TDArgs->Error=Error;
+
+     if ( Algorithm==PPIALG_HKTD )
+      { KIndex[0]=TD_HIGHK_HELMHOLTZ;
+        KIndex[1]=TD_HIGHK_HELMHOLTZ;
+        KIndex[2]=TD_HIGHK_GRADHELMHOLTZ;
+      };
+
+     TaylorDuffy(TDArgs);
+
+     H[0] = Result[1] - 4.0*Result[0]/(k*k);
+     H[1] = (ncv==3) ? 0.0 : Result[2];
+     return;
+   };
+
+  /*****************************************************************/
+  /* desingularization:                                            */
+  /*                                                               */
+  /*  1) use naive cubature to compute panel-panel integral with   */
+  /*     singular terms removed                                    */
+  /*  2) get the singular terms either by looking them up in the   */
+  /*     table (if one was provided) or just computing them on the */
+  /*     fly                                                       */
+  /*  3) add the singular and non-singular contributions           */
+  /*                                                               */
+  /*****************************************************************/
+  // step 1
+  int NumGradientComponents=Args->NumGradientComponents;
+  int NumTorqueAxes=Args->NumTorqueAxes;
+  Args->NumGradientComponents=Args->NumTorqueAxes=0;
+  GetPPIs_Cubature(Args, 1, 0, Va, Qa, Vb, Qb);
+  Args->NumGradientComponents=NumGradientComponents;
+  Args->NumTorqueAxes=NumTorqueAxes;
+  H[0]=Args->H[0];
+  H[1]=Args->H[1];
+
+  // step 2
+  QDFIPPIData MyQDFD, *QDFD=&MyQDFD;
+  if (Args->opFC)
+   GetQDFIPPIData(Va, Qa, Vb, Qb, ncv, Args->opFC, QDFD);
+  else
+   GetQDFIPPIData(Va, Qa, Vb, Qb, ncv, &GlobalFIPPICache, QDFD);
+
+  // step 3
+  // note: PF[n] = (ik)^n / (4\pi)
+  cdouble ik=II*k; 
+  cdouble OOIK2=1.0/(ik*ik);
+  cdouble PF[5];
+  PF[0]=1.0/(4.0*M_PI);
+  PF[1]=ik*PF[0];
+  PF[2]=ik*PF[1];
+  PF[3]=ik*PF[2];
+  PF[4]=ik*PF[3];
+
+  // add contributions to panel-panel integrals
+  H[0] +=  PF[0]*AA0*( QDFD->hDotRM1 + OOIK2*QDFD->hNablaRM1)
+          +PF[1]*AA1*( QDFD->hDotR0  + OOIK2*QDFD->hNablaR0 )
+          +PF[2]*AA2*( QDFD->hDotR1  + OOIK2*QDFD->hNablaR1 )
+          +PF[3]*AA3*( QDFD->hDotR2  + OOIK2*QDFD->hNablaR2 );
+  
+  H[1] +=  PF[0]*BB0*QDFD->hTimesRM3
+          +PF[2]*BB2*QDFD->hTimesRM1
+          +PF[3]*BB3*QDFD->hTimesR0 
+          +PF[4]*BB4*QDFD->hTimesR1;
+}
+
+/***************************************************************/
+/* vertex derivatives (Args->DVertex) of the H integrals for a */
+/* pair of nearby panels, by central differences on a private  */
+/* copy of the vertex. the algorithm is pinned to the one that */
+/* was chosen for the unperturbed pair (Args->WhichAlgorithm), */
+/* so the step can never switch between integration rules.    */
+/***************************************************************/
+static void GetNearPPIVertexDerivatives(GetPPIArgStruct *Args, int ncv,
+                                        double **Va, double *Qa,
+                                        double **Vb, double *Qb)
+{
+  double *DV=Args->DVertex;
+  memset(Args->GradH, 0, 6*sizeof(cdouble));
+
+  double VP[3], *VaP[3], *VbP[3];
+  bool Touched=false;
+  for(int i=0; i<3; i++)
+   { VaP[i] = (Va[i]==DV) ? VP : Va[i];
+     VbP[i] = (Vb[i]==DV) ? VP : Vb[i];
+     if ( Va[i]==DV || Vb[i]==DV ) Touched=true;
+   };
+  if (!Touched) return;
+  double *QaP = (Qa==DV) ? VP : Qa;
+  double *QbP = (Qb==DV) ? VP : Qb;
+
+  double Delta = PPI_DVRELDELTA * fmax( Args->Sa->Panels[Args->npa]->Radius,
+                                        Args->Sb->Panels[Args->npb]->Radius );
+  cdouble HSave[2], HP[2], HM[2];
+  memcpy(HSave, Args->H, 2*sizeof(cdouble));
+  for(int Mu=0; Mu<3; Mu++)
+   { memcpy(VP, DV, 3*sizeof(double));
+     VP[Mu] = DV[Mu] + Delta;
+     GetNearPPIs(Args, Args->WhichAlgorithm, ncv, VaP, QaP, VbP, QbP, HP);
+     VP[Mu] = DV[Mu] - Delta;
+     GetNearPPIs(Args, Args->WhichAlgorithm, ncv, VaP, QaP, VbP, QbP, HM);
+     Args->GradH[2*Mu+0] = (HP[0]-HM[0]) / (2.0*Delta);
+     Args->GradH[2*Mu+1] = (HP[1]-HM[1]) / (2.0*Delta);
+   };
+  memcpy(Args->H, HSave, 2*sizeof(cdouble));
+}
+
 /***************************************************************/
 /* calculate integrals over a single pair of triangles using   */
 /* one of several different methods based on how near the two  */
@@ -469,6 +689,22 @@ void GetPanelPanelInteractions(GetPPIArgStruct *Args)
   double rRel; 
   int ncv;
 
+  /***************************************************************/
+  /* if the caller already knows that the panels are far apart   */
+  /* (see EdgeClusterTree.cc) we can go straight to cubature     */
+  /***************************************************************/
+  if (Args->Far && Displacement==0)
+   { Va[0] = Sa->Vertices + 3*Pa->VI[0];
+     Va[1] = Sa->Vertices + 3*Pa->VI[1];
+     Va[2] = Sa->Vertices + 3*Pa->VI[2];
+     Vb[0] = Sb->Vertices + 3*Pb->VI[0];
+     Vb[1] = Sb->Vertices + 3*Pb->VI[1];
+     Vb[2] = Sb->Vertices + 3*Pb->VI[2];
+     Args->WhichAlgorithm=PPIALG_LOCUBATURE;
+     GetPPIs_Cubature(Args, 0, 0, Va, Qa, Vb, Qb);
+     return;
+   };
+
   if (Displacement==0)
    ncv=AssessPanelPair(Sa,npa,Sb,npb,&rRel,Va,Vb);
   else 
@@ -531,45 +767,17 @@ void GetPanelPanelInteractions(GetPPIArgStruct *Args)
   /***************************************************************/
   if ( ncv==3 || ( ncv>0 && (InSWRegime || Args->ForceTaylorDuffy) ) )
    { 
-     TaylorDuffyArgStruct TDArgStruct, *TDArgs=&TDArgStruct;
-     InitTaylorDuffyArgs(TDArgs);
-
-     int PIndex[3]={TD_UNITY, TD_PMCHWG1, TD_PMCHWC};
-     int KIndex[3]={TD_HELMHOLTZ, TD_HELMHOLTZ, TD_GRADHELMHOLTZ};
-     cdouble KParam[3]={k,k,k};
-     cdouble Result[3], Error[3];
-
-     TDArgs->WhichCase=ncv;
-     TDArgs->NumPKs = (ncv==3) ? 2 : 3;
-     TDArgs->PIndex=PIndex;
-     TDArgs->KIndex=KIndex;
-     TDArgs->KParam=KParam;
-     TDArgs->V1=Va[0];
-     TDArgs->V2=Va[1];
-     TDArgs->V3=Va[2];
-     TDArgs->V2P=Vb[1];
-     TDArgs->V3P=Vb[2];
-     TDArgs->Q=Qa;
-     TDArgs->QP=Qb;
-     TDArgs->Result=Result;
-     TDArgs->Error=Error;
-
      if ( InVerySWRegime && RWGGeometry::UseHighKTaylorDuffy )
-      { Args->WhichAlgorithm=PPIALG_HKTD;
-        KIndex[0]=TD_HIGHK_HELMHOLTZ;
-        KIndex[1]=TD_HIGHK_HELMHOLTZ;
-        KIndex[2]=TD_HIGHK_GRADHELMHOLTZ;
-      }
+      Args->WhichAlgorithm=PPIALG_HKTD;
      else
       Args->WhichAlgorithm=PPIALG_TD;
 
-     TaylorDuffy(TDArgs);
-
-     H[0] = Result[1] - 4.0*Result[0]/(k*k);
-     H[1] = (ncv==3) ? 0.0 : Result[2];
+     GetNearPPIs(Args, Args->WhichAlgorithm, ncv, Va, Qa, Vb, Qb, H);
 
      if (GradH) memset(GradH, 0, 2*NumGradientComponents*sizeof(cdouble));
      if (dHdT)  memset(dHdT,  0, 2*NumTorqueAxes*sizeof(cdouble));
+     if (Args->DVertex && NumGradientComponents>0)
+      GetNearPPIVertexDerivatives(Args, ncv, Va, Qa, Vb, Qb);
      return;
    };
 
@@ -583,57 +791,23 @@ void GetPanelPanelInteractions(GetPPIArgStruct *Args)
   /* promptly throw away the H integrals since we proceed to       */
   /* compute those using the more-accurate desingularization       */
   /* method below.                                                 */
+  /* (vertex derivatives are instead obtained by differencing the  */
+  /* desingularized integrals themselves.)                         */
   /*****************************************************************/
   cdouble GradHSave[6], dHdTSave[6];
   Args->WhichAlgorithm=PPIALG_DESING;
+  if ( Args->DVertex && NumGradientComponents>0 )
+   { GetNearPPIs(Args, PPIALG_DESING, ncv, Va, Qa, Vb, Qb, H);
+     GetNearPPIVertexDerivatives(Args, ncv, Va, Qa, Vb, Qb);
+     return;
+   };
   if ( NumGradientComponents>0 || NumTorqueAxes>0 )
    { GetPPIs_Cubature(Args, 0, 1, Va, Qa, Vb, Qb);
      memcpy(GradHSave, Args->GradH, 2*NumGradientComponents*sizeof(cdouble));
      memcpy(dHdTSave, Args->dHdT, 2*NumTorqueAxes*sizeof(cdouble));
    };
 
-  /*****************************************************************/
-  /* finally, if we made it here, then we use desingularization:   */
-  /*                                                               */
-  /*  1) use naive cubature to compute panel-panel integral with   */
-  /*     singular terms removed                                    */
-  /*  2) get the singular terms either by looking them up in the   */
-  /*     table (if one was provided) or just computing them on the */
-  /*     fly                                                       */
-  /*  3) add the singular and non-singular contributions           */
-  /*                                                               */
-  /*****************************************************************/
-  // step 1
-  GetPPIs_Cubature(Args, 1, 0, Va, Qa, Vb, Qb);
-
-  // step 2
-  QDFIPPIData MyQDFD, *QDFD=&MyQDFD;
-  if (Args->opFC)
-   GetQDFIPPIData(Va, Qa, Vb, Qb, ncv, Args->opFC, QDFD);
-  else
-   GetQDFIPPIData(Va, Qa, Vb, Qb, ncv, &GlobalFIPPICache, QDFD);
-
-  // step 3
-  // note: PF[n] = (ik)^n / (4\pi)
-  cdouble ik=II*k; 
-  cdouble OOIK2=1.0/(ik*ik);
-  cdouble PF[5];
-  PF[0]=1.0/(4.0*M_PI);
-  PF[1]=ik*PF[0];
-  PF[2]=ik*PF[1];
-  PF[3]=ik*PF[2];
-  PF[4]=ik*PF[3];
-
-  // add contributions to panel-panel integrals
-  H[0] +=  PF[0]*AA0*( QDFD->hDotRM1 + OOIK2*QDFD->hNablaRM1)
-          +PF[1]*AA1*( QDFD->hDotR0  + OOIK2*QDFD->hNablaR0 )
-          +PF[2]*AA2*( QDFD->hDotR1  + OOIK2*QDFD->hNablaR1 )
-          +PF[3]*AA3*( QDFD->hDotR2  + OOIK2*QDFD->hNablaR2 );
-  
-  H[1] +=  PF[0]*BB0*QDFD->hTimesRM3
-          +PF[2]*BB2*QDFD->hTimesRM1
-          +PF[3]*BB3*QDFD->hTimesR0 
-          +PF[4]*BB4*QDFD->hTimesR1;
+  GetNearPPIs(Args, PPIALG_DESING, ncv, Va, Qa, Vb, Qb, H);
 
   // restore derivative integrals as necessary 
   if (NumGradientComponents>0)
@@ -674,6 +848,8 @@ void InitGetPPIArgs(GetPPIArgStruct *Args)
   Args->opFC=0;
   Args->Displacement=0;
   Args->GInterp=0;
+  Args->Far=false;
+  Args->DVertex=0;
 }
 
 } // namespace scuff
@@ -67,9 +67,17 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 
 #include "libscuff.h"
 
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+#ifdef USE_OPENMP
+#  include <omp.h>
+#endif
+
 namespace scuff {
 
 /*************************************************************************/
@@ -484,6 +492,75 @@ static int kdtri_surface_piercings(kdtri t, const double p[3])
 
 /***********************************************************************/
 
+/* Test whether the segment from p to q intersects the triangle in b
+   (Moller-Trumbore).  The test is deliberately conservative: segments
+   that graze an edge or vertex, or have an endpoint (nearly) on the
+   triangle, count as intersecting. */
+static int segment_crosses_tri(const double p[3], const double q[3],
+                               const boxtri *b)
+{
+  const double eps = 1.0e-8;
+  double d[3], e1[3], e2[3], s[3], h[3], qv[3];
+  d[0] = q[0]-p[0]; d[1] = q[1]-p[1]; d[2] = q[2]-p[2];
+  e1[0] = b->x[1]-b->x[0]; e1[1] = b->y[1]-b->y[0]; e1[2] = b->z[1]-b->z[0];
+  e2[0] = b->x[2]-b->x[0]; e2[1] = b->y[2]-b->y[0]; e2[2] = b->z[2]-b->z[0];
+
+  h[0] = d[1]*e2[2] - d[2]*e2[1];
+  h[1] = d[2]*e2[0] - d[0]*e2[2];
+  h[2] = d[0]*e2[1] - d[1]*e2[0];
+  double a = e1[0]*h[0] + e1[1]*h[1] + e1[2]*h[2];
+  double scale = (fabs(e1[0])+fabs(e1[1])+fabs(e1[2]))
+                *(fabs(e2[0])+fabs(e2[1])+fabs(e2[2]))
+                *(fabs(d[0])+fabs(d[1])+fabs(d[2]));
+  if (fabs(a) <= eps*scale)
+    return scale==0.0 ? 0 : 1; /* (nearly) coplanar: don't trust it */
+
+  s[0] = p[0]-b->x[0]; s[1] = p[1]-b->y[0]; s[2] = p[2]-b->z[0];
+  double u = (s[0]*h[0] + s[1]*h[1] + s[2]*h[2]) / a;
+  if (u < -eps || u > 1.0+eps) return 0;
+
+  qv[0] = s[1]*e1[2] - s[2]*e1[1];
+  qv[1] = s[2]*e1[0] - s[0]*e1[2];
+  qv[2] = s[0]*e1[1] - s[1]*e1[0];
+  double v = (d[0]*qv[0] + d[1]*qv[1] + d[2]*qv[2]) / a;
+  if (v < -eps || u + v > 1.0+eps) return 0;
+
+  double t = (e2[0]*qv[0] + e2[1]*qv[1] + e2[2]*qv[2]) / a;
+  return (t >= -eps && t <= 1.0+eps);
+}
+
+/* return true if the segment from p to q (whose bounding box is lo, hi)
+   intersects any triangle in t */
+static int kdtri_segment_crosses(kdtri t, const double p[3], const double q[3],
+                                 const double lo[3], const double hi[3])
+{
+  if (!t) return 0;
+  if (lo[0] > t->bmax[0] || hi[0] < t->bmin[0] ||
+      lo[1] > t->bmax[1] || hi[1] < t->bmin[1] ||
+      lo[2] > t->bmax[2] || hi[2] < t->bmin[2])
+    return 0;
+
+  if (t->le) { /* search subtrees; see kdtri_partition for the split rule */
+    if (lo[t->dim] <= t->div && kdtri_segment_crosses(t->le, p, q, lo, hi))
+      return 1;
+    if (hi[t->dim] > t->div && kdtri_segment_crosses(t->gt, p, q, lo, hi))
+      return 1;
+    return 0;
+  }
+  else { /* we are at a leaf node: search directly */
+    size_t i, n = t->n;
+    boxtri *B = t->B;
+    for (i = 0; i < n; ++i)
+      if (lo[0] <= B[i].bmax[0] && hi[0] >= B[i].bmin[0] &&
+	  lo[1] <= B[i].bmax[1] && hi[1] >= B[i].bmin[1] &&
+	  segment_crosses_tri(p, q, B+i))
+	return 1;
+    return 0;
+  }
+}
+
+/***********************************************************************/
+
 /* Create a (tree-partitioned) kdtri object for the panels of S, using
    O(NumPanels) storage and O(NumPanels*log(NumPanels)) time.   Returns
    NULL if we ran out of memory. */
@@ -648,4 +725,140 @@ int RWGGeometry::GetRegionIndex(const double X[3])
 
 }
 
+/***************************************************************/
+/* return true if the line segment from X1 to X2 crosses any   */
+/* panel of any surface in the geometry.                       */
+/***************************************************************/
+static bool SegmentCrossesSurfaces(RWGGeometry *G, const double X1[3], const double X2[3])
+{
+  double lo[3], hi[3];
+  for(int i=0; i<3; i++)
+   { lo[i] = fmin(X1[i], X2[i]);
+     hi[i] = fmax(X1[i], X2[i]);
+   };
+
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   { 
+     RWGSurface *S=G->Surfaces[ns];
+
+     // quick rejection using the bounding box of the surface
+     if (    lo[0] > S->RMax[0] || hi[0] < S->RMin[0]
+          || lo[1] > S->RMax[1] || hi[1] < S->RMin[1]
+          || lo[2] > S->RMax[2] || hi[2] < S->RMin[2]
+        ) continue;
+
+     if ( kdtri_segment_crosses(S->kdPanels, X1, X2, lo, hi) )
+      return true;
+   };
+
+  return false;
+}
+
+/***************************************************************/
+/* interleave the low 21 bits of three integers to get a 63-bit*/
+/* Morton (Z-order) key                                        */
+/***************************************************************/
+static unsigned long long SpreadBits(unsigned long long n)
+{ 
+  n &= 0x1fffffULL;
+  n = (n | (n << 32)) & 0x1f00000000ffffULL;
+  n = (n | (n << 16)) & 0x1f0000ff0000ffULL;
+  n = (n | (n <<  8)) & 0x100f00f00f00f00fULL;
+  n = (n | (n <<  4)) & 0x10c30c30c30c30c3ULL;
+  n = (n | (n <<  2)) & 0x1249249249249249ULL;
+  return n;
+}
+
+typedef struct MortonPoint
+ { unsigned long long Key;
+   int Index;
+ } MortonPoint;
+
+static int CompareMortonPoints(const void *p1, const void *p2)
+{ 
+  unsigned long long K1=((const MortonPoint *)p1)->Key;
+  unsigned long long K2=((const MortonPoint *)p2)->Key;
+  return K1<K2 ? -1 : (K1>K2 ? 1 : 0);
+}
+
+/***************************************************************/
+/* batched version of GetRegionIndex: on return, Regions[nr]   */
+/* is the index of the region containing the point in row nr   */
+/* of XMatrix.                                                 */
+/*                                                             */
+/* how it works: we visit the points in Morton order, so that  */
+/* successive points are usually close together in space, and  */
+/* reuse the region index of the previous point whenever the   */
+/* segment joining the two points crosses no panel; we only    */
+/* fall back to a full GetRegionIndex() call if it does.       */
+/***************************************************************/
+void RWGGeometry::GetRegionIndices(HMatrix *XMatrix, int *Regions)
+{
+  int NX=XMatrix->NR;
+  if (NX==0) return;
+
+  for(int ns=0; ns<NumSurfaces; ns++)
+   Surfaces[ns]->InitkdPanels(false);
+
+  /*--------------------------------------------------------------*/
+  /*- sort the points along a Morton curve -----------------------*/
+  /*--------------------------------------------------------------*/
+  double XMin[3]={+1.0e89, +1.0e89, +1.0e89};
+  double XMax[3]={-1.0e89, -1.0e89, -1.0e89};
+  for(int nx=0; nx<NX; nx++)
+   for(int i=0; i<3; i++)
+    { XMin[i] = fmin(XMin[i], XMatrix->GetEntryD(nx,i));
+      XMax[i] = fmax(XMax[i], XMatrix->GetEntryD(nx,i));
+    };
+
+  double Scale[3];
+  for(int i=0; i<3; i++)
+   Scale[i] = (XMax[i]>XMin[i]) ? 2097151.0 / (XMax[i]-XMin[i]) : 0.0;
+
+  MortonPoint *MPs = (MortonPoint *)mallocEC(NX*sizeof(MortonPoint));
+  for(int nx=0; nx<NX; nx++)
+   { unsigned long long I[3];
+     for(int i=0; i<3; i++)
+      I[i] = (unsigned long long)( Scale[i]*(XMatrix->GetEntryD(nx,i) - XMin[i]) );
+     MPs[nx].Key   = SpreadBits(I[0]) | (SpreadBits(I[1])<<1) | (SpreadBits(I[2])<<2);
+     MPs[nx].Index = nx;
+   };
+  qsort(MPs, NX, sizeof(MortonPoint), CompareMortonPoints);
+
+  /*--------------------------------------------------------------*/
+  /*- walk the sorted list in contiguous chunks, one per task -----*/
+  /*--------------------------------------------------------------*/
+  int NumTasks=1;
+#ifdef USE_OPENMP
+  int NumThreads=GetNumThreads();
+  NumTasks=4*NumThreads;
+  if (NumTasks>NX) NumTasks=NX;
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+  for(int nt=0; nt<NumTasks; nt++)
+   { 
+     int Start = (nt*NX) / NumTasks;
+     int Stop  = ((nt+1)*NX) / NumTasks;
+     double X[3], XLast[3];
+     int LastRegion=-1;
+     for(int n=Start; n<Stop; n++)
+      { 
+        int nx=MPs[n].Index;
+        X[0]=XMatrix->GetEntryD(nx,0);
+        X[1]=XMatrix->GetEntryD(nx,1);
+        X[2]=XMatrix->GetEntryD(nx,2);
+
+        if ( LastRegion!=-1 && !SegmentCrossesSurfaces(this, XLast, X) )
+         Regions[nx] = LastRegion;
+        else
+         Regions[nx] = GetRegionIndex(X);
+
+        LastRegion=Regions[nx];
+        VecCopy(X, XLast);
+      };
+   };
+
+  free(MPs);
+}
+
 } // namespace scuff
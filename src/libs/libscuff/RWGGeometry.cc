@@ -47,6 +47,9 @@ bool RWGGeometry::AssignBasisFunctionsToExteriorEdges=true;
 double RWGGeometry::DeltaInterp=0.05;
 bool RWGGeometry::UseHighKTaylorDuffy=true;
 bool RWGGeometry::UseTaylorDuffyV2P0=true;
+double RWGGeometry::TreecodeTolerance=0.0;
+int RWGGeometry::TreecodeMinPoints=1000;
+char *RWGGeometry::SnapshotDir=0;
 int RWGGeometry::NumMeshDirs=0;
 char **RWGGeometry::MeshDirs=0;
 
@@ -201,6 +204,12 @@ RWGGeometry::RWGGeometry(const char *pGeoFileName, int pLogLevel)
      Log("Setting DeltaInterp to %g...",DeltaInterp);
    };
 
+  char *TreecodeStr;
+  if ( (TreecodeStr=getenv("SCUFF_FIELD_TREECODE")) )
+   { sscanf(TreecodeStr, "%le", &TreecodeTolerance);
+     Log("Using treecode field evaluation with tolerance %g...",TreecodeTolerance);
+   };
+
   /***************************************************************/
   /* NOTE: i am not sure where to put this. put it here for now. */
   /***************************************************************/
@@ -215,6 +224,9 @@ RWGGeometry::RWGGeometry(const char *pGeoFileName, int pLogLevel)
   Surfaces=0;
   AllSurfacesClosed=1;
   LDim=0;
+  NumMirrorPlanes=0;
+  MirrorData=0;
+  bool AutoMirror=false;
   tolVecClose=0.0; // to be updated once mesh is read in
   TBlockCacheNameAddendum=0;
 
@@ -296,6 +308,28 @@ RWGGeometry::RWGGeometry(const char *pGeoFileName, int pLogLevel)
         ProcessLATTICESection(f,GeoFileName,&LineNum);
         AssignBasisFunctionsToExteriorEdges=false;
       }
+     else if ( !StrCaseCmp(Tokens[0],"MIRROR_SYMMETRY") )
+      { 
+        /*--------------------------------------------------------------*/
+        /* MIRROR_SYMMETRY x [y] [z]: geometry is symmetric under the   */
+        /* reflections x->-x etc; MIRROR_SYMMETRY AUTO: detect these    */
+        /*--------------------------------------------------------------*/
+        if ( nTokens<2 || nTokens>4 )
+         ErrExit("%s:%i: MIRROR_SYMMETRY requires one to three arguments",GeoFileName,LineNum);
+        for(int nt=1; nt<nTokens; nt++)
+         { if ( !StrCaseCmp(Tokens[nt],"AUTO") )
+            AutoMirror=true;
+           else if ( strlen(Tokens[nt])==1 && strchr("xyzXYZ",Tokens[nt][0]) )
+            { int i=tolower(Tokens[nt][0]) - 'x';
+              for(int p=0; p<NumMirrorPlanes; p++)
+               if (MirrorPlanes[p]==i)
+                ErrExit("%s:%i: duplicate mirror plane %s",GeoFileName,LineNum,Tokens[nt]);
+              MirrorPlanes[NumMirrorPlanes++]=i;
+            }
+           else
+            ErrExit("%s:%i: invalid mirror plane %s",GeoFileName,LineNum,Tokens[nt]);
+         };
+      }
      else if ( !StrCaseCmp(Tokens[0],"MATERIAL") )
       {
         /*--------------------------------------------------------------*/
@@ -570,6 +604,7 @@ RWGGeometry::RWGGeometry(const char *pGeoFileName, int pLogLevel)
         int nr2p=SP->RegionIndices[1];
         if (    ( !strcmp(S->MeshFileName, SP->MeshFileName) )
              && ( S->MeshTag == SP->MeshTag )
+             && ( S->NumSlices == SP->NumSlices )
              && ( !strcmp(RegionMPs[nr1]->Name, RegionMPs[nr1p]->Name) )
              && (   (S->IsPEC && SP->IsPEC)
                  || (!S->IsPEC && !SP->IsPEC && !strcmp(RegionMPs[nr2]->Name, RegionMPs[nr2p]->Name) )
@@ -580,6 +615,30 @@ RWGGeometry::RWGGeometry(const char *pGeoFileName, int pLogLevel)
       };
    };
 
+  /***************************************************************/
+  /* the geometry as a whole is rotationally symmetric only if   */
+  /* all surfaces have the same symmetry; otherwise we just treat*/
+  /* the replicated surfaces like any other surface.             */
+  /***************************************************************/
+  NumSlices=Surfaces[0]->NumSlices;
+  for(int ns=1; ns<NumSurfaces; ns++)
+   if (Surfaces[ns]->NumSlices!=NumSlices)
+    { if (NumSlices>1 || Surfaces[ns]->NumSlices>1)
+       Warn("not all surfaces have the same rotational symmetry; symmetry will not be exploited");
+      NumSlices=1;
+      break;
+    };
+  if (NumSlices>1 && LDim>0)
+   ErrExit("%s: ROTATIONAL_SYMMETRY is not supported for periodic geometries",GeoFileName);
+  if (NumSlices>1)
+   Log("Geometry has %i-fold rotational symmetry.",NumSlices);
+
+  /***************************************************************/
+  /* set up mirror symmetry if requested                         */
+  /***************************************************************/
+  if (NumMirrorPlanes>0 || AutoMirror)
+   InitMirrorSymmetry(AutoMirror);
+
   /***************************************************************/
   /* initialize SurfaceMoved[] array.                            */
   /* the values of this array are only defined after             */
@@ -623,6 +682,7 @@ RWGGeometry::~RWGGeometry()
   free(MuTF);
   free(Mate);
   free(SurfaceMoved);
+  DestroyMirrorSymmetry();
   free(GeoFileName);
 
 }
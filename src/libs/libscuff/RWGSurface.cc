@@ -84,6 +84,7 @@ RWGSurface::RWGSurface(FILE *f, const char *pLabel, int *LineNum, char *Keyword)
   MeshTag=-1;
   MeshFileName=0;
   IsPEC=1;
+  NumSlices=1;
   Label = strdupEC(pLabel);
   tolVecClose=0.0; // to be updated once mesh is read in
 
@@ -205,6 +206,19 @@ RWGSurface::RWGSurface(FILE *f, const char *pLabel, int *LineNum, char *Keyword)
            return;
          };
       }
+     else if ( !StrCaseCmp(Tokens[0],"ROTATIONAL_SYMMETRY") )
+      { 
+        // the mesh file describes one of NumSlices identical slices
+        // related by rotation about the z-axis of the mesh file
+        if (NumTokens!=2)
+         { ErrMsg=strdupEC("ROTATIONAL_SYMMETRY keyword requires one argument");
+           return;
+         };
+        if ( 1!=sscanf(Tokens[1],"%i",&NumSlices) || NumSlices<1 )
+         { ErrMsg=vstrdup("invalid ROTATIONAL_SYMMETRY order %s",Tokens[1]);
+           return;
+         };
+      }
      else if ( !StrCaseCmp(Tokens[0],"SURFACE_CONDUCTIVITY") )
       { 
         if (NumTokens<2)
@@ -298,6 +312,7 @@ RWGSurface::RWGSurface(const char *MeshFile, int pMeshTag)
   MaterialName=0;
   RegionLabels[0]=RegionLabels[1]=0;
   IsPEC=1;
+  NumSlices=1;
   tolVecClose=0.0; // to be updated once mesh is read in
   InitRWGSurface();
 }
@@ -317,6 +332,11 @@ void RWGSurface::InitRWGSurface(const GTransformation *OTGT)
 { 
   ErrMsg=0;
   kdPanels = NULL;
+  ECTree = NULL;
+  EdgeBlock = NULL;
+  EdgeMoved = NULL;
+  SpatialOrder = NULL;
+  NumOrderedEdges = 0;
 
   /*------------------------------------------------------------*/
   /*- try to open the mesh file. we look in several places:     */
@@ -352,6 +372,25 @@ void RWGSurface::InitRWGSurface(const GTransformation *OTGT)
   /*------------------------------------------------------------*/
   GT=0;
 
+  /*------------------------------------------------------------*/
+  /*- if geometry snapshots are enabled and we have a snapshot  */
+  /*- matching the contents of the mesh file and the surface    */
+  /*- parameters, we can skip everything below.                 */
+  /*------------------------------------------------------------*/
+  unsigned long long SnapshotKey=0;
+  FromSnapshot=false;
+  if (RWGGeometry::SnapshotDir)
+   { SnapshotKey=GetSnapshotKey(MeshFile, OTGT);
+     if ( ReadSnapshot(SnapshotKey) )
+      { fclose(MeshFile);
+        FromSnapshot=true;
+        NumBFs = IsPEC ? NumEdges : 2*NumEdges;
+        IsClosed = (NumExteriorEdges == 0);
+        UpdateBoundingBox();
+        return;
+      };
+   };
+
   /*------------------------------------------------------------*/
   /*- Switch off based on the file type to read the mesh file:  */
   /*-  1. file extension=.msh    --> ReadGMSHFile              -*/
@@ -380,6 +419,13 @@ void RWGSurface::InitRWGSurface(const GTransformation *OTGT)
       ErrExit("file %s: no panels found for mesh tag %i",MeshFileName,MeshTag);
    };
 
+  /*------------------------------------------------------------*/
+  /*- if the mesh file describes one slice of a rotationally   -*/
+  /*- symmetric surface, build the full surface from it.       -*/
+  /*------------------------------------------------------------*/
+  if (NumSlices>1)
+   ReplicateSlice(OTGT);
+
   /*------------------------------------------------------------*/
   /*- Now that we have put the panels in an array, go through  -*/
   /*- and fill in the Index field of each panel structure.     -*/
@@ -415,6 +461,13 @@ void RWGSurface::InitRWGSurface(const GTransformation *OTGT)
      Log("Promoted %i exterior edges for surface %s to half-RWG basis functions.",NumExteriorEdges,Label);
    };
 
+  /*------------------------------------------------------------*/
+  /*- for rotationally symmetric surfaces, order the edges by  -*/
+  /*- slice so that the BEM matrix is block-circulant.         -*/
+  /*------------------------------------------------------------*/
+  if (NumSlices>1)
+   SortEdgesBySlice();
+
   /*------------------------------------------------------------*/
   /*- now that we have put the edges into a list, we can go    -*/
   /*- back and fill in the EdgeIndices field in each RWGPanel. -*/
@@ -447,6 +500,9 @@ void RWGSurface::InitRWGSurface(const GTransformation *OTGT)
 
   UpdateBoundingBox();
 
+  if (RWGGeometry::SnapshotDir)
+   WriteSnapshot(SnapshotKey);
+
 } 
 
 /*--------------------------------------------------------------*/
@@ -460,6 +516,11 @@ RWGSurface::RWGSurface(double *pVertices, int pNumVertices,
 { 
   ErrMsg=0;
   kdPanels = NULL;
+  ECTree = NULL;
+  EdgeBlock = NULL;
+  EdgeMoved = NULL;
+  SpatialOrder = NULL;
+  NumOrderedEdges = 0;
 
   MeshFileName=strdupEC("ByHand.msh");
   Label=strdupEC("ByHand");
@@ -473,7 +534,9 @@ RWGSurface::RWGSurface(double *pVertices, int pNumVertices,
   RegionIndices[1]=-1;
   IsPEC=1;
   IsObject=1;
+  NumSlices=1;
   GT=0;
+  FromSnapshot=false;
 
   Vertices=(double *)mallocEC(3*NumVertices*sizeof(double));
   memcpy(Vertices,pVertices,3*NumVertices*sizeof(double *));
@@ -559,13 +622,9 @@ RWGSurface::~RWGSurface()
    free(Panels[np]);
   free(Panels);
 
-  int ne;
-  for(ne=0; ne<NumEdges; ne++)
-   free(Edges[ne]);
+  // all RWGEdge structures, interior and exterior, live in EdgeBlock
+  free(EdgeBlock);
   free(Edges);
-
-  for(ne=0; ne<NumExteriorEdges; ne++)
-   free(ExteriorEdges[ne]);
   free(ExteriorEdges);
 
   int nbc;
@@ -579,12 +638,15 @@ RWGSurface::~RWGSurface()
   if (Label) free(Label);
   if (ErrMsg) free(ErrMsg);
   if (GT) delete GT;
+  if (EdgeMoved) free(EdgeMoved);
+  if (SpatialOrder) free(SpatialOrder);
 
   if (MaterialName) free(MaterialName);
   if (RegionLabels[0]) free(RegionLabels[0]);
   if (RegionLabels[1]) free(RegionLabels[1]);
 
   kdtri_destroy(kdPanels);
+  ClearEdgeClusterTree();
 }
 
 /***************************************************************/
@@ -614,6 +676,7 @@ void RWGSurface::Transform(const GTransformation *DeltaGT)
    InitRWGPanel(Panels[np], Vertices);
 
   UpdateBoundingBox();
+  ClearEdgeClusterTree();
 
   /***************************************************************/
   /* update the internally stored GTransformation ****************/
@@ -663,6 +726,7 @@ void RWGSurface::UnTransform()
    InitRWGPanel(Panels[np], Vertices);
 
   UpdateBoundingBox();
+  ClearEdgeClusterTree();
 
   /***************************************************************/
   /***************************************************************/
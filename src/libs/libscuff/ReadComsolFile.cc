@@ -28,29 +28,32 @@
 #include <string.h>
 #include <ctype.h>
 
+#include <libhrutil.h>
+
 #include "libscuff.h"
+#include "libscuffInternals.h"
 
 namespace scuff {
 
-#define MAXSTR 1000
-
 /***************************************************************/
-/* Given an open file f, read lines until one is found that    */
-/* contains the given search string. Returns the number of     */
-/* lines read or 0 if the file ended before the string was     */
-/* found. If the return value is nonzero, Line contains the    */
-/* last line read from the file.                               */
+/* line parsers for the vertex and element sections; UserData  */
+/* points to the RWGSurface being constructed.                 */
 /***************************************************************/
-static int SkipTo(FILE *f, const char *SearchString, char *Line)
-{ 
-  int Lines=0;
+static bool ParseVertexLine(const char *Line, int nv, void *UserData)
+{ double *V=((RWGSurface *)UserData)->Vertices + 3*nv;
+  return ScanDouble(&Line, V+0) && ScanDouble(&Line, V+1) && ScanDouble(&Line, V+2);
+}
 
-  while( fgets(Line,MAXSTR,f) )
-   { Lines++;
-     if (strstr(Line,SearchString))
-      return Lines;
-   };
-  return 0;
+static bool ParseElementLine(const char *Line, int np, void *UserData)
+{ RWGSurface *S=(RWGSurface *)UserData;
+  int n1, n2, n3;
+  if ( !ScanInt(&Line, &n1) || !ScanInt(&Line, &n2) || !ScanInt(&Line, &n3) )
+   return false;
+  if ( n1<0 || n1>=S->NumVertices || n2<0 || n2>=S->NumVertices || n3<0 || n3>=S->NumVertices )
+   return false;
+  S->Panels[np]=NewRWGPanel(S->Vertices,n1,n2,n3);
+  S->Panels[np]->Index=np;
+  return true;
 }
 
 /***************************************************************/
@@ -60,41 +63,32 @@ static int SkipTo(FILE *f, const char *SearchString, char *Line)
 void RWGSurface::ReadComsolFile(FILE *MeshFile, char *FileName, 
                                 const GTransformation *OTGT)
 { 
-  char Line[MAXSTR];
-  int nv, np, n1, n2, n3, LineNum, LinesRead, nConv;
-  
-  LineNum=0;
+  const char *Line, *p;
+  int BadLine;
+
+  MeshFileBuffer *MFB=OpenMeshFileBuffer(MeshFile, FileName);
  
   /***************************************************************/
   /* skip down to node definition section                        */
   /***************************************************************/
-  LinesRead=SkipTo(MeshFile,"# number of mesh points",Line);
-  if (LinesRead==0)
+  if ( !(Line=SkipToMeshLine(MFB,"# number of mesh points")) )
    ErrExit("%s: failed to find line '#number of mesh points'",FileName);
-  LineNum+=LinesRead;
 
-  nConv=sscanf(Line,"%i ",&NumVertices);
-  if (nConv!=1 || NumVertices<0 || NumVertices>10000000)
-   ErrExit("%s:%i: too many vertices(%i)",FileName,LineNum,NumVertices);
+  p=Line;
+  if ( !ScanInt(&p, &NumVertices) || NumVertices<0 )
+   ErrExit("%s:%i: invalid number of vertices",FileName,MFB->LineNum);
 
-  LinesRead=SkipTo(MeshFile,"# Mesh point coordinates",Line);
-  if (LinesRead==0)
+  if ( !SkipToMeshLine(MFB,"# Mesh point coordinates") )
    ErrExit("%s: failed to find line '#Mesh point coordinates'",FileName);
-  LineNum+=LinesRead;
 
   /***************************************************************/
   /* read vertices ***********************************************/
   /***************************************************************/
-  Vertices=(double *)mallocEC(3*NumVertices*sizeof(double *));
-  for(nv=0; nv<NumVertices; nv++)
-   { 
-     if ( !fgets(Line,MAXSTR,MeshFile) )
+  Vertices=(double *)mallocEC((3*NumVertices+1)*sizeof(double));
+  if ( (BadLine=ParseMeshLines(MFB, NumVertices, ParseVertexLine, this)) )
+   { if (BadLine==-1)
       ErrExit("%s: unexpected end of file",FileName);
-     LineNum++;
-
-     if ( 3!=sscanf(Line,"%le %le %le",
-                    Vertices+3*nv,Vertices+3*nv+1,Vertices+3*nv+2))
-      ErrExit("%s:%i: syntax error",FileName,LineNum);
+     ErrExit("%s:%i: syntax error",FileName,BadLine);
    };
 
   /***************************************************************/
@@ -105,44 +99,34 @@ void RWGSurface::ReadComsolFile(FILE *MeshFile, char *FileName,
   /***************************************************************/
   /* skip down to element definition section *********************/
   /***************************************************************/
-  LinesRead=SkipTo(MeshFile,"3 # number of nodes per element",Line);
-  if (LinesRead==0)
+  if ( !SkipToMeshLine(MFB,"3 # number of nodes per element") )
    ErrExit("%s: failed to find line '3 #number of nodes per element'", FileName);
-  LineNum+=LinesRead;
 
-  if ( !fgets(Line,MAXSTR,MeshFile) )
+  if ( !(Line=GetMeshLine(MFB)) )
    ErrExit("%s: unexpected end of file",FileName);
-  LineNum++;
-  nConv=sscanf(Line,"%i",&NumPanels);
-  if (nConv!=1 || !strstr(Line,"# number of elements"))
-   ErrExit("%s:%i: syntax error",FileName,LineNum);
+  p=Line;
+  if ( !ScanInt(&p, &NumPanels) || NumPanels<0 || !MeshLineContains(Line,"# number of elements") )
+   ErrExit("%s:%i: syntax error",FileName,MFB->LineNum);
 
-  if ( !fgets(Line,MAXSTR,MeshFile) )
+  if ( !(Line=GetMeshLine(MFB)) )
    ErrExit("%s: unexpected end of file",FileName);
-  LineNum++;
-  if ( !strstr(Line,"# Elements") )
-   ErrExit("%s:%i: syntax error",FileName,LineNum);
+  if ( !MeshLineContains(Line,"# Elements") )
+   ErrExit("%s:%i: syntax error",FileName,MFB->LineNum);
 
   /***************************************************************/
   /* read panels    **********************************************/ 
   /***************************************************************/
-  Panels=(RWGPanel **)mallocEC(NumPanels*sizeof(Panels[0]));
-  for(np=0; np<NumPanels; np++)
-   { 
-     if ( !fgets(Line,MAXSTR,MeshFile) )
+  Panels=(RWGPanel **)mallocEC((NumPanels+1)*sizeof(Panels[0]));
+  if ( (BadLine=ParseMeshLines(MFB, NumPanels, ParseElementLine, this)) )
+   { if (BadLine==-1)
       ErrExit("%s: unexpected end of file",FileName);
-     LineNum++;
-
-     if ( 3!=sscanf(Line,"%i %i %i",&n1,&n2,&n3) )
-      ErrExit("%s:%i: syntax error",FileName,LineNum); 
- 
-     Panels[np]=NewRWGPanel(Vertices,n1,n2,n3);
-     Panels[np]->Index=np;
+     ErrExit("%s:%i: syntax error",FileName,BadLine);
    };
 
   /***************************************************************/
   /* ignore the rest of the file and we are done *****************/
   /***************************************************************/
+  CloseMeshFileBuffer(MFB);
   fclose(MeshFile);
 
 } 
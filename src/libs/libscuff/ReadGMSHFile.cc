@@ -20,6 +20,19 @@
 /*
  * ReadGMSHFile.cc -- subroutine of the RWGSurface class constructor
  *
+ * supported file formats:
+ *
+ *  -- legacy ($NOD / $ELM) format
+ *  -- MSH 2.x, ASCII or binary
+ *  -- MSH 4.1, ASCII or binary
+ *
+ * the file is read through a MeshFileBuffer (see MeshFileBuffer.cc);
+ * ASCII node and element lists are parsed in parallel, and binary
+ * node and element lists are copied straight out of the buffer.
+ * in MSH 4.1 files, physical tags are attached to geometric entities
+ * rather than to elements, so the $Entities section is used to
+ * decide which triangles belong to the requested MESHTAG.
+ *
  * homer reid    -- 3/2007 
  */
 
@@ -27,8 +40,12 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
+
+#include <libhrutil.h>
 
 #include "libscuff.h"
+#include "libscuffInternals.h"
 
 namespace scuff {
 
@@ -38,6 +55,12 @@ namespace scuff {
 #define TYPE_TRIANGLE 2
 #define TYPE_POINT    15
 
+#define FORMAT_KEYWORD      "$MeshFormat"
+#define FORMAT_END_KEYWORD  "$EndMeshFormat"
+
+#define ENTITIES_KEYWORD     "$Entities"
+#define ENTITIES_END_KEYWORD "$EndEntities"
+
 #define NODE_START_KEYWORD1 "$NOD"
 #define NODE_START_KEYWORD2 "$Nodes"
 
@@ -51,10 +74,638 @@ namespace scuff {
 #define ELM_END_KEYWORD2    "$EndElements"
 
 #define FORMAT_LEGACY 0
-#define FORMAT_NEW    1
+#define FORMAT_V2     1
+#define FORMAT_V4     2
 
 #define MAXREFPTS 100
 
+/*************************************************************/
+/* number of nodes for each GMSH element type; needed to step*/
+/* over elements we don't care about in binary files.        */
+/*************************************************************/
+static int GMSHNodesPerElement(int ElType)
+{
+  static const int NumNodes[32]=
+   { 0,  2,  3,  4,  4,  8,  6,  5,  3,  6,  9, 10, 27, 18, 14,  1,
+     8, 20, 15, 13,  9, 10, 12, 15, 15, 21,  4,  5,  6, 20, 35, 56 };
+  if (ElType<1 || ElType>31)
+   return -1;
+  return NumNodes[ElType];
+}
+
+/*************************************************************/
+/* element record: only points and triangles are kept, and   */
+/* V[] holds GMSH node tags (not yet mapped to our indices)  */
+/*************************************************************/
+typedef struct GMSHElement
+ { int Type;
+   int Include;  // =1 if the element lies on the requested physical region
+   int V[3];
+ } GMSHElement;
+
+/*************************************************************/
+/* data shared among the routines in this file               */
+/*************************************************************/
+typedef struct GMSHData
+ {
+   MeshFileBuffer *MFB;
+   const char *FileName;
+   int Format;
+   bool Binary;
+   int DataSize;
+   int MeshTag;
+
+   int NumNodes;
+   int *NodeTags;
+   double *Coords;
+
+   int NumElements;
+   GMSHElement *Elements;
+
+   // MSH 4.1 only: surface entities and whether each lies on MeshTag
+   int NumSurfaceEntities;
+   int *SurfaceEntityTags;
+   int *SurfaceEntitySelected;
+
+   // offset and element type of the current block (MSH 4.1)
+   int Offset;
+   int BlockType, BlockInclude;
+
+ } GMSHData;
+
+/*************************************************************/
+/* small helpers for reading header lines and binary data    */
+/*************************************************************/
+static const char *GetHeaderLine(GMSHData *GD)
+{ const char *Line=GetMeshLine(GD->MFB);
+  if (!Line)
+   ErrExit("%s: unexpected end of file",GD->FileName);
+  return Line;
+}
+
+static int ReadBinaryInt(GMSHData *GD)
+{ int i;
+  if ( !ReadMeshBytes(GD->MFB, &i, sizeof(int)) )
+   ErrExit("%s: unexpected end of file",GD->FileName);
+  return i;
+}
+
+static int ReadBinarySize(GMSHData *GD)
+{ size_t s;
+  if ( !ReadMeshBytes(GD->MFB, &s, sizeof(size_t)) )
+   ErrExit("%s: unexpected end of file",GD->FileName);
+  if ( s > (size_t)INT_MAX )
+   ErrExit("%s: count or tag too large (%lu)",GD->FileName,(unsigned long)s);
+  return (int)s;
+}
+
+static const char *GetBinaryBlock(GMSHData *GD, size_t NumBytes)
+{ const char *Block=GD->MFB->Data + GD->MFB->Pos;
+  if ( !ReadMeshBytes(GD->MFB, 0, NumBytes) )
+   ErrExit("%s: unexpected end of file",GD->FileName);
+  return Block;
+}
+
+static int ReadHeaderCount(GMSHData *GD, const char *What)
+{ const char *p=GetHeaderLine(GD);
+  long Count;
+  if ( !ScanInt(&p, &Count) || Count<0 || Count>INT_MAX )
+   ErrExit("%s:%i: invalid number of %s",GD->FileName,GD->MFB->LineNum,What);
+  return (int)Count;
+}
+
+/* read the end-of-section keyword; in binary files, the binary */
+/* data are followed by a newline before the keyword            */
+static void ExpectKeyword(GMSHData *GD, const char *Keyword)
+{ const char *Line=GetHeaderLine(GD);
+  if ( GD->Binary && (*Line=='\n' || *Line=='\r') )
+   Line=GetHeaderLine(GD);
+  if ( !MeshLineIs(Line, Keyword) )
+   ErrExit("%s:%i: unexpected keyword (expected %s)",GD->FileName,GD->MFB->LineNum,Keyword);
+}
+
+static void SkipSection(GMSHData *GD, const char *Keyword)
+{ const char *Line;
+  while( (Line=GetMeshLine(GD->MFB)) )
+   if ( !strncmp(Line,"$End",4) || !strncmp(Line,"$END",4) )
+    return;
+  ErrExit("%s: section %s not terminated",GD->FileName,Keyword);
+}
+
+/*************************************************************/
+/* $MeshFormat section                                       */
+/*************************************************************/
+static void ReadMeshFormat(GMSHData *GD)
+{
+  const char *p=GetHeaderLine(GD);
+  double Version;
+  int FileType;
+  if (    !ScanDouble(&p, &Version)
+       || !ScanInt(&p, &FileType)
+       || !ScanInt(&p, &(GD->DataSize))
+     )
+   ErrExit("%s:%i: invalid mesh format specification",GD->FileName,GD->MFB->LineNum);
+
+  if ( Version < 3.0 )
+   GD->Format=FORMAT_V2;
+  else if ( Version >= 4.1 && Version < 5.0 )
+   GD->Format=FORMAT_V4;
+  else
+   ErrExit("%s: MSH format version %g is not supported (use 2.2 or 4.1)",GD->FileName,Version);
+
+  GD->Binary = (FileType==1);
+  if (GD->Binary)
+   { int One=ReadBinaryInt(GD);
+     if (One!=1)
+      ErrExit("%s: binary mesh file has wrong byte order",GD->FileName);
+     if ( GD->DataSize!=sizeof(double) || (GD->Format==FORMAT_V4 && GD->DataSize!=sizeof(size_t)) )
+      ErrExit("%s: unsupported data size %i",GD->FileName,GD->DataSize);
+   };
+
+  ExpectKeyword(GD, FORMAT_END_KEYWORD);
+}
+
+/*************************************************************/
+/* $Entities section (MSH 4.1): record which surface entities*/
+/* carry the physical tag we are looking for                 */
+/*************************************************************/
+static int HasMeshTag(GMSHData *GD, int NumPhysicalTags, const int *PhysicalTags)
+{ if (GD->MeshTag==-1) return 1;
+  for(int n=0; n<NumPhysicalTags; n++)
+   if (PhysicalTags[n]==GD->MeshTag)
+    return 1;
+  return 0;
+}
+
+static void ReadEntities(GMSHData *GD)
+{
+  if (GD->Format!=FORMAT_V4)
+   { SkipSection(GD, ENTITIES_KEYWORD);
+     return;
+   };
+
+  int NumEntities[4];
+  if (GD->Binary)
+   { for(int d=0; d<4; d++)
+      NumEntities[d]=ReadBinarySize(GD);
+   }
+  else
+   { const char *p=GetHeaderLine(GD);
+     for(int d=0; d<4; d++)
+      if ( !ScanInt(&p, NumEntities+d) || NumEntities[d]<0 )
+       ErrExit("%s:%i: invalid entity counts",GD->FileName,GD->MFB->LineNum);
+   };
+
+  GD->NumSurfaceEntities=NumEntities[2];
+  GD->SurfaceEntityTags=(int *)mallocEC((NumEntities[2]+1)*sizeof(int));
+  GD->SurfaceEntitySelected=(int *)mallocEC((NumEntities[2]+1)*sizeof(int));
+
+  int MaxPhys=16;
+  int *PhysicalTags=(int *)mallocEC(MaxPhys*sizeof(int));
+  for(int d=0; d<4; d++)
+   for(int ne=0; ne<NumEntities[d]; ne++)
+    {
+      int Tag, NumPhys;
+
+      if (GD->Binary)
+       { Tag=ReadBinaryInt(GD);
+         GetBinaryBlock(GD, (d==0 ? 3 : 6)*sizeof(double));
+         NumPhys=ReadBinarySize(GD);
+         if (NumPhys>MaxPhys)
+          PhysicalTags=(int *)realloc(PhysicalTags, (MaxPhys=NumPhys)*sizeof(int));
+         for(int n=0; n<NumPhys; n++)
+          PhysicalTags[n]=ReadBinaryInt(GD);
+         if (d>0)
+          { int NumBounding=ReadBinarySize(GD);
+            GetBinaryBlock(GD, NumBounding*sizeof(int));
+          };
+       }
+      else
+       { const char *p=GetHeaderLine(GD);
+         double Dummy;
+         bool OK=ScanInt(&p, &Tag);
+         for(int n=0; OK && n<(d==0 ? 3 : 6); n++)
+          OK=ScanDouble(&p, &Dummy);
+         OK = OK && ScanInt(&p, &NumPhys) && NumPhys>=0;
+         if (OK && NumPhys>MaxPhys)
+          PhysicalTags=(int *)realloc(PhysicalTags, (MaxPhys=NumPhys)*sizeof(int));
+         for(int n=0; OK && n<NumPhys; n++)
+          OK=ScanInt(&p, PhysicalTags+n);
+         if (!OK)
+          ErrExit("%s:%i: invalid entity specification",GD->FileName,GD->MFB->LineNum);
+       };
+
+      if (d==2)
+       { GD->SurfaceEntityTags[ne]=Tag;
+         GD->SurfaceEntitySelected[ne]=HasMeshTag(GD, NumPhys, PhysicalTags);
+       };
+    };
+  free(PhysicalTags);
+
+  ExpectKeyword(GD, ENTITIES_END_KEYWORD);
+}
+
+static int SurfaceEntitySelected(GMSHData *GD, int Tag)
+{ if (GD->MeshTag==-1) return 1;
+  for(int n=0; n<GD->NumSurfaceEntities; n++)
+   if (GD->SurfaceEntityTags[n]==Tag)
+    return GD->SurfaceEntitySelected[n];
+  return 0;
+}
+
+/*************************************************************/
+/* line parsers for ASCII node sections                      */
+/*************************************************************/
+static bool ParseNodeLine(const char *Line, int nl, void *UserData)
+{ GMSHData *GD=(GMSHData *)UserData;
+  double *X=GD->Coords + 3*nl;
+  return    ScanInt(&Line, GD->NodeTags + nl)
+         && ScanDouble(&Line, X+0)
+         && ScanDouble(&Line, X+1)
+         && ScanDouble(&Line, X+2);
+}
+
+static bool ParseNodeTagLine(const char *Line, int nl, void *UserData)
+{ GMSHData *GD=(GMSHData *)UserData;
+  return ScanInt(&Line, GD->NodeTags + GD->Offset + nl);
+}
+
+static bool ParseNodeCoordLine(const char *Line, int nl, void *UserData)
+{ GMSHData *GD=(GMSHData *)UserData;
+  double *X=GD->Coords + 3*(GD->Offset + nl);
+  return ScanDouble(&Line, X+0) && ScanDouble(&Line, X+1) && ScanDouble(&Line, X+2);
+}
+
+/*************************************************************/
+/* $Nodes / $NOD section                                     */
+/*************************************************************/
+static void ReadNodes(GMSHData *GD)
+{
+  int BadLine;
+
+  /*------------------------------------------------------------*/
+  /*- legacy and 2.x formats: a count followed by one record   -*/
+  /*- per node                                                 -*/
+  /*------------------------------------------------------------*/
+  if (GD->Format!=FORMAT_V4)
+   {
+     int NumNodes=GD->NumNodes=ReadHeaderCount(GD, "nodes");
+     if (NumNodes==0)
+      ErrExit("%s: invalid number of nodes",GD->FileName);
+     GD->NodeTags=(int *)mallocEC(NumNodes*sizeof(int));
+     GD->Coords=(double *)mallocEC(3*NumNodes*sizeof(double));
+
+     if (GD->Binary)
+      { size_t RecSize=sizeof(int) + 3*sizeof(double);
+        const char *Block=GetBinaryBlock(GD, NumNodes*RecSize);
+#ifdef USE_OPENMP
+        int NumThreads=GetNumThreads();
+#pragma omp parallel for schedule(static), num_threads(NumThreads)
+#endif
+        for(int nn=0; nn<NumNodes; nn++)
+         { memcpy(GD->NodeTags + nn, Block + nn*RecSize, sizeof(int));
+           memcpy(GD->Coords + 3*nn, Block + nn*RecSize + sizeof(int), 3*sizeof(double));
+         };
+      }
+     else if ( (BadLine=ParseMeshLines(GD->MFB, NumNodes, ParseNodeLine, GD)) )
+      { if (BadLine==-1)
+         ErrExit("%s: too few nodes",GD->FileName);
+        ErrExit("%s:%i: invalid node specification",GD->FileName,BadLine);
+      };
+
+     ExpectKeyword(GD, GD->Format==FORMAT_LEGACY ? NODE_END_KEYWORD1 : NODE_END_KEYWORD2);
+     return;
+   };
+
+  /*------------------------------------------------------------*/
+  /*- 4.1 format: nodes come in entity blocks, each consisting -*/
+  /*- of a list of tags followed by a list of coordinates      -*/
+  /*------------------------------------------------------------*/
+  int NumBlocks, NumNodes;
+  if (GD->Binary)
+   { NumBlocks=ReadBinarySize(GD);
+     NumNodes=ReadBinarySize(GD);
+     ReadBinarySize(GD); // min tag
+     ReadBinarySize(GD); // max tag
+   }
+  else
+   { const char *p=GetHeaderLine(GD);
+     if ( !ScanInt(&p, &NumBlocks) || !ScanInt(&p, &NumNodes) || NumBlocks<0 || NumNodes<=0 )
+      ErrExit("%s:%i: invalid number of nodes",GD->FileName,GD->MFB->LineNum);
+   };
+  GD->NumNodes=NumNodes;
+  GD->NodeTags=(int *)mallocEC(NumNodes*sizeof(int));
+  GD->Coords=(double *)mallocEC(3*NumNodes*sizeof(double));
+
+  int Offset=0;
+  for(int nb=0; nb<NumBlocks; nb++)
+   {
+     int EntityDim, Parametric, NumInBlock;
+     if (GD->Binary)
+      { EntityDim=ReadBinaryInt(GD);
+        ReadBinaryInt(GD); // entity tag
+        Parametric=ReadBinaryInt(GD);
+        NumInBlock=ReadBinarySize(GD);
+      }
+     else
+      { const char *p=GetHeaderLine(GD);
+        int EntityTag;
+        if (    !ScanInt(&p, &EntityDim) || !ScanInt(&p, &EntityTag)
+             || !ScanInt(&p, &Parametric) || !ScanInt(&p, &NumInBlock)
+             || NumInBlock<0
+           )
+         ErrExit("%s:%i: invalid node block",GD->FileName,GD->MFB->LineNum);
+      };
+     if ( Offset + NumInBlock > NumNodes )
+      ErrExit("%s: too many nodes",GD->FileName);
+
+     if (GD->Binary)
+      {
+        int NumParams = (Parametric && (EntityDim==1 || EntityDim==2)) ? EntityDim : 0;
+        size_t XSize = (3+NumParams)*sizeof(double);
+        const char *TagBlock=GetBinaryBlock(GD, NumInBlock*sizeof(size_t));
+        const char *XBlock=GetBinaryBlock(GD, NumInBlock*XSize);
+#ifdef USE_OPENMP
+        int NumThreads=GetNumThreads();
+#pragma omp parallel for schedule(static), num_threads(NumThreads)
+#endif
+        for(int nn=0; nn<NumInBlock; nn++)
+         { size_t Tag;
+           memcpy(&Tag, TagBlock + nn*sizeof(size_t), sizeof(size_t));
+           GD->NodeTags[Offset+nn] = (Tag > (size_t)INT_MAX) ? -1 : (int)Tag;
+           memcpy(GD->Coords + 3*(Offset+nn), XBlock + nn*XSize, 3*sizeof(double));
+         };
+      }
+     else
+      { GD->Offset=Offset;
+        if ( (BadLine=ParseMeshLines(GD->MFB, NumInBlock, ParseNodeTagLine, GD)) )
+         ErrExit("%s:%i: invalid node tag",GD->FileName,BadLine==-1 ? GD->MFB->LineNum : BadLine);
+        if ( (BadLine=ParseMeshLines(GD->MFB, NumInBlock, ParseNodeCoordLine, GD)) )
+         ErrExit("%s:%i: invalid node coordinates",GD->FileName,BadLine==-1 ? GD->MFB->LineNum : BadLine);
+      };
+
+     Offset+=NumInBlock;
+   };
+  if (Offset!=NumNodes)
+   ErrExit("%s: too few nodes",GD->FileName);
+
+  ExpectKeyword(GD, NODE_END_KEYWORD2);
+}
+
+/*************************************************************/
+/* line parsers for ASCII element sections                   */
+/*************************************************************/
+static bool GetElementNodes(const char **p, GMSHElement *E)
+{
+  if (E->Type==TYPE_POINT)
+   return ScanInt(p, E->V+0);
+  else if (E->Type==TYPE_TRIANGLE)
+   return ScanInt(p, E->V+0) && ScanInt(p, E->V+1) && ScanInt(p, E->V+2);
+  return true;
+}
+
+static bool ParseLegacyElementLine(const char *Line, int nl, void *UserData)
+{ GMSHData *GD=(GMSHData *)UserData;
+  GMSHElement *E=GD->Elements + nl;
+  int ElNum, RegPhys, RegElem, NodeCnt;
+  if (    !ScanInt(&Line, &ElNum) || !ScanInt(&Line, &(E->Type))
+       || !ScanInt(&Line, &RegPhys) || !ScanInt(&Line, &RegElem)
+       || !ScanInt(&Line, &NodeCnt)
+     ) return false;
+  E->Include = (GD->MeshTag==-1 || GD->MeshTag==RegPhys);
+  return GetElementNodes(&Line, E);
+}
+
+static bool ParseV2ElementLine(const char *Line, int nl, void *UserData)
+{ GMSHData *GD=(GMSHData *)UserData;
+  GMSHElement *E=GD->Elements + nl;
+  int ElNum, NumTags, RegPhys=0, Tag;
+  if ( !ScanInt(&Line, &ElNum) || !ScanInt(&Line, &(E->Type)) || !ScanInt(&Line, &NumTags) )
+   return false;
+
+  // the first 'tag' is the physical region
+  for(int nt=0; nt<NumTags; nt++)
+   { if (!ScanInt(&Line, &Tag))
+      return false;
+     if (nt==0) RegPhys=Tag;
+   };
+  E->Include = (GD->MeshTag==-1 || GD->MeshTag==RegPhys);
+  return GetElementNodes(&Line, E);
+}
+
+static bool ParseV4ElementLine(const char *Line, int nl, void *UserData)
+{ GMSHData *GD=(GMSHData *)UserData;
+  GMSHElement *E=GD->Elements + GD->Offset + nl;
+  long ElTag;
+  E->Type=GD->BlockType;
+  E->Include=GD->BlockInclude;
+  return ScanInt(&Line, &ElTag) && GetElementNodes(&Line, E);
+}
+
+/*************************************************************/
+/* $Elements / $ELM section                                  */
+/*************************************************************/
+static void ReadElements(GMSHData *GD)
+{
+  int BadLine;
+
+  /*------------------------------------------------------------*/
+  /*- legacy and 2.x ASCII formats: one element per line       -*/
+  /*------------------------------------------------------------*/
+  if ( GD->Format!=FORMAT_V4 && !GD->Binary )
+   {
+     int NumElements=GD->NumElements=ReadHeaderCount(GD, "elements");
+     GD->Elements=(GMSHElement *)mallocEC((NumElements+1)*sizeof(GMSHElement));
+     MeshLineParser Parser
+      = (GD->Format==FORMAT_LEGACY) ? ParseLegacyElementLine : ParseV2ElementLine;
+     if ( (BadLine=ParseMeshLines(GD->MFB, NumElements, Parser, GD)) )
+      { if (BadLine==-1)
+         ErrExit("%s: too few elements in input file",GD->FileName);
+        ErrExit("%s:%i: invalid element specification",GD->FileName,BadLine);
+      };
+     ExpectKeyword(GD, GD->Format==FORMAT_LEGACY ? ELM_END_KEYWORD1 : ELM_END_KEYWORD2);
+     return;
+   };
+
+  /*------------------------------------------------------------*/
+  /*- 2.x binary format: blocks of elements of a single type,  -*/
+  /*- each record being (number, tags, nodes)                  -*/
+  /*------------------------------------------------------------*/
+  if (GD->Format==FORMAT_V2)
+   {
+     int NumElements=GD->NumElements=ReadHeaderCount(GD, "elements");
+     GD->Elements=(GMSHElement *)mallocEC((NumElements+1)*sizeof(GMSHElement));
+     int ne=0;
+     while(ne<NumElements)
+      {
+        int ElType=ReadBinaryInt(GD);
+        int NumInBlock=ReadBinaryInt(GD);
+        int NumTags=ReadBinaryInt(GD);
+        int NPE=GMSHNodesPerElement(ElType);
+        if (NPE<0)
+         ErrExit("%s: unknown element type %i",GD->FileName,ElType);
+        if ( NumInBlock<0 || NumTags<0 || ne+NumInBlock>NumElements )
+         ErrExit("%s: invalid element block",GD->FileName);
+
+        int RecLen=1 + NumTags + NPE;
+        const char *Block=GetBinaryBlock(GD, NumInBlock*RecLen*sizeof(int));
+#ifdef USE_OPENMP
+        int NumThreads=GetNumThreads();
+#pragma omp parallel for schedule(static), num_threads(NumThreads)
+#endif
+        for(int n=0; n<NumInBlock; n++)
+         { GMSHElement *E=GD->Elements + ne + n;
+           E->Type=ElType;
+           E->Include=0;
+           if (ElType!=TYPE_POINT && ElType!=TYPE_TRIANGLE)
+            continue;
+           const char *R=Block + n*RecLen*sizeof(int);
+           int RegPhys=0;
+           if (NumTags>0)
+            memcpy(&RegPhys, R + sizeof(int), sizeof(int));
+           memcpy(E->V, R + (1+NumTags)*sizeof(int), NPE*sizeof(int));
+           E->Include = (GD->MeshTag==-1 || GD->MeshTag==RegPhys);
+         };
+        ne+=NumInBlock;
+      };
+     ExpectKeyword(GD, ELM_END_KEYWORD2);
+     return;
+   };
+
+  /*------------------------------------------------------------*/
+  /*- 4.1 format: blocks of elements of a single type on a     -*/
+  /*- single entity                                            -*/
+  /*------------------------------------------------------------*/
+  int NumBlocks, NumElements;
+  if (GD->Binary)
+   { NumBlocks=ReadBinarySize(GD);
+     NumElements=ReadBinarySize(GD);
+     ReadBinarySize(GD); // min tag
+     ReadBinarySize(GD); // max tag
+   }
+  else
+   { const char *p=GetHeaderLine(GD);
+     if ( !ScanInt(&p, &NumBlocks) || !ScanInt(&p, &NumElements) || NumBlocks<0 || NumElements<0 )
+      ErrExit("%s:%i: invalid number of elements",GD->FileName,GD->MFB->LineNum);
+   };
+  GD->NumElements=NumElements;
+  GD->Elements=(GMSHElement *)mallocEC((NumElements+1)*sizeof(GMSHElement));
+
+  int Offset=0;
+  for(int nb=0; nb<NumBlocks; nb++)
+   {
+     int EntityDim, EntityTag, ElType, NumInBlock;
+     if (GD->Binary)
+      { EntityDim=ReadBinaryInt(GD);
+        EntityTag=ReadBinaryInt(GD);
+        ElType=ReadBinaryInt(GD);
+        NumInBlock=ReadBinarySize(GD);
+      }
+     else
+      { const char *p=GetHeaderLine(GD);
+        if (    !ScanInt(&p, &EntityDim) || !ScanInt(&p, &EntityTag)
+             || !ScanInt(&p, &ElType) || !ScanInt(&p, &NumInBlock)
+             || NumInBlock<0
+           )
+         ErrExit("%s:%i: invalid element block",GD->FileName,GD->MFB->LineNum);
+      };
+     if ( Offset + NumInBlock > NumElements )
+      ErrExit("%s: too many elements",GD->FileName);
+
+     GD->BlockType=ElType;
+     GD->BlockInclude = (ElType==TYPE_TRIANGLE) ? SurfaceEntitySelected(GD, EntityTag) : 1;
+
+     if (GD->Binary)
+      { int NPE=GMSHNodesPerElement(ElType);
+        if (NPE<0)
+         ErrExit("%s: unknown element type %i",GD->FileName,ElType);
+        size_t RecSize=(1+NPE)*sizeof(size_t);
+        const char *Block=GetBinaryBlock(GD, NumInBlock*RecSize);
+#ifdef USE_OPENMP
+        int NumThreads=GetNumThreads();
+#pragma omp parallel for schedule(static), num_threads(NumThreads)
+#endif
+        for(int n=0; n<NumInBlock; n++)
+         { GMSHElement *E=GD->Elements + Offset + n;
+           E->Type=GD->BlockType;
+           E->Include=GD->BlockInclude;
+           if (ElType!=TYPE_POINT && ElType!=TYPE_TRIANGLE)
+            continue;
+           for(int nv=0; nv<NPE; nv++)
+            { size_t Tag;
+              memcpy(&Tag, Block + n*RecSize + (1+nv)*sizeof(size_t), sizeof(size_t));
+              E->V[nv] = (Tag > (size_t)INT_MAX) ? -1 : (int)Tag;
+            };
+         };
+      }
+     else
+      { GD->Offset=Offset;
+        if ( (BadLine=ParseMeshLines(GD->MFB, NumInBlock, ParseV4ElementLine, GD)) )
+         { if (BadLine==-1)
+            ErrExit("%s: too few elements in input file",GD->FileName);
+           ErrExit("%s:%i: invalid element specification",GD->FileName,BadLine);
+         };
+      };
+
+     Offset+=NumInBlock;
+   };
+  GD->NumElements=Offset;
+
+  ExpectKeyword(GD, ELM_END_KEYWORD2);
+}
+
+/*************************************************************/
+/* Eliminate redundant vertices: on return, Canon[j] is the  */
+/* smallest index i such that vertex i lies within 1e-6 of   */
+/* vertex j (=j if there is none). Vertices are sorted by x  */
+/* coordinate so that only near neighbors need be examined.  */
+/* Returns the number of redundant vertex pairs.             */
+/*************************************************************/
+typedef struct XIndex
+ { double x;
+   int n;
+ } XIndex;
+
+static int CompareXIndex(const void *p1, const void *p2)
+{ const XIndex *a=(const XIndex *)p1, *b=(const XIndex *)p2;
+  if (a->x < b->x) return -1;
+  if (a->x > b->x) return +1;
+  return a->n - b->n;
+}
+
+static int FindRedundantVertices(double *Vertices, int NumVertices, int *Canon)
+{
+  #define REDUNDANT_TOL 1.0e-6
+  XIndex *Sorted=(XIndex *)mallocEC(NumVertices*sizeof(XIndex));
+  for(int nv=0; nv<NumVertices; nv++)
+   { Sorted[nv].x=Vertices[3*nv];
+     Sorted[nv].n=nv;
+   };
+  qsort(Sorted, NumVertices, sizeof(XIndex), CompareXIndex);
+
+  int NumRedundant=0;
+#ifdef USE_OPENMP
+  int NumThreads=GetNumThreads();
+#pragma omp parallel for schedule(static), num_threads(NumThreads), reduction(+:NumRedundant)
+#endif
+  for(int k=0; k<NumVertices; k++)
+   { int j=Sorted[k].n;
+     double *Vj=Vertices + 3*j;
+     Canon[j]=j;
+     for(int Dir=-1; Dir<=1; Dir+=2)
+      for(int kp=k+Dir; kp>=0 && kp<NumVertices && fabs(Sorted[kp].x-Sorted[k].x)<REDUNDANT_TOL; kp+=Dir)
+       { int i=Sorted[kp].n;
+         if ( i<j && VecDistance(Vertices+3*i, Vj) < REDUNDANT_TOL )
+          { NumRedundant++;
+            if (i<Canon[j]) Canon[j]=i;
+          };
+       };
+   };
+
+  free(Sorted);
+  return NumRedundant;
+}
+
 /*************************************************************/
 /* Read vertices and panels from a GMSH .msh file to specify */
 /* a surface.                                                */
@@ -62,18 +713,12 @@ namespace scuff {
 /* Otherwise, only panels on the specified physical region   */
 /* are read.                                                 */
 /*************************************************************/
-void RWGSurface::ReadGMSHFile(FILE *MeshFile, char *FileName, 
+void RWGSurface::ReadGMSHFile(FILE *MeshFile, char *FileName,
                              const GTransformation *OTGT, int MeshTag)
 {
   RWGPanel *P;
-  char buffer[100];
-  int VI[3], Temp;
-  int *GMSH2HR;
-  int jGMSH;
-  int i, j, nv, ne, np, LineNum, NumElements, NodeIndex;
-  int ElNum, ElType, RegPhys, RegElem, NodeCnt, nConv;
-
-  int WhichMeshFormat, KeywordFound, nt, nTags, nRead, iDummy, bufPos;
+  int Temp;
+  int nv, np;
 
   /* stuff to figure out correct orientation of panel normals */
   double dRP, dRPMin;
@@ -81,203 +726,145 @@ void RWGSurface::ReadGMSHFile(FILE *MeshFile, char *FileName,
   double CentroidDisplaced[3];
   int nrp;
   int RefPntIndices[MAXREFPTS];
- 
+
+  GMSHData MyGD, *GD=&MyGD;
+  memset(GD, 0, sizeof(GMSHData));
+  GD->MFB=OpenMeshFileBuffer(MeshFile, FileName);
+  GD->FileName=FileName;
+  GD->Format=FORMAT_V2;
+  GD->MeshTag=MeshTag;
+
   /*------------------------------------------------------------*/
-  /* Read lines until we hit the keyword indicating the start   */
-  /* of the 'nodes' section, then read the number of nodes.     */
+  /* Read sections until we have the nodes and the elements.    */
   /*------------------------------------------------------------*/
-  LineNum=0;
-  KeywordFound=0;
-  while(KeywordFound==0)
-   { 
-     if (!fgets(buffer,100,MeshFile))
-      ErrExit("%s: failed to find node start keyword");
-     LineNum++;
-     if( !strncmp(buffer,NODE_START_KEYWORD1,strlen(NODE_START_KEYWORD1)))
-      { WhichMeshFormat=FORMAT_LEGACY; KeywordFound=1; }
-     else if( !strncmp(buffer,NODE_START_KEYWORD2,strlen(NODE_START_KEYWORD2)))
-      { WhichMeshFormat=FORMAT_NEW; KeywordFound=1; }
+  const char *Line;
+  while( (GD->Coords==0 || GD->Elements==0) && (Line=GetMeshLine(GD->MFB)) )
+   {
+     if ( MeshLineIs(Line,FORMAT_KEYWORD) )
+      ReadMeshFormat(GD);
+     else if ( MeshLineIs(Line,ENTITIES_KEYWORD) )
+      ReadEntities(GD);
+     else if ( MeshLineIs(Line,NODE_START_KEYWORD1) )
+      { GD->Format=FORMAT_LEGACY;
+        ReadNodes(GD);
+      }
+     else if ( MeshLineIs(Line,NODE_START_KEYWORD2) )
+      ReadNodes(GD);
+     else if ( MeshLineIs(Line,ELM_START_KEYWORD1) || MeshLineIs(Line,ELM_START_KEYWORD2) )
+      { if (GD->Coords==0)
+         ErrExit("%s:%i: elements section precedes nodes section",FileName,GD->MFB->LineNum);
+        ReadElements(GD);
+      }
+     else if ( Line[0]=='$' )
+      SkipSection(GD, Line);
    };
-  if ( !fgets(buffer,100,MeshFile) || !(NumVertices=atoi(buffer)) )
-   ErrExit("%s: invalid number of nodes",FileName); 
-  LineNum++;
+  if (GD->Coords==0)
+   ErrExit("%s: failed to find node start keyword",FileName);
+  if (GD->Elements==0)
+   ErrExit("%s: bad file format (elements section not found)",FileName);
 
   /*------------------------------------------------------------*/
-  /*- Read in the vertices (which GMSH calls 'nodes.')          */
   /*- Note that the numbering of the vertices in GMSH does not  */
   /*- necessarily correspond to their ordering in the mesh      */
   /*- file. To remedy this situation, we construct a mapping    */
   /*- between GMSH's vertices indices and our internal vertex   */
   /*- indices, which works like this: The vertex that GMSH      */
   /*- calls 'node 3' is stored in slot GMSH2HR[3] within our    */
-  /*- internal Vertices array.                                  */ 
+  /*- internal Vertices array.                                  */
   /*------------------------------------------------------------*/
-  Vertices=(double *)mallocEC(3*NumVertices*sizeof(double));
-  GMSH2HR=(int *)mallocEC(2*NumVertices*sizeof(int));
-  for(i=0; i<2*NumVertices; i++)
-   GMSH2HR[i]=-1;
-  for (nv=0; nv<NumVertices; nv++)
-   { if (!fgets(buffer,100,MeshFile))
-      ErrExit("%s: too few nodes",FileName);
-     LineNum++;
-     nConv=sscanf(buffer,"%i %le %le %le",&NodeIndex,
-                          Vertices+3*nv,Vertices+3*nv+1,Vertices+3*nv+2); 
-     if(nConv!=4)
-      ErrExit("%s:%i: invalid node specification",FileName,LineNum); 
-     if (NodeIndex>2*NumVertices)
-      ErrExit("%s: internal error in ReadGMSHFile",FileName);
-     GMSH2HR[NodeIndex]=nv;
-   }; /* for (nv=0; nv<NumVertices; nv++) */
-   
+  NumVertices=GD->NumNodes;
+  Vertices=GD->Coords;
+  int MaxTag=0;
+  for(nv=0; nv<NumVertices; nv++)
+   { if (GD->NodeTags[nv]<0)
+      ErrExit("%s: invalid node tag",FileName);
+     if (GD->NodeTags[nv]>MaxTag)
+      MaxTag=GD->NodeTags[nv];
+   };
+  int *GMSH2HR=(int *)mallocEC((MaxTag+1)*sizeof(int));
+  for(int nt=0; nt<=MaxTag; nt++)
+   GMSH2HR[nt]=-1;
+  for(nv=0; nv<NumVertices; nv++)
+   GMSH2HR[ GD->NodeTags[nv] ] = nv;
+  free(GD->NodeTags);
+
   /*------------------------------------------------------------*/
-  /*- Apply one-time geometrical transformation (if any) to all */ 
-  /*- vertices.                                                 */ 
+  /*- Apply one-time geometrical transformation (if any) to all */
+  /*- vertices.                                                 */
   /*------------------------------------------------------------*/
   if (OTGT) OTGT->Apply(Vertices, NumVertices);
- 
-  /*------------------------------------------------------------*/
-  /*- Eliminate any redundant vertices from the vertex list.   -*/
-  /*- Explain me in greater detail please.                     -*/
-  /*------------------------------------------------------------*/
-  NumRedundantVertices=0;
-  for(i=0; i<NumVertices; i++)
-   for(j=i+1; j<NumVertices; j++)
-    if ( VecDistance(Vertices+3*i, Vertices+3*j) < 1.0e-6 )
-     {
-       /* remap all references to my node j so that they now refer to my node i*/
-       for(jGMSH=0; jGMSH<2*NumVertices; jGMSH++)
-        if (GMSH2HR[jGMSH]==j)
-         GMSH2HR[jGMSH]=i;
-
-       NumRedundantVertices++;
-       //fprintf(stderr,"\n*\n* redundant nodes found!!(%i,%i)\n*\n",i,j);
-     };
- 
+
   /*------------------------------------------------------------*/
-  /* Confirm that the next two lines in the file are the        */
-  /* end-of-nodes-section keyword and the start-of-elements-section */
-  /* keyword, then read the number of elements.                 */
+  /*- Eliminate any redundant vertices from the vertex list:   -*/
+  /*- all references to a vertex j lying within 1e-6 of a      -*/
+  /*- lower-numbered vertex i are remapped to refer to i.      -*/
   /*------------------------------------------------------------*/
-  if ( !fgets(buffer,100,MeshFile) )
-   ErrExit("%s: bad file format (nodes section not terminated)",FileName);
-  LineNum++;
+  int *Canon=(int *)mallocEC(NumVertices*sizeof(int));
+  NumRedundantVertices=FindRedundantVertices(Vertices, NumVertices, Canon);
+  if (NumRedundantVertices>0)
+   for(int nt=0; nt<=MaxTag; nt++)
+    if (GMSH2HR[nt]!=-1)
+     GMSH2HR[nt]=Canon[ GMSH2HR[nt] ];
+  free(Canon);
 
-  if ( WhichMeshFormat==FORMAT_LEGACY ) 
-   { if ( strncmp(buffer,NODE_END_KEYWORD1,strlen(NODE_END_KEYWORD1)))
-      ErrExit("%s:%i: unexpected keyword",FileName,LineNum);
-   }
-  else
-   { if ( strncmp(buffer,NODE_END_KEYWORD2,strlen(NODE_END_KEYWORD2)))
-      ErrExit("%s:%i: unexpected keyword",FileName,LineNum);
-   };
-
-  if ( !fgets(buffer,100,MeshFile) )
-   ErrExit("%s: bad file format (elements section not initiated)",FileName);
-  LineNum++;
-
-  if ( WhichMeshFormat==FORMAT_LEGACY ) 
-   { if ( strncmp(buffer,ELM_START_KEYWORD1,strlen(ELM_START_KEYWORD1)))
-      ErrExit("%s:%i: unexpected keyword",FileName,LineNum);
-   }
-  else
-   { if ( strncmp(buffer,ELM_START_KEYWORD2,strlen(ELM_START_KEYWORD2)))
-      ErrExit("%s:%i: unexpected keyword",FileName,LineNum);
-   }
-
-  if ( !fgets(buffer,100,MeshFile) )
-   ErrExit("%s: bad file format (invalid number of elements)",FileName);
-  LineNum++;
-  nConv=sscanf(buffer,"%i",&NumElements);
-  if (nConv!=1 || NumElements<0) 
-   ErrExit("%s:%i: invalid number of elements",FileName,LineNum);
- 
   /*------------------------------------------------------------*/
-  /*- Now read each line of the elements section.               */ 
+  /*- map element node tags to vertex indices, and count the   -*/
+  /*- triangles we will keep                                   -*/
   /*------------------------------------------------------------*/
+  int NumElements=GD->NumElements;
   NumPanels=NumRefPts=0;
-  Panels=(RWGPanel **)mallocEC(NumElements * sizeof(Panels[0]));
-  for (ne=0; ne<NumElements; ne++)
-   { 
-     if (!fgets(buffer,100,MeshFile))
-      ErrExit("too few elements in input file");
-     LineNum++;
-
-     if (WhichMeshFormat==FORMAT_LEGACY)
-      { 
-        nConv=sscanf(buffer,"%i %i %i %i %i %i %i %i",
-                     &ElNum,&ElType,&RegPhys,&RegElem,&NodeCnt,VI,VI+1,VI+2);
-        if (nConv<5)
-         ErrExit("%s:%i: invalid element specification",FileName,LineNum);
+  for(int ne=0; ne<NumElements; ne++)
+   { GMSHElement *E=GD->Elements + ne;
+     int NPE = (E->Type==TYPE_TRIANGLE) ? 3 : (E->Type==TYPE_POINT) ? 1 : 0;
+     for(int nv=0; nv<NPE; nv++)
+      { if ( E->V[nv]<0 || E->V[nv]>MaxTag || GMSH2HR[E->V[nv]]==-1 )
+         ErrExit("%s: element %i refers to unknown node %i",FileName,ne+1,E->V[nv]);
+        E->V[nv] = GMSH2HR[E->V[nv]];
+      };
+
+     /***************************************************************/
+     /* add new reference point to list of reference points *********/
+     /***************************************************************/
+     if (E->Type==TYPE_POINT)
+      { if (NumRefPts==MAXREFPTS)
+         ErrExit("%s: too many reference points",FileName);
+        RefPntIndices[NumRefPts++]=E->V[0];
       }
+     else if (E->Type==TYPE_TRIANGLE && E->Include)
+      E->Include=++NumPanels; // 1-based panel index
      else
-      { 
-        nConv=sscanf(buffer,"%i %i %i%n",&ElNum,&ElType,&nTags,&nRead);
-        bufPos=nRead;
-        if (nConv<3)
-         ErrExit("%s:%i: invalid element specification",FileName,LineNum);
-
-        // read the first 'tag,' which should be the physical region
-        if (nTags==0)
-         RegPhys=0;
-        else 
-         sscanf(buffer+bufPos,"%i%n",&RegPhys,&nRead);
-        bufPos+=nRead;
-
-        // read any remaining tags 
-        for(nt=0; nt<nTags-1; nt++)
-         { sscanf(buffer+bufPos,"%i%n",&iDummy,&nRead);
-           bufPos+=nRead;
-         };
-
-        // finally, read the vertex indices. 
-        nConv=sscanf(buffer+bufPos,"%i %i %i",VI,VI+1,VI+2);
+      E->Include=0;
+   };
+  free(GMSH2HR);
 
-        if (ElType==TYPE_TRIANGLE && nConv!=3)
-         ErrExit("%s:%i: invalid element specification",FileName,LineNum);
-        else if (ElType==TYPE_POINT && nConv!=1)
-         ErrExit("%s:%i: invalid element specification",FileName,LineNum);
-      };
-   
-     /* we only process elements that are points or triangles */
-     switch(ElType)
-      { 
-        /***************************************************************/
-        /* add new reference point to list of reference points *********/
-        /***************************************************************/
-        case TYPE_POINT:
-          if (NumRefPts==MAXREFPTS)
-           ErrExit("%s:%i: too many reference points",FileName,LineNum); 
-          RefPntIndices[NumRefPts++]=GMSH2HR[ VI[0] ];
-          break;
-
-        /***************************************************************/
-        /* add new triangle to list of panels                          */
-        /***************************************************************/
-        case TYPE_TRIANGLE:
-          if ( (MeshTag == -1) || (MeshTag==RegPhys) )
-           { Panels[NumPanels]=NewRWGPanel(Vertices, GMSH2HR[ VI[0] ], GMSH2HR[ VI[1] ], 
-                                           GMSH2HR[ VI[2] ]);
-             Panels[NumPanels]->Index=NumPanels;
-             NumPanels++;
-           };
-          break;
-
-        default:
-          //ErrExit("%s:%i: unknown element type %i",FileName,LineNum,ElType);
-          //fprintf(stderr,"%s:%i: warning: ignoring unknown element type %i\n",FileName,LineNum,ElType);
-          break;
-
-      }; // switch(ElType)
-   }; //for (ne=0; ne<NumElements; ne++)
+  /*------------------------------------------------------------*/
+  /*- add the triangles to the list of panels                  -*/
+  /*------------------------------------------------------------*/
+  Panels=(RWGPanel **)mallocEC((NumPanels+1) * sizeof(Panels[0]));
+#ifdef USE_OPENMP
+  int NumThreads=GetNumThreads();
+#pragma omp parallel for schedule(static), num_threads(NumThreads)
+#endif
+  for(int ne=0; ne<NumElements; ne++)
+   { GMSHElement *E=GD->Elements + ne;
+     if (E->Type!=TYPE_TRIANGLE || E->Include==0)
+      continue;
+     int np=E->Include-1;
+     Panels[np]=NewRWGPanel(Vertices, E->V[0], E->V[1], E->V[2]);
+     Panels[np]->Index=np;
+   };
+  free(GD->Elements);
+  if (GD->SurfaceEntityTags) free(GD->SurfaceEntityTags);
+  if (GD->SurfaceEntitySelected) free(GD->SurfaceEntitySelected);
 
   /*------------------------------------------------------------*/
   /*- flip panel normals as necessary based on user's          -*/
   /*- specification of reference points.                       -*/
   /*------------------------------------------------------------*/
   if (NumRefPts>0)
-   { 
+   {
      for(np=0; np<NumPanels; np++)
-      { 
+      {
         P=Panels[np];
 
         /* find nearest reference point */
@@ -303,7 +890,7 @@ void RWGSurface::ReadGMSHFile(FILE *MeshFile, char *FileName,
         /* also interchange the labeling of panel vertices 0    */
         /* and 2 to ensure that the right-hand-rule convention  */
         /* is preserved                                         */
-        if (dRP < dRPMin) 
+        if (dRP < dRPMin)
          { VecScale(P->ZHat,-1.0);
            Temp=P->VI[0]; P->VI[0]=P->VI[2]; P->VI[2]=Temp;
          };
@@ -312,9 +899,9 @@ void RWGSurface::ReadGMSHFile(FILE *MeshFile, char *FileName,
 
    }; // if (NumRefPts>0)
 
-  free(GMSH2HR);
+  CloseMeshFileBuffer(GD->MFB);
   fclose(MeshFile);
- 
-} 
+
+}
 
 } // namespace scuff
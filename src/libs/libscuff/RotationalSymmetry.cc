@@ -0,0 +1,639 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * RotationalSymmetry.cc -- support for geometries with discrete (C_N)
+ *                       -- rotational symmetry
+ *
+ * how it works:
+ *
+ *  (a) a surface declared with ROTATIONAL_SYMMETRY N in its .scuffgeo
+ *      section is meshed as a single slice; the full surface is
+ *      obtained by rotating the slice N times through 2pi/N about
+ *      the z-axis of the mesh file (ReplicateSlice below).
+ *
+ *  (b) the edges of the full surface are ordered so that edge
+ *      #(k*NE/N + n) is the image of edge #n under k rotations, with
+ *      the same orientation (SortEdgesBySlice below).
+ *
+ *  (c) if all surfaces in a geometry share the same symmetry, the
+ *      BEM matrix is block-circulant, M_{kl} = C_{(l-k) mod N},
+ *      where k,l label slices. the discrete Fourier transform
+ *      over slices block-diagonalizes it into N 'harmonic' blocks
+ *
+ *       M_m = \sum_{j=0}^{N-1} e^{2\pi i m j/N} C_j,   m=0..N-1
+ *
+ *      each of which has dimension TotalBFs/N. only the first
+ *      block row (the C_j blocks) is ever computed, and we factor
+ *      and solve N small systems instead of one large one.
+ *
+ *      LUSolveSymmetric() returns the usual coefficient vector for
+ *      the full surface, so GetFields(), GetPFT() etc. may be used
+ *      on the solution without modification.
+ *
+ * agent         -- 10/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+
+#include "libscuff.h"
+#include "libscuffInternals.h"
+
+#ifdef USE_OPENMP
+#  include <omp.h>
+#endif
+
+namespace scuff {
+
+#define II cdouble(0,1)
+
+/***************************************************************/
+/* rotate X through angle Theta (radians) about the axis       */
+/* through X0 in direction ZHat (a unit vector).               */
+/***************************************************************/
+static void RotateAboutAxis(const double X0[3], const double ZHat[3],
+                            double Theta, const double X[3], double XP[3])
+{
+  double R[3], ZxR[3];
+  VecSub(X, X0, R);
+  VecCross(ZHat, R, ZxR);
+  double ZdR = VecDot(ZHat, R);
+  double CT=cos(Theta), ST=sin(Theta);
+  for(int Mu=0; Mu<3; Mu++)
+   XP[Mu] = X0[Mu] + CT*R[Mu] + ST*ZxR[Mu] + (1.0-CT)*ZdR*ZHat[Mu];
+}
+
+/***************************************************************/
+/* union-find helper for merging vertices that coincide in     */
+/* adjacent slices                                             */
+/***************************************************************/
+static int FindRoot(int *Parent, int n)
+{
+  while( Parent[n]!=n )
+   { Parent[n]=Parent[Parent[n]];
+     n=Parent[n];
+   };
+  return n;
+}
+
+/***************************************************************/
+/* table of vertices sorted by the integer coordinates of the  */
+/* cubical cell (side length h) containing them. if h exceeds  */
+/* the matching tolerance, a vertex within that tolerance of a */
+/* point X lies in the cell of X or in one of its 26 neighbors.*/
+/***************************************************************/
+typedef struct VertexCell
+ { long C[3];   // integer cell coordinates of vertex
+   int nv;      // vertex index
+ } VertexCell;
+
+typedef struct VertexCellTable
+ { VertexCell *Cells;
+   int NumCells;
+   double h;    // cell side length
+ } VertexCellTable;
+
+static int CompareCells(const long *C1, const long *C2)
+{ for(int i=0; i<3; i++)
+   if (C1[i]!=C2[i])
+    return C1[i] < C2[i] ? -1 : 1;
+  return 0;
+}
+
+static int CompareVertexCells(const void *p1, const void *p2)
+{
+  const VertexCell *VC1=(const VertexCell *)p1, *VC2=(const VertexCell *)p2;
+  int Result=CompareCells(VC1->C, VC2->C);
+  if (Result) return Result;
+  return VC1->nv - VC2->nv;
+}
+
+static void GetVertexCell(const double *X, double h, long C[3])
+{ for(int i=0; i<3; i++)
+   C[i] = (long)floor( X[i] / h );
+}
+
+static void InitVertexCellTable(double *Vertices, int NumVertices, int *Used,
+                                double h, VertexCellTable *VCT)
+{
+  VCT->h = h;
+  VCT->Cells = (VertexCell *)mallocEC( (NumVertices+1)*sizeof(VertexCell) );
+  VCT->NumCells = 0;
+  for(int nv=0; nv<NumVertices; nv++)
+   { if (!Used[nv]) continue;
+     VertexCell *VC = VCT->Cells + (VCT->NumCells++);
+     GetVertexCell(Vertices + 3*nv, h, VC->C);
+     VC->nv = nv;
+   };
+  qsort(VCT->Cells, VCT->NumCells, sizeof(VertexCell), CompareVertexCells);
+}
+
+/***************************************************************/
+/* return the lowest-index vertex in the table lying within    */
+/* Tol of X, or -1 if there is none.                           */
+/***************************************************************/
+static int FindVertexInTable(VertexCellTable *VCT, double *Vertices,
+                             const double X[3], double Tol)
+{
+  long C0[3];
+  GetVertexCell(X, VCT->h, C0);
+  int nvMatch=-1;
+  for(int d0=-1; d0<=1; d0++)
+   for(int d1=-1; d1<=1; d1++)
+    for(int d2=-1; d2<=1; d2++)
+     { long C[3]={ C0[0]+d0, C0[1]+d1, C0[2]+d2 };
+       int Lo=0, Hi=VCT->NumCells;
+       while(Lo<Hi)
+        { int Mid = Lo + (Hi-Lo)/2;
+          if ( CompareCells(VCT->Cells[Mid].C, C) < 0 )
+           Lo=Mid+1;
+          else
+           Hi=Mid;
+        };
+       for(int n=Lo; n<VCT->NumCells && CompareCells(VCT->Cells[n].C, C)==0; n++)
+        { int nv=VCT->Cells[n].nv;
+          if ( (nvMatch==-1 || nv<nvMatch) && VecDistance(X, Vertices+3*nv) < Tol )
+           nvMatch=nv;
+        };
+     };
+  return nvMatch;
+}
+
+/***************************************************************/
+/* On entry, the Vertices and Panels arrays describe a single  */
+/* slice of the surface (already subjected to the one-time     */
+/* transformation OTGT, if any). On return they describe the   */
+/* full surface, with panel #(k*NPS + p) the image of slice    */
+/* panel #p under k rotations. Vertices lying on the cut planes*/
+/* between slices (and on the axis) are shared.                */
+/***************************************************************/
+void RWGSurface::ReplicateSlice(const GTransformation *OTGT)
+{
+  int N = NumSlices;
+
+  /*--------------------------------------------------------------*/
+  /*- the symmetry axis is the z-axis of the mesh file, carried   */
+  /*- along by the one-time transformation                        */
+  /*--------------------------------------------------------------*/
+  SymmetryOrigin[0]=SymmetryOrigin[1]=SymmetryOrigin[2]=0.0;
+  SymmetryAxis[0]=SymmetryAxis[1]=0.0; SymmetryAxis[2]=1.0;
+  if (OTGT)
+   { OTGT->Apply(SymmetryOrigin);
+     OTGT->ApplyRotation(SymmetryAxis);
+   };
+  double Theta = 2.0*M_PI/((double)N);
+
+  /*--------------------------------------------------------------*/
+  /*- flag the vertices actually used by slice panels (the GMSH   */
+  /*- reader leaves redundant vertices in place) and get a length */
+  /*- scale for the vertex-matching tolerance                     */
+  /*--------------------------------------------------------------*/
+  int NVS=NumVertices, NPS=NumPanels;
+  int *Used=(int *)mallocEC(NVS*sizeof(int));
+  memset(Used, 0, NVS*sizeof(int));
+  double Tol=1.0e89;
+  for(int np=0; np<NPS; np++)
+   { for(int i=0; i<3; i++)
+      Used[ Panels[np]->VI[i] ] = 1;
+     Tol=fmin(Tol, Panels[np]->Radius);
+   };
+  Tol*=1.0e-3;
+
+  /*--------------------------------------------------------------*/
+  /*- Succ[i]=j if rotating slice vertex #i through one step lands */
+  /*- on slice vertex #j, or -1 if it lands on no slice vertex.   */
+  /*- candidates for j are looked up in a table of slice vertices */
+  /*- sorted by cell (as for the periodic partner-edge search in  */
+  /*- PBCSetup.cc), so this is O(NVS log NVS) instead of O(NVS^2).*/
+  /*--------------------------------------------------------------*/
+  VertexCellTable VCT;
+  InitVertexCellTable(Vertices, NVS, Used, 4.0*Tol, &VCT);
+  int *Succ=(int *)mallocEC(NVS*sizeof(int));
+  for(int i=0; i<NVS; i++)
+   { Succ[i]=-1;
+     if (!Used[i]) continue;
+     double RV[3];
+     RotateAboutAxis(SymmetryOrigin, SymmetryAxis, Theta, Vertices+3*i, RV);
+     Succ[i]=FindVertexInTable(&VCT, Vertices, RV, Tol);
+   };
+  free(VCT.Cells);
+
+  /*--------------------------------------------------------------*/
+  /*- node (k,i) = vertex #i of slice copy #k. rotating copy k    */
+  /*- once more gives copy k+1, so node (k,Succ[i]) and node      */
+  /*- (k+1,i) are the same physical vertex.                       */
+  /*--------------------------------------------------------------*/
+  int NumNodes=N*NVS;
+  int *Parent=(int *)mallocEC(NumNodes*sizeof(int));
+  for(int n=0; n<NumNodes; n++)
+   Parent[n]=n;
+  for(int k=0; k<N; k++)
+   for(int i=0; i<NVS; i++)
+    { if (Succ[i]==-1) continue;
+      int r1=FindRoot(Parent, k*NVS + Succ[i]);
+      int r2=FindRoot(Parent, ((k+1)%N)*NVS + i);
+      if (r1!=r2)
+       Parent[ r1>r2 ? r1 : r2 ] = (r1>r2 ? r2 : r1);
+    };
+
+  /*--------------------------------------------------------------*/
+  /*- assign indices within the full vertex list to the distinct  */
+  /*- physical vertices                                           */
+  /*--------------------------------------------------------------*/
+  int *FullIndex=(int *)mallocEC(NumNodes*sizeof(int));
+  int NVF=0;
+  for(int n=0; n<NumNodes; n++)
+   FullIndex[n]=-1;
+  for(int k=0; k<N; k++)
+   for(int i=0; i<NVS; i++)
+    { if (!Used[i]) continue;
+      int r=FindRoot(Parent, k*NVS + i);
+      if (FullIndex[r]==-1)
+       FullIndex[r]=NVF++;
+      FullIndex[k*NVS + i]=FullIndex[r];
+    };
+
+  double *FullVertices=(double *)mallocEC(3*NVF*sizeof(double));
+  for(int k=0; k<N; k++)
+   for(int i=0; i<NVS; i++)
+    if (Used[i])
+     RotateAboutAxis(SymmetryOrigin, SymmetryAxis, k*Theta, Vertices+3*i,
+                     FullVertices + 3*FullIndex[k*NVS+i]);
+
+  /*--------------------------------------------------------------*/
+  /*- create the panels of the full surface. panel vertex order   */
+  /*- (and hence orientation) is inherited from the slice panel.  */
+  /*--------------------------------------------------------------*/
+  RWGPanel **FullPanels=(RWGPanel **)mallocEC(N*NPS*sizeof(RWGPanel *));
+  for(int k=0; k<N; k++)
+   for(int np=0; np<NPS; np++)
+    { int *VI=Panels[np]->VI;
+      int V0=FullIndex[k*NVS+VI[0]];
+      int V1=FullIndex[k*NVS+VI[1]];
+      int V2=FullIndex[k*NVS+VI[2]];
+      if ( V0==V1 || V1==V2 || V2==V0 )
+       ErrExit("%s: panel %i degenerates under %i-fold rotation (is the mesh a slice?)",
+                MeshFileName,np,N);
+      FullPanels[k*NPS+np]=NewRWGPanel(FullVertices, V0, V1, V2);
+    };
+
+  for(int np=0; np<NPS; np++)
+   free(Panels[np]);
+  free(Panels);
+  free(Vertices);
+
+  Panels=FullPanels;
+  Vertices=FullVertices;
+  NumPanels=N*NPS;
+  NumVertices=NVF;
+
+  Log("Replicated %i-panel slice of surface %s %i times (%i panels, %i vertices)",
+       NPS,Label,N,NumPanels,NumVertices);
+
+  free(FullIndex);
+  free(Parent);
+  free(Succ);
+  free(Used);
+}
+
+/***************************************************************/
+/* reorder the Edges[] array of a surface built by             */
+/* ReplicateSlice() so that Edges[k*NO + no] is the image of   */
+/* Edges[no] under k rotations (NO = NumEdges/NumSlices), and  */
+/* orient each edge so that its positive panel is the image of */
+/* the positive panel of Edges[no].                            */
+/* this must be called after InitEdgeList() (and after any     */
+/* exterior edges have been promoted to half-RWG functions)    */
+/* but before the EI fields of the panels are filled in.       */
+/***************************************************************/
+void RWGSurface::SortEdgesBySlice()
+{
+  int N=NumSlices;
+  int NPS=NumPanels/N;
+
+  if ( NumEdges%N )
+   ErrExit("%s: surface is not %i-fold rotationally symmetric (%i edges)",
+            MeshFileName,N,NumEdges);
+  int NO = NumEdges/N;
+
+  /*--------------------------------------------------------------*/
+  /*- RotV[nv] = index of the image of vertex nv under one step   */
+  /*--------------------------------------------------------------*/
+  int *RotV=(int *)mallocEC(NumVertices*sizeof(int));
+  for(int np=0; np<NumPanels; np++)
+   { RWGPanel *P = Panels[np];
+     RWGPanel *PP = Panels[ (np+NPS)%NumPanels ];
+     for(int i=0; i<3; i++)
+      RotV[P->VI[i]] = PP->VI[i];
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- PanelEdges[3*np + i] = edges (with basis functions) that    */
+  /*- bound panel #np                                             */
+  /*--------------------------------------------------------------*/
+  int *PanelEdges=(int *)mallocEC(3*NumPanels*sizeof(int));
+  for(int n=0; n<3*NumPanels; n++)
+   PanelEdges[n]=-1;
+  for(int ne=0; ne<NumEdges; ne++)
+   { int Panels2[2];
+     Panels2[0]=Edges[ne]->iPPanel;
+     Panels2[1]=Edges[ne]->iMPanel;
+     for(int n=0; n<2; n++)
+      { if (Panels2[n]<0) continue;
+        int *PE=PanelEdges + 3*Panels2[n];
+        int i=0;
+        while( i<3 && PE[i]!=-1 ) i++;
+        if (i<3) PE[i]=ne;
+      };
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- walk the orbit of each edge under rotation                  */
+  /*--------------------------------------------------------------*/
+  RWGEdge **SortedEdges=(RWGEdge **)mallocEC(NumEdges*sizeof(RWGEdge *));
+  int *Orbit=(int *)mallocEC(N*sizeof(int));
+  bool *Visited=(bool *)mallocEC(NumEdges*sizeof(bool));
+  memset(Visited, 0, NumEdges*sizeof(bool));
+  int no=0;
+  for(int ne=0; ne<NumEdges; ne++)
+   {
+     if (Visited[ne]) continue;
+
+     int neCur=ne, KStart=-1;
+     for(int k=0; k<N; k++)
+      {
+        if ( Visited[neCur] || no==NO )
+         ErrExit("%s: surface is not %i-fold rotationally symmetric",MeshFileName,N);
+        Visited[neCur]=true;
+        Orbit[k]=neCur;
+
+        RWGEdge *E=Edges[neCur];
+        if ( E->iPPanel < NPS )
+         KStart=k;
+
+        // find the image of E, and orient it to match E
+        int iPImage=(E->iPPanel + NPS)%NumPanels;
+        int iV1=RotV[E->iV1], iV2=RotV[E->iV2];
+        int neNext=-1;
+        for(int i=0; i<3 && neNext==-1; i++)
+         { int nep=PanelEdges[3*iPImage+i];
+           if (nep==-1) continue;
+           RWGEdge *EP=Edges[nep];
+           if (    (EP->iV1==iV1 && EP->iV2==iV2)
+                || (EP->iV1==iV2 && EP->iV2==iV1) )
+            neNext=nep;
+         };
+        if (neNext==-1)
+         ErrExit("%s: surface is not %i-fold rotationally symmetric",MeshFileName,N);
+
+        RWGEdge *EP=Edges[neNext];
+        if ( EP->iPPanel!=iPImage )
+         { int Temp;
+           Temp=EP->iQP;     EP->iQP=EP->iQM;         EP->iQM=Temp;
+           Temp=EP->iPPanel; EP->iPPanel=EP->iMPanel; EP->iMPanel=Temp;
+           Temp=EP->PIndex;  EP->PIndex=EP->MIndex;   EP->MIndex=Temp;
+         };
+
+        if ( k==N-1 && neNext!=ne )
+         ErrExit("%s: surface is not %i-fold rotationally symmetric",MeshFileName,N);
+        neCur=neNext;
+      };
+
+     // the orbit member whose positive panel lies in the
+     // original slice goes in slot 0
+     for(int k=0; k<N; k++)
+      SortedEdges[ k*NO + no ] = Edges[ Orbit[ (KStart+k)%N ] ];
+     no++;
+   };
+
+  for(int ne=0; ne<NumEdges; ne++)
+   { Edges[ne]=SortedEdges[ne];
+     Edges[ne]->Index=ne;
+   };
+
+  free(Visited);
+  free(Orbit);
+  free(SortedEdges);
+  free(PanelEdges);
+  free(RotV);
+}
+
+/***************************************************************/
+/* get the symmetry axis of a surface in its current position  */
+/***************************************************************/
+static void GetSymmetryAxis(RWGSurface *S, double X0[3], double ZHat[3])
+{
+  VecCopy(S->SymmetryOrigin, X0);
+  VecCopy(S->SymmetryAxis, ZHat);
+  if (S->GT)
+   { S->GT->Apply(X0);
+     S->GT->ApplyRotation(ZHat);
+   };
+}
+
+/***************************************************************/
+/* make sure all surfaces still share a common symmetry axis   */
+/* (they might not if some have been independently transformed)*/
+/***************************************************************/
+static void CheckSymmetryAxes(RWGGeometry *G)
+{
+  if (G->NumSlices<=1)
+   ErrExit("geometry %s does not have rotational symmetry",G->GeoFileName);
+
+  double X0[3], ZHat[3];
+  GetSymmetryAxis(G->Surfaces[0], X0, ZHat);
+  for(int ns=1; ns<G->NumSurfaces; ns++)
+   { double X0P[3], ZHatP[3], DX[3], ZxDX[3];
+     GetSymmetryAxis(G->Surfaces[ns], X0P, ZHatP);
+     VecSub(X0P, X0, DX);
+     VecCross(ZHat, DX, ZxDX);
+     if (    VecDot(ZHat, ZHatP) < 1.0-1.0e-8
+          || VecNorm(ZxDX) > 1.0e-6*(1.0 + VecNorm(X0))
+        )
+      ErrExit("surfaces %s and %s do not share a common symmetry axis",
+               G->Surfaces[0]->Label, G->Surfaces[ns]->Label);
+   };
+}
+
+/***************************************************************/
+/* number of blocks in the symmetry-reduced BEM matrix, or 0   */
+/* if the geometry is not rotationally symmetric. (geometries  */
+/* with mirror symmetry are handled by the analogous routines  */
+/* in MirrorSymmetry.cc.)                                      */
+/***************************************************************/
+int RWGGeometry::GetNumSymmetryBlocks()
+{
+  return NumSlices>1 ? NumSlices : 0;
+}
+
+/***************************************************************/
+/* allocate the NumSlices harmonic blocks of the BEM matrix    */
+/* for a rotationally symmetric geometry                       */
+/***************************************************************/
+HMatrix **RWGGeometry::AllocateSymmetryBlocks()
+{
+  if (NumSlices<=1)
+   ErrExit("%s: AllocateSymmetryBlocks called for geometry without symmetry",GeoFileName);
+
+  int Dim = TotalBFs / NumSlices;
+  HMatrix **MBlocks=(HMatrix **)mallocEC(NumSlices*sizeof(HMatrix *));
+  for(int m=0; m<NumSlices; m++)
+   MBlocks[m]=new HMatrix(Dim, Dim, LHM_COMPLEX);
+  return MBlocks;
+}
+
+/***************************************************************/
+/* assemble the harmonic blocks M_m. we first compute the first*/
+/* block row of the full BEM matrix (the interactions of the   */
+/* basis functions in slice 0 of each surface with all basis   */
+/* functions of all surfaces) and then Fourier-transform over  */
+/* the slice index of the columns.                             */
+/***************************************************************/
+void RWGGeometry::AssembleSymmetryBlocks(cdouble Omega, HMatrix **MBlocks)
+{
+  CheckSymmetryAxes(this);
+
+  int N = NumSlices;
+  int Dim = TotalBFs / N;
+
+  Log("Assembling %i-fold symmetric BEM matrix at Omega=(%g,%g)...",N,real(Omega),imag(Omega));
+
+  /*--------------------------------------------------------------*/
+  /*- first block row: B0[r][c] = M[r][c] for r in slice 0         */
+  /*--------------------------------------------------------------*/
+  HMatrix *B0=new HMatrix(Dim, TotalBFs, LHM_COMPLEX);
+
+  GetSSIArgStruct MyArgs, *Args=&MyArgs;
+  InitGetSSIArgs(Args);
+  Args->G=this;
+  Args->Omega=Omega;
+  Args->B=B0;
+  for(int ns=0; ns<NumSurfaces; ns++)
+   for(int nsp=0; nsp<NumSurfaces; nsp++)
+    { Args->Sa=Surfaces[ns];
+      Args->Sb=Surfaces[nsp];
+      Args->RowOffset=BFIndexOffset[ns]/N;
+      Args->ColOffset=BFIndexOffset[nsp];
+      Args->NumRowEdges=Surfaces[ns]->NumEdges/N;
+      GetSurfaceSurfaceInteractions(Args);
+    };
+
+  /*--------------------------------------------------------------*/
+  /*- M_m[r][c] = \sum_j e^{2\pi i m j / N} B0[r][(j,c)] where     */
+  /*- (j,c) is the column of basis function #c in slice #j        */
+  /*--------------------------------------------------------------*/
+  int NumThreads=GetNumThreads();
+#ifdef USE_OPENMP
+#pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
+#endif
+  for(int m=0; m<N; m++)
+   {
+     HMatrix *MB=MBlocks[m];
+     MB->Zero();
+     for(int nsp=0; nsp<NumSurfaces; nsp++)
+      { int NBFS = Surfaces[nsp]->NumBFs / N; // BFs per slice
+        int ColOffset = BFIndexOffset[nsp];
+        for(int j=0; j<N; j++)
+         { cdouble Phase = exp( II*2.0*M_PI*((double)(m*j%N))/((double)N) );
+           for(int nr=0; nr<Dim; nr++)
+            for(int nc=0; nc<NBFS; nc++)
+             MB->AddEntry(nr, ColOffset/N + nc,
+                          Phase*B0->GetEntry(nr, ColOffset + j*NBFS + nc));
+         };
+      };
+   };
+
+  delete B0;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+void RWGGeometry::LUFactorizeSymmetryBlocks(HMatrix **MBlocks)
+{
+  int NumBlocks=GetNumSymmetryBlocks();
+  for(int m=0; m<NumBlocks; m++)
+   { Log(" LU-factorizing symmetry block %i/%i...",m+1,NumBlocks);
+     MBlocks[m]->LUFactorize();
+   };
+}
+
+/***************************************************************/
+/* on entry, KN is the RHS vector for the full geometry (as    */
+/* returned by AssembleRHSVector). on return, it is the        */
+/* solution of the full BEM system.                            */
+/* the MBlocks must have been LU-factorized.                   */
+/***************************************************************/
+void RWGGeometry::LUSolveSymmetric(HMatrix **MBlocks, HVector *KN)
+{
+  int N = NumSlices;
+  int Dim = TotalBFs / N;
+
+  /*--------------------------------------------------------------*/
+  /*- Xm[m][r] = (1/N) \sum_k e^{-2\pi i m k/N} KN[(k,r)]         */
+  /*--------------------------------------------------------------*/
+  HVector **Xm=(HVector **)mallocEC(N*sizeof(HVector *));
+  for(int m=0; m<N; m++)
+   { Xm[m]=new HVector(Dim, LHM_COMPLEX);
+     Xm[m]->Zero();
+   };
+
+  for(int ns=0; ns<NumSurfaces; ns++)
+   { int NBFS = Surfaces[ns]->NumBFs / N;
+     int Offset = BFIndexOffset[ns];
+     for(int m=0; m<N; m++)
+      for(int k=0; k<N; k++)
+       { cdouble Phase = exp( -II*2.0*M_PI*((double)(m*k%N))/((double)N) ) / ((double)N);
+         for(int nbf=0; nbf<NBFS; nbf++)
+          Xm[m]->AddEntry(Offset/N + nbf, Phase*KN->GetEntry(Offset + k*NBFS + nbf));
+       };
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- solve the harmonic systems ----------------------------------*/
+  /*--------------------------------------------------------------*/
+  for(int m=0; m<N; m++)
+   MBlocks[m]->LUSolve(Xm[m]);
+
+  /*--------------------------------------------------------------*/
+  /*- KN[(k,r)] = \sum_m e^{2\pi i m k/N} Xm[m][r]                */
+  /*--------------------------------------------------------------*/
+  KN->Zero();
+  for(int ns=0; ns<NumSurfaces; ns++)
+   { int NBFS = Surfaces[ns]->NumBFs / N;
+     int Offset = BFIndexOffset[ns];
+     for(int k=0; k<N; k++)
+      for(int m=0; m<N; m++)
+       { cdouble Phase = exp( II*2.0*M_PI*((double)(m*k%N))/((double)N) );
+         for(int nbf=0; nbf<NBFS; nbf++)
+          KN->AddEntry(Offset + k*NBFS + nbf, Phase*Xm[m]->GetEntry(Offset/N + nbf));
+       };
+   };
+
+  for(int m=0; m<N; m++)
+   delete Xm[m];
+  free(Xm);
+}
+
+} // namespace scuff
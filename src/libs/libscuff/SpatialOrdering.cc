@@ -0,0 +1,154 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * SpatialOrdering.cc -- optional traversal of the basis functions of
+ *                    -- each surface along a space-filling curve
+ *
+ * how it works:
+ *
+ *  (a) the order of the Edges[] array produced by InitEdgeList() is
+ *      determined by the vertex numbering in the mesh file, so edges
+ *      with neighboring indices may be far apart in space. after
+ *      RWGGeometry::SetSpatialEdgeOrdering(true), each surface has
+ *      a SpatialOrder[] array listing its edges sorted by the Morton
+ *      (z-order) index of their centroids, and the loops in
+ *      GetSurfaceSurfaceInteractions() visit the edge pairs in that
+ *      order, so that consecutive matrix entries involve panels
+ *      that are close together in space. this improves the reuse of
+ *      panel data and FIPPI cache entries in the O(N^2) matrix loops.
+ *
+ *  (b) only the order in which the matrix entries are computed
+ *      changes; each entry is still stored at the index of its basis
+ *      functions in mesh-file order. thus the BEM matrix, RHS vectors,
+ *      and KN vectors are identical with and without the ordering,
+ *      and callers never see a different numbering.
+ *
+ *  (c) the order depends only on the edge centroids, so it need not
+ *      be stored in geometry snapshots. if vertices are later moved
+ *      by UpdateVertices() the order is merely less local.
+ *
+ * agent         -- 10/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include <libhmat.h>
+
+#include "libscuff.h"
+#include "libscuffInternals.h"
+
+namespace scuff {
+
+#define MORTONBITS 21
+
+/***************************************************************/
+/* interleave the low MORTONBITS bits of i, j, k               */
+/***************************************************************/
+static unsigned long long SpreadBits(unsigned long long x)
+{
+  x &= 0x1fffffULL;
+  x = (x | (x << 32)) & 0x1f00000000ffffULL;
+  x = (x | (x << 16)) & 0x1f0000ff0000ffULL;
+  x = (x | (x <<  8)) & 0x100f00f00f00f00fULL;
+  x = (x | (x <<  4)) & 0x10c30c30c30c30c3ULL;
+  x = (x | (x <<  2)) & 0x1249249249249249ULL;
+  return x;
+}
+
+static unsigned long long MortonKey(unsigned i, unsigned j, unsigned k)
+{
+  return SpreadBits(i) | (SpreadBits(j)<<1) | (SpreadBits(k)<<2);
+}
+
+typedef struct EdgeKey
+ { unsigned long long Key;
+   int ne;
+ } EdgeKey;
+
+static int CompareEdgeKeys(const void *p1, const void *p2)
+{
+  const EdgeKey *K1=(const EdgeKey *)p1;
+  const EdgeKey *K2=(const EdgeKey *)p2;
+  if (K1->Key < K2->Key) return -1;
+  if (K1->Key > K2->Key) return +1;
+  return K1->ne - K2->ne;
+}
+
+/***************************************************************/
+/* compute (Enable=true) or discard (Enable=false) the spatial */
+/* traversal order of the edges of a surface.                  */
+/***************************************************************/
+void RWGSurface::InitSpatialOrder(bool Enable)
+{
+  if (SpatialOrder)
+   free(SpatialOrder);
+  SpatialOrder=0;
+  NumOrderedEdges=0;
+  if (!Enable || NumEdges<=1) return;
+
+  double XMin[3], XMax[3];
+  VecCopy(Edges[0]->Centroid, XMin);
+  VecCopy(Edges[0]->Centroid, XMax);
+  for(int ne=1; ne<NumEdges; ne++)
+   for(int i=0; i<3; i++)
+    { XMin[i]=fmin(XMin[i], Edges[ne]->Centroid[i]);
+      XMax[i]=fmax(XMax[i], Edges[ne]->Centroid[i]);
+    };
+  double Width=fmax(XMax[0]-XMin[0], fmax(XMax[1]-XMin[1], XMax[2]-XMin[2]));
+  if (Width==0.0) Width=1.0;
+  double Scale=((double)((1<<MORTONBITS)-1)) / Width;
+
+  /*--------------------------------------------------------------*/
+  /*- sort by Morton key, with ties broken by the edge index -----*/
+  /*--------------------------------------------------------------*/
+  EdgeKey *Keys=(EdgeKey *)mallocEC(NumEdges*sizeof(EdgeKey));
+  for(int ne=0; ne<NumEdges; ne++)
+   { unsigned Q[3];
+     for(int i=0; i<3; i++)
+      Q[i] = (unsigned)floor( (Edges[ne]->Centroid[i]-XMin[i])*Scale );
+     Keys[ne].Key=MortonKey(Q[0], Q[1], Q[2]);
+     Keys[ne].ne=ne;
+   };
+  qsort(Keys, NumEdges, sizeof(EdgeKey), CompareEdgeKeys);
+
+  SpatialOrder=(int *)mallocEC(NumEdges*sizeof(int));
+  NumOrderedEdges=NumEdges;
+  for(int n=0; n<NumEdges; n++)
+   SpatialOrder[n]=Keys[n].ne;
+
+  free(Keys);
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+void RWGGeometry::SetSpatialEdgeOrdering(bool Enable)
+{
+  for(int ns=0; ns<NumSurfaces; ns++)
+   Surfaces[ns]->InitSpatialOrder(Enable);
+  if (Enable)
+   Log("Visiting basis functions along a space-filling curve in matrix assembly.");
+}
+
+} // namespace scuff
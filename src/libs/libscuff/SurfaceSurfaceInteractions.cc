@@ -149,6 +149,8 @@ void *GSSIThread(void *data)
   GetEEIArgs->NumTorqueAxes=NumTorqueAxes;
   GetEEIArgs->GammaMatrix=GammaMatrix;
   GetEEIArgs->Displacement=Displacement;
+  GetEEIArgs->opFC=Args->opFC;
+  GetEEIArgs->DVertex=Args->DVertex;
 
   /* pointers to arrays inside the structure */
   cdouble *GC=GetEEIArgs->GC;
@@ -177,34 +179,55 @@ void *GSSIThread(void *data)
 
   /***************************************************************/
   /* loop over all internal edges on both objects.               */
+  /* (nra indexes the rows of the block; it differs from the   */
+  /* edge index nea only if the caller asked for selected rows.*/
+  /* if the surfaces have spatial traversal orders, the edges   */
+  /* are visited in those orders; see SpatialOrdering.cc)       */
   /***************************************************************/
-  int nea, NEa=Sa->NumEdges;
-  int neb, NEb=Sb->NumEdges;
+  int *RowEdges=Args->RowEdges;
+  int *OrderA=0, *OrderB=0;
+  if ( Sa->SpatialOrder && Sa->NumOrderedEdges==Sa->NumEdges
+       && Sb->SpatialOrder && Sb->NumOrderedEdges==Sb->NumEdges
+       && Args->NumRowEdges==0
+     )
+   { OrderA=Sa->SpatialOrder;
+     OrderB=Sb->SpatialOrder;
+   };
+  int na, nea, nra, NEa=Args->NumRowEdges ? Args->NumRowEdges : Sa->NumEdges;
+  int nb, neb, NEb=Sb->NumEdges;
   int X, Y, Mu, nt=0;
   int NumGradientComponents = GradB ? 3 : 0;
   int nebStart = Symmetric ? 1 : 0;
-  for(nea=0; nea<NEa; nea++)
-   for(neb=nebStart*nea; neb<NEb; neb++)
+  for(na=0; na<NEa; na++)
+   for(nb=nebStart*na; nb<NEb; nb++)
     { 
       nt++;
       if (nt==TD->NumTasks) nt=0;
       if (nt!=TD->nt) continue;
 
-      if (G->LogLevel>=SCUFF_VERBOSELOGGING && (neb==nebStart*nea) )
-       LogPercent(nea, NEa);
+      nea = RowEdges ? RowEdges[na] : OrderA ? OrderA[na] : na;
+      neb = OrderB ? OrderB[nb] : nb;
+      if ( Symmetric && neb<nea ) 
+       { int Temp=nea; nea=neb; neb=Temp; };
+      nra = Args->NumRowEdges ? na : nea;
+
+      if (G->LogLevel>=SCUFF_VERBOSELOGGING && (nb==nebStart*na) )
+       LogPercent(na, NEa);
 
       /*--------------------------------------------------------------*/
       /*- contributions of first medium (EpsA, MuA)  -----------------*/
       /*--------------------------------------------------------------*/
       GetEEIArgs->nea     = nea;
       GetEEIArgs->neb     = neb;
+      GetEEIArgs->Far     =    Args->NearRowStart
+                            && !IsNearEdgePair(Args->NearRowStart, Args->NearCols, nea, neb);
       GetEEIArgs->k       = kA;
       GetEEIArgs->GInterp = Args->GInterpA;
       GetEdgeEdgeInteractions(GetEEIArgs);
 
       if ( SaIsPEC && SbIsPEC )
        { 
-         X=RowOffset + nea;
+         X=RowOffset + nra;
          Y=ColOffset + neb;  
 
          B->AddEntry( X, Y, PreFac1A*GC[0] );
@@ -217,7 +240,7 @@ void *GSSIThread(void *data)
        }
       else if ( SaIsPEC && !SbIsPEC )
        { 
-         X=RowOffset + nea;
+         X=RowOffset + nra;
          Y=ColOffset + 2*neb;  
 
          B->AddEntry( X, Y,   PreFac1A*GC[0] );
@@ -236,7 +259,7 @@ void *GSSIThread(void *data)
        }
       else if ( !SaIsPEC && SbIsPEC )
        {
-         X=RowOffset + 2*nea;
+         X=RowOffset + 2*nra;
          Y=ColOffset + neb;  
 
          B->AddEntry( X,   Y, PreFac1A*GC[0] );
@@ -255,7 +278,7 @@ void *GSSIThread(void *data)
        }
       else if ( !SaIsPEC && !SbIsPEC )
        { 
-         X=RowOffset + 2*nea;
+         X=RowOffset + 2*nra;
          Y=ColOffset + 2*neb;  
 
          B->AddEntry( X, Y,   PreFac1A*GC[0]);
@@ -296,7 +319,7 @@ void *GSSIThread(void *data)
          GetEEIArgs->GInterp = Args->GInterpB;
          GetEdgeEdgeInteractions(GetEEIArgs);
 
-         X=RowOffset + 2*nea;
+         X=RowOffset + 2*nra;
          Y=ColOffset + 2*neb;
 
          B->AddEntry( X, Y,   PreFac1B*GC[0]);
@@ -325,7 +348,7 @@ void *GSSIThread(void *data)
           };
        }; // if (EpsB!=0.0)
 
-    }; // for(nea=0; nea<NEa; nea++), for(neb=nebStart*nea; neb<NEb; neb++) ... 
+    }; // for(na=0; na<NEa; na++), for(nb=nebStart*na; nb<NEb; nb++) ... 
 
   memcpy(TD->PPIAlgorithmCount, GetEEIArgs->PPIAlgorithmCount, NUMPPIALGORITHMS*sizeof(unsigned));
   return 0;
@@ -350,10 +373,12 @@ void AddSurfaceSigmaContributionToBEMMatrix(GetSSIArgStruct *Args)
   /*--------------------------------------------------------------*/
   /*--------------------------------------------------------------*/
   /*--------------------------------------------------------------*/
-  HMatrix *B    = Args->B;
-  int Offset    = Args->RowOffset;
+  HMatrix *B      = Args->B;
+  int RowOffset   = Args->RowOffset;
+  int ColOffset   = Args->ColOffset;
+  int NumRowEdges = Args->NumRowEdges;
 
-  if (Offset!=Args->ColOffset)
+  if (NumRowEdges==0 && RowOffset!=ColOffset)
    ErrExit("%s:%i: internal error",__FILE__,__LINE__);
 
   /*--------------------------------------------------------------*/
@@ -370,9 +395,13 @@ void AddSurfaceSigmaContributionToBEMMatrix(GetSSIArgStruct *Args)
   /*--------------------------------------------------------------*/
   int neAlpha, neBeta;
   double Overlap;
-  for(neAlpha=0; neAlpha<S->NumEdges; neAlpha++)
-   for(neBeta=neAlpha; neBeta<S->NumEdges; neBeta++)
+  // if only some rows are wanted we can't exploit symmetry
+  int *RowEdges = Args->RowEdges;
+  int nAlpha, NAlpha = NumRowEdges ? NumRowEdges : S->NumEdges;
+  for(nAlpha=0; nAlpha<NAlpha; nAlpha++)
+   for(neBeta=(NumRowEdges ? 0 : nAlpha); neBeta<S->NumEdges; neBeta++)
     { 
+      neAlpha = RowEdges ? RowEdges[nAlpha] : nAlpha;
       Overlap=S->GetOverlap(neAlpha, neBeta);
       if (Overlap==0.0) continue;
 
@@ -416,14 +445,14 @@ void AddSurfaceSigmaContributionToBEMMatrix(GetSSIArgStruct *Args)
 #endif
 
       if ( S->IsPEC )
-       { B->AddEntry(Offset+neAlpha, Offset+neBeta, -1.0*Overlap/GZ);
-         if (neAlpha!=neBeta)
-          B->AddEntry(Offset+neBeta, Offset+neAlpha, -1.0*Overlap/GZ);
+       { B->AddEntry(RowOffset+nAlpha, ColOffset+neBeta, -1.0*Overlap/GZ);
+         if (neAlpha!=neBeta && NumRowEdges==0)
+          B->AddEntry(RowOffset+neBeta, ColOffset+neAlpha, -1.0*Overlap/GZ);
        }
       else
-       { B->AddEntry(Offset + 2*neAlpha+1, Offset + 2*neBeta+1, +GZ*Overlap);
-         if (neAlpha!=neBeta)
-          B->AddEntry(Offset + 2*neBeta+1, Offset + 2*neAlpha+1, +GZ*Overlap);
+       { B->AddEntry(RowOffset + 2*nAlpha+1, ColOffset + 2*neBeta+1, +GZ*Overlap);
+         if (neAlpha!=neBeta && NumRowEdges==0)
+          B->AddEntry(RowOffset + 2*neBeta+1, ColOffset + 2*neAlpha+1, +GZ*Overlap);
        }
       
     };
@@ -449,20 +478,23 @@ void GetSurfaceSurfaceInteractions(GetSSIArgStruct *Args)
   /*--------------------------------------------------------------*/
   /*--------------------------------------------------------------*/
   /*--------------------------------------------------------------*/
+  int NumRowBFs = Sa->NumBFs;
+  if (Args->NumRowEdges)
+   NumRowBFs = (Sa->IsPEC ? 1 : 2)*Args->NumRowEdges;
   if ( Args->Accumulate==false )
-   { Args->B->ZeroBlock(Args->RowOffset, Sa->NumBFs, Args->ColOffset, Sb->NumBFs);
+   { Args->B->ZeroBlock(Args->RowOffset, NumRowBFs, Args->ColOffset, Sb->NumBFs);
      if (Args->GradB && Args->GradB[0])
-      Args->GradB[0]->ZeroBlock(Args->RowOffset, Sa->NumBFs, Args->ColOffset, Sb->NumBFs);
+      Args->GradB[0]->ZeroBlock(Args->RowOffset, NumRowBFs, Args->ColOffset, Sb->NumBFs);
      if (Args->GradB && Args->GradB[1])
-      Args->GradB[1]->ZeroBlock(Args->RowOffset, Sa->NumBFs, Args->ColOffset, Sb->NumBFs);
+      Args->GradB[1]->ZeroBlock(Args->RowOffset, NumRowBFs, Args->ColOffset, Sb->NumBFs);
      if (Args->GradB && Args->GradB[2])
-      Args->GradB[2]->ZeroBlock(Args->RowOffset, Sa->NumBFs, Args->ColOffset, Sb->NumBFs);
+      Args->GradB[2]->ZeroBlock(Args->RowOffset, NumRowBFs, Args->ColOffset, Sb->NumBFs);
      if (Args->dBdTheta && Args->dBdTheta[0])
-      Args->dBdTheta[0]->ZeroBlock(Args->RowOffset, Sa->NumBFs, Args->ColOffset, Sb->NumBFs);
+      Args->dBdTheta[0]->ZeroBlock(Args->RowOffset, NumRowBFs, Args->ColOffset, Sb->NumBFs);
      if (Args->dBdTheta && Args->dBdTheta[1])
-      Args->dBdTheta[1]->ZeroBlock(Args->RowOffset, Sa->NumBFs, Args->ColOffset, Sb->NumBFs);
+      Args->dBdTheta[1]->ZeroBlock(Args->RowOffset, NumRowBFs, Args->ColOffset, Sb->NumBFs);
      if (Args->dBdTheta && Args->dBdTheta[2])
-      Args->dBdTheta[2]->ZeroBlock(Args->RowOffset, Sa->NumBFs, Args->ColOffset, Sb->NumBFs);
+      Args->dBdTheta[2]->ZeroBlock(Args->RowOffset, NumRowBFs, Args->ColOffset, Sb->NumBFs);
    };
 
   /***************************************************************/
@@ -509,6 +541,20 @@ void GetSurfaceSurfaceInteractions(GetSSIArgStruct *Args)
   if ( Args->EpsA==0.0 && Args->EpsB==0.0 )
    return;
 
+  /***************************************************************/
+  /* get near-interaction lists; all edge pairs not on these     */
+  /* lists are known to be far apart (see EdgeClusterTree.cc).   */
+  /* the bounding spheres of straddling edges in periodic        */
+  /* geometries do not enclose both panels, so we skip this step */
+  /* in that case and for displaced surfaces.                    */
+  /***************************************************************/
+  Args->NearRowStart=Args->NearCols=0;
+  if (    Args->Displacement==0 && !Args->UseAB9Kernel
+       && Sa->TotalStraddlers==0 && Sb->TotalStraddlers==0
+     )
+   GetNearEdgeLists(Sa->GetEdgeClusterTree(), Sb->GetEdgeClusterTree(),
+                    &(Args->NearRowStart), &(Args->NearCols));
+
   /***************************************************************/
   /* fire off threads ********************************************/
   /***************************************************************/
@@ -546,7 +592,11 @@ void GetSurfaceSurfaceInteractions(GetSSIArgStruct *Args)
   Log(" no multithreading...");
 #else
   NumTasks=NumThreads*100;
-  if (NumTasks>Sa->NumEdges) NumTasks=Sa->NumEdges;
+  int NEa = Args->NumRowEdges ? Args->NumRowEdges : Sa->NumEdges;
+  // tasks are dealt out by (row,column) pair, so a block with only
+  // a few selected rows can still keep all threads busy
+  if (Args->NumRowEdges) NEa*=Sb->NumEdges;
+  if (NumTasks>NEa) NumTasks=NEa;
   Log(" OpenMP multithreading (%i threads,%i tasks)...",NumThreads,NumTasks);
 #pragma omp parallel for schedule(dynamic,1), num_threads(NumThreads)
 #endif
@@ -562,6 +612,12 @@ void GetSurfaceSurfaceInteractions(GetSSIArgStruct *Args)
    };
 #endif
 
+  if (Args->NearRowStart)
+   { free(Args->NearRowStart);
+     free(Args->NearCols);
+     Args->NearRowStart=Args->NearCols=0;
+   };
+
   if (G->LogLevel>=SCUFF_VERBOSELOGGING)
    { Log("  %i/%i cache hits/misses",GlobalFIPPICache.Hits,GlobalFIPPICache.Misses);
      Log("  PPIs: LOC(%u), HOC(%u), TD(%u), HK(%u), D(%u)",
@@ -635,6 +691,15 @@ void InitGetSSIArgs(GetSSIArgStruct *Args)
 
   Args->Accumulate=false;
 
+  Args->NumRowEdges=0;
+  Args->RowEdges=0;
+
+  Args->opFC=0;
+  Args->DVertex=0;
+
+  Args->NearRowStart=0;
+  Args->NearCols=0;
+
 }
 
 } // namespace scuff
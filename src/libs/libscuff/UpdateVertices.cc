@@ -0,0 +1,340 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * UpdateVertices.cc -- in-place modification of vertex positions, for
+ *                   -- parametric shape sweeps (varying a gap or an
+ *                   -- aperture radius by moving a few vertices)
+ *
+ * how it works:
+ *
+ *  (a) RWGSurface::UpdateVertices() overwrites the coordinates of
+ *      the given vertices and recomputes the geometric data of just
+ *      those panels that have one of the moved vertices as a corner
+ *      and of just those edges that bound one of these panels. the
+ *      mesh topology (and hence the numbering of panels, edges, and
+ *      basis functions) is unchanged. the edges whose basis functions
+ *      changed are marked in the surface's EdgeMoved[] array.
+ *
+ *  (b) the panel kd-tree and the edge cluster tree store copies of
+ *      the panel and edge coordinates and their partitioning depends
+ *      on them, so they are simply discarded and rebuilt the next
+ *      time they are needed.
+ *
+ *  (c) the FIPPI cache is keyed on the relative positions of panel
+ *      vertices, so cached integrals for pairs of unmoved panels
+ *      remain valid and nothing needs to be done.
+ *
+ *  (d) RWGGeometry::UpdateBEMMatrix() takes a BEM matrix assembled
+ *      before the vertices moved and recomputes only the rows that
+ *      belong to marked edges. since the (non-periodic) BEM matrix is
+ *      symmetric, the columns of the marked edges are then filled in
+ *      from these rows.
+ *
+ *  (e) the marks are left in place by UpdateBEMMatrix(), so that a
+ *      caller holding BEM matrices at several frequencies can update
+ *      each of them; once all are up to date, the caller clears the
+ *      marks with RWGGeometry::ClearMovedEdges(). further vertex
+ *      motion before that simply adds to the set of marked edges.
+ *
+ * agent         -- 10/2026
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include <libhmat.h>
+
+#include "libscuff.h"
+#include "libscuffInternals.h"
+
+namespace scuff {
+
+/***************************************************************/
+/* recompute the centroid, length, and bounding radius of E    */
+/* from the current vertex coordinates.                        */
+/***************************************************************/
+void UpdateEdgeGeometry(RWGEdge *E, double *Vertices)
+{
+  double *V1=Vertices + 3*E->iV1;
+  double *V2=Vertices + 3*E->iV2;
+  for(int i=0; i<3; i++)
+   E->Centroid[i]=(V1[i] + V2[i]) / 2.0;
+  E->Length=VecDistance(V1, V2);
+
+  /* bounding radius is max distance from centroid to any vertex */
+  E->Radius=VecDistance(E->Centroid, Vertices+3*E->iQP);
+  if (E->iQM!=-1)
+   E->Radius=fmax(E->Radius, VecDistance(E->Centroid,Vertices+3*E->iQM));
+  E->Radius=fmax(E->Radius, VecDistance(E->Centroid,V1));
+  E->Radius=fmax(E->Radius, VecDistance(E->Centroid,V2));
+}
+
+/***************************************************************/
+/* move vertex #MovedVertices[n] to the point with cartesian    */
+/* coordinates NewVertices[3*n+0,1,2], n=0..NumMovedVertices-1. */
+/* the new coordinates are in the current frame of the surface, */
+/* i.e. including the effect of any Transform()s.               */
+/*                                                             */
+/* the return value is the number of basis functions (interior */
+/* edges, or promoted exterior edges) that were changed; if    */
+/* MovedEdges is non-NULL, it must have space for NumEdges     */
+/* integers and on return contains the indices of these edges. */
+/***************************************************************/
+int RWGSurface::UpdateVertices(int NumMovedVertices, const int *MovedVertices,
+                               const double *NewVertices, int *MovedEdges)
+{
+  if (NumSlices>1)
+   ErrExit("%s: cannot move vertices of rotationally-symmetric surface",Label);
+  if (TotalStraddlers>0)
+   ErrExit("%s: cannot move vertices of periodic surface",Label);
+
+  /*--------------------------------------------------------------*/
+  /*- overwrite the vertex coordinates ---------------------------*/
+  /*--------------------------------------------------------------*/
+  char *VertexMoved=(char *)mallocEC(NumVertices*sizeof(char));
+  memset(VertexMoved, 0, NumVertices*sizeof(char));
+  for(int n=0; n<NumMovedVertices; n++)
+   { int nv=MovedVertices[n];
+     if (nv<0 || nv>=NumVertices)
+      ErrExit("%s: invalid vertex index %i",Label,nv);
+     memcpy(Vertices + 3*nv, NewVertices + 3*n, 3*sizeof(double));
+     VertexMoved[nv]=1;
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- recompute panels with at least one moved vertex -------------*/
+  /*--------------------------------------------------------------*/
+  char *PanelMoved=(char *)mallocEC(NumPanels*sizeof(char));
+  int NumMovedPanels=0;
+  for(int np=0; np<NumPanels; np++)
+   { int *VI=Panels[np]->VI;
+     PanelMoved[np] = VertexMoved[VI[0]] || VertexMoved[VI[1]] || VertexMoved[VI[2]];
+     if (PanelMoved[np])
+      { InitRWGPanel(Panels[np], Vertices);
+        NumMovedPanels++;
+      };
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- recompute edges bounding at least one moved panel. note that*/
+  /*- promoted exterior edges appear in both Edges[] and          */
+  /*- ExteriorEdges[]; updating them twice is harmless.           */
+  /*--------------------------------------------------------------*/
+  if (EdgeMoved==0)
+   { EdgeMoved=(int *)mallocEC(NumEdges*sizeof(int));
+     memset(EdgeMoved, 0, NumEdges*sizeof(int));
+   };
+
+  int NumMovedEdges=0;
+  for(int ne=0; ne<NumEdges; ne++)
+   { RWGEdge *E=Edges[ne];
+     if ( !PanelMoved[E->iPPanel] && (E->iMPanel==-1 || !PanelMoved[E->iMPanel]) )
+      continue;
+     UpdateEdgeGeometry(E, Vertices);
+     EdgeMoved[ne]=1;
+     if (MovedEdges)
+      MovedEdges[NumMovedEdges]=ne;
+     NumMovedEdges++;
+   };
+
+  for(int ne=0; ne<NumExteriorEdges; ne++)
+   { RWGEdge *E=ExteriorEdges[ne];
+     if ( E && PanelMoved[E->iPPanel] )
+      UpdateEdgeGeometry(E, Vertices);
+   };
+
+  free(VertexMoved);
+  free(PanelMoved);
+
+  /*--------------------------------------------------------------*/
+  /*- bounding box, kd-tree, and edge cluster tree ---------------*/
+  /*--------------------------------------------------------------*/
+  UpdateBoundingBox();
+  kdtri_destroy(kdPanels);
+  kdPanels=NULL;
+  ClearEdgeClusterTree();
+
+  Log("Moved %i vertices of surface %s (%i panels, %i basis functions changed)",
+       NumMovedVertices,Label,NumMovedPanels,NumMovedEdges);
+
+  return NumMovedEdges;
+}
+
+/***************************************************************/
+/* geometry-level wrapper: move vertices of surface #ns and    */
+/* update any geometry-wide data that depended on them.        */
+/***************************************************************/
+int RWGGeometry::UpdateVertices(int ns, int NumMovedVertices,
+                                const int *MovedVertices,
+                                const double *NewVertices,
+                                int *MovedEdges)
+{
+  if (ns<0 || ns>=NumSurfaces)
+   ErrExit("%s:%i: invalid surface index %i",__FILE__,__LINE__,ns);
+  if (LDim>0)
+   ErrExit("vertex updates are not supported for periodic geometries");
+
+  int NumMovedEdges=Surfaces[ns]->UpdateVertices(NumMovedVertices, MovedVertices,
+                                                 NewVertices, MovedEdges);
+
+  /*--------------------------------------------------------------*/
+  /*- surface #ns is no longer identical to its former mates: if  */
+  /*- it was the representative of a class of identical surfaces, */
+  /*- the next member of that class takes over.                   */
+  /*--------------------------------------------------------------*/
+  if (Mate[ns]!=-1)
+   Mate[ns]=-1;
+  else
+   { int NewRep=-1;
+     for(int nsp=ns+1; nsp<NumSurfaces; nsp++)
+      if (Mate[nsp]==ns)
+       { Mate[nsp] = (NewRep==-1) ? -1 : NewRep;
+         if (NewRep==-1) NewRep=nsp;
+       };
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- a deformation will generally break any mirror symmetry      */
+  /*--------------------------------------------------------------*/
+  if (MirrorData)
+   { Warn("surface %s deformed; disabling mirror symmetry",Surfaces[ns]->Label);
+     DestroyMirrorSymmetry();
+     NumMirrorPlanes=0;
+   };
+
+  return NumMovedEdges;
+}
+
+/***************************************************************/
+/* clear the records of moved edges on all surfaces. call this */
+/* once every BEM matrix assembled before the vertices moved   */
+/* has been passed to UpdateBEMMatrix() (or discarded).        */
+/***************************************************************/
+void RWGGeometry::ClearMovedEdges()
+{
+  for(int ns=0; ns<NumSurfaces; ns++)
+   if (Surfaces[ns]->EdgeMoved)
+    memset(Surfaces[ns]->EdgeMoved, 0, Surfaces[ns]->NumEdges*sizeof(int));
+}
+
+/***************************************************************/
+/* update a BEM matrix to account for vertex motion since it   */
+/* was assembled.                                              */
+/*                                                             */
+/* on entry, M must contain the (unfactorized) BEM matrix at   */
+/* the same frequency Omega for the geometry as it was at the  */
+/* last call to ClearMovedEdges(). on return, the rows and     */
+/* columns of M belonging to basis functions that changed      */
+/* since then have been recomputed. if M is NULL or has the    */
+/* wrong size, the full matrix is assembled from scratch.      */
+/*                                                             */
+/* the moved-edge records are not cleared, so several matrices */
+/* (e.g. at different frequencies) may be updated in turn; the */
+/* caller must call ClearMovedEdges() when done with them.     */
+/***************************************************************/
+HMatrix *RWGGeometry::UpdateBEMMatrix(cdouble Omega, HMatrix *M)
+{
+  if (LDim>0)
+   ErrExit("%s:%i: UpdateBEMMatrix is not supported for periodic geometries",__FILE__,__LINE__);
+
+  if ( M==0 || M->NR!=TotalBFs || M->NC!=TotalBFs )
+   return AssembleBEMMatrix(Omega, M);
+
+  /*--------------------------------------------------------------*/
+  /*- gather the moved edges on each surface ---------------------*/
+  /*--------------------------------------------------------------*/
+  int *NumRowEdges = (int *)mallocEC(NumSurfaces*sizeof(int));
+  int **RowEdges   = (int **)mallocEC(NumSurfaces*sizeof(int *));
+  int *RowOffset   = (int *)mallocEC(NumSurfaces*sizeof(int));
+  int NumRows=0;
+  for(int ns=0; ns<NumSurfaces; ns++)
+   { RWGSurface *S=Surfaces[ns];
+     NumRowEdges[ns]=0;
+     RowEdges[ns]=(int *)mallocEC((S->NumEdges+1)*sizeof(int));
+     RowOffset[ns]=NumRows;
+     if (S->EdgeMoved)
+      for(int ne=0; ne<S->NumEdges; ne++)
+       if (S->EdgeMoved[ne])
+        RowEdges[ns][ NumRowEdges[ns]++ ] = ne;
+     NumRows += (S->IsPEC ? 1 : 2)*NumRowEdges[ns];
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- compute the rows of the moved basis functions --------------*/
+  /*--------------------------------------------------------------*/
+  if (NumRows>0)
+   {
+     Log("Recomputing %i of %i rows of BEM matrix at Omega=(%g,%g)...",
+          NumRows,TotalBFs,real(Omega),imag(Omega));
+
+     HMatrix *B0=new HMatrix(NumRows, TotalBFs, M->RealComplex);
+
+     GetSSIArgStruct MyArgs, *Args=&MyArgs;
+     InitGetSSIArgs(Args);
+     Args->G=this;
+     Args->Omega=Omega;
+     Args->B=B0;
+     for(int ns=0; ns<NumSurfaces; ns++)
+      { if (NumRowEdges[ns]==0) continue;
+        for(int nsp=0; nsp<NumSurfaces; nsp++)
+         { Args->Sa=Surfaces[ns];
+           Args->Sb=Surfaces[nsp];
+           Args->RowOffset=RowOffset[ns];
+           Args->ColOffset=BFIndexOffset[nsp];
+           Args->NumRowEdges=NumRowEdges[ns];
+           Args->RowEdges=RowEdges[ns];
+           GetSurfaceSurfaceInteractions(Args);
+         };
+      };
+
+     /*--------------------------------------------------------------*/
+     /*- stamp the new rows, and by symmetry the new columns, into M */
+     /*--------------------------------------------------------------*/
+     for(int ns=0; ns<NumSurfaces; ns++)
+      { int BFsPerEdge = Surfaces[ns]->IsPEC ? 1 : 2;
+        for(int n=0; n<NumRowEdges[ns]; n++)
+         for(int k=0; k<BFsPerEdge; k++)
+          { int Row  = BFIndexOffset[ns] + BFsPerEdge*RowEdges[ns][n] + k;
+            int BRow = RowOffset[ns] + BFsPerEdge*n + k;
+            for(int nc=0; nc<TotalBFs; nc++)
+             { cdouble MEntry=B0->GetEntry(BRow, nc);
+               M->SetEntry(Row, nc, MEntry);
+               if (M->StorageType==LHM_NORMAL)
+                M->SetEntry(nc, Row, MEntry);
+             };
+          };
+      };
+
+     delete B0;
+   };
+
+  for(int ns=0; ns<NumSurfaces; ns++)
+   free(RowEdges[ns]);
+  free(RowEdges);
+  free(NumRowEdges);
+  free(RowOffset);
+
+  return M;
+}
+
+} // namespace scuff
@@ -209,6 +209,10 @@ class RWGSurface
    void Transform(const char *format, ...);
    void UnTransform();
 
+   /* move individual vertices in place (see UpdateVertices.cc) */
+   int UpdateVertices(int NumMovedVertices, const int *MovedVertices,
+                      const double *NewVertices, int *MovedEdges=0);
+
    /* fast inclusion tests */
    bool Contains(const double X[3]);
    bool Contains(const RWGSurface *S);
@@ -235,6 +239,7 @@ class RWGSurface
    RWGPanel **Panels;              /* array of pointers to panels         */
    RWGEdge **Edges;                /* array of pointers to edges          */
    RWGEdge **ExteriorEdges;        /* array of pointers to exterior edges */
+   RWGEdge *EdgeBlock;             /* storage for all RWGEdge structures  */
    int IsClosed;                   /* = 1 for a closed surface, 0 for an open surface */
    double RMax[3], RMin[3];        /* bounding box corners */
 
@@ -253,6 +258,7 @@ class RWGSurface
    int NumBCs;                     /* number of boundary countours */
 
    int Index;                      /* index of this surface in geometry  */
+   bool FromSnapshot;              /* true if the topology was read from a geometry snapshot */
 
    int *WhichBC;                   /* WhichBC[nv] = index of boundary contour */
                                    /* on which vertex #nv lies (=0 if vertex  */
@@ -268,9 +274,28 @@ class RWGSurface
    int MeshTag;                    /* index of entity within mesh file; = -1 if not applicable */
    char *Label;                    /* unique label identifying surface */
 
+   /* EdgeMoved[ne]=1 if the basis function on edge #ne has been   */
+   /* changed by UpdateVertices() since the last call to           */
+   /* RWGGeometry::ClearMovedEdges() (NULL if UpdateVertices() was */
+   /* never called)                                                */
+   int *EdgeMoved;
+
+   /* if non-NULL, SpatialOrder[0..NumOrderedEdges-1] is the order  */
+   /* in which the matrix-assembly loops visit the edges (along a   */
+   /* space-filling curve); the numbering of the edges and basis    */
+   /* functions is not affected (see SpatialOrdering.cc)            */
+   int *SpatialOrder;
+   int NumOrderedEdges;
+
    kdtri kdPanels; /* kd-tree of panels */
    void InitkdPanels(bool reinit = false, int LogLevel = SCUFF_NOLOGGING);
 
+   /* bounding-sphere tree over the edges, built on first use and */
+   /* discarded whenever the surface moves (see EdgeClusterTree.cc) */
+   void *ECTree;
+   void *GetEdgeClusterTree();
+   void ClearEdgeClusterTree();
+
    /* GT encodes any transformation that has been carried out since */
    /* the surface was read from its mesh file (not including a      */
    /* possible one-time GTransformation that may have been specified*/
@@ -289,6 +314,16 @@ class RWGSurface
    int MaterialRegionsLineNum;     /* line of .scuffgeo file on which MATERIAL or REGIONS keyword appeared */
    char *MaterialName;             /* name of material in OBJECT...ENDOBJECT section */
 
+   /* NumSlices>1 if the surface was declared with ROTATIONAL_SYMMETRY: */
+   /* the mesh file then describes one slice, and the full surface is  */
+   /* invariant under rotation by 2pi/NumSlices about the axis through  */
+   /* SymmetryOrigin along SymmetryAxis (both as of surface creation,   */
+   /* i.e. not including subsequent Transform()s). edge                 */
+   /* #(k*NumEdges/NumSlices + n) is the image of edge #n under k       */
+   /* rotations (see RotationalSymmetry.cc)                             */
+   int NumSlices;
+   double SymmetryOrigin[3], SymmetryAxis[3];
+
    // 20140327 explain me
    int TotalStraddlers;
    int *PhasedBFCs; // 'phased basis-function contributions'
@@ -303,10 +338,16 @@ class RWGSurface
    void InitEdgeList();
    void ReadGMSHFile(FILE *MeshFile, char *FileName, const GTransformation *GT, int MeshTag);
    void ReadComsolFile(FILE *MeshFile, char *FileName, const GTransformation *GT);
+   void ReplicateSlice(const GTransformation *OTGT);
+   void SortEdgesBySlice();
+   void InitSpatialOrder(bool Enable);
+
+   /* binary snapshots of the surface topology (GeometrySnapshot.cc) */
+   unsigned long long GetSnapshotKey(FILE *MeshFile, const GTransformation *OTGT);
+   bool ReadSnapshot(unsigned long long Key);
+   void WriteSnapshot(unsigned long long Key);
 
    /* calculate reduced potentials due to a single basis function */
-   /* (this is a helper function used to implement the            */
-   /*  GetInnerProducts() class method)                           */
    void GetReducedPotentials(int ne, const double *X, cdouble K, Interp3D *GBarInterp,
                              cdouble *a, cdouble *Curla, cdouble *Gradp);
 
@@ -345,6 +386,31 @@ class RWGGeometry
    void UnTransform();
    char *CheckGTCList(GTComplex **GTCList, int NumGTCs);
 
+   /* in-place deformation of a single surface; UpdateBEMMatrix()   */
+   /* then recomputes just the rows and columns of a previously     */
+   /* assembled BEM matrix that were affected. the moved edges stay */
+   /* marked until ClearMovedEdges() is called, so every matrix     */
+   /* held by the caller can be updated first (see UpdateVertices.cc)*/
+   int UpdateVertices(int ns, int NumMovedVertices, const int *MovedVertices,
+                      const double *NewVertices, int *MovedEdges=0);
+   HMatrix *UpdateBEMMatrix(cdouble Omega, HMatrix *M);
+   void ClearMovedEdges();
+
+   /* derivatives of the BEM matrix with respect to the coordinates */
+   /* of mesh vertices, for shape optimization (see                 */
+   /* AssembleDMDVMatrix.cc)                                        */
+   HMatrix *AllocateDMDVMatrix(bool PureImagFreq=false);
+   HMatrix *AssembleDMDVMatrix(int ns, int nv, int Mu, cdouble Omega,
+                               HMatrix *DMDV=0);
+   HMatrix *GetDMDVContractions(int ns, cdouble Omega, HVector *Lambda,
+                                HVector *KN, HMatrix *LDMDVKN=0);
+
+   /* visit the basis functions of each surface along a space-      */
+   /* filling curve in the BEM matrix assembly loops, for better     */
+   /* cache reuse; results and numbering are unchanged (see         */
+   /* SpatialOrdering.cc)                                           */
+   void SetSpatialEdgeOrdering(bool Enable);
+
    /* visualization */
    void WritePPMesh(const char *FileName, const char *Tag, int PlotNormals=0);
    void WriteGPMesh(const char *format, ...);
@@ -367,6 +433,28 @@ class RWGGeometry
                                bool NeedZDerivative=false);
    void DestroyABMBAccelerator(void *Accelerator);
 
+   /* routines for geometries with N-fold rotational symmetry: the   */
+   /* BEM matrix is replaced by GetNumSymmetryBlocks() smaller       */
+   /* blocks (one per harmonic); LUSolveSymmetric() overwrites the   */
+   /* RHS vector KN with the solution vector for the full geometry.  */
+   int GetNumSymmetryBlocks();
+   HMatrix **AllocateSymmetryBlocks();
+   void AssembleSymmetryBlocks(cdouble Omega, HMatrix **MBlocks);
+   void LUFactorizeSymmetryBlocks(HMatrix **MBlocks);
+   void LUSolveSymmetric(HMatrix **MBlocks, HVector *KN);
+
+   /* analogous routines for geometries with mirror symmetry (one    */
+   /* block per irreducible representation of the reflection group). */
+   /* CheckMirrorSymmetry() returns false if surfaces have been      */
+   /* transformed since construction in a way that invalidates the   */
+   /* symmetry data; AssembleMirrorBlocks() exits in that case.      */
+   int GetNumMirrorBlocks();
+   HMatrix **AllocateMirrorBlocks();
+   void AssembleMirrorBlocks(cdouble Omega, HMatrix **MBlocks);
+   void LUFactorizeMirrorBlocks(HMatrix **MBlocks);
+   void LUSolveMirror(HMatrix **MBlocks, HVector *KN);
+   bool CheckMirrorSymmetry();
+
    /* routines for allocating, and then filling in, the RHS vector */
    HVector *AllocateRHSVector(bool PureImagFreq = false );
    HVector *AssembleRHSVector(cdouble Omega, IncField *IF, HVector *RHS = NULL);
@@ -375,6 +463,7 @@ class RWGGeometry
 
    // get the index of the region containing point X
    int GetRegionIndex(const double X[3]);
+   void GetRegionIndices(HMatrix *XMatrix, int *Regions);
    int PointInRegion(int RegionIndex, const double X[3]); 
 
    /* simplest routine for computing fields */
@@ -407,6 +496,20 @@ class RWGGeometry
    HMatrix *GetFieldsGrid(SurfaceGrid &grid, const char *expr,
 			  cdouble Omega, HVector *KN=NULL, IncField *inc=NULL);
 
+   /* streaming variant of GetFieldsGrids: the grid is evaluated in
+      tiles of TileRows rows, each of which is written to FileName
+      (HDF5 if the name ends in .h5/.hdf5, raw binary otherwise) as
+      soon as it is done; if Resume is true, tiles already present
+      in FileName are skipped. Returns the number of tiles computed. */
+   int GetFieldsGridsToFile(SurfaceGrid &grid, int nfuncs, FieldFunc **funcs,
+			    cdouble Omega, HVector *KN, IncField *inc,
+			    const char *FileName, int TileRows=0,
+			    bool Resume=false);
+   int GetFieldsGridsToFile(SurfaceGrid &grid, const char *exprs,
+			    cdouble Omega, HVector *KN, IncField *inc,
+			    const char *FileName, int TileRows=0,
+			    bool Resume=false);
+
    /* routine for computing dyadic green's functions */
    void GetDyadicGFs(double X[3], cdouble Omega, HMatrix *M, HVector *KN,
                      cdouble GE[3][3], cdouble GM[3][3]);
@@ -414,6 +517,12 @@ class RWGGeometry
                      cdouble Omega, HMatrix *M, HVector *KN,
                      cdouble GEScat[3][3], cdouble GMScat[3][3],
                      cdouble GETot[3][3], cdouble GMTot[3][3]);
+   // batched version: BlockSize points share each LU solve, with
+   // 2*TotalBFs*(3 or 6)*BlockSize matrix entries of workspace;
+   // BlockSize=0 caps that at 2x256 MB (see GetDyadicGFs.cc)
+   HMatrix *GetDyadicGFs(HMatrix *XMatrix, cdouble Omega,
+                         HMatrix *M, HMatrix *GMatrix=0,
+                         bool ElectricOnly=false, int BlockSize=0);
 
    /* routine for computing power, force, and torque on an object */
    void GetPFT(HVector *KN, HVector *RHS, cdouble Omega, int SurfaceIndex, double PFT[8]);
@@ -461,8 +570,11 @@ class RWGGeometry
    HVector *AssembleRHSVector(cdouble Omega, double *kBloch, IncField *IF, HVector *RHS = NULL);
    void GetFields(IncField *IF, HVector *KN, cdouble Omega, double *kBloch,
                   double *X, cdouble *EH);
+   /* if Regions is non-NULL, it must have XMatrix->NR entries, and on */
+   /* return it holds the index of the region containing each point.   */
    HMatrix *GetFields(IncField *IF, HVector *KN, cdouble Omega, double *kBloch,
-                      HMatrix *XMatrix, HMatrix *FMatrix=NULL, char *FuncString=NULL);
+                      HMatrix *XMatrix, HMatrix *FMatrix=NULL, char *FuncString=NULL,
+                      int *Regions=NULL);
    void RegisterTransformationList(GTComplex **GTCList, int NumTransformations);
 
    /*--------------------------------------------------------------------*/ 
@@ -477,6 +589,10 @@ class RWGGeometry
    // helper functions for AssembleBEMMatrix
    void UpdateCachedEpsMuValues(cdouble Omega);
 
+   // helper functions for mirror-symmetric geometries (MirrorSymmetry.cc)
+   void InitMirrorSymmetry(bool Auto);
+   void DestroyMirrorSymmetry();
+
    // the following helper functions are only used for periodic boundary conditions
    void InitPBCData();
    void GetRegionExtents(int nr, double RMax[3], double RMin[3], double *DeltaR=0, int *NPoints=0);
@@ -558,6 +674,18 @@ class RWGGeometry
    /*      properties                                           */
    int *Mate;
 
+   /* NumSlices>1 if all surfaces have the same NumSlices-fold  */
+   /* rotational symmetry (see RotationalSymmetry.cc)           */
+   int NumSlices;
+
+   /* NumMirrorPlanes>0 if the geometry is symmetric under the  */
+   /* reflections x_i -> -x_i for i=MirrorPlanes[0..N-1]; the   */
+   /* action of the symmetry group on the basis functions is    */
+   /* stored in MirrorData (see MirrorSymmetry.cc)              */
+   int NumMirrorPlanes;
+   int MirrorPlanes[3];
+   void *MirrorData;
+
    /* SurfaceMoved[i] = 1 if surface #i was moved on the most   */
    /* recent call to Transform(). Otherwise SurfaceMoved[i]=0.  */
    int *SurfaceMoved;
@@ -570,6 +698,25 @@ class RWGGeometry
    static bool UseHighKTaylorDuffy;
    static bool UseTaylorDuffyV2P0;
 
+   /* if TreecodeTolerance>0, GetFields() computes scattered fields */
+   /* at >= TreecodeMinPoints evaluation points using a treecode    */
+   /* with the given relative accuracy (see FieldTreecode.cc)       */
+   static double TreecodeTolerance;
+   static int TreecodeMinPoints;
+
+   /* geometry snapshot cache (see GeometrySnapshot.cc): after      */
+   /* SetSnapshotDir(Dir), every RWGGeometry constructed caches the */
+   /* topology of its surfaces (vertices, panels, edges, exterior   */
+   /* edges, boundary contours) in directory Dir, which is created  */
+   /* if it does not exist, and reuses it on later runs instead of  */
+   /* re-parsing the mesh files. Dir receives one file              */
+   /* KEY.scuffsnap per distinct surface and one file               */
+   /* STAMP.scuffstamp per mesh file, where KEY and STAMP are       */
+   /* 16-digit hexadecimal hashes; it may be shared by concurrent   */
+   /* runs. SetSnapshotDir(0) disables the cache (the default).     */
+   static void SetSnapshotDir(const char *Dir);
+   static char *SnapshotDir;
+
  };
 
 /***************************************************************/
@@ -577,9 +724,17 @@ class RWGGeometry
 /***************************************************************/
 RWGPanel *NewRWGPanel(double *Vertices, int iV1, int iV2, int iV3);
 void InitRWGPanel(RWGPanel *P, double *Vertices);
+void UpdateEdgeGeometry(RWGEdge *E, double *Vertices);
 int CountCommonRegions(RWGSurface *Sa, RWGSurface *Sb, 
                        int CommonRegionIndices[2], double Signs[2]);
 
+/* projections of an RWG basis function onto regular spherical */
+/* waves about X0 (GetSphericalMoments.cc)                     */
+void GetMNProjections(RWGSurface *S, int ne, cdouble k, int lMax,
+                      cdouble *MArray, cdouble *NArray, double *Workspace,
+                      cdouble *MProjections, cdouble *NProjections,
+                      const double *X0=0, bool Conjugate=true);
+
 /*--------------------------------------------------------------*/
 /*--------------------------------------------------------------*/
 /*- 4. some other lower-level non-class methods                -*/
@@ -630,6 +785,21 @@ cdouble ExpRelV2P0(int n, cdouble Z);
 void PreloadCache(const char *FileName);
 void StoreCache(const char *FileName);
 
+/*--------------------------------------------------------------*/
+/*- concurrent evaluation of frequency integrands in worker     */
+/*- processes (FrequencyWorkers.cc)                             */
+/*--------------------------------------------------------------*/
+typedef void (*FrequencyFunction)(void *UserData, const double *x, double *fval);
+void ReserveFrequencyWorkers(int NumWorkers);
+void *CreateFrequencyWorkers(FrequencyFunction Function, void *UserData,
+                             int ndim, int fdim, int NumWorkers);
+int GetNumFrequencyWorkers(void *FWD);
+int GetFrequencyWorkerIndex();
+void EvaluateFrequencyPoints(void *FWD, int NumPoints, const double *x, double *fval);
+void DestroyFrequencyWorkers(void *FWD);
+void LockOutputFile(FILE *f);
+void UnlockOutputFile(FILE *f);
+
 } // namespace scuff
 
 #endif // #ifndef LIBSCUFF_H
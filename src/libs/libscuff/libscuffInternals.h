@@ -43,6 +43,12 @@ namespace scuff {
 #define PPIALG_DESING        4
 #define NUMPPIALGORITHMS     5
 
+// the 'desingularization radius': if the relative distance between
+// two panels (centroid distance / larger panel radius) is < this
+// number, we evaluate the PPIs using the low-k taylor-series
+// expansion (desingularization); otherwise we use simple cubature.
+#define DESINGULARIZATION_RADIUS 4.0
+
 /***************************************************************/ 
 /* 1. argument structures for routines whose input/output      */
 /*    interface is so complicated that an ordinary C++         */
@@ -80,6 +86,17 @@ typedef struct GetPPIArgStruct
    // this is an optional 3-vector displacement applied to object b
    double *Displacement;
 
+   // if this flag is true, the caller guarantees that the panels are
+   // farther apart than DESINGULARIZATION_RADIUS, and the routine
+   // skips straight to cubature (ignored if Displacement is nonzero)
+   bool Far;
+
+   // if this is nonzero, it points to the coordinates of a vertex of
+   // Sa, and GradH[2*Mu+0,1] return the derivatives of H[0,1] with
+   // respect to coordinate Mu of that vertex instead of the derivatives
+   // with respect to a displacement (see AssembleDMDVMatrix.cc)
+   double *DVertex;
+
    // this field is filled in by the PanelPanelInteractions() routine
    // to indicate which of the various computational algorithms was   
    // used to compute the panel-panel integrals
@@ -137,6 +154,15 @@ typedef struct GetEEIArgStruct
 
    void *opFC; // 'opaque pointer to FIPPI cache'
 
+   // if this flag is true, the caller guarantees that all four
+   // panel pairs are farther apart than DESINGULARIZATION_RADIUS
+   // (see EdgeClusterTree.cc)
+   bool Far;
+
+   // optional vertex of Sa; if nonzero, GradGC returns derivatives
+   // with respect to its coordinates (see GetPPIArgStruct)
+   double *DVertex;
+
    // this is used to force the code to use a specific
    // panel-integration algorithm; for diagnostic purposes only
    int Force;
@@ -201,6 +227,25 @@ typedef struct GetSSIArgStruct
    // augments (does not overwrite) the matrix entries
    bool Accumulate;
 
+   // if this is nonzero, only NumRowEdges rows (or pairs of rows,
+   // for non-PEC surfaces) of the block are computed: those of
+   // edges RowEdges[0..NumRowEdges-1] of Sa, or of the first
+   // NumRowEdges edges if RowEdges is NULL. row #n of the output
+   // block corresponds to the nth of these edges. (used for
+   // symmetric geometries; see RotationalSymmetry.cc and
+   // MirrorSymmetry.cc)
+   int NumRowEdges;
+   int *RowEdges;
+
+   // optional FIPPI cache to use instead of the global cache
+   // (for panel pairs that will not recur; see AssembleDMDVMatrix.cc)
+   void *opFC;
+
+   // optional vertex of Sa; if nonzero, GradB[Mu] receives the
+   // derivative of the block with respect to coordinate Mu of
+   // that vertex (see AssembleDMDVMatrix.cc)
+   double *DVertex;
+
    // output fields filled in by routine
    HMatrix *B;
    HMatrix **GradB;
@@ -213,6 +258,7 @@ typedef struct GetSSIArgStruct
    cdouble MuA, MuB;
    int SaIsPEC, SbIsPEC;
    Interp3D *GInterpA, *GInterpB;
+   int *NearRowStart, *NearCols; // near-interaction lists (EdgeClusterTree.cc)
 
  } GetSSIArgStruct;
 
@@ -220,6 +266,17 @@ void InitGetSSIArgs(GetSSIArgStruct *Args);
 void GetSurfaceSurfaceInteractions(GetSSIArgStruct *Args);
 void AddSurfaceSigmaContributionToBEMMatrix(GetSSIArgStruct *Args);
 
+/*--------------------------------------------------------------*/
+/*- bounding-sphere hierarchies over the edges of a surface, and */
+/*- near-interaction lists for pairs of surfaces                 */
+/*- (EdgeClusterTree.cc)                                         */
+/*--------------------------------------------------------------*/
+void *CreateEdgeClusterTree(RWGSurface *S);
+void DestroyEdgeClusterTree(void *opECT);
+void GetNearEdgeLists(void *opECTA, void *opECTB,
+                      int **pRowStart, int **pCols);
+bool IsNearEdgePair(const int *RowStart, const int *Cols, int nea, int neb);
+
 /***************************************************************/
 /* 2. definition of data structures and methods for working    */
 /*    with frequency-independent panel-panel integrals (FIPPIs)*/
@@ -362,6 +419,49 @@ typedef struct GBarData
 void GBarVDPhi3D(double X1, double X2, double X3, 
                  void *UserData, double *PhiVD);
 
+/***************************************************************/
+/* treecode for accelerated scattered-field computations at    */
+/* many evaluation points (FieldTreecode.cc)                   */
+/***************************************************************/
+void *CreateFieldTreecode(RWGGeometry *G, HVector *KN, cdouble Omega,
+                          double Tolerance);
+void DestroyFieldTreecode(void *opFTC);
+void *CreateTreecodeWorkspace();
+void DestroyTreecodeWorkspace(void *Workspace);
+void GetTreecodeScatteredFields(void *opFTC, const double X[3],
+                                int RegionIndex, cdouble EHS[6],
+                                void *Workspace);
+
+/***************************************************************/
+/* parsing core shared by the mesh-file readers                */
+/* (MeshFileBuffer.cc)                                         */
+/***************************************************************/
+typedef struct MeshFileBuffer
+ {
+   const char *FileName;
+   char *Data;          // file contents, NUL-terminated
+   size_t Size;         // size of file
+   size_t Pos;          // current read position
+   int LineNum;         // number of lines read so far
+   bool Mapped;         // true if Data is memory-mapped
+
+ } MeshFileBuffer;
+
+typedef bool (*MeshLineParser)(const char *Line, int nl, void *UserData);
+
+MeshFileBuffer *OpenMeshFileBuffer(FILE *f, const char *FileName);
+void CloseMeshFileBuffer(MeshFileBuffer *MFB);
+const char *GetMeshLine(MeshFileBuffer *MFB);
+const char *SkipToMeshLine(MeshFileBuffer *MFB, const char *SearchString);
+bool MeshLineIs(const char *Line, const char *Keyword);
+bool MeshLineContains(const char *Line, const char *SearchString);
+bool ReadMeshBytes(MeshFileBuffer *MFB, void *Dest, size_t N);
+bool ScanInt(const char **p, long *Value);
+bool ScanInt(const char **p, int *Value);
+bool ScanDouble(const char **p, double *Value);
+int ParseMeshLines(MeshFileBuffer *MFB, int NumLines,
+                   MeshLineParser Parser, void *UserData);
+
 } // namespace scuff
 
 #endif //LIBSCUFFINTERNALS_H
@@ -0,0 +1,165 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-CasimirTrace.cc -- SCUFF-EM unit test comparing the batched
+ *                           -- scuff-cas3D force/torque traces against
+ *                           -- one LU solve per quantity
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+#include "scuff-cas3D.h"
+
+using namespace scuff;
+
+#define NUMQUANTITIES 6
+#define NUMPROBES     4
+#define TOLERANCE     1.0e-10
+
+/***************************************************************/
+/* the pre-batching computation of \trace M^{-1} dM/dAlpha:    */
+/* stamp the adjoints of the derivative blocks into an N x N1  */
+/* matrix, back-substitute against the LU-factorized M, and    */
+/* sum the diagonal of the upper N1 x N1 block.                */
+/* if Z is nonzero, the same upper block is instead contracted */
+/* with the K probe vectors stored in Z.                       */
+/***************************************************************/
+double GetReferenceTrace(SC3Data *SC3D, int Mu, double *Z, int K)
+{
+  RWGGeometry *G = SC3D->G;
+  int N1         = SC3D->N1;
+
+  HMatrix *dM = new HMatrix(SC3D->N, N1, SC3D->M->RealComplex);
+  dM->Zero();
+  for(int ns=1; ns<G->NumSurfaces; ns++)
+   dM->InsertBlockAdjoint(SC3D->dUBlocks[ 6*(ns-1) + Mu ], G->BFIndexOffset[ns], 0);
+  SC3D->M->LUSolve(dM);
+
+  double Trace=0.0;
+  if (Z)
+   { for(int k=0; k<K; k++)
+      for(int nr=0; nr<N1; nr++)
+       for(int nc=0; nc<N1; nc++)
+        Trace += Z[nr + k*N1] * real(dM->GetEntry(nr,nc)) * Z[nc + k*N1];
+     Trace/=((double)K);
+   }
+  else
+   { for(int n=0; n<N1; n++)
+      Trace += real(dM->GetEntry(n,n));
+   };
+  Trace*=2.0;
+
+  delete dM;
+  return -Trace/(2.0*M_PI);
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM Casimir trace unit test running on %s",GetHostName());
+
+  RWGGeometry *G = new RWGGeometry("PECSpheres_255.scuffgeo");
+
+  /*--------------------------------------------------------------*/
+  /*- request all three force components and the torques about   -*/
+  /*- the three cartesian axes                                   -*/
+  /*--------------------------------------------------------------*/
+  int WhichQuantities = QUANTITY_XFORCE  | QUANTITY_YFORCE  | QUANTITY_ZFORCE
+                       |QUANTITY_TORQUE1 | QUANTITY_TORQUE2 | QUANTITY_TORQUE3;
+  double TorqueAxes[9]={ 1.0, 0.0, 0.0,
+                         0.0, 1.0, 0.0,
+                         0.0, 0.0, 1.0 };
+  SC3Data *SC3D=CreateSC3Data(G, 0, WhichQuantities, NUMQUANTITIES,
+                              3, TorqueAxes, false,
+                              const_cast<char *>("unit-test-CasimirTrace"));
+  SC3D->UseExistingData = false;
+  SC3D->WriteCache      = 0;
+  memset(SC3D->XiConverged, 0, SC3D->NTNQ*sizeof(bool));
+
+  const char *Names[NUMQUANTITIES]
+   = {"XForce", "YForce", "ZForce", "Torque1", "Torque2", "Torque3"};
+
+  double XiList[] = { 0.1, 1.0 };
+  int NumFailed=0;
+  for(int nXi=0; nXi<2; nXi++)
+   {
+     double Xi=XiList[nXi];
+
+     /*--------------------------------------------------------------*/
+     /*- exact block traces from the shared N x N1 solve ------------*/
+     /*--------------------------------------------------------------*/
+     double EFT[NUMQUANTITIES], Reference[NUMQUANTITIES];
+     SC3D->TraceProbes=0;
+     GetCasimirIntegrand(SC3D, Xi, 0, EFT);
+
+     double MaxRef=0.0, MaxDelta=0.0;
+     for(int Mu=0; Mu<NUMQUANTITIES; Mu++)
+      { Reference[Mu] = GetReferenceTrace(SC3D, Mu, 0, 0);
+        Log(" Xi=%g %s: batched=%+.12e reference=%+.12e",
+              Xi,Names[Mu],EFT[Mu],Reference[Mu]);
+        MaxRef   = fmax(MaxRef, fabs(Reference[Mu]));
+        MaxDelta = fmax(MaxDelta, fabs(EFT[Mu]-Reference[Mu]));
+      };
+     double RelError = MaxDelta / MaxRef;
+     printf("Xi=%g: batched vs. per-quantity traces: %.2e: %s\n",
+             Xi, RelError, RelError<TOLERANCE ? "PASSED" : "FAILED");
+     if (RelError>=TOLERANCE)
+      NumFailed++;
+
+     /*--------------------------------------------------------------*/
+     /*- probe-vector estimates must agree with the same probes     -*/
+     /*- applied to the per-quantity solution                       -*/
+     /*--------------------------------------------------------------*/
+     SC3D->TraceProbes=NUMPROBES;
+     GetCasimirIntegrand(SC3D, Xi, 0, EFT);
+
+     MaxRef=MaxDelta=0.0;
+     for(int Mu=0; Mu<NUMQUANTITIES; Mu++)
+      { Reference[Mu] = GetReferenceTrace(SC3D, Mu, SC3D->ProbeSigns, NUMPROBES);
+        Log(" Xi=%g %s (%i probes): batched=%+.12e reference=%+.12e",
+              Xi,Names[Mu],NUMPROBES,EFT[Mu],Reference[Mu]);
+        MaxRef   = fmax(MaxRef, fabs(Reference[Mu]));
+        MaxDelta = fmax(MaxDelta, fabs(EFT[Mu]-Reference[Mu]));
+      };
+     RelError = MaxDelta / MaxRef;
+     printf("Xi=%g: %i-probe traces vs. per-quantity solve: %.2e: %s\n",
+             Xi, NUMPROBES, RelError, RelError<TOLERANCE ? "PASSED" : "FAILED");
+     if (RelError>=TOLERANCE)
+      NumFailed++;
+   };
+
+  delete G;
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
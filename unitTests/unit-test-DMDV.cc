@@ -0,0 +1,157 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-DMDV.cc -- SCUFF-EM unit test comparing vertex derivatives
+ *                   -- of the BEM matrix against finite differences
+ *                   -- of the full BEM matrix
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+
+using namespace scuff;
+
+#define NUMVERTICES 3
+#define FDSTEP      1.0e-4
+#define TOLERANCE   1.0e-3
+
+/***************************************************************/
+/* Lambda^T * M * KN                                           */
+/***************************************************************/
+cdouble Contract(HVector *Lambda, HMatrix *M, HVector *KN)
+{
+  cdouble Sum=0.0;
+  for(int nr=0; nr<M->NR; nr++)
+   { cdouble MKN=0.0;
+     for(int nc=0; nc<M->NC; nc++)
+      MKN += M->GetEntry(nr,nc)*KN->GetEntry(nc);
+     Sum += Lambda->GetEntry(nr)*MKN;
+   };
+  return Sum;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM dM/dV unit test running on %s",GetHostName());
+
+  RWGGeometry *G = new RWGGeometry("SiSpheres_255.scuffgeo");
+  RWGSurface *S  = G->Surfaces[0];
+  int N          = G->TotalBFs;
+
+  HMatrix *MPlus  = G->AllocateBEMMatrix();
+  HMatrix *MMinus = G->AllocateBEMMatrix();
+  HVector *KN     = G->AllocateRHSVector();
+  HVector *Lambda = G->AllocateRHSVector();
+
+  srand48(271828);
+  for(int n=0; n<N; n++)
+   { KN->SetEntry(n,     cdouble(drand48()-0.5, drand48()-0.5));
+     Lambda->SetEntry(n, cdouble(drand48()-0.5, drand48()-0.5));
+   };
+
+  int VertexList[NUMVERTICES];
+  VertexList[0] = 0;
+  VertexList[1] = S->NumVertices/3;
+  VertexList[2] = (2*S->NumVertices)/3;
+
+  // long and short wavelengths, so that both the desingularized
+  // and the taylor-duffy panel-pair integrals are differentiated
+  double OmegaList[] = { 0.5, 6.0 };
+  int NumFailed=0;
+  for(int nOmega=0; nOmega<2; nOmega++)
+   {
+     cdouble Omega=OmegaList[nOmega];
+
+     HMatrix *LDMDVKN=G->GetDMDVContractions(0, Omega, Lambda, KN);
+
+     double MaxFD=0.0, MaxDelta=0.0;
+     for(int n=0; n<NUMVERTICES; n++)
+      for(int Mu=0; Mu<3; Mu++)
+       {
+         int nv=VertexList[n];
+         double V0[3], V[3];
+         memcpy(V0, S->Vertices + 3*nv, 3*sizeof(double));
+
+         memcpy(V, V0, 3*sizeof(double));
+         V[Mu] += FDSTEP;
+         G->UpdateVertices(0, 1, &nv, V);
+         G->AssembleBEMMatrix(Omega, MPlus);
+
+         V[Mu] = V0[Mu] - FDSTEP;
+         G->UpdateVertices(0, 1, &nv, V);
+         G->AssembleBEMMatrix(Omega, MMinus);
+
+         G->UpdateVertices(0, 1, &nv, V0);
+
+         cdouble FD = (Contract(Lambda, MPlus, KN) - Contract(Lambda, MMinus, KN))
+                      / (2.0*FDSTEP);
+         cdouble Analytic = LDMDVKN->GetEntry(nv, Mu);
+         Log(" Omega=%g vertex %i Mu=%i: FD=(%+.6e,%+.6e) DMDV=(%+.6e,%+.6e)",
+               real(Omega),nv,Mu,real(FD),imag(FD),real(Analytic),imag(Analytic));
+
+         MaxFD    = fmax(MaxFD, abs(FD));
+         MaxDelta = fmax(MaxDelta, abs(FD-Analytic));
+       };
+
+     double RelError = MaxDelta / MaxFD;
+     printf("Omega=%g: dM/dV contractions vs. finite differences: %.2e: %s\n",
+             real(Omega), RelError, RelError<TOLERANCE ? "PASSED" : "FAILED");
+     if (RelError>=TOLERANCE)
+      NumFailed++;
+
+     // the single-coordinate derivative matrix must agree with
+     // the contractions
+     int nv=VertexList[1];
+     HMatrix *DMDV=G->AssembleDMDVMatrix(0, nv, 2, Omega);
+     cdouble Direct=Contract(Lambda, DMDV, KN);
+     cdouble Contracted=LDMDVKN->GetEntry(nv, 2);
+     double Mismatch=abs(Direct-Contracted)/abs(Direct);
+     printf("Omega=%g: AssembleDMDVMatrix vs. GetDMDVContractions: %.2e: %s\n",
+             real(Omega), Mismatch, Mismatch<1.0e-8 ? "PASSED" : "FAILED");
+     if (Mismatch>=1.0e-8)
+      NumFailed++;
+
+     delete DMDV;
+     delete LDMDVKN;
+   };
+
+  delete MPlus;
+  delete MMinus;
+  delete KN;
+  delete Lambda;
+  delete G;
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
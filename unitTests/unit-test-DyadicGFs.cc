@@ -0,0 +1,145 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-DyadicGFs.cc -- SCUFF-EM unit test comparing the batched
+ *                        -- (reciprocity-based) dyadic GFs against the
+ *                        -- single-point GetDyadicGFs routine
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+
+using namespace scuff;
+
+#define NUMPOINTS 4
+
+// the single-point routine evaluates the scattered fields with the
+// field cubature of GetFields(), while the batched routine uses the
+// RHS-assembly cubature, so the two agree only to cubature accuracy;
+// the electric-only and small-block batched results differ from the
+// full default-block results only by roundoff
+#define TOLERANCE    1.0e-3
+#define EOTOLERANCE  1.0e-10
+
+// points per block for the small-block run; NUMPOINTS is not a
+// multiple of this, so the last block is partially filled
+#define SMALLBLOCK   3
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM dyadic GF unit test running on %s",GetHostName());
+
+  RWGGeometry *G = new RWGGeometry("SiSpheres_255.scuffgeo");
+
+  // exterior points near, between, and away from the two spheres
+  double XPoints[NUMPOINTS][3]={ {  0.0,  0.0,  1.5 },
+                                 {  0.3, -0.2,  1.4 },
+                                 {  2.0,  0.5, -0.5 },
+                                 {  0.0,  0.0, -2.0 } };
+  HMatrix *XMatrix = new HMatrix(NUMPOINTS, 3);
+  for(int nx=0; nx<NUMPOINTS; nx++)
+   for(int i=0; i<3; i++)
+    XMatrix->SetEntry(nx, i, XPoints[nx][i]);
+
+  // a real frequency (complex BEM matrix) and an imaginary
+  // frequency (real BEM matrix, as used by scuff-caspol)
+  cdouble OmegaList[2] = { cdouble(1.0,0.0), cdouble(0.0,1.0) };
+  int NumFailed=0;
+  for(int nOmega=0; nOmega<2; nOmega++)
+   {
+     cdouble Omega = OmegaList[nOmega];
+     bool PureImag = (nOmega==1);
+
+     HMatrix *M  = G->AllocateBEMMatrix(PureImag);
+     HVector *KN = G->AllocateRHSVector(PureImag);
+     G->AssembleBEMMatrix(Omega, M);
+     M->LUFactorize();
+
+     HMatrix *GMatrix  = G->GetDyadicGFs(XMatrix, Omega, M);
+     HMatrix *GEMatrix = G->GetDyadicGFs(XMatrix, Omega, M, 0, true);
+     HMatrix *GBMatrix = G->GetDyadicGFs(XMatrix, Omega, M, 0, false, SMALLBLOCK);
+
+     double MaxRef=0.0, MaxDelta=0.0, MaxEODelta=0.0, MaxBlockDelta=0.0;
+     for(int nx=0; nx<NUMPOINTS; nx++)
+      {
+        cdouble GE[3][3], GM[3][3];
+        G->GetDyadicGFs(XPoints[nx], Omega, M, KN, GE, GM);
+        for(int i=0; i<3; i++)
+         for(int j=0; j<3; j++)
+          { cdouble GEBatch = GMatrix->GetEntry(nx, 3*i+j);
+            cdouble GMBatch = GMatrix->GetEntry(nx, 9+3*i+j);
+            Log(" Omega=%s X=%i (%i,%i): GE=%s/%s GM=%s/%s",z2s(Omega),nx,i,j,
+                  z2s(GE[i][j]),z2s(GEBatch),z2s(GM[i][j]),z2s(GMBatch));
+            MaxRef   = fmax(MaxRef, fmax(abs(GE[i][j]), abs(GM[i][j])));
+            MaxDelta = fmax(MaxDelta, fmax(abs(GE[i][j]-GEBatch),
+                                           abs(GM[i][j]-GMBatch)));
+            MaxEODelta = fmax(MaxEODelta,
+                              abs(GEMatrix->GetEntry(nx,3*i+j)-GEBatch));
+            MaxBlockDelta = fmax(MaxBlockDelta,
+                                 fmax(abs(GBMatrix->GetEntry(nx,3*i+j)-GEBatch),
+                                      abs(GBMatrix->GetEntry(nx,9+3*i+j)-GMBatch)));
+          };
+      };
+
+     double RelError = MaxDelta / MaxRef;
+     printf("Omega=%s: batched vs. single-point DGFs: %.2e: %s\n",
+             z2s(Omega), RelError, RelError<TOLERANCE ? "PASSED" : "FAILED");
+     if (RelError>=TOLERANCE)
+      NumFailed++;
+
+     RelError = MaxEODelta / MaxRef;
+     printf("Omega=%s: electric-only vs. full batched DGFs: %.2e: %s\n",
+             z2s(Omega), RelError, RelError<EOTOLERANCE ? "PASSED" : "FAILED");
+     if (GEMatrix->NC!=9 || RelError>=EOTOLERANCE)
+      NumFailed++;
+
+     RelError = MaxBlockDelta / MaxRef;
+     printf("Omega=%s: %i-point vs. default blocks: %.2e: %s\n",
+             z2s(Omega), SMALLBLOCK, RelError, RelError<EOTOLERANCE ? "PASSED" : "FAILED");
+     if (RelError>=EOTOLERANCE)
+      NumFailed++;
+
+     delete GMatrix;
+     delete GEMatrix;
+     delete GBMatrix;
+     delete KN;
+     delete M;
+   };
+
+  delete XMatrix;
+  delete G;
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
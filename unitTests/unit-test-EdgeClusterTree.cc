@@ -0,0 +1,121 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-EdgeClusterTree.cc -- SCUFF-EM unit test checking that the
+ *                              -- cached edge cluster trees are rebuilt
+ *                              -- when surfaces move
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+
+using namespace scuff;
+
+#define TOLERANCE 1.0e-12
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+double MaxRelDiff(HMatrix *A, HMatrix *B)
+{
+  double MaxA=0.0, MaxDelta=0.0;
+  for(int nr=0; nr<A->NR; nr++)
+   for(int nc=0; nc<A->NC; nc++)
+    { MaxA     = fmax(MaxA, abs(A->GetEntry(nr,nc)));
+      MaxDelta = fmax(MaxDelta, abs(A->GetEntry(nr,nc)-B->GetEntry(nr,nc)));
+    };
+  return MaxDelta / MaxA;
+}
+
+/***************************************************************/
+/* move the spheres of SiSpheres_255 to within a fraction of a */
+/* panel of each other (so that pairs that were far before the */
+/* motion become near) and stretch one vertex of the first     */
+/* sphere toward the second                                    */
+/***************************************************************/
+void MoveSpheres(RWGGeometry *G, bool MoveVertex)
+{
+  G->Surfaces[1]->Transform("DISP 0 0 -0.95");
+  if (MoveVertex)
+   { RWGSurface *S=G->Surfaces[0];
+     int nvTop=0;
+     for(int nv=1; nv<S->NumVertices; nv++)
+      if ( S->Vertices[3*nv+2] > S->Vertices[3*nvTop+2] )
+       nvTop=nv;
+     double V[3];
+     memcpy(V, S->Vertices + 3*nvTop, 3*sizeof(double));
+     V[2]+=0.02;
+     G->UpdateVertices(0, 1, &nvTop, V);
+   };
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM edge cluster tree unit test running on %s",GetHostName());
+
+  cdouble Omega=1.0;
+  int NumFailed=0;
+  for(int MoveVertex=0; MoveVertex<2; MoveVertex++)
+   {
+     // G1 assembles once before the motion, so its cluster trees
+     // are cached at the old positions; G2 is moved before any
+     // cluster tree exists
+     RWGGeometry *G1 = new RWGGeometry("SiSpheres_255.scuffgeo");
+     RWGGeometry *G2 = new RWGGeometry("SiSpheres_255.scuffgeo");
+     HMatrix *M1 = G1->AllocateBEMMatrix();
+     HMatrix *M2 = G2->AllocateBEMMatrix();
+
+     G1->AssembleBEMMatrix(Omega, M1);
+     MoveSpheres(G1, MoveVertex);
+     G1->AssembleBEMMatrix(Omega, M1);
+
+     MoveSpheres(G2, MoveVertex);
+     G2->AssembleBEMMatrix(Omega, M2);
+
+     double RelError=MaxRelDiff(M2, M1);
+     printf("%s: cached vs. fresh cluster trees: %.2e: %s\n",
+             MoveVertex ? "transform + vertex update" : "transform",
+             RelError, RelError<TOLERANCE ? "PASSED" : "FAILED");
+     if (RelError>=TOLERANCE)
+      NumFailed++;
+
+     delete M1;
+     delete M2;
+     delete G1;
+     delete G2;
+   };
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
@@ -0,0 +1,564 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-EdgeList.cc -- SCUFF-EM unit test checking the edge
+ *                       -- topology computed by InitEdgeList and the
+ *                       -- straddler partners found by AddStraddlers
+ *                       -- against the original linked-list and
+ *                       -- linear-search implementations
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+
+using namespace scuff;
+
+/***************************************************************/
+/* edge lists are pure topology plus a few values computed by  */
+/* identical formulas, so everything must agree exactly        */
+/***************************************************************/
+#define SAME(a,b) ( memcmp(&(a), &(b), sizeof(a))==0 )
+
+/***************************************************************/
+/* output of the reference edge-list computation               */
+/***************************************************************/
+typedef struct RefEdgeList
+ { int NumEdges, NumExteriorEdges, NumTotalEdges;
+   RWGEdge **Edges, **ExteriorEdges, *AllEdges;
+   int NumBCs, *NumBCEdges, *WhichBC;
+   RWGEdge ***BCEdges;
+   int NumInteriorVertices;
+ } RefEdgeList;
+
+/***************************************************************/
+/* reference implementation: the original linked-list version  */
+/* of RWGSurface::InitEdgeList, applied to the vertices and    */
+/* panels of S                                                 */
+/***************************************************************/
+void RefInitEdgeList(RWGSurface *S, RefEdgeList *R)
+{
+  int NumVertices=S->NumVertices, NumPanels=S->NumPanels;
+  double *Vertices=S->Vertices;
+  RWGEdge *E, ***EVEdges, *BCEdgeList;
+  int np, ne, nv, nvp;
+
+  RWGEdge **EdgeLists=(RWGEdge **)mallocEC(NumVertices*sizeof(RWGEdge *));
+  int *VertexUsed=(int *)mallocEC(NumVertices*sizeof(int));
+  int *EVNumEdges=(int *)mallocEC(NumVertices*sizeof(int));
+  EVEdges=(RWGEdge ***)mallocEC(NumVertices*sizeof(RWGEdge **));
+  EVEdges[0]=(RWGEdge **)mallocEC(2*NumVertices*sizeof(RWGEdge *));
+  for(nv=1; nv<NumVertices; nv++)
+   EVEdges[nv]=EVEdges[nv-1]+2;
+  memset(EdgeLists,0,NumVertices*sizeof(RWGEdge *));
+  memset(VertexUsed,0,NumVertices*sizeof(int));
+  memset(EVNumEdges,0,NumVertices*sizeof(int));
+
+  // all edge structures come from one block so they are easy to free
+  R->AllEdges=(RWGEdge *)mallocEC(3*NumPanels*sizeof(RWGEdge));
+  int NumAllocated=0;
+
+  R->NumEdges=R->NumTotalEdges=0;
+  for(np=0; np<NumPanels; np++)
+   for(ne=0; ne<3; ne++)
+    {
+      RWGPanel *P=S->Panels[np];
+      int iVLesser=P->VI[ne];
+      int iVGreater=P->VI[(ne+1)%3];
+      if ( iVLesser > iVGreater )
+       { iVLesser=P->VI[(ne+1)%3];
+         iVGreater=P->VI[ne];
+       };
+      VertexUsed[iVLesser]=VertexUsed[iVGreater]=1;
+
+      for(E=EdgeLists[iVLesser]; E; E=E->Next)
+       if (E->iV2==iVGreater)
+        break;
+
+      if ( E )
+       { if ( E->iMPanel != -1 )
+          ErrExit("%s: invalid mesh topology",S->MeshFileName);
+         E->iQM=P->VI[(ne+2)%3];
+         E->iMPanel=P->Index;
+         E->MIndex=(ne+2)%3;
+         E->Index=R->NumEdges++;
+         E->Radius=VecDistance(E->Centroid, Vertices+3*E->iQP);
+         E->Radius=fmax(E->Radius, VecDistance(E->Centroid,Vertices+3*E->iQM));
+         E->Radius=fmax(E->Radius, VecDistance(E->Centroid,Vertices+3*E->iV1));
+         E->Radius=fmax(E->Radius, VecDistance(E->Centroid,Vertices+3*E->iV2));
+       }
+      else
+       { R->NumTotalEdges++;
+         E=R->AllEdges + (NumAllocated++);
+         E->Next=EdgeLists[iVLesser];
+         EdgeLists[iVLesser]=E;
+         E->iV1=iVLesser;
+         E->iV2=iVGreater;
+         E->iQP=P->VI[ (ne+2)%3 ];
+         E->iQM=-1;
+         double *VLesser=Vertices + 3*iVLesser;
+         double *VGreater=Vertices + 3*iVGreater;
+         for(int i=0; i<3; i++)
+          E->Centroid[i]=(VLesser[i] + VGreater[i]) / 2.0;
+         E->Length=VecDistance(VLesser, VGreater);
+         E->Radius=0.0;
+         E->iPPanel=P->Index;
+         E->PIndex=(ne+2)%3;
+         E->iMPanel=-1;
+         E->Index=-1;
+         E->MIndex=(ne+2)%3;
+       };
+    };
+
+  R->Edges=(RWGEdge **)mallocEC((R->NumEdges+1)*sizeof(RWGEdge *));
+  R->ExteriorEdges=(RWGEdge **)mallocEC((R->NumTotalEdges-R->NumEdges+1)*sizeof(RWGEdge *));
+  R->NumExteriorEdges=0;
+  for(nv=0; nv<NumVertices; nv++)
+   for(E=EdgeLists[nv]; E; E=E->Next)
+    { if (E->Index==-1)
+       { R->ExteriorEdges[R->NumExteriorEdges]=E;
+         E->Index=-(R->NumExteriorEdges+1);
+         R->NumExteriorEdges++;
+         EVEdges[E->iV1][ EVNumEdges[E->iV1]++ ] = E;
+         EVEdges[E->iV2][ EVNumEdges[E->iV2]++ ] = E;
+       }
+      else
+       R->Edges[E->Index]=E;
+    };
+
+  R->WhichBC=(int *)mallocEC(NumVertices*sizeof(int));
+  memset(R->WhichBC,0,NumVertices*sizeof(int));
+  R->NumBCs=0;
+  R->NumBCEdges=0;
+  R->BCEdges=0;
+  int NumExteriorVertices=0;
+  for(;;)
+   {
+     for(nv=0; nv<NumVertices; nv++)
+      if (EVNumEdges[nv]>0)
+       break;
+     if (nv==NumVertices) break;
+
+     R->NumBCEdges=(int *)realloc(R->NumBCEdges, (R->NumBCs+1)*sizeof(int));
+     R->BCEdges=(RWGEdge ***)realloc(R->BCEdges, (R->NumBCs+1)*sizeof(RWGEdge **));
+
+     BCEdgeList=0;
+     E=EVEdges[nv][0];
+     nvp=nv;
+     R->NumBCEdges[R->NumBCs]=0;
+     do
+      { EVNumEdges[nvp]=0;
+        R->WhichBC[nvp]=R->NumBCs;
+        NumExteriorVertices++;
+        E->Next=BCEdgeList;
+        BCEdgeList=E;
+        R->NumBCEdges[R->NumBCs]++;
+        nvp = (nvp==E->iV1) ? E->iV2 : E->iV1;
+        E = (E==EVEdges[nvp][0]) ? EVEdges[nvp][1] : EVEdges[nvp][0];
+      } while (nvp!=nv);
+
+     R->BCEdges[R->NumBCs]=(RWGEdge **)mallocEC(R->NumBCEdges[R->NumBCs]*sizeof(RWGEdge *));
+     for(ne=0, E=BCEdgeList; E; E=E->Next)
+      R->BCEdges[R->NumBCs][ne++]=E;
+     R->NumBCs++;
+   };
+
+  int NumUnusedVertices=0;
+  for(nv=0; nv<NumVertices; nv++)
+   if (VertexUsed[nv]==0)
+    NumUnusedVertices++;
+  R->NumInteriorVertices=NumVertices-NumExteriorVertices-NumUnusedVertices;
+
+  free(EdgeLists);
+  free(VertexUsed);
+  free(EVNumEdges);
+  free(EVEdges[0]);
+  free(EVEdges);
+}
+
+void FreeRefEdgeList(RefEdgeList *R)
+{
+  for(int nbc=0; nbc<R->NumBCs; nbc++)
+   free(R->BCEdges[nbc]);
+  free(R->BCEdges);
+  free(R->NumBCEdges);
+  free(R->WhichBC);
+  free(R->Edges);
+  free(R->ExteriorEdges);
+  free(R->AllEdges);
+}
+
+/***************************************************************/
+/* the original code left Radius unset for exterior edges, so  */
+/* it is only compared for interior edges                      */
+/***************************************************************/
+int CompareEdges(RWGEdge *E, RWGEdge *ER, bool Interior)
+{
+  return !(    E->iV1==ER->iV1 && E->iV2==ER->iV2
+            && E->iQP==ER->iQP && E->iQM==ER->iQM
+            && SAME(E->Centroid, ER->Centroid)
+            && SAME(E->Length, ER->Length)
+            && (!Interior || SAME(E->Radius, ER->Radius))
+            && E->iPPanel==ER->iPPanel && E->iMPanel==ER->iMPanel
+            && E->PIndex==ER->PIndex && E->MIndex==ER->MIndex
+            && E->Index==ER->Index
+          );
+}
+
+/***************************************************************/
+/* return the number of mismatches between the edge list of S  */
+/* and the reference edge list                                 */
+/***************************************************************/
+int CompareEdgeList(RWGSurface *S, RefEdgeList *R)
+{
+  if (    S->NumEdges!=R->NumEdges
+       || S->NumExteriorEdges!=R->NumExteriorEdges
+       || S->NumTotalEdges!=R->NumTotalEdges
+       || S->NumBCs!=R->NumBCs
+       || S->NumInteriorVertices!=R->NumInteriorVertices
+     ) return 1;
+
+  int NumBad=0;
+  for(int ne=0; ne<R->NumEdges; ne++)
+   NumBad+=CompareEdges(S->Edges[ne], R->Edges[ne], true);
+  for(int ne=0; ne<R->NumExteriorEdges; ne++)
+   NumBad+=CompareEdges(S->ExteriorEdges[ne], R->ExteriorEdges[ne], false);
+
+  // panel edge indices as assigned by the RWGSurface constructor
+  for(int np=0; np<S->NumPanels; np++)
+   { int EI[3]={-1,-1,-1};
+     for(int ne=0; ne<R->NumEdges; ne++)
+      { RWGEdge *E=R->Edges[ne];
+        if (E->iPPanel==np) EI[E->PIndex]=ne;
+        if (E->iMPanel==np) EI[E->MIndex]=ne;
+      };
+     for(int ne=0; ne<R->NumExteriorEdges; ne++)
+      if (R->ExteriorEdges[ne]->iPPanel==np)
+       EI[R->ExteriorEdges[ne]->PIndex]=-(ne+1);
+     if (!SAME(EI, S->Panels[np]->EI)) NumBad++;
+   };
+
+  for(int nbc=0; nbc<R->NumBCs; nbc++)
+   { if (S->NumBCEdges[nbc]!=R->NumBCEdges[nbc])
+      { NumBad++;
+        continue;
+      };
+     for(int n=0; n<R->NumBCEdges[nbc]; n++)
+      if (S->BCEdges[nbc][n]->Index!=R->BCEdges[nbc][n]->Index)
+       NumBad++;
+     for(int nv=0; nv<S->NumVertices; nv++)
+      if ( (S->WhichBC[nv]==nbc) != (R->WhichBC[nv]==nbc) )
+       NumBad++;
+   };
+
+  return NumBad;
+}
+
+/***************************************************************/
+/* reference implementation: the original linear-search        */
+/* version of the partner-edge search in PBCSetup.cc, applied  */
+/* to a copy of the exterior edges taken before AddStraddlers. */
+/* Removed[nei] mirrors the zeroing of ExteriorEdges[nei].     */
+/***************************************************************/
+typedef struct ExtEdge
+ { int iV1, iV2, iQP, iPPanel;
+ } ExtEdge;
+
+int RefFindPartnerEdge(RWGSurface *S, ExtEdge *XE, bool *Removed,
+                       int NumExteriorEdges, int nei,
+                       double LBV[MAXLDIM][2], double LBVi[MAXLDIM][2],
+                       int LDim, int *pWhichBV, double *V)
+{
+  double *V1 = S->Vertices + 3*(XE[nei].iV1);
+  double *V2 = S->Vertices + 3*(XE[nei].iV2);
+  const double tolvc = S->tolVecClose;
+
+  double *LTranslate;
+  int WhichBV;
+  if (LDim==1)
+   { WhichBV=*pWhichBV=0;
+     LTranslate = LBV[0];
+   }
+  else
+   { double V1L[2], V2L[2];
+     V1L[0] = LBVi[0][0]*V1[0] + LBVi[0][1]*V1[1];
+     V1L[1] = LBVi[1][0]*V1[0] + LBVi[1][1]*V1[1];
+     V2L[0] = LBVi[0][0]*V2[0] + LBVi[0][1]*V2[1];
+     V2L[1] = LBVi[1][0]*V2[0] + LBVi[1][1]*V2[1];
+     if ( fabs(V1L[0]) < tolvc && fabs(V2L[0]) < tolvc )
+      { WhichBV=*pWhichBV = 0;
+        LTranslate=LBV[0];
+      }
+     else if ( fabs(V1L[1]) < tolvc && fabs(V2L[1]) < tolvc )
+      { WhichBV=*pWhichBV = 1;
+        LTranslate=LBV[1];
+      }
+     else
+      return -1;
+   };
+
+  double V1T[3], V2T[3];
+  V1T[0] = V1[0] + LTranslate[0]; V1T[1] = V1[1] + LTranslate[1]; V1T[2] = V1[2];
+  V2T[0] = V2[0] + LTranslate[0]; V2T[1] = V2[1] + LTranslate[1]; V2T[2] = V2[2];
+  for(int neip=0; neip<NumExteriorEdges; neip++)
+   {
+     if (Removed[neip])
+      continue;
+     double *V1P = S->Vertices + 3*(XE[neip].iV1);
+     double *V2P = S->Vertices + 3*(XE[neip].iV2);
+     if (   (VecClose(V1T, V1P, tolvc) && VecClose(V2T, V2P, tolvc))
+         || (VecClose(V1T, V2P, tolvc) && VecClose(V2T, V1P, tolvc))
+        )
+      { memcpy(V, S->Vertices + 3*(XE[neip].iQP), 3*sizeof(double));
+        V[0] -= LTranslate[0];
+        V[1] -= LTranslate[1];
+        return neip;
+      };
+   };
+
+  return -1;
+}
+
+/***************************************************************/
+/* run AddStraddlers on S and compare the straddlers it adds   */
+/* (which edge, which partner panel, which lattice vector, and */
+/* the new vertex) with those found by the reference search.   */
+/* returns the number of mismatches.                           */
+/***************************************************************/
+int TestStraddlers(RWGSurface *S, double LBV[MAXLDIM][2], int LDim, int *pTotal)
+{
+  int NumVertices0=S->NumVertices, NumEdges0=S->NumEdges;
+  int NumExteriorEdges0=S->NumExteriorEdges;
+
+  ExtEdge *XE=(ExtEdge *)mallocEC((NumExteriorEdges0+1)*sizeof(ExtEdge));
+  for(int nei=0; nei<NumExteriorEdges0; nei++)
+   { RWGEdge *E=S->ExteriorEdges[nei];
+     XE[nei].iV1=E->iV1;
+     XE[nei].iV2=E->iV2;
+     XE[nei].iQP=E->iQP;
+     XE[nei].iPPanel=E->iPPanel;
+   };
+
+  double LBVi[MAXLDIM][2] = {{0.0,0.0}, {0.0,0.0}};
+  if (LDim==1)
+   { double L1Norm2 = LBV[0][0]*LBV[0][0] + LBV[0][1]*LBV[0][1];
+     LBVi[0][0] = LBV[0][0] / L1Norm2;
+     LBVi[0][1] = LBV[0][1] / L1Norm2;
+   }
+  else
+   { double zPerp = LBV[0][0]*LBV[1][1] - LBV[0][1]*LBV[1][0];
+     for (int i=0; i<2; ++i)
+      { LBVi[i][0] = -zPerp * LBV[1-i][1];
+        LBVi[i][1] = +zPerp * LBV[1-i][0];
+        double DotProd = LBV[i][0]*LBVi[i][0] + LBV[i][1]*LBVi[i][1];
+        LBVi[i][0] /= DotProd;
+        LBVi[i][1] /= DotProd;
+      };
+   };
+
+  // expected straddlers, in the order AddStraddlers creates them
+  bool *Removed=(bool *)mallocEC((NumExteriorEdges0+1)*sizeof(bool));
+  memset(Removed,0,(NumExteriorEdges0+1)*sizeof(bool));
+  int *RefEdge=(int *)mallocEC((NumExteriorEdges0+1)*sizeof(int));
+  int *RefPanel=(int *)mallocEC((NumExteriorEdges0+1)*sizeof(int));
+  int *RefBV=(int *)mallocEC((NumExteriorEdges0+1)*sizeof(int));
+  double *RefV=(double *)mallocEC(3*(NumExteriorEdges0+1)*sizeof(double));
+  int RefNumStraddlers[MAXLDIM]={0,0}, NumRef=0;
+  for(int nei=0; nei<NumExteriorEdges0; nei++)
+   { int WhichBV;
+     int neip=RefFindPartnerEdge(S, XE, Removed, NumExteriorEdges0, nei,
+                                 LBV, LBVi, LDim, &WhichBV, RefV + 3*NumRef);
+     if (neip==-1) continue;
+     RefEdge[NumRef]=nei;
+     RefPanel[NumRef]=XE[neip].iPPanel;
+     RefBV[NumRef]=WhichBV;
+     RefNumStraddlers[WhichBV]++;
+     Removed[nei]=true;
+     NumRef++;
+   };
+
+  int NumStraddlers[MAXLDIM];
+  S->AddStraddlers(LBV, LDim, NumStraddlers);
+
+  int NumBad=0;
+  if (    S->TotalStraddlers!=NumRef
+       || S->NumEdges!=NumEdges0+NumRef
+       || S->NumVertices!=NumVertices0+NumRef
+       || S->NumExteriorEdges!=NumExteriorEdges0-NumRef
+     ) NumBad++;
+  for(int nd=0; nd<LDim; nd++)
+   if (NumStraddlers[nd]!=RefNumStraddlers[nd])
+    NumBad++;
+
+  for(int n=0; NumBad==0 && n<NumRef; n++)
+   { RWGEdge *E=S->Edges[NumEdges0+n];
+     ExtEdge *X=XE + RefEdge[n];
+     if (    E->iV1!=X->iV1 || E->iV2!=X->iV2 || E->iQP!=X->iQP
+          || E->iPPanel!=X->iPPanel || E->iQM!=NumVertices0+n
+          || E->Index!=NumEdges0+n
+        ) NumBad++;
+     if (    S->PhasedBFCs[3*n+0]!=RefPanel[n]
+          || S->PhasedBFCs[3*n+1]!=NumEdges0+n
+          || S->PhasedBFCs[3*n+2]!=RefBV[n]
+        ) NumBad++;
+     if ( memcmp(S->Vertices + 3*(NumVertices0+n), RefV + 3*n, 3*sizeof(double)) )
+      NumBad++;
+   };
+
+  free(XE);
+  free(Removed);
+  free(RefEdge);
+  free(RefPanel);
+  free(RefBV);
+  free(RefV);
+
+  *pTotal=NumRef;
+  return NumBad;
+}
+
+/***************************************************************/
+/* write a GMSH mesh of the parallelogram spanned by L1, L2,   */
+/* subdivided into 2*N*N triangles, with randomly jittered     */
+/* interior vertices, random cell diagonals, and randomly      */
+/* permuted vertex numbering.                                  */
+/***************************************************************/
+void WriteParallelogramMesh(const char *FileName, int N, double L1[2], double L2[2])
+{
+  int NN=(N+1)*(N+1);
+  int *Perm=(int *)mallocEC(NN*sizeof(int));
+  for(int n=0; n<NN; n++)
+   Perm[n]=n;
+  for(int n=NN-1; n>0; n--)
+   { int m=lrand48()%(n+1), t=Perm[n]; Perm[n]=Perm[m]; Perm[m]=t; };
+
+  double *X=(double *)mallocEC(3*NN*sizeof(double));
+  for(int i=0; i<=N; i++)
+   for(int j=0; j<=N; j++)
+    { double u=((double)i)/N, v=((double)j)/N;
+      if (0<i && i<N && 0<j && j<N)
+       { u+=0.2*(drand48()-0.5)/N;
+         v+=0.2*(drand48()-0.5)/N;
+       };
+      double *XX=X + 3*Perm[i*(N+1)+j];
+      XX[0]=u*L1[0] + v*L2[0];
+      XX[1]=u*L1[1] + v*L2[1];
+      XX[2]=0.0;
+    };
+
+  FILE *f=fopen(FileName,"w");
+  if (!f) ErrExit("could not open %s",FileName);
+  fprintf(f,"$MeshFormat\n2.2 0 8\n$EndMeshFormat\n");
+  fprintf(f,"$Nodes\n%i\n",NN);
+  for(int n=0; n<NN; n++)
+   fprintf(f,"%i %.17g %.17g %.17g\n",n+1,X[3*n+0],X[3*n+1],X[3*n+2]);
+  fprintf(f,"$EndNodes\n$Elements\n%i\n",2*N*N);
+  int ne=1;
+  for(int i=0; i<N; i++)
+   for(int j=0; j<N; j++)
+    { int A=1+Perm[i*(N+1)+j],     B=1+Perm[(i+1)*(N+1)+j];
+      int C=1+Perm[(i+1)*(N+1)+j+1], D=1+Perm[i*(N+1)+j+1];
+      if (lrand48()%2)
+       { fprintf(f,"%i 2 2 0 1 %i %i %i\n",ne++,A,B,C);
+         fprintf(f,"%i 2 2 0 1 %i %i %i\n",ne++,A,C,D);
+       }
+      else
+       { fprintf(f,"%i 2 2 0 1 %i %i %i\n",ne++,A,B,D);
+         fprintf(f,"%i 2 2 0 1 %i %i %i\n",ne++,B,C,D);
+       };
+    };
+  fprintf(f,"$EndElements\n");
+  fclose(f);
+
+  free(Perm);
+  free(X);
+}
+
+/***************************************************************/
+/* build a surface from MeshFile, compare its edge list with   */
+/* the reference, and (if LDim>0) its straddlers too           */
+/***************************************************************/
+int TestSurface(const char *MeshFile, const char *Description,
+                double LBV[MAXLDIM][2]=0, int LDim=0)
+{
+  RWGSurface *S=new RWGSurface(MeshFile);
+
+  RefEdgeList R;
+  RefInitEdgeList(S, &R);
+  int NumBad=CompareEdgeList(S, &R);
+  FreeRefEdgeList(&R);
+
+  int NumStraddlers=0;
+  if (LDim>0)
+   { // tolerance for vector comparisons as set by RWGGeometry
+     S->tolVecClose = 1./0.;
+     for(int ne=0; ne<S->NumEdges; ne++)
+      S->tolVecClose = fmin(S->tolVecClose, S->Edges[ne]->Length);
+     S->tolVecClose *= 1e-3;
+     NumBad+=TestStraddlers(S, LBV, LDim, &NumStraddlers);
+   };
+
+  printf("%-34s: %4i edges, %3i exterior, %2i BCs, %3i straddlers, %i mismatches: %s\n",
+          Description, S->NumEdges, S->NumExteriorEdges, S->NumBCs,
+          NumStraddlers, NumBad, NumBad==0 ? "PASSED" : "FAILED");
+
+  delete S;
+  return NumBad==0 ? 0 : 1;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM edge list unit test running on %s",GetHostName());
+
+  // keep exterior edges out of the Edges array, as for periodic
+  // geometries, so that all surfaces are compared the same way
+  RWGGeometry::AssignBasisFunctionsToExteriorEdges=false;
+
+  srand48(1);
+
+  int NumFailed=0;
+  NumFailed+=TestSurface("SSphere_255.msh",             "closed (SSphere_255)");
+  NumFailed+=TestSurface("UnitTestSphere_R0P75_414.msh","closed (UnitTestSphere_R0P75_414)");
+  NumFailed+=TestSurface("Tab_26.msh",                  "open (Tab_26)");
+  NumFailed+=TestSurface("SphereQuarter_42.msh",        "open (SphereQuarter_42)");
+
+  double LSquare[MAXLDIM][2] = { {1.0, 0.0}, {0.0, 1.0} };
+  NumFailed+=TestSurface("Square_40.msh", "periodic 2D (Square_40)", LSquare, 2);
+  NumFailed+=TestSurface("Square_40.msh", "periodic 1D (Square_40)", LSquare, 1);
+
+  double LSkew[MAXLDIM][2] = { {1.0, 0.0}, {0.5, 0.8} };
+  const char *SkewMesh="EdgeListSkew.msh";
+  WriteParallelogramMesh(SkewMesh, 24, LSkew[0], LSkew[1]);
+  NumFailed+=TestSurface(SkewMesh, "periodic 2D (skewed, 1152 panels)", LSkew, 2);
+  unlink(SkewMesh);
+
+  if (NumFailed>0) abort();
+  return 0;
+}
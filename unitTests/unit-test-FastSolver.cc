@@ -0,0 +1,151 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-FastSolver.cc -- SCUFF-EM unit test comparing the scuff-static
+ *                         -- fast (multipole + GMRES) solver against the
+ *                         -- dense BEM matrix and its LU solve
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+#include "SSSolver.h"
+
+using namespace scuff;
+
+#define NUMCOLUMNS     3
+#define MULTIPOLEORDER 10
+#define GMRESTOL       1.0e-10
+
+// the fast solver treats well-separated panel pairs with a fixed
+// low-order cubature and a truncated multipole expansion, while the
+// dense matrix uses GetPPI throughout, so the two agree only to
+// roughly the far-field cubature accuracy
+#define TOLERANCE      1.0e-3
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+double MaxRelDiff(HMatrix *A, HMatrix *B)
+{
+  double MaxA=0.0, MaxDelta=0.0;
+  for(int nr=0; nr<A->NR; nr++)
+   for(int nc=0; nc<A->NC; nc++)
+    { MaxA     = fmax(MaxA, fabs(A->GetEntryD(nr,nc)));
+      MaxDelta = fmax(MaxDelta, fabs(A->GetEntryD(nr,nc)-B->GetEntryD(nr,nc)));
+    };
+  return MaxDelta / MaxA;
+}
+
+/***************************************************************/
+/* smooth test charge densities: constant, and linear in z and */
+/* x, evaluated at the panel centroids                         */
+/***************************************************************/
+HMatrix *GetTestCharges(RWGGeometry *G)
+{
+  HMatrix *X = new HMatrix(G->TotalPanels, NUMCOLUMNS);
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   { RWGSurface *S=G->Surfaces[ns];
+     int Offset=G->PanelIndexOffset[ns];
+     for(int np=0; np<S->NumPanels; np++)
+      { double *XC=S->Panels[np]->Centroid;
+        X->SetEntry(Offset+np, 0, 1.0);
+        X->SetEntry(Offset+np, 1, XC[2]);
+        X->SetEntry(Offset+np, 2, XC[0]);
+      };
+   };
+  return X;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM fast electrostatics solver unit test running on %s",GetHostName());
+
+  // conductors (potential rows) and dielectrics (normal-field rows)
+  const char *GeoFiles[2] = { "PECSpheres_255.scuffgeo",
+                              "SiSpheres_255.scuffgeo" };
+  int NumFailed=0;
+  for(int ng=0; ng<2; ng++)
+   {
+     SSSolver *SSS = new SSSolver(GeoFiles[ng]);
+     RWGGeometry *G = SSS->G;
+
+     HMatrix *M = SSS->AssembleBEMMatrix();
+     HMatrix *X = GetTestCharges(G);
+
+     /*--------------------------------------------------------------*/
+     /*- matrix-vector product: dense vs. fast ----------------------*/
+     /*--------------------------------------------------------------*/
+     HMatrix *YDense = new HMatrix(G->TotalPanels, NUMCOLUMNS);
+     M->Multiply(X, YDense);
+
+     SSS->InitFastSolver(GMRESTOL, MULTIPOLEORDER);
+     HMatrix *YFast = SSS->ApplyBEMMatrix(X);
+
+     double RelError=MaxRelDiff(YDense, YFast);
+     printf("%s: ApplyBEMMatrix vs. dense product: %.2e: %s\n",
+             GeoFiles[ng], RelError, RelError<TOLERANCE ? "PASSED" : "FAILED");
+     if (RelError>=TOLERANCE)
+      NumFailed++;
+
+     /*--------------------------------------------------------------*/
+     /*- solve: LU vs. GMRES, for the right-hand sides YDense, whose -*/
+     /*- exact solutions are the smooth charges X                   -*/
+     /*--------------------------------------------------------------*/
+     HMatrix *SigmaLU   = new HMatrix(YDense);
+     HMatrix *SigmaFast = new HMatrix(YDense);
+
+     SSS->SolveBEMSystem(0, SigmaFast);
+     SSS->DestroyFastSolver();
+
+     M->LUFactorize();
+     SSS->SolveBEMSystem(M, SigmaLU);
+
+     RelError=MaxRelDiff(SigmaLU, SigmaFast);
+     printf("%s: fast solve vs. LU solve: %.2e: %s\n",
+             GeoFiles[ng], RelError, RelError<TOLERANCE ? "PASSED" : "FAILED");
+     if (RelError>=TOLERANCE)
+      NumFailed++;
+
+     delete SigmaLU;
+     delete SigmaFast;
+     delete YDense;
+     delete YFast;
+     delete X;
+     delete M;
+     delete SSS;
+   };
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
@@ -0,0 +1,135 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-FieldTreecode.cc -- SCUFF-EM unit test comparing treecode
+ *                            -- scattered fields against direct GetFields
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+#include "libIncField.h"
+
+using namespace scuff;
+
+#define NUMPOINTS 2000
+#define TOLERANCE 1.0e-4
+
+/***************************************************************/
+/* evaluation points: a shell of points around each sphere,    */
+/* a few of them inside the spheres, and a few far away        */
+/***************************************************************/
+HMatrix *CreateEvalPoints(int NumPoints)
+{
+  HMatrix *XMatrix = new HMatrix(NumPoints, 3);
+  srand48(12345);
+  for(int np=0; np<NumPoints; np++)
+   { double CosTheta = 2.0*drand48() - 1.0;
+     double SinTheta = sqrt(1.0-CosTheta*CosTheta);
+     double Phi      = 2.0*M_PI*drand48();
+     double r;
+     if (np%10==0)
+      r = 0.6*drand48();          // sphere interior
+     else if (np%10==1)
+      r = 10.0 + 10.0*drand48();  // far field
+     else
+      r = 1.1 + 2.0*drand48();    // near field
+
+     double ZCenter = (np%2) ? 3.0 : 0.0;
+     XMatrix->SetEntry(np, 0, r*SinTheta*cos(Phi));
+     XMatrix->SetEntry(np, 1, r*SinTheta*sin(Phi));
+     XMatrix->SetEntry(np, 2, ZCenter + r*CosTheta);
+   };
+  return XMatrix;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM field treecode unit test running on %s",GetHostName());
+
+  RWGGeometry *G = new RWGGeometry("SiSpheres_255.scuffgeo");
+  HMatrix *M   = G->AllocateBEMMatrix();
+  HVector *KN  = G->AllocateRHSVector();
+
+  cdouble E0[3]  = { 1.0, 0.0, 0.0 };
+  double nHat[3] = { 0.0, 0.0, 1.0 };
+  PlaneWave PW(E0, nHat);
+
+  HMatrix *XMatrix = CreateEvalPoints(NUMPOINTS);
+  HMatrix *FDirect = new HMatrix(NUMPOINTS, 6, LHM_COMPLEX);
+  HMatrix *FTree   = new HMatrix(NUMPOINTS, 6, LHM_COMPLEX);
+
+  double OmegaList[] = { 0.5, 2.0 };
+  int NumFailed=0;
+  for(int nOmega=0; nOmega<2; nOmega++)
+   {
+     cdouble Omega=OmegaList[nOmega];
+     G->AssembleBEMMatrix(Omega, M);
+     M->LUFactorize();
+     G->AssembleRHSVector(Omega, &PW, KN);
+     M->LUSolve(KN);
+
+     RWGGeometry::TreecodeTolerance=0.0;
+     G->GetFields(0, KN, Omega, XMatrix, FDirect);
+
+     RWGGeometry::TreecodeTolerance=1.0e-6;
+     RWGGeometry::TreecodeMinPoints=0;
+     G->GetFields(0, KN, Omega, XMatrix, FTree);
+
+     double MaxF=0.0, MaxDelta=0.0;
+     for(int np=0; np<NUMPOINTS; np++)
+      for(int nf=0; nf<6; nf++)
+       { cdouble FD = FDirect->GetEntry(np,nf);
+         cdouble FT = FTree->GetEntry(np,nf);
+         double Scale = (nf<3) ? 1.0 : ZVAC;
+         MaxF     = fmax(MaxF,     Scale*abs(FD));
+         MaxDelta = fmax(MaxDelta, Scale*abs(FT-FD));
+       };
+
+     double RelError = MaxDelta / MaxF;
+     printf("Omega=%g: max relative treecode error %.2e: %s\n",
+             real(Omega), RelError, RelError<TOLERANCE ? "PASSED" : "FAILED");
+     if (RelError>=TOLERANCE)
+      NumFailed++;
+   };
+
+  delete XMatrix;
+  delete FDirect;
+  delete FTree;
+  delete M;
+  delete KN;
+  delete G;
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
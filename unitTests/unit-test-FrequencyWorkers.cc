@@ -0,0 +1,131 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-FrequencyWorkers.cc -- SCUFF-EM unit test comparing
+ *                               -- scuff-neq fluxes computed by
+ *                               -- forked frequency workers against
+ *                               -- a serial run in the parent
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+#include "scuff-neq.h"
+
+using namespace scuff;
+
+/***************************************************************/
+/* workers and parent run the same code on the same data, but  */
+/* with different thread counts, so results may differ in the  */
+/* order of OpenMP reductions                                  */
+/***************************************************************/
+#define TOLERANCE 1.0e-10
+
+#define NUMWORKERS 2
+
+// a worker that hangs (e.g. in the OpenMP runtime after fork)
+// must fail the test rather than block it forever
+#define TIMEOUT 1800
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM frequency worker unit test running on %s",GetHostName());
+
+  alarm(TIMEOUT);
+
+  // set up everything single-threaded, as the applications do
+  int NumThreads=GetNumThreads();
+  ReserveFrequencyWorkers(NUMWORKERS);
+
+  int QuantityFlags = QFLAG_POWER | QFLAG_XFORCE | QFLAG_ZFORCE;
+  SNEQData *SNEQD=CreateSNEQData(const_cast<char *>("SiSpheres_255.scuffgeo"), 0,
+                                 QuantityFlags, const_cast<char *>("unit-test-FrequencyWorkers"));
+  SNEQD->UseExistingData = false;
+  SNEQD->SIRadius        = 100.0;
+  SNEQD->SINumPoints     = 31;
+  SNEQD->PlotFlux        = 0;
+
+  int NS=SNEQD->G->NumSurfaces;
+  int FDim = NS*SNEQD->NTNSNQ;
+
+  int NumFailed=0;
+
+  /*--------------------------------------------------------------*/
+  /*- fluxes from the workers; creating them must hand the full   */
+  /*- thread count back to the parent                             */
+  /*--------------------------------------------------------------*/
+  SNEQD->FrequencyWorkers=CreateFrequencyWorkers(OmegaWorkerFunction, (void *)SNEQD,
+                                                 2, FDim, NUMWORKERS);
+  bool ThreadsOK = (GetNumThreads()==NumThreads);
+  printf("thread count restored after fork (%i): %s\n",
+          GetNumThreads(), ThreadsOK ? "PASSED" : "FAILED");
+  if (!ThreadsOK) NumFailed++;
+
+  // more points than workers, so that workers are reused
+  cdouble Omega[] = { 0.1, 0.5, 1.0, cdouble(0.3,0.2), 2.0 };
+  int NumOmega = sizeof(Omega)/sizeof(Omega[0]);
+  double *WorkerFlux = new double[NumOmega*FDim];
+  double *SerialFlux = new double[NumOmega*FDim];
+  GetFluxes(SNEQD, NumOmega, Omega, WorkerFlux);
+
+  DestroyFrequencyWorkers(SNEQD->FrequencyWorkers);
+  SNEQD->FrequencyWorkers=0;
+
+  /*--------------------------------------------------------------*/
+  /*- the same fluxes computed serially in this process           */
+  /*--------------------------------------------------------------*/
+  GetFluxes(SNEQD, NumOmega, Omega, SerialFlux);
+
+  for(int no=0; no<NumOmega; no++)
+   { double MaxRef=0.0, MaxDelta=0.0;
+     for(int nf=0; nf<FDim; nf++)
+      { double W=WorkerFlux[no*FDim + nf], S=SerialFlux[no*FDim + nf];
+        Log(" Omega=(%g,%g) nf=%i: worker=%+.12e serial=%+.12e",
+              real(Omega[no]),imag(Omega[no]),nf,W,S);
+        MaxRef   = fmax(MaxRef, fabs(S));
+        MaxDelta = fmax(MaxDelta, fabs(W-S));
+      };
+     double RelError = MaxDelta/MaxRef;
+     bool OK = (RelError<TOLERANCE);
+     printf("Omega=(%g,%g): worker vs. serial fluxes: %.2e: %s\n",
+             real(Omega[no]), imag(Omega[no]), RelError, OK ? "PASSED" : "FAILED");
+     if (!OK) NumFailed++;
+   };
+
+  delete[] WorkerFlux;
+  delete[] SerialFlux;
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
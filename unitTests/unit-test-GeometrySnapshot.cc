@@ -0,0 +1,196 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-GeometrySnapshot.cc -- SCUFF-EM unit test checking that
+ *                               -- surfaces loaded from geometry
+ *                               -- snapshots match those obtained by
+ *                               -- parsing the mesh files afresh
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+
+using namespace scuff;
+
+/***************************************************************/
+/* snapshots are flat copies of the parsed data, so everything */
+/* must agree exactly                                          */
+/***************************************************************/
+#define SAME(a,b) ( memcmp(&(a), &(b), sizeof(a))==0 )
+
+int CompareEdges(RWGEdge *E0, RWGEdge *E1)
+{
+  if (E0==0 || E1==0) return (E0==E1) ? 0 : 1;
+  return !(    E0->iV1==E1->iV1 && E0->iV2==E1->iV2
+            && E0->iQP==E1->iQP && E0->iQM==E1->iQM
+            && SAME(E0->Centroid, E1->Centroid)
+            && SAME(E0->Length, E1->Length)
+            && SAME(E0->Radius, E1->Radius)
+            && E0->iPPanel==E1->iPPanel && E0->iMPanel==E1->iMPanel
+            && E0->PIndex==E1->PIndex && E0->MIndex==E1->MIndex
+            && E0->Index==E1->Index
+          );
+}
+
+/***************************************************************/
+/* return the number of mismatched items between two surfaces  */
+/***************************************************************/
+int CompareSurfaces(RWGSurface *S0, RWGSurface *S1)
+{
+  if (    S0->NumVertices!=S1->NumVertices
+       || S0->NumPanels!=S1->NumPanels
+       || S0->NumEdges!=S1->NumEdges
+       || S0->NumExteriorEdges!=S1->NumExteriorEdges
+       || S0->NumTotalEdges!=S1->NumTotalEdges
+       || S0->NumBCs!=S1->NumBCs
+       || S0->NumBFs!=S1->NumBFs
+       || S0->IsClosed!=S1->IsClosed
+     ) return 1;
+
+  int NumBad=0;
+  if ( memcmp(S0->Vertices, S1->Vertices, 3*S0->NumVertices*sizeof(double)) )
+   NumBad++;
+
+  for(int np=0; np<S0->NumPanels; np++)
+   { RWGPanel *P0=S0->Panels[np], *P1=S1->Panels[np];
+     if (!(    SAME(P0->VI, P1->VI) && SAME(P0->EI, P1->EI)
+            && SAME(P0->Centroid, P1->Centroid) && SAME(P0->ZHat, P1->ZHat)
+            && P0->ZHatFlipped==P1->ZHatFlipped
+            && SAME(P0->Radius, P1->Radius) && SAME(P0->Area, P1->Area)
+            && P0->Index==P1->Index
+        )) NumBad++;
+   };
+
+  for(int ne=0; ne<S0->NumEdges; ne++)
+   NumBad+=CompareEdges(S0->Edges[ne], S1->Edges[ne]);
+
+  for(int ne=0; ne<S0->NumExteriorEdges; ne++)
+   NumBad+=CompareEdges(S0->ExteriorEdges[ne], S1->ExteriorEdges[ne]);
+
+  if (S0->NumBCs>0)
+   { if ( memcmp(S0->WhichBC, S1->WhichBC, S0->NumVertices*sizeof(int)) )
+      NumBad++;
+     for(int nbc=0; nbc<S0->NumBCs; nbc++)
+      { if (S0->NumBCEdges[nbc]!=S1->NumBCEdges[nbc])
+         { NumBad++;
+           continue;
+         };
+        for(int n=0; n<S0->NumBCEdges[nbc]; n++)
+         NumBad+=CompareEdges(S0->BCEdges[nbc][n], S1->BCEdges[nbc][n]);
+      };
+   };
+
+  return NumBad;
+}
+
+/***************************************************************/
+/* count (and optionally delete) snapshot files in Dir         */
+/***************************************************************/
+int CountSnapshots(const char *Dir, bool Delete=false)
+{
+  DIR *D=opendir(Dir);
+  if (!D) return 0;
+  int Count=0;
+  struct dirent *DE;
+  while( (DE=readdir(D)) )
+   { const char *Ext=strrchr(DE->d_name,'.');
+     if (Ext && !strcmp(Ext,".scuffsnap")) Count++;
+     if (Delete && DE->d_name[0]!='.')
+      { char *FileName=vstrdup("%s/%s",Dir,DE->d_name);
+        unlink(FileName);
+        free(FileName);
+      };
+   };
+  closedir(D);
+  return Count;
+}
+
+/***************************************************************/
+/* build GeoFile three times -- without snapshots, writing     */
+/* snapshots, and reading them back -- and compare             */
+/***************************************************************/
+int TestGeometry(const char *GeoFile, const char *Dir)
+{
+  RWGGeometry::SetSnapshotDir(0);
+  RWGGeometry *G0=new RWGGeometry(GeoFile);
+
+  RWGGeometry::SetSnapshotDir(Dir);
+  int NumBefore=CountSnapshots(Dir);
+  RWGGeometry *G1=new RWGGeometry(GeoFile);
+  int NumWritten=CountSnapshots(Dir) - NumBefore;
+  RWGGeometry *G2=new RWGGeometry(GeoFile);
+  RWGGeometry::SetSnapshotDir(0);
+
+  int NumBad=0, NumFromSnapshot=0;
+  if (G0->NumSurfaces!=G2->NumSurfaces || G0->TotalBFs!=G2->TotalBFs)
+   NumBad++;
+  else
+   for(int ns=0; ns<G0->NumSurfaces; ns++)
+    { if (G1->Surfaces[ns]->FromSnapshot) NumBad++;
+      if (G2->Surfaces[ns]->FromSnapshot) NumFromSnapshot++;
+      NumBad+=CompareSurfaces(G0->Surfaces[ns], G2->Surfaces[ns]);
+      for(int nd=0; nd<G0->LDim; nd++)
+       if (G0->NumStraddlers[nd][ns]!=G2->NumStraddlers[nd][ns])
+        NumBad++;
+    };
+
+  bool OK = (NumBad==0 && NumWritten>0 && NumFromSnapshot==G0->NumSurfaces);
+  printf("%-22s: %i snapshots written, %i/%i surfaces read back, %i mismatches: %s\n",
+          GeoFile, NumWritten, NumFromSnapshot, G0->NumSurfaces, NumBad,
+          OK ? "PASSED" : "FAILED");
+
+  delete G0;
+  delete G1;
+  delete G2;
+  return OK ? 0 : 1;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM geometry snapshot unit test running on %s",GetHostName());
+
+  char Dir[]="GeometrySnapshot.XXXXXX";
+  if (!mkdtemp(Dir))
+   ErrExit("could not create temporary directory");
+
+  int NumFailed=0;
+  NumFailed+=TestGeometry("PECSphere_255.scuffgeo", Dir); // closed
+  NumFailed+=TestGeometry("TwoTabPairs.scuffgeo",   Dir); // open
+  NumFailed+=TestGeometry("SiSlab_40.scuffgeo",     Dir); // periodic
+
+  CountSnapshots(Dir, true);
+  rmdir(Dir);
+
+  if (NumFailed>0) abort();
+  return 0;
+}
@@ -0,0 +1,189 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-GridResume.cc -- SCUFF-EM unit test for the tiled field-grid
+ *                         -- writer GetFieldsGridsToFile(): a write is
+ *                         -- interrupted at various points, resumed,
+ *                         -- and the result is byte-compared against an
+ *                         -- uninterrupted run
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+#include "libIncField.h"
+
+using namespace scuff;
+
+// 37 rows in tiles of 8 rows: four full tiles and a short last
+// tile of 5 rows
+#define N1        37
+#define N2        11
+#define TILEROWS  8
+#define NUMTILES  ((N1 + TILEROWS - 1) / TILEROWS)
+
+// Ex is complex-valued (two columns), |E|^2 is real (one column)
+#define FUNCS     "Ex,|Ex|^2+|Ey|^2+|Ez|^2"
+#define NUMFUNCS  2
+#define NUMCOLS   3
+
+// layout of the binary output file (see FieldGrid.cc)
+#define DATAOFFSET (8 + 4*sizeof(int) + NUMFUNCS*sizeof(int))
+#define ROWBYTES   ((long)N2 * NUMCOLS * sizeof(double))
+#define FILEBYTES  (DATAOFFSET + N1*ROWBYTES)
+
+#define REFFILE  "GridResume_Ref.dat"
+#define TESTFILE "GridResume_Test.dat"
+
+/***************************************************************/
+/* read a file into a newly allocated buffer                   */
+/***************************************************************/
+char *ReadFile(const char *FileName, long *NumBytes)
+{
+  FILE *f=fopen(FileName,"rb");
+  if (!f) ErrExit("could not open %s",FileName);
+  fseek(f, 0, SEEK_END);
+  *NumBytes=ftell(f);
+  fseek(f, 0, SEEK_SET);
+  char *Buffer=(char *)mallocEC(*NumBytes + 1);
+  if ( fread(Buffer, 1, *NumBytes, f) != (size_t)(*NumBytes) )
+   ErrExit("could not read %s",FileName);
+  fclose(f);
+  return Buffer;
+}
+
+/***************************************************************/
+/* number of tiles that a resumed run must recompute if the    */
+/* interrupted file contained NumBytes bytes: a tile is done   */
+/* only if all of its rows made it to disk                     */
+/***************************************************************/
+int ExpectedTiles(long NumBytes)
+{
+  if (NumBytes<(long)DATAOFFSET || NumBytes>(long)FILEBYTES)
+   return NUMTILES;
+  long Rows = (NumBytes - DATAOFFSET) / ROWBYTES;
+  int NumDone=0;
+  for(int nt=0; nt<NUMTILES; nt++)
+   { int RowEnd = (nt+1)*TILEROWS > N1 ? N1 : (nt+1)*TILEROWS;
+     if (RowEnd<=Rows) NumDone++;
+   };
+  return NUMTILES - NumDone;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM field-grid resume unit test running on %s",GetHostName());
+
+  RWGGeometry *G = new RWGGeometry("PECSphere_255.scuffgeo");
+  HMatrix *M   = G->AllocateBEMMatrix();
+  HVector *KN  = G->AllocateRHSVector();
+
+  cdouble E0[3]  = { 1.0, 0.0, 0.0 };
+  double nHat[3] = { 0.0, 0.0, 1.0 };
+  PlaneWave PW(E0, nHat);
+
+  cdouble Omega=1.0;
+  G->AssembleBEMMatrix(Omega, M);
+  M->LUFactorize();
+  G->AssembleRHSVector(Omega, &PW, KN);
+  M->LUSolve(KN);
+
+  // an xz-plane grid cutting through the sphere
+  double C0[3]={0.0, 0.0, 0.0};
+  PlaneGrid Grid(N1, N2, C0, 4.0, 4.0, YDIR);
+
+  /*--------------------------------------------------------------*/
+  /*- uninterrupted reference run ---------------------------------*/
+  /*--------------------------------------------------------------*/
+  int NumFailed=0;
+  remove(REFFILE);
+  int NT=G->GetFieldsGridsToFile(Grid, FUNCS, Omega, KN, &PW,
+                                 REFFILE, TILEROWS, false);
+  long RefBytes;
+  char *RefData=ReadFile(REFFILE, &RefBytes);
+  bool OK = (NT==NUMTILES && RefBytes==(long)FILEBYTES);
+  printf("reference run: %i tiles, %li bytes: %s\n",NT,RefBytes,
+          OK ? "PASSED" : "FAILED");
+  if (!OK) NumFailed++;
+
+  /*--------------------------------------------------------------*/
+  /*- simulate interruptions by truncating the reference file at -*/
+  /*- various points (inside the header, mid-tile, on a tile      */
+  /*- boundary, inside the short last tile, one byte short of     */
+  /*- complete, complete) and by appending garbage, then resume   */
+  /*--------------------------------------------------------------*/
+  long CutList[]=
+   { 10,
+     DATAOFFSET,
+     DATAOFFSET + 13*ROWBYTES + 17,
+     DATAOFFSET + 16*ROWBYTES,
+     DATAOFFSET + 33*ROWBYTES,
+     DATAOFFSET + 35*ROWBYTES + 5,
+     FILEBYTES - 1,
+     FILEBYTES,
+     FILEBYTES + 24
+   };
+  int NumCuts=sizeof(CutList)/sizeof(CutList[0]);
+
+  for(int nc=0; nc<NumCuts; nc++)
+   { 
+     long Cut=CutList[nc];
+     FILE *f=fopen(TESTFILE,"wb");
+     long NumWritten=0;
+     if (f)
+      { NumWritten+=fwrite(RefData, 1, Cut<RefBytes ? Cut : RefBytes, f);
+        for(; NumWritten<Cut; NumWritten++)
+         fputc(0x5a, f);
+        fclose(f);
+      };
+
+     NT=G->GetFieldsGridsToFile(Grid, FUNCS, Omega, KN, &PW,
+                                TESTFILE, TILEROWS, true);
+
+     long TestBytes;
+     char *TestData=ReadFile(TESTFILE, &TestBytes);
+     bool Same = (TestBytes==RefBytes && !memcmp(TestData, RefData, RefBytes));
+     free(TestData);
+
+     int NTExpected=ExpectedTiles(Cut);
+     OK = Same && (NT==NTExpected);
+     printf("cut at %6li bytes: %i/%i tiles recomputed (expected %i), files %s: %s\n",
+             Cut, NT, NUMTILES, NTExpected, Same ? "identical" : "differ",
+             OK ? "PASSED" : "FAILED");
+     if (!OK) NumFailed++;
+   };
+
+  free(RefData);
+  remove(REFFILE);
+  remove(TESTFILE);
+
+  if (NumFailed>0) abort();
+  return 0;
+}
@@ -0,0 +1,446 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-IncFieldBatch.cc -- SCUFF-EM unit test comparing the batched
+ *                            -- incident-field routines (the GetFieldsBatch()
+ *                            -- overrides in libIncField and the batched
+ *                            -- incident-field pass of GetFields()) against
+ *                            -- the original per-point field formulas
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+#include "libIncField.h"
+#include "libVec.h"
+
+using namespace scuff;
+
+#define II cdouble(0.0,1.0)
+
+// the batched routines hoist the point-independent factors out of
+// the loop but otherwise repeat the per-point arithmetic, so they
+// agree with it to a few ulps
+#define TOLERANCE 1.0e-12
+
+// more than one block (1024 points) of GetIncFieldsBatch()
+#define NUMPOINTS 3000
+
+/***************************************************************/
+/* reference implementations: the per-point GetFields() routines*/
+/* of PlaneWave, PointSource, and GaussianBeam as they were     */
+/* before the batched versions were introduced                  */
+/***************************************************************/
+void RefPlaneWaveFields(PlaneWave *PW, const double X[3], cdouble EH[6])
+{
+  cdouble Eps=PW->Eps, Mu=PW->Mu, Omega=PW->Omega;
+  cdouble *E0=PW->E0;
+  double *nHat=PW->nHat;
+
+  cdouble K=sqrt(Eps*Mu) * Omega;
+  cdouble Z=ZVAC*sqrt(Mu/Eps);
+  cdouble ExpFac=exp(II*K*(nHat[0]*X[0] + nHat[1]*X[1] + nHat[2]*X[2]));
+
+  EH[0] = E0[0] * ExpFac;
+  EH[1] = E0[1] * ExpFac;
+  EH[2] = E0[2] * ExpFac;
+
+  /* H = (nHat \cross E) / Z */
+  EH[3] = (nHat[1]*EH[2] - nHat[2]*EH[1]) / Z;
+  EH[4] = (nHat[2]*EH[0] - nHat[0]*EH[2]) / Z ;
+  EH[5] = (nHat[0]*EH[1] - nHat[1]*EH[0]) / Z;
+}
+
+void RefPointSourceFields(PointSource *PS, const double X[3], cdouble EH[6])
+{
+  cdouble Eps=PS->Eps, Mu=PS->Mu, Omega=PS->Omega;
+  double *X0=PS->X0;
+  cdouble *P=PS->P;
+
+  /* construct R, RHat, etc. */
+  double RHat[3], R;
+  RHat[0]=X[0] - X0[0];
+  RHat[1]=X[1] - X0[1];
+  RHat[2]=X[2] - X0[2];
+  R=sqrt(  RHat[0]*RHat[0] + RHat[1]*RHat[1] + RHat[2]*RHat[2] );
+  RHat[0]/=R;
+  RHat[1]/=R;
+  RHat[2]/=R;
+
+  cdouble PDotR, RCrossP[3];
+  PDotR=P[0]*RHat[0] + P[1]*RHat[1] + P[2]*RHat[2];
+  RCrossP[0]= RHat[1]*P[2] - RHat[2]*P[1];
+  RCrossP[1]= RHat[2]*P[0] - RHat[0]*P[2];
+  RCrossP[2]= RHat[0]*P[1] - RHat[1]*P[0];
+  
+  cdouble k      = Omega*sqrt(Eps*Mu);
+  cdouble ikr    = II*k*R;
+  cdouble ikr2   = ikr*ikr;
+  cdouble ExpFac = k*k*exp(ikr) / (4.0*M_PI*R);
+
+  cdouble Z      = ZVAC*sqrt(Mu/Eps);
+
+  /* compute the various scalar quantities in the point source formulae */
+  cdouble Term1=  1.0 - 1.0/ikr + 1.0/ikr2; 
+  cdouble Term2= (-1.0 + 3.0/ikr - 3.0/ikr2) * PDotR; 
+  cdouble Term3= (1.0 - 1.0/ikr);
+
+  /* now assemble everything based on source type */
+  if ( PS->Type == LIF_ELECTRIC_DIPOLE )
+   { 
+     ExpFac /= Eps;
+
+     EH[0]=ExpFac*( Term1*P[0] + Term2*RHat[0] );
+     EH[1]=ExpFac*( Term1*P[1] + Term2*RHat[1] );
+     EH[2]=ExpFac*( Term1*P[2] + Term2*RHat[2] );
+
+     EH[3]=ExpFac*Term3*RCrossP[0] / Z;
+     EH[4]=ExpFac*Term3*RCrossP[1] / Z;
+     EH[5]=ExpFac*Term3*RCrossP[2] / Z;
+   }
+  else // ( Type == LIF_TYPE_PSMC )
+   { 
+     ExpFac /= Mu;
+
+     EH[0]=-1.0*ExpFac*Term3*RCrossP[0] / Z;
+     EH[1]=-1.0*ExpFac*Term3*RCrossP[1] / Z;
+     EH[2]=-1.0*ExpFac*Term3*RCrossP[2] / Z;
+
+     EH[3]=ExpFac*( Term1*P[0] + Term2*RHat[0] ) / (Z*Z);
+     EH[4]=ExpFac*( Term1*P[1] + Term2*RHat[1] ) / (Z*Z);
+     EH[5]=ExpFac*( Term1*P[2] + Term2*RHat[2] ) / (Z*Z);
+   };
+}
+
+void RefGaussianBeamFields(GaussianBeam *GB, const double X[3], cdouble EH[6])
+{
+  cdouble Eps=GB->Eps, Mu=GB->Mu, Omega=GB->Omega;
+  double W0=GB->W0, *X0=GB->X0, *KProp=GB->KProp;
+  cdouble *E0=GB->E0;
+
+  const cdouble IU(0,1);
+  double EpsR = real(Eps);
+  double MuR  = real(Mu);
+  double k    = sqrt(EpsR*MuR)*real(Omega); // wavenumber of medium 
+  double ZR   = sqrt(MuR/EpsR);             // relative wave impedance of medium
+
+  zVec zvE0     = E0;     // complex field-strength vector
+                          // containing information on the 
+                          // field strength and polarization 
+
+  // we follow CJR Sheppard & S Saghafi, J Opt Soc Am A 16, 1381 and
+  // approximate the Gaussian beam as the field of the sum of an   
+  // x-polarized electric and y-polarized magnetic dipole, located at
+  // the complex point X = (0,0,i z0)
+  // this has the advantage that the field can be analytically calculated
+  // and exactly solves Maxwell's equations everywhere in space
+  double z0 = k*W0*W0/2;
+  double kz0 = k*z0;
+  dVec Xrel = dVec(X) - dVec(X0);
+
+  // the field has NO cylindrical symmetry! this means that for
+  // complex polarization vectors, we have to do a separate calculation
+  // for the real and for the complex part
+
+  // first, we do everything that is not direction dependent, i.e.
+  // where we only need the z-coordinate and the radial distance rho
+  dVec zHat = KProp; zHat.normalize();
+  double z, rho;
+
+  // this is from libVec.h
+  GetLocalCylinderCoordinates(Xrel, zHat, rho, z);
+
+  // HR 20130915 the cos, sin below can overflow if kR has large 
+  // imaginary part, so in that case we use the 'rescaled' versions 
+  // of f and g, defined as f,g divided by exp(kz0). x
+  bool UseRescaledFG = false;
+
+  cdouble zc = z - IU*z0;
+  cdouble Rsq  = rho*rho + zc*zc, R = sqrt(Rsq), kR = k*R, kRsq = kR*kR, kR3 = kRsq*kR;
+  cdouble f,g,fmgbRsq;
+  // we have to be careful: R can go to zero, leading to numerical problems
+  if (std::abs(kR)>1.e-4) 
+   {
+    cdouble coskR, sinkR;
+    if ( fabs(imag(kR))>30.0 )
+     { UseRescaledFG = true;
+       cdouble ExpI     = exp( IU*real(kR) );
+       cdouble ExpPlus  = exp( imag(kR) - kz0 );
+       cdouble ExpMinus = exp( -(imag(kR) + kz0) );
+       coskR = 0.5*( ExpI*ExpMinus + conj(ExpI)*ExpPlus);
+       sinkR = -0.5*IU*( ExpI*ExpMinus - conj(ExpI)*ExpPlus);
+     }
+    else
+     { coskR = cos(kR); 
+       sinkR = sin(kR);
+     };
+    f   = -3.  *            (coskR/kRsq - sinkR/kR3);
+    //g =  1.5 * (sinkR/kR + coskR/kRsq - sinkR/kR3)
+    g   =  1.5 *  sinkR/kR - 0.5 * f;
+    fmgbRsq = (f-g)/Rsq;
+  } else {
+    cdouble kR4 = kRsq*kRsq;
+    // use a series expansion for small R
+    // fourth order term is already at most 1e-16*3/280!
+    f = kR4   /280. - kRsq/10. + 1.;
+    g = kR4*3./280. - kRsq/5.  + 1.;
+    // note: this is (f(kR)-g(kR))/R^2, not /kR^2 - so we get an additional k^2 term
+    fmgbRsq = (kR4/5040. - kRsq/140. + 0.1) * (k*k);
+  }
+  cdouble i2fk = 0.5*IU*f*k;
+
+  // now calculate the actual coordinates for having either zvE0.real() or zvE0.imag() as the x axis
+  // local coordinate system given by ^z = kProp, ^x ~ Re(E0) or Im(E0), ^y ~ ^z x ^x  
+  zVec E, H;
+
+  double rnorm = norm(zvE0.real());
+  if (rnorm>1e-13) {
+    // calculate fields in local coordinate system
+    dVec xHat = zvE0.real() / rnorm;
+    dVec yHat = cross(zHat,xHat);
+    double  x  = dot(xHat,Xrel);
+    double  y  = dot(yHat,Xrel);
+    
+    cdouble Ex = g + fmgbRsq * x * x  + i2fk * zc;
+    cdouble Ey =     fmgbRsq * x * y;
+    cdouble Ez =     fmgbRsq * x * zc - i2fk * x;
+    cdouble Hx = Ey;
+    cdouble Hy = g + fmgbRsq * y * y  + i2fk * zc;
+    cdouble Hz =     fmgbRsq * y * zc - i2fk * y;
+
+    // go back to the laboratory frame
+    E += cdouble(rnorm) * (Ex * zVec(xHat) + Ey * zVec(yHat) + Ez * zVec(zHat));
+    H += cdouble(rnorm) * (Hx * zVec(xHat) + Hy * zVec(yHat) + Hz * zVec(zHat));
+  } 
+  
+  double inorm = norm(zvE0.imag());
+  if (inorm>1e-13) {
+    // calculate fields in local coordinate system
+    dVec xHat = zvE0.imag() / inorm;
+    dVec yHat = cross(zHat,xHat);
+    double  x  = dot(xHat,Xrel);
+    double  y  = dot(yHat,Xrel);
+    
+    cdouble Ex = g + fmgbRsq * x * x  + i2fk * zc;
+    cdouble Ey =     fmgbRsq * x * y;
+    cdouble Ez =     fmgbRsq * x * zc - i2fk * x;
+    cdouble Hx = Ey;
+    cdouble Hy = g + fmgbRsq * y * y  + i2fk * zc;
+    cdouble Hz =     fmgbRsq * y * zc - i2fk * y;
+    
+    // go back to the laboratory frame
+    E += IU * inorm * (Ex * zVec(xHat) + Ey * zVec(yHat) + Ez * zVec(zHat));
+    H += IU * inorm * (Hx * zVec(xHat) + Hy * zVec(yHat) + Hz * zVec(zHat));
+  }
+
+  // the field as calculated above is not normalized, so we get the field strength at the origin
+  // (for E0 == 1)
+  // this can be simplified very much by using that for x=y=z=0, R = sqrt((-i z0)**2) = i z0
+
+  // 20130915 HR see comments above; note sinh(kz0)/exp(kz0) = 0.5(1-exp(-2*kz0)) 
+  double Eorig; 
+  if (UseRescaledFG)
+   Eorig = 3./(2*kz0*kz0*kz0) * (kz0*(kz0-1) + 0.5*(1.0-exp(-2.0*kz0)) );
+  else
+   Eorig = 3./(2*kz0*kz0*kz0) * (exp(kz0)*kz0*(kz0-1) + sinh(kz0));
+  
+  // now scale the fields to have E(0,0,0) = E0
+  E /= Eorig;
+  EH[0] = E[0]; EH[1] = E[1]; EH[2] = E[2];
+  H /= (Eorig*ZVAC*ZR);
+  EH[3] = H[0]; EH[4] = H[1]; EH[5] = H[2];
+}
+
+/***************************************************************/
+/* dispatch to the reference routine for the type of IF        */
+/***************************************************************/
+void RefFields(IncField *IF, const double X[3], cdouble EH[6])
+{
+  PlaneWave *PW=dynamic_cast<PlaneWave *>(IF);
+  PointSource *PS=dynamic_cast<PointSource *>(IF);
+  GaussianBeam *GB=dynamic_cast<GaussianBeam *>(IF);
+  if (PW)
+   RefPlaneWaveFields(PW, X, EH);
+  else if (PS)
+   RefPointSourceFields(PS, X, EH);
+  else if (GB)
+   RefGaussianBeamFields(GB, X, EH);
+  else
+   ErrExit("unknown IncField type");
+}
+
+/***************************************************************/
+/* relative difference between two six-vectors                 */
+/***************************************************************/
+double RelDiff(const cdouble *EH, const cdouble *EHRef)
+{
+  double Norm=0.0, Delta=0.0;
+  for(int i=0; i<6; i++)
+   { Norm  += norm(EHRef[i]);
+     Delta += norm(EH[i]-EHRef[i]);
+   };
+  return Norm==0.0 ? sqrt(Delta) : sqrt(Delta/Norm);
+}
+
+/***************************************************************/
+/* random points in a box, plus a few points close to the ring */
+/* rho=z0 in the focal plane of a gaussian beam centered at the*/
+/* origin and propagating along z, where the small-kR series   */
+/* of GaussianBeam kicks in                                    */
+/***************************************************************/
+HMatrix *CreateEvalPoints(int NumPoints, double z0)
+{
+  HMatrix *XMatrix = new HMatrix(NumPoints, 3);
+  srand48(0);
+  for(int np=0; np<NumPoints; np++)
+   { if (np%50==0)
+      { double Phi=2.0*M_PI*drand48();
+        double rho=z0*(1.0 + 1.0e-6*(2.0*drand48()-1.0));
+        XMatrix->SetEntry(np, 0, rho*cos(Phi));
+        XMatrix->SetEntry(np, 1, rho*sin(Phi));
+        XMatrix->SetEntry(np, 2, 1.0e-6*(2.0*drand48()-1.0));
+      }
+     else
+      { XMatrix->SetEntry(np, 0, -1.5 + 5.0*drand48());
+        XMatrix->SetEntry(np, 1, -1.5 + 3.0*drand48());
+        XMatrix->SetEntry(np, 2, -1.5 + 3.0*drand48());
+      };
+   };
+  return XMatrix;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM batched incident-field unit test running on %s",GetHostName());
+
+  double Omega=1.0;
+
+  /***************************************************************/
+  /* incident fields: a plane wave and a wide gaussian beam (whose*/
+  /* large kz0 triggers the rescaled f,g branch) in the exterior, */
+  /* an electric dipole in the shell of the outer sphere, a narrow*/
+  /* gaussian beam in the shell of the middle sphere, and a       */
+  /* magnetic dipole in the inner sphere of NestedSpheres.scuffgeo*/
+  /***************************************************************/
+  cdouble E0[3]   = { 1.0, 0.5*II, 0.0 };
+  double nHat[3]  = { 0.0, 0.6, 0.8 };
+  PlaneWave PW(E0, nHat);
+
+  double XPE[3]   = { 0.0, 0.0, 0.9 };
+  cdouble PE[3]   = { 0.3, 1.0, 0.2*II };
+  PointSource PSE(XPE, PE, LIF_ELECTRIC_DIPOLE);
+
+  double XPM[3]   = { 0.05, 0.0, 0.1 };
+  cdouble PM[3]   = { 0.0, 0.7, 1.0 };
+  PointSource PSM(XPM, PM, LIF_MAGNETIC_DIPOLE);
+
+  double XGB[3]   = { 0.0, 0.0, 0.0 };
+  double KProp[3] = { 0.0, 0.0, 1.0 };
+  cdouble EGB[3]  = { 1.0, II, 0.0 };
+  GaussianBeam GBNarrow(XGB, KProp, EGB, 0.5, "MiddleSphere");
+  GaussianBeam GBWide(XGB, KProp, EGB, 10.0);
+
+  IncField *IFs[5] = { &PW, &PSE, &PSM, &GBNarrow, &GBWide };
+  for(int n=0; n<4; n++)
+   IFs[n]->Next=IFs[n+1];
+
+  RWGGeometry *G = new RWGGeometry("NestedSpheres.scuffgeo");
+
+  // z0 = k W0^2 / 2 for the narrow beam, in a medium with Eps=4
+  HMatrix *XMatrix = CreateEvalPoints(NUMPOINTS, 2.0*Omega*0.5*0.5/2.0);
+
+  /***************************************************************/
+  /* total incident fields computed by GetFields() from the whole */
+  /* chain; this also assigns each IncField its source region and */
+  /* the material properties of that region                       */
+  /***************************************************************/
+  HMatrix *FMatrix=G->GetFields(&PW, 0, Omega, XMatrix);
+
+  int NumFailed=0;
+  double *X = new double[3*NUMPOINTS];
+  for(int np=0; np<NUMPOINTS; np++)
+   for(int i=0; i<3; i++)
+    X[3*np+i] = XMatrix->GetEntryD(np,i);
+
+  /***************************************************************/
+  /* GetFieldsBatch() for each field type on its own              */
+  /***************************************************************/
+  const char *Names[5]={"plane wave","electric dipole","magnetic dipole",
+                        "narrow gaussian beam","wide gaussian beam"};
+  cdouble *EHBatch = new cdouble[6*NUMPOINTS];
+  for(int n=0; n<5; n++)
+   { IFs[n]->GetFieldsBatch(NUMPOINTS, X, EHBatch);
+     double MaxErr=0.0;
+     for(int np=0; np<NUMPOINTS; np++)
+      { cdouble EHRef[6];
+        RefFields(IFs[n], X+3*np, EHRef);
+        MaxErr=fmax(MaxErr, RelDiff(EHBatch+6*np, EHRef));
+      };
+     printf("%-22s (region %i): batch vs. per-point: %.2e: %s\n",
+             Names[n], IFs[n]->RegionIndex, MaxErr,
+             MaxErr<TOLERANCE ? "PASSED" : "FAILED");
+     if (MaxErr>=TOLERANCE) NumFailed++;
+   };
+
+  /***************************************************************/
+  /* GetFields() on the whole chain: at each point, the sum of    */
+  /* the fields of all IncFields sourced in the region containing */
+  /* the point                                                    */
+  /***************************************************************/
+  double MaxErr=0.0;
+  int NumInRegion[5]={0,0,0,0,0};
+  for(int np=0; np<NUMPOINTS; np++)
+   { int nr=G->GetRegionIndex(X+3*np);
+     if (nr<5) NumInRegion[nr]++;
+     cdouble EHRef[6]={0.0,0.0,0.0,0.0,0.0,0.0}, dEH[6], EH[6];
+     for(IncField *IF=&PW; IF; IF=IF->Next)
+      if (IF->RegionIndex==nr)
+       { RefFields(IF, X+3*np, dEH);
+         for(int i=0; i<6; i++) EHRef[i]+=dEH[i];
+       };
+     for(int i=0; i<6; i++)
+      EH[i]=FMatrix->GetEntry(np,i);
+     MaxErr=fmax(MaxErr, RelDiff(EH, EHRef));
+   };
+  Log("points per region: %i %i %i %i %i",NumInRegion[0],NumInRegion[1],
+       NumInRegion[2],NumInRegion[3],NumInRegion[4]);
+  printf("GetFields, chained fields in 4 regions: %.2e: %s\n",
+          MaxErr, MaxErr<TOLERANCE ? "PASSED" : "FAILED");
+  if (MaxErr>=TOLERANCE) NumFailed++;
+
+  delete[] EHBatch;
+  delete[] X;
+  delete FMatrix;
+  delete XMatrix;
+  delete G;
+
+  if (NumFailed>0) abort();
+  return 0;
+}
@@ -0,0 +1,108 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-MeshFormats.cc -- SCUFF-EM unit test checking that the same
+ *                          -- mesh stored as MSH 2.2 binary, MSH 4.1
+ *                          -- ASCII, and MSH 4.1 binary yields the same
+ *                          -- surface as the MSH 2.2 ASCII original
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+
+using namespace scuff;
+
+/***************************************************************/
+/* returns the number of discrepancies between S and SRef      */
+/***************************************************************/
+int CompareSurfaces(RWGSurface *S, RWGSurface *SRef)
+{
+  if (    S->NumVertices!=SRef->NumVertices
+       || S->NumPanels!=SRef->NumPanels
+       || S->NumEdges!=SRef->NumEdges
+       || S->NumExteriorEdges!=SRef->NumExteriorEdges
+     )
+   { printf(" counts differ: (%i,%i,%i,%i) vs (%i,%i,%i,%i)\n",
+             S->NumVertices, S->NumPanels, S->NumEdges, S->NumExteriorEdges,
+             SRef->NumVertices, SRef->NumPanels, SRef->NumEdges, SRef->NumExteriorEdges);
+     return 1;
+   };
+
+  int NumErrors=0;
+  for(int np=0; np<S->NumPanels; np++)
+   for(int i=0; i<3; i++)
+    if ( VecDistance(S->Vertices + 3*S->Panels[np]->VI[i],
+                     SRef->Vertices + 3*SRef->Panels[np]->VI[i]) > 1.0e-12 )
+     NumErrors++;
+
+  for(int ne=0; ne<S->NumEdges; ne++)
+   { RWGEdge *E=S->Edges[ne], *ERef=SRef->Edges[ne];
+     if (    E->iV1!=ERef->iV1 || E->iV2!=ERef->iV2
+          || E->iQP!=ERef->iQP || E->iQM!=ERef->iQM
+          || E->iPPanel!=ERef->iPPanel || E->iMPanel!=ERef->iMPanel
+        )
+      NumErrors++;
+   };
+
+  return NumErrors;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM mesh-format unit test running on %s",GetHostName());
+
+  RWGSurface *SRef = new RWGSurface("SSphere_255.msh");
+
+  const char *MeshFiles[]={ "SSphere_255_bin.msh",
+                            "SSphere_255_v41.msh",
+                            "SSphere_255_v41bin.msh" };
+  const char *Formats[]  ={ "MSH 2.2 binary",
+                            "MSH 4.1 ASCII",
+                            "MSH 4.1 binary" };
+  int NumFailed=0;
+  for(int n=0; n<3; n++)
+   { RWGSurface *S = new RWGSurface(MeshFiles[n]);
+     int NumErrors=CompareSurfaces(S, SRef);
+     printf("%s: %i discrepancies: %s\n",Formats[n],NumErrors,
+             NumErrors==0 ? "PASSED" : "FAILED");
+     if (NumErrors)
+      NumFailed++;
+     delete S;
+   };
+
+  delete SRef;
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
@@ -0,0 +1,123 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-MirrorSymmetry.cc -- SCUFF-EM unit test comparing the
+ *                             -- mirror-symmetry block solve against
+ *                             -- the full BEM solve
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+#include "libIncField.h"
+
+using namespace scuff;
+
+#define TOLERANCE 1.0e-8
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM mirror-symmetry unit test running on %s",GetHostName());
+
+  RWGGeometry *G = new RWGGeometry("SiSpheres_Mirror.scuffgeo");
+  if ( G->GetNumMirrorBlocks()!=8 )
+   { printf("geometry has %i mirror blocks (expected 8): FAILED\n",
+             G->GetNumMirrorBlocks());
+     abort();
+   };
+
+  HMatrix *M      = G->AllocateBEMMatrix();
+  HMatrix **MBlocks = G->AllocateMirrorBlocks();
+  HVector *KNFull = G->AllocateRHSVector();
+  HVector *KNSym  = G->AllocateRHSVector();
+
+  // a plane wave travelling off-axis, so that every irrep is excited
+  cdouble E0[3]  = { 1.0, cdouble(0.0,0.4), cdouble(0.0,-0.3) };
+  double nHat[3] = { 0.0, 0.6, 0.8 };
+  PlaneWave PW(E0, nHat);
+
+  double OmegaList[] = { 0.1, 1.0 };
+  int NumFailed=0;
+  for(int nOmega=0; nOmega<2; nOmega++)
+   {
+     cdouble Omega=OmegaList[nOmega];
+
+     G->AssembleBEMMatrix(Omega, M);
+     M->LUFactorize();
+     G->AssembleRHSVector(Omega, &PW, KNFull);
+     M->LUSolve(KNFull);
+
+     G->AssembleMirrorBlocks(Omega, MBlocks);
+     G->LUFactorizeMirrorBlocks(MBlocks);
+     G->AssembleRHSVector(Omega, &PW, KNSym);
+     G->LUSolveMirror(MBlocks, KNSym);
+
+     double MaxKN=0.0, MaxDelta=0.0;
+     for(int n=0; n<G->TotalBFs; n++)
+      { MaxKN    = fmax(MaxKN,    abs(KNFull->GetEntry(n)));
+        MaxDelta = fmax(MaxDelta, abs(KNFull->GetEntry(n)-KNSym->GetEntry(n)));
+      };
+
+     double RelError = MaxDelta / MaxKN;
+     printf("Omega=%g: max relative mirror-vs-full difference %.2e: %s\n",
+             real(Omega), RelError, RelError<TOLERANCE ? "PASSED" : "FAILED");
+     if (RelError>=TOLERANCE)
+      NumFailed++;
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- displacing one sphere breaks the symmetry; undoing the      */
+  /*- displacement restores it                                    */
+  /*--------------------------------------------------------------*/
+  bool Before=G->CheckMirrorSymmetry();
+  G->Surfaces[1]->Transform("DISP 0 0 0.1");
+  bool During=G->CheckMirrorSymmetry();
+  G->Surfaces[1]->UnTransform();
+  bool After=G->CheckMirrorSymmetry();
+  bool CheckOK = (Before && !During && After);
+  printf("symmetry re-check after transform (%i %i %i): %s\n",
+          Before, During, After, CheckOK ? "PASSED" : "FAILED");
+  if (!CheckOK)
+   NumFailed++;
+
+  for(int m=0; m<G->GetNumMirrorBlocks(); m++)
+   delete MBlocks[m];
+  free(MBlocks);
+  delete M;
+  delete KNFull;
+  delete KNSym;
+  delete G;
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
@@ -0,0 +1,211 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-NEQFlux.cc -- SCUFF-EM unit test comparing the scuff-neq
+ *                      -- flux traces computed from column-block solves
+ *                      -- against traces of the full inverse BEM matrix
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+#include "scuff-neq.h"
+
+using namespace scuff;
+
+#define TOLERANCE 1.0e-10
+
+// in GetFlux.cc
+void UndoSCUFFMatrixTransformation(HMatrix *M);
+
+/***************************************************************/
+/* the pre-column-block computation of the flux traces: stamp  */
+/* the T and U blocks left behind by GetFlux() into the full   */
+/* BEM matrix, invert it in place with LUInvert(), and evaluate */
+/* trace[ MDest * W^\dagger * SymGSource * W ] entry by entry. */
+/***************************************************************/
+void GetReferenceFlux(SNEQData *SNEQD, cdouble Omega, double *Reference)
+{
+  RWGGeometry *G = SNEQD->G;
+  int NS         = G->NumSurfaces;
+
+  HMatrix *W = new HMatrix(G->TotalBFs, G->TotalBFs, LHM_COMPLEX);
+  for(int nb=0, ns=0; ns<NS; ns++)
+   { int RowOffset=G->BFIndexOffset[ns];
+     W->InsertBlock(SNEQD->T[ns], RowOffset, RowOffset);
+     for(int nsp=ns+1; nsp<NS; nsp++, nb++)
+      { int ColOffset=G->BFIndexOffset[nsp];
+        W->InsertBlock(SNEQD->U[nb], RowOffset, ColOffset);
+        W->InsertBlockTranspose(SNEQD->U[nb], ColOffset, RowOffset);
+      };
+   };
+  UndoSCUFFMatrixTransformation(W);
+  W->LUFactorize();
+  W->LUInvert();
+
+  for(int nss=0; nss<NS; nss++)
+   for(int nsd=0; nsd<NS; nsd++)
+    {
+      int DimS=G->Surfaces[nss]->NumBFs, OffsetS=G->BFIndexOffset[nss];
+      int DimD=G->Surfaces[nsd]->NumBFs, OffsetD=G->BFIndexOffset[nsd];
+
+      HMatrix *WSD  = new HMatrix(DimS, DimD, LHM_COMPLEX);
+      HMatrix *SymG = new HMatrix(DimS, DimS, LHM_COMPLEX);
+      HMatrix *GW   = new HMatrix(DimS, DimD, LHM_COMPLEX);
+      HMatrix *WDGW = new HMatrix(DimD, DimD, LHM_COMPLEX);
+      W->ExtractBlock(OffsetS, OffsetD, WSD);
+      HMatrix *TS=SNEQD->TSelf[nss];
+      for(int nr=0; nr<DimS; nr++)
+       for(int nc=0; nc<DimS; nc++)
+        SymG->SetEntry(nr, nc, 0.5*(TS->GetEntry(nr,nc) + conj(TS->GetEntry(nc,nr))));
+      SymG->Multiply(WSD, GW);
+      WSD->Multiply(GW, WDGW, "--transA C");
+
+      HMatrix *MSIPFT[NUMSIPFT];
+      bool NeedMatrix[NUMSIPFT];
+      memset(MSIPFT, 0, NUMSIPFT*sizeof(HMatrix *));
+      if (nss==nsd)
+       { for(int QIndex=0; QIndex<MAXQUANTITIES; QIndex++)
+          { NeedMatrix[QIndex] = SNEQD->QuantityFlags & (1<<QIndex);
+            if (NeedMatrix[QIndex])
+             MSIPFT[QIndex] = new HMatrix(DimD, DimD, LHM_COMPLEX);
+          };
+         GetSIPFTMatrices(G, nss, 0, SNEQD->SIRadius, SNEQD->SINumPoints,
+                          Omega, NeedMatrix, MSIPFT);
+       };
+
+      for(int nq=0, QIndex=0; QIndex<MAXQUANTITIES; QIndex++)
+       {
+         int QFlag = 1<<QIndex;
+         if ( !(SNEQD->QuantityFlags & QFlag) )
+          continue;
+
+         double FMPTrace=0.0;
+         double Factor;
+         if ( QFlag==QFLAG_POWER && SNEQD->SymGPower )
+          { HMatrix *T=SNEQD->TSelf[nsd];
+            for(int nr=0; nr<DimD; nr++)
+             for(int nc=0; nc<DimD; nc++)
+              { cdouble SymGEntry = 0.5*(T->GetEntry(nr,nc) + conj(T->GetEntry(nc,nr)));
+                FMPTrace += real(SymGEntry * WDGW->GetEntry(nc,nr));
+              };
+            Factor=1.0/8.0;
+          }
+         else if (nss==nsd)
+          { for(int nr=0; nr<DimD; nr++)
+             for(int nc=0; nc<DimD; nc++)
+              FMPTrace += real( MSIPFT[QIndex]->GetEntry(nr,nc) * WDGW->GetEntry(nc,nr) );
+            Factor=1.0/4.0;
+          }
+         else
+          { SMatrix *OMatrixD = SNEQD->SArray[nsd][ 1 + QIndex ];
+            int *CIndices;
+            cdouble *Entries;
+            for(int ri=0; ri<DimD; ri++)
+             { int nnz=OMatrixD->GetRow(ri, &CIndices, (void **)&Entries);
+               for(int nci=0; nci<nnz; nci++)
+                FMPTrace += real( Entries[nci] * WDGW->GetEntry(CIndices[nci], ri) );
+             };
+            Factor=-1.0/16.0;
+          };
+         Reference[ GetIndex(SNEQD, 0, nss, nsd, nq++) ] = Factor*FMPTrace;
+       };
+
+      for(int QIndex=0; QIndex<MAXQUANTITIES; QIndex++)
+       if (MSIPFT[QIndex]) delete MSIPFT[QIndex];
+      delete WSD;
+      delete SymG;
+      delete GW;
+      delete WDGW;
+    };
+
+  delete W;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM NEQ flux unit test running on %s",GetHostName());
+
+  int QuantityFlags = QFLAG_POWER | QFLAG_XFORCE | QFLAG_ZFORCE;
+  SNEQData *SNEQD=CreateSNEQData(const_cast<char *>("SiSpheres_255.scuffgeo"), 0,
+                                 QuantityFlags, const_cast<char *>("unit-test-NEQFlux"));
+  SNEQD->UseExistingData = false;
+  SNEQD->SIRadius        = 100.0;
+  SNEQD->SINumPoints     = 31;
+  SNEQD->PlotFlux        = 0;
+
+  int NS=SNEQD->G->NumSurfaces, NQ=SNEQD->NQ;
+  int FDim = NS*SNEQD->NTNSNQ;
+  double *Flux      = new double[FDim];
+  double *Reference = new double[FDim];
+
+  double OmegaList[] = { 0.1, 1.0 };
+  int NumFailed=0;
+  for(int SymGPower=0; SymGPower<2; SymGPower++)
+   for(int nOmega=0; nOmega<2; nOmega++)
+    {
+      cdouble Omega=OmegaList[nOmega];
+      SNEQD->SymGPower=SymGPower;
+
+      GetFlux(SNEQD, Omega, Flux);
+      GetReferenceFlux(SNEQD, Omega, Reference);
+
+      // the quantities differ widely in magnitude, so each one is
+      // normalized to its own largest (source,dest) entry
+      double RelError=0.0;
+      for(int nq=0; nq<NQ; nq++)
+       { double MaxRef=0.0, MaxDelta=0.0;
+         for(int nss=0; nss<NS; nss++)
+          for(int nsd=0; nsd<NS; nsd++)
+           { int Index=GetIndex(SNEQD, 0, nss, nsd, nq);
+             Log(" Omega=%g SymGPower=%i %i%i nq=%i: column-block=%+.12e reference=%+.12e",
+                   real(Omega),SymGPower,nss+1,nsd+1,nq,Flux[Index],Reference[Index]);
+             MaxRef   = fmax(MaxRef, fabs(Reference[Index]));
+             MaxDelta = fmax(MaxDelta, fabs(Flux[Index]-Reference[Index]));
+           };
+         RelError = fmax(RelError, MaxDelta/MaxRef);
+       };
+
+      printf("Omega=%g%s: column-block vs. LUInvert traces: %.2e: %s\n",
+              real(Omega), SymGPower ? " (SymGPower)" : "",
+              RelError, RelError<TOLERANCE ? "PASSED" : "FAILED");
+      if (RelError>=TOLERANCE)
+       NumFailed++;
+    };
+
+  delete[] Flux;
+  delete[] Reference;
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
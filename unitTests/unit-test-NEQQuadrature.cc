@@ -0,0 +1,229 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-NEQQuadrature.cc -- SCUFF-EM unit test comparing the
+ *                            -- batched scuff-neq frequency quadratures,
+ *                            -- with and without frequency workers,
+ *                            -- against point-by-point evaluation
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+#include "scuff-neq.h"
+
+using namespace scuff;
+
+/***************************************************************/
+/* the batched quadratures in this process make exactly the    */
+/* same GetFlux() calls as the reference, so they must agree   */
+/* to roundoff; worker processes use a different thread count  */
+/* and may differ in the order of OpenMP reductions            */
+/***************************************************************/
+#define SERIAL_TOLERANCE 1.0e-14
+#define WORKER_TOLERANCE 1.0e-10
+
+#define NUMWORKERS 2
+#define TIMEOUT    3600
+
+#define SGJCLOG "scuff-neq.SGJClog"
+
+// in Quadrature.cc
+void PutInThetaFactors(SNEQData *SNEQD, double Omega,
+                       double *TSurfaces, double TEnvironment,
+                       double *FluxVector);
+
+/***************************************************************/
+/* the pre-batching TrapSimp loop, evaluating the integrand    */
+/* point by point; the u=1 (Omega=infinity) endpoint of the    */
+/* transformed semi-infinite range contributes zero.           */
+/***************************************************************/
+void GetReferenceTrapSimp(SNEQData *SNEQD, double OmegaMin, double OmegaMax,
+                          double *TSurfaces, double TEnvironment,
+                          int NumIntervals, double *I, double *E)
+{
+  bool Infinite = (OmegaMax==-1.0);
+  double uMin = Infinite ? 0.0 : OmegaMin;
+  double uMax = Infinite ? 1.0 : OmegaMax;
+
+  int fdim = SNEQD->NTNSNQ * SNEQD->G->NumSurfaces;
+  double *fLeft  = new double[fdim];
+  double *fMid   = new double[fdim];
+  double *fRight = new double[fdim];
+
+  double Delta = (uMax-uMin)/NumIntervals;
+  memset(I, 0, fdim*sizeof(double));
+  memset(E, 0, fdim*sizeof(double));
+  for(int nPoint=0; nPoint<=2*NumIntervals; nPoint++)
+   {
+     double u = uMin + 0.5*nPoint*Delta;
+     double *f = (nPoint==0) ? fLeft : (nPoint%2) ? fMid : fRight;
+     if ( Infinite && nPoint==2*NumIntervals )
+      memset(f, 0, fdim*sizeof(double));
+     else
+      { double Omega = Infinite ? OmegaMin + u/(1.0-u) : u;
+        double Jacobian = Infinite ? 1.0/((1.0-u)*(1.0-u)) : 1.0;
+        GetFlux(SNEQD, Omega, f);
+        for(int nf=0; nf<fdim; nf++) f[nf]*=Jacobian;
+        PutInThetaFactors(SNEQD, Omega, TSurfaces, TEnvironment, f);
+      };
+
+     if (nPoint==0 || nPoint%2) continue;
+
+     for(int nf=0; nf<fdim; nf++)
+      { double ISimp = (fLeft[nf] + 4.0*fMid[nf] + fRight[nf])*Delta/6.0;
+        double ITrap = (fLeft[nf] + 2.0*fMid[nf] + fRight[nf])*Delta/4.0;
+        I[nf] += ISimp;
+        E[nf] += fabs(ISimp - ITrap);
+      };
+     memcpy(fLeft, fRight, fdim*sizeof(double));
+   };
+
+  delete[] fLeft;
+  delete[] fMid;
+  delete[] fRight;
+}
+
+/***************************************************************/
+/* max |V-VRef| / max |VRef|; any non-finite entry fails       */
+/***************************************************************/
+double VectorMismatch(double *V, double *VRef, int N)
+{
+  double MaxDelta=0.0, MaxRef=0.0;
+  for(int n=0; n<N; n++)
+   { if ( !isfinite(V[n]) ) return HUGE_VAL;
+     MaxDelta = fmax(MaxDelta, fabs(V[n]-VRef[n]));
+     MaxRef   = fmax(MaxRef, fabs(VRef[n]));
+   };
+  return MaxRef==0.0 ? MaxDelta : MaxDelta/MaxRef;
+}
+
+int Check(const char *What, double *V, double *VRef, int N, double Tolerance)
+{
+  double Mismatch=VectorMismatch(V, VRef, N);
+  bool OK = (Mismatch < Tolerance);
+  printf("%-50s: %.2e: %s\n",What,Mismatch,OK ? "PASSED" : "FAILED");
+  return OK ? 0 : 1;
+}
+
+long FileSize(const char *FileName)
+{
+  struct stat Stat;
+  return stat(FileName, &Stat) ? 0 : (long)Stat.st_size;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM NEQ quadrature unit test running on %s",GetHostName());
+
+  alarm(TIMEOUT);
+  ReserveFrequencyWorkers(NUMWORKERS);
+
+  SNEQData *SNEQD=CreateSNEQData(const_cast<char *>("SiSphere_255.scuffgeo"), 0,
+                                 QFLAG_POWER, const_cast<char *>("unit-test-NEQQuadrature"));
+  SNEQD->UseExistingData = false;
+  SNEQD->SIRadius        = 100.0;
+  SNEQD->SINumPoints     = 31;
+  SNEQD->PlotFlux        = 0;
+  SNEQD->AbsTol          = 1.0e-12;
+  SNEQD->RelTol          = 1.0e-1;
+
+  int FDim = SNEQD->NTNSNQ * SNEQD->G->NumSurfaces;
+  void *Workers=CreateFrequencyWorkers(OmegaWorkerFunction, (void *)SNEQD,
+                                       2, FDim, NUMWORKERS);
+
+  double TSurfaces[1] = { 300.0 }, TEnvironment=0.0;
+  double *IRef = new double[FDim], *ERef = new double[FDim];
+  double *I    = new double[FDim], *E    = new double[FDim];
+
+  int NumFailed=0;
+
+  /*--------------------------------------------------------------*/
+  /*- TrapSimp over a finite and a semi-infinite range            */
+  /*--------------------------------------------------------------*/
+  double OmegaMaxList[] = { 1.0, -1.0 };
+  for(int nr=0; nr<2; nr++)
+   {
+     double OmegaMin=0.1, OmegaMax=OmegaMaxList[nr];
+     const char *Range = OmegaMax==-1.0 ? "(0.1,infinity)" : "(0.1,1)";
+     char What[100];
+
+     SNEQD->FrequencyWorkers=0;
+     GetReferenceTrapSimp(SNEQD, OmegaMin, OmegaMax, TSurfaces, TEnvironment, 2, IRef, ERef);
+
+     GetOmegaIntegral_TrapSimp(SNEQD, OmegaMin, OmegaMax, TSurfaces, TEnvironment, 2, I, E);
+     snprintf(What, 100, "TrapSimp %s batched vs. pointwise, I", Range);
+     NumFailed+=Check(What, I, IRef, FDim, SERIAL_TOLERANCE);
+     snprintf(What, 100, "TrapSimp %s batched vs. pointwise, E", Range);
+     NumFailed+=Check(What, E, ERef, FDim, SERIAL_TOLERANCE);
+
+     SNEQD->FrequencyWorkers=Workers;
+     GetOmegaIntegral_TrapSimp(SNEQD, OmegaMin, OmegaMax, TSurfaces, TEnvironment, 2, I, E);
+     snprintf(What, 100, "TrapSimp %s workers vs. pointwise, I", Range);
+     NumFailed+=Check(What, I, IRef, FDim, WORKER_TOLERANCE);
+     snprintf(What, 100, "TrapSimp %s workers vs. pointwise, E", Range);
+     NumFailed+=Check(What, E, ERef, FDim, WORKER_TOLERANCE);
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- adaptive quadrature: pcubature_v with workers vs.           */
+  /*- pcubature_log in this process; both must log evaluations    */
+  /*--------------------------------------------------------------*/
+  SNEQD->FrequencyWorkers=0;
+  long LogSize=FileSize(SGJCLOG);
+  GetOmegaIntegral_Adaptive(SNEQD, 0.5, 1.0, TSurfaces, TEnvironment, IRef, ERef);
+  bool Logged = FileSize(SGJCLOG) > LogSize;
+  printf("%-50s: %s\n","adaptive, serial: evaluations logged",Logged ? "PASSED" : "FAILED");
+  if (!Logged) NumFailed++;
+
+  SNEQD->FrequencyWorkers=Workers;
+  LogSize=FileSize(SGJCLOG);
+  GetOmegaIntegral_Adaptive(SNEQD, 0.5, 1.0, TSurfaces, TEnvironment, I, E);
+  Logged = FileSize(SGJCLOG) > LogSize;
+  printf("%-50s: %s\n","adaptive, workers: evaluations logged",Logged ? "PASSED" : "FAILED");
+  if (!Logged) NumFailed++;
+  NumFailed+=Check("adaptive (0.5,1) workers vs. serial, I", I, IRef, FDim, WORKER_TOLERANCE);
+
+  DestroyFrequencyWorkers(Workers);
+  SNEQD->FrequencyWorkers=0;
+
+  delete[] IRef;
+  delete[] ERef;
+  delete[] I;
+  delete[] E;
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
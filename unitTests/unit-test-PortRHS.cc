@@ -0,0 +1,161 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-PortRHS.cc -- SCUFF-EM unit test comparing the scuff-rf
+ *                      -- multi-port RHS matrix, multi-column solve, and
+ *                      -- port-voltage functionals against the original
+ *                      -- port-by-port computation
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+#include "RWGPorts.h"
+
+using namespace scuff;
+
+#define FREQ2OMEGA (2.0*M_PI/300.0)
+
+// the batched RHS and the port-voltage functionals repeat the
+// per-port arithmetic, so they agree with it to roundoff; the
+// original GetPortVoltages() evaluates the iwA term by adaptive
+// cubature to relative accuracy 1e-4, so it agrees only to roughly
+// that accuracy
+#define TOLERANCE     1.0e-10
+#define IWATOLERANCE  1.0e-3
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM multi-port RHS unit test running on %s",GetHostName());
+
+  // two well-separated pairs of tabs, each pair driven by one port
+  RWGGeometry *G = new RWGGeometry("TwoTabPairs.scuffgeo");
+  int NumPorts;
+  RWGPort **Ports=ParsePortFile(G, "TwoTabPairs.ports", &NumPorts);
+  if (NumPorts!=2)
+   ErrExit("expected 2 ports in TwoTabPairs.ports (got %i)",NumPorts);
+
+  HMatrix *M  = G->AllocateBEMMatrix();
+  HVector *KN = G->AllocateRHSVector();
+  cdouble *PortCurrents  = new cdouble[NumPorts];
+  cdouble *PortVoltages  = new cdouble[NumPorts];
+  cdouble *PortVoltages0 = new cdouble[NumPorts];
+  PortVoltageFunctionals *PVF=0;
+  HMatrix *KNMatrix=0, *VMatrix=0;
+
+  double FreqList[2] = { 0.01, 0.1 }; // GHz
+  int NumFailed=0;
+  for(int nf=0; nf<2; nf++)
+   {
+     cdouble Omega = FREQ2OMEGA * FreqList[nf];
+
+     G->AssembleBEMMatrix(Omega, M);
+     M->LUFactorize();
+
+     /*--------------------------------------------------------------*/
+     /*- batched path, as in scuff-rf --Zparameters -----------------*/
+     /*--------------------------------------------------------------*/
+     PVF=GetPortVoltageFunctionals(G, Ports, NumPorts, Omega, PVF);
+     KNMatrix=GetPortRHSMatrix(G, Ports, NumPorts, Omega, KNMatrix);
+
+     double MaxRHS=0.0, MaxRHSDelta=0.0;
+     for(int np=0; np<NumPorts; np++)
+      { memset(PortCurrents, 0, NumPorts*sizeof(cdouble));
+        PortCurrents[np]=1.0;
+        KN->Zero();
+        AddPortContributionsToRHS(G, Ports, NumPorts, PortCurrents, Omega, KN);
+        for(int nbf=0; nbf<G->TotalBFs; nbf++)
+         { MaxRHS      = fmax(MaxRHS, abs(KN->GetEntry(nbf)));
+           MaxRHSDelta = fmax(MaxRHSDelta, abs(KN->GetEntry(nbf)-KNMatrix->GetEntry(nbf,np)));
+         };
+      };
+
+     M->LUSolve(KNMatrix);
+     VMatrix=GetPortVoltages(PVF, KNMatrix, VMatrix);
+
+     /*--------------------------------------------------------------*/
+     /*- per-port path: one RHS, one solve, and one voltage          */
+     /*- evaluation for each port                                    */
+     /*--------------------------------------------------------------*/
+     double MaxV=0.0, MaxVDelta=0.0, MaxV0Delta=0.0;
+     for(int np=0; np<NumPorts; np++)
+      { memset(PortCurrents, 0, NumPorts*sizeof(cdouble));
+        PortCurrents[np]=1.0;
+        KN->Zero();
+        AddPortContributionsToRHS(G, Ports, NumPorts, PortCurrents, Omega, KN);
+        M->LUSolve(KN);
+        GetPortVoltages(PVF, KN, PortCurrents, PortVoltages);
+        GetPortVoltages(G, KN, Ports, NumPorts, PortCurrents, Omega, PortVoltages0);
+        for(int npp=0; npp<NumPorts; npp++)
+         { cdouble VBatch=VMatrix->GetEntry(npp, np);
+           Log(" f=%g V(%i,%i): batched=%s functional=%s original=%s",
+                 FreqList[nf],npp,np,z2s(VBatch),z2s(PortVoltages[npp]),
+                 z2s(PortVoltages0[npp]));
+           MaxV       = fmax(MaxV, abs(PortVoltages0[npp]));
+           MaxVDelta  = fmax(MaxVDelta, abs(VBatch-PortVoltages[npp]));
+           MaxV0Delta = fmax(MaxV0Delta, abs(VBatch-PortVoltages0[npp]));
+         };
+      };
+
+     double RelError = MaxRHSDelta / MaxRHS;
+     printf("f=%g GHz: RHS matrix vs. per-port RHS: %.2e: %s\n",
+             FreqList[nf], RelError, RelError<TOLERANCE ? "PASSED" : "FAILED");
+     if (RelError>=TOLERANCE)
+      NumFailed++;
+
+     RelError = MaxVDelta / MaxV;
+     printf("f=%g GHz: batched vs. per-port voltages: %.2e: %s\n",
+             FreqList[nf], RelError, RelError<TOLERANCE ? "PASSED" : "FAILED");
+     if (RelError>=TOLERANCE)
+      NumFailed++;
+
+     RelError = MaxV0Delta / MaxV;
+     printf("f=%g GHz: batched vs. original port voltages: %.2e: %s\n",
+             FreqList[nf], RelError, RelError<IWATOLERANCE ? "PASSED" : "FAILED");
+     if (RelError>=IWATOLERANCE)
+      NumFailed++;
+   };
+
+  DestroyPortVoltageFunctionals(PVF);
+  delete KNMatrix;
+  delete VMatrix;
+  delete[] PortCurrents;
+  delete[] PortVoltages;
+  delete[] PortVoltages0;
+  delete KN;
+  delete M;
+  delete G;
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
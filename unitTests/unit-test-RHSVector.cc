@@ -0,0 +1,319 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-RHSVector.cc -- SCUFF-EM unit test comparing the RHS vector
+ *                        -- assembled from panel moments of the incident
+ *                        -- fields against the original edge-by-edge
+ *                        -- integration of the fields against each RWG
+ *                        -- basis function
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include <libTriInt.h>
+#include "libscuff.h"
+#include "libIncField.h"
+
+using namespace scuff;
+
+#define II cdouble(0.0,1.0)
+
+// both methods use the same 20th-order triangle cubature, so they
+// differ only by the rearrangement of the sums
+#define TOLERANCE 1.0e-10
+
+/***************************************************************/
+/* reference implementation: the edge-by-edge inner products  */
+/* of the original AssembleRHSVector()                         */
+/***************************************************************/
+typedef struct InnerProductIntegrandData 
+ { 
+   double *Q;
+   double PreFac;
+
+   IncField **PositiveIFs;
+   int NPositiveIFs;
+   IncField **NegativeIFs;
+   int NNegativeIFs;
+
+   int NeedHProd;
+
+ } InnerProductIntegrandData;
+
+static void InnerProductIntegrand(double *X, void *opIPID, double *F)
+{ 
+  InnerProductIntegrandData *IPID=(InnerProductIntegrandData *)opIPID;
+
+  /* get value of RWG basis function at X */
+  double fRWG[3];
+  VecSub(X,IPID->Q,fRWG);
+  VecScale(fRWG,IPID->PreFac);
+
+  /* get incident E and H fields at X */
+  cdouble dEH[6], EH[6];
+  memset(EH, 0, 6*sizeof(cdouble));
+  int n, nif;
+  for(nif=0; nif<IPID->NPositiveIFs; nif++)
+   { IPID->PositiveIFs[nif]->GetFields(X,dEH);
+     for(n=0; n<6; n++) 
+      EH[n]+=dEH[n];
+   };
+  for(nif=0; nif<IPID->NNegativeIFs; nif++)
+   { IPID->NegativeIFs[nif]->GetFields(X,dEH);
+     for(n=0; n<6; n++) 
+      EH[n]-=dEH[n];
+   };
+  
+  /* compute dot products */
+  cdouble *zF = (cdouble *)F;
+  zF[0] = fRWG[0]*EH[0] + fRWG[1]*EH[1] + fRWG[2]*EH[2];
+  if (IPID->NeedHProd)
+   zF[1] = fRWG[0]*EH[3] + fRWG[1]*EH[4] + fRWG[2]*EH[5];
+} 
+
+void GetInnerProducts(RWGSurface *S, int ne, 
+                      IncField **PositiveIFs, int NPositiveIFs,
+                      IncField **NegativeIFs, int NNegativeIFs,
+                      cdouble *pEProd, cdouble *pHProd)
+{ 
+  /* get edge vertices */
+  RWGEdge *E   = S->Edges[ne];
+  double *QP   = S->Vertices + 3*(E->iQP);
+  double *V1   = S->Vertices + 3*(E->iV1);
+  double *V2   = S->Vertices + 3*(E->iV2);
+  double PArea = S->Panels[E->iPPanel]->Area;
+  double *QM;
+  double MArea=0.0;
+  if ( E->iQM == -1 )
+   QM = 0;
+  else
+   { QM = S->Vertices + 3*(E->iQM);
+     MArea = S->Panels[E->iMPanel]->Area;
+   };
+
+  /* set up data structure passed to InnerProductIntegrand */
+  InnerProductIntegrandData MyIPID, *IPID=&MyIPID;
+  IPID->PositiveIFs  = PositiveIFs;
+  IPID->NPositiveIFs = NPositiveIFs;
+  IPID->NegativeIFs  = NegativeIFs;
+  IPID->NNegativeIFs = NNegativeIFs;
+  IPID->NeedHProd    = (pHProd==NULL ? 0 : 1);
+  
+  int nFun = (pHProd==NULL ? 2 : 4);
+  double I[4], IP[4], IM[4];
+
+  /* integrate over positive panel */
+  IPID->Q=QP;
+  IPID->PreFac=E->Length / (2.0*PArea);
+  TriIntFixed(InnerProductIntegrand, nFun, (void *)IPID, QP, V1, V2, 20, IP);
+
+  /* integrate over negative panel if present */
+  if (QM)
+   { IPID->Q=QM;
+     IPID->PreFac=E->Length / (2.0*MArea);
+     TriIntFixed(InnerProductIntegrand, nFun, (void *)IPID, V1, V2, QM, 20, IM);
+   }
+  else
+   memset(IM, 0, 4*sizeof(double));
+
+  /* total integral is difference between pos and neg pan integrals */
+  for(int nf=0; nf<nFun; nf++)
+   I[nf] = IP[nf] - IM[nf];
+  
+  *pEProd = cdouble(I[0], I[1]);
+  if (pHProd)
+   *pHProd = cdouble(I[2], I[3]);
+}
+
+/***************************************************************/
+/* the reference RHS vector; assumes AssembleRHSVector() has   */
+/* already been called on IFList to set the source regions and */
+/* material properties of the IncFields                        */
+/***************************************************************/
+void RefRHSVector(RWGGeometry *G, IncField *IFList, HVector *RHS)
+{
+  int NIF=0;
+  for(IncField *IF=IFList; IF; IF=IF->Next) NIF++;
+  IncField **PositiveIFs = new IncField *[NIF];
+  IncField **NegativeIFs = new IncField *[NIF];
+
+  RHS->Zero();
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   { 
+     RWGSurface *S=G->Surfaces[ns];
+     int Offset=G->BFIndexOffset[ns];
+
+     int NPositiveIFs=0, NNegativeIFs=0;
+     for(IncField *IF=IFList; IF; IF=IF->Next)
+      { if (S->RegionIndices[0]==IF->RegionIndex)
+         NegativeIFs[NNegativeIFs++] = IF;
+        else if (S->RegionIndices[1]==IF->RegionIndex)
+         PositiveIFs[NPositiveIFs++] = IF;
+      };
+     if ( NPositiveIFs==0 && NNegativeIFs==0 )
+      continue;
+
+     for(int ne=0; ne<S->NumEdges; ne++)
+      { cdouble EProd, HProd;
+        GetInnerProducts(S, ne, PositiveIFs, NPositiveIFs,
+                         NegativeIFs, NNegativeIFs,
+                         &EProd, S->IsPEC ? 0 : &HProd);
+        if (S->IsPEC)
+         RHS->SetEntry(Offset + ne, EProd / ZVAC);
+        else
+         { RHS->SetEntry(Offset + 2*ne+0, EProd / ZVAC);
+           RHS->SetEntry(Offset + 2*ne+1, HProd);
+         };
+      };
+   };
+
+  delete[] PositiveIFs;
+  delete[] NegativeIFs;
+}
+
+/***************************************************************/
+/* assemble the RHS both ways for the chain of fields starting */
+/* at IF and return the relative difference                    */
+/***************************************************************/
+double CompareRHS(RWGGeometry *G, cdouble Omega, IncField *IF,
+                  HVector *RHS, HVector *RHSRef)
+{
+  G->AssembleRHSVector(Omega, IF, RHS);
+  RefRHSVector(G, IF, RHSRef);
+
+  double Norm=0.0, Delta=0.0;
+  for(int n=0; n<RHS->N; n++)
+   { Norm  += norm(RHSRef->GetEntry(n));
+     Delta += norm(RHS->GetEntry(n) - RHSRef->GetEntry(n));
+   };
+  return Norm==0.0 ? 1.0 : sqrt(Delta/Norm);
+}
+
+/***************************************************************/
+/* run one IncField at a time, then the whole chain            */
+/***************************************************************/
+int RunTests(RWGGeometry *G, const char *GeoName, cdouble Omega,
+             IncField **IFs, const char **Names, int NIF)
+{
+  HVector *RHS    = G->AllocateRHSVector();
+  HVector *RHSRef = G->AllocateRHSVector();
+
+  int NumFailed=0;
+  for(int n=0; n<=NIF; n++)
+   { 
+     // n<NIF: field #n on its own; n==NIF: all fields chained
+     IncField *IF;
+     if (n<NIF)
+      { IF=IFs[n]; 
+        IF->Next=0;
+      }
+     else
+      { IF=IFs[0];
+        for(int m=0; m<NIF-1; m++)
+         IFs[m]->Next=IFs[m+1];
+        IFs[NIF-1]->Next=0;
+      };
+
+     double Err=CompareRHS(G, Omega, IF, RHS, RHSRef);
+     printf("%s, %-22s (region %i): %.2e: %s\n",GeoName,
+             n<NIF ? Names[n] : "all fields",
+             n<NIF ? IF->RegionIndex : -1, 
+             Err, Err<TOLERANCE ? "PASSED" : "FAILED");
+     if (Err>=TOLERANCE) NumFailed++;
+   };
+
+  delete RHS;
+  delete RHSRef;
+  return NumFailed;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM RHS vector unit test running on %s",GetHostName());
+
+  cdouble E0[3]   = { 1.0, 0.5*II, 0.0 };
+  double nHat[3]  = { 0.0, 0.6, 0.8 };
+  double KProp[3] = { 0.0, 0.0, 1.0 };
+  cdouble EGB[3]  = { 1.0, II, 0.0 };
+  cdouble P[3]    = { 0.3, 1.0, 0.2*II };
+
+  int NumFailed=0;
+
+  /***************************************************************/
+  /* dielectric spheres: NestedSpheres.scuffgeo has a plane wave */
+  /* and a point source in the exterior region, a point source   */
+  /* and a gaussian beam in the shells of the outer and middle   */
+  /* spheres, and a point source in the inner sphere, so every   */
+  /* surface sees fields from its exterior (negative) side, its  */
+  /* interior (positive) side, or both                           */
+  /***************************************************************/
+  {
+    RWGGeometry *G = new RWGGeometry("NestedSpheres.scuffgeo");
+
+    double XExt[3]   = { 0.5, 0.3, 1.7 };
+    double XOuter[3] = { 0.0, 0.0, 0.9 };
+    double XInner[3] = { 0.05, 0.0, 0.1 };
+    double XGB[3]    = { 0.0, 0.0, 0.0 };
+
+    PlaneWave PW(E0, nHat);
+    PointSource PSExt(XExt, P);
+    PointSource PSOuter(XOuter, P, LIF_MAGNETIC_DIPOLE);
+    GaussianBeam GB(XGB, KProp, EGB, 0.5, "MiddleSphere");
+    PointSource PSInner(XInner, P);
+
+    IncField *IFs[5]={ &PW, &PSExt, &PSOuter, &GB, &PSInner };
+    const char *Names[5]={ "plane wave", "exterior dipole",
+                           "outer-shell dipole", "middle-shell beam",
+                           "inner dipole" };
+    NumFailed+=RunTests(G, "nested spheres", 1.0, IFs, Names, 5);
+    delete G;
+  }
+
+  /***************************************************************/
+  /* PEC sphere (E-field inner products only)                    */
+  /***************************************************************/
+  {
+    RWGGeometry *G = new RWGGeometry("PECSphere_255.scuffgeo");
+
+    double XExt[3] = { 0.5, 0.3, 1.7 };
+    double XGB[3]  = { 0.0, 0.0, 0.0 };
+    PlaneWave PW(E0, nHat);
+    PointSource PSExt(XExt, P);
+    GaussianBeam GB(XGB, KProp, EGB, 2.0);
+
+    IncField *IFs[3]={ &PW, &PSExt, &GB };
+    const char *Names[3]={ "plane wave", "exterior dipole", "gaussian beam" };
+    NumFailed+=RunTests(G, "PEC sphere", 1.0, IFs, Names, 3);
+    delete G;
+  }
+
+  if (NumFailed>0) abort();
+  return 0;
+}
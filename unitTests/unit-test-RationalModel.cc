@@ -0,0 +1,128 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-RationalModel.cc -- SCUFF-EM unit test checking the
+ *                            -- scuff-rf reduced-order frequency model
+ *                            -- on a known rational Z-matrix
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+#include "RWGPorts.h"
+
+using namespace scuff;
+
+#define NUMFREQS   201
+#define MAXSAMPLES 40
+#define ROMTOL     1.0e-6
+#define TOLERANCE  1.0e-5
+
+#define II cdouble(0.0,1.0)
+
+/***************************************************************/
+/* a reciprocal two-port with two resonances in 1--10 GHz:     */
+/* each entry is a sum of simple poles plus a constant, so the */
+/* exact Z-matrix is a rational function of type (2,2)         */
+/***************************************************************/
+void KnownZSampler(void *UserData, double Freq, HMatrix *ZMatrix)
+{
+  cdouble P1 = cdouble(3.0, 0.2), P2 = cdouble(6.0,-0.5);
+  cdouble R1 = 1.0/(Freq-P1), R2 = 1.0/(Freq-P2);
+
+  ZMatrix->SetEntry(0, 0, 50.0 + 10.0*R1 + 2.0*II*R2);
+  ZMatrix->SetEntry(0, 1,         5.0*R1 - 3.0*R2);
+  ZMatrix->SetEntry(1, 0,         5.0*R1 - 3.0*R2);
+  ZMatrix->SetEntry(1, 1, 25.0 +  1.0*R1 + 8.0*R2);
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM rational model unit test running on %s",GetHostName());
+
+  HVector *FreqList = new HVector(NUMFREQS);
+  for(int nf=0; nf<NUMFREQS; nf++)
+   FreqList->SetEntry(nf, 1.0 + 9.0*nf/(NUMFREQS-1.0));
+
+  HMatrix *ZMatrices[NUMFREQS];
+  for(int nf=0; nf<NUMFREQS; nf++)
+   ZMatrices[nf] = new HMatrix(2, 2, LHM_COMPLEX);
+  double ErrEst[NUMFREQS];
+
+  int NS=GetZParametersROM(KnownZSampler, 0, 2, FreqList, ROMTOL,
+                           MAXSAMPLES, ZMatrices, ErrEst);
+
+  /*--------------------------------------------------------------*/
+  /*- compare the model with the exact Z-matrix at every point   -*/
+  /*- of the sweep                                               -*/
+  /*--------------------------------------------------------------*/
+  HMatrix *ZExact = new HMatrix(2, 2, LHM_COMPLEX);
+  double MaxZ=0.0, MaxDelta=0.0, MaxErrEst=0.0;
+  for(int nf=0; nf<NUMFREQS; nf++)
+   { double Freq=FreqList->GetEntryD(nf);
+     KnownZSampler(0, Freq, ZExact);
+     for(int i=0; i<2; i++)
+      for(int j=0; j<2; j++)
+       { MaxZ     = fmax(MaxZ, abs(ZExact->GetEntry(i,j)));
+         MaxDelta = fmax(MaxDelta, abs(ZExact->GetEntry(i,j)-ZMatrices[nf]->GetEntry(i,j)));
+       };
+     MaxErrEst = fmax(MaxErrEst, ErrEst[nf]);
+   };
+
+  int NumFailed=0;
+  double RelError = MaxDelta / MaxZ;
+  printf("ROM vs. exact Z over the sweep (%i samples): %.2e: %s\n",
+          NS, RelError, RelError<TOLERANCE ? "PASSED" : "FAILED");
+  if (RelError>=TOLERANCE)
+   NumFailed++;
+
+  // a type-(2,2) rational function needs only a handful of samples
+  bool FewSamples = (NS < NUMFREQS/10);
+  printf("number of exact samples: %i: %s\n",
+          NS, FewSamples ? "PASSED" : "FAILED");
+  if (!FewSamples)
+   NumFailed++;
+
+  printf("largest error estimate: %.2e: %s\n",
+          MaxErrEst, MaxErrEst<ROMTOL ? "PASSED" : "FAILED");
+  if (MaxErrEst>=ROMTOL)
+   NumFailed++;
+
+  delete ZExact;
+  for(int nf=0; nf<NUMFREQS; nf++)
+   delete ZMatrices[nf];
+  delete FreqList;
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
@@ -0,0 +1,156 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-RegionIndices.cc -- SCUFF-EM unit test comparing the
+ *                            -- batched region classification of
+ *                            -- GetRegionIndices() against per-point
+ *                            -- calls to GetRegionIndex()
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+
+using namespace scuff;
+
+// distance by which the near-surface points are displaced from
+// the panel centroids along the panel normals
+#define NEARDIST 1.0e-6
+
+/***************************************************************/
+/* add to XMatrix, beginning at row nr, the points at distance */
+/* +-NEARDIST from the centroid of every panel in G, followed  */
+/* by NumRandom random points in the box [XMin, XMax]; returns */
+/* the number of rows written.                                 */
+/***************************************************************/
+int AddPoints(RWGGeometry *G, HMatrix *XMatrix, int nr,
+              int NumRandom, double XMin[3], double XMax[3])
+{
+  int nr0=nr;
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   for(int np=0; np<G->Surfaces[ns]->NumPanels; np++)
+    { RWGPanel *P=G->Surfaces[ns]->Panels[np];
+      for(int Sign=-1; Sign<=1; Sign+=2, nr++)
+       for(int i=0; i<3; i++)
+        XMatrix->SetEntry(nr, i, P->Centroid[i] + Sign*NEARDIST*P->ZHat[i]);
+    };
+
+  for(int n=0; n<NumRandom; n++, nr++)
+   for(int i=0; i<3; i++)
+    XMatrix->SetEntry(nr, i, XMin[i] + (XMax[i]-XMin[i])*drand48());
+
+  return nr-nr0;
+}
+
+/***************************************************************/
+/* classify all points in XMatrix both ways and return the     */
+/* number of points on which the two methods disagree          */
+/***************************************************************/
+int CountMismatches(RWGGeometry *G, HMatrix *XMatrix, const char *Label)
+{
+  int NX=XMatrix->NR;
+  int *Regions = new int[NX];
+  G->GetRegionIndices(XMatrix, Regions);
+
+  int NumMismatches=0;
+  for(int nx=0; nx<NX; nx++)
+   { double X[3];
+     X[0]=XMatrix->GetEntryD(nx,0);
+     X[1]=XMatrix->GetEntryD(nx,1);
+     X[2]=XMatrix->GetEntryD(nx,2);
+     int Region0=G->GetRegionIndex(X);
+     if (Regions[nx]!=Region0)
+      { if (NumMismatches<10)
+         Log("%s: point (%+.8e,%+.8e,%+.8e): region %i (batched) vs. %i",
+              Label,X[0],X[1],X[2],Regions[nx],Region0);
+        NumMismatches++;
+      };
+   };
+  delete[] Regions;
+
+  printf("%s: %i/%i mismatches: %s\n",Label,NumMismatches,NX,
+          NumMismatches==0 ? "PASSED" : "FAILED");
+  return NumMismatches;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM region-index unit test running on %s",GetHostName());
+  srand48(0);
+
+  int NumFailed=0;
+
+  /***************************************************************/
+  /* nested and touching compact objects: every segment between  */
+  /* successive points may cross several surfaces, and the       */
+  /* near-surface points straddle every panel                    */
+  /***************************************************************/
+  RWGGeometry *G = new RWGGeometry("NestedSpheres.scuffgeo");
+  int NumRandom=5000;
+  int NX=NumRandom;
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   NX+=2*G->Surfaces[ns]->NumPanels;
+  HMatrix *XMatrix=new HMatrix(NX, 3);
+  double XMin[3]={-1.5, -1.5, -1.5}, XMax[3]={3.5, 1.5, 1.5};
+  AddPoints(G, XMatrix, 0, NumRandom, XMin, XMax);
+  if (CountMismatches(G, XMatrix, "nested/touching spheres")) NumFailed++;
+
+  // a dense line of points through the tangent point of the two
+  // touching spheres and through the centers of all four spheres
+  HMatrix *LMatrix=new HMatrix(1001, 3);
+  for(int n=0; n<=1000; n++)
+   { LMatrix->SetEntry(n, 0, -1.5 + 4.5*((double)n)/1000.0 + 1.0e-7);
+     LMatrix->SetEntry(n, 1, 1.0e-7);
+     LMatrix->SetEntry(n, 2, 0.0);
+   };
+  if (CountMismatches(G, LMatrix, "line through tangent point")) NumFailed++;
+  delete LMatrix;
+  delete XMatrix;
+  delete G;
+
+  /***************************************************************/
+  /* open surfaces with shared boundaries (periodic slab): here  */
+  /* GetRegionIndex() uses the ray-piercing test                 */
+  /***************************************************************/
+  G = new RWGGeometry("SiSlab_40.scuffgeo");
+  NumRandom=2000;
+  NX=NumRandom;
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   NX+=2*G->Surfaces[ns]->NumPanels;
+  XMatrix=new HMatrix(NX, 3);
+  double SMin[3]={0.05, 0.05, -0.5}, SMax[3]={0.95, 0.95, 1.5};
+  AddPoints(G, XMatrix, 0, NumRandom, SMin, SMax);
+  if (CountMismatches(G, XMatrix, "slab")) NumFailed++;
+  delete XMatrix;
+  delete G;
+
+  if (NumFailed>0) abort();
+  return 0;
+}
@@ -0,0 +1,108 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-RotationalSymmetry.cc -- SCUFF-EM unit test comparing the
+ *                                 -- C_N symmetry-block solve against
+ *                                 -- the full BEM solve
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+#include "libIncField.h"
+
+using namespace scuff;
+
+#define TOLERANCE 1.0e-8
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM rotational-symmetry unit test running on %s",GetHostName());
+
+  RWGGeometry *G = new RWGGeometry("SiSphere_C4.scuffgeo");
+  if ( G->GetNumSymmetryBlocks()!=4 )
+   { printf("geometry has %i symmetry blocks (expected 4): FAILED\n",
+             G->GetNumSymmetryBlocks());
+     abort();
+   };
+
+  HMatrix *M      = G->AllocateBEMMatrix();
+  HMatrix **MBlocks = G->AllocateSymmetryBlocks();
+  HVector *KNFull = G->AllocateRHSVector();
+  HVector *KNSym  = G->AllocateRHSVector();
+
+  // a plane wave travelling off-axis, so that every harmonic is excited
+  cdouble E0[3]  = { 1.0, cdouble(0.0,0.4), cdouble(0.0,-0.3) };
+  double nHat[3] = { 0.0, 0.6, 0.8 };
+  PlaneWave PW(E0, nHat);
+
+  double OmegaList[] = { 0.1, 1.0 };
+  int NumFailed=0;
+  for(int nOmega=0; nOmega<2; nOmega++)
+   {
+     cdouble Omega=OmegaList[nOmega];
+
+     G->AssembleBEMMatrix(Omega, M);
+     M->LUFactorize();
+     G->AssembleRHSVector(Omega, &PW, KNFull);
+     M->LUSolve(KNFull);
+
+     G->AssembleSymmetryBlocks(Omega, MBlocks);
+     G->LUFactorizeSymmetryBlocks(MBlocks);
+     G->AssembleRHSVector(Omega, &PW, KNSym);
+     G->LUSolveSymmetric(MBlocks, KNSym);
+
+     double MaxKN=0.0, MaxDelta=0.0;
+     for(int n=0; n<G->TotalBFs; n++)
+      { MaxKN    = fmax(MaxKN,    abs(KNFull->GetEntry(n)));
+        MaxDelta = fmax(MaxDelta, abs(KNFull->GetEntry(n)-KNSym->GetEntry(n)));
+      };
+
+     double RelError = MaxDelta / MaxKN;
+     printf("Omega=%g: max relative C_N-vs-full difference %.2e: %s\n",
+             real(Omega), RelError, RelError<TOLERANCE ? "PASSED" : "FAILED");
+     if (RelError>=TOLERANCE)
+      NumFailed++;
+   };
+
+  for(int m=0; m<G->GetNumSymmetryBlocks(); m++)
+   delete MBlocks[m];
+  free(MBlocks);
+  delete M;
+  delete KNFull;
+  delete KNSym;
+  delete G;
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
@@ -0,0 +1,132 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-SpatialOrdering.cc -- SCUFF-EM unit test checking that the
+ *                              -- spatial traversal order leaves the BEM
+ *                              -- matrix and the KN numbering unchanged
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+#include "libIncField.h"
+
+using namespace scuff;
+
+#define TOLERANCE 1.0e-12
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+double MaxRelDiff(HMatrix *A, HMatrix *B)
+{
+  double MaxA=0.0, MaxDelta=0.0;
+  for(int nr=0; nr<A->NR; nr++)
+   for(int nc=0; nc<A->NC; nc++)
+    { MaxA     = fmax(MaxA, abs(A->GetEntry(nr,nc)));
+      MaxDelta = fmax(MaxDelta, abs(A->GetEntry(nr,nc)-B->GetEntry(nr,nc)));
+    };
+  return MaxDelta / MaxA;
+}
+
+double MaxRelDiff(HVector *A, HVector *B)
+{
+  double MaxA=0.0, MaxDelta=0.0;
+  for(int n=0; n<A->N; n++)
+   { MaxA     = fmax(MaxA, abs(A->GetEntry(n)));
+     MaxDelta = fmax(MaxDelta, abs(A->GetEntry(n)-B->GetEntry(n)));
+   };
+  return MaxDelta / MaxA;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM spatial ordering unit test running on %s",GetHostName());
+
+  RWGGeometry *G = new RWGGeometry("SiSpheres_255.scuffgeo");
+  HMatrix *M0  = G->AllocateBEMMatrix();
+  HMatrix *M1  = G->AllocateBEMMatrix();
+  HVector *KN0 = G->AllocateRHSVector();
+  HVector *KN1 = G->AllocateRHSVector();
+
+  cdouble E0[3]  = { 1.0, 0.0, 0.0 };
+  double nHat[3] = { 0.0, 0.0, 1.0 };
+  PlaneWave PW(E0, nHat);
+
+  cdouble Omega=1.0;
+  int NumFailed=0;
+
+  /*--------------------------------------------------------------*/
+  /*- baseline: mesh-file traversal order ------------------------*/
+  /*--------------------------------------------------------------*/
+  G->AssembleBEMMatrix(Omega, M0);
+  G->AssembleRHSVector(Omega, &PW, KN0);
+  M1->Copy(M0);
+  M1->LUFactorize();
+  M1->LUSolve(KN0);
+
+  /*--------------------------------------------------------------*/
+  /*- spatial traversal order; this must not change anything -----*/
+  /*--------------------------------------------------------------*/
+  G->SetSpatialEdgeOrdering(true);
+  for(int ns=0; ns<G->NumSurfaces; ns++)
+   if (G->Surfaces[ns]->SpatialOrder==0)
+    { printf("surface %i has no spatial order: FAILED\n",ns);
+      NumFailed++;
+    };
+
+  G->AssembleBEMMatrix(Omega, M1);
+  double MError=MaxRelDiff(M0, M1);
+  printf("BEM matrix with spatial ordering: %.2e: %s\n",
+          MError, MError<TOLERANCE ? "PASSED" : "FAILED");
+  if (MError>=TOLERANCE) NumFailed++;
+
+  G->AssembleRHSVector(Omega, &PW, KN1);
+  M1->LUFactorize();
+  M1->LUSolve(KN1);
+  double KNError=MaxRelDiff(KN0, KN1);
+  printf("KN vector with spatial ordering: %.2e: %s\n",
+          KNError, KNError<TOLERANCE ? "PASSED" : "FAILED");
+  if (KNError>=TOLERANCE) NumFailed++;
+
+  G->SetSpatialEdgeOrdering(false);
+
+  delete M0;
+  delete M1;
+  delete KN0;
+  delete KN1;
+  delete G;
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
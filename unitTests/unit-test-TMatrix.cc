@@ -0,0 +1,162 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-TMatrix.cc -- SCUFF-EM unit test comparing the scuff-tmatrix
+ *                      -- block computation (RHS matrix, multi-column
+ *                      -- solve, projection matrix) against the original
+ *                      -- wave-by-wave computation
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+#include "SphericalWave.h"
+
+using namespace scuff;
+
+#define LMAX 2
+
+// both paths use the same panel cubature for the RHS and the same
+// edge projection integrals for the moments, so they differ only by
+// roundoff in the spherical-wave evaluations and the matrix algebra
+#define TOLERANCE 1.0e-8
+
+// in GetSphericalMoments.cc and SphericalWave.cc
+HVector *GetSphericalMoments(RWGGeometry *S, cdouble k, int lMax,
+                             HVector *KNVector, HVector *AVector=0);
+HMatrix *GetSphericalProjectionMatrix(RWGGeometry *G, cdouble k, int lMax,
+                                      HMatrix *PMatrix=0);
+HMatrix *GetSphericalWaveRHSMatrix(RWGGeometry *G, cdouble Omega, int lMax,
+                                   HMatrix *RMatrix=0);
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+double MaxAbs(HMatrix *A)
+{
+  double Max=0.0;
+  for(int nr=0; nr<A->NR; nr++)
+   for(int nc=0; nc<A->NC; nc++)
+    Max = fmax(Max, abs(A->GetEntry(nr,nc)));
+  return Max;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM T-matrix unit test running on %s",GetHostName());
+
+  // one PEC scatterer (one BF per edge) and one dielectric
+  // scatterer (two BFs per edge)
+  const char *GeoFiles[2] = { "PECSphere_255.scuffgeo",
+                              "SiSphere_255.scuffgeo" };
+  cdouble Omega = 1.0;
+  int NumMoments = 2*(LMAX+1)*(LMAX+1);
+  const char *TypeChar="ME";
+
+  int NumFailed=0;
+  for(int ng=0; ng<2; ng++)
+   {
+     RWGGeometry *G = new RWGGeometry(GeoFiles[ng]);
+     HMatrix *M  = G->AllocateBEMMatrix();
+     HVector *KN = G->AllocateRHSVector();
+     HVector *AVector = new HVector(NumMoments, LHM_COMPLEX);
+     G->AssembleBEMMatrix(Omega, M);
+     M->LUFactorize();
+
+     /*--------------------------------------------------------------*/
+     /*- block path, as in scuff-tmatrix ----------------------------*/
+     /*--------------------------------------------------------------*/
+     HMatrix *RMatrix = GetSphericalWaveRHSMatrix(G, Omega, LMAX);
+     HMatrix *R0      = new HMatrix(RMatrix);
+     M->LUSolve(RMatrix);
+     HMatrix *PMatrix = GetSphericalProjectionMatrix(G, Omega, LMAX);
+     HMatrix *TMatrix = new HMatrix(NumMoments, NumMoments, LHM_COMPLEX);
+     PMatrix->Multiply(RMatrix, TMatrix);
+
+     /*--------------------------------------------------------------*/
+     /*- wave-by-wave path: one RHS assembly, one solve, and one     */
+     /*- GetSphericalMoments() call per incident (l,m,Type) wave     */
+     /*--------------------------------------------------------------*/
+     HMatrix *T0 = new HMatrix(NumMoments, NumMoments, LHM_COMPLEX);
+     SphericalWave SW;
+     double MaxRHSDelta=0.0, MaxTDelta=0.0;
+     for(int nc=0, l=0; l<=LMAX; l++)
+      for(int m=-l; m<=l; m++)
+       for(int Type=SW_MAGNETIC; Type<=SW_ELECTRIC; Type++, nc++)
+        {
+          if (l==0)
+           continue;
+
+          SW.SetL(l);
+          SW.SetM(m);
+          SW.SetType(Type);
+          G->AssembleRHSVector(Omega, &SW, KN);
+          for(int nbf=0; nbf<G->TotalBFs; nbf++)
+           MaxRHSDelta = fmax(MaxRHSDelta, abs(KN->GetEntry(nbf)-R0->GetEntry(nbf,nc)));
+
+          M->LUSolve(KN);
+          GetSphericalMoments(G, Omega, LMAX, KN, AVector);
+          for(int nr=0; nr<NumMoments; nr++)
+           { T0->SetEntry(nr, nc, AVector->GetEntry(nr));
+             MaxTDelta = fmax(MaxTDelta, abs(AVector->GetEntry(nr)-TMatrix->GetEntry(nr,nc)));
+           };
+          Log(" %s %c(%i,%i): T diagonal=%s/%s",GeoFiles[ng],TypeChar[Type],l,m,
+                z2s(T0->GetEntry(nc,nc)),z2s(TMatrix->GetEntry(nc,nc)));
+        };
+
+     double RelError = MaxRHSDelta / MaxAbs(R0);
+     printf("%s: RHS matrix vs. AssembleRHSVector: %.2e: %s\n",
+             GeoFiles[ng], RelError, RelError<TOLERANCE ? "PASSED" : "FAILED");
+     if (RelError>=TOLERANCE)
+      NumFailed++;
+
+     RelError = MaxTDelta / MaxAbs(T0);
+     printf("%s: block vs. wave-by-wave T-matrix: %.2e: %s\n",
+             GeoFiles[ng], RelError, RelError<TOLERANCE ? "PASSED" : "FAILED");
+     if (RelError>=TOLERANCE)
+      NumFailed++;
+
+     delete T0;
+     delete TMatrix;
+     delete PMatrix;
+     delete R0;
+     delete RMatrix;
+     delete AVector;
+     delete KN;
+     delete M;
+     delete G;
+   };
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
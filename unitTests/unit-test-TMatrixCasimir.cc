@@ -0,0 +1,126 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-TMatrixCasimir.cc -- SCUFF-EM unit test comparing the
+ *                             -- scuff-cas3D T-matrix fast path against
+ *                             -- the full BEM calculation
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+#include "scuff-cas3D.h"
+
+using namespace scuff;
+
+#define NUMQUANTITIES 3
+#define TOLERANCE     1.0e-3
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+SC3Data *CreateData(RWGGeometry *G, const char *FileBase)
+{
+  int WhichQuantities = QUANTITY_ENERGY | QUANTITY_XFORCE | QUANTITY_ZFORCE;
+  SC3Data *SC3D=CreateSC3Data(G, const_cast<char *>("PECSpheres_Sweep.trans"),
+                              WhichQuantities, NUMQUANTITIES, 0, 0, false,
+                              const_cast<char *>(FileBase));
+  SC3D->UseExistingData = false;
+  SC3D->WriteCache      = 0;
+  memset(SC3D->XiConverged, 0, SC3D->NTNQ*sizeof(bool));
+  return SC3D;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM T-matrix Casimir unit test running on %s",GetHostName());
+
+  RWGGeometry *G = new RWGGeometry("PECSpheres_255.scuffgeo");
+
+  SC3Data *BEM = CreateData(G, "unit-test-TMatrixCasimir-BEM");
+  SC3Data *TM  = CreateData(G, "unit-test-TMatrixCasimir-TM");
+  TM->TMatrixData = CreateTMatrixData(TM, 0);
+  if (TM->TMatrixData==0)
+   { printf("T-matrix fast path not available: FAILED\n");
+     abort();
+   };
+
+  // the sweep file has three admissible transformations (center
+  // separations 8, 7, 6) and one (separation 3) that is not; the
+  // fast path is validated at separation 6 and should then be
+  // used for separations 8 and 7
+  int NT=BEM->NumTransformations;
+  double XiList[] = { 0.1, 0.5 };
+  int NumFailed=0;
+  for(int nXi=0; nXi<2; nXi++)
+   {
+     double Xi=XiList[nXi];
+     double *EFTBEM = new double[NT*NUMQUANTITIES];
+     double *EFTTM  = new double[NT*NUMQUANTITIES];
+
+     int FastPathCount=GetTMatrixFastPathCount(TM);
+     GetCasimirIntegrand(BEM, Xi, 0, EFTBEM);
+     GetCasimirIntegrand(TM,  Xi, 0, EFTTM);
+     FastPathCount=GetTMatrixFastPathCount(TM) - FastPathCount;
+
+     printf("Xi=%g: transformations computed via T-matrices: %i: %s\n",
+             Xi, FastPathCount, FastPathCount==2 ? "PASSED" : "FAILED");
+     if (FastPathCount!=2)
+      NumFailed++;
+
+     for(int nt=0; nt<NT; nt++)
+      { double *B = EFTBEM + nt*NUMQUANTITIES;
+        double *T = EFTTM  + nt*NUMQUANTITIES;
+        Log(" Xi=%g %s: E=(%+.8e,%+.8e) FX=(%+.8e,%+.8e) FZ=(%+.8e,%+.8e)",
+              Xi, BEM->GTCList[nt]->Tag, B[0], T[0], B[1], T[1], B[2], T[2]);
+
+        // force components are compared relative to the z-force,
+        // since the x-force vanishes by symmetry
+        double EError = fabs(T[0]-B[0]) / fabs(B[0]);
+        double FError = fmax( fabs(T[1]-B[1]), fabs(T[2]-B[2]) ) / fabs(B[2]);
+        double Error  = fmax(EError, FError);
+        printf("Xi=%g, separation %s: T-matrix vs. BEM: %.2e: %s\n",
+                Xi, BEM->GTCList[nt]->Tag, Error, Error<TOLERANCE ? "PASSED" : "FAILED");
+        if (Error>=TOLERANCE)
+         NumFailed++;
+      };
+
+     delete[] EFTBEM;
+     delete[] EFTTM;
+   };
+
+  delete G;
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
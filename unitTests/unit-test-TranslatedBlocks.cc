@@ -0,0 +1,101 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-TranslatedBlocks.cc -- SCUFF-EM unit test checking that the
+ *                               -- off-diagonal blocks AssembleBEMMatrix
+ *                               -- reuses for translated copies of a
+ *                               -- surface agree with blocks assembled
+ *                               -- directly by AssembleBEMMatrixBlock
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+
+using namespace scuff;
+
+#define TOLERANCE 1.0e-6
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM translated-block unit test running on %s",GetHostName());
+
+  RWGGeometry *G = new RWGGeometry("SiSphereArray_255.scuffgeo");
+  HMatrix *M = G->AllocateBEMMatrix();
+
+  int NBF = G->Surfaces[0]->NumBFs;
+  HMatrix *B = new HMatrix(NBF, NBF, LHM_COMPLEX);
+
+  cdouble OmegaList[] = { 0.1, 1.0, cdouble(0.0,1.0) };
+  int NumFailed=0;
+  for(int nOmega=0; nOmega<3; nOmega++)
+   {
+     cdouble Omega=OmegaList[nOmega];
+     G->AssembleBEMMatrix(Omega, M);
+
+     /*--------------------------------------------------------------*/
+     /*- compare every off-diagonal block (including those filled in */
+     /*- by reuse and by symmetrization) with a direct computation   */
+     /*--------------------------------------------------------------*/
+     double MaxRelError=0.0;
+     for(int ns=0; ns<G->NumSurfaces; ns++)
+      for(int nsp=0; nsp<G->NumSurfaces; nsp++)
+       { if (ns==nsp) continue;
+         B->Zero();
+         G->AssembleBEMMatrixBlock(ns, nsp, Omega, 0, B);
+         int RowOffset=G->BFIndexOffset[ns], ColOffset=G->BFIndexOffset[nsp];
+         double MaxB=0.0, MaxDelta=0.0;
+         for(int nr=0; nr<NBF; nr++)
+          for(int nc=0; nc<NBF; nc++)
+           { cdouble b=B->GetEntry(nr,nc);
+             cdouble m=M->GetEntry(RowOffset+nr, ColOffset+nc);
+             MaxB=fmax(MaxB, abs(b));
+             MaxDelta=fmax(MaxDelta, abs(m-b));
+           };
+         MaxRelError=fmax(MaxRelError, MaxDelta/MaxB);
+       };
+
+     printf("Omega=(%g,%g): max relative block error %.2e: %s\n",
+             real(Omega), imag(Omega), MaxRelError,
+             MaxRelError<TOLERANCE ? "PASSED" : "FAILED");
+     if (MaxRelError>=TOLERANCE)
+      NumFailed++;
+   };
+
+  delete B;
+  delete M;
+  delete G;
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
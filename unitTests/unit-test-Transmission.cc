@@ -0,0 +1,232 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-Transmission.cc -- SCUFF-EM unit test for the scuff-transmission
+ *                           -- Fourier integrals, accelerated matrix
+ *                           -- assembly, and Floquet-mode fluxes
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+#include "scuff-transmission.h"
+
+using namespace scuff;
+
+// f1f2 is accurate to ~1e-10 near its Taylor-expansion thresholds;
+// the accelerated and unaccelerated BEM matrices agree to roundoff;
+// the cubature of the poynting vector is exact for the
+// specular orders and picks up the evanescent orders only at the
+// level of exp(-2*pi*distance to the film)
+#define NUMGL        64
+#define F1F2TOL      1.0e-9
+#define MATRIXTOL    1.0e-10
+#define FLUXTOL      1.0e-3
+
+#define ZABOVE  3.0
+#define ZBELOW -2.0
+
+/***************************************************************/
+/* Gauss-Legendre points and weights on [0,1]                  */
+/***************************************************************/
+void GetGLRule(int N, double *x, double *w)
+{
+  for(int i=0; i<N; i++)
+   { double z=cos(M_PI*(i+0.75)/(N+0.5)), z1, dP;
+     do
+      { double P1=1.0, P2=0.0;
+        for(int j=1; j<=N; j++)
+         { double P3=P2;
+           P2=P1;
+           P1=((2.0*j-1.0)*z*P2 - (j-1.0)*P3)/j;
+         };
+        dP = N*(z*P1-P2)/(z*z-1.0);
+        z1 = z;
+        z  = z1 - P1/dP;
+      } while( fabs(z-z1) > 1.0e-15 );
+     x[i] = 0.5*(1.0-z);
+     w[i] = 1.0/((1.0-z*z)*dP*dP);
+   };
+}
+
+/***************************************************************/
+/* f1, f2 by brute-force quadrature over the triangle 0<v<u<1  */
+/***************************************************************/
+void f1f2BruteForce(double X, double Y, cdouble *f1, cdouble *f2)
+{
+  static double x[NUMGL], w[NUMGL];
+  static bool Initialized=false;
+  if (!Initialized)
+   { GetGLRule(NUMGL, x, w);
+     Initialized=true;
+   };
+
+  *f1=*f2=0.0;
+  for(int nu=0; nu<NUMGL; nu++)
+   for(int nv=0; nv<NUMGL; nv++)
+    { double u=x[nu], v=u*x[nv], wt=w[nu]*w[nv]*u;
+      cdouble Exp=exp(-II*(u*X+v*Y));
+      *f1 += wt*u*Exp;
+      *f2 += wt*v*Exp;
+    };
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM transmission unit test running on %s",GetHostName());
+  int NumFailed=0;
+
+  /*--------------------------------------------------------------*/
+  /*- f1f2: generic arguments and arguments on either side of the */
+  /*- switch to the Taylor-expanded divided differences           */
+  /*--------------------------------------------------------------*/
+  double Args[]={ 0.0, 1.0e-9, -2.0e-4, 2.999e-4, 3.001e-4, 0.01,
+                  -0.5, 0.999, 1.001, 2.0*M_PI, -7.3, 15.0 };
+  int NumArgs=sizeof(Args)/sizeof(Args[0]);
+  double MaxF1F2Error=0.0;
+  for(int nx=0; nx<NumArgs; nx++)
+   for(int ny=0; ny<NumArgs; ny++)
+    for(int Shift=0; Shift<2; Shift++)
+     { double X=Args[nx];
+       double Y= Shift ? -X+Args[ny] : Args[ny];
+       cdouble f1, f2, f1Ref, f2Ref;
+       f1f2(X, Y, &f1, &f2);
+       f1f2BruteForce(X, Y, &f1Ref, &f2Ref);
+       MaxF1F2Error=fmax(MaxF1F2Error, abs(f1-f1Ref)/abs(f1Ref));
+       MaxF1F2Error=fmax(MaxF1F2Error, abs(f2-f2Ref)/abs(f2Ref));
+     };
+  printf("f1f2 vs. brute-force quadrature: %.2e: %s\n",
+          MaxF1F2Error, MaxF1F2Error<F1F2TOL ? "PASSED" : "FAILED");
+  if (MaxF1F2Error>=F1F2TOL)
+   NumFailed++;
+
+  /*--------------------------------------------------------------*/
+  /*- a dielectric slab, one unit cell thick ----------------------*/
+  /*--------------------------------------------------------------*/
+  RWGGeometry::AssignBasisFunctionsToExteriorEdges=false;
+  RWGGeometry *G = new RWGGeometry("SiSlab_40.scuffgeo");
+  HMatrix *M    = G->AllocateBEMMatrix();
+  HMatrix *MRef = G->AllocateBEMMatrix();
+  HVector *KN   = G->AllocateRHSVector();
+
+  double XAbove[3]={0.0, 0.0, ZABOVE};
+  double XBelow[3]={0.0, 0.0, ZBELOW};
+  int RegionAbove=G->GetRegionIndex(XAbove);
+  int RegionBelow=G->GetRegionIndex(XBelow);
+
+  void **Accelerators = CreateABMBAccelerators(G);
+
+  // below the diffraction threshold (k=1 < 2*pi/(1+sin Theta)),
+  // the accelerator is filled at the first angle and reused at
+  // the second
+  cdouble Omega=1.0;
+  double ThetaList[2]={ 0.0, 30.0*M_PI/180.0 };
+  for(int nTheta=0; nTheta<2; nTheta++)
+   {
+     double Theta=ThetaList[nTheta];
+     double kBloch[2];
+     kBloch[0] = real(Omega)*sin(Theta);
+     kBloch[1] = 0.0;
+
+     /*--------------------------------------------------------------*/
+     /*- accelerated vs. unaccelerated matrix assembly --------------*/
+     /*--------------------------------------------------------------*/
+     AssembleBEMMatrix(G, Omega, kBloch, Accelerators, M);
+     AssembleBEMMatrix(G, Omega, kBloch, 0, MRef);
+     double MaxM=0.0, MaxDelta=0.0;
+     for(int nr=0; nr<M->NR; nr++)
+      for(int nc=0; nc<M->NC; nc++)
+       { MaxM     = fmax(MaxM, abs(MRef->GetEntry(nr,nc)));
+         MaxDelta = fmax(MaxDelta, abs(M->GetEntry(nr,nc)-MRef->GetEntry(nr,nc)));
+       };
+     double RelError=MaxDelta/MaxM;
+     printf("Theta=%g: accelerated vs. direct BEM matrix: %.2e: %s\n",
+             Theta*180.0/M_PI, RelError, RelError<MATRIXTOL ? "PASSED" : "FAILED");
+     if (RelError>=MATRIXTOL)
+      NumFailed++;
+
+     /*--------------------------------------------------------------*/
+     /*- Floquet-mode vs. field-cubature fluxes for TE and TM waves  */
+     /*--------------------------------------------------------------*/
+     int NumOrders = CountPropagatingOrders(G, Omega, kBloch, RegionAbove)
+                    +CountPropagatingOrders(G, Omega, kBloch, RegionBelow);
+     printf("Theta=%g: higher orders below threshold: %i: %s\n",
+             Theta*180.0/M_PI, NumOrders, NumOrders==0 ? "PASSED" : "FAILED");
+     if (NumOrders!=0)
+      NumFailed++;
+
+     M->LUFactorize();
+     double nHat[3]={ sin(Theta), 0.0, cos(Theta) };
+     cdouble E0[2][3]={ { 0.0, 1.0, 0.0 }, { cos(Theta), 0.0, -sin(Theta) } };
+     double MaxFluxError=0.0;
+     for(int Pol=0; Pol<2; Pol++)
+      { PlaneWave PW(E0[Pol], nHat);
+        G->AssembleRHSVector(Omega, kBloch, &PW, KN);
+        M->LUSolve(KN);
+
+        double Flux[2], FluxRef[2];
+        GetTRFluxFloquet(G, &PW, KN, Omega, kBloch, ZABOVE, RegionAbove,
+                         ZBELOW, RegionBelow, Flux);
+        GetTRFlux(G, &PW, KN, Omega, 0, kBloch, ZABOVE, ZBELOW, FluxRef);
+        double IncFlux = cos(Theta)/(2.0*ZVAC);
+        Log(" Theta=%g Pol=%i: T=%e/%e R=%e/%e",Theta*180.0/M_PI,Pol,
+              Flux[0]/IncFlux,FluxRef[0]/IncFlux,Flux[1]/IncFlux,FluxRef[1]/IncFlux);
+        for(int n=0; n<2; n++)
+         MaxFluxError=fmax(MaxFluxError, fabs(Flux[n]-FluxRef[n])/IncFlux);
+      };
+     printf("Theta=%g: Floquet-mode vs. field-cubature fluxes: %.2e: %s\n",
+             Theta*180.0/M_PI, MaxFluxError, MaxFluxError<FLUXTOL ? "PASSED" : "FAILED");
+     if (MaxFluxError>=FLUXTOL)
+      NumFailed++;
+   };
+
+  /*--------------------------------------------------------------*/
+  /*- above the threshold the nonzero orders must be detected, so */
+  /*- that scuff-transmission falls back to field cubature        */
+  /*--------------------------------------------------------------*/
+  double kBloch[2]={ 0.0, 0.0 };
+  int NumOrders = CountPropagatingOrders(G, 7.0, kBloch, RegionAbove);
+  printf("Omega=7: higher orders above threshold: %i: %s\n",
+          NumOrders, NumOrders==4 ? "PASSED" : "FAILED");
+  if (NumOrders!=4)
+   NumFailed++;
+
+  DestroyABMBAccelerators(G, Accelerators);
+  delete KN;
+  delete MRef;
+  delete M;
+  delete G;
+
+  if (NumFailed>0)
+   abort();
+
+  return 0;
+
+}
@@ -0,0 +1,159 @@
+/* Copyright (C) 2005-2011 M. T. Homer Reid
+ *
+ * This file is part of SCUFF-EM.
+ *
+ * SCUFF-EM is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * SCUFF-EM is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * unit-test-UpdateBEMMatrix.cc -- SCUFF-EM unit test comparing BEM
+ *                              -- matrices at two frequencies updated
+ *                              -- by UpdateBEMMatrix after vertex
+ *                              -- motion against full reassembly
+ *
+ * agent            -- 10/2026
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <libhrutil.h>
+#include "libscuff.h"
+
+using namespace scuff;
+
+/***************************************************************/
+/* updated rows are computed by the same panel-panel routines  */
+/* as in full assembly, but entries that full assembly obtains */
+/* from the transposed panel pair may differ by roundoff       */
+/***************************************************************/
+#define TOLERANCE 1.0e-8
+
+/***************************************************************/
+/* max |M1-M2| / max |M2|                                      */
+/***************************************************************/
+double MatrixMismatch(HMatrix *M1, HMatrix *M2)
+{
+  double MaxDelta=0.0, MaxEntry=0.0;
+  for(int nr=0; nr<M2->NR; nr++)
+   for(int nc=0; nc<M2->NC; nc++)
+    { MaxDelta=fmax(MaxDelta, abs(M1->GetEntry(nr,nc) - M2->GetEntry(nr,nc)));
+      MaxEntry=fmax(MaxEntry, abs(M2->GetEntry(nr,nc)));
+    };
+  return MaxDelta / MaxEntry;
+}
+
+/***************************************************************/
+/* move the vertices of surface #ns that lie above height ZMin */
+/* (relative to its center) upward by DZ                       */
+/***************************************************************/
+int MoveCap(RWGGeometry *G, int ns, double ZMin, double DZ)
+{
+  RWGSurface *S=G->Surfaces[ns];
+  int *VList=(int *)mallocEC(S->NumVertices*sizeof(int));
+  double *VNew=(double *)mallocEC(3*S->NumVertices*sizeof(double));
+  double ZCenter=0.5*(S->RMax[2] + S->RMin[2]);
+  int NumMoved=0;
+  for(int nv=0; nv<S->NumVertices; nv++)
+   { double *V=S->Vertices + 3*nv;
+     if (V[2]-ZCenter < ZMin) continue;
+     VList[NumMoved]=nv;
+     VNew[3*NumMoved+0]=V[0];
+     VNew[3*NumMoved+1]=V[1];
+     VNew[3*NumMoved+2]=V[2] + DZ;
+     NumMoved++;
+   };
+  int NumMovedEdges=G->UpdateVertices(ns, NumMoved, VList, VNew);
+  free(VList);
+  free(VNew);
+  return NumMovedEdges;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int CheckMatrix(const char *What, RWGGeometry *G, cdouble Omega, HMatrix *M)
+{
+  HMatrix *MRef=G->AssembleBEMMatrix(Omega);
+  double Mismatch=MatrixMismatch(M, MRef);
+  bool OK = Mismatch < TOLERANCE;
+  printf("%-40s Omega=(%g,%g): %.2e: %s\n",
+          What, real(Omega), imag(Omega), Mismatch, OK ? "PASSED" : "FAILED");
+  delete MRef;
+  return OK ? 0 : 1;
+}
+
+/***************************************************************/
+/***************************************************************/
+/***************************************************************/
+int main(int argc, char *argv[])
+{
+  SetLogFileName("scuff-unit-tests.log");
+  Log("SCUFF-EM UpdateBEMMatrix unit test running on %s",GetHostName());
+
+  // two identical dielectric spheres, so that moving vertices
+  // of one also breaks the reuse of identical diagonal blocks
+  RWGGeometry *G = new RWGGeometry("SiSpheres_255.scuffgeo");
+
+  // a real and an imaginary frequency
+  cdouble Omega1 = 0.5, Omega2 = cdouble(0.0, 2.0);
+  HMatrix *M1 = G->AssembleBEMMatrix(Omega1);
+  HMatrix *M2 = G->AssembleBEMMatrix(Omega2);
+
+  int NumFailed=0;
+
+  /*--------------------------------------------------------------*/
+  /*- first deformation: update both matrices, then clear the     */
+  /*- moved-edge records                                          */
+  /*--------------------------------------------------------------*/
+  int NumMovedEdges=MoveCap(G, 0, 0.6, 0.05);
+  Log("First deformation moved %i edges",NumMovedEdges);
+  if (NumMovedEdges==0 || NumMovedEdges==G->Surfaces[0]->NumEdges)
+   ErrExit("%s:%i: bad test deformation (%i edges)",__FILE__,__LINE__,NumMovedEdges);
+
+  G->UpdateBEMMatrix(Omega1, M1);
+  G->UpdateBEMMatrix(Omega2, M2);
+  G->ClearMovedEdges();
+  NumFailed+=CheckMatrix("cap of sphere 1 moved:",            G, Omega1, M1);
+  NumFailed+=CheckMatrix("cap of sphere 1 moved:",            G, Omega2, M2);
+
+  /*--------------------------------------------------------------*/
+  /*- second deformation on the other surface, applied in two     */
+  /*- steps before any update                                     */
+  /*--------------------------------------------------------------*/
+  MoveCap(G, 1, 0.8, 0.03);
+  MoveCap(G, 1, 0.9, 0.02);
+  G->UpdateBEMMatrix(Omega2, M2);
+  G->UpdateBEMMatrix(Omega1, M1);
+  G->ClearMovedEdges();
+  NumFailed+=CheckMatrix("caps of spheres 1 and 2 moved:",    G, Omega1, M1);
+  NumFailed+=CheckMatrix("caps of spheres 1 and 2 moved:",    G, Omega2, M2);
+
+  /*--------------------------------------------------------------*/
+  /*- with nothing moved since the last clear, an update must not */
+  /*- change anything                                             */
+  /*--------------------------------------------------------------*/
+  G->UpdateBEMMatrix(Omega1, M1);
+  NumFailed+=CheckMatrix("no motion since last clear:",       G, Omega1, M1);
+
+  delete M1;
+  delete M2;
+  delete G;
+
+  if (NumFailed>0) abort();
+  return 0;
+}